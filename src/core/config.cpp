@@ -61,6 +61,9 @@ JsonDocument BruceConfig::toJson() const {
     setting["startupApp"] = startupApp;
     setting["startupAppJSInterpreterFile"] = startupAppJSInterpreterFile;
     setting["wigleBasicToken"] = wigleBasicToken;
+    setting["wardriveDedupKB"] = wardriveDedupKB;
+    setting["wardriveRelogMin"] = wardriveRelogMin;
+    setting["wardriveBinaryLog"] = wardriveBinaryLog;
     setting["devMode"] = devMode;
     setting["colorInverted"] = colorInverted;
 
@@ -347,6 +350,24 @@ void BruceConfig::fromFile(bool checkFS) {
         count++;
         log_e("Fail");
     }
+    if (!setting["wardriveDedupKB"].isNull()) {
+        wardriveDedupKB = setting["wardriveDedupKB"].as<int>();
+    } else {
+        count++;
+        log_e("Fail");
+    }
+    if (!setting["wardriveRelogMin"].isNull()) {
+        wardriveRelogMin = setting["wardriveRelogMin"].as<int>();
+    } else {
+        count++;
+        log_e("Fail");
+    }
+    if (!setting["wardriveBinaryLog"].isNull()) {
+        wardriveBinaryLog = setting["wardriveBinaryLog"].as<bool>();
+    } else {
+        count++;
+        log_e("Fail");
+    }
     if (!setting["devMode"].isNull()) {
         devMode = setting["devMode"].as<int>();
     } else {
@@ -457,6 +478,8 @@ void BruceConfig::validateConfig() {
     validateLedEffectDirectionValue();
 #endif
     validateMifareKeysItems();
+    validateWardriveDedupKB();
+    validateWardriveRelogMin();
     validateDevModeValue();
     validateColorInverted();
     validateBadUSBBLEKeyboardLayout();
@@ -717,6 +740,33 @@ void BruceConfig::setWigleBasicToken(String value) {
     saveFile();
 }
 
+void BruceConfig::setWardriveDedupKB(int value) {
+    wardriveDedupKB = value;
+    validateWardriveDedupKB();
+    saveFile();
+}
+
+void BruceConfig::validateWardriveDedupKB() {
+    if (wardriveDedupKB < 4) wardriveDedupKB = 4;
+    if (wardriveDedupKB > 1024) wardriveDedupKB = 1024;
+}
+
+void BruceConfig::setWardriveRelogMin(int value) {
+    wardriveRelogMin = value;
+    validateWardriveRelogMin();
+    saveFile();
+}
+
+void BruceConfig::validateWardriveRelogMin() {
+    if (wardriveRelogMin < 0) wardriveRelogMin = 0;
+    if (wardriveRelogMin > 1440) wardriveRelogMin = 1440;
+}
+
+void BruceConfig::setWardriveBinaryLog(bool value) {
+    wardriveBinaryLog = value;
+    saveFile();
+}
+
 void BruceConfig::setDevMode(int value) {
     devMode = value;
     validateDevModeValue();
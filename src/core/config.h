@@ -81,6 +81,9 @@ public:
     String startupApp = "";
     String startupAppJSInterpreterFile = "";
     String wigleBasicToken = "";
+    int wardriveDedupKB = 16;       // Memory for the wardriving "already logged" set
+    int wardriveRelogMin = 0;       // Log a device again after this many minutes, 0 = once per session
+    bool wardriveBinaryLog = false; // Compact .bwd log instead of WigleWifi CSV, exported later
     int devMode = 0;
     int colorInverted = 1;
     int badUSBBLEKeyboardLayout = 0;
@@ -174,6 +177,11 @@ public:
     void setStartupApp(String value);
     void setStartupAppJSInterpreterFile(String value);
     void setWigleBasicToken(String value);
+    void setWardriveDedupKB(int value);
+    void validateWardriveDedupKB();
+    void setWardriveRelogMin(int value);
+    void validateWardriveRelogMin();
+    void setWardriveBinaryLog(bool value);
     void setDevMode(int value);
     void validateDevModeValue();
     void setColorInverted(int value);
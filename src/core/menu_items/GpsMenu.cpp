@@ -4,6 +4,7 @@
 #include "core/utils.h"
 #include "modules/gps/gps_tracker.h"
 #include "modules/gps/wardriving.h"
+#include "modules/gps/wardriving_export.h"
 #include <math.h>
 
 void GpsMenu::optionsMenu() {
@@ -22,24 +23,78 @@ void GpsMenu::optionsMenu() {
 
 void GpsMenu::wardrivingMenu() {
     options = {
-        {"Scan WiFi Networks", []() { Wardriving(true, false); }},
-        {"Scan BLE Devices",   []() { Wardriving(false, true); }},
-        {"Scan Both",          []() { Wardriving(true, true); } },
-        {"Back",               [this]() { optionsMenu(); }      },
+        {"Scan WiFi Networks", []() { Wardriving(true, false); }      },
+        {"Passive WiFi Scan",  []() { Wardriving(true, false, true); }},
+        {"Scan BLE Devices",   []() { Wardriving(false, true); }      },
+        {"Scan Both",          []() { Wardriving(true, true); }       },
+        {"Export Binary Log",  []() { wardrive_export_menu(); }       },
+        {"Back",               [this]() { optionsMenu(); }            },
     };
 
     loopOptions(options, MENU_TYPE_SUBMENU, "Wardriving");
 }
 void GpsMenu::configMenu() {
     options = {
-        {"Baudrate", setGpsBaudrateMenu                                 },
-        {"GPS Pins", [=]() { setUARTPinsMenu(bruceConfigPins.gps_bus); }},
-        {"Back",     [this]() { optionsMenu(); }                        },
+        {"Baudrate",      setGpsBaudrateMenu                                 },
+        {"GPS Pins",      [=]() { setUARTPinsMenu(bruceConfigPins.gps_bus); }},
+        {"Dedup Memory",  [this]() { dedupMemoryMenu(); }                    },
+        {"Re-log Window", [this]() { relogWindowMenu(); }                    },
+        {"Log Format",    [this]() { logFormatMenu(); }                      },
+        {"Back",          [this]() { optionsMenu(); }                        },
     };
 
     loopOptions(options, MENU_TYPE_SUBMENU, "GPS Config");
 }
 
+// Memory for the set of devices already logged; about 21 bytes per device (768 in 16 KB)
+void GpsMenu::dedupMemoryMenu() {
+    const int sizes[] = {4, 16, 64, 256, 1024};
+    int selected = 0;
+    options = {};
+    for (int i = 0; i < 5; i++) {
+        const int kb = sizes[i];
+        if (bruceConfig.wardriveDedupKB == kb) selected = i;
+        options.push_back(
+            {String(kb) + " KB",
+             [=]() { bruceConfig.setWardriveDedupKB(kb); },
+             bruceConfig.wardriveDedupKB == kb}
+        );
+    }
+    addOptionToMainMenu();
+
+    loopOptions(options, selected);
+}
+
+void GpsMenu::logFormatMenu() {
+    const bool binary = bruceConfig.wardriveBinaryLog;
+    options = {
+        {"WigleWifi CSV", [=]() { bruceConfig.setWardriveBinaryLog(false); }, !binary},
+        {"Binary (.bwd)", [=]() { bruceConfig.setWardriveBinaryLog(true); },  binary },
+    };
+    addOptionToMainMenu();
+
+    loopOptions(options, binary ? 1 : 0);
+}
+
+// How long before a device heard again is logged again at its new position
+void GpsMenu::relogWindowMenu() {
+    const int minutes[] = {0, 5, 15, 60, 240};
+    int selected = 0;
+    options = {};
+    for (int i = 0; i < 5; i++) {
+        const int min = minutes[i];
+        if (bruceConfig.wardriveRelogMin == min) selected = i;
+        options.push_back(
+            {min == 0 ? String("Never") : String(min) + " min",
+             [=]() { bruceConfig.setWardriveRelogMin(min); },
+             bruceConfig.wardriveRelogMin == min}
+        );
+    }
+    addOptionToMainMenu();
+
+    loopOptions(options, selected);
+}
+
 void GpsMenu::drawIcon(float scale) {
     clearIconArea();
     int radius = scale * 18;
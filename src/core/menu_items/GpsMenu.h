@@ -15,6 +15,9 @@ public:
 
 private:
     void configMenu(void);
+    void dedupMemoryMenu(void);
+    void relogWindowMenu(void);
+    void logFormatMenu(void);
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include "core/sd_functions.h"
 #include "crypto_commands.h"
 #include "gpio_commands.h"
+#include "gps_commands.h"
 #include "interpreter_commands.h"
 #include "ir_commands.h"
 #include "power_commands.h"
@@ -35,6 +36,7 @@ void SerialCli::setup() {
 
     createCryptoCommands(&_cli);
     createGpioCommands(&_cli);
+    createGpsCommands(&_cli);
     createIrCommands(&_cli);
     createPowerCommands(&_cli);
     createRfCommands(&_cli);
@@ -0,0 +1,53 @@
+#include "gps_commands.h"
+#include "core/sd_functions.h"
+#include "modules/gps/wardriving_export.h"
+#include <globals.h>
+
+uint32_t wardriveExportCallback(cmd *c) {
+    // wardrive export BruceWardriving/260101_120000_wardriving.bwd kml
+
+    Command cmd(c);
+
+    Argument arg = cmd.getArgument("filepath");
+    Argument formatArg = cmd.getArgument("format");
+    String filepath = arg.getValue();
+    String format = formatArg.getValue();
+    filepath.trim();
+    format.trim();
+    format.toLowerCase();
+
+    if (!filepath.startsWith("/")) filepath = "/" + filepath;
+    if (format != "csv" && format != "kml") {
+        serialDevice->println("Format must be csv or kml");
+        return false;
+    }
+
+    FS *fs;
+    if (!getFsStorage(fs)) return false;
+
+    if (!(*fs).exists(filepath)) {
+        serialDevice->println("File does not exist");
+        return false;
+    }
+
+    String outPath;
+    const WardriveExportResult result = wardrive_export_file(
+        *fs, filepath, format == "kml" ? WARDRIVE_EXPORT_KML : WARDRIVE_EXPORT_CSV, outPath
+    );
+    if (!result.ok) {
+        serialDevice->println("Not a binary wardriving log, or the output could not be written");
+        return false;
+    }
+    if (result.damaged) serialDevice->println("Skipped " + String(result.damaged) + " damaged spots");
+    if (result.corrupt) serialDevice->println("Stopped at a corrupt record");
+    serialDevice->println(String(result.rows) + " rows written to " + outPath);
+    return true;
+}
+
+void createGpsCommands(SimpleCLI *cli) {
+    Command wardriveCmd = cli->addCompositeCmd("wardrive");
+
+    Command exportCmd = wardriveCmd.addCommand("export", wardriveExportCallback);
+    exportCmd.addPosArg("filepath");
+    exportCmd.addPosArg("format", "csv");
+}
@@ -0,0 +1,8 @@
+#ifndef __SERIAL_GPS_CMD_H__
+#define __SERIAL_GPS_CMD_H__
+
+#include <SimpleCLI.h>
+
+void createGpsCommands(SimpleCLI *cli);
+
+#endif
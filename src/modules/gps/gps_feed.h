@@ -0,0 +1,172 @@
+#ifndef __GPS_FEED_H__
+#define __GPS_FEED_H__
+// Path of the GPS bytes from the UART to the NMEA parser. The UART receive callback copies what
+// the driver holds into a ring as soon as it arrives; the GPS task drains the ring into the parser
+// at its own pace, so a long WiFi scan or SD write no longer lets the UART overflow. A framer
+// watches the same bytes and counts complete, bad and cut-off sentences, which is how lost data
+// shows up (TinyGPSPlus silently drops a sentence cut short by the next '$'). Plain C++ so the
+// pipeline can be replayed off-target.
+#include "modules/wifi/packet_slab.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// What the GPS task publishes, read as one consistent copy
+struct GpsFix {
+    bool valid = false;     // position known
+    bool timeValid = false; // date and time known
+    double lat = 0;
+    double lng = 0;
+    float altitudeM = 0;
+    float hdop = 0; // 0 until a GGA carried it
+    uint8_t satellites = 0;
+    uint16_t year = 0;
+    uint8_t month = 0;
+    uint8_t day = 0;
+    uint8_t hour = 0;
+    uint8_t minute = 0;
+    uint8_t second = 0;
+    uint32_t fixMs = 0; // millis() when the position was parsed
+    uint32_t seq = 0;   // bumped on every new position
+
+    uint32_t ageMs(uint32_t nowMs) const { return valid ? nowMs - fixMs : UINT32_MAX; }
+};
+
+struct GpsFeedStats {
+    uint32_t bytes = 0;         // received from the UART
+    uint32_t overflowBytes = 0; // dropped, the ring was full
+    uint32_t sentences = 0;     // complete with a good checksum
+    uint32_t badChecksum = 0;
+    uint32_t truncated = 0; // cut off by the next '$', too long or without a checksum
+};
+
+// Splits the byte stream into sentences and checks "*hh" checksums. Does not parse fields.
+class NmeaFramer {
+public:
+    static const uint8_t MAX_SENTENCE = 82; // NMEA 0183, '$' to <LF>
+
+    enum Result : uint8_t { NONE, SENTENCE, BAD_CHECKSUM, TRUNCATED };
+
+    Result feed(char c) {
+        if (c == '$') {
+            const bool cut = inSentence_;
+            start();
+            return cut ? TRUNCATED : NONE;
+        }
+        if (!inSentence_) return NONE;
+        if (++length_ > MAX_SENTENCE) {
+            inSentence_ = false;
+            return TRUNCATED;
+        }
+        if (c == '\r' || c == '\n') {
+            inSentence_ = false;
+            if (starDigits_ != 2) return TRUNCATED;
+            return given_ == sum_ ? SENTENCE : BAD_CHECKSUM;
+        }
+        if (starDigits_ < 0) {
+            if (c == '*') starDigits_ = 0;
+            else sum_ ^= (uint8_t)c;
+            return NONE;
+        }
+        const int v = hex(c);
+        if (v < 0 || starDigits_ == 2) {
+            inSentence_ = false;
+            return BAD_CHECKSUM;
+        }
+        given_ = (uint8_t)(given_ << 4 | v);
+        starDigits_++;
+        return NONE;
+    }
+
+    void reset() { inSentence_ = false; }
+
+private:
+    static int hex(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    void start() {
+        inSentence_ = true;
+        length_ = 1;
+        sum_ = 0;
+        given_ = 0;
+        starDigits_ = -1;
+    }
+
+    bool inSentence_ = false;
+    uint8_t length_ = 0;
+    uint8_t sum_ = 0;
+    uint8_t given_ = 0;
+    int8_t starDigits_ = -1; // -1 before the '*'
+};
+
+// Single producer (UART callback) and single consumer (GPS task)
+template <size_t Capacity> class GpsFeed {
+public:
+    // Producer side. Bytes that do not fit are counted and dropped.
+    void receive(const uint8_t *data, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            if (!ring_.push(data[i])) {
+                overflowBytes_.fetch_add(len - i, std::memory_order_relaxed);
+                break;
+            }
+        }
+        bytes_.fetch_add(len, std::memory_order_relaxed);
+    }
+
+    // Consumer side: hands up to maxBytes to parser.encode(char), TinyGPSPlus style. Returns how
+    // many bytes were drained.
+    template <typename ParserT> size_t drain(ParserT &parser, size_t maxBytes) {
+        size_t n = 0;
+        uint8_t c;
+        while (n < maxBytes && ring_.pop(c)) {
+            parser.encode((char)c);
+            switch (framer_.feed((char)c)) {
+                case NmeaFramer::SENTENCE: sentences_++; break;
+                case NmeaFramer::BAD_CHECKSUM: badChecksum_++; break;
+                case NmeaFramer::TRUNCATED: truncated_++; break;
+                default: break;
+            }
+            n++;
+        }
+        return n;
+    }
+
+    // Only safe when neither side is running
+    void reset() {
+        ring_.reset();
+        framer_.reset();
+        bytes_.store(0, std::memory_order_relaxed);
+        overflowBytes_.store(0, std::memory_order_relaxed);
+        sentences_ = badChecksum_ = truncated_ = 0;
+    }
+
+    // Consumer side
+    GpsFeedStats stats() const {
+        GpsFeedStats s;
+        s.bytes = bytes_.load(std::memory_order_relaxed);
+        s.overflowBytes = overflowBytes_.load(std::memory_order_relaxed);
+        s.sentences = sentences_;
+        s.badChecksum = badChecksum_;
+        s.truncated = truncated_;
+        return s;
+    }
+
+    // Either side, the only counter the producer touches
+    uint32_t received() const { return bytes_.load(std::memory_order_relaxed); }
+    size_t pending() const { return ring_.size(); }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    SpscRing<uint8_t, Capacity> ring_;
+    NmeaFramer framer_;
+    std::atomic<uint32_t> bytes_{0};
+    std::atomic<uint32_t> overflowBytes_{0};
+    uint32_t sentences_ = 0;
+    uint32_t badChecksum_ = 0;
+    uint32_t truncated_ = 0;
+};
+
+#endif
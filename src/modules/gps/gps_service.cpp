@@ -0,0 +1,114 @@
+#include "gps_service.h"
+
+#define GPS_TASK_POLL_MS 100
+#define GPS_UART_RX_BUFFER 512
+
+GpsService::~GpsService() {
+    end();
+    if (mutex) vSemaphoreDelete(mutex);
+}
+
+bool GpsService::begin() {
+    end();
+    if (!mutex) mutex = xSemaphoreCreateMutex();
+    if (!mutex) return false;
+
+    feed.reset();
+    gps = TinyGPSPlus();
+    latest = GpsFix();
+    latestStats = GpsFeedStats();
+
+    stopTask = false;
+    taskRunning = true;
+    if (xTaskCreate(taskMain, "gps", 4096, this, 4, &task) != pdPASS) {
+        taskRunning = false;
+        task = nullptr;
+        return false;
+    }
+
+    serial.setRxBufferSize(GPS_UART_RX_BUFFER);
+    serial.onReceive([this]() { onReceive(); });
+    serial.begin(
+        bruceConfigPins.gpsBaudrate, SERIAL_8N1, bruceConfigPins.gps_bus.rx, bruceConfigPins.gps_bus.tx
+    );
+    return true;
+}
+
+void GpsService::end() {
+    if (!task) return;
+    serial.onReceive(nullptr);
+    serial.end();
+
+    stopTask = true;
+    while (taskRunning) {
+        xTaskNotifyGive(task);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    task = nullptr;
+}
+
+GpsFix GpsService::fix() {
+    if (!mutex) return GpsFix();
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    const GpsFix fix = latest;
+    xSemaphoreGive(mutex);
+    return fix;
+}
+
+GpsFeedStats GpsService::stats() {
+    if (!mutex) return GpsFeedStats();
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    const GpsFeedStats stats = latestStats;
+    xSemaphoreGive(mutex);
+    return stats;
+}
+
+// UART event task: empties the driver buffer into the ring right away, parsing waits for the GPS task
+void GpsService::onReceive() {
+    uint8_t buf[128];
+    size_t n;
+    while ((n = serial.available()) > 0) {
+        n = serial.read(buf, n < sizeof(buf) ? n : sizeof(buf));
+        if (n == 0) break;
+        feed.receive(buf, n);
+    }
+    if (task) xTaskNotifyGive(task);
+}
+
+void GpsService::taskMain(void *arg) {
+    GpsService &svc = *(GpsService *)arg;
+    while (!svc.stopTask) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GPS_TASK_POLL_MS));
+        svc.feed.drain(svc.gps, GpsService::RING_BYTES);
+        svc.publish();
+    }
+    svc.taskRunning = false;
+    vTaskDelete(nullptr);
+}
+
+void GpsService::publish() {
+    GpsFix fix = latest; // this task is the only writer
+    if (gps.location.isUpdated()) {
+        fix.lat = gps.location.lat();
+        fix.lng = gps.location.lng();
+        fix.fixMs = millis() - gps.location.age();
+        fix.seq++;
+    }
+    fix.valid = gps.location.isValid();
+    fix.altitudeM = gps.altitude.meters();
+    fix.hdop = gps.hdop.isValid() ? gps.hdop.hdop() : 0;
+    fix.satellites = gps.satellites.value();
+    fix.timeValid = gps.date.isValid() && gps.time.isValid();
+    fix.year = gps.date.year();
+    fix.month = gps.date.month();
+    fix.day = gps.date.day();
+    fix.hour = gps.time.hour();
+    fix.minute = gps.time.minute();
+    fix.second = gps.time.second();
+    const GpsFeedStats stats = feed.stats();
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    latest = fix;
+    latestStats = stats;
+    xSemaphoreGive(mutex);
+}
@@ -0,0 +1,43 @@
+#ifndef __GPS_SERVICE_H__
+#define __GPS_SERVICE_H__
+// Owns the GPS UART while a GPS app runs. Bytes go from the UART callback through a ring to a
+// task that keeps TinyGPSPlus fed (see gps_feed.h), and the latest fix is published as a snapshot,
+// so the apps read the position instead of pumping the parser between scans.
+#include "gps_feed.h"
+#include <TinyGPS++.h>
+#include <globals.h>
+
+class GpsService {
+public:
+    static const size_t RING_BYTES = 4096; // about 4s of NMEA at 9600 baud
+
+    GpsService() = default;
+    GpsService(const GpsService &) = delete;
+    GpsService &operator=(const GpsService &) = delete;
+    ~GpsService();
+
+    // Opens the UART on the configured pins and starts the task, false when the task cannot start
+    bool begin(void);
+    void end(void);
+
+    GpsFix fix(void);
+    GpsFeedStats stats(void);
+    uint32_t bytesReceived(void) const { return feed.received(); }
+
+private:
+    HardwareSerial serial = HardwareSerial(2); // Uses UART2 for GPS
+    TinyGPSPlus gps;                           // GPS task only
+    GpsFeed<RING_BYTES> feed;
+    TaskHandle_t task = nullptr;
+    SemaphoreHandle_t mutex = nullptr; // latest, latestStats
+    volatile bool stopTask = false;
+    volatile bool taskRunning = false;
+    GpsFix latest;
+    GpsFeedStats latestStats;
+
+    static void taskMain(void *arg);
+    void onReceive(void);
+    void publish(void);
+};
+
+#endif
@@ -40,13 +40,15 @@ void GPSTracker::setup() {
 
 bool GPSTracker::begin_gps() {
     releasePins();
-    GPSserial.begin(
-        bruceConfigPins.gpsBaudrate, SERIAL_8N1, bruceConfigPins.gps_bus.rx, bruceConfigPins.gps_bus.tx
-    );
+    if (!gpsService.begin()) {
+        restorePins();
+        displayError("Failed to start GPS task", true);
+        return false;
+    }
 
     int count = 0;
     padprintln("Waiting for GPS data");
-    while (GPSserial.available() <= 0) {
+    while (gpsService.bytesReceived() == 0) {
         if (check(EscPress)) {
             end();
             return false;
@@ -61,7 +63,7 @@ bool GPSTracker::begin_gps() {
 }
 
 void GPSTracker::end() {
-    GPSserial.end();
+    gpsService.end();
     restorePins();
 
     returnToMenu = true;
@@ -70,25 +72,29 @@ void GPSTracker::end() {
 
 void GPSTracker::loop() {
     int count = 0;
+    uint32_t lastReceived = 0;
     returnToMenu = false;
     while (1) {
         display_banner();
 
         if (check(EscPress) || returnToMenu) return end();
 
-        if (GPSserial.available() > 0) {
+        const uint32_t received = gpsService.bytesReceived();
+        if (received != lastReceived) {
+            lastReceived = received;
             count = 0;
-            while (GPSserial.available() > 0) gps.encode(GPSserial.read());
-
-            if (gps.location.isUpdated()) {
+            const GpsFix fix = gpsService.fix();
+            if (fix.valid && fix.seq != lastFixSeq) {
+                lastFixSeq = fix.seq;
                 padprintln("GPS location updated");
-                set_position();
-                add_coord();
+                set_position(fix);
+                add_coord(fix);
             } else {
                 padprintln("GPS location not updated");
                 dump_gps_data();
 
-                if (filename == "" && gps.date.year() >= CURRENT_YEAR && gps.date.year() < CURRENT_YEAR + 5)
+                if (filename == "" && fix.timeValid && fix.year >= CURRENT_YEAR &&
+                    fix.year < CURRENT_YEAR + 5)
                     create_filename();
             }
         } else {
@@ -101,21 +107,18 @@ void GPSTracker::loop() {
         }
 
         int tmp = millis();
-        while (millis() - tmp < MAX_WAIT && !gps.location.isUpdated()) {
+        while (millis() - tmp < MAX_WAIT && gpsService.fix().seq == lastFixSeq) {
             if (check(EscPress) || returnToMenu) return end();
         }
     }
 }
 
-void GPSTracker::set_position() {
-    double lat = gps.location.lat();
-    double lng = gps.location.lng();
-
-    if (initial_position_set) distance += gps.distanceBetween(cur_lat, cur_lng, lat, lng);
+void GPSTracker::set_position(const GpsFix &fix) {
+    if (initial_position_set) distance += TinyGPSPlus::distanceBetween(cur_lat, cur_lng, fix.lat, fix.lng);
     else initial_position_set = true;
 
-    cur_lat = lat;
-    cur_lng = lng;
+    cur_lat = fix.lat;
+    cur_lng = fix.lng;
 }
 
 void GPSTracker::display_banner() {
@@ -127,33 +130,44 @@ void GPSTracker::display_banner() {
         padprintln("GPS Coordinates: " + String(gpsCoordCount), 2);
         padprintf(2, "Distance: %.2fkm\n", distance / 1000);
     }
+    if (gpsConnected) {
+        const GpsFix fix = gpsService.fix();
+        const GpsFeedStats gps = gpsService.stats();
+        const unsigned long lost = gps.badChecksum + gps.truncated;
+        const unsigned long ovf = gps.overflowBytes; // whole sentences can vanish here unseen
+        const float age = fix.ageMs(millis()) / 1000.0f;
+        if (fix.valid) padprintf(2, "Fix: %.1fs HDOP: %.1f Lost: %lu Ovf: %lu\n", age, fix.hdop, lost, ovf);
+        else padprintf(2, "Fix: none  Lost: %lu  Ovf: %lu\n", lost, ovf);
+    }
 
     padprintln("");
 }
 
 void GPSTracker::dump_gps_data() {
-    if (!date_time_updated && (!gps.date.isUpdated() || !gps.time.isUpdated())) {
+    const GpsFix fix = gpsService.fix();
+    if (!date_time_updated && !fix.timeValid) {
         padprintln("Waiting for valid GPS data");
         return;
     }
     date_time_updated = true;
-    padprintf(2, "Date: %02d-%02d-%02d\n", gps.date.year(), gps.date.month(), gps.date.day());
-    padprintf(2, "Time: %02d:%02d:%02d\n", gps.time.hour(), gps.time.minute(), gps.time.second());
-    padprintf(2, "Sat:  %d\n", gps.satellites.value());
-    padprintf(2, "HDOP: %.2f\n", gps.hdop.hdop());
+    padprintf(2, "Date: %02d-%02d-%02d\n", fix.year, fix.month, fix.day);
+    padprintf(2, "Time: %02d:%02d:%02d\n", fix.hour, fix.minute, fix.second);
+    padprintf(2, "Sat:  %d\n", fix.satellites);
+    padprintf(2, "HDOP: %.2f\n", fix.hdop);
 }
 
 void GPSTracker::create_filename() {
+    const GpsFix fix = gpsService.fix();
     char timestamp[20];
     sprintf(
         timestamp,
         "%02d%02d%02d_%02d%02d%02d",
-        gps.date.year() % 100,
-        gps.date.month() % 100,
-        gps.date.day() % 100,
-        gps.time.hour() % 100,
-        gps.time.minute() % 100,
-        gps.time.second() % 100
+        fix.year % 100,
+        fix.month % 100,
+        fix.day % 100,
+        fix.hour % 100,
+        fix.minute % 100,
+        fix.second % 100
     );
     filename = String(timestamp) + "_gps_tracker.gpx";
 }
@@ -198,7 +212,7 @@ void GPSTracker::add_final_file_data() {
     file.close();
 }
 
-void GPSTracker::add_coord() {
+void GPSTracker::add_coord(const GpsFix &fix) {
     FS *fs;
     if (!getFsStorage(fs)) {
         padprintln("Storage setup error");
@@ -222,18 +236,18 @@ void GPSTracker::add_coord() {
 
     if (is_new_file) add_initial_file_data(file);
 
-    file.printf("      <trkpt lat=\"%f\" lon=\"%f\">\n", gps.location.lat(), gps.location.lng());
+    file.printf("      <trkpt lat=\"%f\" lon=\"%f\">\n", fix.lat, fix.lng);
     file.println("        <sym>Waypoint</sym>");
-    file.printf("        <ele>%f</ele>\n", gps.altitude.meters());
-    file.printf("        <hdop>%f</hdop>\n", gps.hdop.hdop());
-    file.printf("        <sat>%ld</sat>\n", gps.satellites.value());
+    file.printf("        <ele>%f</ele>\n", fix.altitudeM);
+    file.printf("        <hdop>%f</hdop>\n", fix.hdop);
+    file.printf("        <sat>%d</sat>\n", fix.satellites);
     file.println("      </trkpt>");
 
     gpsCoordCount++;
 
     file.close();
 
-    padprintf(2, "Coord: %.6f, %.6f\n", gps.location.lat(), gps.location.lng());
+    padprintf(2, "Coord: %.6f, %.6f\n", fix.lat, fix.lng);
 }
 
 void GPSTracker::releasePins() {
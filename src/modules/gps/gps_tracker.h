@@ -9,7 +9,7 @@
 #ifndef __GPS_TRACKER_H__
 #define __GPS_TRACKER_H__
 
-#include <TinyGPS++.h>
+#include "gps_service.h"
 #include <globals.h>
 
 class GPSTracker {
@@ -33,8 +33,8 @@ private:
     double cur_lng;
     double distance = 0;
     String filename = "";
-    TinyGPSPlus gps;
-    HardwareSerial GPSserial = HardwareSerial(2);
+    GpsService gpsService;
+    uint32_t lastFixSeq = 0;
     int gpsCoordCount = 0;
     bool rxPinReleased = false;
 
@@ -55,8 +55,8 @@ private:
     /////////////////////////////////////////////////////////////////////////////////////
     // Operations
     /////////////////////////////////////////////////////////////////////////////////////
-    void set_position(void);
-    void add_coord(void);
+    void set_position(const GpsFix &fix);
+    void add_coord(const GpsFix &fix);
     void add_initial_file_data(File file);
     void add_final_file_data(void);
     void create_filename(void);
@@ -13,9 +13,20 @@
 #include "core/wifi/wifi_common.h"
 #include "current_year.h"
 #include "modules/ble/ble_common.h"
+#include "wardriving_passive.h"
 #include <cctype>
+#include <esp_heap_caps.h>
+#include <new>
 
 #define MAX_WAIT 5000
+#define FIX_MAX_AGE_MS 10000
+#define HOP_SCHEDULE_FILE "/BruceWardriving/hop.txt"
+#define PASSIVE_DRAIN_BATCH 16
+#define PASSIVE_DRAIN_INTERVAL_MS 1000
+#define ACTIVE_SCAN_PAUSE_MS 200
+#define WRITER_POLL_MS 250
+#define WRITER_BUFFER_PSRAM (16 * 1024)
+#define WRITER_BUFFER_INTERNAL (4 * 1024)
 
 #if __has_include(<NimBLEExtAdvertising.h>)
 #define NIMBLE_V2_PLUS 1
@@ -40,14 +51,17 @@ static bool parseMacToU64(const String &mac, uint64_t &out) {
     out = value;
     return true;
 }
-Wardriving::Wardriving(bool scanWiFi, bool scanBLE) {
+Wardriving::Wardriving(bool scanWiFi, bool scanBLE, bool passiveWiFi) {
     this->scanWiFi = scanWiFi;
     this->scanBLE = scanBLE;
+    this->passiveWiFi = scanWiFi && passiveWiFi;
+    binaryLog = bruceConfig.wardriveBinaryLog;
     setup();
 }
 
 Wardriving::~Wardriving() {
     if (gpsConnected) end();
+    if (stateMutex) vSemaphoreDelete(stateMutex);
     ioExpander.turnPinOnOff(IO_EXP_GPS, LOW);
 #ifdef USE_BOOST /// ENABLE 5V OUTPUT
     PPM.disableOTG();
@@ -57,6 +71,7 @@ Wardriving::~Wardriving() {
 void Wardriving::setup() {
     wifiNetworkCount = 0;
     bluetoothDeviceCount = 0;
+    if (!stateMutex) stateMutex = xSemaphoreCreateMutex();
     ioExpander.turnPinOnOff(IO_EXP_GPS, HIGH);
 #ifdef USE_BOOST /// ENABLE 5V OUTPUT
     PPM.enableOTG();
@@ -65,6 +80,10 @@ void Wardriving::setup() {
     padprintln("Initializing...");
 
     loadAlertMACs();
+    if (!begin_dedup()) {
+        displayError("Not enough memory", true);
+        return;
+    }
     begin_wifi();
     if (!begin_gps()) return;
 
@@ -76,17 +95,61 @@ void Wardriving::setup() {
 void Wardriving::begin_wifi() {
     WiFi.mode(WIFI_STA);
     WiFi.disconnect();
+    if (!passiveWiFi) return;
+
+    loadHopSchedule();
+    passiveStarted = wardrive_passive_start(hopSchedule);
+    if (passiveStarted) {
+        padprintf("Passive: %u channels, %lums cycle\n", hopSchedule.count(), hopSchedule.cycleMs());
+    } else {
+        padprintln("Passive scan failed, using active scan");
+        passiveWiFi = false;
+    }
+}
+
+// Sized from the configured budget, halved until the allocation fits
+bool Wardriving::begin_dedup() {
+    relogWindowMs = bruceConfig.wardriveRelogMin * 60000UL;
+    for (size_t budget = bruceConfig.wardriveDedupKB * 1024UL; budget >= 4096; budget /= 2) {
+        if (registeredMACs.init(budget)) {
+            padprintf("Dedup: %u devices\n", (unsigned)registeredMACs.capacity());
+            return true;
+        }
+    }
+    return false;
+}
+
+// One "channel:dwellMs" / "first-last:dwellMs" list per line, # comments, see WardriveHopSchedule
+void Wardriving::loadHopSchedule() {
+    hopSchedule.setDefault();
+    FS *fs;
+    if (!getFsStorage(fs) || !(*fs).exists(HOP_SCHEDULE_FILE)) return;
+    File hopFile = (*fs).open(HOP_SCHEDULE_FILE, FILE_READ);
+    if (!hopFile) return;
+    String spec = "";
+    while (hopFile.available()) {
+        String line = hopFile.readStringUntil('\n');
+        line.trim();
+        if (line.length() == 0 || line.startsWith("#")) continue;
+        spec += line + ",";
+    }
+    hopFile.close();
+    if (spec.length() > 0 && !hopSchedule.parse(spec.c_str(), spec.length())) {
+        padprintln("Bad hop.txt, using default channels");
+    }
 }
 
 bool Wardriving::begin_gps() {
     releasePins();
-    GPSserial.begin(
-        bruceConfigPins.gpsBaudrate, SERIAL_8N1, bruceConfigPins.gps_bus.rx, bruceConfigPins.gps_bus.tx
-    );
+    if (!gpsService.begin()) {
+        restorePins();
+        displayError("Failed to start GPS task", true);
+        return false;
+    }
 
     int count = 0;
     padprintln("Waiting for GPS data");
-    while (GPSserial.available() <= 0) {
+    while (gpsService.bytesReceived() == 0) {
         if (check(EscPress)) {
             end();
             return false;
@@ -101,6 +164,12 @@ bool Wardriving::begin_gps() {
 }
 
 void Wardriving::end() {
+    if (tasksStarted) stopTasks();
+    if (passiveStarted) {
+        wardrive_passive_stop();
+        passiveStarted = false;
+    }
+    registeredMACs.release();
     if (scanWiFi) wifiDisconnect();
     if (scanBLE) {
 #if defined(CONFIG_IDF_TARGET_ESP32C5)
@@ -112,7 +181,7 @@ void Wardriving::end() {
         bleInitialized = false;
     }
 
-    GPSserial.end();
+    gpsService.end();
     restorePins();
     returnToMenu = true;
     gpsConnected = false;
@@ -120,32 +189,31 @@ void Wardriving::end() {
 
 void Wardriving::loop() {
     int count = 0;
+    uint32_t lastReceived = 0;
     returnToMenu = false;
     while (1) {
         display_banner();
 
-        if (GPSserial.available() > 0) {
+        const uint32_t received = gpsService.bytesReceived();
+        if (received != lastReceived) {
+            lastReceived = received;
             count = 0;
-            while (GPSserial.available() > 0) gps.encode(GPSserial.read());
-            String txt = "GPS Read: ";
-            // Debuging GPS messages
-            // while (GPSserial.available() > 0) {
-            //     char read = GPSserial.read();
-            //     txt += read;
-            //     gps.encode(read);
-            // }
-            // Serial.println(txt);
-            if (gps.location.isUpdated()) {
+            const GpsFix fix = gpsService.fix();
+            if (fix.valid && fix.seq != lastFixSeq) {
+                lastFixSeq = fix.seq;
                 padprintln("GPS location updated");
-                set_position();
-                scanWiFiBLE();
+                set_position(fix);
+                if (!tasksStarted && !startTasks()) return end();
             } else {
                 padprintln("GPS location not updated");
                 dump_gps_data();
 
-                if (filename == "" && gps.date.year() >= CURRENT_YEAR && gps.date.year() < CURRENT_YEAR + 5)
+                if (filename == "" && fix.timeValid && fix.year >= CURRENT_YEAR &&
+                    fix.year < CURRENT_YEAR + 5)
                     create_filename();
             }
+            // an invalid fix once the position went stale, the passive table stops stamping APs
+            if (passiveStarted) wardrive_passive_set_fix(fixSnapshot());
         } else {
             if (count > 5) {
                 displayError("GPS not Found!");
@@ -155,23 +223,22 @@ void Wardriving::loop() {
             count++;
         }
 
+        showPendingAlert();
+
         unsigned long tmp = millis();
-        while (millis() - tmp < MAX_WAIT && !gps.location.isUpdated()) {
+        while (millis() - tmp < MAX_WAIT && gpsService.fix().seq == lastFixSeq) {
             if (check(EscPress) || returnToMenu) return end();
             vTaskDelay(50 / portTICK_PERIOD_MS);
         }
     }
 }
 
-void Wardriving::set_position() {
-    double lat = gps.location.lat();
-    double lng = gps.location.lng();
-
-    if (initial_position_set) distance += gps.distanceBetween(cur_lat, cur_lng, lat, lng);
+void Wardriving::set_position(const GpsFix &fix) {
+    if (initial_position_set) distance += TinyGPSPlus::distanceBetween(cur_lat, cur_lng, fix.lat, fix.lng);
     else initial_position_set = true;
 
-    cur_lat = lat;
-    cur_lng = lng;
+    cur_lat = fix.lat;
+    cur_lng = fix.lng;
 }
 
 void Wardriving::display_banner() {
@@ -192,43 +259,94 @@ void Wardriving::display_banner() {
     uint32_t minutes = (elapsedSeconds / 60) % 60;
     uint32_t seconds = elapsedSeconds % 60;
     padprintf("Distance: %.2fkm  ET: %02lu:%02lu:%02lu\n", distance / 1000, hours, minutes, seconds);
+    if (gpsConnected) {
+        const GpsFix fix = gpsService.fix();
+        const GpsFeedStats gps = gpsService.stats();
+        const unsigned long lost = gps.badChecksum + gps.truncated;
+        const unsigned long ovf = gps.overflowBytes; // whole sentences can vanish here unseen
+        const float age = fix.ageMs(millis()) / 1000.0f;
+        if (fix.valid) padprintf("Fix: %.1fs HDOP: %.1f Lost: %lu Ovf: %lu\n", age, fix.hdop, lost, ovf);
+        else padprintf("Fix: none  Lost: %lu  Ovf: %lu\n", lost, ovf);
+    }
+    if (passiveStarted) {
+        WardrivePassiveStats stats = wardrive_passive_stats();
+        padprintf(
+            "Ch: %u  Heard: %lu  Table: %u/%u\n",
+            stats.channel,
+            stats.table.aps,
+            (unsigned)stats.size,
+            (unsigned)stats.capacity
+        );
+    }
+    if (tasksStarted) {
+        xSemaphoreTake(stateMutex, portMAX_DELAY);
+        const WardriveWriterStats stats = writerStats;
+        xSemaphoreGive(stateMutex);
+        const uint32_t now = millis();
+        if (now - rateMs >= 1000) {
+            rowsPerSecond = (stats.rows - rateRows) * 1000.0f / (now - rateMs);
+            rateRows = stats.rows;
+            rateMs = now;
+        }
+        const size_t depth = wifiRows->size() + bleRows->size();
+        padprintf(
+            "Rows: %.1f/s  Queue: %u/%u  Drop: %lu\n",
+            rowsPerSecond,
+            (unsigned)depth,
+            (unsigned)(wifiRows->capacity() + bleRows->capacity()),
+            rowsDropped
+        );
+        padprintf("Write: %.1fms  max %.1fms\n", stats.lastWriteUs / 1000.0f, stats.maxWriteUs / 1000.0f);
+        xSemaphoreTake(stateMutex, portMAX_DELAY);
+        const size_t known = registeredMACs.size();
+        const WardriveDedupStats dedup = registeredMACs.stats();
+        xSemaphoreGive(stateMutex);
+        padprintf(
+            "Known: %u/%u  Evict: %lu  Relog: %lu\n",
+            (unsigned)known,
+            (unsigned)registeredMACs.capacity(),
+            dedup.evicted,
+            dedup.relogged
+        );
+    }
     // Serial.printf("Wardrive Elapsed Time: %02lu:%02lu:%02lu\n", hours, minutes, seconds);
 }
 
 void Wardriving::dump_gps_data() {
-    if (!date_time_updated && (!gps.date.isUpdated() || !gps.time.isUpdated())) {
+    const GpsFix fix = gpsService.fix();
+    if (!date_time_updated && !fix.timeValid) {
         padprintln("Waiting for valid GPS data");
         return;
     }
     date_time_updated = true;
-    padprintf(2, "Date: %02d-%02d-%02d\n", gps.date.year(), gps.date.month(), gps.date.day());
-    padprintf(2, "Time: %02d:%02d:%02d\n", gps.time.hour(), gps.time.minute(), gps.time.second());
-    padprintf(2, "Sat:  %d\n", gps.satellites.value());
-    padprintf(2, "HDOP: %.2f\n", gps.hdop.hdop());
+    padprintf(2, "Date: %02d-%02d-%02d\n", fix.year, fix.month, fix.day);
+    padprintf(2, "Time: %02d:%02d:%02d\n", fix.hour, fix.minute, fix.second);
+    padprintf(2, "Sat:  %d\n", fix.satellites);
+    padprintf(2, "HDOP: %.2f\n", fix.hdop);
 }
 
-String Wardriving::auth_mode_to_string(wifi_auth_mode_t authMode) {
+uint8_t Wardriving::auth_mode_to_wardrive(wifi_auth_mode_t authMode) {
     switch (authMode) {
-        case WIFI_AUTH_OPEN: return "OPEN";
-        case WIFI_AUTH_WEP: return "WEP";
-        case WIFI_AUTH_WPA_PSK: return "WPA_PSK";
-        case WIFI_AUTH_WPA2_PSK: return "WPA2_PSK";
-        case WIFI_AUTH_WPA_WPA2_PSK: return "WPA_WPA2_PSK";
-        case WIFI_AUTH_WPA2_ENTERPRISE: return "WPA2_ENTERPRISE";
-        case WIFI_AUTH_WPA3_PSK: return "WPA3_PSK";
-        case WIFI_AUTH_WPA2_WPA3_PSK: return "WPA2_WPA3_PSK";
-        case WIFI_AUTH_WAPI_PSK: return "WAPI_PSK";
-        default: return "UNKNOWN";
+        case WIFI_AUTH_OPEN: return WARDRIVE_AUTH_OPEN;
+        case WIFI_AUTH_WEP: return WARDRIVE_AUTH_WEP;
+        case WIFI_AUTH_WPA_PSK: return WARDRIVE_AUTH_WPA_PSK;
+        case WIFI_AUTH_WPA2_PSK: return WARDRIVE_AUTH_WPA2_PSK;
+        case WIFI_AUTH_WPA_WPA2_PSK: return WARDRIVE_AUTH_WPA_WPA2_PSK;
+        case WIFI_AUTH_WPA2_ENTERPRISE: return WARDRIVE_AUTH_WPA2_ENTERPRISE;
+        case WIFI_AUTH_WPA3_PSK: return WARDRIVE_AUTH_WPA3_PSK;
+        case WIFI_AUTH_WPA2_WPA3_PSK: return WARDRIVE_AUTH_WPA2_WPA3_PSK;
+        case WIFI_AUTH_WAPI_PSK: return WARDRIVE_AUTH_WAPI_PSK;
+        default: return WARDRIVE_AUTH_UNKNOWN;
     }
 }
 
-void Wardriving::scanWiFiBLE() {
+// Opens the session log for appending, writing the WigleWifi or binary header when it is new
+File Wardriving::openLogFile() {
     FS *fs;
     if (!getFsStorage(fs)) {
         padprintln("Storage setup error");
         displayError("Storage setup error", true);
-        returnToMenu = true;
-        return;
+        return File();
     }
 
     if (filename == "") create_filename();
@@ -242,207 +360,376 @@ void Wardriving::scanWiFiBLE() {
     if (!file) {
         padprintln("Failed to open file for writing");
         displayError("Failed to open file for writing", true);
-        returnToMenu = true;
-        return;
+        return file;
     }
 
-    if (is_new_file) {
-        file.println(
-            "WigleWifi-1.6,appRelease=v" + String(BRUCE_VERSION) + ",model=M5Stack GPS Unit,release=v" +
-            String(BRUCE_VERSION) +
-            ",device=ESP32 M5Stack,display=SPI TFT,board=ESP32 M5Stack,brand=Bruce,star=Sol,body=4,subBody=1"
-        );
-        file.println(
-            "MAC,SSID,AuthMode,FirstSeen,Channel,Frequency,RSSI,CurrentLatitude,CurrentLongitude,"
-            "AltitudeMeters,AccuracyMeters,RCOIs,MfgrId,Type"
-        );
+    if (is_new_file && binaryLog) {
+        uint8_t header[WARDRIVE_BIN_HEADER_SIZE];
+        file.write(header, WardriveBinEncoder::header(header));
+    } else if (is_new_file) {
+        char header[320];
+        file.write((const uint8_t *)header, formatWigleHeader(header, sizeof(header), BRUCE_VERSION));
     }
+    // An appended binary log starts over with a reset record
+    binEncoder.restart();
+    return file;
+}
 
-    padprintf("Coord: %.6f, %.6f\n", gps.location.lat(), gps.location.lng());
-    padprintln("Start Scanning...");
+/////////////////////////////////////////////////////////////////////////////////////
+// Collector and writer tasks
+/////////////////////////////////////////////////////////////////////////////////////
 
-    if (scanBLE && pBLEScan != nullptr && pBLEScan->isScanning()) {
-        pBLEScan->stop();
-        vTaskDelay(50 / portTICK_PERIOD_MS);
+static uint32_t writerMicros() { return (uint32_t)micros(); }
+
+bool Wardriving::startTasks() {
+    if (filename == "") create_filename();
+    File file = openLogFile();
+    if (!file) return false;
+
+    wifiRows = new (std::nothrow) WardriveRowQueue();
+    bleRows = new (std::nothrow) WardriveRowQueue();
+    size_t bufferSize = WRITER_BUFFER_INTERNAL;
+    if (psramFound()) {
+        bufferSize = WRITER_BUFFER_PSRAM;
+        writerBuffer = (uint8_t *)heap_caps_malloc(bufferSize, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    }
+    if (!writerBuffer) {
+        bufferSize = WRITER_BUFFER_INTERNAL;
+        writerBuffer = (uint8_t *)heap_caps_malloc(bufferSize, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    }
+    // Without the name table every binary row carries its name, bigger but still valid
+    if (binaryLog) binEncoder.init();
+    if (!wifiRows || !bleRows || !writerBuffer) {
+        file.close();
+        stopTasks();
+        displayError("Not enough memory", true);
+        return false;
+    }
+    logWriter.setBuffer(writerBuffer, bufferSize);
+    logWriter.setClock(writerMicros);
+    logWriter.attach(file, file.size(), millis());
+    writerStats = WardriveWriterStats();
+    rowsDropped = 0;
+    rateRows = 0;
+    rateMs = millis();
+
+    if (scanBLE && !begin_ble()) {
+        stopTasks();
+        return false;
     }
 
-    int networksFound = scanWiFi ? scanWiFiNetworks() : 0;
-    int bleFound = 0;
-    if (networksFound > 0) {
-        for (int i = 0; i < networksFound; i++) {
-            String macAddress = WiFi.BSSIDstr(i);
-            uint64_t macKey = 0;
-            bool macKeyOk = parseMacToU64(macAddress, macKey);
-
-            // Check if MAC was already found in this session
-            enforceRegisteredMACLimit();
-            if (!macKeyOk || registeredMACs.find(macKey) == registeredMACs.end()) {
-
-                if (macKeyOk) registeredMACs.insert(macKey); // Adds MAC to cache
-                int32_t channel = WiFi.channel(i);
-
-                char buffer[512];
-                snprintf(
-                    buffer,
-                    sizeof(buffer),
-                    "%s,\"%s\",[%s],%04d-%02d-%02d %02d:%02d:%02d,%ld,%ld,%ld,%f,%f,%f,%f,,,WIFI\n",
-                    macAddress.c_str(),
-                    WiFi.SSID(i).c_str(),
-                    auth_mode_to_string(WiFi.encryptionType(i)).c_str(),
-                    gps.date.year(),
-                    gps.date.month(),
-                    gps.date.day(),
-                    gps.time.hour(),
-                    gps.time.minute(),
-                    gps.time.second(),
-                    channel,
-                    channel != 14 ? 2407 + (channel * 5) : 2484,
-                    WiFi.RSSI(i),
-                    gps.location.lat(),
-                    gps.location.lng(),
-                    gps.altitude.meters(),
-                    gps.hdop.hdop() * 1.0
-                );
-                file.print(buffer);
-
-                // Check for alert
-                checkForAlert(macAddress, "WiFi", WiFi.SSID(i));
-
-                wifiNetworkCount++;
-            }
+    stopCollectors = false;
+    stopWriter = false;
+    writerRunning = true;
+#if SOC_CPU_CORES_NUM > 1
+    BaseType_t res = xTaskCreatePinnedToCore(writerTaskMain, "wd_writer", 4096, this, 3, &writerTask, 1);
+#else
+    BaseType_t res = xTaskCreate(writerTaskMain, "wd_writer", 4096, this, 3, &writerTask);
+#endif
+    if (res != pdPASS) writerRunning = false;
+    if (res == pdPASS && scanWiFi) {
+        wifiRunning = true;
+        res = xTaskCreate(wifiTaskMain, "wd_wifi", 4096, this, 2, &wifiTask);
+        if (res != pdPASS) wifiRunning = false;
+    }
+    if (res == pdPASS && scanBLE) {
+        bleRunning = true;
+        res = xTaskCreate(bleTaskMain, "wd_ble", 8192, this, 2, &bleTask);
+        if (res != pdPASS) bleRunning = false;
+    }
+    tasksStarted = true;
+    if (res != pdPASS) {
+        stopTasks();
+        displayError("Failed to start scan tasks", true);
+        return false;
+    }
+    return true;
+}
 
-            if ((i & 0x1F) == 0) vTaskDelay(1);
-        }
+// Collectors stop first so their last rows still reach the writer, which then closes the file
+void Wardriving::stopTasks() {
+    stopCollectors = true;
+    if (bleRunning && pBLEScan != nullptr) pBLEScan->stop();
+    while (wifiRunning || bleRunning) {
+        if (wifiTask) xTaskNotifyGive(wifiTask);
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
-    // Free scan results from heap as soon as we finish consuming them
-    if (scanWiFi) {
-        WiFi.scanDelete();
-        vTaskDelay(120 / portTICK_PERIOD_MS);
+    wifiTask = nullptr;
+    bleTask = nullptr;
+
+    stopWriter = true;
+    while (writerRunning) {
+        if (writerTask) xTaskNotifyGive(writerTask);
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
+    writerTask = nullptr;
+    logWriter.close();
+
+    delete wifiRows;
+    wifiRows = nullptr;
+    delete bleRows;
+    bleRows = nullptr;
+    free(writerBuffer);
+    writerBuffer = nullptr;
+    binEncoder.release();
+    tasksStarted = false;
+}
 
-    if (scanBLE) {
-        if (!bleInitialized || pBLEScan == nullptr) {
-            if (!BLEDevice::init("")) {
-                Serial.println(" Failed to init BLE");
-                file.close();
-                vTaskDelay(500 / portTICK_PERIOD_MS);
-                return;
-            }
-            pBLEScan = BLEDevice::getScan();
-            pBLEScan->setActiveScan(true);
-            pBLEScan->setInterval(SCAN_INT);
-            pBLEScan->setWindow(SCAN_WINDOW);
-            bleInitialized = true;
+void Wardriving::wifiTaskMain(void *arg) {
+    Wardriving &wd = *(Wardriving *)arg;
+    while (!wd.stopCollectors) {
+        if (wd.passiveStarted) {
+            wd.collectPassiveWiFi(false);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PASSIVE_DRAIN_INTERVAL_MS));
+        } else if (wd.fixSnapshot().valid) {
+            wd.collectWiFi();
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ACTIVE_SCAN_PAUSE_MS));
+        } else {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(500));
         }
-        if (pBLEScan->isScanning()) {
-            pBLEScan->stop();
-            vTaskDelay(50 / portTICK_PERIOD_MS);
+    }
+    // APs still settling get their row now rather than never
+    if (wd.passiveStarted) wd.collectPassiveWiFi(true);
+    wd.wifiRunning = false;
+    vTaskDelete(nullptr);
+}
+
+void Wardriving::bleTaskMain(void *arg) {
+    Wardriving &wd = *(Wardriving *)arg;
+    while (!wd.stopCollectors) {
+        if (wd.fixSnapshot().valid) wd.collectBLE();
+        else vTaskDelay(pdMS_TO_TICKS(500));
+    }
+    wd.bleRunning = false;
+    vTaskDelete(nullptr);
+}
+
+void Wardriving::writerTaskMain(void *arg) {
+    Wardriving &wd = *(Wardriving *)arg;
+    WardriveSighting row;
+    while (true) {
+        // Read before draining: everything pushed before the stop request is still written
+        const bool stopping = wd.stopWriter;
+        while (wd.wifiRows->pop(row)) wd.writeRow(row);
+        while (wd.bleRows->pop(row)) wd.writeRow(row);
+        if (stopping) wd.logWriter.flush(millis());
+        else wd.logWriter.poll(millis());
+
+        xSemaphoreTake(wd.stateMutex, portMAX_DELAY);
+        wd.writerStats = wd.logWriter.stats();
+        xSemaphoreGive(wd.stateMutex);
+        if (stopping) break;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WRITER_POLL_MS));
+    }
+    wd.writerRunning = false;
+    vTaskDelete(nullptr);
+}
+
+// Formatting happens here, on the writer task, so the collectors only fill in a sighting
+void Wardriving::writeRow(const WardriveSighting &row) {
+    if (binaryLog) {
+        uint8_t record[WardriveBinEncoder::MAX_OUTPUT];
+        const size_t len = binEncoder.encode(row, record);
+        if (len > 0) logWriter.append((const char *)record, len);
+        return;
+    }
+    char text[WARDRIVE_ROW_MAX + 1];
+    const size_t len = formatWigleRow(text, sizeof(text), row);
+    if (len > 0) logWriter.append(text, len);
+}
+
+// A full queue is retried for a while before the row is dropped, so a slow card throttles the
+// collector instead of losing data right away
+bool Wardriving::queueRow(WardriveRowQueue &queue, const WardriveSighting &row) {
+    for (int attempt = 0; !queue.push(row); attempt++) {
+        if (attempt >= 50 || stopWriter) {
+            rowsDropped = rowsDropped + 1;
+            return false;
         }
+        if (writerTask) xTaskNotifyGive(writerTask);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (queue.size() >= queue.capacity() / 2 && writerTask) xTaskNotifyGive(writerTask);
+    return true;
+}
 
-        BLEScanResults foundDevices;
+// true when the MAC should get a row: not logged yet this session, evicted since, or past the
+// re-log window
+bool Wardriving::registerMAC(uint64_t macKey) {
+    xSemaphoreTake(stateMutex, portMAX_DELAY);
+    const bool log = registeredMACs.shouldLog(macKey, millis(), relogWindowMs);
+    xSemaphoreGive(stateMutex);
+    return log;
+}
 
-        foundDevices = pBLEScan->getResults(scanTime * 1000, false);
+// Latest position for the rows. A fix older than FIX_MAX_AGE_MS counts as none, so a lost GPS
+// pauses logging instead of stamping everything with the last known position.
+WardriveFix Wardriving::fixSnapshot() {
+    const GpsFix gps = gpsService.fix();
+    WardriveFix fix;
+    fix.valid = gps.valid && gps.ageMs(millis()) <= FIX_MAX_AGE_MS;
+    fix.lat = gps.lat;
+    fix.lng = gps.lng;
+    fix.altitudeM = gps.altitudeM;
+    fix.accuracyM = gps.hdop;
+    fix.year = gps.year;
+    fix.month = gps.month;
+    fix.day = gps.day;
+    fix.hour = gps.hour;
+    fix.minute = gps.minute;
+    fix.second = gps.second;
+    return fix;
+}
 
-        int count = foundDevices.getCount();
-        bleFound = count;
-        if (count == 0) {
-            pBLEScan->clearResults();
-            vTaskDelay(150 / portTICK_PERIOD_MS);
-            goto scan_summary;
+void Wardriving::collectWiFi() {
+    int networksFound = scanWiFiNetworks();
+    // The fix can go stale during the scan; without one nothing is logged or marked as seen
+    const WardriveFix fix = fixSnapshot();
+    if (!fix.valid) {
+        WiFi.scanDelete();
+        return;
+    }
+    for (int i = 0; i < networksFound && !stopCollectors; i++) {
+        WardriveSighting row;
+        row.mac = macKey(WiFi.BSSID(i));
+
+        // Check if MAC was already found in this session
+        if (registerMAC(row.mac)) {
+            const String ssid = WiFi.SSID(i);
+            row.type = WARDRIVE_DEVICE_WIFI;
+            row.auth = auth_mode_to_wardrive(WiFi.encryptionType(i));
+            row.channel = WiFi.channel(i);
+            row.rssi = WiFi.RSSI(i);
+            row.name.set(ssid.c_str(), ssid.length());
+            row.fix = fix;
+            queueRow(*wifiRows, row);
+
+            // Check for alert
+            checkForAlert(WiFi.BSSIDstr(i), "WiFi", ssid);
+
+            wifiNetworkCount = wifiNetworkCount + 1;
         }
 
-        // Bluetooth Rows
-        // [BD_ADDR],[Device Name],[Capabilities],[First timestamp seen],[Channel],[Frequency],
-        // [RSSI],[Latitude],[Longitude],[Altitude],[Accuracy],[RCOIs],[MfgrId],[Type]
-        // Example: 63:56:ac:c4:d4:30,,Misc [LE],2018-08-03 18:14:12,0,,
-        // -67,37.76090571,-122.44877987,104,49.3120002746582,,72,BLE
-
-        int deviceIndex = 0;
-        for (int i = 0; i < count; i++) {
-            const NimBLEAdvertisedDevice *device = foundDevices.getDevice(i);
-            if (!device) continue;
-
-            String address;
-            String name;
-            int rssi = 0;
-            uint16_t manufacturerId = 0;
-
-            try {
-                address = device->getAddress().toString().c_str();
-                name = device->getName().c_str();
-                rssi = device->getRSSI();
-
-                if (device->haveManufacturerData()) {
-                    std::string mfgData = device->getManufacturerData();
-                    if (!mfgData.empty() && mfgData.length() >= 2) {
-                        manufacturerId = (uint16_t(mfgData[1]) << 8) | uint16_t(mfgData[0]);
-                    }
-                }
-            } catch (...) { continue; }
-
-            // Check if MAC was already found in this session
-            enforceRegisteredMACLimit();
-            uint64_t macKey = 0;
-            bool macKeyOk = parseMacToU64(address, macKey);
-            if (!macKeyOk || registeredMACs.find(macKey) == registeredMACs.end()) {
-                if (macKeyOk) registeredMACs.insert(macKey); // Adds MAC to cache
-
-                char buffer[512];
-                char manufacturerIdStr[8] = "";
-                if (manufacturerId != 0) {
-                    snprintf(manufacturerIdStr, sizeof(manufacturerIdStr), "%04X", manufacturerId);
-                }
-                snprintf(
-                    buffer,
-                    sizeof(buffer),
-                    "%s,\"%s\",Misc [BLE],%04d-%02d-%02d %02d:%02d:%02d,0,,%d,%f,%f,%f,%f,,%s,BLE\n",
-                    address.c_str(),
-                    name.c_str(),
-                    gps.date.year(),
-                    gps.date.month(),
-                    gps.date.day(),
-                    gps.time.hour(),
-                    gps.time.minute(),
-                    gps.time.second(),
-                    rssi,
-                    gps.location.lat(),
-                    gps.location.lng(),
-                    gps.altitude.meters(),
-                    gps.hdop.hdop() * 1.0,
-                    manufacturerIdStr
-                );
-                file.print(buffer);
-
-                // Check for alert
-                checkForAlert(address, "BLE", name);
-
-                bluetoothDeviceCount++;
-            }
+        if ((i & 0x1F) == 0) vTaskDelay(1);
+    }
+    // Free scan results from heap as soon as we finish consuming them
+    WiFi.scanDelete();
+}
 
-            if ((deviceIndex++ & 0x1F) == 0) vTaskDelay(1);
+// Queues the rows of the APs the passive collector has settled
+void Wardriving::collectPassiveWiFi(bool force) {
+    static WardrivePassiveRow rows[PASSIVE_DRAIN_BATCH];
+    size_t n;
+    do {
+        n = wardrive_passive_drain(rows, PASSIVE_DRAIN_BATCH, force);
+        for (size_t i = 0; i < n; i++) {
+            // The passive table logs an AP once while it stays in range, the session set decides
+            // whether it is logged again when it comes back
+            if (!registerMAC(rows[i].bssid)) continue;
+            queueRow(*wifiRows, wardriveApSighting(rows[i].bssid, rows[i].ap));
+            wifiNetworkCount = wifiNetworkCount + 1;
+
+            uint8_t mac[6];
+            macFromKey(rows[i].bssid, mac);
+            char macStr[18];
+            snprintf(
+                macStr,
+                sizeof(macStr),
+                "%02X:%02X:%02X:%02X:%02X:%02X",
+                mac[0],
+                mac[1],
+                mac[2],
+                mac[3],
+                mac[4],
+                mac[5]
+            );
+            checkForAlert(macStr, "WiFi", rows[i].ap.ssid.text);
         }
+        vTaskDelay(1);
+    } while (n == PASSIVE_DRAIN_BATCH);
+}
 
-        pBLEScan->clearResults();
-        vTaskDelay(20 / portTICK_PERIOD_MS);
+bool Wardriving::begin_ble() {
+    if (bleInitialized && pBLEScan != nullptr) return true;
+    if (!BLEDevice::init("")) {
+        displayError("Failed to init BLE", true);
+        return false;
     }
+    pBLEScan = BLEDevice::getScan();
+    pBLEScan->setActiveScan(true);
+    pBLEScan->setInterval(SCAN_INT);
+    pBLEScan->setWindow(SCAN_WINDOW);
+    bleInitialized = true;
+    return true;
+}
 
-scan_summary:
-    if (scanWiFi || scanBLE) {
-        String summary = "Scan done.";
-        if (scanWiFi) summary += " WiFi: " + String(networksFound);
-        if (scanBLE) summary += " BLE: " + String(bleFound);
-        padprintln(summary);
+void Wardriving::collectBLE() {
+    if (pBLEScan->isScanning()) {
+        pBLEScan->stop();
+        vTaskDelay(50 / portTICK_PERIOD_MS);
     }
 
-    file.close();
-}
+    // Blocks this task only, WiFi keeps collecting meanwhile
+    BLEScanResults foundDevices = pBLEScan->getResults(scanTime * 1000, false);
+    const WardriveFix fix = fixSnapshot(); // as in collectWiFi, a stale fix logs nothing
 
-void Wardriving::enforceRegisteredMACLimit() {
-    if (registeredMACs.size() < MAX_REGISTERED_MACS) return;
+    int count = foundDevices.getCount();
+    if (count == 0 || !fix.valid) {
+        pBLEScan->clearResults();
+        vTaskDelay(150 / portTICK_PERIOD_MS);
+        return;
+    }
+
+    // Bluetooth Rows
+    // [BD_ADDR],[Device Name],[Capabilities],[First timestamp seen],[Channel],[Frequency],
+    // [RSSI],[Latitude],[Longitude],[Altitude],[Accuracy],[RCOIs],[MfgrId],[Type]
+    // Example: 63:56:ac:c4:d4:30,,Misc [LE],2018-08-03 18:14:12,0,,
+    // -67,37.76090571,-122.44877987,104,49.3120002746582,,72,BLE
+
+    int deviceIndex = 0;
+    for (int i = 0; i < count && !stopCollectors; i++) {
+        const NimBLEAdvertisedDevice *device = foundDevices.getDevice(i);
+        if (!device) continue;
+
+        String address;
+        String name;
+        int rssi = 0;
+        uint16_t manufacturerId = 0;
+
+        try {
+            address = device->getAddress().toString().c_str();
+            name = device->getName().c_str();
+            rssi = device->getRSSI();
+
+            if (device->haveManufacturerData()) {
+                std::string mfgData = device->getManufacturerData();
+                if (!mfgData.empty() && mfgData.length() >= 2) {
+                    manufacturerId = (uint16_t(mfgData[1]) << 8) | uint16_t(mfgData[0]);
+                }
+            }
+        } catch (...) { continue; }
+
+        // Check if MAC was already found in this session
+        WardriveSighting row;
+        if (parseMacToU64(address, row.mac) && registerMAC(row.mac)) {
+            row.type = WARDRIVE_DEVICE_BLE;
+            row.rssi = rssi;
+            row.mfgrId = manufacturerId;
+            row.name.set(name.c_str(), name.length());
+            row.fix = fix;
+            queueRow(*bleRows, row);
+
+            // Check for alert
+            checkForAlert(address, "BLE", name);
+
+            bluetoothDeviceCount = bluetoothDeviceCount + 1;
+        }
 
-    registeredMACs.clear();
-    macCacheClears++;
-    padprintln("MAC cache cleared to prevent heap overflow");
+        if ((deviceIndex++ & 0x1F) == 0) vTaskDelay(1);
+    }
+
+    pBLEScan->clearResults();
+    vTaskDelay(20 / portTICK_PERIOD_MS);
 }
 
 int Wardriving::scanWiFiNetworks() {
@@ -486,18 +773,19 @@ void Wardriving::loadAlertMACs() {
 }
 
 void Wardriving::create_filename() {
+    const GpsFix fix = gpsService.fix();
     char timestamp[20];
     sprintf(
         timestamp,
         "%02d%02d%02d_%02d%02d%02d",
-        gps.date.year() % 100,
-        gps.date.month() % 100,
-        gps.date.day() % 100,
-        gps.time.hour() % 100,
-        gps.time.minute() % 100,
-        gps.time.second() % 100
+        fix.year % 100,
+        fix.month % 100,
+        fix.day % 100,
+        fix.hour % 100,
+        fix.minute % 100,
+        fix.second % 100
     );
-    filename = String(timestamp) + "_wardriving.csv";
+    filename = String(timestamp) + (binaryLog ? "_wardriving.bwd" : "_wardriving.csv");
 }
 
 void Wardriving::releasePins() {
@@ -525,13 +813,25 @@ void Wardriving::checkForAlert(const String &macAddress, const String &deviceTyp
         if (deviceName.length() > 0) { alertMsg += " Name: " + deviceName; }
         alertMsg += " MAC: " + macAddress;
 
-        foundMACAddressCount++;
+        // Called from the collector tasks, the UI loop shows it
+        xSemaphoreTake(stateMutex, portMAX_DELAY);
+        foundMACAddressCount = foundMACAddressCount + 1;
+        pendingAlert = alertMsg;
+        xSemaphoreGive(stateMutex);
+    }
+}
+
+void Wardriving::showPendingAlert() {
+    xSemaphoreTake(stateMutex, portMAX_DELAY);
+    String alertMsg = pendingAlert;
+    pendingAlert = "";
+    xSemaphoreGive(stateMutex);
+    if (alertMsg.length() == 0) return;
 
-        displayError(alertMsg.c_str());
+    displayError(alertMsg.c_str());
 
-        // Brief delay to make alert visible
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-    }
+    // Brief delay to make alert visible
+    vTaskDelay(2000 / portTICK_PERIOD_MS);
 }
 
 void Wardriving::restorePins() {
@@ -9,8 +9,12 @@
 #ifndef __WAR_DRIVING_H__
 #define __WAR_DRIVING_H__
 
+#include "gps_service.h"
 #include "modules/ble/ble_common.h"
-#include <TinyGPS++.h>
+#include "wardriving_ap_table.h"
+#include "wardriving_binlog.h"
+#include "wardriving_dedup.h"
+#include "wardriving_writer.h"
 #include <cstdint>
 #include <esp_wifi_types.h>
 #include <globals.h>
@@ -21,7 +25,7 @@ public:
     /////////////////////////////////////////////////////////////////////////////////////
     // Constructor
     /////////////////////////////////////////////////////////////////////////////////////
-    Wardriving(bool scanWiFi = false, bool scanBLE = false);
+    Wardriving(bool scanWiFi = false, bool scanBLE = false, bool passiveWiFi = false);
     ~Wardriving();
 
     /////////////////////////////////////////////////////////////////////////////////////
@@ -38,25 +42,54 @@ private:
     double distance = 0;
     uint32_t sessionStartMs = 0;
     String filename = "";
-    TinyGPSPlus gps;
-    HardwareSerial GPSserial = HardwareSerial(2); // Uses UART2 for GPS
-    std::set<uint64_t> registeredMACs;            // Store and track registered MAC (packed 48-bit)
+    GpsService gpsService;                        // UART, NMEA parsing and the latest fix
+    uint32_t lastFixSeq = 0;                      // GpsFix::seq the UI loop last handled
+    WardriveDedup registeredMACs;                 // MACs logged this session, least recent evicted
+    uint32_t relogWindowMs = 0;                   // Re-log a device heard again after this, 0 = never
     std::set<String> alertMACs;                   // Store alert MAC addresses from file
     bool scanWiFi = false;                        // Flag to scan WiFi networks
     bool scanBLE = false;                         // Flag to scan Bluetooth devices
+    bool passiveWiFi = false;                     // Channel hopping sniffer instead of scanNetworks
+    bool passiveStarted = false;                  // Passive collector running
+    WardriveHopSchedule hopSchedule;              // Dwell per channel for the passive mode
     bool bleInitialized = false;                  // BLE init guard for wardriving
-    int wifiNetworkCount = 0;                     // Counter fo wifi networks
-    int bluetoothDeviceCount = 0;                 // Counter for bluetooth devices
-    int foundMACAddressCount = 0;                 // Counter for found MAC addresses
-    uint32_t macCacheClears = 0;                  // Number of times MAC cache was cleared
-    static constexpr size_t MAX_REGISTERED_MACS = 250;
+    volatile int wifiNetworkCount = 0;            // Counter fo wifi networks
+    volatile int bluetoothDeviceCount = 0;        // Counter for bluetooth devices
+    volatile int foundMACAddressCount = 0;        // Counter for found MAC addresses
+    bool binaryLog = false;                       // Write a .bwd log, see wardriving_binlog.h
 
     bool rxPinReleased = false;
 
+    // Collector and writer tasks. WiFi and BLE collect concurrently, each queues WardriveSighting
+    // records in its own queue; one writer task formats them (CSV or binary) and owns the log file.
+    bool tasksStarted = false;
+    TaskHandle_t wifiTask = nullptr;
+    TaskHandle_t bleTask = nullptr;
+    TaskHandle_t writerTask = nullptr;
+    volatile bool stopCollectors = false;
+    volatile bool stopWriter = false;
+    volatile bool wifiRunning = false;
+    volatile bool bleRunning = false;
+    volatile bool writerRunning = false;
+    SemaphoreHandle_t stateMutex = nullptr; // registeredMACs, pendingAlert, writerStats
+    String pendingAlert = "";               // Shown by the UI loop, collectors do not draw
+    WardriveRowQueue *wifiRows = nullptr;
+    WardriveRowQueue *bleRows = nullptr;
+    uint8_t *writerBuffer = nullptr;
+    WardriveLogWriter<File> logWriter;
+    WardriveBinEncoder binEncoder;          // Writer task only
+    WardriveWriterStats writerStats;        // Published by the writer task
+    volatile uint32_t rowsDropped = 0;
+    uint32_t rateRows = 0;
+    uint32_t rateMs = 0;
+    float rowsPerSecond = 0;
+
     /////////////////////////////////////////////////////////////////////////////////////
     // Setup
     /////////////////////////////////////////////////////////////////////////////////////
     void begin_wifi(void);
+    bool begin_ble(void);
+    void loadHopSchedule(void);
     bool begin_gps(void);
     void end(void);
     void releasePins(void);
@@ -71,13 +104,26 @@ private:
     /////////////////////////////////////////////////////////////////////////////////////
     // Operations
     /////////////////////////////////////////////////////////////////////////////////////
-    void set_position(void);
-    void scanWiFiBLE(void);
+    void set_position(const GpsFix &fix);
+    bool startTasks(void);
+    void stopTasks(void);
+    static void wifiTaskMain(void *arg);
+    static void bleTaskMain(void *arg);
+    static void writerTaskMain(void *arg);
+    void collectWiFi(void);
+    void collectPassiveWiFi(bool force);
+    void collectBLE(void);
+    bool queueRow(WardriveRowQueue &queue, const WardriveSighting &row);
+    void writeRow(const WardriveSighting &row);
+    bool registerMAC(uint64_t macKey);
     int scanWiFiNetworks(void);
-    void enforceRegisteredMACLimit(void);
+    WardriveFix fixSnapshot(void);
+    File openLogFile(void);
+    void showPendingAlert(void);
+    bool begin_dedup(void);
     void loadAlertMACs(void);
     void checkForAlert(const String &macAddress, const String &deviceType, const String &deviceName = "");
-    String auth_mode_to_string(wifi_auth_mode_t authMode);
+    uint8_t auth_mode_to_wardrive(wifi_auth_mode_t authMode);
     void create_filename(void);
 };
 
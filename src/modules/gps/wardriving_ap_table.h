@@ -0,0 +1,316 @@
+#ifndef __WARDRIVING_AP_TABLE_H__
+#define __WARDRIVING_AP_TABLE_H__
+// Passive wardriving state: the access points harvested from beacons and probe responses,
+// deduplicated by BSSID, and the channel hop schedule driving the radio.
+// Frames are parsed without the table lock (parseWardriveBeacon), only the short merge into the
+// table needs it. Plain C++ so it can be fed from a recorded pcap and a synthetic GPS track.
+#include "modules/wifi/frame_parser.h"
+#include "modules/wifi/mac_table.h"
+#include <stdio.h>
+
+// Same labels the active scan writes, so files from both modes read alike
+enum WardriveAuth : uint8_t {
+    WARDRIVE_AUTH_OPEN,
+    WARDRIVE_AUTH_WEP,
+    WARDRIVE_AUTH_WPA_PSK,
+    WARDRIVE_AUTH_WPA2_PSK,
+    WARDRIVE_AUTH_WPA_WPA2_PSK,
+    WARDRIVE_AUTH_WPA2_ENTERPRISE,
+    WARDRIVE_AUTH_WPA3_PSK,
+    WARDRIVE_AUTH_WPA2_WPA3_PSK,
+    WARDRIVE_AUTH_OWE,
+    WARDRIVE_AUTH_WAPI_PSK,
+    WARDRIVE_AUTH_UNKNOWN,
+};
+
+inline const char *wardriveAuthName(uint8_t auth) {
+    switch (auth) {
+        case WARDRIVE_AUTH_OPEN: return "OPEN";
+        case WARDRIVE_AUTH_WEP: return "WEP";
+        case WARDRIVE_AUTH_WPA_PSK: return "WPA_PSK";
+        case WARDRIVE_AUTH_WPA2_PSK: return "WPA2_PSK";
+        case WARDRIVE_AUTH_WPA_WPA2_PSK: return "WPA_WPA2_PSK";
+        case WARDRIVE_AUTH_WPA2_ENTERPRISE: return "WPA2_ENTERPRISE";
+        case WARDRIVE_AUTH_WPA3_PSK: return "WPA3_PSK";
+        case WARDRIVE_AUTH_WPA2_WPA3_PSK: return "WPA2_WPA3_PSK";
+        case WARDRIVE_AUTH_OWE: return "OWE";
+        case WARDRIVE_AUTH_WAPI_PSK: return "WAPI_PSK";
+        default: return "UNKNOWN";
+    }
+}
+
+struct WardriveFix {
+    double lat = 0;
+    double lng = 0;
+    float altitudeM = 0;
+    float accuracyM = 0; // HDOP, as the active scan writes it
+    uint16_t year = 0;
+    uint8_t month = 0;
+    uint8_t day = 0;
+    uint8_t hour = 0;
+    uint8_t minute = 0;
+    uint8_t second = 0;
+    bool valid = false;
+};
+
+// What one beacon or probe response says about its BSS
+struct WardriveBeacon {
+    uint64_t bssid = 0;
+    FixedSsid ssid; // empty for a hidden network
+    uint8_t auth = WARDRIVE_AUTH_UNKNOWN;
+    uint8_t channel = 0; // DS parameter set, else the channel the frame was heard on
+    int8_t rssi = 0;
+    bool probeResponse = false;
+};
+
+struct WardriveAp {
+    FixedSsid ssid;
+    uint8_t auth = WARDRIVE_AUTH_UNKNOWN;
+    uint8_t channel = 0;
+    int8_t bestRssi = -128;
+    bool logged = false; // row written, only updated in place from now on
+    uint32_t firstSeenMs = 0;
+    uint32_t lastSeenMs = 0;
+    WardriveFix first; // first valid fix the BSS was heard at
+    WardriveFix last;
+};
+
+// Security from the capability privacy bit and the RSN / WPA IEs
+inline uint8_t wardriveParseAuth(bool privacy, const uint8_t *rsn, uint8_t rsnLen, bool wpaIe) {
+    if (!rsn) {
+        if (wpaIe) return WARDRIVE_AUTH_WPA_PSK;
+        return privacy ? WARDRIVE_AUTH_WEP : WARDRIVE_AUTH_OPEN;
+    }
+    // version(2) group(4) pairwise count(2) + n*4, AKM count(2) + m*4
+    bool psk = false, sae = false, dot1x = false, owe = false;
+    if (rsnLen >= 8) {
+        const uint16_t pairwise = rsn[6] | (rsn[7] << 8);
+        uint16_t pos = 8 + pairwise * 4;
+        if (pos + 2 <= rsnLen) {
+            const uint16_t akms = rsn[pos] | (rsn[pos + 1] << 8);
+            pos += 2;
+            for (uint16_t i = 0; i < akms && pos + 4 <= rsnLen; ++i, pos += 4) {
+                if (rsn[pos] != 0x00 || rsn[pos + 1] != 0x0F || rsn[pos + 2] != 0xAC) continue;
+                switch (rsn[pos + 3]) {
+                    case 1:
+                    case 5: dot1x = true; break;
+                    case 2:
+                    case 6: psk = true; break;
+                    case 8:
+                    case 9: sae = true; break;
+                    case 18: owe = true; break;
+                    default: break;
+                }
+            }
+        }
+    }
+    if (sae) return psk ? WARDRIVE_AUTH_WPA2_WPA3_PSK : WARDRIVE_AUTH_WPA3_PSK;
+    if (dot1x) return WARDRIVE_AUTH_WPA2_ENTERPRISE;
+    if (owe) return WARDRIVE_AUTH_OWE;
+    if (psk) return wpaIe ? WARDRIVE_AUTH_WPA_WPA2_PSK : WARDRIVE_AUTH_WPA2_PSK;
+    return WARDRIVE_AUTH_UNKNOWN;
+}
+
+// false for anything but a well-formed beacon or probe response
+inline bool parseWardriveBeacon(const WifiFrameDesc &frame, WardriveBeacon &out) {
+    if (!frame.is(WIFI_FRAME_BEACON | WIFI_FRAME_PROBE_RESP) || !frame.bssid) return false;
+    const uint16_t tags = wifiMgmtTagOffset(frame.subtype);
+    if (frame.len < tags) return false;
+    out = WardriveBeacon();
+    out.bssid = macKey(frame.bssid);
+    out.rssi = frame.rssi;
+    out.channel = frame.channel;
+    out.probeResponse = frame.is(WIFI_FRAME_PROBE_RESP);
+
+    // Hidden networks beacon an empty or NUL-filled SSID
+    if (frame.ssidOffset && frame.ssidLen && frame.frame[frame.ssidOffset] != 0) {
+        out.ssid.set((const char *)frame.frame + frame.ssidOffset, frame.ssidLen);
+    }
+
+    const uint8_t *f = frame.frame;
+    const bool privacy = f[24 + 10] & 0x10; // capability information
+    const uint8_t *rsn = nullptr;
+    uint8_t rsnLen = 0;
+    bool wpaIe = false;
+    for (uint16_t pos = tags; pos + 2 <= frame.len;) {
+        const uint8_t tag = f[pos];
+        const uint8_t len = f[pos + 1];
+        if (pos + 2 + len > frame.len) break;
+        const uint8_t *value = f + pos + 2;
+        if (tag == 3 && len >= 1) out.channel = value[0];
+        else if (tag == 48) {
+            rsn = value;
+            rsnLen = len;
+        } else if (tag == 221 && len >= 4 && value[0] == 0x00 && value[1] == 0x50 && value[2] == 0xF2 &&
+                   value[3] == 0x01) {
+            wpaIe = true;
+        }
+        pos += 2 + len;
+    }
+    out.auth = wardriveParseAuth(privacy, rsn, rsnLen, wpaIe);
+    return true;
+}
+
+struct WardriveTableStats {
+    uint32_t frames = 0;    // beacons and probe responses merged
+    uint32_t aps = 0;       // distinct BSSIDs added
+    uint32_t revealed = 0;  // hidden SSIDs named by a probe response
+    uint32_t dropped = 0;   // new BSSIDs refused because the table was full
+    uint32_t unlocated = 0; // pruned before any fix came in, no row was written for them
+};
+
+class WardriveApTable {
+public:
+    bool init(size_t slots) { return table_.init(slots); }
+    void release() { table_.release(); }
+    void clear() {
+        table_.clear();
+        stats_ = WardriveTableStats();
+    }
+
+    // Position stamped on every AP merged from now on
+    void setFix(const WardriveFix &fix) { fix_ = fix; }
+    const WardriveFix &fix() const { return fix_; }
+
+    // Merges one parsed frame, true when the BSSID is new
+    bool merge(const WardriveBeacon &beacon, uint32_t nowMs) {
+        bool created = false;
+        WardriveAp *ap = table_.insert(beacon.bssid, &created);
+        if (!ap) {
+            stats_.dropped++;
+            return false;
+        }
+        stats_.frames++;
+        if (created) {
+            stats_.aps++;
+            ap->firstSeenMs = nowMs;
+        }
+        if (!beacon.ssid.empty() && ap->ssid.empty()) {
+            if (!created) stats_.revealed++;
+            ap->ssid = beacon.ssid;
+        }
+        // A probe response does not carry everything a beacon does, keep what beacons said
+        if (created || !beacon.probeResponse) {
+            ap->auth = beacon.auth;
+            ap->channel = beacon.channel;
+        }
+        if (beacon.rssi > ap->bestRssi) ap->bestRssi = beacon.rssi;
+        ap->lastSeenMs = nowMs;
+        if (fix_.valid) {
+            if (!ap->first.valid) ap->first = fix_;
+            ap->last = fix_;
+        }
+        return created;
+    }
+
+    // Hands each AP that is ready for its row to fn(bssid, ap) and marks it logged, at most max.
+    // Ready means located and heard for settleMs, so the best RSSI had time to come in; force
+    // takes every located AP. Returns how many were handed out.
+    template <typename Fn> size_t drain(uint32_t nowMs, uint32_t settleMs, bool force, size_t max, Fn fn) {
+        size_t n = 0;
+        for (auto entry : table_) {
+            if (n >= max) break;
+            const WardriveAp &ap = entry.value();
+            if (ap.logged || !ap.first.valid) continue;
+            if (!force && nowMs - ap.firstSeenMs < settleMs) continue;
+            fn(entry.key(), ap);
+            table_.find(entry.key())->logged = true;
+            n++;
+        }
+        return n;
+    }
+
+    // Forgets APs not heard for maxIdleMs, which is what keeps a long drive within the table.
+    // A logged one coming back is logged again at its new position. Call it after a drain() that
+    // had room: an AP still unlogged by then never had a fix, it is counted as unlocated.
+    size_t prune(uint32_t nowMs, uint32_t maxIdleMs) {
+        return table_.eraseIf([&](uint64_t, const WardriveAp &ap) {
+            if (nowMs - ap.lastSeenMs <= maxIdleMs) return false;
+            if (!ap.logged) stats_.unlocated++;
+            return true;
+        });
+    }
+
+    size_t size() const { return table_.size(); }
+    size_t capacity() const { return table_.capacity(); }
+    const WardriveTableStats &stats() const { return stats_; }
+    const WardriveAp *find(uint64_t bssid) const { return table_.find(bssid); }
+
+private:
+    MacTable<WardriveAp> table_;
+    WardriveFix fix_;
+    WardriveTableStats stats_;
+};
+
+// Channel hop schedule, one dwell time per channel. The text form is a comma list of
+// "channel:dwellMs" or "first-last:dwellMs", e.g. "1:250,6:250,11:250,2-5:100".
+struct WardriveHopStep {
+    uint8_t channel;
+    uint16_t dwellMs;
+};
+
+class WardriveHopSchedule {
+public:
+    static const uint8_t MAX_STEPS = 32;
+    static const uint16_t MIN_DWELL_MS = 20;
+
+    // Longer on the usual 1/6/11, the rest of the 2.4 GHz band still gets visited
+    void setDefault() { parse(DEFAULT_SPEC, strlen(DEFAULT_SPEC)); }
+
+    // false (schedule untouched) on a malformed spec or one without steps
+    bool parse(const char *text, size_t len) {
+        WardriveHopStep steps[MAX_STEPS];
+        uint8_t count = 0;
+        size_t i = 0;
+        while (i < len) {
+            while (i < len && (text[i] == ' ' || text[i] == ',' || text[i] == '\r' || text[i] == '\n')) i++;
+            if (i == len) break;
+            uint32_t first, last, dwell;
+            if (!number(text, len, i, first)) return false;
+            last = first;
+            if (i < len && text[i] == '-') {
+                i++;
+                if (!number(text, len, i, last)) return false;
+            }
+            if (i >= len || text[i] != ':') return false;
+            i++;
+            if (!number(text, len, i, dwell)) return false;
+            if (first == 0 || last < first || last > 196 || dwell < MIN_DWELL_MS || dwell > 60000) {
+                return false;
+            }
+            for (uint32_t ch = first; ch <= last; ++ch) {
+                if (count >= MAX_STEPS) return false;
+                steps[count++] = {(uint8_t)ch, (uint16_t)dwell};
+            }
+        }
+        if (count == 0) return false;
+        memcpy(steps_, steps, sizeof(WardriveHopStep) * count);
+        count_ = count;
+        return true;
+    }
+
+    uint8_t count() const { return count_; }
+    const WardriveHopStep &step(uint8_t i) const { return steps_[i]; }
+    uint32_t cycleMs() const {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < count_; ++i) total += steps_[i].dwellMs;
+        return total;
+    }
+
+private:
+    static constexpr const char *DEFAULT_SPEC = "1:250,6:250,11:250,2-5:100,7-10:100,12-13:100";
+
+    static bool number(const char *text, size_t len, size_t &i, uint32_t &out) {
+        const size_t start = i;
+        out = 0;
+        while (i < len && text[i] >= '0' && text[i] <= '9' && i - start < 6) {
+            out = out * 10 + (text[i++] - '0');
+        }
+        return i > start;
+    }
+
+    WardriveHopStep steps_[MAX_STEPS];
+    uint8_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,477 @@
+#ifndef __WARDRIVING_BINLOG_H__
+#define __WARDRIVING_BINLOG_H__
+// Compact wardriving log, around 15 bytes a row against 110+ for the CSV it exports to. After an 8 byte
+// file header ("BWDL", version, 3 reserved) come tagged little-endian records:
+//   'S' A5 'B' 'W' 'D' 'L' 5A C3          session sync, also a reset
+//   'Z'                                   reset: forget names and the current fix
+//   'N' len:u8 text[len]                  name, gets the next id (0, 1, ...) until a reset
+//   'K' time:u32 lat:i32 lng:i32 alt:i32 acc:u16   absolute fix
+//   'D' dt:u8 dlat:i16 dlng:i16 dalt:i16 acc:u16   fix relative to the current one
+//   'W' mac[6] name:u16 auth:u8 channel:u8 rssi:i8  WiFi device at the current fix
+//   'B' mac[6] name:u16 rssi:i8 mfgr:u16            BLE device at the current fix
+// time is seconds since 2000-01-01, coordinates are 1e-7 degrees, altitude centimetres,
+// accuracy (HDOP) hundredths; name 0xFFFF means none. Every writer session starts with a sync
+// record, so a file reopened for appending decodes without the state of the previous session. A
+// record cut short by a power loss only loses that record: the reader skips to the sync record
+// that follows, whether it starts inside the cut record or after bytes that do not decode.
+#include "wardriving_log.h"
+#include <math.h>
+
+const uint8_t WARDRIVE_BIN_MAGIC[4] = {'B', 'W', 'D', 'L'};
+const uint8_t WARDRIVE_BIN_VERSION = 1;
+const size_t WARDRIVE_BIN_HEADER_SIZE = 8;
+const uint8_t WARDRIVE_BIN_SYNC[8] = {'S', 0xA5, 'B', 'W', 'D', 'L', 0x5A, 0xC3};
+
+enum WardriveBinTag : uint8_t {
+    WARDRIVE_BIN_SESSION = 'S',
+    WARDRIVE_BIN_RESET = 'Z',
+    WARDRIVE_BIN_NAME = 'N',
+    WARDRIVE_BIN_KEY_FIX = 'K',
+    WARDRIVE_BIN_DELTA_FIX = 'D',
+    WARDRIVE_BIN_WIFI = 'W',
+    WARDRIVE_BIN_BLE = 'B',
+};
+
+// A fix as stored, comparisons and deltas work on these units
+struct WardriveBinFix {
+    uint32_t time = 0;
+    int32_t lat = 0;
+    int32_t lng = 0;
+    int32_t altCm = 0;
+    uint16_t accuracy = 0;
+
+    bool operator==(const WardriveBinFix &o) const {
+        return time == o.time && lat == o.lat && lng == o.lng && altCm == o.altCm && accuracy == o.accuracy;
+    }
+    bool operator!=(const WardriveBinFix &o) const { return !(*this == o); }
+};
+
+// Days since 2000-01-01 of a civil date (proleptic Gregorian)
+inline int32_t wardriveDaysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 730425;
+}
+
+inline WardriveBinFix wardriveBinFix(const WardriveFix &fix) {
+    WardriveBinFix q;
+    if (fix.year >= 2000 && fix.month >= 1 && fix.month <= 12 && fix.day >= 1) {
+        const int32_t days = wardriveDaysFromCivil(fix.year, fix.month, fix.day);
+        q.time = (uint32_t)days * 86400u + fix.hour * 3600u + fix.minute * 60u + fix.second;
+    }
+    q.lat = (int32_t)lround(fix.lat * 1e7);
+    q.lng = (int32_t)lround(fix.lng * 1e7);
+    q.altCm = (int32_t)lround((double)fix.altitudeM * 100);
+    const long acc = lround((double)fix.accuracyM * 100);
+    q.accuracy = acc < 0 ? 0 : acc > 0xFFFF ? 0xFFFF : (uint16_t)acc;
+    return q;
+}
+
+inline WardriveFix wardriveFixFromBin(const WardriveBinFix &q) {
+    WardriveFix fix;
+    fix.lat = q.lat / 1e7;
+    fix.lng = q.lng / 1e7;
+    fix.altitudeM = q.altCm / 100.0f;
+    fix.accuracyM = q.accuracy / 100.0f;
+    fix.valid = true;
+    if (q.time == 0) return fix;
+    // civil from days, the inverse of wardriveDaysFromCivil
+    const int32_t z = (int32_t)(q.time / 86400) + 730425;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    fix.year = (uint16_t)((int)yoe + era * 400 + (m <= 2));
+    fix.month = m;
+    fix.day = doy - (153 * mp + 2) / 5 + 1;
+    const uint32_t secs = q.time % 86400;
+    fix.hour = secs / 3600;
+    fix.minute = secs / 60 % 60;
+    fix.second = secs % 60;
+    return fix;
+}
+
+class WardriveBinEncoder {
+public:
+    static const size_t MAX_NAMES = 512;
+    // Most bytes one encode() call produces: sync, name, key fix and the row
+    static const size_t MAX_OUTPUT = sizeof(WARDRIVE_BIN_SYNC) + 2 + FixedSsid::MAX_LEN + 19 + 12;
+
+    static size_t header(uint8_t *out) {
+        memcpy(out, WARDRIVE_BIN_MAGIC, 4);
+        out[4] = WARDRIVE_BIN_VERSION;
+        out[5] = out[6] = out[7] = 0;
+        return WARDRIVE_BIN_HEADER_SIZE;
+    }
+
+    bool init() { return names_.init(MAX_NAMES * 4 / 3 + 1); }
+    void release() { names_.release(); }
+
+    // The next encode() starts with a sync record, call when (re)opening a file
+    void restart() {
+        resetState();
+        pendingSync_ = true;
+    }
+
+    // Appends the records for one sighting to out (MAX_OUTPUT bytes at least), returns the count.
+    // A sighting without a valid fix writes nothing and returns 0.
+    size_t encode(const WardriveSighting &s, uint8_t *out) {
+        if (!s.fix.valid) return 0;
+        uint8_t *p = out;
+        if (pendingSync_) {
+            memcpy(p, WARDRIVE_BIN_SYNC, sizeof(WARDRIVE_BIN_SYNC));
+            p += sizeof(WARDRIVE_BIN_SYNC);
+            pendingSync_ = false;
+        } else if (nextName_ >= MAX_NAMES) {
+            resetState();
+            *p++ = WARDRIVE_BIN_RESET;
+        }
+        const uint16_t name = internName(s.name, p);
+        p = putFix(wardriveBinFix(s.fix), p);
+        *p++ = s.type == WARDRIVE_DEVICE_BLE ? WARDRIVE_BIN_BLE : WARDRIVE_BIN_WIFI;
+        uint8_t mac[6];
+        macFromKey(s.mac, mac);
+        memcpy(p, mac, 6);
+        p += 6;
+        p = put16(p, name);
+        if (s.type == WARDRIVE_DEVICE_BLE) {
+            *p++ = (uint8_t)s.rssi;
+            p = put16(p, s.mfgrId);
+        } else {
+            *p++ = s.auth;
+            *p++ = s.channel;
+            *p++ = (uint8_t)s.rssi;
+        }
+        return p - out;
+    }
+
+private:
+    void resetState() {
+        names_.clear();
+        nextName_ = 0;
+        haveFix_ = false;
+    }
+
+    static uint8_t *put16(uint8_t *p, uint16_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+        return p + 2;
+    }
+    static uint8_t *put32(uint8_t *p, uint32_t v) {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+        return p + 4;
+    }
+
+    // FNV-1a over the bytes, the length keeps "" and a zero byte apart
+    static uint64_t nameKey(const FixedSsid &name) {
+        uint64_t h = 14695981039346656037ull ^ name.len;
+        for (uint8_t i = 0; i < name.len; ++i) {
+            h ^= (uint8_t)name.text[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // Whether text holds the sync record, which the reader would take for a new session
+    static bool holdsSync(const char *text, size_t len) {
+        for (size_t i = 0; i + sizeof(WARDRIVE_BIN_SYNC) <= len; ++i) {
+            if (memcmp(text + i, WARDRIVE_BIN_SYNC, sizeof(WARDRIVE_BIN_SYNC)) == 0) return true;
+        }
+        return false;
+    }
+
+    // Known names cost nothing, new ones are written out once with a name record before use.
+    // p is advanced past that record. A name crafted to hold the sync record is left out.
+    uint16_t internName(const FixedSsid &name, uint8_t *&p) {
+        if (name.empty() || holdsSync(name.text, name.len)) return 0xFFFF;
+        bool created = false;
+        uint16_t *id = names_.insert(nameKey(name), &created);
+        if (id && !created) return *id;
+        *p++ = WARDRIVE_BIN_NAME;
+        *p++ = name.len;
+        memcpy(p, name.text, name.len);
+        p += name.len;
+        // without a table (or a full one) every row carries its name, still decodable
+        if (id) *id = nextName_;
+        return nextName_++;
+    }
+
+    uint8_t *putFix(const WardriveBinFix &q, uint8_t *p) {
+        if (haveFix_ && q == fix_) return p;
+        const int64_t dt = (int64_t)q.time - fix_.time;
+        const int64_t dlat = (int64_t)q.lat - fix_.lat;
+        const int64_t dlng = (int64_t)q.lng - fix_.lng;
+        const int64_t dalt = (int64_t)q.altCm - fix_.altCm;
+        const bool small = dt >= 0 && dt <= 0xFF && dlat >= INT16_MIN && dlat <= INT16_MAX &&
+                           dlng >= INT16_MIN && dlng <= INT16_MAX && dalt >= INT16_MIN && dalt <= INT16_MAX;
+        if (haveFix_ && small) {
+            *p++ = WARDRIVE_BIN_DELTA_FIX;
+            *p++ = (uint8_t)dt;
+            p = put16(p, (uint16_t)(int16_t)dlat);
+            p = put16(p, (uint16_t)(int16_t)dlng);
+            p = put16(p, (uint16_t)(int16_t)dalt);
+        } else {
+            *p++ = WARDRIVE_BIN_KEY_FIX;
+            p = put32(p, q.time);
+            p = put32(p, (uint32_t)q.lat);
+            p = put32(p, (uint32_t)q.lng);
+            p = put32(p, (uint32_t)q.altCm);
+        }
+        p = put16(p, q.accuracy);
+        fix_ = q;
+        haveFix_ = true;
+        return p;
+    }
+
+    MacTable<uint16_t> names_;
+    uint16_t nextName_ = 0;
+    WardriveBinFix fix_;
+    bool haveFix_ = false;
+    bool pendingSync_ = true;
+};
+
+// Pulls sightings back out of a binary log. SourceT needs size_t read(uint8_t *, size_t), like
+// fs::File or a stdio wrapper on a host.
+template <typename SourceT> class WardriveBinReader {
+public:
+    enum Result { ROW, END, CORRUPT };
+
+    explicit WardriveBinReader(SourceT &source) : source_(source) {}
+    WardriveBinReader(const WardriveBinReader &) = delete;
+    WardriveBinReader &operator=(const WardriveBinReader &) = delete;
+    ~WardriveBinReader() { free(names_); }
+
+    // Checks the file header and allocates the name table (about 17 KB)
+    bool begin() {
+        if (fill(WARDRIVE_BIN_HEADER_SIZE) < WARDRIVE_BIN_HEADER_SIZE) return false;
+        const uint8_t *header = buf_ + pos_;
+        if (memcmp(header, WARDRIVE_BIN_MAGIC, 4) != 0 || header[4] != WARDRIVE_BIN_VERSION) return false;
+        pos_ += WARDRIVE_BIN_HEADER_SIZE;
+        if (!names_) names_ = (FixedSsid *)calloc(WardriveBinEncoder::MAX_NAMES, sizeof(FixedSsid));
+        return names_ != nullptr;
+    }
+
+    // END also covers a last record cut short. A record that does not decode, or one a sync record
+    // starts inside of (the session after it was appended to a cut file), is skipped up to the next
+    // sync record; CORRUPT when there is none.
+    Result next(WardriveSighting &out) {
+        for (;;) {
+            const size_t avail = fill(WINDOW);
+            if (avail == 0) return END;
+            const size_t start = pos_;
+            const uint8_t *r = buf_ + start;
+            const size_t len = recordLength(r, avail);
+            if (len == 0) {
+                if (!resync()) return CORRUPT;
+                continue;
+            }
+            if (len > avail) return END;
+            const size_t cut = syncInside(r, len, avail);
+            if (cut != 0) {
+                pos_ += cut;
+                damaged_++;
+                continue;
+            }
+            pos_ += len;
+            switch (decode(r, out)) {
+                case DECODED_ROW: rows_++; return ROW;
+                case DECODED_STATE: break;
+                case DECODED_BAD:
+                    pos_ = start;
+                    if (!resync()) return CORRUPT;
+                    break;
+            }
+        }
+    }
+
+    uint32_t rows() const { return rows_; }
+    uint32_t damaged() const { return damaged_; }
+
+private:
+    enum Decoded { DECODED_ROW, DECODED_STATE, DECODED_BAD };
+    static const size_t SYNC_SIZE = sizeof(WARDRIVE_BIN_SYNC);
+    // Longest record (a name) plus what a sync record starting at its last byte needs
+    static const size_t WINDOW = 2 + FixedSsid::MAX_LEN + SYNC_SIZE - 1;
+
+    static uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+    static uint32_t get32(const uint8_t *p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    // Bytes the record at r takes, 0 for an unknown tag or a bad name length
+    static size_t recordLength(const uint8_t *r, size_t avail) {
+        switch (r[0]) {
+            case WARDRIVE_BIN_SESSION: return SYNC_SIZE;
+            case WARDRIVE_BIN_RESET: return 1;
+            case WARDRIVE_BIN_NAME:
+                if (avail < 2) return 2;
+                return r[1] > FixedSsid::MAX_LEN ? 0 : 2 + r[1];
+            case WARDRIVE_BIN_KEY_FIX: return 19;
+            case WARDRIVE_BIN_DELTA_FIX: return 10;
+            case WARDRIVE_BIN_WIFI:
+            case WARDRIVE_BIN_BLE: return 12;
+            default: return 0;
+        }
+    }
+
+    // Offset of a sync record starting within the record at r, 0 when there is none
+    static size_t syncInside(const uint8_t *r, size_t len, size_t avail) {
+        for (size_t i = 1; i < len && i + SYNC_SIZE <= avail; ++i) {
+            if (r[i] == WARDRIVE_BIN_SESSION && memcmp(r + i, WARDRIVE_BIN_SYNC, SYNC_SIZE) == 0) return i;
+        }
+        return 0;
+    }
+
+    Decoded decode(const uint8_t *r, WardriveSighting &out) {
+        const uint8_t *b = r + 1;
+        switch (r[0]) {
+            case WARDRIVE_BIN_SESSION:
+                if (memcmp(r, WARDRIVE_BIN_SYNC, SYNC_SIZE) != 0) return DECODED_BAD;
+                nameCount_ = 0;
+                haveFix_ = false;
+                return DECODED_STATE;
+            case WARDRIVE_BIN_RESET:
+                nameCount_ = 0;
+                haveFix_ = false;
+                return DECODED_STATE;
+            case WARDRIVE_BIN_NAME:
+                if (nameCount_ >= WardriveBinEncoder::MAX_NAMES) return DECODED_BAD;
+                names_[nameCount_++].set((const char *)b + 1, b[0]);
+                return DECODED_STATE;
+            case WARDRIVE_BIN_KEY_FIX:
+                fix_.time = get32(b);
+                fix_.lat = (int32_t)get32(b + 4);
+                fix_.lng = (int32_t)get32(b + 8);
+                fix_.altCm = (int32_t)get32(b + 12);
+                fix_.accuracy = get16(b + 16);
+                haveFix_ = true;
+                return DECODED_STATE;
+            case WARDRIVE_BIN_DELTA_FIX:
+                if (!haveFix_) return DECODED_BAD;
+                fix_.time += b[0];
+                fix_.lat += (int16_t)get16(b + 1);
+                fix_.lng += (int16_t)get16(b + 3);
+                fix_.altCm += (int16_t)get16(b + 5);
+                fix_.accuracy = get16(b + 7);
+                return DECODED_STATE;
+            default: break; // WiFi or BLE row, recordLength() let nothing else through
+        }
+        if (!haveFix_) return DECODED_BAD;
+        const uint16_t name = get16(b + 6);
+        if (name != 0xFFFF && name >= nameCount_) return DECODED_BAD;
+        out = WardriveSighting();
+        out.mac = macKey(b);
+        if (name != 0xFFFF) out.name = names_[name];
+        if (r[0] == WARDRIVE_BIN_BLE) {
+            out.type = WARDRIVE_DEVICE_BLE;
+            out.rssi = (int8_t)b[8];
+            out.mfgrId = get16(b + 9);
+        } else {
+            out.type = WARDRIVE_DEVICE_WIFI;
+            out.auth = b[8];
+            out.channel = b[9];
+            out.rssi = (int8_t)b[10];
+        }
+        out.fix = wardriveFixFromBin(fix_);
+        return DECODED_ROW;
+    }
+
+    // Skips the byte at pos_ and everything up to the next sync record, false at the end of the file
+    bool resync() {
+        damaged_++;
+        pos_++;
+        for (;;) {
+            const size_t avail = fill(SYNC_SIZE);
+            if (avail < SYNC_SIZE) {
+                pos_ = fill_;
+                return false;
+            }
+            const size_t scan = avail - SYNC_SIZE + 1;
+            const uint8_t *hit = (const uint8_t *)memchr(buf_ + pos_, WARDRIVE_BIN_SESSION, scan);
+            if (!hit) {
+                pos_ += scan;
+                continue;
+            }
+            pos_ = hit - buf_;
+            if (memcmp(hit, WARDRIVE_BIN_SYNC, SYNC_SIZE) == 0) return true;
+            pos_++;
+        }
+    }
+
+    // Buffers at least want bytes past pos_ unless the file ends first, returns what is buffered
+    size_t fill(size_t want) {
+        if (fill_ - pos_ >= want) return fill_ - pos_;
+        memmove(buf_, buf_ + pos_, fill_ - pos_);
+        fill_ -= pos_;
+        pos_ = 0;
+        while (fill_ < want) {
+            const size_t n = source_.read(buf_ + fill_, sizeof(buf_) - fill_);
+            if (n == 0) break;
+            fill_ += n;
+        }
+        return fill_;
+    }
+
+    SourceT &source_;
+    uint8_t buf_[512];
+    size_t pos_ = 0;
+    size_t fill_ = 0;
+    FixedSsid *names_ = nullptr;
+    size_t nameCount_ = 0;
+    WardriveBinFix fix_;
+    bool haveFix_ = false;
+    uint32_t rows_ = 0;
+    uint32_t damaged_ = 0;
+};
+
+enum WardriveExportFormat : uint8_t {
+    WARDRIVE_EXPORT_CSV,
+    WARDRIVE_EXPORT_KML,
+};
+
+struct WardriveExportResult {
+    bool ok = false;      // header valid and every write went through
+    bool corrupt = false; // stopped at an undecodable record, rows before it were exported
+    uint32_t rows = 0;
+    uint32_t damaged = 0; // damaged spots skipped up to the next session
+};
+
+// Converts a binary log to WigleWifi-1.6 CSV or KML. SinkT needs size_t write(const uint8_t *,
+// size_t). `version` goes into the CSV header.
+template <typename SourceT, typename SinkT>
+WardriveExportResult
+wardriveExport(SourceT &source, SinkT &sink, WardriveExportFormat format, const char *version) {
+    WardriveExportResult result;
+    WardriveBinReader<SourceT> reader(source);
+    if (!reader.begin()) return result;
+
+    char line[FixedSsid::MAX_LEN * 6 + 256];
+    auto put = [&](const char *text, size_t len) {
+        return len > 0 && sink.write((const uint8_t *)text, len) == len;
+    };
+    bool ok = format == WARDRIVE_EXPORT_KML ? put(WARDRIVE_KML_HEADER, strlen(WARDRIVE_KML_HEADER))
+                                            : put(line, formatWigleHeader(line, sizeof(line), version));
+    WardriveSighting s;
+    typename WardriveBinReader<SourceT>::Result r = WardriveBinReader<SourceT>::END;
+    while (ok && (r = reader.next(s)) == WardriveBinReader<SourceT>::ROW) {
+        const size_t len = format == WARDRIVE_EXPORT_KML ? formatKmlPlacemark(line, sizeof(line), s)
+                                                         : formatWigleRow(line, sizeof(line), s);
+        ok = put(line, len);
+    }
+    if (ok && format == WARDRIVE_EXPORT_KML) ok = put(WARDRIVE_KML_FOOTER, strlen(WARDRIVE_KML_FOOTER));
+    result.ok = ok;
+    result.corrupt = ok && r == WardriveBinReader<SourceT>::CORRUPT;
+    result.rows = reader.rows();
+    result.damaged = reader.damaged();
+    return result;
+}
+
+#endif
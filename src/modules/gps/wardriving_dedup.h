@@ -0,0 +1,200 @@
+#ifndef __WARDRIVING_DEDUP_H__
+#define __WARDRIVING_DEDUP_H__
+// Which devices a wardriving session has already logged. Memory is one allocation sized from a
+// byte budget; once it is full the least recently heard MAC is evicted, never the whole set, so a
+// long drive does not suddenly log every nearby device again. With a re-log window a device heard
+// again after the window gets a new row (at its new position). Plain C++ so it can be built
+// off-target.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct WardriveDedupStats {
+    uint32_t logged = 0;   // shouldLog() answers that were true
+    uint32_t relogged = 0; // of those, known devices past the re-log window
+    uint32_t evicted = 0;
+};
+
+class WardriveDedup {
+public:
+    // Per entry: the node plus its share of the hash index
+    static const size_t NODE_BYTES = 16;
+    static const uint16_t NIL = 0xFFFF;
+    static const size_t MAX_ENTRIES = NIL - 1;
+
+    WardriveDedup() = default;
+    WardriveDedup(const WardriveDedup &) = delete;
+    WardriveDedup &operator=(const WardriveDedup &) = delete;
+    ~WardriveDedup() { release(); }
+
+    // Entries and index buckets that fit in budgetBytes; the index stays at most 3/4 full
+    static void layoutFor(size_t budgetBytes, size_t &entries, size_t &buckets) {
+        entries = 0;
+        buckets = 0;
+        for (size_t b = 8; b <= 0x10000; b <<= 1) {
+            size_t n = b - b / 4;
+            if (n > MAX_ENTRIES) n = MAX_ENTRIES;
+            if (b * sizeof(uint16_t) + n * NODE_BYTES > budgetBytes) {
+                // a partly used index may still beat the previous size
+                if (b * sizeof(uint16_t) < budgetBytes) {
+                    const size_t fit = (budgetBytes - b * sizeof(uint16_t)) / NODE_BYTES;
+                    if (fit > entries) {
+                        entries = fit;
+                        buckets = b;
+                    }
+                }
+                break;
+            }
+            entries = n;
+            buckets = b;
+        }
+    }
+
+    // false when the budget does not hold a single entry or the allocation fails
+    bool init(size_t budgetBytes) {
+        release();
+        size_t entries, buckets;
+        layoutFor(budgetBytes, entries, buckets);
+        if (entries == 0) return false;
+        uint8_t *mem = (uint8_t *)malloc(entries * sizeof(Node) + buckets * sizeof(uint16_t));
+        if (!mem) return false;
+        nodes_ = reinterpret_cast<Node *>(mem);
+        index_ = reinterpret_cast<uint16_t *>(mem + entries * sizeof(Node));
+        capacity_ = entries;
+        mask_ = buckets - 1;
+        clear();
+        return true;
+    }
+
+    void release() {
+        free(nodes_);
+        nodes_ = nullptr;
+        index_ = nullptr;
+        capacity_ = 0;
+        mask_ = 0;
+        size_ = 0;
+    }
+
+    void clear() {
+        if (index_) memset(index_, 0xFF, (mask_ + 1) * sizeof(uint16_t));
+        size_ = 0;
+        head_ = tail_ = NIL;
+        stats_ = WardriveDedupStats();
+    }
+
+    // true when the device should get a row now: never logged, evicted since, or last logged at
+    // least windowMs ago (0 disables re-logging). Either way it becomes the most recent entry.
+    bool shouldLog(uint64_t key, uint32_t nowMs, uint32_t windowMs) {
+        if (!nodes_) return true;
+        uint16_t idx = find(key);
+        if (idx != NIL) {
+            moveToFront(idx);
+            Node &n = nodes_[idx];
+            if (windowMs == 0 || (uint32_t)(nowMs - n.loggedMs) < windowMs) return false;
+            n.loggedMs = nowMs;
+            stats_.logged++;
+            stats_.relogged++;
+            return true;
+        }
+        if (size_ < capacity_) {
+            idx = size_++;
+        } else {
+            idx = tail_;
+            unlink(idx);
+            unindex(idx);
+            stats_.evicted++;
+        }
+        nodes_[idx].key = key;
+        nodes_[idx].loggedMs = nowMs;
+        pushFront(idx);
+        index(idx);
+        stats_.logged++;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    size_t memoryBytes() const {
+        return nodes_ ? capacity_ * sizeof(Node) + (mask_ + 1) * sizeof(uint16_t) : 0;
+    }
+    const WardriveDedupStats &stats() const { return stats_; }
+
+private:
+    struct Node {
+        uint64_t key;
+        uint32_t loggedMs;
+        uint16_t prev; // towards the most recent
+        uint16_t next; // towards the least recent
+    };
+    static_assert(sizeof(Node) == NODE_BYTES, "WardriveDedup node layout");
+
+    size_t home(uint64_t key) const {
+        uint32_t h = (uint32_t)key ^ (uint32_t)(key >> 32);
+        h *= 0x9E3779B1u;
+        h ^= h >> 16;
+        return h & mask_;
+    }
+
+    uint16_t find(uint64_t key) const {
+        for (size_t b = home(key); index_[b] != NIL; b = (b + 1) & mask_) {
+            if (nodes_[index_[b]].key == key) return index_[b];
+        }
+        return NIL;
+    }
+
+    void index(uint16_t idx) {
+        size_t b = home(nodes_[idx].key);
+        while (index_[b] != NIL) b = (b + 1) & mask_;
+        index_[b] = idx;
+    }
+
+    // Backward-shift deletion, same scheme as MacTable
+    void unindex(uint16_t idx) {
+        size_t hole = home(nodes_[idx].key);
+        while (index_[hole] != idx) hole = (hole + 1) & mask_;
+        index_[hole] = NIL;
+        for (size_t b = (hole + 1) & mask_; index_[b] != NIL; b = (b + 1) & mask_) {
+            const size_t h = home(nodes_[index_[b]].key);
+            const bool movable = hole <= b ? (h <= hole || h > b) : (h <= hole && h > b);
+            if (movable) {
+                index_[hole] = index_[b];
+                index_[b] = NIL;
+                hole = b;
+            }
+        }
+    }
+
+    void pushFront(uint16_t idx) {
+        nodes_[idx].prev = NIL;
+        nodes_[idx].next = head_;
+        if (head_ != NIL) nodes_[head_].prev = idx;
+        head_ = idx;
+        if (tail_ == NIL) tail_ = idx;
+    }
+
+    void unlink(uint16_t idx) {
+        Node &n = nodes_[idx];
+        if (n.prev != NIL) nodes_[n.prev].next = n.next;
+        else head_ = n.next;
+        if (n.next != NIL) nodes_[n.next].prev = n.prev;
+        else tail_ = n.prev;
+    }
+
+    void moveToFront(uint16_t idx) {
+        if (head_ == idx) return;
+        unlink(idx);
+        pushFront(idx);
+    }
+
+    Node *nodes_ = nullptr;
+    uint16_t *index_ = nullptr;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    uint16_t head_ = NIL;
+    uint16_t tail_ = NIL;
+    WardriveDedupStats stats_;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "wardriving_export.h"
+#include "core/display.h"
+#include "core/sd_functions.h"
+#include <globals.h>
+
+#define WARDRIVING_DIR "/BruceWardriving"
+
+WardriveExportResult
+wardrive_export_file(FS &fs, const String &path, WardriveExportFormat format, String &outPath) {
+    WardriveExportResult result;
+    const int dot = path.lastIndexOf('.');
+    outPath = (dot > path.lastIndexOf('/') ? path.substring(0, dot) : path) +
+              (format == WARDRIVE_EXPORT_KML ? ".kml" : ".csv");
+
+    File in = fs.open(path, FILE_READ);
+    if (!in) return result;
+    File out = fs.open(outPath, FILE_WRITE);
+    if (!out) {
+        in.close();
+        return result;
+    }
+    result = wardriveExport(in, out, format, BRUCE_VERSION);
+    in.close();
+    out.close();
+    if (!result.ok) fs.remove(outPath);
+    return result;
+}
+
+void wardrive_export_menu() {
+    FS *fs;
+    if (!getFsStorage(fs)) {
+        displayError("Storage setup error", true);
+        return;
+    }
+    String path = loopSD(*fs, true, "bwd", WARDRIVING_DIR);
+    if (path.length() == 0) return;
+
+    int format = -1;
+    options = {
+        {"WigleWifi CSV", [&]() { format = WARDRIVE_EXPORT_CSV; }},
+        {"KML",           [&]() { format = WARDRIVE_EXPORT_KML; }},
+    };
+    loopOptions(options);
+    if (format < 0) return;
+
+    displayTextLine("Exporting...");
+    String outPath;
+    const WardriveExportResult result =
+        wardrive_export_file(*fs, path, (WardriveExportFormat)format, outPath);
+    if (!result.ok) {
+        displayError("Export failed", true);
+        return;
+    }
+    String msg = String(result.rows) + " rows to " + outPath.substring(outPath.lastIndexOf('/') + 1);
+    if (result.damaged) msg += ", " + String(result.damaged) + " damaged spots skipped";
+    if (result.corrupt) msg += " (stopped at a bad record)";
+    displaySuccess(msg, true);
+}
@@ -0,0 +1,15 @@
+#ifndef __WARDRIVING_EXPORT_H__
+#define __WARDRIVING_EXPORT_H__
+// Turns binary wardriving logs (.bwd) into WigleWifi CSV or KML on the device, from the GPS menu
+// or the serial CLI. tools/wardrive_convert.cpp does the same on a host.
+#include "wardriving_binlog.h"
+#include <FS.h>
+
+// Writes the export next to the log (same name, .csv or .kml), outPath gets its path
+WardriveExportResult
+wardrive_export_file(FS &fs, const String &path, WardriveExportFormat format, String &outPath);
+
+// Picks a log and a format, then exports it
+void wardrive_export_menu();
+
+#endif
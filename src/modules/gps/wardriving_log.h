@@ -0,0 +1,219 @@
+#ifndef __WARDRIVING_LOG_H__
+#define __WARDRIVING_LOG_H__
+// What the wardriving collectors hand to the writer: one sighting per device, formatted by the
+// writer task as a WigleWifi-1.6 CSV row or a binary record (wardriving_binlog.h). The text
+// formats live here so the live log and the exporters write the same rows. Plain C++ so it can be
+// built off-target.
+#include "modules/wifi/packet_slab.h"
+#include "wardriving_ap_table.h"
+#include <stdio.h>
+
+const size_t WARDRIVE_ROW_MAX = 254;
+
+enum WardriveDeviceType : uint8_t {
+    WARDRIVE_DEVICE_WIFI,
+    WARDRIVE_DEVICE_BLE,
+};
+
+struct WardriveSighting {
+    uint64_t mac = 0;
+    uint8_t type = WARDRIVE_DEVICE_WIFI;
+    uint8_t auth = WARDRIVE_AUTH_UNKNOWN; // WiFi only
+    uint8_t channel = 0;                  // WiFi only
+    int8_t rssi = 0;
+    uint16_t mfgrId = 0; // BLE only, 0 when not advertised
+    FixedSsid name;      // SSID or BLE device name
+    WardriveFix fix;
+};
+
+typedef SpscRing<WardriveSighting, 32> WardriveRowQueue;
+
+inline WardriveSighting wardriveApSighting(uint64_t bssid, const WardriveAp &ap) {
+    WardriveSighting s;
+    s.mac = bssid;
+    s.type = WARDRIVE_DEVICE_WIFI;
+    s.auth = ap.auth;
+    s.channel = ap.channel;
+    s.rssi = ap.bestRssi;
+    s.name = ap.ssid;
+    s.fix = ap.first;
+    return s;
+}
+
+inline int wardriveChannelFreq(int channel) {
+    return channel == 14 ? 2484 : channel > 14 ? 5000 + channel * 5 : 2407 + channel * 5;
+}
+
+// The two WigleWifi-1.6 header lines. Returns the length, 0 when buf is too small.
+inline size_t formatWigleHeader(char *buf, size_t size, const char *version) {
+    const int n = snprintf(
+        buf,
+        size,
+        "WigleWifi-1.6,appRelease=v%s,model=M5Stack GPS Unit,release=v%s,device=ESP32 M5Stack,"
+        "display=SPI TFT,board=ESP32 M5Stack,brand=Bruce,star=Sol,body=4,subBody=1\r\n"
+        "MAC,SSID,AuthMode,FirstSeen,Channel,Frequency,RSSI,CurrentLatitude,CurrentLongitude,"
+        "AltitudeMeters,AccuracyMeters,RCOIs,MfgrId,Type\r\n",
+        version,
+        version
+    );
+    return n > 0 && (size_t)n < size ? (size_t)n : 0;
+}
+
+// CSV quoting: inner quotes doubled, control characters dropped
+inline void wardriveCsvText(char *out, const FixedSsid &name) {
+    size_t o = 0;
+    for (uint8_t i = 0; i < name.len; ++i) {
+        const char c = name.text[i];
+        if ((uint8_t)c < 0x20 || c == 0x7F) continue;
+        if (c == '"') out[o++] = '"';
+        out[o++] = c;
+    }
+    out[o] = '\0';
+}
+
+// One WigleWifi-1.6 row in the column order the file header declares. Returns the length, 0 when
+// buf is too small or the sighting has no valid fix.
+inline size_t formatWigleRow(char *buf, size_t size, const WardriveSighting &s) {
+    if (!s.fix.valid) return 0;
+    uint8_t mac[6];
+    macFromKey(s.mac, mac);
+    char name[FixedSsid::MAX_LEN * 2 + 1];
+    wardriveCsvText(name, s.name);
+    const WardriveFix &fix = s.fix;
+    int n;
+    if (s.type == WARDRIVE_DEVICE_BLE) {
+        char mfgr[5] = "";
+        if (s.mfgrId != 0) snprintf(mfgr, sizeof(mfgr), "%04X", s.mfgrId);
+        n = snprintf(
+            buf,
+            size,
+            "%02X:%02X:%02X:%02X:%02X:%02X,\"%s\",Misc [BLE],%04d-%02d-%02d %02d:%02d:%02d,0,,%d,%f,%f,%f,"
+            "%f,,%s,BLE\n",
+            mac[0],
+            mac[1],
+            mac[2],
+            mac[3],
+            mac[4],
+            mac[5],
+            name,
+            fix.year,
+            fix.month,
+            fix.day,
+            fix.hour,
+            fix.minute,
+            fix.second,
+            s.rssi,
+            fix.lat,
+            fix.lng,
+            (double)fix.altitudeM,
+            (double)fix.accuracyM,
+            mfgr
+        );
+    } else {
+        n = snprintf(
+            buf,
+            size,
+            "%02X:%02X:%02X:%02X:%02X:%02X,\"%s\",[%s],%04d-%02d-%02d %02d:%02d:%02d,%d,%d,%d,%f,%f,%f,%f,,,"
+            "WIFI\n",
+            mac[0],
+            mac[1],
+            mac[2],
+            mac[3],
+            mac[4],
+            mac[5],
+            name,
+            wardriveAuthName(s.auth),
+            fix.year,
+            fix.month,
+            fix.day,
+            fix.hour,
+            fix.minute,
+            fix.second,
+            s.channel,
+            wardriveChannelFreq(s.channel),
+            s.rssi,
+            fix.lat,
+            fix.lng,
+            (double)fix.altitudeM,
+            (double)fix.accuracyM
+        );
+    }
+    return n > 0 && (size_t)n < size ? (size_t)n : 0;
+}
+
+const char WARDRIVE_KML_HEADER[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                   "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n<Document>\n"
+                                   "<name>Bruce Wardriving</name>\n";
+const char WARDRIVE_KML_FOOTER[] = "</Document>\n</kml>\n";
+
+// XML escaping, control characters dropped
+inline void wardriveXmlText(char *out, const FixedSsid &name) {
+    size_t o = 0;
+    for (uint8_t i = 0; i < name.len; ++i) {
+        const char c = name.text[i];
+        const char *entity = nullptr;
+        switch (c) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '"': entity = "&quot;"; break;
+            default: break;
+        }
+        if (entity) {
+            const size_t len = strlen(entity);
+            memcpy(out + o, entity, len);
+            o += len;
+        } else if ((uint8_t)c >= 0x20 && c != 0x7F) {
+            out[o++] = c;
+        }
+    }
+    out[o] = '\0';
+}
+
+// One KML placemark at the position the device was logged at, named after the SSID/device name
+// or the MAC for hidden ones. Returns the length, 0 when buf is too small or there is no valid fix.
+inline size_t formatKmlPlacemark(char *buf, size_t size, const WardriveSighting &s) {
+    if (!s.fix.valid) return 0;
+    uint8_t mac[6];
+    macFromKey(s.mac, mac);
+    char macText[18];
+    snprintf(
+        macText,
+        sizeof(macText),
+        "%02X:%02X:%02X:%02X:%02X:%02X",
+        mac[0],
+        mac[1],
+        mac[2],
+        mac[3],
+        mac[4],
+        mac[5]
+    );
+    char name[FixedSsid::MAX_LEN * 6 + 1];
+    wardriveXmlText(name, s.name);
+    const bool ble = s.type == WARDRIVE_DEVICE_BLE;
+    const WardriveFix &fix = s.fix;
+    const int n = snprintf(
+        buf,
+        size,
+        "<Placemark><name>%s</name><description>%s %s%s%s RSSI %d %04d-%02d-%02d %02d:%02d:%02d"
+        "</description><Point><coordinates>%f,%f,%f</coordinates></Point></Placemark>\n",
+        s.name.empty() ? macText : name,
+        ble ? "BLE" : "WIFI",
+        macText,
+        ble ? "" : " ",
+        ble ? "" : wardriveAuthName(s.auth),
+        s.rssi,
+        fix.year,
+        fix.month,
+        fix.day,
+        fix.hour,
+        fix.minute,
+        fix.second,
+        fix.lng,
+        fix.lat,
+        (double)fix.altitudeM
+    );
+    return n > 0 && (size_t)n < size ? (size_t)n : 0;
+}
+
+#endif
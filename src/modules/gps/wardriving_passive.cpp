@@ -0,0 +1,138 @@
+#include "wardriving_passive.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "modules/wifi/frame_bus.h"
+#include <Arduino.h>
+
+namespace {
+// Table size (slots, 3/4 usable). Logged APs idle for the prune age make room for new ones.
+const size_t AP_TABLE_SLOTS_PSRAM = 2048;
+const size_t AP_TABLE_SLOTS_INTERNAL = 256;
+const uint32_t AP_SETTLE_MS = 10000;
+const uint32_t AP_PRUNE_IDLE_MS = 5 * 60 * 1000;
+const uint32_t AP_PRUNE_INTERVAL_MS = 30000;
+const uint32_t HOP_TASK_STACK = 2048;
+
+// The callback only try-locks: a beacon lost while the UI task drains comes again 100 ms later
+WardriveApTable apTable;
+SemaphoreHandle_t apTableMutex = nullptr;
+StaticSemaphore_t apTableMutexBuffer;
+volatile uint32_t apTableBusy = 0;
+uint32_t lastPrune = 0;
+WardriveHopSchedule hopSchedule;
+TaskHandle_t hopTask = nullptr;
+volatile bool hopStop = false;
+volatile bool hopRunning = false;
+volatile uint8_t hopChannel = 0;
+volatile uint32_t hopCount = 0;
+
+// Runs in the WiFi task: parse outside the lock, merge under it
+void onFrame(const WifiFrameDesc &frame, const wifi_promiscuous_pkt_t *, wifi_promiscuous_pkt_type_t) {
+    WardriveBeacon beacon;
+    if (!parseWardriveBeacon(frame, beacon)) return;
+    if (xSemaphoreTake(apTableMutex, 0) != pdTRUE) {
+        apTableBusy = apTableBusy + 1;
+        return;
+    }
+    apTable.merge(beacon, millis());
+    xSemaphoreGive(apTableMutex);
+}
+
+void hopTaskMain(void *) {
+    uint8_t i = 0;
+    while (!hopStop) {
+        const WardriveHopStep &step = hopSchedule.step(i);
+        // Channels the radio or the country setting does not allow are skipped quietly, after a
+        // tick so a schedule the radio refuses entirely does not spin on the CPU
+        const bool tuned = esp_wifi_set_channel(step.channel, WIFI_SECOND_CHAN_NONE) == ESP_OK;
+        if (tuned) {
+            hopChannel = step.channel;
+            hopCount = hopCount + 1;
+        }
+        ulTaskNotifyTake(pdTRUE, tuned ? pdMS_TO_TICKS(step.dwellMs) : 1);
+        i = (i + 1) % hopSchedule.count();
+    }
+    hopRunning = false;
+    vTaskDelete(nullptr);
+}
+} // namespace
+
+bool wardrive_passive_start(const WardriveHopSchedule &schedule) {
+    if (schedule.count() == 0) return false;
+    if (!apTableMutex) apTableMutex = xSemaphoreCreateMutexStatic(&apTableMutexBuffer);
+    if (!apTable.init(psramFound() ? AP_TABLE_SLOTS_PSRAM : AP_TABLE_SLOTS_INTERNAL)) return false;
+    apTable.clear();
+    apTableBusy = 0;
+    lastPrune = millis();
+    hopSchedule = schedule;
+    hopCount = 0;
+
+    wifi_promiscuous_filter_t filter = {.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT};
+    esp_wifi_set_promiscuous_filter(&filter);
+    frame_bus_subscribe(onFrame, WIFI_FRAME_BEACON | WIFI_FRAME_PROBE_RESP);
+    frame_bus_attach();
+    esp_wifi_set_promiscuous(true);
+
+    hopStop = false;
+    hopRunning = true;
+    if (xTaskCreate(hopTaskMain, "wd_hop", HOP_TASK_STACK, nullptr, 2, &hopTask) != pdPASS) {
+        hopRunning = false;
+        hopTask = nullptr;
+        wardrive_passive_stop();
+        return false;
+    }
+    return true;
+}
+
+void wardrive_passive_stop() {
+    hopStop = true;
+    while (hopRunning) {
+        if (hopTask) xTaskNotifyGive(hopTask);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    hopTask = nullptr;
+    esp_wifi_set_promiscuous(false);
+    frame_bus_unsubscribe(onFrame);
+    if (!apTableMutex) return;
+    xSemaphoreTake(apTableMutex, portMAX_DELAY);
+    apTable.release();
+    xSemaphoreGive(apTableMutex);
+}
+
+void wardrive_passive_set_fix(const WardriveFix &fix) {
+    xSemaphoreTake(apTableMutex, portMAX_DELAY);
+    apTable.setFix(fix);
+    xSemaphoreGive(apTableMutex);
+}
+
+size_t wardrive_passive_drain(WardrivePassiveRow *rows, size_t max, bool force) {
+    const uint32_t now = millis();
+    size_t n = 0;
+    xSemaphoreTake(apTableMutex, portMAX_DELAY);
+    apTable.drain(now, AP_SETTLE_MS, force, max, [&](uint64_t bssid, const WardriveAp &ap) {
+        rows[n].bssid = bssid;
+        rows[n].ap = ap;
+        n++;
+    });
+    if (n < max && now - lastPrune >= AP_PRUNE_INTERVAL_MS) {
+        apTable.prune(now, AP_PRUNE_IDLE_MS);
+        lastPrune = now;
+    }
+    xSemaphoreGive(apTableMutex);
+    return n;
+}
+
+WardrivePassiveStats wardrive_passive_stats() {
+    WardrivePassiveStats s;
+    xSemaphoreTake(apTableMutex, portMAX_DELAY);
+    s.table = apTable.stats();
+    s.size = apTable.size();
+    s.capacity = apTable.capacity();
+    xSemaphoreGive(apTableMutex);
+    s.busy = apTableBusy;
+    s.channel = hopChannel;
+    s.hops = hopCount;
+    return s;
+}
@@ -0,0 +1,35 @@
+#ifndef __WARDRIVING_PASSIVE_H__
+#define __WARDRIVING_PASSIVE_H__
+// Passive WiFi collection for wardriving: the radio hops channels on a dwell schedule and a
+// frame bus subscriber merges every beacon and probe response into the AP table. Nothing
+// transmits and nothing blocks the caller; rows are pulled out with wardrive_passive_drain().
+#include "wardriving_ap_table.h"
+
+struct WardrivePassiveRow {
+    uint64_t bssid;
+    WardriveAp ap;
+};
+
+struct WardrivePassiveStats {
+    WardriveTableStats table;
+    size_t size = 0;
+    size_t capacity = 0;
+    uint8_t channel = 0; // channel the radio sits on right now
+    uint32_t hops = 0;
+    uint32_t busy = 0; // frames skipped while the table was being drained
+};
+
+// WiFi must already be started in STA mode. false when the table or the hop task cannot be set up.
+bool wardrive_passive_start(const WardriveHopSchedule &schedule);
+void wardrive_passive_stop();
+
+// Position stamped on APs heard from now on, pass an invalid fix while there is none
+void wardrive_passive_set_fix(const WardriveFix &fix);
+
+// Copies up to max APs ready for their row into rows (see WardriveApTable::drain) and forgets
+// logged APs that went quiet. force takes every located AP, for the end of a session.
+size_t wardrive_passive_drain(WardrivePassiveRow *rows, size_t max, bool force);
+
+WardrivePassiveStats wardrive_passive_stats();
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef __WARDRIVING_WRITER_H__
+#define __WARDRIVING_WRITER_H__
+// Wardriving log output: a single writer appends the formatted rows (CSV text or binary records)
+// to one long-lived file. Rows are packed into a large buffer that is written out in whole blocks,
+// so the card sees aligned, sector sized writes, and poll() pushes the tail and syncs every flush
+// interval. FileT needs write(const uint8_t *, size_t), flush(), close() and operator bool, like
+// fs::File or a stdio wrapper on a host.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct WardriveWriterStats {
+    uint32_t rows = 0;
+    uint32_t bytes = 0;       // bytes handed to the file
+    uint32_t writes = 0;      // write() calls issued on the file
+    uint32_t syncs = 0;       // flush() calls issued on the file
+    uint32_t failed = 0;      // short writes
+    uint32_t lastWriteUs = 0; // duration of the latest write() + flush(), needs a clock
+    uint32_t maxWriteUs = 0;
+};
+
+template <typename FileT> class WardriveLogWriter {
+public:
+    static const size_t WRITE_BLOCK = 512;
+    static const uint32_t DEFAULT_FLUSH_INTERVAL_MS = 2000;
+
+    // `buffer` is owned by the caller; capacity is rounded down to whole blocks (at least one)
+    void setBuffer(uint8_t *buffer, size_t capacity) {
+        buffer_ = buffer;
+        capacity_ = capacity >= WRITE_BLOCK ? capacity - capacity % WRITE_BLOCK : capacity;
+        used_ = 0;
+    }
+    void setFlushInterval(uint32_t ms) { flushIntervalMs_ = ms; }
+    // Microsecond clock for the write latency figures, none by default
+    void setClock(uint32_t (*micros)()) { micros_ = micros; }
+
+    // Takes over an opened file positioned at its end. fileBytes is its current size, so block
+    // writes line up with the file offset and not just with the buffer.
+    bool attach(FileT file, uint32_t fileBytes, uint32_t nowMs) {
+        close();
+        if (!file) return false;
+        file_ = file;
+        open_ = true;
+        used_ = 0;
+        offset_ = fileBytes;
+        lastSyncMs_ = nowMs;
+        return true;
+    }
+
+    // A full buffer goes out up to the last block boundary; the row straddling it stays behind
+    // and starts the next block
+    bool append(const char *row, size_t len) {
+        if (!open_) return false;
+        stats_.rows++;
+        if (!buffer_ || capacity_ == 0) return writeOut((const uint8_t *)row, len);
+        if (len > capacity_) return drain() && writeOut((const uint8_t *)row, len);
+        if (used_ + len > capacity_ && !writeBlocks()) return false;
+        if (used_ + len > capacity_ && !drain()) return false;
+        memcpy(buffer_ + used_, row, len);
+        used_ += len;
+        return true;
+    }
+
+    // Time based sync, call regularly from the task that owns the writer
+    bool poll(uint32_t nowMs) {
+        if (!open_) return true;
+        if ((uint32_t)(nowMs - lastSyncMs_) < flushIntervalMs_) return true;
+        return flush(nowMs);
+    }
+
+    // Writes out everything buffered and syncs the file
+    bool flush(uint32_t nowMs) {
+        if (!open_) return true;
+        lastSyncMs_ = nowMs;
+        if (used_ == 0 && syncedBytes_ == stats_.bytes) return true;
+        const uint32_t start = micros_ ? micros_() : 0;
+        const bool ok = drain();
+        file_.flush();
+        stats_.syncs++;
+        syncedBytes_ = stats_.bytes;
+        noteLatency(start);
+        return ok;
+    }
+
+    void close() {
+        if (!open_) return;
+        drain();
+        file_.flush();
+        file_.close();
+        open_ = false;
+        used_ = 0;
+    }
+
+    bool isOpen() const { return open_; }
+    size_t buffered() const { return used_; }
+    const WardriveWriterStats &stats() const { return stats_; }
+
+private:
+    // Writes the buffered bytes up to the last block boundary of the file, keeps the rest
+    bool writeBlocks() {
+        const size_t head = (WRITE_BLOCK - offset_ % WRITE_BLOCK) % WRITE_BLOCK;
+        if (used_ < head + WRITE_BLOCK) return true;
+        const size_t n = head + (used_ - head) / WRITE_BLOCK * WRITE_BLOCK;
+        const uint32_t start = micros_ ? micros_() : 0;
+        const bool ok = writeOut(buffer_, n);
+        noteLatency(start);
+        memmove(buffer_, buffer_ + n, used_ - n);
+        used_ -= n;
+        return ok;
+    }
+
+    bool drain() {
+        if (used_ == 0) return true;
+        const bool ok = writeOut(buffer_, used_);
+        used_ = 0;
+        return ok;
+    }
+
+    bool writeOut(const uint8_t *data, size_t len) {
+        const size_t written = file_.write(data, len);
+        stats_.writes++;
+        stats_.bytes += written;
+        offset_ += written;
+        if (written != len) {
+            stats_.failed++;
+            return false;
+        }
+        return true;
+    }
+
+    void noteLatency(uint32_t start) {
+        if (!micros_) return;
+        const uint32_t us = micros_() - start;
+        stats_.lastWriteUs = us;
+        if (us > stats_.maxWriteUs) stats_.maxWriteUs = us;
+    }
+
+    FileT file_;
+    bool open_ = false;
+    uint8_t *buffer_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    uint32_t offset_ = 0;
+    uint32_t flushIntervalMs_ = DEFAULT_FLUSH_INTERVAL_MS;
+    uint32_t lastSyncMs_ = 0;
+    uint32_t syncedBytes_ = 0;
+    uint32_t (*micros_)() = nullptr;
+    WardriveWriterStats stats_;
+};
+
+#endif
@@ -12,6 +12,11 @@
 #include "core/wifi/wifi_common.h"
 
 #define CBUFLEN 1024
+#define WIGLE_QUEUE_FILE "/BruceWardriving/wigle_queue.txt"
+#define WIGLE_QUEUE_TEMP "/BruceWardriving/wigle_queue.tmp"
+// A part in flight is among the newest uploads; past this many pages it was never made
+#define WIGLE_LANDED_MAX_PAGES 10
+#define WIGLE_MAX_TRIES 6
 
 Wigle::Wigle() {}
 
@@ -108,6 +113,23 @@ void Wigle::send_upload_headers(WiFiClientSecure &client, String filename, int f
     client.println();
 }
 
+// Adapter handed to wigleUploadStep()
+struct WigleTransport {
+    Wigle &wigle;
+
+    WigleSendResult send(
+        const char *name,
+        const uint8_t *header,
+        size_t headerLen,
+        File &file,
+        uint32_t offset,
+        uint32_t length
+    ) {
+        return wigle._send_part(name, header, headerLen, file, offset, length);
+    }
+    int landed(const char *name) { return wigle._part_landed(name); }
+};
+
 bool Wigle::upload(FS *fs, String filepath, bool auto_delete) {
     display_banner();
 
@@ -120,20 +142,24 @@ bool Wigle::upload(FS *fs, String filepath, bool auto_delete) {
         displayError("Failed to open Wigle file", true);
         return false;
     }
+    const uint32_t filesize = file.size();
+    file.close();
 
-    if (!_upload_file(file, "Uploading...")) {
-        file.close();
-        displayError("File upload error", true);
+    _load_queue(fs);
+    if (!queue.add(filepath.c_str(), filesize)) {
+        displayError("Wigle upload queue full", true);
         return false;
     }
+    _save_queue(fs);
 
-    file.close();
-    if (auto_delete) fs->remove(filepath);
+    if (_run_queue(fs, filepath, auto_delete) < 1) return false;
 
     displaySuccess("File upload success", true);
     return true;
 }
 
+// Queues every CSV in the folder, then works through the whole queue, so files left half
+// uploaded by an earlier run are finished too
 bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
     Serial.println("Wigle upload all path: " + folder);
 
@@ -145,14 +171,11 @@ bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
     if (!fs || !get_user()) return false;
 
     dump_wigle_info();
-    int i = 1;
-    bool success;
+    _load_queue(fs);
 
     while (true) {
         bool isDir;
 
-        success = false;
-
         String fullPath = root.getNextFileName(&isDir);
         String nameOnly = fullPath.substring(fullPath.lastIndexOf("/") + 1);
         if (fullPath == "") { break; }
@@ -165,54 +188,175 @@ bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
             ext.toUpperCase();
             if (ext.equals("CSV")) {
                 File file = fs->open(fullPath);
-
                 if (file) {
-                    if (!_upload_file(file, "Uploading " + String(i) + "...")) {
-                        file.close();
-                        displayError("File upload error", true);
-                        return false;
+                    if (!queue.add(fullPath.c_str(), file.size())) {
+                        padprintln("Queue full, skipped " + nameOnly);
                     }
-                    i++;
-                    success = true;
-
                     file.close();
-                    if (success && auto_delete) fs->remove(fullPath);
                 }
             }
         }
     }
     root.close();
+    _save_queue(fs);
+
+    const int uploaded = _run_queue(fs, "", auto_delete);
+    if (uploaded < 0) return false;
 
-    String plural = i > 2 ? "s" : "";
-    displaySuccess(String(i - 1) + " file" + plural + " uploaded", true);
+    String plural = uploaded != 1 ? "s" : "";
+    displaySuccess(String(uploaded) + " file" + plural + " uploaded", true);
     return true;
 }
 
-bool Wigle::_upload_file(File file, String upload_message) {
+void Wigle::_load_queue(FS *fs) {
+    queue.clear();
+    // a save cut short between the remove and the rename leaves only the new copy
+    if (!fs->exists(WIGLE_QUEUE_FILE) && fs->exists(WIGLE_QUEUE_TEMP)) {
+        fs->rename(WIGLE_QUEUE_TEMP, WIGLE_QUEUE_FILE);
+    }
+    File file = fs->open(WIGLE_QUEUE_FILE, FILE_READ);
+    if (!file) return;
+    const size_t len = file.size();
+    char *text = (char *)malloc(len + 1);
+    if (text) {
+        file.read((uint8_t *)text, len);
+        queue.parse(text, len);
+        free(text);
+    }
+    file.close();
+}
+
+// Written to a temporary file that then replaces the queue, so a power loss mid-write never
+// leaves a truncated queue behind
+void Wigle::_save_queue(FS *fs) {
+    if (queue.count() == 0) {
+        if (fs->exists(WIGLE_QUEUE_FILE)) fs->remove(WIGLE_QUEUE_FILE);
+        return;
+    }
+    static char text[WIGLE_QUEUE_MAX_FILES * 160];
+    const size_t len = queue.serialize(text, sizeof(text));
+    if (len == 0) return;
+    if (!fs->exists("/BruceWardriving")) fs->mkdir("/BruceWardriving");
+    File file = fs->open(WIGLE_QUEUE_TEMP, FILE_WRITE);
+    if (!file) return;
+    const bool written = file.write((const uint8_t *)text, len) == len;
+    file.close();
+    if (!written) {
+        fs->remove(WIGLE_QUEUE_TEMP);
+        return;
+    }
+    if (fs->exists(WIGLE_QUEUE_FILE)) fs->remove(WIGLE_QUEUE_FILE);
+    fs->rename(WIGLE_QUEUE_TEMP, WIGLE_QUEUE_FILE);
+}
+
+// Waits out the retry delay, false when the user cancels
+bool Wigle::_wait_backoff(uint16_t attempts) {
+    const uint32_t waitMs = WigleUploadQueue::backoffMs(attempts);
+    const uint32_t start = millis();
+    while (millis() - start < waitMs) {
+        displayTextLine("Retry in " + String((waitMs - (millis() - start)) / 1000 + 1) + "s");
+        for (int i = 0; i < 10; i++) {
+            if (check(EscPress)) return false;
+            vTaskDelay(100 / portTICK_PERIOD_MS);
+        }
+    }
+    return true;
+}
+
+// Uploads the queued files, every one or just `only`. Returns how many finished, -1 when the run
+// stopped early; the queue keeps the progress for the next run either way.
+int Wigle::_run_queue(FS *fs, const String &only, bool auto_delete) {
+    WigleTransport transport = {*this};
+    int finished = 0;
+    size_t i = 0;
+    while (i < queue.count()) {
+        const String path = queue.at(i).path;
+        if (only != "" && only != path) {
+            i++;
+            continue;
+        }
+
+        File file = fs->open(path);
+        WigleQueueEntry *e = file ? queue.add(path.c_str(), file.size()) : nullptr;
+        if (!e) {
+            if (file) file.close();
+            queue.remove(i);
+            _save_queue(fs);
+            continue;
+        }
+
+        progress_message = "Uploading " + String(finished + 1) + "...";
+        WigleStepResult r;
+        do {
+            r = wigleUploadStep(*e, file, transport, WIGLE_PART_MAX_BYTES, [&]() { _save_queue(fs); });
+            if (r == WIGLE_STEP_RETRY && (e->attempts >= WIGLE_MAX_TRIES || !_wait_backoff(e->attempts))) {
+                file.close();
+                displayError("Upload paused, resumes next time", true);
+                return -1;
+            }
+        } while (r == WIGLE_STEP_PART_DONE || r == WIGLE_STEP_RETRY);
+        file.close();
+
+        if (r == WIGLE_STEP_REJECTED) {
+            displayError("Wigle rejected the upload", true);
+            return -1;
+        }
+        if (r == WIGLE_STEP_BAD_FILE) {
+            padprintln("Not a WigleWifi file: " + path.substring(path.lastIndexOf("/") + 1));
+        } else {
+            finished++;
+            if (auto_delete) fs->remove(path);
+        }
+        queue.remove(i);
+        _save_queue(fs);
+    }
+    return finished;
+}
+
+// Reads the HTTP status code and up to 1 KB of the body
+static int read_response(WiFiClientSecure &client, String &body) {
+    String status = client.readStringUntil('\n');
+    while (client.connected() || client.available()) {
+        String line = client.readStringUntil('\n');
+        if (line == "\r" || line == "") break;
+    }
+    const uint32_t start = millis();
+    while ((client.connected() || client.available()) && body.length() <= 1024 && millis() - start < 10000) {
+        if (client.available()) body.concat((char)client.read());
+        else vTaskDelay(1);
+    }
+    // "HTTP/1.1 200 OK"
+    const int space = status.indexOf(' ');
+    return space > 0 ? status.substring(space + 1).toInt() : 0;
+}
+
+WigleSendResult Wigle::_send_part(
+    const char *name, const uint8_t *header, size_t headerLen, File &file, uint32_t offset, uint32_t length
+) {
     WiFiClientSecure client;
     client.setInsecure();
-    if (!client.connect(host, 443)) {
-        displayError("Wigle API connection failed", true);
-        return false;
-    }
+    if (!client.connect(host, 443)) return WIGLE_SEND_FAILED;
 
-    String filename = file.name();
-    int filesize = file.size();
     String boundary = "BRUCE";
     boundary.concat(esp_random());
 
-    send_upload_headers(client, filename, filesize, boundary);
+    send_upload_headers(client, name, headerLen + length, boundary);
+    if (client.write(header, headerLen) != headerLen) {
+        client.stop();
+        return WIGLE_SEND_FAILED;
+    }
 
     byte cbuf[CBUFLEN];
-    float percent = 0;
-    while (file.available()) {
-        long bytes_available = file.available();
-        int toread = CBUFLEN;
-        if (bytes_available < CBUFLEN) toread = bytes_available;
-        file.read(cbuf, toread);
-        client.write(cbuf, toread);
-        percent = ((float)file.position() / (float)file.size()) * 100;
-        progressHandler(percent, 100, upload_message);
+    file.seek(offset);
+    uint32_t sent = 0;
+    while (sent < length) {
+        const size_t toread = length - sent < CBUFLEN ? length - sent : CBUFLEN;
+        if (file.read(cbuf, toread) != toread || client.write(cbuf, toread) != toread) {
+            client.stop();
+            return WIGLE_SEND_FAILED;
+        }
+        sent += toread;
+        progressHandler(((float)(offset + sent) / (float)file.size()) * 100, 100, progress_message);
     }
 
     client.println();
@@ -222,20 +366,73 @@ bool Wigle::_upload_file(File file, String upload_message) {
     client.println();
     client.flush();
 
-    Serial.println("File transfer complete");
+    Serial.println("Part transfer complete: " + String(name));
 
     String serverres = "";
+    const int status = read_response(client, serverres);
+    client.stop();
 
-    while (client.connected()) {
-        if (client.available()) {
-            char c = client.read();
-            // Serial.write(c);
-            serverres.concat(c);
-        }
-        if (serverres.length() > 1024) break;
+    if (serverres.indexOf("\"success\":true") > -1) return WIGLE_SEND_OK;
+    if (status == 401 || status == 403) return WIGLE_SEND_REJECTED;
+    return WIGLE_SEND_FAILED;
+}
+
+// Feeds one page of the account's uploads to scan, false when there is no answer
+bool Wigle::_scan_transactions(uint32_t pageStart, WigleTransactionScan &scan) {
+    WiFiClientSecure client;
+    client.setInsecure();
+    if (!client.connect(host, 443)) return false;
+
+    client.print("GET /api/v2/file/transactions?pagestart=");
+    client.print(pageStart);
+    client.print("&pageend=");
+    client.print(pageStart + WIGLE_TRANSACTIONS_PAGE);
+    client.println(" HTTP/1.0");
+    client.print("Host: ");
+    client.println(host);
+    client.println("Connection: close");
+    client.println("User-Agent: bruce.wardriving");
+    client.print("Authorization: ");
+    client.println(auth_header);
+    client.println();
+
+    String status = client.readStringUntil('\n');
+    if (status.indexOf(" 200") < 0) {
+        client.stop();
+        return false;
     }
 
+    // Streamed through the whole body, it can be larger than the heap can hold
+    bool complete = false;
+    const uint32_t start = millis();
+    while (millis() - start < 15000) {
+        if (!client.available()) {
+            if (!client.connected()) {
+                complete = true;
+                break;
+            }
+            vTaskDelay(1);
+            continue;
+        }
+        scan.feed(client.read());
+        if (scan.found()) {
+            complete = true;
+            break;
+        }
+    }
     client.stop();
+    return complete;
+}
 
-    return (serverres.indexOf("\"success\":true") > -1);
+// Looks for the part in the uploads of the account, newest first, a page at a time until it shows
+// up or the list ends: 1 found, 0 not, -1 no answer
+int Wigle::_part_landed(const char *name) {
+    WigleTransactionScan scan(name);
+    for (uint32_t page = 0; page < WIGLE_LANDED_MAX_PAGES; page++) {
+        scan.nextPage();
+        if (!_scan_transactions(page * WIGLE_TRANSACTIONS_PAGE, scan)) return -1;
+        if (scan.found()) return 1;
+        if (scan.entries() < WIGLE_TRANSACTIONS_PAGE) return 0;
+    }
+    return 0;
 }
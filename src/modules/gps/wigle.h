@@ -8,6 +8,7 @@
 #ifndef __WIGLE_H__
 #define __WIGLE_H__
 
+#include "wigle_upload_queue.h"
 #include <WiFiClientSecure.h>
 #include <globals.h>
 
@@ -30,12 +31,29 @@ public:
     void dump_wigle_info(void);
 
 private:
+    friend struct WigleTransport;
+
     String wigle_user;
     String auth_header;
     const char *host = "api.wigle.net";
+    WigleUploadQueue queue;
+    String progress_message;
 
     bool _check_token(void);
-    bool _upload_file(File file, String upload_message);
+    void _load_queue(FS *fs);
+    void _save_queue(FS *fs);
+    int _run_queue(FS *fs, const String &only, bool auto_delete);
+    bool _wait_backoff(uint16_t attempts);
+    WigleSendResult _send_part(
+        const char *name,
+        const uint8_t *header,
+        size_t headerLen,
+        File &file,
+        uint32_t offset,
+        uint32_t length
+    );
+    bool _scan_transactions(uint32_t pageStart, WigleTransactionScan &scan);
+    int _part_landed(const char *name);
 };
 
 #endif
@@ -0,0 +1,314 @@
+#ifndef __WIGLE_UPLOAD_QUEUE_H__
+#define __WIGLE_UPLOAD_QUEUE_H__
+// Resumable Wigle uploads. Each queued CSV is sent in parts of at most WIGLE_PART_MAX_BYTES that
+// end on a row boundary and repeat the two WigleWifi header lines, so every part is a valid upload
+// on its own. The queue remembers per file how far the upload got and which part is in flight; it
+// is saved before and after every part, so a dropped connection or a reboot resumes at that part. A
+// part whose outcome is unknown (sent, no answer) is looked up on the server by its name before it
+// is sent again, and is only sent again once the server says it is not there, which keeps rows from
+// being uploaded twice. Plain C++ so the queue, the splitting and the retry policy can be driven
+// from a host with a fake server.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t WIGLE_QUEUE_MAX_FILES = 32;
+const uint32_t WIGLE_PART_MAX_BYTES = 256 * 1024;
+const size_t WIGLE_HEADER_MAX = 512;
+const uint32_t WIGLE_TRANSACTIONS_PAGE = 100;
+
+struct WigleQueueEntry {
+    char path[96] = {0};
+    uint32_t size = 0;       // file size last seen
+    uint32_t offset = 0;     // everything before it is on the server (header excluded)
+    uint32_t pendingEnd = 0; // end of the part in flight, 0 when none
+    uint16_t parts = 0;      // parts uploaded
+    uint16_t attempts = 0;   // failures in a row on the current part
+
+    bool done() const { return offset > 0 && pendingEnd == 0 && offset >= size; }
+};
+
+enum WigleSendResult : uint8_t {
+    WIGLE_SEND_OK,
+    WIGLE_SEND_FAILED,   // connection or server error, the part may or may not have landed
+    WIGLE_SEND_REJECTED, // the server refused it for good (bad token, bad file)
+};
+
+enum WigleStepResult : uint8_t {
+    WIGLE_STEP_PART_DONE,
+    WIGLE_STEP_FILE_DONE,
+    WIGLE_STEP_RETRY, // wait backoffMs(attempts) and step again
+    WIGLE_STEP_REJECTED,
+    WIGLE_STEP_BAD_FILE, // no WigleWifi header
+};
+
+class WigleUploadQueue {
+public:
+    static const uint32_t BACKOFF_BASE_MS = 2000;
+    static const uint32_t BACKOFF_MAX_MS = 5 * 60 * 1000;
+
+    // Delay before the next try after `attempts` failures in a row
+    static uint32_t backoffMs(uint16_t attempts) {
+        if (attempts == 0) return 0;
+        uint32_t ms = BACKOFF_BASE_MS;
+        for (uint16_t i = 1; i < attempts && ms < BACKOFF_MAX_MS; ++i) ms *= 2;
+        return ms < BACKOFF_MAX_MS ? ms : BACKOFF_MAX_MS;
+    }
+
+    size_t count() const { return count_; }
+    WigleQueueEntry &at(size_t i) { return entries_[i]; }
+    const WigleQueueEntry &at(size_t i) const { return entries_[i]; }
+    void clear() { count_ = 0; }
+
+    int find(const char *path) const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (strcmp(entries_[i].path, path) == 0) return (int)i;
+        }
+        return -1;
+    }
+
+    // Queues a file or refreshes its size. A file that shrank was replaced and starts over.
+    // nullptr when the queue is full or the path too long.
+    WigleQueueEntry *add(const char *path, uint32_t size) {
+        const int idx = find(path);
+        if (idx >= 0) {
+            WigleQueueEntry &e = entries_[idx];
+            if (size < e.size || size < e.offset) e = fresh(path);
+            e.size = size;
+            return &e;
+        }
+        if (count_ >= WIGLE_QUEUE_MAX_FILES || strlen(path) >= sizeof(entries_[0].path)) return nullptr;
+        WigleQueueEntry &e = entries_[count_++];
+        e = fresh(path);
+        e.size = size;
+        return &e;
+    }
+
+    void remove(size_t i) {
+        if (i >= count_) return;
+        memmove(&entries_[i], &entries_[i + 1], (count_ - i - 1) * sizeof(WigleQueueEntry));
+        count_--;
+    }
+
+    // One line per file: "offset pendingEnd parts attempts size path". Returns the length, 0 when
+    // buf is too small.
+    size_t serialize(char *buf, size_t size) const {
+        size_t used = 0;
+        int n = snprintf(buf, size, "# wigle upload queue v1\n");
+        if (n < 0 || (size_t)n >= size) return 0;
+        used = n;
+        for (size_t i = 0; i < count_; ++i) {
+            const WigleQueueEntry &e = entries_[i];
+            n = snprintf(
+                buf + used,
+                size - used,
+                "%lu %lu %u %u %lu %s\n",
+                (unsigned long)e.offset,
+                (unsigned long)e.pendingEnd,
+                e.parts,
+                e.attempts,
+                (unsigned long)e.size,
+                e.path
+            );
+            if (n < 0 || (size_t)n >= size - used) return 0;
+            used += n;
+        }
+        return used;
+    }
+
+    // Replaces the queue with a saved one, skipping lines it cannot read
+    void parse(const char *text, size_t len) {
+        count_ = 0;
+        size_t pos = 0;
+        while (pos < len && count_ < WIGLE_QUEUE_MAX_FILES) {
+            size_t end = pos;
+            while (end < len && text[end] != '\n') end++;
+            char line[160];
+            const size_t n = end - pos < sizeof(line) - 1 ? end - pos : sizeof(line) - 1;
+            memcpy(line, text + pos, n);
+            line[n] = '\0';
+            pos = end + 1;
+            if (n > 0 && line[n - 1] == '\r') line[n - 1] = '\0';
+            if (line[0] == '#' || line[0] == '\0') continue;
+
+            WigleQueueEntry e;
+            char *p = line;
+            unsigned long v[5];
+            bool ok = true;
+            for (int f = 0; f < 5 && ok; ++f) {
+                char *next;
+                v[f] = strtoul(p, &next, 10);
+                ok = next != p && *next == ' ';
+                p = next + 1;
+            }
+            if (!ok || *p == '\0' || strlen(p) >= sizeof(e.path)) continue;
+            e.offset = v[0];
+            e.pendingEnd = v[1];
+            e.parts = v[2];
+            e.attempts = v[3];
+            e.size = v[4];
+            strcpy(e.path, p);
+            entries_[count_++] = e;
+        }
+    }
+
+private:
+    static WigleQueueEntry fresh(const char *path) {
+        WigleQueueEntry e;
+        strncpy(e.path, path, sizeof(e.path) - 1);
+        return e;
+    }
+
+    WigleQueueEntry entries_[WIGLE_QUEUE_MAX_FILES];
+    size_t count_ = 0;
+};
+
+// Name a part is uploaded under: file name without extension, the start offset, ".csv". Stable
+// for a given part, which is what lets an unanswered upload be looked up later.
+inline void wiglePartName(char *buf, size_t size, const char *path, uint32_t offset) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char *dot = strrchr(base, '.');
+    const int baseLen = dot ? (int)(dot - base) : (int)strlen(base);
+    snprintf(buf, size, "%.*s_%lu.csv", baseLen, base, (unsigned long)offset);
+}
+
+// Scans one page of the account's upload list (/api/v2/file/transactions) as it streams in: counts
+// the uploads on it and looks for a part by name, without holding the body
+class WigleTransactionScan {
+public:
+    explicit WigleTransactionScan(const char *name) {
+        snprintf(needle_, sizeof(needle_), "\"fileName\":\"%s\"", name);
+    }
+
+    void feed(char c) {
+        if (match(c, needle_, matched_)) found_ = true;
+        if (match(c, ENTRY, entryMatched_)) entries_++;
+    }
+
+    // Keeps found(), starts counting entries over
+    void nextPage() {
+        matched_ = 0;
+        entryMatched_ = 0;
+        entries_ = 0;
+    }
+
+    bool found() const { return found_; }
+    uint32_t entries() const { return entries_; }
+
+private:
+    static constexpr const char *ENTRY = "\"transid\":";
+
+    // Both needles open with a quote, so a mismatch restarts at it
+    static bool match(char c, const char *needle, size_t &matched) {
+        if (c == needle[matched]) matched++;
+        else matched = c == needle[0] ? 1 : 0;
+        if (needle[matched] != '\0') return false;
+        matched = 0;
+        return true;
+    }
+
+    char needle_[160];
+    size_t matched_ = 0;
+    size_t entryMatched_ = 0;
+    uint32_t entries_ = 0;
+    bool found_ = false;
+};
+
+// Reads the two WigleWifi header lines. Returns their length, 0 when the file does not start with
+// them. FileT needs seek(pos) and read(uint8_t *, size_t), like fs::File.
+template <typename FileT> size_t wigleReadHeader(FileT &file, uint8_t *header, size_t max) {
+    file.seek(0);
+    const size_t n = file.read(header, max);
+    if (n < 12 || memcmp(header, "WigleWifi-", 10) != 0) return 0;
+    int lines = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (header[i] == '\n' && ++lines == 2) return i + 1;
+    }
+    return 0;
+}
+
+// End of the part starting at offset: at most maxBytes on, moved back to just after the last
+// complete row. Returns offset when there is no complete row.
+template <typename FileT>
+uint32_t wiglePartEnd(FileT &file, uint32_t offset, uint32_t size, uint32_t maxBytes) {
+    uint32_t limit = size - offset > maxBytes ? offset + maxBytes : size;
+    uint8_t buf[256];
+    uint32_t pos = limit;
+    while (pos > offset) {
+        const uint32_t start = pos - offset > sizeof(buf) ? pos - sizeof(buf) : offset;
+        file.seek(start);
+        const size_t n = file.read(buf, pos - start);
+        if (n != pos - start) return offset;
+        for (size_t i = n; i > 0; --i) {
+            if (buf[i - 1] == '\n') return start + i;
+        }
+        pos = start;
+    }
+    return offset;
+}
+
+// One unit of work on a queued file: confirms or resends the part in flight, or sends the next
+// one. persist() is called whenever the entry changed and must save the queue before returning.
+// TransportT needs
+//   WigleSendResult send(const char *name, const uint8_t *header, size_t headerLen, FileT &file,
+//                        uint32_t offset, uint32_t length)
+//   int landed(const char *name) // 1 on the server, 0 not, -1 cannot tell (retried, never resent)
+template <typename FileT, typename TransportT, typename PersistFn>
+WigleStepResult wigleUploadStep(
+    WigleQueueEntry &e, FileT &file, TransportT &transport, uint32_t maxPartBytes, PersistFn persist
+) {
+    uint8_t header[WIGLE_HEADER_MAX];
+    const size_t headerLen = wigleReadHeader(file, header, sizeof(header));
+    if (headerLen == 0) return WIGLE_STEP_BAD_FILE;
+    if (e.offset < headerLen) e.offset = headerLen;
+
+    char name[128];
+    wiglePartName(name, sizeof(name), e.path, e.offset);
+    if (e.pendingEnd != 0) {
+        const int landed = transport.landed(name);
+        if (landed == 1) {
+            e.offset = e.pendingEnd;
+            e.pendingEnd = 0;
+            e.parts++;
+            e.attempts = 0;
+            persist();
+            return e.offset >= e.size ? WIGLE_STEP_FILE_DONE : WIGLE_STEP_PART_DONE;
+        }
+        if (landed != 0) {
+            // it may be on the server, sending it again could upload its rows twice
+            e.attempts++;
+            persist();
+            return WIGLE_STEP_RETRY;
+        }
+    } else {
+        if (e.offset >= e.size) return WIGLE_STEP_FILE_DONE;
+        const uint32_t end = wiglePartEnd(file, e.offset, e.size, maxPartBytes - headerLen);
+        if (end <= e.offset) {
+            // only a row cut short by a power loss is left, it would not import anyway
+            e.offset = e.size;
+            persist();
+            return WIGLE_STEP_FILE_DONE;
+        }
+        e.pendingEnd = end;
+        persist();
+    }
+
+    const WigleSendResult r =
+        transport.send(name, header, headerLen, file, e.offset, e.pendingEnd - e.offset);
+    if (r == WIGLE_SEND_OK) {
+        e.offset = e.pendingEnd;
+        e.pendingEnd = 0;
+        e.parts++;
+        e.attempts = 0;
+        persist();
+        return e.offset >= e.size ? WIGLE_STEP_FILE_DONE : WIGLE_STEP_PART_DONE;
+    }
+    e.attempts++;
+    persist();
+    return r == WIGLE_SEND_REJECTED ? WIGLE_STEP_REJECTED : WIGLE_STEP_RETRY;
+}
+
+#endif
@@ -10,6 +10,7 @@ Thanks to @bmorcelli (Pirata) for his help doing a better code.
 */
 
 #include "pwngrid.h"
+#include "../wifi/frame_bus.h"
 #include "../wifi/sniffer.h"
 #include "core/wifi/wifi_common.h"
 
@@ -204,106 +205,43 @@ signed int getPwngridClosestRssi() {
 // Detect pwnagotchi adapted from Marauder
 // https://github.com/justcallmekoko/ESP32Marauder/wiki/detect-pwnagotchi
 // https://github.com/justcallmekoko/ESP32Marauder/blob/master/esp32_marauder/WiFiScan.cpp#L2255
-typedef struct {
-    int16_t fctl;
-    int16_t duration;
-    uint8_t da;
-    uint8_t sa;
-    uint8_t bssid;
-    int16_t seqctl;
-    unsigned char payload[];
-} __attribute__((packed)) WifiMgmtHdr;
-
-typedef struct {
-    uint8_t payload[0];
-    WifiMgmtHdr hdr;
-} wifi_ieee80211_packet_t;
-
-void getMAC(char *addr, uint8_t *data, uint16_t offset) {
-    sprintf(
-        addr,
-        "%02x:%02x:%02x:%02x:%02x:%02x",
-        data[offset + 0],
-        data[offset + 1],
-        data[offset + 2],
-        data[offset + 3],
-        data[offset + 4],
-        data[offset + 5]
-    );
-}
-
-void pwnSnifferCallback(void *buf, wifi_promiscuous_pkt_type_t type) {
-    sniffer(buf, type);
-    wifi_promiscuous_pkt_t *snifferPacket = (wifi_promiscuous_pkt_t *)buf;
-    WifiMgmtHdr *frameControl = (WifiMgmtHdr *)snifferPacket->payload;
-
-    const uint8_t *frame = snifferPacket->payload;
-    const uint16_t frameCtrl = (uint16_t)frame[0] | ((uint16_t)frame[1] << 8);
-    const uint8_t frameType = (frameCtrl & 0x0C) >> 2;
-    const uint8_t frameSubType = (frameCtrl & 0xF0) >> 4;
-
-    if (frameType == 0x00 && frameSubType == 0x08) {
-        const uint8_t *addr1 = snifferPacket->payload + 4;  // Adresse du destinataire (Adresse 1)
-        const uint8_t *addr2 = snifferPacket->payload + 10; // Adresse de l'expéditeur (Adresse 2)
-        const uint8_t *bssid = snifferPacket->payload + 16; // Adresse BSSID (Adresse 3)
-        const uint8_t *apAddr;
-
-        if (memcmp(addr1, bssid, 6) == 0) {
-            apAddr = addr1;
-        } else {
-            apAddr = addr2;
-        }
-        BeaconList Beacon;
-        memcpy(Beacon.MAC, apAddr, 6);
-        Beacon.channel = ch;
-        if (registeredBeacons.find(Beacon) == registeredBeacons.end()) {
-            registeredBeacons.insert(Beacon); // Save a new MAC to Deauth
-        }
-    }
-
-    String src = "";
+static const uint8_t PWNAGOTCHI_BEACON_SRC[6] = {0xde, 0xad, 0xbe, 0xef, 0xde, 0xad};
+
+// Beacon subscriber on the frame bus. The sniffer subscriber already registers every beacon
+// for the deauth list, so only the pwnagotchi advertisement is handled here.
+static void pwnOnBeacon(
+    const WifiFrameDesc &frame, const wifi_promiscuous_pkt_t *pkt, wifi_promiscuous_pkt_type_t type
+) {
+    if (type != WIFI_PKT_MGMT || frame.frame[0] != 0x80) return;
+    if (memcmp(frame.addr2, PWNAGOTCHI_BEACON_SRC, 6) != 0) return;
+
+    // Remove frame check sequence bytes
+    int len = frame.len - 4;
     String essid = "";
+    // Just grab the first 255 bytes of the pwnagotchi beacon
+    // because that is where the name is
+    for (int i = 38; i < len; i++) {
+        if (isAscii(frame.frame[i])) { essid.concat((char)frame.frame[i]); }
+    }
 
-    if (type == WIFI_PKT_MGMT) {
-        // Remove frame check sequence bytes
-        int len = snifferPacket->rx_ctrl.sig_len - 4;
-        int fctl = ntohs(frameControl->fctl);
-        const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)snifferPacket->payload;
-        const WifiMgmtHdr *hdr = &ipkt->hdr;
-
-        // if ((snifferPacket->payload[0] == 0x80) && (buf == 0)) {
-        if ((snifferPacket->payload[0] == 0x80)) {
-            char addr[] = "00:00:00:00:00:00";
-            getMAC(addr, snifferPacket->payload, 10);
-            src.concat(addr);
-            if (src == "de:ad:be:ef:de:ad") {
-                // Just grab the first 255 bytes of the pwnagotchi beacon
-                // because that is where the name is
-                for (int i = 38; i < len; i++) {
-                    if (isAscii(snifferPacket->payload[i])) { essid.concat((char)snifferPacket->payload[i]); }
-                }
-
-                JsonDocument sniffed_json; // ArduinoJson v6s
-                DeserializationError result = deserializeJson(sniffed_json, essid);
-
-                if (result == DeserializationError::Ok) {
-                    // Serial.println("\nSuccessfully parsed json");
-                    // serializeJson(json, Serial);  // ArduinoJson v6
-                    add_new_peer(sniffed_json, snifferPacket->rx_ctrl.rssi);
-                } else if (result == DeserializationError::IncompleteInput) {
-                    Serial.println("Deserialization error: incomplete input");
-                } else if (result == DeserializationError::NoMemory) {
-                    Serial.println("Deserialization error: no memory");
-                } else if (result == DeserializationError::InvalidInput) {
-                    Serial.println("Deserialization error: invalid input");
-                } else if (result == DeserializationError::TooDeep) {
-                    Serial.println("Deserialization error: too deep");
-                } else {
-                    Serial.println(essid);
-                    Serial.println("Deserialization error");
-                }
-            }
-        }
+    JsonDocument sniffed_json; // ArduinoJson v6s
+    DeserializationError result = deserializeJson(sniffed_json, essid);
+
+    if (result == DeserializationError::Ok) {
+        // Serial.println("\nSuccessfully parsed json");
+        // serializeJson(json, Serial);  // ArduinoJson v6
+        add_new_peer(sniffed_json, frame.rssi);
+    } else if (result == DeserializationError::IncompleteInput) {
+        Serial.println("Deserialization error: incomplete input");
+    } else if (result == DeserializationError::NoMemory) {
+        Serial.println("Deserialization error: no memory");
+    } else if (result == DeserializationError::InvalidInput) {
+        Serial.println("Deserialization error: invalid input");
+    } else if (result == DeserializationError::TooDeep) {
+        Serial.println("Deserialization error: too deep");
+    } else {
+        Serial.println(essid);
+        Serial.println("Deserialization error");
     }
 }
 
@@ -320,8 +258,15 @@ void initPwngrid() {
     esp_wifi_start();
     esp_wifi_set_promiscuous_filter(&filter);
     esp_wifi_set_promiscuous(true);
-    esp_wifi_set_promiscuous_rx_cb(pwnSnifferCallback);
+    frame_bus_subscribe(pwnOnBeacon, WIFI_FRAME_BEACON);
+    sniffer_attach();
     // esp_wifi_set_ps(WIFI_PS_NONE);
     esp_wifi_set_channel(random(0, 14), WIFI_SECOND_CHAN_NONE);
     vTaskDelay(1 / portTICK_RATE_MS);
 }
+
+void stopPwngrid() {
+    frame_bus_unsubscribe(pwnOnBeacon);
+    sniffer_detach();
+    sniffer_release_backend();
+}
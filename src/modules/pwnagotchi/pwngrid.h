@@ -31,6 +31,7 @@ typedef struct {
 } pwngrid_peer;
 
 void initPwngrid();
+void stopPwngrid();
 esp_err_t pwngridAdvertise(uint8_t channel, String face);
 std::vector<pwngrid_peer> getPwngridPeers();
 uint8_t getPwngridRunTotalPeers();
@@ -1,4 +1,5 @@
 #include "emit.h"
+#include "modules/rf/raw_stream.h"
 #include "modules/rf/rf_utils.h" // for initRfModule
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
 #include <freertos/FreeRTOS.h>
@@ -10,6 +11,10 @@ volatile bool selPressed = false;
 volatile bool escPressed = false;
 volatile float frequency = 0.0;
 
+// Gaps longer than this are waited out in steps so the buttons are still read
+#define RAW_EMIT_WAIT_US 20000
+#define RAW_EMIT_FILE_RING 1024 // durations read ahead of the spill file
+
 // Task handle for the periodic task
 TaskHandle_t rf_raw_emit_draw_handle = NULL;
 
@@ -31,7 +36,6 @@ void rf_raw_emit_draw(void *parameter) {
         previousMillis = millis(); // Prevent screen power-saving
 
         rssiCount = static_cast<uint16_t>(rssiCount + 1);
-        if (rssiCount >= 200) selPressed = true; // Stop the emission after 20 seconds
 
         // Check for button presses
         if (check(SelPress)) selPressed = true;
@@ -46,8 +50,15 @@ void rf_raw_emit_draw(void *parameter) {
         int rssi = outputState ? -45 : -90; // Use outputState to determine RSSI
         int barHeight = map(rssi, -90, -45, 1, maxBarHeight);
 
-        // Calculate bar position
+        // Calculate bar position, starting over at the left once the screen is full
         int x = 20 + (int)(rssiCount * 1.35);
+        if (x >= tftWidth - 20) {
+            tft.fillRect(
+                20, centerY - maxBarHeight, tftWidth - 40, maxBarHeight * 2 + 1, bruceConfig.bgColor
+            );
+            rssiCount = 0;
+            x = 20;
+        }
         int yTop = centerY - barHeight;
 
         // Draw the bar
@@ -75,28 +86,59 @@ void rf_raw_emit(RawRecording &recorded, bool &returnToMenu) {
     // Larger stack prevents stack canary resets while drawing
     xTaskCreate(rf_raw_emit_draw, "RawEmitDraw", 4096, NULL, 1, &rf_raw_emit_draw_handle);
 
-    for (size_t i = 0; i < recorded.codes.size(); ++i) {
-        // Send the RMT code
-        for (int j = 0; j < recorded.codeLengths[i]; j++) {
-            outputState = true;
-            if (recorded.codes[i][j].level0 == 1) digitalWrite(txPin, HIGH);
-            else digitalWrite(txPin, LOW);
-            delayMicroseconds(recorded.codes[i][j].duration0);
-            if (recorded.codes[i][j].level1 == 1) digitalWrite(txPin, HIGH);
-            else digitalWrite(txPin, LOW);
-            delayMicroseconds(recorded.codes[i][j].duration1);
-            if (selPressed || escPressed) break;
-        }
-        outputState = false;
-        if (i < recorded.codes.size() - 1) {
+    // One duration of RAW_Data: high when positive, low when negative
+    auto emit = [&](int32_t d) {
+        outputState = d > 0;
+        digitalWrite(txPin, d > 0 ? HIGH : LOW);
+        uint32_t us = d > 0 ? d : -(int64_t)d;
+        if (us <= RAW_EMIT_WAIT_US) {
+            delayMicroseconds(us);
+        } else {
             unsigned long startTime = millis();
-            while (millis() - startTime < recorded.gaps[i]) {
+            while (millis() - startTime < us / 1000) {
                 delay(10); // Small delay to avoid busy-waiting
                 if (selPressed || escPressed) break;
             }
         }
-        if (selPressed || escPressed) break;
+        return !(selPressed || escPressed);
+    };
+
+    if (recorded.spillFs) {
+        // The arena spilled, the whole recording is in the file
+        File file = recorded.spillFs->open(recorded.spillPath, FILE_READ);
+        RawTxStream<RAW_EMIT_FILE_RING> *stream = new (std::nothrow) RawTxStream<RAW_EMIT_FILE_RING>();
+        if (file && stream) {
+            while (stream->pump(file)) {}
+            bool running = true;
+            while (running) {
+                int32_t d;
+                if (!stream->pop(d)) {
+                    if (stream->done()) break;
+                    stream->pump(file); // ran dry inside a frame
+                    continue;
+                }
+                if (d == RAW_STREAM_LINE_END) continue;
+                if (d < -RAW_EMIT_WAIT_US) {
+                    // Read ahead in the silence between frames, not in the middle of one
+                    digitalWrite(txPin, LOW);
+                    outputState = false;
+                    const unsigned long readStart = micros();
+                    while (stream->pump(file)) {}
+                    d += (int32_t)(micros() - readStart);
+                    if (d >= 0) continue;
+                }
+                running = emit(d);
+            }
+        } else {
+            Serial.println("RAW replay: cannot read " + recorded.spillPath);
+        }
+        delete stream;
+        if (file) file.close();
+    } else {
+        recorded.arena.forEach(emit);
     }
+    digitalWrite(txPin, LOW);
+    outputState = false;
 
     // Stop the FreeRTOS task
     if (rf_raw_emit_draw_handle != NULL) {
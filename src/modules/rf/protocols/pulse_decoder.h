@@ -0,0 +1,383 @@
+#pragma once
+// Decodes a RAW capture against a table of fixed-code protocols. The durations are clustered into
+// a histogram first; a protocol is only tried with a te (its short pulse) that a cluster backs up
+// together with the protocol's long pulse, so most of the table is ruled out without touching the
+// capture. The capture is then read as frames of pilot, bits and stop, and every protocol that
+// decodes gets a candidate with a confidence from the timing fit and how many repeats agree.
+// Plain C++ so it can run over a corpus of captures off-target.
+#include <initializer_list>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+const uint8_t PULSE_HIST_MAX = 16;          // distinct durations the histogram keeps
+const uint8_t PULSE_FRAMES_MAX = 32;        // frames a protocol keeps for the repeat vote
+const int32_t PULSE_GLITCH_US = 60;         // shorter pulses are noise, merged into their neighbours
+const int8_t PULSE_GAP_TE = 8;              // elements this many te or longer are gaps: lower bound only
+const float PULSE_TOLERANCE = 0.35f;        // relative error a pulse may have against k * te
+const float PULSE_CLUSTER_TOLERANCE = 0.2f; // relative width of a histogram cluster
+const int32_t PULSE_CLUSTER_MIN_US = 40;    // ... but never narrower than this
+
+// Timings in te, the sign is the level (high when positive), 0 is no element. Same shapes as the
+// c_rf_protocol tables the bruteforce sends.
+struct PulseProtocol {
+    const char *name;
+    uint16_t te;           // nominal short pulse, us
+    uint16_t teMin, teMax; // te the protocol is tried with
+    int8_t pilot[2];       // before the bits
+    int8_t zero[2];
+    int8_t one[2];
+    int8_t stop[2]; // after the bits
+    uint8_t minBits, maxBits;
+};
+
+static const PulseProtocol PULSE_PROTOCOLS[] = {
+    {"CAME",        320, 250, 375, {-36, 1}, {-1, 2}, {-2, 1}, {0, 0},    12, 24},
+    {"Nice FLO",    700, 600, 820, {-36, 1}, {-1, 2}, {-2, 1}, {0, 0},    12, 24},
+    {"Ansonic",     555, 460, 640, {-35, 1}, {-2, 1}, {-1, 2}, {0, 0},    12, 12},
+    {"Holtek",      430, 375, 520, {-36, 1}, {-2, 1}, {-1, 2}, {0, 0},    12, 40},
+    {"Linear",      500, 400, 600, {0, 0},   {1, -3}, {3, -1}, {0, -43},  10, 10},
+    {"Chamberlain", 430, 360, 520, {0, 0},   {-2, 1}, {-1, 2}, {-7, 2},   7,  10},
+    {"Liftmaster",  400, 330, 470, {0, 0},   {-2, 1}, {-1, 2}, {0, 0},    9,  12},
+    {"Princeton",   350, 100, 700, {0, 0},   {1, -3}, {3, -1}, {1, -31},  12, 32},
+    {"RcSwitch 2",  650, 500, 800, {0, 0},   {1, -2}, {2, -1}, {1, -10},  8,  32},
+};
+
+const size_t PULSE_PROTOCOL_COUNT = sizeof(PULSE_PROTOCOLS) / sizeof(PULSE_PROTOCOLS[0]);
+
+struct PulseCluster {
+    int32_t center; // mean duration, us
+    uint32_t count;
+    uint32_t highs; // how many of them were high
+    int64_t sum;
+};
+
+// Absolute durations grouped by nearness, sorted by center once built
+class PulseHistogram {
+public:
+    void clear() { size_ = 0; }
+
+    void add(int32_t d) {
+        const int32_t a = abs(d);
+        int best = -1;
+        int32_t bestDiff = 0;
+        for (uint8_t i = 0; i < size_; i++) {
+            const int32_t diff = abs(clusters_[i].center - a);
+            if (best < 0 || diff < bestDiff) {
+                best = i;
+                bestDiff = diff;
+            }
+        }
+        if (best < 0 || (!near(clusters_[best].center, a) && size_ < PULSE_HIST_MAX)) {
+            clusters_[size_++] = {a, 1, d > 0 ? 1u : 0u, a};
+            return;
+        }
+        // full: the nearest cluster takes it
+        PulseCluster &c = clusters_[best];
+        c.count++;
+        c.highs += d > 0;
+        c.sum += a;
+        c.center = c.sum / c.count;
+    }
+
+    void sort() {
+        for (uint8_t i = 1; i < size_; i++) {
+            const PulseCluster c = clusters_[i];
+            uint8_t j = i;
+            for (; j > 0 && clusters_[j - 1].center > c.center; j--) clusters_[j] = clusters_[j - 1];
+            clusters_[j] = c;
+        }
+    }
+
+    // The cluster within tolerance of us, -1 when none
+    int find(float us) const {
+        for (uint8_t i = 0; i < size_; i++) {
+            if (near(clusters_[i].center, us)) return i;
+        }
+        return -1;
+    }
+
+    uint8_t size() const { return size_; }
+    const PulseCluster &operator[](uint8_t i) const { return clusters_[i]; }
+
+private:
+    static bool near(float center, float us) {
+        float tol = center * PULSE_CLUSTER_TOLERANCE;
+        if (tol < PULSE_CLUSTER_MIN_US) tol = PULSE_CLUSTER_MIN_US;
+        return fabsf(center - us) <= tol;
+    }
+
+    PulseCluster clusters_[PULSE_HIST_MAX];
+    uint8_t size_ = 0;
+};
+
+struct PulseCandidate {
+    const PulseProtocol *protocol;
+    uint64_t key; // first bit received in the most significant used bit
+    uint8_t bits;
+    uint16_t te;        // us, as measured
+    uint8_t frames;     // repeats that decoded to key
+    uint8_t confidence; // 0..100
+};
+
+class PulseDecoder {
+public:
+    // Candidates for durations (signed, high when positive, as RAW_Data holds them; a 0 ends them),
+    // best first. Returns how many were written to out.
+    size_t decode(const int32_t *durations, size_t count, PulseCandidate *out, size_t maxOut) {
+        normalize(durations, count);
+        hist_.clear();
+        for (int32_t d : pulses_) hist_.add(d);
+        hist_.sort();
+
+        size_t found = 0;
+        for (size_t p = 0; p < PULSE_PROTOCOL_COUNT; p++) {
+            const PulseProtocol &proto = PULSE_PROTOCOLS[p];
+            PulseCandidate best = {};
+            float tes[2];
+            const size_t n = teCandidates(proto, tes);
+            for (size_t t = 0; t < n; t++) {
+                PulseCandidate c;
+                if (tryProtocol(proto, tes[t], c) && c.confidence > best.confidence) best = c;
+            }
+            if (!best.protocol) continue;
+            // insertion by confidence, the weakest falls off when out is full
+            size_t at = found < maxOut ? found : maxOut;
+            while (at > 0 && out[at - 1].confidence < best.confidence) {
+                if (at < maxOut) out[at] = out[at - 1];
+                at--;
+            }
+            if (at < maxOut) out[at] = best;
+            if (found < maxOut) found++;
+        }
+        return found;
+    }
+
+    const PulseHistogram &histogram() const { return hist_; }
+    const std::vector<int32_t> &pulses() const { return pulses_; }
+
+private:
+    struct Frame {
+        uint64_t key;
+        uint8_t bits;
+    };
+
+    // Same-level runs merged, glitches folded into the pulse they interrupt
+    void normalize(const int32_t *in, size_t count) {
+        pulses_.clear();
+        pulses_.reserve(count);
+        for (size_t r = 0; r < count; r++) {
+            int32_t d = in[r];
+            if (d == 0) break;
+            if (!pulses_.empty() && abs(d) < PULSE_GLITCH_US) {
+                int32_t &prev = pulses_.back();
+                const int32_t sign = prev > 0 ? 1 : -1;
+                prev += sign * abs(d);
+                // the level it interrupted resumes
+                if (r + 1 < count && in[r + 1] != 0 && (in[r + 1] > 0) == (prev > 0)) prev += in[++r];
+                continue;
+            }
+            if (!pulses_.empty() && (pulses_.back() > 0) == (d > 0)) pulses_.back() += d;
+            else pulses_.push_back(d);
+        }
+    }
+
+    static int8_t longest(const PulseProtocol &p) {
+        int8_t k = 1;
+        for (int8_t e : {p.zero[0], p.zero[1], p.one[0], p.one[1]}) {
+            if (abs(e) > k) k = abs(e);
+        }
+        return k;
+    }
+
+    // te values the histogram supports for p: a short cluster in range with its long partner
+    size_t teCandidates(const PulseProtocol &p, float *tes) const {
+        const int8_t k = longest(p);
+        size_t n = 0;
+        uint32_t counts[2] = {0, 0};
+        for (uint8_t i = 0; i < hist_.size(); i++) {
+            const PulseCluster &s = hist_[i];
+            if (s.center < p.teMin || s.center > p.teMax || s.count * 2 < p.minBits) continue;
+            const int l = hist_.find(float(s.center) * k);
+            if (l < 0 || l == i) continue;
+            const PulseCluster &L = hist_[l];
+            const float te = (float(s.sum) + float(L.sum) / k) / float(s.count + L.count);
+            const uint32_t weight = s.count + L.count;
+            // keep the two best supported
+            if (n < 2) {
+                tes[n] = te;
+                counts[n++] = weight;
+            } else if (weight > counts[1]) {
+                tes[1] = te;
+                counts[1] = weight;
+            }
+            if (n == 2 && counts[1] > counts[0]) {
+                const float t = tes[0];
+                tes[0] = tes[1];
+                tes[1] = t;
+                const uint32_t c = counts[0];
+                counts[0] = counts[1];
+                counts[1] = c;
+            }
+        }
+        return n;
+    }
+
+    // Relative error of d against k te, -1 when it does not fit. Gaps only need to be long enough.
+    static float elementError(int32_t d, int8_t k, float te) {
+        if ((d > 0) != (k > 0)) return -1;
+        const float want = abs(k) * te;
+        const float got = abs(d);
+        if (abs(k) >= PULSE_GAP_TE) return got >= want * 0.5f ? 0 : -1;
+        const float diff = fabsf(got - want);
+        return diff <= PULSE_TOLERANCE * want ? diff / want : -1;
+    }
+
+    bool isGap(size_t i, float te) const { return abs(pulses_[i]) >= PULSE_GAP_TE * te; }
+
+    // Matches the elements of pair at j, the end of the capture counting as a match (the last
+    // repeat is often cut). Advances j past what matched.
+    bool matchPair(const int8_t *pair, size_t &j, float te, float &err, uint32_t &elements) const {
+        for (int e = 0; e < 2; e++) {
+            if (pair[e] == 0) continue;
+            if (j >= pulses_.size()) return true;
+            const float x = elementError(pulses_[j], pair[e], te);
+            if (x < 0) return false;
+            if (abs(pair[e]) < PULSE_GAP_TE) {
+                err += x;
+                elements++;
+            }
+            j++;
+        }
+        return true;
+    }
+
+    // One frame starting at i; next is where the following one may start. Starts of the same parity
+    // before dead would read the same bits to the same end, so they fail the same way.
+    bool readFrame(
+        const PulseProtocol &p, float te, size_t i, Frame &f, size_t &next, size_t &dead, float &err,
+        uint32_t &elements
+    ) const {
+        const size_t n = pulses_.size();
+        size_t j = i;
+        dead = i;
+        float e = 0;
+        uint32_t els = 0;
+        if ((p.pilot[0] || p.pilot[1]) && !matchPair(p.pilot, j, te, e, els)) return false;
+
+        f.key = 0;
+        f.bits = 0;
+        // the last bit may run into the gap after the frame, unless the stop has a pulse before it
+        const bool canTrail = p.stop[0] == 0;
+        bool trailing = false;
+        while (f.bits < p.maxBits && j + 1 < n) {
+            const float z0 = elementError(pulses_[j], p.zero[0], te);
+            const float z1 = elementError(pulses_[j + 1], p.zero[1], te);
+            const float o0 = elementError(pulses_[j], p.one[0], te);
+            const float o1 = elementError(pulses_[j + 1], p.one[1], te);
+            const bool zero = z0 >= 0 && z1 >= 0;
+            const bool one = o0 >= 0 && o1 >= 0;
+            int bit;
+            if (zero || one) {
+                bit = one && (!zero || o0 + o1 < z0 + z1);
+                e += bit ? o0 + o1 : z0 + z1;
+                els += 2;
+            } else if (canTrail && isGap(j + 1, te) && (pulses_[j + 1] > 0) == (p.zero[1] > 0) &&
+                       p.zero[0] != p.one[0] && (z0 >= 0) != (o0 >= 0)) {
+                bit = o0 >= 0;
+                e += bit ? o0 : z0;
+                els++;
+                trailing = true;
+            } else {
+                break;
+            }
+            if (f.bits < 64) f.key = (f.key << 1) | bit;
+            f.bits++;
+            j += 2;
+            if (trailing) break;
+        }
+        if (trailing || f.bits < p.maxBits) dead = j;
+        if (f.bits < p.minBits) return false;
+
+        if (p.stop[0] || p.stop[1]) {
+            // a trailing bit already took the stop gap
+            if (!trailing && !matchPair(p.stop, j, te, e, els)) return false;
+        } else if (!trailing && j < n && !isGap(j, te)) {
+            return false;
+        }
+        next = j;
+        err += e;
+        elements += els;
+        return true;
+    }
+
+    bool tryProtocol(const PulseProtocol &p, float te, PulseCandidate &c) const {
+        Frame frames[PULSE_FRAMES_MAX];
+        size_t count = 0;
+        float err = 0;
+        uint32_t elements = 0;
+        // without a pilot or a stop to anchor it, a frame has to start after a gap
+        const bool anchored = p.pilot[0] || p.pilot[1] || p.stop[0] || p.stop[1];
+        // what the first pulse of a frame must look like, checked before reading one
+        const int8_t bit0 = abs(p.zero[0]) < abs(p.one[0]) ? p.zero[0] : p.one[0];
+        const int8_t k0 = p.pilot[0] ? p.pilot[0] : p.pilot[1] ? p.pilot[1] : bit0;
+        const int32_t min0 = int32_t(abs(k0) * te * (abs(k0) >= PULSE_GAP_TE ? 0.5f : 1 - PULSE_TOLERANCE));
+        const size_t n = pulses_.size();
+        size_t dead[2] = {0, 0}; // per start parity
+        size_t first = 0, last = 0, covered = 0;
+        size_t i = 0;
+        bool chained = false; // i follows a decoded frame
+        while (i + p.minBits * 2 <= n && count < PULSE_FRAMES_MAX) {
+            size_t next;
+            const bool start = (anchored || chained || i == 0 || isGap(i - 1, te)) &&
+                               (pulses_[i] > 0) == (k0 > 0) && abs(pulses_[i]) >= min0;
+            if (start && i >= dead[i & 1] &&
+                readFrame(p, te, i, frames[count], next, dead[i & 1], err, elements)) {
+                if (!count) first = i;
+                last = next;
+                covered += next - i;
+                count++;
+                i = next;
+                chained = true;
+                continue;
+            }
+            i++;
+            chained = false;
+        }
+        if (!count) return false;
+
+        // the key most repeats agree on, the longest on a tie (a cut first frame loses its first bits)
+        size_t mode = 0, modeCount = 0;
+        for (size_t a = 0; a < count; a++) {
+            size_t same = 0;
+            for (size_t b = 0; b < count; b++) {
+                same += frames[a].key == frames[b].key && frames[a].bits == frames[b].bits;
+            }
+            if (same > modeCount || (same == modeCount && frames[a].bits > frames[mode].bits)) {
+                mode = a;
+                modeCount = same;
+            }
+        }
+
+        const float fit = elements ? 1 - (err / elements) / PULSE_TOLERANCE : 1;
+        const float repeats = modeCount >= 3 ? 1 : modeCount == 2 ? 0.8f : 0.5f;
+        const float agree = float(modeCount) / count;
+        // frames read out of a longer signal leave most of it between them
+        const float coverage = float(covered) / (last - first);
+        // protocols sharing a shape are told apart by how close te is to theirs
+        float off = fabsf(te - p.te) / (p.teMax - p.teMin);
+        if (off > 1) off = 1;
+        c.protocol = &p;
+        c.key = frames[mode].key;
+        c.bits = frames[mode].bits;
+        c.te = uint16_t(te + 0.5f);
+        c.frames = modeCount;
+        c.confidence = uint8_t(100 * fit * repeats * agree * coverage * (1 - off) + 0.5f);
+        return true;
+    }
+
+    std::vector<int32_t> pulses_;
+    PulseHistogram hist_;
+};
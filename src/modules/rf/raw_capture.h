@@ -0,0 +1,229 @@
+#ifndef __RAW_CAPTURE_H__
+#define __RAW_CAPTURE_H__
+// A RAW recording kept as one ring of signed durations (high when positive, the gaps between
+// received frames as negative ones), the way RAW_Data holds them. The capture task is the only
+// producer and never waits: what does not fit is dropped and counted. The record loop is the only
+// consumer: once the ring fills past a threshold it writes the oldest blocks out as RAW_Data lines,
+// so a recording is bounded by the storage instead of the RAM. Memory is handed in, PSRAM or not.
+// Plain C++ so the ring and the spill can be driven with synthetic streams off-target.
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+const size_t RAW_CAPTURE_BLOCK = 512;        // durations per spilled block, one RAW_Data line
+const size_t RAW_CAPTURE_TEXT = 256;         // bytes formatted before each write to the sink
+const uint8_t RAW_CAPTURE_SPILL_RETRIES = 3; // failed spills in a row before spill() gives up
+
+struct RawCaptureStats {
+    uint32_t frames = 0;     // receive buffers taken in
+    uint32_t durations = 0;  // durations stored, spilled ones included
+    uint32_t overflows = 0;  // durations dropped because the ring was full
+    uint32_t spilled = 0;    // durations written out by spill()
+    uint32_t spillErrors = 0;
+    uint32_t highWater = 0; // fullest the ring has been
+};
+
+// SinkT: size_t write(const uint8_t *, size_t), size_t position() and bool seek(size_t), like File
+template <typename SinkT> class RawCaptureArena {
+public:
+    // capacity durations at memory, rounded down to whole blocks. spillAt is the fill spill() brings
+    // the ring back under. Only call with the producer stopped.
+    bool init(int32_t *memory, size_t capacity, size_t spillAt) {
+        capacity -= capacity % RAW_CAPTURE_BLOCK;
+        if (!memory || capacity == 0) return false;
+        memory_ = memory;
+        capacity_ = capacity;
+        spillAt_ = spillAt < RAW_CAPTURE_BLOCK ? RAW_CAPTURE_BLOCK : spillAt > capacity ? capacity : spillAt;
+        reset();
+        return true;
+    }
+
+    // Only with the producer stopped
+    void reset() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        line_ = 0;
+        frames_.store(0, std::memory_order_relaxed);
+        durations_.store(0, std::memory_order_relaxed);
+        overflows_.store(0, std::memory_order_relaxed);
+        highWater_.store(0, std::memory_order_relaxed);
+        spilled_ = 0;
+        spillErrors_ = 0;
+        failures_ = 0;
+        torn_ = false;
+    }
+
+    // Producer: one received frame as RMT symbol words (duration0 bits 0-14, level0 bit 15,
+    // duration1 bits 16-30, level1 bit 31), preceded by the silence since the last one when gapUs.
+    void pushFrame(const uint32_t *words, size_t count, uint32_t gapUs) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t stored = 0, dropped = 0;
+        auto put = [&](int32_t d) {
+            if (head - tail >= capacity_) {
+                dropped++;
+                return;
+            }
+            memory_[head % capacity_] = d;
+            head++;
+            stored++;
+        };
+        if (gapUs) put(-int32_t(gapUs > INT32_MAX ? INT32_MAX : gapUs));
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t w = words[i];
+            const int32_t d0 = w & 0x7FFF, d1 = (w >> 16) & 0x7FFF;
+            if (d0) put(w & 0x8000 ? d0 : -d0);
+            if (d1) put(w & 0x80000000 ? d1 : -d1);
+        }
+        head_.store(head, std::memory_order_release);
+        frames_.fetch_add(1, std::memory_order_relaxed);
+        durations_.fetch_add(stored, std::memory_order_relaxed);
+        if (dropped) overflows_.fetch_add(dropped, std::memory_order_relaxed);
+        const uint32_t fill = head - tail;
+        if (fill > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(fill, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumer: writes the oldest whole blocks while the ring is past spillAt. Returns the blocks
+    // written; a failed write stops it and leaves the block in the ring for the next call, until
+    // spillStopped().
+    size_t spill(SinkT &sink) {
+        size_t blocks = 0;
+        if (spillStopped()) return 0;
+        while (size() >= spillAt_ && size() >= RAW_CAPTURE_BLOCK) {
+            if (!spillRange(sink, tail_.load(std::memory_order_relaxed), RAW_CAPTURE_BLOCK, false)) break;
+            tail_.store(tail_.load(std::memory_order_relaxed) + RAW_CAPTURE_BLOCK, std::memory_order_release);
+            spilled_ += RAW_CAPTURE_BLOCK;
+            blocks++;
+        }
+        return blocks;
+    }
+
+    // Consumer: writes and drops everything left, the last line may be short. false when the sink
+    // does not hold the whole recording: this write failed, or an earlier one could not be taken back.
+    bool flush(SinkT &sink) {
+        if (torn_) return false;
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t n = size();
+        if (!spillRange(sink, tail, n, true)) return false;
+        tail_.store(tail + n, std::memory_order_release);
+        spilled_ += n;
+        return true;
+    }
+
+    // Writes what the ring holds without dropping it (saving a recording that never spilled)
+    bool write(SinkT &sink) {
+        const size_t line = line_;
+        const bool ok = writeRange(sink, tail_.load(std::memory_order_relaxed), size(), true);
+        line_ = line;
+        return ok;
+    }
+
+    // fn(int32_t) for every duration held, oldest first; stops when fn returns false
+    template <typename Fn> bool forEach(Fn fn) const {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        for (size_t i = tail; i != head; i++) {
+            if (!fn(memory_[i % capacity_])) return false;
+        }
+        return true;
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return capacity_; }
+    bool spillDue() const { return size() >= spillAt_; }
+    // Spilling failed RAW_CAPTURE_SPILL_RETRIES times in a row, or left part of a line in the sink
+    bool spillStopped() const { return torn_ || failures_ >= RAW_CAPTURE_SPILL_RETRIES; }
+    bool spilledAny() const { return spilled_ != 0; }
+
+    RawCaptureStats stats() const {
+        RawCaptureStats s;
+        s.frames = frames_.load(std::memory_order_relaxed);
+        s.durations = durations_.load(std::memory_order_relaxed);
+        s.overflows = overflows_.load(std::memory_order_relaxed);
+        s.spilled = spilled_;
+        s.spillErrors = spillErrors_;
+        s.highWater = highWater_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    // writeRange() to the spill sink. A failed write is taken back by seeking to where it started,
+    // so the retry does not repeat what part of it got through.
+    bool spillRange(SinkT &sink, size_t from, size_t count, bool last) {
+        const size_t start = sink.position();
+        const size_t line = line_;
+        if (writeRange(sink, from, count, last)) {
+            failures_ = 0;
+            return true;
+        }
+        line_ = line;
+        spillErrors_++;
+        failures_++;
+        if (!sink.seek(start)) torn_ = true;
+        return false;
+    }
+
+    // RAW_Data lines of RAW_CAPTURE_BLOCK values, continuing the line the last write left open.
+    // last ends the line it leaves open.
+    bool writeRange(SinkT &sink, size_t from, size_t count, bool last) {
+        char text[RAW_CAPTURE_TEXT];
+        size_t len = 0;
+        auto out = [&](const char *s, size_t n) {
+            if (len + n > sizeof(text)) {
+                if (sink.write((const uint8_t *)text, len) != len) return false;
+                len = 0;
+            }
+            for (size_t i = 0; i < n; i++) text[len++] = s[i];
+            return true;
+        };
+        for (size_t i = 0; i < count; i++) {
+            char num[16];
+            size_t n = 0;
+            if (line_ == 0) {
+                if (!out("RAW_Data:", 9)) return false;
+            }
+            num[n++] = ' ';
+            const int32_t d = memory_[(from + i) % capacity_];
+            uint32_t v = d < 0 ? uint32_t(0) - uint32_t(d) : uint32_t(d);
+            if (d < 0) num[n++] = '-';
+            char digits[10];
+            size_t k = 0;
+            do {
+                digits[k++] = '0' + v % 10;
+                v /= 10;
+            } while (v);
+            while (k) num[n++] = digits[--k];
+            if (++line_ == RAW_CAPTURE_BLOCK) {
+                num[n++] = '\n';
+                line_ = 0;
+            }
+            if (!out(num, n)) return false;
+        }
+        if (last && line_) {
+            if (!out("\n", 1)) return false;
+            line_ = 0;
+        }
+        return len == 0 || sink.write((const uint8_t *)text, len) == len;
+    }
+
+    int32_t *memory_ = nullptr;
+    size_t capacity_ = 0;
+    size_t spillAt_ = 0;
+    size_t line_ = 0; // values on the RAW_Data line being written, consumer-only
+    uint32_t spilled_ = 0;
+    uint32_t spillErrors_ = 0;
+    uint8_t failures_ = 0; // failed spills in a row
+    bool torn_ = false;    // a failed write could not be taken back
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<uint32_t> frames_{0};
+    std::atomic<uint32_t> durations_{0};
+    std::atomic<uint32_t> overflows_{0};
+    std::atomic<uint32_t> highWater_{0};
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef __RAW_STREAM_H__
+#define __RAW_STREAM_H__
+// RAW_Data of a .sub file streamed from the file to the transmitter through a fixed ring, so a
+// capture of any length needs the same few kilobytes instead of its whole text as a String plus an
+// array of every timing. The tokenizer reads a line the way sendRfCommand() always has: the value is
+// trimmed and split on single spaces, every token goes through atol(), so an empty token reads 0,
+// and the first 0 ends the line's signal. Plain C++ so it can be run against the String parser
+// off-target.
+#include "modules/wifi/packet_slab.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const int32_t RAW_STREAM_LINE_END = 0; // pushed after every RAW_Data line, a duration is never 0
+const size_t RAW_STREAM_CHUNK = 512;   // bytes read from the file at a time
+
+// One RAW_Data value, fed a character at a time. emit(int32_t) receives the durations in order.
+class RawDataTokenizer {
+public:
+    static bool isSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+    void reset() {
+        started_ = false;
+        wsRun_ = false;
+        spaces_ = 0;
+        stopped_ = false;
+        startToken();
+    }
+
+    // A run of whitespace only splits tokens once something follows it, the text parser trims the
+    // value first. Inside the run every ' ' ends a token, the ones after the first end empty tokens.
+    template <typename EmitFn> void put(char c, EmitFn &emit) {
+        if (isSpace(c)) {
+            if (!started_) return;
+            wsRun_ = true;
+            if (c == ' ') spaces_++;
+            else if (spaces_ == 0 && phase_ != 0) phase_ = 3; // atol() stops at it
+            return;
+        }
+        if (wsRun_ && spaces_ > 0) {
+            emitToken(emit);
+            if (spaces_ > 1) push(0, emit);
+        }
+        wsRun_ = false;
+        spaces_ = 0;
+        started_ = true;
+        switch (phase_) {
+            case 0:
+                if (c == '-' || c == '+') {
+                    neg_ = c == '-';
+                    phase_ = 1;
+                    return;
+                }
+                // fall through
+            case 1:
+            case 2:
+                if (c >= '0' && c <= '9') {
+                    phase_ = 2;
+                    value_ = value_ * 10 + (c - '0');
+                    if (value_ > (int64_t)INT32_MAX + 1) value_ = (int64_t)INT32_MAX + 1;
+                } else {
+                    phase_ = 3;
+                }
+                break;
+            default: break;
+        }
+    }
+
+    // End of the line, an empty value reads as one 0 token
+    template <typename EmitFn> void end(EmitFn &emit) {
+        emitToken(emit);
+        reset();
+    }
+
+private:
+    void startToken() {
+        phase_ = 0;
+        neg_ = false;
+        value_ = 0;
+    }
+
+    template <typename EmitFn> void emitToken(EmitFn &emit) {
+        int64_t v = neg_ ? -value_ : value_;
+        if (v > INT32_MAX) v = INT32_MAX;
+        push((int32_t)v, emit);
+        startToken();
+    }
+
+    template <typename EmitFn> void push(int32_t v, EmitFn &emit) {
+        if (stopped_) return;
+        if (v == 0) stopped_ = true;
+        else emit(v);
+    }
+
+    bool started_ = false;
+    bool wsRun_ = false;
+    bool stopped_ = false;
+    uint32_t spaces_ = 0;
+    uint8_t phase_ = 0; // 0 leading blanks, 1 sign, 2 digits, 3 done
+    bool neg_ = false;
+    int64_t value_ = 0;
+};
+
+struct RawStreamStats {
+    uint32_t bytes = 0;     // read from the file
+    uint32_t durations = 0; // pushed to the ring
+    uint32_t lines = 0;     // RAW_Data lines
+    uint32_t highWater = 0; // fullest the ring has been
+};
+
+// Single producer (the task reading the file) and single consumer (the transmit loop). Only
+// RAW_Data lines are streamed, each followed by RAW_STREAM_LINE_END.
+template <size_t Capacity> class RawTxStream {
+public:
+    // Producer side. Reads one chunk, never more than the ring has room for, and returns the bytes
+    // read; 0 when the ring is too full or the file is done.
+    template <typename SourceT> size_t pump(SourceT &source) {
+        if (done_.load(std::memory_order_relaxed)) return 0;
+        // n bytes push at most n + 2 values: a token carried over from the last chunk is finished
+        // by a newline, which also pushes the line end, and at the end of the file
+        const size_t room = Capacity - ring_.size();
+        if (room < 3) return 0;
+        uint8_t buf[RAW_STREAM_CHUNK];
+        const size_t want = room - 2 < sizeof(buf) ? room - 2 : sizeof(buf);
+        const size_t n = source.read(buf, want);
+        if (n == 0) {
+            if (inRaw_) endLine();
+            done_.store(true, std::memory_order_release);
+            return 0;
+        }
+        for (size_t i = 0; i < n; ++i) put((char)buf[i]);
+        stats_.bytes += n;
+        const size_t used = ring_.size();
+        if (used > stats_.highWater) stats_.highWater = used;
+        return n;
+    }
+
+    // Consumer side. false when nothing is queued; check done() to tell the end of the file from
+    // a ring the producer has not caught up with.
+    bool pop(int32_t &v) { return ring_.pop(v); }
+    bool done() const { return done_.load(std::memory_order_acquire); }
+    size_t pending() const { return ring_.size(); }
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer side, or once both sides stopped
+    const RawStreamStats &stats() const { return stats_; }
+
+    // Only safe when neither side is running
+    void reset() {
+        ring_.reset();
+        tokenizer_.reset();
+        keyLen_ = 0;
+        inKey_ = true;
+        inRaw_ = false;
+        stats_ = RawStreamStats();
+        done_.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    static const uint8_t KEY_MAX = 10;
+
+    void put(char c) {
+        if (c == '\n') {
+            if (inRaw_) endLine();
+            keyLen_ = 0;
+            inKey_ = true;
+            inRaw_ = false;
+            return;
+        }
+        if (inRaw_) {
+            auto emit = [this](int32_t v) { push(v); };
+            tokenizer_.put(c, emit);
+            return;
+        }
+        if (!inKey_) return;
+        if (keyLen_ >= KEY_MAX) {
+            inKey_ = false;
+            return;
+        }
+        key_[keyLen_++] = c;
+        if (c != ':') return;
+        inKey_ = false;
+        inRaw_ = keyLen_ == 9 && memcmp(key_, "RAW_Data:", 9) == 0;
+        if (inRaw_) tokenizer_.reset();
+    }
+
+    void endLine() {
+        auto emit = [this](int32_t v) { push(v); };
+        tokenizer_.end(emit);
+        ring_.push(RAW_STREAM_LINE_END);
+        stats_.lines++;
+        inRaw_ = false;
+    }
+
+    void push(int32_t v) {
+        ring_.push(v);
+        stats_.durations++;
+    }
+
+    SpscRing<int32_t, Capacity> ring_;
+    RawDataTokenizer tokenizer_;
+    char key_[KEY_MAX];
+    uint8_t keyLen_ = 0;
+    bool inKey_ = true;
+    bool inRaw_ = false;
+    RawStreamStats stats_;
+    std::atomic<bool> done_{false};
+};
+
+#endif
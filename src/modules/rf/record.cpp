@@ -1,14 +1,11 @@
 #include "record.h"
+#include "rf_capture.h"
 #include "rf_utils.h"
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
-static bool
-record_rmt_rx_done_callback(rmt_channel_t *channel, const rmt_rx_done_event_data_t *edata, void *user_data) {
-    BaseType_t high_task_wakeup = pdFALSE;
-    QueueHandle_t receive_queue = (QueueHandle_t)user_data;
-    // send the received RMT symbols to the parser task
-    xQueueSendFromISR(receive_queue, edata, &high_task_wakeup);
-    return high_task_wakeup == pdTRUE;
-}
+
+// Where a recording goes on once the arena fills up; saving it only gives it a name
+#define RF_RECORD_SPILL_PATH "/BruceRF/.recording.sub"
+
 float phase = 0.0;
 float lastPhase = 2 * PI;
 unsigned long lastAnimationUpdate = 0;
@@ -134,6 +131,24 @@ float rf_freq_scan() {
     return frequency;
 }
 
+// Opens the spill file with the .sub header, the arena's RAW_Data lines follow it
+static bool rf_raw_open_spill(RawRecording &recorded, File &spill) {
+    FS *fs = nullptr;
+    if (!getFsStorage(fs) || fs == nullptr) return false;
+    if (!fs->exists("/BruceRF") && !fs->mkdir("/BruceRF")) return false;
+    spill = fs->open(RF_RECORD_SPILL_PATH, FILE_WRITE, true);
+    if (!spill) return false;
+    if (!rf_raw_write_header(spill, recorded.frequency)) {
+        spill.close();
+        fs->remove(RF_RECORD_SPILL_PATH);
+        return false;
+    }
+    recorded.spillFs = fs;
+    recorded.spillPath = RF_RECORD_SPILL_PATH;
+    recorded.spillSaved = false;
+    return true;
+}
+
 void rf_raw_record_create(RawRecording &recorded, bool &returnToMenu) {
     RawRecordingStatus status;
 
@@ -174,66 +189,32 @@ void rf_raw_record_create(RawRecording &recorded, bool &returnToMenu) {
 
     // Start recording
     delay(200);
-    rmt_channel_handle_t rx_ch = NULL;
-    rx_ch = setup_rf_rx();
-    if (rx_ch == NULL) return;
-    ESP_LOGI("RMT_SPECTRUM", "register RX done callback");
-    QueueHandle_t receive_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
-    assert(receive_queue);
-    rmt_rx_event_callbacks_t cbs = {
-        .on_recv_done = record_rmt_rx_done_callback,
-    };
-    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rx_ch, &cbs, receive_queue));
-    ESP_ERROR_CHECK(rmt_enable(rx_ch));
-    rmt_receive_config_t receive_config = {
-        .signal_range_min_ns = 3000,     // 10us minimum signal duration
-        .signal_range_max_ns = 12000000, // 24ms maximum signal duration
-    };
-    rmt_symbol_word_t item[64];
-    rmt_rx_done_event_data_t rx_data;
-    ESP_ERROR_CHECK(rmt_receive(rx_ch, item, sizeof(item), &receive_config));
+    if (!rf_capture_start(recorded.arena)) return;
     Serial.println("RMT Initialized");
 
+    File spill;
+    bool spillFailed = false;
+    uint32_t lastFrames = 0;
     while (!status.recordingFinished) {
         previousMillis = millis();
-        size_t rx_size = 0;
-        rmt_symbol_word_t *rx_items = NULL;
-        if (xQueueReceive(receive_queue, &rx_data, 0) == pdPASS) {
-            rx_size = rx_data.num_symbols;
-            rx_items = rx_data.received_symbols;
-        }
-        if (rx_size != 0) {
-            bool valid_signal = false;
-            if (rx_size >= 5) valid_signal = true;
-            if (valid_signal) {         // ignore codes shorter than 5 items
-                fakeRssiPresent = true; // For rssi display on single-pinned RF Modules
-                rmt_symbol_word_t *code = (rmt_symbol_word_t *)malloc(rx_size * sizeof(rmt_symbol_word_t));
-
-                // Gap calculation
-                unsigned long receivedTime = millis();
-                unsigned long long signalDuration = 0;
-                for (size_t i = 0; i < rx_size; i++) {
-                    code[i] = rx_items[i];
-                    signalDuration += rx_items[i].duration0 + rx_items[i].duration1;
-                }
-                recorded.codes.push_back(code);
-                recorded.codeLengths.push_back(rx_size);
-
-                if (status.lastSignalTime != 0) {
-                    unsigned long signalDurationMs = signalDuration / RMT_1MS_TICKS;
-                    uint16_t gap = (uint16_t)(receivedTime - status.lastSignalTime - signalDurationMs - 5);
-                    recorded.gaps.push_back(gap);
-                } else {
-                    status.firstSignalTime = receivedTime;
-                    status.recordingStarted = true;
-                    // Erase sinewave animation
-                    tft.drawPixel(0, 0, 0);
-                    tft.fillRect(10, 30, tftWidth - 20, tftHeight - 40, bruceConfig.bgColor);
-                }
-                status.lastSignalTime = receivedTime;
+        const RfCaptureStats capture = rf_capture_stats();
+        if (capture.frames != lastFrames) {
+            fakeRssiPresent = true; // For rssi display on single-pinned RF Modules
+            if (lastFrames == 0) {
+                status.firstSignalTime = millis();
+                status.recordingStarted = true;
+                // Erase sinewave animation
+                tft.drawPixel(0, 0, 0);
+                tft.fillRect(10, 30, tftWidth - 20, tftHeight - 40, bruceConfig.bgColor);
             }
-            ESP_ERROR_CHECK(rmt_receive(rx_ch, item, sizeof(item), &receive_config));
-            rx_size = 0;
+            lastFrames = capture.frames;
+            status.lastSignalTime = capture.lastFrameMs;
+        }
+
+        // The capture task keeps filling the arena while its oldest blocks go to storage
+        if (recorded.arena.spillDue() && !spillFailed && !recorded.arena.spillStopped()) {
+            if (!spill) spillFailed = !rf_raw_open_spill(recorded, spill);
+            if (spill) recorded.arena.spill(spill);
         }
 
         // Periodically update RSSI
@@ -246,11 +227,19 @@ void rf_raw_record_create(RawRecording &recorded, bool &returnToMenu) {
             if (rssiFeature) status.latestRssi = ELECHOUSE_cc1101.getRssi();
 
             status.rssiCount++;
+            // Start over at the left once the bars fill the screen
+            if (20 + (int)(status.rssiCount * 1.35) >= tftWidth - 20) {
+                int centerY = (TFT_WIDTH / 2) + 20; // same bar area rf_raw_record_draw() uses
+                int maxBarHeight = (TFT_WIDTH / 2) - 50;
+                tft.fillRect(
+                    20, centerY - maxBarHeight, tftWidth - 40, maxBarHeight * 2 + 1, bruceConfig.bgColor
+                );
+                status.rssiCount = 0;
+            }
             status.lastRssiUpdate = millis();
         }
 
-        // Stop recording after 20 seconds
-        if (status.firstSignalTime > 0 && millis() - status.firstSignalTime >= 20000)
+        if (status.firstSignalTime > 0 && millis() - status.firstSignalTime >= RF_CAPTURE_MAX_MS)
             status.recordingFinished = true;
         if (check(SelPress) && status.recordingStarted) status.recordingFinished = true;
         if (check(EscPress)) {
@@ -260,10 +249,34 @@ void rf_raw_record_create(RawRecording &recorded, bool &returnToMenu) {
         rf_raw_record_draw(status);
     }
     Serial.println("Recording stopped.");
-    rmt_disable(rx_ch);
-    rmt_del_channel(rx_ch);
-    vQueueDelete(receive_queue);
+    rf_capture_stop();
     deinitRfModule();
+    // Once it spilled the file holds the whole recording, unless writing it failed
+    if (spill) {
+        recorded.spillComplete = recorded.arena.flush(spill);
+        spill.close();
+    }
+
+    const RfCaptureStats capture = rf_capture_stats();
+    const RawCaptureStats stats = recorded.arena.stats();
+    Serial.printf(
+        "RAW capture: %lu frames, %lu noise, %lu durations, %lu dropped, %lu spilled (%lu errors), "
+        "high water %lu/%lu, %lu rx errors\n",
+        (unsigned long)stats.frames,
+        (unsigned long)capture.noise,
+        (unsigned long)stats.durations,
+        (unsigned long)stats.overflows,
+        (unsigned long)stats.spilled,
+        (unsigned long)stats.spillErrors,
+        (unsigned long)stats.highWater,
+        (unsigned long)recorded.arena.capacity(),
+        (unsigned long)capture.rxErrors
+    );
+    if (!recorded.spillComplete && !returnToMenu) {
+        displayWarning("Writing the recording failed", true);
+    } else if (stats.overflows && !returnToMenu) {
+        displayWarning("Dropped " + String(stats.overflows) + " pulses", true);
+    }
 }
 
 int rf_raw_record_options(bool saved) {
@@ -284,35 +297,63 @@ int rf_raw_record_options(bool saved) {
     return option;
 }
 
+// The arena's memory is allocated once for the whole session, PSRAM when there is some. The internal
+// one is halved until it fits a fragmented heap; it only spills sooner.
+static bool rf_raw_record_alloc(RawRecording &recorded) {
+    size_t bytes = RF_CAPTURE_ARENA_INTERNAL;
+    if (psramFound()) {
+        bytes = RF_CAPTURE_ARENA_PSRAM;
+        recorded.memory = (int32_t *)heap_caps_malloc(bytes, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    }
+    if (!recorded.memory) {
+        for (bytes = RF_CAPTURE_ARENA_INTERNAL; bytes >= RF_CAPTURE_ARENA_MIN; bytes /= 2) {
+            recorded.memory = (int32_t *)heap_caps_malloc(bytes, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+            if (recorded.memory) break;
+        }
+    }
+    if (!recorded.memory) return false;
+    const size_t capacity = bytes / sizeof(int32_t);
+    return recorded.arena.init(recorded.memory, capacity, capacity * RF_CAPTURE_SPILL_PERCENT / 100);
+}
+
+// Drops the recording, and its spill file unless it was saved
+static void rf_raw_record_clear(RawRecording &recorded) {
+    if (recorded.spillFs && !recorded.spillSaved) recorded.spillFs->remove(recorded.spillPath);
+    recorded.spillFs = nullptr;
+    recorded.spillPath = "";
+    recorded.spillSaved = false;
+    recorded.spillComplete = true;
+    recorded.arena.reset();
+    recorded.frequency = 0;
+}
+
 void rf_raw_record() {
     bool replaying = false;
     bool returnToMenu = false;
     bool saved = false;
     int option = 3;
     RawRecording recorded;
+    if (!rf_raw_record_alloc(recorded)) {
+        free(recorded.memory);
+        displayError("Not enough memory", true);
+        return;
+    }
     while (option != 4) {
         if (option == 1) { // Replay
             rf_raw_emit(recorded, returnToMenu);
         } else if (option == 2) { // Save
-            saved = true;
-            rf_raw_save(recorded);
+            saved = rf_raw_save(recorded);
         } else if (option == 3) { // Discard
             saved = false;
-            for (auto &code : recorded.codes) free(code);
-            recorded.codes.clear();
-            recorded.codeLengths.clear();
-            recorded.gaps.clear();
-            recorded.frequency = 0;
+            rf_raw_record_clear(recorded);
             rf_raw_record_create(recorded, returnToMenu);
         }
 
-        if (returnToMenu || check(EscPress)) return;
+        if (returnToMenu || check(EscPress)) break;
         option = rf_raw_record_options(saved);
     }
-    for (auto &code : recorded.codes) free(code);
-    recorded.codes.clear();
-    recorded.codeLengths.clear();
-    recorded.gaps.clear();
-    recorded.frequency = 0;
+    rf_raw_record_clear(recorded);
+    free(recorded.memory);
+    recorded.memory = nullptr;
     return;
 }
@@ -0,0 +1,149 @@
+#include "rf_capture.h"
+#include "rf_utils.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+static_assert(sizeof(rmt_symbol_word_t) == sizeof(uint32_t), "the arena decodes RMT symbols as words");
+
+// Same limits the recorder always used: pulses under 3 us are glitches, 12 ms of silence ends a frame
+#define RF_CAPTURE_MIN_NS 3000
+#define RF_CAPTURE_IDLE_NS 12000000
+
+struct RfCaptureEvent {
+    rmt_symbol_word_t *symbols;
+    size_t count;
+    int64_t doneUs; // when the driver handed the buffer back
+};
+
+static rmt_symbol_word_t rfCaptureRx[2][RF_CAPTURE_RX_SYMBOLS];
+static rmt_channel_handle_t rfCaptureChannel = NULL;
+static QueueHandle_t rfCaptureQueue = NULL;
+static TaskHandle_t rfCaptureTask = NULL;
+static RfCaptureArena *rfCaptureArena = nullptr;
+static volatile bool rfCaptureStop = false;
+static volatile bool rfCaptureRunning = false;
+static volatile uint32_t rfCaptureFrames = 0;
+static volatile uint32_t rfCaptureNoise = 0;
+static volatile uint32_t rfCaptureRxErrors = 0;
+static volatile unsigned long rfCaptureLastMs = 0;
+
+static const rmt_receive_config_t rfCaptureConfig = {
+    .signal_range_min_ns = RF_CAPTURE_MIN_NS,
+    .signal_range_max_ns = RF_CAPTURE_IDLE_NS,
+};
+
+static bool
+rf_capture_done_callback(rmt_channel_t *channel, const rmt_rx_done_event_data_t *edata, void *user_data) {
+    BaseType_t high_task_wakeup = pdFALSE;
+    RfCaptureEvent ev = {edata->received_symbols, edata->num_symbols, esp_timer_get_time()};
+    xQueueSendFromISR((QueueHandle_t)user_data, &ev, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
+}
+
+// Re-arms the idle buffer before touching the finished one, the channel is only deaf for the time
+// it takes this task to wake up
+static void rf_capture_task(void *) {
+    uint8_t next = 1;
+    int64_t prevEndUs = 0;
+    RfCaptureEvent ev;
+    while (!rfCaptureStop) {
+        if (xQueueReceive(rfCaptureQueue, &ev, pdMS_TO_TICKS(20)) != pdPASS) continue;
+        if (rmt_receive(rfCaptureChannel, rfCaptureRx[next], sizeof(rfCaptureRx[next]), &rfCaptureConfig) !=
+            ESP_OK) {
+            rfCaptureRxErrors++;
+        }
+        next ^= 1;
+
+        if (ev.count < RF_CAPTURE_MIN_SYMBOLS) {
+            rfCaptureNoise++;
+            continue;
+        }
+        int64_t durationUs = 0; // setup_rf_rx() ticks at 1 MHz
+        for (size_t i = 0; i < ev.count; i++) {
+            durationUs += ev.symbols[i].duration0 + ev.symbols[i].duration1;
+        }
+        // A full buffer is handed back as soon as it fills, any other after the idle timeout
+        const int64_t endUs = ev.doneUs - (ev.count < RF_CAPTURE_RX_SYMBOLS ? RF_CAPTURE_IDLE_NS / 1000 : 0);
+        uint32_t gapUs = 0;
+        if (prevEndUs != 0) {
+            const int64_t gap = endUs - durationUs - prevEndUs;
+            gapUs = gap < 1 ? 1 : gap > INT32_MAX ? INT32_MAX : (uint32_t)gap;
+        }
+        prevEndUs = endUs;
+
+        rfCaptureArena->pushFrame((const uint32_t *)ev.symbols, ev.count, gapUs);
+        rfCaptureFrames++;
+        rfCaptureLastMs = millis();
+    }
+    rfCaptureRunning = false;
+    vTaskDelete(NULL);
+}
+
+bool rf_capture_start(RfCaptureArena &arena) {
+    if (rfCaptureRunning) return false;
+    rfCaptureChannel = setup_rf_rx();
+    if (rfCaptureChannel == NULL) return false;
+    rfCaptureQueue = xQueueCreate(2, sizeof(RfCaptureEvent));
+    if (!rfCaptureQueue) {
+        rmt_del_channel(rfCaptureChannel);
+        rfCaptureChannel = NULL;
+        return false;
+    }
+    rmt_rx_event_callbacks_t cbs = {
+        .on_recv_done = rf_capture_done_callback,
+    };
+    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rfCaptureChannel, &cbs, rfCaptureQueue));
+    ESP_ERROR_CHECK(rmt_enable(rfCaptureChannel));
+
+    rfCaptureArena = &arena;
+    rfCaptureFrames = 0;
+    rfCaptureNoise = 0;
+    rfCaptureRxErrors = 0;
+    rfCaptureLastMs = 0;
+    rfCaptureStop = false;
+    if (rmt_receive(rfCaptureChannel, rfCaptureRx[0], sizeof(rfCaptureRx[0]), &rfCaptureConfig) != ESP_OK) {
+        rf_capture_stop();
+        return false;
+    }
+    rfCaptureRunning = true;
+#if CONFIG_FREERTOS_UNICORE
+    BaseType_t res = xTaskCreate(rf_capture_task, "rf_capture", 3072, nullptr, 5, &rfCaptureTask);
+#else
+    // the record loop draws and writes to the SD card on the Arduino loop core
+    BaseType_t res =
+        xTaskCreatePinnedToCore(rf_capture_task, "rf_capture", 3072, nullptr, 5, &rfCaptureTask, 0);
+#endif
+    if (res != pdPASS) {
+        rfCaptureRunning = false;
+        rf_capture_stop();
+        return false;
+    }
+    return true;
+}
+
+void rf_capture_stop() {
+    rfCaptureStop = true;
+    while (rfCaptureRunning) vTaskDelay(1);
+    rfCaptureTask = NULL;
+    if (rfCaptureChannel) {
+        rmt_disable(rfCaptureChannel);
+        rmt_del_channel(rfCaptureChannel);
+        rfCaptureChannel = NULL;
+    }
+    if (rfCaptureQueue) {
+        vQueueDelete(rfCaptureQueue);
+        rfCaptureQueue = NULL;
+    }
+    rfCaptureArena = nullptr;
+}
+
+RfCaptureStats rf_capture_stats() {
+    RfCaptureStats s;
+    s.frames = rfCaptureFrames;
+    s.noise = rfCaptureNoise;
+    s.rxErrors = rfCaptureRxErrors;
+    s.lastFrameMs = rfCaptureLastMs;
+    return s;
+}
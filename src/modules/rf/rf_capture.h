@@ -0,0 +1,32 @@
+#ifndef RF_CAPTURE_H
+#define RF_CAPTURE_H
+// Continuous RAW capture from the RMT: two receive buffers take turns, the one that just finished is
+// copied into a RawCaptureArena by a task of its own while the other one is already receiving, so
+// the record loop can draw, read the RSSI and spill to storage without losing frames.
+#include "raw_capture.h"
+#include <FS.h>
+
+#define RF_CAPTURE_ARENA_PSRAM (1024 * 1024)  // bytes, 262144 durations
+#define RF_CAPTURE_ARENA_INTERNAL (48 * 1024) // bytes, halved while the heap has no block that big
+#define RF_CAPTURE_ARENA_MIN (6 * 1024)       // bytes, the smallest internal arena (three blocks)
+#define RF_CAPTURE_SPILL_PERCENT 75           // fill at which the record loop writes blocks out
+#define RF_CAPTURE_RX_SYMBOLS 64              // per receive buffer, two of them
+#define RF_CAPTURE_MIN_SYMBOLS 5              // shorter frames are noise
+#define RF_CAPTURE_MAX_MS (10 * 60 * 1000)    // a recording stops by itself after this
+
+typedef RawCaptureArena<File> RfCaptureArena;
+
+struct RfCaptureStats {
+    uint32_t frames = 0;   // frames kept
+    uint32_t noise = 0;    // frames shorter than RF_CAPTURE_MIN_SYMBOLS
+    uint32_t rxErrors = 0; // rmt_receive() refused to re-arm
+    unsigned long lastFrameMs = 0;
+};
+
+// Sets up the receive channel at the current frequency and starts filling arena
+bool rf_capture_start(RfCaptureArena &arena);
+// Stops the task and releases the channel, the arena keeps what was captured
+void rf_capture_stop();
+RfCaptureStats rf_capture_stats();
+
+#endif
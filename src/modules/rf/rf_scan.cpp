@@ -137,6 +137,7 @@ void RFScan::read_rcswitch() {
         received.Bit = rcswitch.getReceivedBitlength();
         received.filepath = "signal_" + String(signals);
         received.data = "";
+        received.decoded = "";
 
         frequency = 0;
         display_info(received, signals, ReadRAW, codesOnly, autoSave, title);
@@ -155,6 +156,7 @@ void RFScan::read_raw() {
     String _data = "";
     std::vector<int> durations;
     std::vector<int> indexed_durations;
+    std::vector<int32_t> timings;
     uint64_t result = 0;
     uint8_t repetition = 0;
 
@@ -165,6 +167,7 @@ void RFScan::read_raw() {
         signed int sign = (transitions % 2 == 0) ? 1 : -1;
 
         int duration = sign * (int)raw[transitions];
+        timings.push_back(duration);
         if (duration < -5000 && repetition < 2) { repetition += 1; }
         _data += String(duration);
         if (received.te == 0 && duration > 0) received.te = duration;
@@ -182,6 +185,8 @@ void RFScan::read_raw() {
     received.data = _data;
     received.filepath = "signal_" + String(signals);
     received.frequency = long(frequency * 1000000);
+    received.decoded = "";
+    if (!decoded) decode_raw(timings);
 
     // if there is a value decoded by RCSwitch, show it
     if (decoded) {
@@ -227,6 +232,31 @@ void RFScan::read_raw() {
     rcswitch.resetAvailable();
 }
 
+// Fixed-code protocols RCSwitch does not know, tried on the capture. Every candidate goes to serial,
+// the best one is shown with the signal when it is confident enough; the signal itself stays RAW.
+void RFScan::decode_raw(const std::vector<int32_t> &timings) {
+    PulseCandidate candidates[4];
+    const size_t found = decoder.decode(timings.data(), timings.size(), candidates, 4);
+    for (size_t i = 0; i < found; i++) {
+        const PulseCandidate &c = candidates[i];
+        decimalToHexString(c.key, hexString);
+        Serial.printf(
+            "Decoded %s: %d bits, key %s, te %uus, %u repeats, %u%%\n",
+            c.protocol->name,
+            c.bits,
+            hexString,
+            (unsigned)c.te,
+            (unsigned)c.frames,
+            (unsigned)c.confidence
+        );
+    }
+    if (found && candidates[0].confidence >= DECODE_CONFIDENCE_MIN) {
+        decimalToHexString(candidates[0].key, hexString);
+        received.decoded = String(candidates[0].protocol->name) + " " + String(candidates[0].bits) + "bit " +
+                           String(hexString);
+    }
+}
+
 void RFScan::select_menu_option() {
 #if !defined(T_EMBED_1101) && !defined(CONFIG_IDF_TARGET_ESP32C5)
     rcswitch.disableReceive(); // it is causing T-Embed to restart
@@ -440,6 +470,7 @@ void display_signal_data(RfCodes received) {
 
     if (received.protocol == "RAW") padprintln("CRC: " + String(hexString));
     else padprintln("Key: " + String(hexString));
+    if (received.decoded != "") padprintln("Decoded: " + received.decoded);
 
     // if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) {
     //     int rssi = ELECHOUSE_cc1101.getRssi();
@@ -1,11 +1,13 @@
 #ifndef __RF_SCAN_H__
 #define __RF_SCAN_H__
 
+#include "protocols/pulse_decoder.h"
 #include "rf_utils.h"
 #include "structs.h"
 #include <RCSwitch.h>
 
 #define _MAX_TRIES 5
+#define DECODE_CONFIDENCE_MIN 50 // a RAW capture shows a decode from this confidence (0..100)
 
 class RFScan {
 public:
@@ -35,6 +37,7 @@ public:
 
 private:
     RCSwitch rcswitch = RCSwitch();
+    PulseDecoder decoder;
     RfCodes received;
     String title = "RF Scan Copy";
     bool restartScan = false;
@@ -63,6 +66,7 @@ private:
     /////////////////////////////////////////////////////////////////////////////////////
     void read_rcswitch();
     void read_raw();
+    void decode_raw(const std::vector<int32_t> &timings);
     void replay_signal(bool asRaw = false);
     void save_signal(bool asRaw = false);
     void reset_signals();
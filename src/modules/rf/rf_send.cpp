@@ -1,8 +1,79 @@
 #include "rf_send.h"
 #include "core/type_convertion.h"
+#include "raw_stream.h"
 #include "rf_utils.h"
+#include "rf_tx_session.h"
+#include "rmt_tx.h"
+#include "sub_cache.h"
 #include <RCSwitch.h>
 
+#define RAW_TX_RING 2048 // durations queued ahead of the transmitter, 8 KB whatever the capture length
+
+typedef RawTxStream<RAW_TX_RING> RawTxRing;
+
+// The configured module as RfTxSession drives it. Single-pinned modules have nothing to set up
+// besides the frequency, so they only support ASK/OOK and ignore the other settings.
+struct BruceRfRadio {
+    static bool cc1101() { return bruceConfigPins.rfModule == CC1101_SPI_MODULE; }
+
+    bool supports(const RfTxConfig &cfg) {
+        if (cc1101() || cfg.modulation == 2) return true;
+        Serial.print("unsupported modulation: ");
+        Serial.println(cfg.modulation);
+        return false;
+    }
+    bool init(const RfTxConfig &cfg) {
+        if (!initRfModule("", cfg.frequency / 1000000.0)) return false;
+        if (!cc1101()) initRfModule("tx", cfg.frequency / 1000000.0);
+        return true;
+    }
+    // derived from
+    // https://github.com/LSatan/SmartRC-CC1101-Driver-Lib/blob/master/examples/Rc-Switch%20examples%20cc1101/SendDemo_cc1101/SendDemo_cc1101.ino
+    void setModulation(uint8_t modulation) {
+        if (cc1101()) ELECHOUSE_cc1101.setModulation(modulation);
+    }
+    void setDeviation(float deviation) {
+        if (cc1101()) ELECHOUSE_cc1101.setDeviation(deviation);
+    }
+    // Receive Bandwidth in kHz. Value from 58.03 to 812.50. Default is 812.50 kHz.
+    void setRxBW(float rxBW) {
+        if (cc1101()) ELECHOUSE_cc1101.setRxBW(rxBW);
+    }
+    void setDataRate(float dataRate) {
+        if (cc1101()) ELECHOUSE_cc1101.setDRate(dataRate);
+    }
+    // TxPower in dBm, depending on the band: -30 -20 -15 -10 -6 0 5 7 10 11 12. Default is max!
+    void setPower(int8_t power) {
+        if (cc1101()) ELECHOUSE_cc1101.setPA(power);
+    }
+    void startTx() {
+        if (!cc1101()) return;
+        pinMode(bruceConfigPins.CC1101_bus.io0, OUTPUT);
+        ioExpander.turnPinOnOff(IO_EXP_CC_RX, LOW);
+        ioExpander.turnPinOnOff(IO_EXP_CC_TX, HIGH);
+        ELECHOUSE_cc1101.SetTx();
+    }
+    // between signals, so an FSK carrier does not stay on; the registers are kept
+    void idle() {
+        if (cc1101()) ELECHOUSE_cc1101.setSidle();
+        else digitalWrite(bruceConfigPins.rfTx, LOW);
+    }
+    void deinit() { deinitRfModule(); }
+    uint32_t nowUs() { return micros(); }
+};
+
+typedef RfTxSession<BruceRfRadio> RfTx;
+
+static BruceRfRadio rfRadio;
+
+static const SubDataLine *txRawStream(
+    RfTx &tx, FS *fs, const String &path, const CompiledSub &sub, int bit, uint64_t key, bool hideDefaultUI
+);
+static void sendCompiledSignal(
+    RfTx &tx, const CompiledSub &sub, int bit, uint64_t key, const SubDataLine *line, bool hideDefaultUI
+);
+static void rcswitchTransmit(uint64_t data, unsigned int bits, int pulse, int protocol, int repeat);
+
 void sendCustomRF() {
     // interactive menu part only
     FS *fs = NULL;
@@ -35,82 +106,77 @@ void sendCustomRF() {
     }
 }
 
+// Text kept in the recent codes for a compiled data line, sendRfCommand() reads it back
+static String compiled_line_text(const CompiledSub &sub, const SubDataLine *line) {
+    String text;
+    if (!line) return text;
+    // a streamed compile only kept the start of the last RAW_Data line
+    const int32_t *timings = sub.streamed ? sub.timings.data() : sub.lineTimings(*line);
+    const uint32_t count = sub.streamed && line->kind == SUB_DATA_TIMINGS
+                               ? (line->count < sub.timings.size() ? line->count : sub.timings.size())
+                               : line->count;
+    text.reserve(count * (line->kind == SUB_DATA_TIMINGS ? 6 : 3));
+    for (uint32_t i = 0; i < count; ++i) {
+        char buf[12];
+        if (line->kind == SUB_DATA_TIMINGS) {
+            snprintf(buf, sizeof(buf), "%ld", (long)timings[i]);
+        } else {
+            snprintf(buf, sizeof(buf), "%02X", sub.lineBytes(*line)[i]);
+        }
+        if (i) text += ' ';
+        text += buf;
+    }
+    return text;
+}
+
 bool txSubFile(FS *fs, String filepath, bool hideDefaultUI) {
     struct RfCodes selected_code;
-    File databaseFile;
-    String line;
-    String txt;
+    CompiledSub sub;
+    RfTx tx(rfRadio); // one radio setup for every signal of the file
+    bool usedCache = false;
     int sent = 0;
 
     if (!fs) return false;
 
-    databaseFile = fs->open(filepath, FILE_READ);
-
     if (!hideDefaultUI) { drawMainBorder(); }
 
-    if (!databaseFile) {
+    if (!load_sub_file(fs, filepath, sub, &usedCache)) {
         Serial.println("Failed to open database file.");
         displayError("Fail to open file", true);
         return false;
     }
-    Serial.println("Opened sub file.");
-    selected_code.filepath = filepath.substring(1 + filepath.lastIndexOf("/"));
-
-    std::vector<int> bitList;
-    std::vector<int> bitRawList;
-    std::vector<uint64_t> keyList;
-    std::vector<String> rawDataList;
-
-    if (!databaseFile) Serial.println("Fail opening file");
-    // Store the code(s) in the signal
-    while (databaseFile.available()) {
-        line = databaseFile.readStringUntil('\n');
-        txt = line.substring(line.indexOf(":") + 1);
-        if (txt.endsWith("\r")) txt.remove(txt.length() - 1);
-        txt.trim();
-        if (line.startsWith("Protocol:")) selected_code.protocol = txt;
-        if (line.startsWith("Preset:")) selected_code.preset = txt;
-        if (line.startsWith("Frequency:")) selected_code.frequency = txt.toInt();
-        if (line.startsWith("TE:")) selected_code.te = txt.toInt();
-        if (line.startsWith("Bit:")) bitList.push_back(txt.toInt()); // selected_code.Bit = txt.toInt();
-        if (line.startsWith("Bit_RAW:"))
-            bitRawList.push_back(txt.toInt()); // selected_code.BitRAW = txt.toInt();
-        if (line.startsWith("Key:"))
-            keyList.push_back(
-                hexStringToDecimal(txt.c_str())
-            ); // selected_code.key = hexStringToDecimal(txt.c_str());
-        if (line.startsWith("RAW_Data:") || line.startsWith("Data_RAW:"))
-            rawDataList.push_back(txt); // selected_code.data = txt;
-        if (check(EscPress)) break;
-    }
-    int total = bitList.size() + bitRawList.size() + keyList.size() + rawDataList.size() > 0 ? 1 : 0;
+    Serial.printf("Opened sub file (%s).\n", usedCache ? "compiled" : "parsed");
+
+    int total = sub.bits.size() + sub.bitRaws.size() + sub.keys.size() + sub.lines.size() > 0 ? 1 : 0;
     Serial.printf("Total signals found: %d\n", total);
-    databaseFile.close();
-
-    // If the signal is complete, send all of the code(s) that were found in it.
-    // TODO: try to minimize the overhead between codes.
-    if (selected_code.protocol != "" && selected_code.preset != "" && selected_code.frequency > 0) {
-        for (int bit : bitList) {
-            selected_code.Bit = bit;
-            sendRfCommand(selected_code, hideDefaultUI);
+
+    // If the signal is complete, send all of the code(s) that were found in it. Bit, key and data
+    // line carry over from one loop to the next, like the fields of a single RfCodes did.
+    if (sub.complete()) {
+        int bit = 0;
+        uint64_t key = 0;
+        const SubDataLine *line = nullptr;
+        for (int32_t b : sub.bits) {
+            bit = b;
+            sendCompiledSignal(tx, sub, bit, key, line, hideDefaultUI);
             sent++;
             if (!hideDefaultUI) {
                 if (check(EscPress)) break;
                 displayTextLine("Sent " + String(sent) + "/" + String(total));
             }
         }
-        for (int bitRaw : bitRawList) {
-            selected_code.Bit = bitRaw;
-            sendRfCommand(selected_code, hideDefaultUI);
+        for (int32_t b : sub.bitRaws) {
+            bit = b;
+            sendCompiledSignal(tx, sub, bit, key, line, hideDefaultUI);
             sent++;
             if (!hideDefaultUI) {
                 if (check(EscPress)) break;
                 displayTextLine("Sent " + String(sent) + "/" + String(total));
             }
         }
-        for (uint64_t key : keyList) {
-            selected_code.key = key;
-            sendRfCommand(selected_code, hideDefaultUI);
+        for (uint32_t k : sub.keys) {
+            key = k;
+            sendCompiledSignal(tx, sub, bit, key, line, hideDefaultUI);
             sent++;
             if (!hideDefaultUI) {
                 if (check(EscPress)) break;
@@ -119,52 +185,51 @@ bool txSubFile(FS *fs, String filepath, bool hideDefaultUI) {
         }
 
         // RAS_Data is considered one long signal, doesn't matter the number of lines it has
-        if (rawDataList.size() > 0) sent++;
-        for (String rawData : rawDataList) {
-            selected_code.data = rawData;
-            sendRfCommand(selected_code, hideDefaultUI);
-            // sent++;
-            if (check(EscPress)) break;
-            // displayTextLine("Sent " + String(sent) + "/" + String(total));
+        if (sub.lines.size() > 0) sent++;
+        if (sub.streamed && sub.protocol == SUB_PROTOCOL_RAW) {
+            line = txRawStream(tx, fs, filepath, sub, bit, key, hideDefaultUI);
+        } else {
+            for (const SubDataLine &l : sub.lines) {
+                line = &l;
+                sendCompiledSignal(tx, sub, bit, key, line, hideDefaultUI);
+                if (check(EscPress)) break;
+            }
         }
+
+        selected_code.filepath = filepath.substring(1 + filepath.lastIndexOf("/"));
+        selected_code.protocol = sub.protocolName;
+        selected_code.preset = sub.presetName;
+        selected_code.frequency = sub.frequency;
+        selected_code.te = sub.te;
+        selected_code.Bit = bit;
+        selected_code.key = key;
+        selected_code.data = compiled_line_text(sub, line);
         addToRecentCodes(selected_code);
     }
 
+    tx.end();
+    const RfTxSessionStats &txStats = tx.stats();
+    Serial.printf(
+        "RF TX: %lu signals, %lu inits, %lu reconfigs, %lu writes, gap min/avg/max %lu/%lu/%lu us\n",
+        (unsigned long)txStats.signals,
+        (unsigned long)txStats.inits,
+        (unsigned long)txStats.reconfigs,
+        (unsigned long)txStats.writes,
+        (unsigned long)txStats.gapMinUs,
+        (unsigned long)txStats.gapAvgUs(),
+        (unsigned long)txStats.gapMaxUs
+    );
     Serial.printf("\nSent %d of %d signals\n", sent, total);
     if (!hideDefaultUI) { displayTextLine("Sent " + String(sent) + "/" + String(total), true); }
 
-    // Clear the vectors from memory
-    bitList.clear();
-    bitRawList.clear();
-    keyList.clear();
-    rawDataList.clear();
-    bitList.shrink_to_fit();
-    bitRawList.shrink_to_fit();
-    keyList.shrink_to_fit();
-    rawDataList.shrink_to_fit();
-
     delay(1000);
-    deinitRfModule();
     return true;
 }
 
-void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
-    uint32_t frequency = rfcode.frequency;
-    String protocol = rfcode.protocol;
-    String preset = rfcode.preset;
-    String data = rfcode.data;
-    uint64_t key = rfcode.key;
-    byte modulation = 2; // possible values for CC1101: 0 = 2-FSK, 1 =GFSK, 2=ASK, 3 = 4-FSK, 4 = MSK
-    float deviation = 1.58;
-    float rxBW = 270.83; // Receive bandwidth
-    float dataRate = 10; // Data Rate
-                         /*
-                             Serial.println("sendRawRfCommand");
-                             Serial.println(data);
-                             Serial.println(frequency);
-                             Serial.println(preset);
-                             Serial.println(protocol);
-                           */
+// Radio settings of a preset, false when the preset is not supported
+static bool rfTxConfig(uint32_t frequency, uint8_t preset, const char *presetName, RfTxConfig &cfg) {
+    cfg = RfTxConfig();
+    cfg.frequency = frequency;
 
     // Radio preset name (configures modulation, bandwidth, filters, etc.).
     /*  supported flipper presets:
@@ -177,111 +242,274 @@ void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
         FuriHalSubGhzPresetGFSK9_99KbAsync, //< GFSK, deviation 19.042969 kHz, 9.996Kb/s, asynchronous
         FuriHalSubGhzPresetCustom, //Custom Preset
     */
-    // struct Protocol rcswitch_protocol;
-    int rcswitch_protocol_no = 1;
-    if (preset == "FuriHalSubGhzPresetOok270Async") {
-        rcswitch_protocol_no = 1;
-        //  pulseLength , syncFactor , zero , one, invertedSignal
-        // rcswitch_protocol = { 350, {  1, 31 }, {  1,  3 }, {  3,  1 }, false };
-        modulation = 2;
-        rxBW = 270;
-    } else if (preset == "FuriHalSubGhzPresetOok650Async") {
-        rcswitch_protocol_no = 2;
-        // rcswitch_protocol = { 650, {  1, 10 }, {  1,  2 }, {  2,  1 }, false };
-        modulation = 2;
-        rxBW = 650;
-    } else if (preset == "FuriHalSubGhzPreset2FSKDev238Async") {
-        modulation = 0;
-        deviation = 2.380371;
-        rxBW = 238;
-    } else if (preset == "FuriHalSubGhzPreset2FSKDev476Async") {
-        modulation = 0;
-        deviation = 47.60742;
-        rxBW = 476;
-    } else if (preset == "FuriHalSubGhzPresetMSK99_97KbAsync") {
-        modulation = 4;
-        deviation = 47.60742;
-        dataRate = 99.97;
-    } else if (preset == "FuriHalSubGhzPresetGFSK9_99KbAsync") {
-        modulation = 1;
-        deviation = 19.042969;
-        dataRate = 9.996;
-    } else {
-        bool found = false;
-        for (int p = 0; p < 30; p++) {
-            if (preset == String(p)) {
-                rcswitch_protocol_no = preset.toInt();
-                found = true;
-            }
-        }
-        if (!found) {
+    switch (preset) {
+        case SUB_PRESET_OOK270:
+            //  pulseLength , syncFactor , zero , one, invertedSignal
+            // rcswitch_protocol = { 350, {  1, 31 }, {  1,  3 }, {  3,  1 }, false };
+            cfg.modulation = 2;
+            cfg.rxBW = 270;
+            break;
+        case SUB_PRESET_OOK650:
+            // rcswitch_protocol = { 650, {  1, 10 }, {  1,  2 }, {  2,  1 }, false };
+            cfg.modulation = 2;
+            cfg.rxBW = 650;
+            break;
+        case SUB_PRESET_2FSK238:
+            cfg.modulation = 0;
+            cfg.deviation = 2.380371;
+            cfg.rxBW = 238;
+            break;
+        case SUB_PRESET_2FSK476:
+            cfg.modulation = 0;
+            cfg.deviation = 47.60742;
+            cfg.rxBW = 476;
+            break;
+        case SUB_PRESET_MSK99_97:
+            cfg.modulation = 4;
+            cfg.deviation = 47.60742;
+            cfg.dataRate = 99.97;
+            break;
+        case SUB_PRESET_GFSK9_99:
+            cfg.modulation = 1;
+            cfg.deviation = 19.042969;
+            cfg.dataRate = 9.996;
+            break;
+        case SUB_PRESET_RCSWITCH: break;
+        default:
             Serial.print("unsupported preset: ");
-            Serial.println(preset);
-            return;
-        }
+            Serial.println(presetName);
+            return false;
     }
 
-    // init transmitter
-    if (!initRfModule("", frequency / 1000000.0)) return;
-    if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) { // CC1101 in use
-        // derived from
-        // https://github.com/LSatan/SmartRC-CC1101-Driver-Lib/blob/master/examples/Rc-Switch%20examples%20cc1101/SendDemo_cc1101/SendDemo_cc1101.ino
-        ELECHOUSE_cc1101.setModulation(modulation);
-        if (deviation) ELECHOUSE_cc1101.setDeviation(deviation);
-        if (rxBW)
-            ELECHOUSE_cc1101.setRxBW(
-                rxBW
-            ); // Set the Receive Bandwidth in kHz. Value from 58.03 to 812.50. Default is 812.50 kHz.
-        if (dataRate) ELECHOUSE_cc1101.setDRate(dataRate);
-        pinMode(bruceConfigPins.CC1101_bus.io0, OUTPUT);
-        ELECHOUSE_cc1101.setPA(
-            12
-        ); // set TxPower. The following settings are possible depending on the frequency band.  (-30  -20 -15
-        // -10  -6    0    5    7    10   11   12)   Default is max!
-        ioExpander.turnPinOnOff(IO_EXP_CC_RX, LOW);
-        ioExpander.turnPinOnOff(IO_EXP_CC_TX, HIGH);
-        ELECHOUSE_cc1101.SetTx();
+    return true;
+}
+
+// Gets the session ready to send with a preset, false when it cannot
+static bool beginRfTx(RfTx &tx, uint32_t frequency, uint8_t preset, const char *presetName) {
+    RfTxConfig cfg;
+    if (!rfTxConfig(frequency, preset, presetName, cfg)) return false;
+    return tx.begin(cfg);
+}
+
+// One transmission of a compiled file, what sendRfCommand() does with the equivalent RfCodes. A data
+// line only goes out when it matches the protocol (RAW_Data for RAW, Data_RAW for BinRAW).
+void sendCompiledSub(
+    const CompiledSub &sub, int bit, uint64_t key, const SubDataLine *line, bool hideDefaultUI
+) {
+    RfTx tx(rfRadio);
+    sendCompiledSignal(tx, sub, bit, key, line, hideDefaultUI);
+}
+
+// sendCompiledSub() on a session that stays up for the next signal. The data lines of a RAW file
+// are one signal, the radio keeps transmitting from one to the next.
+static void sendCompiledSignal(
+    RfTx &tx, const CompiledSub &sub, int bit, uint64_t key, const SubDataLine *line, bool hideDefaultUI
+) {
+    if (!beginRfTx(tx, sub.frequency, sub.preset, sub.presetName)) return;
+
+    switch (sub.protocol) {
+        case SUB_PROTOCOL_RAW:
+            if (!hideDefaultUI) { displayTextLine("Sending.."); }
+            if (line && line->kind == SUB_DATA_TIMINGS && !sub.streamed) {
+                RCSwitch_RAW_send(sub.lineTimings(*line), line->count);
+            }
+            break;
+        case SUB_PROTOCOL_BINRAW:
+            if (line && line->kind == SUB_DATA_BYTES) {
+                RCSwitch_RAW_Bit_send(sub.lineBytes(*line), line->count, sub.te);
+            }
+            break;
+        case SUB_PROTOCOL_RCSWITCH:
+            if (!hideDefaultUI) { displayTextLine("Sending.."); }
+            rcswitchTransmit(key, bit, sub.te, sub.rcswitchProtocol, 10);
+            break;
+        case SUB_PROTOCOL_PRINCETON: rcswitchTransmit(key, bit, 350, 1, 10); break;
+        default:
+            Serial.print("unsupported protocol: ");
+            Serial.println(sub.protocolName);
+            Serial.println("Sending RcSwitch 11 protocol");
+            rcswitchTransmit(key, bit, 270, 11, 10);
+            break;
+    }
+
+    tx.signalDone(sub.protocol == SUB_PROTOCOL_RAW && line);
+}
+
+static int rfTxPin() {
+    if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) return bruceConfigPins.CC1101_bus.io0;
+    return bruceConfigPins.rfTx;
+}
+
+// Positive timings are high, negative ones low, in microseconds
+static inline void rawPulse(int pin, int32_t t) {
+    digitalWrite(pin, t >= 0 ? HIGH : LOW);
+    delayMicroseconds(t >= 0 ? (uint32_t)t : 0u - (uint32_t)t);
+}
+
+static RmtRawTx rmtRawTx;
+
+// Sends the durations next(int32_t &) hands over on the RMT, bit-banged when no channel is free
+template <typename NextFn> static void rawSend(int pin, NextFn &next) {
+    RmtTxReport report;
+    if (rmtRawTx.send(pin, next, &report)) {
+        Serial.printf(
+            "RMT TX: %lu symbols, %lu blocks, %lu us sent for %lu us encoded, block error max %lu us "
+            "mean %lu us, %lu starved\n",
+            (unsigned long)report.symbols,
+            (unsigned long)report.blocks,
+            (unsigned long)report.measuredUs,
+            (unsigned long)report.expectedUs,
+            (unsigned long)report.maxBlockErrorUs,
+            (unsigned long)report.meanBlockErrorUs,
+            (unsigned long)report.starved
+        );
+        return;
+    }
+    int32_t t;
+    while (next(t)) rawPulse(pin, t);
+    digitalWrite(pin, LOW);
+}
+
+struct RawTxProducer {
+    RawTxRing *stream;
+    File *file;
+    volatile bool stop;
+    volatile bool running;
+};
+
+static void rawTxProducerTask(void *arg) {
+    RawTxProducer &p = *(RawTxProducer *)arg;
+    while (!p.stop && !p.stream->done()) {
+        if (p.stream->pump(*p.file) == 0 && !p.stream->done()) vTaskDelay(1); // ring full
+    }
+    p.running = false;
+    vTaskDelete(nullptr);
+}
+
+// Sends one streamed RAW_Data line, up to its RAW_STREAM_LINE_END. When the reader falls behind,
+// the encoder waits for it and the stall is counted; the RMT keeps sending the block it has.
+static void rawStreamLine(RawTxRing &stream, int pin, bool transmit, uint32_t &underruns) {
+    auto next = [&](int32_t &t) {
+        if (!stream.pop(t)) {
+            if (transmit) underruns++;
+            while (!stream.pop(t)) {
+                if (stream.done() && stream.pending() == 0) return false;
+            }
+        }
+        return t != RAW_STREAM_LINE_END;
+    };
+    if (transmit) {
+        rawSend(pin, next);
     } else {
-        // other single-pinned modules in use
-        if (modulation != 2) {
-            Serial.print("unsupported modulation: ");
-            Serial.println(modulation);
-            return;
+        int32_t t;
+        while (next(t)) {}
+    }
+}
+
+// The data lines of a file too big to hold (sub.streamed): a task reads the file into a fixed ring
+// while this one transmits, so memory use does not grow with the capture. Same sequence as the
+// sendCompiledSub() loop in txSubFile(). Returns the last line handled.
+static const SubDataLine *txRawStream(
+    RfTx &tx, FS *fs, const String &path, const CompiledSub &sub, int bit, uint64_t key, bool hideDefaultUI
+) {
+    RawTxRing *stream = new (std::nothrow) RawTxRing();
+    File file = fs->open(path, FILE_READ);
+    if (!stream || !file) {
+        Serial.println("RAW stream: cannot open file or allocate ring");
+        delete stream;
+        return nullptr;
+    }
+
+    RawTxProducer producer = {stream, &file, false, true};
+#if CONFIG_FREERTOS_UNICORE
+    BaseType_t res = xTaskCreate(rawTxProducerTask, "raw_tx", 4096, &producer, 2, nullptr);
+#else
+    // the transmit loop busy-waits on the Arduino loop core, the reader gets the other one
+    BaseType_t res = xTaskCreatePinnedToCore(rawTxProducerTask, "raw_tx", 4096, &producer, 2, nullptr, 0);
+#endif
+    if (res != pdPASS) {
+        Serial.println("RAW stream: cannot start reader task");
+        file.close();
+        delete stream;
+        return nullptr;
+    }
+
+    const int pin = rfTxPin();
+    uint32_t underruns = 0;
+    const SubDataLine *last = nullptr;
+    for (const SubDataLine &l : sub.lines) {
+        last = &l;
+        if (l.kind != SUB_DATA_TIMINGS) {
+            sendCompiledSignal(tx, sub, bit, key, &l, hideDefaultUI);
+            if (check(EscPress)) break;
+            continue;
         }
-        initRfModule("tx", frequency / 1000000.0);
+        // let the reader get ahead before the radio goes on
+        while (stream->pending() < RAW_TX_RING / 2 && !stream->done()) vTaskDelay(1);
+        const bool transmit = beginRfTx(tx, sub.frequency, sub.preset, sub.presetName);
+        if (transmit && !hideDefaultUI) { displayTextLine("Sending.."); }
+        rawStreamLine(*stream, pin, transmit, underruns);
+        if (transmit) tx.signalDone(true);
+        if (check(EscPress)) break;
     }
 
+    producer.stop = true;
+    while (producer.running) vTaskDelay(1);
+    const RawStreamStats stats = stream->stats();
+    Serial.printf(
+        "RAW stream: %lu bytes, %lu lines, %lu timings, ring peak %lu/%u, %lu underruns\n",
+        (unsigned long)stats.bytes,
+        (unsigned long)stats.lines,
+        (unsigned long)stats.durations,
+        (unsigned long)stats.highWater,
+        (unsigned)RAW_TX_RING,
+        (unsigned long)underruns
+    );
+    file.close();
+    delete stream;
+    return last;
+}
+
+void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
+    uint32_t frequency = rfcode.frequency;
+    String protocol = rfcode.protocol;
+    String preset = rfcode.preset;
+    uint64_t key = rfcode.key;
+    /*
+        Serial.println("sendRawRfCommand");
+        Serial.println(data);
+        Serial.println(frequency);
+        Serial.println(preset);
+        Serial.println(protocol);
+      */
+
+    uint8_t rcswitch_protocol_no = 1;
+    const uint8_t presetId = subPresetId(preset.c_str(), rcswitch_protocol_no);
+    RfTx tx(rfRadio);
+    if (!beginRfTx(tx, frequency, presetId, preset.c_str())) return;
+
     if (protocol == "RAW") {
-        // count the number of elements of RAW_Data
-        int buff_size = 0;
-        int index = 0;
-        while (index >= 0) {
-            index = data.indexOf(' ', index + 1);
-            buff_size++;
-        }
-        // alloc buffer for transmittimings
-        int *transmittimings =
-            (int *)calloc(sizeof(int), buff_size + 1); // should be smaller the data.length()
-        size_t transmittimings_idx = 0;
-
-        // split data into words, convert to int, and store them in transmittimings
-        int startIndex = 0;
-        index = 0;
-        for (transmittimings_idx = 0; transmittimings_idx < buff_size; transmittimings_idx++) {
-            index = data.indexOf(' ', startIndex);
-            if (index == -1) {
-                transmittimings[transmittimings_idx] = data.substring(startIndex).toInt();
-            } else {
-                transmittimings[transmittimings_idx] = data.substring(startIndex, index).toInt();
+        // durations are read as the transmitter asks for them, no copy of the whole line
+        const char *text = rfcode.data.c_str();
+        const size_t len = rfcode.data.length();
+        size_t pos = 0;
+        bool ended = false;
+        RawDataTokenizer tokenizer;
+        auto next = [&](int32_t &t) {
+            bool have = false;
+            auto emit = [&](int32_t v) {
+                t = v;
+                have = true;
+            };
+            while (!have && pos < len) tokenizer.put(text[pos++], emit);
+            if (!have && !ended) {
+                tokenizer.end(emit);
+                ended = true;
             }
-            startIndex = index + 1;
-        }
-        transmittimings[transmittimings_idx] = 0; // termination
-
-        // send rf command
+            return have;
+        };
         if (!hideDefaultUI) { displayTextLine("Sending.."); }
-        RCSwitch_RAW_send(transmittimings);
-        free(transmittimings);
+        rawSend(rfTxPin(), next);
     } else if (protocol == "BinRAW") {
         // transform from "00 01 02 ... FF" into "00000000 00000001 00000010 .... 11111111"
         rfcode.data = hexStrToBinStr(rfcode.data);
@@ -291,7 +519,6 @@ void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
     }
 
     else if (protocol == "RcSwitch") {
-        data.replace(" ", ""); // remove spaces
         // uint64_t data_val = strtoul(data.c_str(), nullptr, 16);
         uint64_t data_val = rfcode.key;
         int bits = rfcode.Bit;
@@ -305,25 +532,29 @@ void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI) {
         Serial.println(rcswitch_protocol_no);
         */
         if (!hideDefaultUI) { displayTextLine("Sending.."); }
-        RCSwitch_send(data_val, bits, pulse, rcswitch_protocol_no, repeat);
+        rcswitchTransmit(data_val, bits, pulse, rcswitch_protocol_no, repeat);
     } else if (protocol.startsWith("Princeton")) {
-        RCSwitch_send(rfcode.key, rfcode.Bit, 350, 1, 10);
+        rcswitchTransmit(rfcode.key, rfcode.Bit, 350, 1, 10);
     } else {
         Serial.print("unsupported protocol: ");
         Serial.println(protocol);
         Serial.println("Sending RcSwitch 11 protocol");
         // if(protocol.startsWith("CAME") || protocol.startsWith("HOLTEC" || NICE)) {
-        RCSwitch_send(rfcode.key, rfcode.Bit, 270, 11, 10);
+        rcswitchTransmit(rfcode.key, rfcode.Bit, 270, 11, 10);
         //}
-
-        return;
     }
 
     // digitalWrite(bruceConfigPins.rfTx, LED_OFF);
-    deinitRfModule();
+    tx.end();
 }
 
 void RCSwitch_send(uint64_t data, unsigned int bits, int pulse, int protocol, int repeat) {
+    rcswitchTransmit(data, bits, pulse, protocol, repeat);
+    deinitRfModule();
+}
+
+// RCSwitch_send() leaving the radio as it is, for the signals of a session
+static void rcswitchTransmit(uint64_t data, unsigned int bits, int pulse, int protocol, int repeat) {
     // derived from
     // https://github.com/LSatan/SmartRC-CC1101-Driver-Lib/blob/master/examples/Rc-Switch%20examples%20cc1101/SendDemo_cc1101/SendDemo_cc1101.ino
 
@@ -349,8 +580,6 @@ void RCSwitch_send(uint64_t data, unsigned int bits, int pulse, int protocol, in
     */
 
     mySwitch.disableTransmit();
-
-    deinitRfModule();
 }
 
 // ported from https://github.com/sui77/rc-switch/blob/3a536a172ab752f3c7a58d831c5075ca24fd920b/RCSwitch.cpp
@@ -389,38 +618,38 @@ void RCSwitch_RAW_Bit_send(RfCodes data) {
     }
 }
 
-void RCSwitch_RAW_send(int *ptrtransmittimings) {
+// Same order as the String version walks "hexStrToBinStr" text: from the last bit of the last byte
+// back to the first bit
+void RCSwitch_RAW_Bit_send(const uint8_t *bytes, size_t count, int te) {
     int nTransmitterPin = bruceConfigPins.rfTx;
     if (bruceConfigPins.rfModule == CC1101_SPI_MODULE) { nTransmitterPin = bruceConfigPins.CC1101_bus.io0; }
 
-    if (!ptrtransmittimings) return;
-
-    bool currentlogiclevel = true;
-    int nRepeatTransmit = 1; // repeats RAW signal twice!
-    // HighLow pulses ;
-
-    for (int nRepeat = 0; nRepeat < nRepeatTransmit; nRepeat++) {
-        unsigned int currenttiming = 0;
-        while (ptrtransmittimings[currenttiming]) { // && currenttiming < RCSWITCH_MAX_CHANGES
-            if (ptrtransmittimings[currenttiming] >= 0) {
-                currentlogiclevel = true;
-            } else {
-                // negative value
-                currentlogiclevel = false;
-                ptrtransmittimings[currenttiming] = (-1) * ptrtransmittimings[currenttiming]; // invert sign
-            }
-
-            digitalWrite(nTransmitterPin, currentlogiclevel ? HIGH : LOW);
-            delayMicroseconds(ptrtransmittimings[currenttiming]);
+    if (!bytes || count == 0) return;
+    for (size_t i = count * 8; i > 0; --i) {
+        const size_t bit = i - 1;
+        const bool currentlogiclevel = (bytes[bit / 8] >> (7 - bit % 8)) & 1;
+        digitalWrite(nTransmitterPin, currentlogiclevel ? HIGH : LOW);
+        delayMicroseconds(te);
+    }
+    digitalWrite(nTransmitterPin, LOW);
+}
 
-            /*
-            Serial.print(ptrtransmittimings[currenttiming]);
-            Serial.print("=");
-            Serial.println(currentlogiclevel);
-            */
+void RCSwitch_RAW_send(const int32_t *timings, size_t count) {
+    if (!timings) return;
+    size_t i = 0;
+    auto next = [&](int32_t &t) {
+        if (i >= count) return false;
+        t = timings[i++];
+        return true;
+    };
+    rawSend(rfTxPin(), next);
+}
 
-            currenttiming++;
-        }
-        digitalWrite(nTransmitterPin, LOW);
-    } // end for
+// Zero terminated, as sendRfCommand() builds them
+void RCSwitch_RAW_send(int *ptrtransmittimings) {
+    if (!ptrtransmittimings) return;
+    size_t count = 0;
+    while (ptrtransmittimings[count]) count++;
+    std::vector<int32_t> timings(ptrtransmittimings, ptrtransmittimings + count);
+    RCSwitch_RAW_send(timings.data(), timings.size());
 }
@@ -2,14 +2,20 @@
 #define __RF_SEND_H__
 
 #include "structs.h"
+#include "sub_compiler.h"
 
 void sendCustomRF();
 bool txSubFile(FS *fs, String filepath, bool hideDefaultUI = false);
 
 void sendRfCommand(struct RfCodes rfcode, bool hideDefaultUI = false);
+void sendCompiledSub(
+    const CompiledSub &sub, int bit, uint64_t key, const SubDataLine *line, bool hideDefaultUI = false
+);
 void RCSwitch_send(uint64_t data, unsigned int bits, int pulse = 0, int protocol = 1, int repeat = 10);
 
 void RCSwitch_RAW_Bit_send(RfCodes data);
+void RCSwitch_RAW_Bit_send(const uint8_t *bytes, size_t count, int te);
 void RCSwitch_RAW_send(int *ptrtransmittimings);
+void RCSwitch_RAW_send(const int32_t *timings, size_t count);
 
 #endif
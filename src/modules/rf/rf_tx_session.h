@@ -0,0 +1,158 @@
+#ifndef __RF_TX_SESSION_H__
+#define __RF_TX_SESSION_H__
+// Keeps the radio set up across the signals of one transmission (the codes and RAW_Data lines of a
+// .sub file) instead of a full init before and a deinit after each of them. The first signal inits
+// the module; later ones with the same frequency only rewrite the settings that differ and go back
+// to TX. A different frequency still gets a full init, which also validates it. The time from the
+// end of one signal to the radio being ready for the next is kept as the inter-signal gap.
+// RadioT provides
+//   bool supports(const RfTxConfig &)   // the module can send with this modulation
+//   bool init(const RfTxConfig &)       // initRfModule() with cfg.frequency
+//   void setModulation(uint8_t), setDeviation(float), setRxBW(float), setDataRate(float), setPower(int8_t)
+//   void startTx(), idle(), deinit()
+//   uint32_t nowUs()
+// Plain C++ so the write sequence can be checked against a mock radio off-target.
+#include <stdint.h>
+
+struct RfTxConfig {
+    uint32_t frequency = 0; // Hz
+    uint8_t modulation = 2; // CC1101: 0 = 2-FSK, 1 = GFSK, 2 = ASK/OOK, 3 = 4-FSK, 4 = MSK
+    float deviation = 1.58; // kHz, 0 leaves the module's value
+    float rxBW = 270.83;    // kHz, 0 leaves the module's value
+    float dataRate = 10;    // kBaud, 0 leaves the module's value
+    int8_t power = 12;      // dBm
+};
+
+struct RfTxSessionStats {
+    uint32_t signals = 0;
+    uint32_t inits = 0;     // full module inits
+    uint32_t reconfigs = 0; // signals that changed settings without an init
+    uint32_t writes = 0;    // settings written, inits included
+    uint32_t gaps = 0;      // gaps measured, the first signal has none
+    uint32_t gapMinUs = 0;
+    uint32_t gapMaxUs = 0;
+    uint64_t gapSumUs = 0;
+
+    uint32_t gapAvgUs() const { return gaps ? gapSumUs / gaps : 0; }
+};
+
+template <typename RadioT> class RfTxSession {
+public:
+    explicit RfTxSession(RadioT &radio) : radio_(radio) {}
+    RfTxSession(const RfTxSession &) = delete;
+    RfTxSession &operator=(const RfTxSession &) = delete;
+    ~RfTxSession() { end(); }
+
+    // Gets the radio ready to send a signal with cfg. false when the module cannot (modulation not
+    // supported, init failed); the signal must be skipped then.
+    bool begin(const RfTxConfig &cfg) {
+        if (!radio_.supports(cfg)) return false;
+        if (active_ && cfg.frequency != cfg_.frequency) end();
+        if (!active_) {
+            if (!radio_.init(cfg)) return false;
+            stats_.inits++;
+            active_ = true;
+            transmitting_ = false;
+            cfg_ = cfg;
+            writeAll();
+        } else if (apply(cfg)) {
+            stats_.reconfigs++;
+        }
+        if (!transmitting_) {
+            radio_.startTx();
+            transmitting_ = true;
+        }
+        stats_.signals++;
+        if (signalEnded_) {
+            const uint32_t gap = radio_.nowUs() - endedUs_;
+            if (stats_.gaps == 0 || gap < stats_.gapMinUs) stats_.gapMinUs = gap;
+            if (gap > stats_.gapMaxUs) stats_.gapMaxUs = gap;
+            stats_.gapSumUs += gap;
+            stats_.gaps++;
+            signalEnded_ = false;
+        }
+        return true;
+    }
+
+    // The signal begin() was for has been sent. The radio idles until the next begin() unless
+    // keepTx, for signals that continue one another (the RAW_Data lines of one capture).
+    void signalDone(bool keepTx = false) {
+        if (!active_) return;
+        if (!keepTx && transmitting_) {
+            radio_.idle();
+            transmitting_ = false;
+        }
+        endedUs_ = radio_.nowUs();
+        signalEnded_ = true;
+    }
+
+    void end() {
+        if (!active_) return;
+        radio_.deinit();
+        active_ = false;
+        transmitting_ = false;
+        signalEnded_ = false;
+    }
+
+    bool active() const { return active_; }
+    const RfTxSessionStats &stats() const { return stats_; }
+
+private:
+    // The order the single-signal path always used
+    void writeAll() {
+        radio_.setModulation(cfg_.modulation);
+        stats_.writes++;
+        if (cfg_.deviation) write(&RadioT::setDeviation, cfg_.deviation);
+        if (cfg_.rxBW) write(&RadioT::setRxBW, cfg_.rxBW);
+        if (cfg_.dataRate) write(&RadioT::setDataRate, cfg_.dataRate);
+        radio_.setPower(cfg_.power);
+        stats_.writes++;
+    }
+
+    // Writes what differs from the current settings, true when anything did. The radio must not be
+    // transmitting while they change.
+    bool apply(const RfTxConfig &cfg) {
+        const bool changes = cfg.modulation != cfg_.modulation ||
+                             (cfg.deviation && cfg.deviation != cfg_.deviation) ||
+                             (cfg.rxBW && cfg.rxBW != cfg_.rxBW) ||
+                             (cfg.dataRate && cfg.dataRate != cfg_.dataRate) || cfg.power != cfg_.power;
+        if (!changes) return false;
+        if (transmitting_) {
+            radio_.idle();
+            transmitting_ = false;
+        }
+        if (cfg.modulation != cfg_.modulation) {
+            radio_.setModulation(cfg.modulation);
+            stats_.writes++;
+        }
+        if (cfg.deviation && cfg.deviation != cfg_.deviation) write(&RadioT::setDeviation, cfg.deviation);
+        if (cfg.rxBW && cfg.rxBW != cfg_.rxBW) write(&RadioT::setRxBW, cfg.rxBW);
+        if (cfg.dataRate && cfg.dataRate != cfg_.dataRate) write(&RadioT::setDataRate, cfg.dataRate);
+        if (cfg.power != cfg_.power) {
+            radio_.setPower(cfg.power);
+            stats_.writes++;
+        }
+        // a 0 keeps what the module has, so the old value stays current
+        const RfTxConfig old = cfg_;
+        cfg_ = cfg;
+        if (!cfg.deviation) cfg_.deviation = old.deviation;
+        if (!cfg.rxBW) cfg_.rxBW = old.rxBW;
+        if (!cfg.dataRate) cfg_.dataRate = old.dataRate;
+        return true;
+    }
+
+    void write(void (RadioT::*set)(float), float value) {
+        (radio_.*set)(value);
+        stats_.writes++;
+    }
+
+    RadioT &radio_;
+    RfTxConfig cfg_;
+    bool active_ = false;
+    bool transmitting_ = false;
+    bool signalEnded_ = false;
+    uint32_t endedUs_ = 0;
+    RfTxSessionStats stats_;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "rmt_tx.h"
+#include <esp_timer.h>
+
+static_assert(sizeof(rmt_symbol_word_t) == sizeof(uint32_t), "RMT symbols are 32-bit words");
+
+#define RMT_TX_WAIT_MARGIN_MS 500
+
+bool IRAM_ATTR RmtRawTx::onTransDone(rmt_channel_handle_t, const rmt_tx_done_event_data_t *, void *ctx) {
+    RmtRawTx &tx = *(RmtRawTx *)ctx;
+    tx.doneUs_[tx.doneSlot_] = esp_timer_get_time();
+    tx.doneSlot_ ^= 1;
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(tx.doneSem_, &woken);
+    return woken == pdTRUE;
+}
+
+bool RmtRawTx::open(int pin) {
+    if (!doneSem_) doneSem_ = xSemaphoreCreateCounting(2, 0);
+    if (!doneSem_) return false;
+    while (xSemaphoreTake(doneSem_, 0) == pdTRUE) {}
+
+    rmt_tx_channel_config_t cfg = {};
+    cfg.gpio_num = gpio_num_t(pin);
+    cfg.clk_src = RMT_CLK_SRC_DEFAULT;
+    cfg.resolution_hz = RMT_TX_RESOLUTION_HZ;
+    cfg.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+    cfg.trans_queue_depth = 2;
+    cfg.intr_priority = 0;
+    if (rmt_new_tx_channel(&cfg, &channel_) != ESP_OK) {
+        channel_ = nullptr;
+        return false;
+    }
+    rmt_copy_encoder_config_t encCfg = {};
+    rmt_tx_event_callbacks_t cbs = {};
+    cbs.on_trans_done = onTransDone;
+    if (rmt_new_copy_encoder(&encCfg, &copyEncoder_) != ESP_OK ||
+        rmt_tx_register_event_callbacks(channel_, &cbs, this) != ESP_OK || rmt_enable(channel_) != ESP_OK) {
+        if (copyEncoder_) rmt_del_encoder(copyEncoder_);
+        rmt_del_channel(channel_);
+        copyEncoder_ = nullptr;
+        channel_ = nullptr;
+        return false;
+    }
+
+    pin_ = pin;
+    next_ = oldest_ = queued_ = 0;
+    doneSlot_ = 0;
+    firstUs_ = lastDoneUs_ = 0;
+    errorSumUs_ = 0;
+    stats_ = RmtTxReport();
+    return true;
+}
+
+bool RmtRawTx::queue(size_t symbols) {
+    uint32_t ticks = 0;
+    for (size_t i = 0; i < symbols; ++i) {
+        ticks += rmtDuration0(blocks_[next_][i]) + rmtDuration1(blocks_[next_][i]);
+    }
+    blockUs_[next_] = ticks; // 1 tick = 1 us
+    queuedUs_[next_] = esp_timer_get_time();
+    if (stats_.blocks == 0) firstUs_ = lastDoneUs_ = queuedUs_[next_];
+
+    rmt_transmit_config_t txCfg = {};
+    txCfg.loop_count = 0;
+    txCfg.flags.eot_level = 0;
+    if (rmt_transmit(channel_, copyEncoder_, blocks_[next_], symbols * sizeof(uint32_t), &txCfg) != ESP_OK) {
+        return false;
+    }
+    stats_.symbols += symbols;
+    stats_.blocks++;
+    stats_.expectedUs += ticks;
+    next_ ^= 1;
+    queued_++;
+    return true;
+}
+
+// Waits for the block queued first and accounts for how long it took on the air
+bool RmtRawTx::waitOldest() {
+    const TickType_t wait = pdMS_TO_TICKS(blockUs_[oldest_] / 1000 + RMT_TX_WAIT_MARGIN_MS);
+    if (xSemaphoreTake(doneSem_, wait) != pdTRUE) return false;
+
+    const int64_t done = doneUs_[oldest_];
+    // a block starts when the one before it is done, or when it is queued if that came later
+    int64_t start = lastDoneUs_;
+    if (queuedUs_[oldest_] > start) {
+        stats_.starved++;
+        start = queuedUs_[oldest_];
+    }
+    const int64_t error = (done - start) - (int64_t)blockUs_[oldest_];
+    const uint32_t absError = error < 0 ? -error : error;
+    if (absError > stats_.maxBlockErrorUs) stats_.maxBlockErrorUs = absError;
+    errorSumUs_ += absError;
+    lastDoneUs_ = done;
+    oldest_ ^= 1;
+    queued_--;
+    return true;
+}
+
+void RmtRawTx::close(RmtTxReport *report) {
+    if (channel_) {
+        rmt_tx_wait_all_done(channel_, RMT_TX_WAIT_MARGIN_MS);
+        rmt_disable(channel_);
+        rmt_del_channel(channel_);
+        channel_ = nullptr;
+    }
+    if (copyEncoder_) {
+        rmt_del_encoder(copyEncoder_);
+        copyEncoder_ = nullptr;
+    }
+    // hand the pin back to GPIO, low, as the bit-banged senders leave it
+    pinMode(pin_, OUTPUT);
+    digitalWrite(pin_, LOW);
+
+    stats_.measuredUs = lastDoneUs_ - firstUs_;
+    if (stats_.blocks) stats_.meanBlockErrorUs = errorSumUs_ / stats_.blocks;
+    if (report) *report = stats_;
+}
@@ -0,0 +1,85 @@
+#ifndef __RMT_TX_H__
+#define __RMT_TX_H__
+// Sub-GHz RAW transmit on the RMT peripheral instead of digitalWrite()/delayMicroseconds(). The
+// durations are encoded (rmt_tx_encoder.h) into two symbol blocks that take turns: one is sent while
+// the other is filled, so a signal can be any length, and the pulse timing no longer depends on
+// interrupts or on what the other core is doing. Each block's send time is measured against its
+// encoded length and reported as the jitter of the transmission.
+#include "rmt_tx_encoder.h"
+#include <Arduino.h>
+#include <driver/rmt_tx.h>
+
+#define RMT_TX_RESOLUTION_HZ 1000000 // 1 tick = 1 us, like the receive side
+#define RMT_TX_BLOCK_SYMBOLS 256     // per block, two blocks
+
+struct RmtTxReport {
+    uint32_t symbols = 0;
+    uint32_t blocks = 0;
+    uint32_t expectedUs = 0;      // the durations as rounded to ticks
+    uint32_t measuredUs = 0;      // first block queued to last block done
+    uint32_t maxBlockErrorUs = 0; // largest |sent - encoded| length of a block
+    uint32_t meanBlockErrorUs = 0;
+    uint32_t starved = 0; // blocks queued after the one before had finished, the line idled low
+};
+
+class RmtRawTx {
+public:
+    RmtRawTx() = default;
+    RmtRawTx(const RmtRawTx &) = delete;
+    RmtRawTx &operator=(const RmtRawTx &) = delete;
+
+    // Sends the durations next(int32_t &) hands over until it returns false. false when the RMT
+    // channel could not be set up; nothing was pulled from next then, so the caller can bit-bang.
+    template <typename NextFn> bool send(int pin, NextFn &next, RmtTxReport *report = nullptr) {
+        if (!open(pin)) return false;
+        RmtPulseEncoder encoder(RMT_TX_RESOLUTION_HZ);
+        bool ok = true;
+        for (;;) {
+            if (queued_ == 2 && !waitOldest()) {
+                ok = false;
+                break;
+            }
+            // a block ends in a low period when it can, the gap between two blocks is low too
+            const size_t n =
+                encoder.encode(next, blocks_[next_], RMT_TX_BLOCK_SYMBOLS, RMT_TX_BLOCK_SYMBOLS * 3 / 4);
+            if (n == 0) break;
+            if (!queue(n)) {
+                ok = false;
+                break;
+            }
+        }
+        while (ok && queued_ > 0) ok = waitOldest();
+        if (!ok) {
+            int32_t rest; // drop what was not sent, next() may be reading a stream
+            while (next(rest)) {}
+        }
+        close(report);
+        return true;
+    }
+
+private:
+    bool open(int pin);
+    bool queue(size_t symbols);
+    bool waitOldest(void);
+    void close(RmtTxReport *report);
+    static bool onTransDone(rmt_channel_handle_t, const rmt_tx_done_event_data_t *, void *ctx);
+
+    uint32_t blocks_[2][RMT_TX_BLOCK_SYMBOLS]; // rmt_symbol_word_t layout
+    int pin_ = -1;
+    rmt_channel_handle_t channel_ = nullptr;
+    rmt_encoder_handle_t copyEncoder_ = nullptr;
+    SemaphoreHandle_t doneSem_ = nullptr;
+    uint8_t next_ = 0;   // block to fill
+    uint8_t oldest_ = 0; // block sent first among the queued ones
+    uint8_t queued_ = 0;
+    volatile int64_t doneUs_[2] = {0, 0}; // set by the ISR, in queue order
+    volatile uint8_t doneSlot_ = 0;
+    int64_t queuedUs_[2] = {0, 0};
+    uint32_t blockUs_[2] = {0, 0};
+    int64_t firstUs_ = 0;
+    int64_t lastDoneUs_ = 0;
+    uint64_t errorSumUs_ = 0;
+    RmtTxReport stats_;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef __RMT_TX_ENCODER_H__
+#define __RMT_TX_ENCODER_H__
+// Signed durations (us, high when positive, low when negative) to RMT symbols. Every symbol holds two
+// halves of up to RMT_HALF_MAX_TICKS each, so pulses longer than that are split into several halves
+// of the same level, and pulses of the same level in a row are merged. Durations are rounded to
+// ticks with the rounding error carried to the next one, so every edge stays within half a tick
+// of where the durations put it, however long the signal. A zero tick count would end the
+// transmission early, so no half is ever 0 except after the very last one.
+// Words use the rmt_symbol_word_t layout: duration0:15, level0:1, duration1:15, level1:1. Plain
+// C++ so the encoder can be checked off-target.
+#include <stddef.h>
+#include <stdint.h>
+
+const uint32_t RMT_HALF_MAX_TICKS = 0x7FFF;
+
+inline uint32_t rmtSymbolWord(uint32_t duration0, bool level0, uint32_t duration1, bool level1) {
+    return (duration0 & 0x7FFF) | (uint32_t)level0 << 15 | (duration1 & 0x7FFF) << 16 |
+           (uint32_t)level1 << 31;
+}
+inline uint32_t rmtDuration0(uint32_t w) { return w & 0x7FFF; }
+inline bool rmtLevel0(uint32_t w) { return (w >> 15) & 1; }
+inline uint32_t rmtDuration1(uint32_t w) { return (w >> 16) & 0x7FFF; }
+inline bool rmtLevel1(uint32_t w) { return w >> 31; }
+
+class RmtPulseEncoder {
+public:
+    explicit RmtPulseEncoder(uint32_t resolutionHz) : resolutionHz_(resolutionHz) {}
+
+    // Fills out with up to maxSymbols symbols from the durations next(int32_t &) hands over, until it
+    // returns false. Once minSymbols are written the block ends at the first symbol that ends low,
+    // so the short idle between two blocks falls inside a low period. Returns the symbols written, 0
+    // once everything was encoded.
+    template <typename NextFn>
+    size_t encode(NextFn &next, uint32_t *out, size_t maxSymbols, size_t minSymbols = SIZE_MAX) {
+        size_t n = 0;
+        while (n < maxSymbols) {
+            bool wrote = false;
+            if (haveRun_ && runTicks_ > RMT_HALF_MAX_TICKS) {
+                wrote = half(RMT_HALF_MAX_TICKS, runLevel_, out + n);
+                runTicks_ -= RMT_HALF_MAX_TICKS;
+            } else if (inputDone_) {
+                if (haveRun_) {
+                    wrote = half((uint32_t)runTicks_, runLevel_, out + n);
+                    haveRun_ = false;
+                } else if (halfPending_) {
+                    out[n] = rmtSymbolWord(halfTicks_, halfLevel_, 0, false); // the end marker
+                    halfPending_ = false;
+                    wrote = true;
+                } else {
+                    break;
+                }
+            } else {
+                int32_t d;
+                if (!next(d)) {
+                    inputDone_ = true;
+                    continue;
+                }
+                const bool level = d > 0;
+                const uint64_t ticks = toTicks(d);
+                if (ticks == 0) continue; // shorter than half a tick, its time carries over
+                inputTicks_ += ticks;
+                if (haveRun_ && level == runLevel_) {
+                    runTicks_ += ticks;
+                    continue;
+                }
+                if (haveRun_) wrote = half((uint32_t)runTicks_, runLevel_, out + n);
+                haveRun_ = true;
+                runLevel_ = level;
+                runTicks_ = ticks;
+            }
+            if (!wrote) continue;
+            symbols_++;
+            if (++n >= minSymbols && !rmtLevel1(out[n - 1])) break;
+        }
+        return n;
+    }
+
+    bool finished() const { return inputDone_ && !haveRun_ && !halfPending_; }
+    uint64_t ticks() const { return inputTicks_; } // total length encoded so far
+    uint32_t symbols() const { return symbols_; }
+
+    void reset() { *this = RmtPulseEncoder(resolutionHz_); }
+
+private:
+    // Round to nearest, the remainder goes to the next duration
+    uint64_t toTicks(int32_t d) {
+        const uint64_t us = d < 0 ? 0u - (uint64_t)(int64_t)d : (uint64_t)d;
+        const int64_t exact = (int64_t)(us * resolutionHz_) + error_; // in 1e-6 ticks
+        if (exact <= 0) {
+            error_ = exact;
+            return 0;
+        }
+        const uint64_t ticks = ((uint64_t)exact + 500000) / 1000000;
+        error_ = exact - (int64_t)(ticks * 1000000);
+        return ticks;
+    }
+
+    // Pairs halves into symbols, true when one was written
+    bool half(uint32_t ticks, bool level, uint32_t *out) {
+        if (!halfPending_) {
+            halfPending_ = true;
+            halfTicks_ = ticks;
+            halfLevel_ = level;
+            return false;
+        }
+        *out = rmtSymbolWord(halfTicks_, halfLevel_, ticks, level);
+        halfPending_ = false;
+        return true;
+    }
+
+    uint32_t resolutionHz_;
+    int64_t error_ = 0; // rounding error carried, in 1e-6 ticks
+    bool inputDone_ = false;
+    bool haveRun_ = false;
+    bool runLevel_ = false;
+    uint64_t runTicks_ = 0;
+    bool halfPending_ = false;
+    bool halfLevel_ = false;
+    uint32_t halfTicks_ = 0;
+    uint64_t inputTicks_ = 0;
+    uint32_t symbols_ = 0;
+};
+
+#endif
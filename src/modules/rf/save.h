@@ -2,5 +2,7 @@
 #define RF_SAVE_H
 #include "structs.h"
 
-bool rf_raw_save(RawRecording recorded);
+// Everything of a RAW .sub file before its RAW_Data lines
+bool rf_raw_write_header(File &file, float frequency);
+bool rf_raw_save(RawRecording &recorded);
 #endif
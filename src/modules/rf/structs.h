@@ -2,14 +2,18 @@
 #define RF_STRUCTS_H
 
 #include "core/display.h"
+#include "rf_capture.h"
 #include <driver/rmt_rx.h>
 #include <driver/rmt_tx.h>
 
 struct RawRecording {
-    float frequency;
-    std::vector<rmt_symbol_word_t *> codes;
-    std::vector<uint16_t> codeLengths;
-    std::vector<uint16_t> gaps;
+    float frequency = 0.f;
+    int32_t *memory = nullptr; // arena storage, allocated once per session
+    RfCaptureArena arena;
+    FS *spillFs = nullptr;     // where the arena spilled, the whole recording is in the file then
+    String spillPath = "";
+    bool spillSaved = false;   // the spill file already became a raw_N.sub
+    bool spillComplete = true; // the last of the arena made it into the spill file
 };
 
 struct RawRecordingStatus {
@@ -33,6 +37,7 @@ struct RfCodes {
     String filepath = "";
     int Bit = 0;
     int BitRAW = 0;
+    String decoded = ""; // best protocol decode of a RAW capture, shown only
 };
 
 struct FreqFound {
@@ -0,0 +1,67 @@
+#include "sub_cache.h"
+
+#define SUB_CACHE_MAX_BYTES (512 * 1024) // bigger sidecars are not read, the source is compiled instead
+
+static String sub_cache_path(const String &path) {
+    char name[sizeof(SUB_CACHE_DIR) + 16];
+    snprintf(name, sizeof(name), SUB_CACHE_DIR "/%08lx.bsub", (unsigned long)subCachePathHash(path.c_str()));
+    return String(name);
+}
+
+static bool read_sidecar(FS *fs, const String &cachePath, const SubSourceKey &key, CompiledSub &out) {
+    File f = fs->open(cachePath, FILE_READ);
+    if (!f) return false;
+    const size_t size = f.size();
+    if (size == 0 || size > SUB_CACHE_MAX_BYTES) {
+        f.close();
+        return false;
+    }
+    uint8_t *buf = (uint8_t *)malloc(size);
+    bool ok = false;
+    if (buf) {
+        ok = f.read(buf, size) == size && loadCompiledSub(buf, size, key, out);
+        free(buf);
+    }
+    f.close();
+    return ok;
+}
+
+static void write_sidecar(FS *fs, const String &cachePath, const SubSourceKey &key, const CompiledSub &sub) {
+    if (!fs->exists("/BruceRF")) fs->mkdir("/BruceRF");
+    if (!fs->exists(SUB_CACHE_DIR)) fs->mkdir(SUB_CACHE_DIR);
+    File f = fs->open(cachePath, FILE_WRITE);
+    if (!f) return;
+    const bool ok = writeCompiledSub(f, sub, key);
+    f.close();
+    if (!ok) fs->remove(cachePath); // a short write, most likely a full card
+}
+
+bool load_sub_file(FS *fs, const String &path, CompiledSub &out, bool *usedCache) {
+    if (usedCache) *usedCache = false;
+    if (!fs) return false;
+    File source = fs->open(path, FILE_READ);
+    if (!source) return false;
+
+    SubSourceKey key;
+    key.size = source.size();
+    if (key.size >= SUB_STREAM_MIN_BYTES) {
+        compileSub(source, out, true);
+        source.close();
+        return true;
+    }
+    key.mtime = (uint32_t)source.getLastWrite();
+    // Without a modification time an edit of the same length would go unnoticed (temporary files)
+    const bool cacheable = key.mtime != 0 && !path.startsWith(SUB_CACHE_DIR);
+    const String cachePath = sub_cache_path(path);
+
+    if (cacheable && read_sidecar(fs, cachePath, key, out)) {
+        source.close();
+        if (usedCache) *usedCache = true;
+        return true;
+    }
+
+    compileSub(source, out);
+    source.close();
+    if (cacheable) write_sidecar(fs, cachePath, key, out);
+    return true;
+}
@@ -0,0 +1,16 @@
+#ifndef __SUB_CACHE_H__
+#define __SUB_CACHE_H__
+// .sub files compiled once (see sub_compiler.h); the sidecars live in /BruceRF/.subcache on the
+// same filesystem as the source and are rebuilt when its size or mtime changes.
+#include "sub_compiler.h"
+#include <FS.h>
+
+#define SUB_CACHE_DIR "/BruceRF/.subcache"
+#define SUB_STREAM_MIN_BYTES (24 * 1024) // bigger files keep RAW_Data in the file, see raw_stream.h
+
+// Loads the sidecar for path, or compiles the file and writes one. false when the file cannot be
+// opened. usedCache tells whether the text was parsed at all. Files of SUB_STREAM_MIN_BYTES or more
+// are compiled with their RAW_Data left to be streamed (out.streamed) and are not cached.
+bool load_sub_file(FS *fs, const String &path, CompiledSub &out, bool *usedCache = nullptr);
+
+#endif
@@ -0,0 +1,507 @@
+#ifndef __SUB_COMPILER_H__
+#define __SUB_COMPILER_H__
+// Flipper .sub files compiled once into a binary sidecar: frequency, preset and protocol ids and
+// the RAW timings / BinRAW bytes already decoded, so a transmission loads arrays instead of
+// parsing text. The compiler streams the source in chunks and reproduces what the line parser in
+// txSubFile() and sendRfCommand() made of a file, quirks included:
+//  - RAW_Data is split on single spaces and every token read like String::toInt(), so an empty
+//    token reads 0, and the first 0 ends the signal (RCSwitch_RAW_send stops there);
+//  - Data_RAW is read like hexStrToBinStr(), every two hex digits make one byte;
+//  - Key is read like hexStringToDecimal(), one byte per three characters, 32 bits kept.
+// The sidecar is only valid for the source size and mtime it records. Plain C++ so the compiler
+// can be checked against the text parser off-target.
+#include "raw_stream.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+const uint8_t SUB_NAME_MAX = 63;   // Protocol / Preset names, longer ones are cut
+const uint8_t SUB_VALUE_MAX = 127; // other non-data values, longer ones are cut
+const uint8_t SUB_CACHE_VERSION = 1;
+const uint32_t SUB_STREAM_KEEP_MAX = 1024; // timings of the last line a streamed compile keeps
+
+enum SubPreset : uint8_t {
+    SUB_PRESET_UNSUPPORTED,
+    SUB_PRESET_OOK270,
+    SUB_PRESET_OOK650,
+    SUB_PRESET_2FSK238,
+    SUB_PRESET_2FSK476,
+    SUB_PRESET_MSK99_97,
+    SUB_PRESET_GFSK9_99,
+    SUB_PRESET_RCSWITCH, // a bare RCSwitch protocol number, 0..29
+};
+
+enum SubProtocol : uint8_t {
+    SUB_PROTOCOL_OTHER, // sent as RCSwitch protocol 11
+    SUB_PROTOCOL_RAW,
+    SUB_PROTOCOL_BINRAW,
+    SUB_PROTOCOL_RCSWITCH,
+    SUB_PROTOCOL_PRINCETON,
+};
+
+enum SubDataKind : uint8_t {
+    SUB_DATA_TIMINGS, // RAW_Data: signed durations in us, high when positive
+    SUB_DATA_BYTES,   // Data_RAW: BinRAW bytes, sent MSB first
+};
+
+// Flipper preset name, or an RCSwitch protocol number written out as "0".."29"
+inline uint8_t subPresetId(const char *name, uint8_t &rcswitchProtocol) {
+    static const struct {
+        const char *name;
+        uint8_t id;
+    } presets[] = {
+        {"FuriHalSubGhzPresetOok270Async",     SUB_PRESET_OOK270  },
+        {"FuriHalSubGhzPresetOok650Async",     SUB_PRESET_OOK650  },
+        {"FuriHalSubGhzPreset2FSKDev238Async", SUB_PRESET_2FSK238 },
+        {"FuriHalSubGhzPreset2FSKDev476Async", SUB_PRESET_2FSK476 },
+        {"FuriHalSubGhzPresetMSK99_97KbAsync", SUB_PRESET_MSK99_97},
+        {"FuriHalSubGhzPresetGFSK9_99KbAsync", SUB_PRESET_GFSK9_99},
+    };
+    rcswitchProtocol = 1;
+    for (const auto &p : presets) {
+        if (strcmp(name, p.name) == 0) {
+            if (p.id == SUB_PRESET_OOK650) rcswitchProtocol = 2;
+            return p.id;
+        }
+    }
+    const size_t len = strlen(name);
+    if (len == 0 || len > 2 || name[0] < '0' || name[0] > '9') return SUB_PRESET_UNSUPPORTED;
+    if (len == 2 && (name[0] == '0' || name[1] < '0' || name[1] > '9')) return SUB_PRESET_UNSUPPORTED;
+    const int n = len == 1 ? name[0] - '0' : (name[0] - '0') * 10 + name[1] - '0';
+    if (n >= 30) return SUB_PRESET_UNSUPPORTED;
+    rcswitchProtocol = n;
+    return SUB_PRESET_RCSWITCH;
+}
+
+inline uint8_t subProtocolId(const char *name) {
+    if (strcmp(name, "RAW") == 0) return SUB_PROTOCOL_RAW;
+    if (strcmp(name, "BinRAW") == 0) return SUB_PROTOCOL_BINRAW;
+    if (strcmp(name, "RcSwitch") == 0) return SUB_PROTOCOL_RCSWITCH;
+    if (strncmp(name, "Princeton", 9) == 0) return SUB_PROTOCOL_PRINCETON;
+    return SUB_PROTOCOL_OTHER;
+}
+
+struct SubDataLine {
+    uint8_t kind;
+    uint32_t offset; // into CompiledSub::timings or ::bytes
+    uint32_t count;
+};
+
+struct CompiledSub {
+    uint32_t frequency = 0;
+    int32_t te = 0;
+    uint8_t preset = SUB_PRESET_UNSUPPORTED;
+    uint8_t rcswitchProtocol = 1;
+    uint8_t protocol = SUB_PROTOCOL_OTHER;
+    char protocolName[SUB_NAME_MAX + 1] = "";
+    char presetName[SUB_NAME_MAX + 1] = "";
+    std::vector<int32_t> bits;      // one transmission each, in file order
+    std::vector<int32_t> bitRaws;   // then these
+    std::vector<uint32_t> keys;     // then these
+    std::vector<SubDataLine> lines; // then one transmission per data line
+    std::vector<int32_t> timings;
+    std::vector<uint8_t> bytes;
+    // RAW_Data left in the file to be streamed (raw_stream.h): lines still carry their counts but
+    // timings only holds the start of the last RAW_Data line
+    bool streamed = false;
+
+    // What txSubFile() requires before it sends anything
+    bool complete() const { return protocolName[0] != '\0' && presetName[0] != '\0' && frequency > 0; }
+
+    const int32_t *lineTimings(const SubDataLine &line) const { return timings.data() + line.offset; }
+    const uint8_t *lineBytes(const SubDataLine &line) const { return bytes.data() + line.offset; }
+
+    void clear() { *this = CompiledSub(); }
+};
+
+// Streaming .sub compiler, feed() the file in chunks of any size then finish()
+class SubCompiler {
+public:
+    explicit SubCompiler(CompiledSub &out, bool streamTimings = false) : out_(out) {
+        out_.clear();
+        out_.streamed = streamTimings;
+        startLine();
+    }
+
+    void feed(const uint8_t *data, size_t len) {
+        for (size_t i = 0; i < len; ++i) put((char)data[i]);
+    }
+
+    // The last line may lack its newline
+    void finish() {
+        if (lineUsed_) endLine();
+        startLine();
+    }
+
+private:
+    enum Key : uint8_t {
+        KEY_NONE,
+        KEY_PROTOCOL,
+        KEY_PRESET,
+        KEY_FREQUENCY,
+        KEY_TE,
+        KEY_BIT,
+        KEY_BIT_RAW,
+        KEY_KEY,
+        KEY_RAW_DATA,
+        KEY_DATA_RAW,
+    };
+    static const uint8_t KEY_MAX = 10; // "Frequency:"
+
+    static bool isSpace(char c) { return RawDataTokenizer::isSpace(c); }
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    // String::toInt(): atol() on the trimmed text, 32-bit long
+    static int32_t toInt(const char *s) {
+        while (isSpace(*s)) s++;
+        const bool neg = *s == '-';
+        if (*s == '-' || *s == '+') s++;
+        int64_t v = 0;
+        while (*s >= '0' && *s <= '9') {
+            v = v * 10 + (*s++ - '0');
+            if (v > (int64_t)INT32_MAX + 1) v = (int64_t)INT32_MAX + 1;
+        }
+        if (neg) return (int32_t)-v;
+        return v > INT32_MAX ? INT32_MAX : (int32_t)v;
+    }
+
+    static Key keyFor(const char *key) {
+        static const struct {
+            const char *name;
+            Key key;
+        } keys[] = {
+            {"Protocol:",  KEY_PROTOCOL },
+            {"Preset:",    KEY_PRESET   },
+            {"Frequency:", KEY_FREQUENCY},
+            {"TE:",        KEY_TE       },
+            {"Bit:",       KEY_BIT      },
+            {"Bit_RAW:",   KEY_BIT_RAW  },
+            {"Key:",       KEY_KEY      },
+            {"RAW_Data:",  KEY_RAW_DATA },
+            {"Data_RAW:",  KEY_DATA_RAW },
+        };
+        for (const auto &k : keys) {
+            if (strcmp(key, k.name) == 0) return k.key;
+        }
+        return KEY_NONE;
+    }
+
+    void startLine() {
+        lineUsed_ = false;
+        inKey_ = true;
+        keyLen_ = 0;
+        key_ = KEY_NONE;
+        valueLen_ = 0;
+        lineCount_ = 0;
+        raw_.reset();
+        nibble_ = -1;
+    }
+
+    void put(char c) {
+        if (c == '\n') {
+            endLine();
+            startLine();
+            return;
+        }
+        lineUsed_ = true;
+        if (inKey_) {
+            if (keyLen_ >= KEY_MAX) {
+                inKey_ = false; // no key we know is this long, the line is ignored
+                return;
+            }
+            keyText_[keyLen_++] = c;
+            if (c != ':') return;
+            keyText_[keyLen_] = '\0';
+            inKey_ = false;
+            key_ = keyFor(keyText_);
+            if (key_ == KEY_RAW_DATA || key_ == KEY_DATA_RAW) {
+                line_.kind = key_ == KEY_RAW_DATA ? SUB_DATA_TIMINGS : SUB_DATA_BYTES;
+                if (key_ == KEY_RAW_DATA && out_.streamed) out_.timings.clear();
+                line_.offset = key_ == KEY_RAW_DATA ? out_.timings.size() : out_.bytes.size();
+            }
+            return;
+        }
+        switch (key_) {
+            case KEY_NONE: break;
+            case KEY_RAW_DATA: {
+                auto emit = [this](int32_t v) { timing(v); };
+                raw_.put(c, emit);
+                break;
+            }
+            case KEY_DATA_RAW: hexChar(c); break;
+            default:
+                if (valueLen_ < SUB_VALUE_MAX) value_[valueLen_++] = c;
+                break;
+        }
+    }
+
+    void timing(int32_t v) {
+        lineCount_++;
+        if (!out_.streamed || out_.timings.size() < SUB_STREAM_KEEP_MAX) out_.timings.push_back(v);
+    }
+
+    void hexChar(char c) {
+        const int d = hexDigit(c);
+        if (d < 0) return;
+        if (nibble_ < 0) {
+            nibble_ = d;
+            return;
+        }
+        out_.bytes.push_back((uint8_t)(nibble_ << 4 | d));
+        nibble_ = -1;
+    }
+
+    void endLine() {
+        if (inKey_ || key_ == KEY_NONE) return;
+        if (key_ == KEY_RAW_DATA || key_ == KEY_DATA_RAW) {
+            if (key_ == KEY_RAW_DATA) {
+                auto emit = [this](int32_t v) { timing(v); };
+                raw_.end(emit);
+                line_.count = lineCount_;
+            } else {
+                line_.count = out_.bytes.size() - line_.offset;
+            }
+            out_.lines.push_back(line_);
+            return;
+        }
+
+        // String::trim()
+        size_t start = 0, end = valueLen_;
+        while (start < end && isSpace(value_[start])) start++;
+        while (end > start && isSpace(value_[end - 1])) end--;
+        value_[end] = '\0';
+        const char *txt = value_ + start;
+        switch (key_) {
+            case KEY_PROTOCOL:
+                copyName(out_.protocolName, txt);
+                out_.protocol = subProtocolId(out_.protocolName);
+                break;
+            case KEY_PRESET:
+                copyName(out_.presetName, txt);
+                out_.preset = subPresetId(out_.presetName, out_.rcswitchProtocol);
+                break;
+            case KEY_FREQUENCY: out_.frequency = (uint32_t)toInt(txt); break;
+            case KEY_TE: out_.te = toInt(txt); break;
+            case KEY_BIT: out_.bits.push_back(toInt(txt)); break;
+            case KEY_BIT_RAW: out_.bitRaws.push_back(toInt(txt)); break;
+            case KEY_KEY: out_.keys.push_back(hexStringKey(txt)); break;
+            default: break;
+        }
+    }
+
+    static void copyName(char *dst, const char *src) {
+        strncpy(dst, src, SUB_NAME_MAX);
+        dst[SUB_NAME_MAX] = '\0';
+    }
+
+    // hexStringToDecimal(): "AA BB CC", one byte per three characters
+    static uint32_t hexStringKey(const char *s) {
+        const size_t len = strlen(s);
+        uint32_t v = 0;
+        for (size_t i = 0; i < len; i += 3) {
+            const int hi = hexDigit(s[i]);
+            const int lo = hexDigit(s[i + 1]);
+            v = v << 8 | (uint32_t)((hi < 0 ? 0 : hi) << 4 | (lo < 0 ? 0 : lo));
+        }
+        return v;
+    }
+
+    CompiledSub &out_;
+    bool lineUsed_ = false;
+    bool inKey_ = true;
+    char keyText_[KEY_MAX + 1];
+    uint8_t keyLen_ = 0;
+    Key key_ = KEY_NONE;
+    char value_[SUB_VALUE_MAX + 1];
+    uint8_t valueLen_ = 0;
+    SubDataLine line_ = {SUB_DATA_TIMINGS, 0, 0};
+    RawDataTokenizer raw_;
+    uint32_t lineCount_ = 0; // RAW_Data timings on this line, kept or not
+    // Data_RAW
+    int nibble_ = -1;
+};
+
+// Compiles a whole file. SourceT needs size_t read(uint8_t *, size_t), like fs::File.
+template <typename SourceT> void compileSub(SourceT &source, CompiledSub &out, bool streamTimings = false) {
+    SubCompiler compiler(out, streamTimings);
+    uint8_t buf[512];
+    size_t n;
+    while ((n = source.read(buf, sizeof(buf))) > 0) compiler.feed(buf, n);
+    compiler.finish();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+// Sidecar
+/////////////////////////////////////////////////////////////////////////////////////
+// "BSUB", version, then the source key and the fields below, little endian, FNV-1a of everything
+// before it at the end:
+//   u32 sourceSize, u32 sourceMtime, u32 frequency, i32 te, u8 preset, u8 rcswitchProtocol,
+//   u8 protocol, u8 nameLen + protocolName, u8 nameLen + presetName,
+//   u32 count + i32 bits[], u32 count + i32 bitRaws[], u32 count + u32 keys[],
+//   u32 count + lines { u8 kind, u32 count, i32 timings[] | u8 bytes[] }
+struct SubSourceKey {
+    uint32_t size = 0;
+    uint32_t mtime = 0;
+};
+
+inline uint32_t subFnv1a(uint32_t h, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; ++i) h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+// Cache file name for a source path, "%08x" of this
+inline uint32_t subCachePathHash(const char *path) {
+    return subFnv1a(2166136261u, (const uint8_t *)path, strlen(path));
+}
+
+template <typename SinkT> struct SubCacheWriter {
+    SinkT &sink;
+    uint32_t hash;
+    bool ok;
+
+    void raw(const void *p, size_t len) {
+        if (!ok || len == 0) return;
+        hash = subFnv1a(hash, (const uint8_t *)p, len);
+        ok = sink.write((const uint8_t *)p, len) == len;
+    }
+    void u8(uint8_t v) { raw(&v, 1); }
+    void u32(uint32_t v) {
+        const uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+        raw(b, 4);
+    }
+    void name(const char *s) {
+        const uint8_t len = (uint8_t)strlen(s);
+        u8(len);
+        raw(s, len);
+    }
+    template <typename T> void words(const std::vector<T> &v) {
+        u32(v.size());
+        for (const T &x : v) u32((uint32_t)x);
+    }
+};
+
+struct SubCacheReader {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok;
+
+    bool has(size_t n) { return ok = ok && (size_t)(end - p) >= n; }
+    uint8_t u8() { return has(1) ? *p++ : 0; }
+    uint32_t u32() {
+        if (!has(4)) return 0;
+        const uint32_t v = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+        p += 4;
+        return v;
+    }
+    void name(char *dst) {
+        const uint8_t n = u8();
+        if (n > SUB_NAME_MAX || !has(n)) {
+            ok = false;
+            return;
+        }
+        memcpy(dst, p, n);
+        dst[n] = '\0';
+        p += n;
+    }
+    // The count is checked against what is left before anything is allocated
+    template <typename T> void words(std::vector<T> &v) {
+        const uint32_t n = u32();
+        if (!ok || n > (size_t)(end - p) / 4) {
+            ok = false;
+            return;
+        }
+        v.reserve(v.size() + n);
+        for (uint32_t i = 0; i < n; ++i) v.push_back((T)u32());
+    }
+};
+
+// SinkT needs size_t write(const uint8_t *, size_t), like fs::File. false on a short write, or for
+// a streamed compile, which does not hold its timings.
+template <typename SinkT>
+bool writeCompiledSub(SinkT &sink, const CompiledSub &sub, const SubSourceKey &key) {
+    if (sub.streamed) return false;
+    SubCacheWriter<SinkT> w = {sink, 2166136261u, true};
+    w.raw("BSUB", 4);
+    w.u8(SUB_CACHE_VERSION);
+    w.u32(key.size);
+    w.u32(key.mtime);
+    w.u32(sub.frequency);
+    w.u32((uint32_t)sub.te);
+    w.u8(sub.preset);
+    w.u8(sub.rcswitchProtocol);
+    w.u8(sub.protocol);
+    w.name(sub.protocolName);
+    w.name(sub.presetName);
+    w.words(sub.bits);
+    w.words(sub.bitRaws);
+    w.words(sub.keys);
+    w.u32(sub.lines.size());
+    for (const SubDataLine &line : sub.lines) {
+        w.u8(line.kind);
+        w.u32(line.count);
+        if (line.kind == SUB_DATA_BYTES) {
+            w.raw(sub.lineBytes(line), line.count);
+            continue;
+        }
+        const int32_t *t = sub.lineTimings(line);
+        for (uint32_t i = 0; i < line.count; ++i) w.u32((uint32_t)t[i]);
+    }
+    const uint32_t hash = w.hash;
+    w.u32(hash);
+    return w.ok;
+}
+
+// Decodes a sidecar read into memory. false when it is damaged, from another version or made
+// for a different source size / mtime.
+inline bool loadCompiledSub(const uint8_t *data, size_t len, const SubSourceKey &key, CompiledSub &out) {
+    out.clear();
+    if (len < 9 || memcmp(data, "BSUB", 4) != 0 || data[4] != SUB_CACHE_VERSION) return false;
+    const uint8_t *tail = data + len - 4;
+    const uint32_t hash = tail[0] | tail[1] << 8 | tail[2] << 16 | (uint32_t)tail[3] << 24;
+    if (subFnv1a(2166136261u, data, len - 4) != hash) return false;
+
+    SubCacheReader r = {data + 5, tail, true};
+    if (r.u32() != key.size || r.u32() != key.mtime) return false;
+    out.frequency = r.u32();
+    out.te = (int32_t)r.u32();
+    out.preset = r.u8();
+    out.rcswitchProtocol = r.u8();
+    out.protocol = r.u8();
+    r.name(out.protocolName);
+    r.name(out.presetName);
+    r.words(out.bits);
+    r.words(out.bitRaws);
+    r.words(out.keys);
+    const uint32_t lines = r.u32();
+    if (!r.ok || lines > (size_t)(tail - r.p) / 5) return false;
+    out.lines.reserve(lines);
+    for (uint32_t i = 0; i < lines && r.ok; ++i) {
+        SubDataLine line;
+        line.kind = r.u8();
+        if (line.kind == SUB_DATA_TIMINGS) {
+            line.offset = out.timings.size();
+            r.words(out.timings);
+            line.count = out.timings.size() - line.offset;
+        } else {
+            line.offset = out.bytes.size();
+            line.count = r.u32();
+            if (!r.has(line.count)) break;
+            out.bytes.insert(out.bytes.end(), r.p, r.p + line.count);
+            r.p += line.count;
+        }
+        out.lines.push_back(line);
+    }
+    if (!r.ok || r.p != tail) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "frame_bus.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <atomic>
+
+namespace {
+// A slot is live once its mask is non-zero. The handler is written before the mask and cleared
+// after it, so the callback never sees a mask without a handler.
+struct FrameBusSubscriber {
+    std::atomic<WifiFrameHandler> handler{nullptr};
+    std::atomic<uint16_t> mask{0};
+};
+
+FrameBusSubscriber subscribers[FRAME_BUS_MAX_SUBSCRIBERS];
+std::atomic<uint16_t> combinedMask{0};
+
+// Only the WiFi task writes these
+volatile uint32_t statFrames = 0;
+volatile uint32_t statMalformed = 0;
+volatile uint32_t statDelivered = 0;
+volatile uint32_t statBusyUs = 0;
+volatile uint32_t statMaxUs = 0;
+
+void refreshCombinedMask() {
+    uint16_t combined = 0;
+    for (auto &sub : subscribers) combined |= sub.mask.load(std::memory_order_relaxed);
+    combinedMask.store(combined, std::memory_order_release);
+}
+} // namespace
+
+bool frame_bus_subscribe(WifiFrameHandler handler, uint16_t mask) {
+    if (!handler) return false;
+    FrameBusSubscriber *target = nullptr;
+    for (auto &sub : subscribers) {
+        WifiFrameHandler current = sub.handler.load(std::memory_order_relaxed);
+        if (current == handler) {
+            target = &sub;
+            break;
+        }
+        if (!current && !target) target = &sub;
+    }
+    if (!target) return false;
+    target->handler.store(handler, std::memory_order_release);
+    target->mask.store(mask, std::memory_order_release);
+    refreshCombinedMask();
+    return true;
+}
+
+void frame_bus_unsubscribe(WifiFrameHandler handler) {
+    for (auto &sub : subscribers) {
+        if (sub.handler.load(std::memory_order_relaxed) != handler) continue;
+        sub.mask.store(0, std::memory_order_release);
+        sub.handler.store(nullptr, std::memory_order_release);
+    }
+    refreshCombinedMask();
+}
+
+void frame_bus_clear() {
+    for (auto &sub : subscribers) {
+        sub.mask.store(0, std::memory_order_release);
+        sub.handler.store(nullptr, std::memory_order_release);
+    }
+    refreshCombinedMask();
+}
+
+void frame_bus_rx_cb(void *buf, wifi_promiscuous_pkt_type_t type) {
+    if (!buf) return;
+    const int64_t start = esp_timer_get_time();
+    statFrames = statFrames + 1;
+    const uint16_t wanted = combinedMask.load(std::memory_order_acquire);
+    if (!wanted) return;
+
+    const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+    WifiFrameDesc frame;
+    if (!parseWifiFrame(
+            pkt->payload, pkt->rx_ctrl.sig_len, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel, frame
+        )) {
+        statMalformed = statMalformed + 1;
+        return;
+    }
+
+    if (frame.classes & wanted) {
+        for (auto &sub : subscribers) {
+            const uint16_t mask = sub.mask.load(std::memory_order_acquire);
+            if (!(mask & frame.classes)) continue;
+            WifiFrameHandler handler = sub.handler.load(std::memory_order_acquire);
+            if (!handler) continue;
+            handler(frame, pkt, type);
+            statDelivered = statDelivered + 1;
+        }
+    }
+
+    const uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    statBusyUs = statBusyUs + elapsed;
+    if (elapsed > statMaxUs) statMaxUs = elapsed;
+}
+
+void frame_bus_attach() { esp_wifi_set_promiscuous_rx_cb(frame_bus_rx_cb); }
+
+FrameBusStats frame_bus_get_stats() {
+    FrameBusStats s;
+    s.frames = statFrames;
+    s.malformed = statMalformed;
+    s.delivered = statDelivered;
+    s.busyUs = statBusyUs;
+    s.maxUs = statMaxUs;
+    return s;
+}
+
+void frame_bus_reset_stats() {
+    statFrames = 0;
+    statMalformed = 0;
+    statDelivered = 0;
+    statBusyUs = 0;
+    statMaxUs = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef __FRAME_BUS_H__
+#define __FRAME_BUS_H__
+// Single promiscuous callback shared by every module that listens to raw 802.11 frames.
+// Each frame is parsed once into a WifiFrameDesc and handed to the subscribers whose filter
+// mask matches one of its classes. Handlers run in the WiFi task: no blocking, no allocation.
+#include "esp_wifi_types.h"
+#include "modules/wifi/frame_parser.h"
+
+typedef void (*WifiFrameHandler)(
+    const WifiFrameDesc &frame, const wifi_promiscuous_pkt_t *pkt, wifi_promiscuous_pkt_type_t type
+);
+
+const uint8_t FRAME_BUS_MAX_SUBSCRIBERS = 4;
+
+struct FrameBusStats {
+    uint32_t frames = 0;    // frames seen by the callback
+    uint32_t malformed = 0; // too short to parse, not dispatched
+    uint32_t delivered = 0; // handler invocations
+    uint32_t busyUs = 0;    // time spent in the callback, parse + handlers
+    uint32_t maxUs = 0;     // slowest single frame
+};
+
+// Registers or updates a handler. Call from the task driving the module, not from a handler.
+// false when all slots are taken.
+bool frame_bus_subscribe(WifiFrameHandler handler, uint16_t mask);
+void frame_bus_unsubscribe(WifiFrameHandler handler);
+void frame_bus_clear();
+
+// The promiscuous rx callback itself, and a helper that installs it
+void frame_bus_rx_cb(void *buf, wifi_promiscuous_pkt_type_t type);
+void frame_bus_attach();
+
+FrameBusStats frame_bus_get_stats();
+void frame_bus_reset_stats();
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef __FRAME_PARSER_H__
+#define __FRAME_PARSER_H__
+// One-pass 802.11 header parser shared by the promiscuous consumers.
+// The descriptor only points into the frame, nothing is copied. Plain C++ (no ESP types)
+// so the parser can be fed from a pcap off-target.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Frame classes, used both as descriptor flags and as subscriber filter masks
+enum WifiFrameClass : uint16_t {
+    WIFI_FRAME_BEACON = 1 << 0,
+    WIFI_FRAME_PROBE_REQ = 1 << 1,
+    WIFI_FRAME_PROBE_RESP = 1 << 2,
+    WIFI_FRAME_DEAUTH = 1 << 3, // deauthentication and disassociation
+    WIFI_FRAME_MGMT_OTHER = 1 << 4,
+    WIFI_FRAME_DATA = 1 << 5,
+    WIFI_FRAME_EAPOL = 1 << 6, // set together with WIFI_FRAME_DATA
+    WIFI_FRAME_CTRL = 1 << 7,
+    WIFI_FRAME_ALL = 0xFFFF,
+};
+
+struct WifiFrameDesc {
+    const uint8_t *frame = nullptr;
+    uint16_t len = 0;
+    uint16_t frameControl = 0;
+    uint8_t type = 0;    // 0 mgmt, 1 ctrl, 2 data
+    uint8_t subtype = 0;
+    uint16_t classes = 0; // WifiFrameClass bits
+    const uint8_t *addr1 = nullptr;
+    const uint8_t *addr2 = nullptr;
+    const uint8_t *addr3 = nullptr;
+    const uint8_t *bssid = nullptr;  // from the DS bits, nullptr for WDS and control frames
+    const uint8_t *apAddr = nullptr; // addr1 if it is the BSSID, else addr2 (sniffer convention)
+    uint16_t headerLen = 0;          // MAC header incl. addr4 and QoS control
+    uint16_t ssidOffset = 0;         // offset of the SSID IE value, 0 when absent
+    uint8_t ssidLen = 0;
+    uint16_t eapolOffset = 0;        // offset of the EAPOL header after LLC/SNAP, 0 when not EAPOL
+    int8_t rssi = 0;
+    uint8_t channel = 0;
+
+    bool is(uint16_t cls) const { return (classes & cls) != 0; }
+};
+
+// Offset of the first tagged parameter in management frame bodies
+inline uint16_t wifiMgmtTagOffset(uint8_t subtype) {
+    switch (subtype) {
+        case 0x00: return 24 + 4;  // association request
+        case 0x01: return 24 + 6;  // association response
+        case 0x02: return 24 + 10; // reassociation request
+        case 0x03: return 24 + 6;  // reassociation response
+        case 0x04: return 24;      // probe request
+        case 0x05:                 // probe response
+        case 0x08: return 24 + 12; // beacon
+        default: return 0;
+    }
+}
+
+// Returns false when the frame is too short to carry a MAC header
+inline bool parseWifiFrame(
+    const uint8_t *frame, uint16_t len, int8_t rssi, uint8_t channel, WifiFrameDesc &d
+) {
+    d = WifiFrameDesc();
+    if (!frame || len < 10) return false;
+    d.frame = frame;
+    d.len = len;
+    d.rssi = rssi;
+    d.channel = channel;
+    d.frameControl = (uint16_t)frame[0] | ((uint16_t)frame[1] << 8);
+    d.type = (d.frameControl & 0x0C) >> 2;
+    d.subtype = (d.frameControl & 0xF0) >> 4;
+    d.addr1 = frame + 4;
+
+    if (d.type == 1) {
+        d.classes = WIFI_FRAME_CTRL;
+        if (len >= 16) d.addr2 = frame + 10;
+        d.headerLen = len >= 16 ? 16 : 10;
+        return true;
+    }
+    if (len < 24) return false;
+    d.addr2 = frame + 10;
+    d.addr3 = frame + 16;
+    d.apAddr = memcmp(d.addr1, d.addr3, 6) == 0 ? d.addr1 : d.addr2;
+    d.headerLen = 24;
+
+    if (d.type == 0) {
+        d.bssid = d.addr3;
+        switch (d.subtype) {
+            case 0x08: d.classes = WIFI_FRAME_BEACON; break;
+            case 0x04: d.classes = WIFI_FRAME_PROBE_REQ; break;
+            case 0x05: d.classes = WIFI_FRAME_PROBE_RESP; break;
+            case 0x0A:
+            case 0x0C: d.classes = WIFI_FRAME_DEAUTH; break;
+            default: d.classes = WIFI_FRAME_MGMT_OTHER; break;
+        }
+        uint16_t pos = wifiMgmtTagOffset(d.subtype);
+        if (pos) {
+            while (pos + 2 <= len) {
+                const uint8_t tag = frame[pos];
+                const uint8_t tagLen = frame[pos + 1];
+                if (pos + 2 + tagLen > len) break;
+                if (tag == 0x00) {
+                    d.ssidOffset = pos + 2;
+                    d.ssidLen = tagLen;
+                    break;
+                }
+                pos += 2 + tagLen;
+            }
+        }
+        return true;
+    }
+
+    if (d.type == 2) {
+        d.classes = WIFI_FRAME_DATA;
+        const bool toDs = d.frameControl & 0x0100;
+        const bool fromDs = d.frameControl & 0x0200;
+        if (!toDs && !fromDs) d.bssid = d.addr3;
+        else if (toDs && !fromDs) d.bssid = d.addr1;
+        else if (!toDs && fromDs) d.bssid = d.addr2;
+        if (toDs && fromDs) d.headerLen += 6;   // addr4
+        if (d.subtype & 0x08) d.headerLen += 2; // QoS control
+        const uint16_t llc = d.headerLen;
+        if (len >= llc + 8 + 4 && frame[llc] == 0xAA && frame[llc + 1] == 0xAA && frame[llc + 2] == 0x03 &&
+            frame[llc + 3] == 0x00 && frame[llc + 4] == 0x00 && frame[llc + 5] == 0x00 &&
+            frame[llc + 6] == 0x88 && frame[llc + 7] == 0x8E) {
+            d.classes |= WIFI_FRAME_EAPOL;
+            d.eapolOffset = llc + 8;
+        }
+        return true;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef __HC22000_H__
+#define __HC22000_H__
+// Streaming hashcat 22000 extractor. Fed one EAPOL-Key frame at a time (already located by
+// parseWifiFrame), it emits
+//   WPA*01*PMKID*MAC_AP*MAC_STA*ESSID***            for PMKIDs found in M1 key data
+//   WPA*02*MIC*MAC_AP*MAC_STA*ESSID*ANONCE*EAPOL*MP for M1/M2 (MP 00) and M2/M3 (MP 02) pairs
+// Pairs are only formed when the replay counters line up (M2 == M1, M3 == M2 + 1), so the
+// message pair never needs the "not checked" bit. Lines are deduplicated on the PMKID/MIC.
+// Plain C++ so it can be built off-target.
+#include "frame_parser.h"
+#include "mac_table.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Offsets inside an EAPOL-Key frame, from the start of the 802.1X header
+const uint8_t EAPOL_KEY_INFO = 5;
+const uint8_t EAPOL_KEY_REPLAY = 9;
+const uint8_t EAPOL_KEY_NONCE = 17;
+const uint8_t EAPOL_KEY_MIC = 81;
+const uint8_t EAPOL_KEY_DATA_LEN = 97;
+const uint8_t EAPOL_KEY_DATA = 99;
+
+// Message number (1-4) from the Key Information field, -1 when it matches none
+inline int eapolKeyMessageNumber(uint16_t keyInfo) {
+    bool install = keyInfo & (1 << 6);
+    bool ack = keyInfo & (1 << 7);
+    bool mic = keyInfo & (1 << 8);
+    bool secure = keyInfo & (1 << 9);
+
+    if (ack && !mic && !install) return 1;            // Message 1
+    if (!ack && mic && !install && !secure) return 2; // Message 2
+    if (ack && mic && install) return 3;              // Message 3
+    if (!ack && mic && !install && secure) return 4;  // Message 4
+    return -1;
+}
+
+struct Hc22000Stats {
+    uint32_t keyFrames = 0;
+    uint32_t pmkids = 0;
+    uint32_t pairs = 0;
+    uint32_t duplicates = 0;
+    uint32_t dedupResets = 0; // the dedup set filled up and was started over
+    uint32_t replayMismatch = 0;
+};
+
+class Hc22000Extractor {
+public:
+    static const uint8_t MAX_SESSIONS = 8;
+    static const uint16_t MAX_EAPOL_LEN = 256; // hashcat limit for the EAPOL field
+    static const size_t MAX_LINE = 16 + 32 + 2 * 13 + 64 + 64 + 2 * MAX_EAPOL_LEN + 16;
+
+    // emit(ctx, line) receives a NUL terminated line without the newline
+    typedef void (*EmitFn)(void *ctx, const char *line);
+
+    bool init(size_t dedupSlots) { return emitted_.init(dedupSlots); }
+    void release() { emitted_.release(); }
+    void setEmitter(EmitFn fn, void *ctx) {
+        emit_ = fn;
+        emitCtx_ = ctx;
+    }
+
+    // Forgets pending messages and emitted hashes, e.g. when a new session file starts
+    void reset() {
+        memset(sessions_, 0, sizeof(sessions_));
+        emitted_.clear();
+        stats_ = Hc22000Stats();
+    }
+
+    // frame must carry WIFI_FRAME_EAPOL. ssid is the raw ESSID, len 0 means unknown (nothing emitted).
+    void feed(const WifiFrameDesc &frame, const char *ssid, size_t ssidLen, uint32_t nowMs) {
+        if (!frame.eapolOffset || !frame.bssid || !ssidLen) return;
+        const uint8_t *eapol = frame.frame + frame.eapolOffset;
+        const size_t avail = frame.len - frame.eapolOffset;
+        if (avail < EAPOL_KEY_DATA || eapol[1] != 3) return; // not an EAPOL-Key frame
+        stats_.keyFrames++;
+
+        const uint16_t keyInfo = (eapol[EAPOL_KEY_INFO] << 8) | eapol[EAPOL_KEY_INFO + 1];
+        int msg = eapolKeyMessageNumber(keyInfo);
+        // Some stations send M4 without the secure bit; only M2 carries a SNonce
+        if (msg == 2 && isZero(eapol + EAPOL_KEY_NONCE, 32)) msg = 4;
+        if (msg < 1 || msg > 3) return;
+
+        const uint8_t *ap = frame.bssid;
+        const uint8_t *sta = memcmp(frame.addr1, ap, 6) == 0 ? frame.addr2 : frame.addr1;
+        const uint64_t replay = readBe64(eapol + EAPOL_KEY_REPLAY);
+        Session &s = sessionFor(ap, sta, nowMs);
+
+        if (msg == 1) {
+            memcpy(s.anonce, eapol + EAPOL_KEY_NONCE, 32);
+            s.m1Replay = replay;
+            s.haveM1 = true;
+            emitPmkid(eapol, avail, ap, sta, ssid, ssidLen);
+            return;
+        }
+
+        const size_t eapolLen = 4 + ((eapol[2] << 8) | eapol[3]);
+        if (msg == 2) {
+            if (eapolLen > MAX_EAPOL_LEN || eapolLen > avail) return;
+            memcpy(s.m2Eapol, eapol, eapolLen);
+            memset(s.m2Eapol + EAPOL_KEY_MIC, 0, 16);
+            memcpy(s.m2Mic, eapol + EAPOL_KEY_MIC, 16);
+            s.m2EapolLen = eapolLen;
+            s.m2Replay = replay;
+            s.haveM2 = true;
+            if (!s.haveM1) return;
+            if (s.m1Replay != replay) {
+                stats_.replayMismatch++;
+                return;
+            }
+            emitPair(s, s.anonce, 0x00, ssid, ssidLen);
+            return;
+        }
+
+        // msg == 3, ANonce is repeated in M3
+        if (!s.haveM2) return;
+        if (replay != s.m2Replay + 1) {
+            stats_.replayMismatch++;
+            return;
+        }
+        emitPair(s, eapol + EAPOL_KEY_NONCE, 0x02, ssid, ssidLen);
+    }
+
+    const Hc22000Stats &stats() const { return stats_; }
+
+private:
+    struct Session {
+        uint8_t ap[6];
+        uint8_t sta[6];
+        uint32_t lastMs;
+        bool used;
+        bool haveM1;
+        bool haveM2;
+        uint64_t m1Replay;
+        uint64_t m2Replay;
+        uint8_t anonce[32];
+        uint8_t m2Mic[16];
+        uint16_t m2EapolLen;
+        uint8_t m2Eapol[MAX_EAPOL_LEN];
+    };
+
+    static bool isZero(const uint8_t *p, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            if (p[i]) return false;
+        }
+        return true;
+    }
+
+    static uint64_t readBe64(const uint8_t *p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    // Least recently used slot is recycled when the pair is new
+    Session &sessionFor(const uint8_t *ap, const uint8_t *sta, uint32_t nowMs) {
+        Session *victim = &sessions_[0];
+        for (auto &s : sessions_) {
+            if (s.used && memcmp(s.ap, ap, 6) == 0 && memcmp(s.sta, sta, 6) == 0) {
+                s.lastMs = nowMs;
+                return s;
+            }
+            if (victim->used && (!s.used || (int32_t)(s.lastMs - victim->lastMs) < 0)) {
+                victim = &s;
+            }
+        }
+        memset(victim, 0, sizeof(Session));
+        memcpy(victim->ap, ap, 6);
+        memcpy(victim->sta, sta, 6);
+        victim->used = true;
+        victim->lastMs = nowMs;
+        return *victim;
+    }
+
+    // First 8 bytes of a PMKID or MIC, good enough as a dedup key. A full set is started over:
+    // a hash seen before that may come out twice, a new one is never lost.
+    bool firstTime(const uint8_t *hash) {
+        uint64_t key = 0;
+        for (int i = 0; i < 8; ++i) key = (key << 8) | hash[i];
+        bool created = false;
+        if (!emitted_.ready()) return true;
+        if (!emitted_.insert(key, &created)) {
+            emitted_.clear();
+            stats_.dedupResets++;
+            emitted_.insert(key, &created);
+            return true;
+        }
+        if (!created) stats_.duplicates++;
+        return created;
+    }
+
+    void emitPmkid(
+        const uint8_t *eapol, size_t avail, const uint8_t *ap, const uint8_t *sta, const char *ssid,
+        size_t ssidLen
+    ) {
+        size_t dataLen = (eapol[EAPOL_KEY_DATA_LEN] << 8) | eapol[EAPOL_KEY_DATA_LEN + 1];
+        if (EAPOL_KEY_DATA + dataLen > avail) dataLen = avail - EAPOL_KEY_DATA;
+        const uint8_t *kd = eapol + EAPOL_KEY_DATA;
+        size_t pos = 0;
+        while (pos + 2 <= dataLen) {
+            const uint8_t type = kd[pos];
+            const uint8_t len = kd[pos + 1];
+            if (pos + 2 + len > dataLen) break;
+            // PMKID KDE: DD len 00-0F-AC 04 PMKID[16]
+            if (type == 0xDD && len >= 20 && kd[pos + 2] == 0x00 && kd[pos + 3] == 0x0F &&
+                kd[pos + 4] == 0xAC && kd[pos + 5] == 0x04) {
+                const uint8_t *pmkid = kd + pos + 6;
+                if (isZero(pmkid, 16) || !firstTime(pmkid)) return;
+                char *p = line_;
+                p = append(p, "WPA*01*");
+                p = appendHex(p, pmkid, 16);
+                p = appendFields(p, ap, sta, ssid, ssidLen);
+                p = append(p, "***");
+                *p = '\0';
+                stats_.pmkids++;
+                if (emit_) emit_(emitCtx_, line_);
+                return;
+            }
+            pos += 2 + len;
+        }
+    }
+
+    void emitPair(
+        const Session &s, const uint8_t *anonce, uint8_t messagePair, const char *ssid, size_t ssidLen
+    ) {
+        if (!firstTime(s.m2Mic)) return;
+        char *p = line_;
+        p = append(p, "WPA*02*");
+        p = appendHex(p, s.m2Mic, 16);
+        p = appendFields(p, s.ap, s.sta, ssid, ssidLen);
+        *p++ = '*';
+        p = appendHex(p, anonce, 32);
+        *p++ = '*';
+        p = appendHex(p, s.m2Eapol, s.m2EapolLen);
+        *p++ = '*';
+        p = appendHex(p, &messagePair, 1);
+        *p = '\0';
+        stats_.pairs++;
+        if (emit_) emit_(emitCtx_, line_);
+    }
+
+    static char *append(char *p, const char *text) {
+        while (*text) *p++ = *text++;
+        return p;
+    }
+
+    static char *appendHex(char *p, const uint8_t *data, size_t len) {
+        static const char digits[] = "0123456789abcdef";
+        for (size_t i = 0; i < len; ++i) {
+            *p++ = digits[data[i] >> 4];
+            *p++ = digits[data[i] & 0x0F];
+        }
+        return p;
+    }
+
+    // *MAC_AP*MAC_STA*ESSID
+    static char *
+    appendFields(char *p, const uint8_t *ap, const uint8_t *sta, const char *ssid, size_t ssidLen) {
+        if (ssidLen > 32) ssidLen = 32;
+        *p++ = '*';
+        p = appendHex(p, ap, 6);
+        *p++ = '*';
+        p = appendHex(p, sta, 6);
+        *p++ = '*';
+        return appendHex(p, (const uint8_t *)ssid, ssidLen);
+    }
+
+    Session sessions_[MAX_SESSIONS] = {};
+    MacSet emitted_;
+    Hc22000Stats stats_;
+    EmitFn emit_ = nullptr;
+    void *emitCtx_ = nullptr;
+    char line_[MAX_LINE];
+};
+
+#endif
@@ -17,6 +17,7 @@
 #include <set>
 #include <vector>
 
+#include "frame_bus.h"
 #include "karma_attack.h"
 #include "sniffer.h" // Channel list
 #include <Arduino.h>
@@ -48,7 +49,10 @@ bool auto_hopping = true; // Enable/disable flag
 unsigned long hop_interval = DEFAULT_HOP_INTERVAL;
 
 File _probe_file;
-std::set<String> uniqueProbes; // Stores unique probe requests (MAC+SSID)
+// Unique probe requests, key = client MAC << 16 | low 16 bits of the SSID hash, SSID kept to confirm
+MacSsidTable uniqueProbes;
+const size_t PROBE_TABLE_SLOTS_PSRAM = 2048;
+const size_t PROBE_TABLE_SLOTS_INTERNAL = 512;
 std::vector<String> probeList; // Stores all probes in order
 String filen = "";
 
@@ -92,6 +96,18 @@ bool isProbeRequestWithSSID(const wifi_promiscuous_pkt_t *packet) {
     return false;
 }
 
+// SSID element located by the frame bus parser; false if absent, empty or not printable
+static bool findProbeSsid(const WifiFrameDesc &frame, const char *&ssid, uint8_t &ssidLen) {
+    if (!frame.ssidOffset || frame.ssidLen == 0) return false;
+    const uint8_t *value = frame.frame + frame.ssidOffset;
+    for (int i = 0; i < frame.ssidLen; i++) {
+        if (!isPrintable(value[i])) return false;
+    }
+    ssid = (const char *)value;
+    ssidLen = frame.ssidLen;
+    return true;
+}
+
 String extractSSID(const wifi_promiscuous_pkt_t *packet) {
     const uint8_t *frame = packet->payload;
     int pos = 24;
@@ -160,31 +176,29 @@ void clearProbes() {
     pkt_counter = 0;
 }
 
-// Packet callback function - ONLY PROCESSES PROBES WITH SSID
-void probe_sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
-    wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
-    wifi_pkt_rx_ctrl_t ctrl = (wifi_pkt_rx_ctrl_t)pkt->rx_ctrl;
-
-    if (isProbeRequestWithSSID(pkt)) {
-        String mac = extractMAC(pkt);
-        String ssid = extractSSID(pkt);
-        if (ssid.length() == 0) return;
-
-        String key = mac + ssid;
-        if (uniqueProbes.find(key) == uniqueProbes.end()) {
-            uniqueProbes.insert(key);
+// Frame bus subscriber, only receives probe requests - ONLY PROCESSES PROBES WITH SSID
+static void probeOnFrame(
+    const WifiFrameDesc &frame, const wifi_promiscuous_pkt_t *pkt, wifi_promiscuous_pkt_type_t type
+) {
+    const char *rawSsid = nullptr;
+    uint8_t rawLen = 0;
+    if (findProbeSsid(frame, rawSsid, rawLen)) {
+        // Repeated probes are rejected here, before any String is built
+        if (uniqueProbes.insert(frame.addr2, rawSsid, rawLen)) {
+            String mac = extractMAC(pkt);
+            String ssid = extractSSID(pkt);
 
             ProbeRequest probe;
             probe.mac = mac;
             probe.ssid = ssid;
-            probe.rssi = ctrl.rssi;
+            probe.rssi = frame.rssi;
             probe.timestamp = millis();
             probe.channel = all_wifi_channels[channl]; // <-- Current channel
 
             probeRequests.push_back(probe);
             pkt_counter++;
             // Print to serial for debugging
-            Serial.printf("[PROBE] MAC: %s, SSID: %s, RSSI: %d\n", mac.c_str(), ssid.c_str(), ctrl.rssi);
+            Serial.printf("[PROBE] MAC: %s, SSID: %s, RSSI: %d\n", mac.c_str(), ssid.c_str(), frame.rssi);
         }
     }
 }
@@ -204,6 +218,12 @@ void karma_setup() {
 
     delay(200);
 
+    if (!uniqueProbes.init(psramFound() ? PROBE_TABLE_SLOTS_PSRAM : PROBE_TABLE_SLOTS_INTERNAL)) {
+        displayError("Not enough memory", true);
+        return;
+    }
+    frame_bus_subscribe(probeOnFrame, WIFI_FRAME_PROBE_REQ);
+
     FS *Fs;
     int redraw = true;
     String FileSys = "LittleFS";
@@ -243,7 +263,7 @@ void karma_setup() {
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_NULL));
     ESP_ERROR_CHECK(esp_wifi_start());
     esp_wifi_set_promiscuous(true);
-    esp_wifi_set_promiscuous_rx_cb(probe_sniffer);
+    frame_bus_attach();
     wifi_second_chan_t secondCh = (wifi_second_chan_t)NULL;
     esp_wifi_set_channel(all_wifi_channels[channl], secondCh);
 
@@ -276,7 +296,7 @@ void karma_setup() {
             redraw = true;
 
             esp_wifi_set_promiscuous(true);
-            esp_wifi_set_promiscuous_rx_cb(probe_sniffer);
+            frame_bus_attach();
         }
 
         /* Channel Hopping */
@@ -290,7 +310,7 @@ void karma_setup() {
             redraw = true;
             vTaskDelay(50 / portTICK_RATE_MS);
             esp_wifi_set_promiscuous(true);
-            esp_wifi_set_promiscuous_rx_cb(probe_sniffer);
+            frame_bus_attach();
         }
 
         if (PrevPress) {
@@ -327,7 +347,7 @@ void karma_setup() {
             redraw = true;
             vTaskDelay(50 / portTICK_PERIOD_MS);
             esp_wifi_set_promiscuous(true);
-            esp_wifi_set_promiscuous_rx_cb(probe_sniffer);
+            frame_bus_attach();
         }
 
 #if defined(HAS_KEYBOARD) || defined(T_EMBED)
@@ -360,7 +380,7 @@ void karma_setup() {
                                                          esp_wifi_set_mode(WIFI_MODE_NULL);
                                                          esp_wifi_start();
                                                          esp_wifi_set_promiscuous(true);
-                                                         esp_wifi_set_promiscuous_rx_cb(probe_sniffer);
+                                                         frame_bus_attach();
                                                      }});
                          }
 
@@ -428,7 +448,10 @@ void karma_setup() {
 
         if (currentTime - last_time > 1000) {
             last_time = currentTime;
-            tft.drawString("Unique: " + String(uniqueProbes.size()), 10, tftHeight - 18);
+            String unique = "Unique: " + String(uniqueProbes.size());
+            // probes the table had no room for are not listed nor saved
+            if (uniqueProbes.rejected()) unique += " Lost: " + String(uniqueProbes.rejected());
+            tft.drawString(unique, 10, tftHeight - 18);
             tft.drawCentreString("Packets " + String(pkt_counter), tftWidth / 2, tftHeight - 26, 1);
             String hopStatus = String(auto_hopping ? "A:" : "M:") + String(hop_interval) + "ms";
             tft.drawRightString(hopStatus, tftWidth - 10, tftHeight - 34);
@@ -448,6 +471,11 @@ Exit:
     esp_wifi_stop();
     esp_wifi_set_promiscuous_rx_cb(NULL);
     esp_wifi_deinit();
+    frame_bus_unsubscribe(probeOnFrame);
+    if (uniqueProbes.rejected()) {
+        Serial.printf("[PROBE] %u probes dropped, the table was full\n", (unsigned)uniqueProbes.rejected());
+    }
+    uniqueProbes.release();
     vTaskDelay(1 / portTICK_RATE_MS);
 }
 
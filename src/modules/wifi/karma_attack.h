@@ -1,9 +1,9 @@
 
 #include <Arduino.h>
 #include <vector>
-#include <set>
 #include "FS.h"
 #include "esp_wifi_types.h"
+#include "modules/wifi/mac_table.h"
 
 // Forward declaration for FS class
 namespace fs {
@@ -38,12 +38,9 @@ void clearProbes();
 std::vector<ProbeRequest> getUniqueProbes();
 std::vector<ProbeRequest> getAllProbes();
 
-// Utility functions
-void sniffer(void *buf, wifi_promiscuous_pkt_type_t type);
-
 //===== GLOBAL VARIABLES =====//
 extern std::vector<ProbeRequest> probeRequests;
-extern std::set<String> uniqueProbes;
+extern MacSsidTable uniqueProbes;
 extern uint32_t packet_counter;
 extern uint8_t ch;
 extern bool isLittleFS;
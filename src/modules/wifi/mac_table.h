@@ -0,0 +1,304 @@
+#ifndef __MAC_TABLE_H__
+#define __MAC_TABLE_H__
+// Fixed-capacity open-addressing hash table keyed by a packed MAC (uint64).
+// Storage is one allocation made by init(), so lookups and inserts from the promiscuous
+// callback never touch the heap. Linear probing with backward-shift deletion: no tombstones,
+// and eraseIf() is a single pass over the slots. Plain C++ so it can be built off-target.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 48-bit MAC packed big-endian into the low bits, same layout the sniffer already uses
+inline uint64_t macKey(const void *mac) {
+    const uint8_t *u = reinterpret_cast<const uint8_t *>(mac);
+    uint64_t key = 0;
+    for (int i = 0; i < 6; ++i) { key = (key << 8) | (uint64_t)u[i]; }
+    return key;
+}
+
+inline void macFromKey(uint64_t key, uint8_t *mac) {
+    for (int i = 5; i >= 0; --i) {
+        mac[i] = key & 0xFF;
+        key >>= 8;
+    }
+}
+
+inline uint32_t ssidHash(const char *ssid, size_t len) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t)ssid[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// SSID stored inline, no String/heap behind it
+struct FixedSsid {
+    static const uint8_t MAX_LEN = 32;
+    char text[MAX_LEN + 1] = {0};
+    uint8_t len = 0;
+
+    void set(const char *src, size_t n) {
+        if (!src) n = 0;
+        if (n > MAX_LEN) n = MAX_LEN;
+        if (n) memcpy(text, src, n);
+        text[n] = '\0';
+        len = (uint8_t)n;
+    }
+    void set(const char *src) { set(src, src ? strlen(src) : 0); }
+    bool equals(const char *other, size_t n) const {
+        if (n > MAX_LEN) n = MAX_LEN;
+        return n == len && memcmp(text, other, n) == 0;
+    }
+    bool empty() const { return len == 0; }
+};
+
+struct MacTableEmpty {};
+
+template <typename V> class MacTable {
+public:
+    MacTable() = default;
+    MacTable(const MacTable &) = delete;
+    MacTable &operator=(const MacTable &) = delete;
+    ~MacTable() { release(); }
+
+    // Allocates room for `slots` entries (rounded up to a power of two). Inserts are refused
+    // above 3/4 load so probe chains stay short. Calling it again once allocated is a no-op.
+    bool init(size_t slots) {
+        if (keys_) return true;
+        size_t cap = 8;
+        while (cap < slots) cap <<= 1;
+        const size_t keyBytes = cap * sizeof(uint64_t);
+        const size_t valueBytes = ((cap * sizeof(V)) + 7) & ~(size_t)7;
+        uint8_t *mem = (uint8_t *)malloc(keyBytes + valueBytes + cap);
+        if (!mem) return false;
+        keys_ = reinterpret_cast<uint64_t *>(mem);
+        values_ = reinterpret_cast<V *>(mem + keyBytes);
+        used_ = mem + keyBytes + valueBytes;
+        mask_ = cap - 1;
+        limit_ = cap - cap / 4;
+        memset(used_, 0, cap);
+        size_ = 0;
+        return true;
+    }
+
+    void release() {
+        free(keys_);
+        keys_ = nullptr;
+        values_ = nullptr;
+        used_ = nullptr;
+        mask_ = 0;
+        limit_ = 0;
+        size_ = 0;
+    }
+
+    bool ready() const { return keys_ != nullptr; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return keys_ ? mask_ + 1 : 0; }
+    size_t memoryBytes() const {
+        return keys_ ? capacity() * (sizeof(uint64_t) + sizeof(V) + 1) : 0;
+    }
+    uint32_t rejected() const { return rejected_; }
+
+    void clear() {
+        if (used_) memset(used_, 0, mask_ + 1);
+        size_ = 0;
+    }
+
+    V *find(uint64_t key) {
+        const size_t idx = locate(key);
+        return idx == NOT_FOUND ? nullptr : &values_[idx];
+    }
+    const V *find(uint64_t key) const {
+        const size_t idx = locate(key);
+        return idx == NOT_FOUND ? nullptr : &values_[idx];
+    }
+    bool contains(uint64_t key) const { return locate(key) != NOT_FOUND; }
+
+    // Find-or-insert. A new entry is value-initialised. nullptr when full or not allocated.
+    V *insert(uint64_t key, bool *created = nullptr) {
+        if (created) *created = false;
+        if (!keys_) return nullptr;
+        size_t idx = slotFor(key);
+        while (used_[idx]) {
+            if (keys_[idx] == key) return &values_[idx];
+            idx = (idx + 1) & mask_;
+        }
+        if (size_ >= limit_) {
+            rejected_++;
+            return nullptr;
+        }
+        used_[idx] = 1;
+        keys_[idx] = key;
+        values_[idx] = V();
+        size_++;
+        if (created) *created = true;
+        return &values_[idx];
+    }
+
+    bool erase(uint64_t key) {
+        const size_t idx = locate(key);
+        if (idx == NOT_FOUND) return false;
+        removeAt(idx);
+        return true;
+    }
+
+    // Removes every entry for which pred(key, value) is true, in one pass.
+    // The walk starts right after an empty slot so no probe chain wraps past the starting point,
+    // which is what keeps backward shifting from moving an unvisited entry behind the cursor.
+    template <typename Pred> size_t eraseIf(Pred pred) {
+        if (!keys_ || size_ == 0) return 0;
+        const size_t cap = mask_ + 1;
+        size_t start = 0;
+        while (used_[start]) start = (start + 1) & mask_;
+        size_t removed = 0;
+        size_t idx = (start + 1) & mask_;
+        for (size_t step = 0; step < cap; ++step) {
+            // a removal may shift the next chain member into idx, so re-check the same slot
+            while (used_[idx] && pred(keys_[idx], values_[idx])) {
+                removeAt(idx);
+                removed++;
+            }
+            idx = (idx + 1) & mask_;
+        }
+        return removed;
+    }
+
+    // fn(key, value)
+    template <typename Fn> void forEach(Fn fn) const {
+        if (!keys_) return;
+        for (size_t i = 0; i <= mask_; ++i) {
+            if (used_[i]) fn(keys_[i], values_[i]);
+        }
+    }
+
+    class const_iterator {
+    public:
+        const_iterator(const MacTable *table, size_t idx) : table_(table), idx_(idx) { skip(); }
+        uint64_t key() const { return table_->keys_[idx_]; }
+        const V &value() const { return table_->values_[idx_]; }
+        const const_iterator &operator*() const { return *this; }
+        const_iterator &operator++() {
+            ++idx_;
+            skip();
+            return *this;
+        }
+        bool operator!=(const const_iterator &other) const { return idx_ != other.idx_; }
+        bool operator==(const const_iterator &other) const { return idx_ == other.idx_; }
+
+    private:
+        void skip() {
+            while (idx_ < table_->capacity() && !table_->used_[idx_]) ++idx_;
+        }
+        const MacTable *table_;
+        size_t idx_;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, capacity()); }
+
+private:
+    static const size_t NOT_FOUND = (size_t)-1;
+
+    size_t slotFor(uint64_t key) const {
+        uint32_t h = (uint32_t)key ^ (uint32_t)(key >> 32);
+        h *= 0x9E3779B1u;
+        h ^= h >> 16;
+        return h & mask_;
+    }
+
+    size_t locate(uint64_t key) const {
+        if (!keys_) return NOT_FOUND;
+        size_t idx = slotFor(key);
+        while (used_[idx]) {
+            if (keys_[idx] == key) return idx;
+            idx = (idx + 1) & mask_;
+        }
+        return NOT_FOUND;
+    }
+
+    void removeAt(size_t hole) {
+        used_[hole] = 0;
+        size_--;
+        size_t idx = (hole + 1) & mask_;
+        while (used_[idx]) {
+            const size_t home = slotFor(keys_[idx]);
+            // entry may move back only if its home is not cyclically inside (hole, idx]
+            const bool movable = hole <= idx ? (home <= hole || home > idx) : (home <= hole && home > idx);
+            if (movable) {
+                keys_[hole] = keys_[idx];
+                values_[hole] = values_[idx];
+                used_[hole] = 1;
+                used_[idx] = 0;
+                hole = idx;
+            }
+            idx = (idx + 1) & mask_;
+        }
+    }
+
+    uint64_t *keys_ = nullptr;
+    V *values_ = nullptr;
+    uint8_t *used_ = nullptr;
+    size_t mask_ = 0;
+    size_t limit_ = 0;
+    size_t size_ = 0;
+    uint32_t rejected_ = 0;
+};
+
+// Set flavour, the value slot is empty
+typedef MacTable<MacTableEmpty> MacSet;
+
+// (MAC, SSID) pairs: the full MAC in the high bits of the key, 16 bits of the SSID hash below and
+// the SSID itself as value. A hit is only a match once the stored SSID compares equal; two SSIDs
+// of one MAC sharing those 16 bits take the next hash value instead of overwriting each other.
+class MacSsidTable {
+public:
+    static const uint8_t PROBES = 4;
+
+    bool init(size_t slots) { return table_.init(slots); }
+    void release() { table_.release(); }
+    void clear() { table_.clear(); }
+    bool ready() const { return table_.ready(); }
+    size_t size() const { return table_.size(); }
+    size_t memoryBytes() const { return table_.memoryBytes(); }
+    // Inserts refused because the table was full or every probe was taken by another SSID
+    uint32_t rejected() const { return table_.rejected() + collisions_; }
+
+    bool contains(const void *mac, const char *ssid, size_t len) const {
+        for (uint8_t probe = 0; probe < PROBES; ++probe) {
+            const FixedSsid *stored = table_.find(key(mac, ssid, len, probe));
+            if (!stored) return false;
+            if (stored->equals(ssid, len)) return true;
+        }
+        return false;
+    }
+
+    // true only when the pair was not there yet and has been stored
+    bool insert(const void *mac, const char *ssid, size_t len) {
+        for (uint8_t probe = 0; probe < PROBES; ++probe) {
+            bool created = false;
+            FixedSsid *stored = table_.insert(key(mac, ssid, len, probe), &created);
+            if (!stored) return false;
+            if (created) {
+                stored->set(ssid, len);
+                return true;
+            }
+            if (stored->equals(ssid, len)) return false;
+        }
+        collisions_++;
+        return false;
+    }
+
+private:
+    static uint64_t key(const void *mac, const char *ssid, size_t len, uint8_t probe) {
+        if (len > FixedSsid::MAX_LEN) len = FixedSsid::MAX_LEN;
+        return (macKey(mac) << 16) | (uint16_t)(ssidHash(ssid, len) + probe);
+    }
+
+    MacTable<FixedSsid> table_;
+    uint32_t collisions_ = 0;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef __PACKET_SLAB_H__
+#define __PACKET_SLAB_H__
+// Fixed-slot packet storage for the promiscuous capture path.
+// No heap calls after init(): the caller hands in one preallocated block (PSRAM when available)
+// and slots travel between the WiFi callback (producer) and the writer task (consumer) as indices
+// through two single-producer/single-consumer rings. Plain C++ so it can be built off-target.
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free ring for exactly one producer and one consumer. Capacity must be a power of two.
+template <typename T, size_t Capacity> class SpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    bool push(const T &value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= Capacity) return false;
+        items_[head & (Capacity - 1)] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) return false;
+        value = items_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only safe when neither side is running
+    void reset() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    T items_[Capacity];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
+
+struct PacketSlabStats {
+    uint32_t queued = 0;         // slots handed to the consumer
+    uint32_t dropped = 0;        // frames lost for any reason
+    uint32_t slotExhausted = 0;  // producer found no free slot
+    uint32_t oversize = 0;       // frame larger than a slot, stored truncated
+    uint32_t highWater = 0;      // deepest the ready queue has been
+    uint16_t slotCount = 0;
+    uint16_t slotSize = 0;
+};
+
+class PacketSlab {
+public:
+    static const uint16_t MAX_SLOTS = 128;
+    static const uint16_t INVALID_SLOT = 0xFFFF;
+
+    // Carves `memory` (slotCount * slotSize bytes) into slots. Only call with both sides stopped.
+    bool init(uint8_t *memory, uint16_t slotCount, uint16_t slotSize) {
+        if (!memory || slotCount == 0 || slotCount > MAX_SLOTS || slotSize == 0) return false;
+        memory_ = memory;
+        slotCount_ = slotCount;
+        slotSize_ = slotSize;
+        freeSlots_.reset();
+        readySlots_.reset();
+        spare_ = INVALID_SLOT;
+        for (uint16_t i = 0; i < slotCount_; ++i) freeSlots_.push(i);
+        resetStats();
+        return true;
+    }
+
+    bool ready() const { return memory_ != nullptr; }
+
+    // Forgets the memory handed to init(), the caller frees it. Only call with both sides stopped.
+    void deinit() {
+        memory_ = nullptr;
+        slotCount_ = 0;
+        slotSize_ = 0;
+        freeSlots_.reset();
+        readySlots_.reset();
+        spare_ = INVALID_SLOT;
+    }
+
+    // Producer side
+    uint16_t acquire() {
+        uint16_t idx = spare_;
+        if (idx != INVALID_SLOT) {
+            spare_ = INVALID_SLOT;
+            return idx;
+        }
+        if (!freeSlots_.pop(idx)) {
+            slotExhausted_.fetch_add(1, std::memory_order_relaxed);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return INVALID_SLOT;
+        }
+        return idx;
+    }
+
+    bool commit(uint16_t idx) {
+        if (!readySlots_.push(idx)) {
+            // Cannot happen while every slot index is unique, kept as a guard
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            spare_ = idx;
+            return false;
+        }
+        queued_.fetch_add(1, std::memory_order_relaxed);
+        // highWater_ has a single writer (the producer), readers only need a relaxed snapshot
+        const uint32_t depth = (uint32_t)readySlots_.size();
+        if (depth > highWater_.load(std::memory_order_relaxed)) {
+            highWater_.store(depth, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Producer gave up on a slot it acquired. Kept aside instead of going back through freeSlots_,
+    // which only the consumer may push into.
+    void cancel(uint16_t idx) { spare_ = idx; }
+
+    void noteOversize() { oversize_.fetch_add(1, std::memory_order_relaxed); }
+    void noteDrop() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Consumer side
+    bool next(uint16_t &idx) { return readySlots_.pop(idx); }
+    void release(uint16_t idx) { freeSlots_.push(idx); }
+
+    uint8_t *slot(uint16_t idx) const { return memory_ + (size_t)idx * slotSize_; }
+    uint16_t slotSize() const { return slotSize_; }
+    uint16_t slotCount() const { return slotCount_; }
+    size_t pending() const { return readySlots_.size(); }
+
+    PacketSlabStats stats() const {
+        PacketSlabStats s;
+        s.queued = queued_.load(std::memory_order_relaxed);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.slotExhausted = slotExhausted_.load(std::memory_order_relaxed);
+        s.oversize = oversize_.load(std::memory_order_relaxed);
+        s.highWater = highWater_.load(std::memory_order_relaxed);
+        s.slotCount = slotCount_;
+        s.slotSize = slotSize_;
+        return s;
+    }
+
+    void resetStats() {
+        queued_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+        slotExhausted_.store(0, std::memory_order_relaxed);
+        oversize_.store(0, std::memory_order_relaxed);
+        highWater_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    uint8_t *memory_ = nullptr;
+    uint16_t slotCount_ = 0;
+    uint16_t slotSize_ = 0;
+    uint16_t spare_ = INVALID_SLOT; // producer-only
+    SpscRing<uint16_t, MAX_SLOTS> freeSlots_;  // consumer -> producer
+    SpscRing<uint16_t, MAX_SLOTS> readySlots_; // producer -> consumer
+    std::atomic<uint32_t> queued_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint32_t> slotExhausted_{0};
+    std::atomic<uint32_t> oversize_{0};
+    std::atomic<uint32_t> highWater_{0};
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef __PCAP_SINK_H__
+#define __PCAP_SINK_H__
+// Buffered classic-pcap writer that keeps its file open.
+// Record headers and payloads are packed into one contiguous buffer and written out when the
+// buffer fills; poll() pushes the buffer and syncs the file every flush interval, so a power
+// loss costs at most one interval of frames. FileT only needs write(const uint8_t *, size_t),
+// flush(), close() and operator bool, which fs::File provides and a stdio wrapper can on a host.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PCAP_LINKTYPE_IEEE802_11 105
+#define PCAP_DEFAULT_SNAPLEN 2500
+
+struct PcapSinkStats {
+    uint32_t frames = 0;
+    uint32_t bytes = 0;   // bytes handed to the file, headers included
+    uint32_t writes = 0;  // write() calls issued on the file
+    uint32_t syncs = 0;   // flush() calls issued on the file
+    uint32_t failed = 0;  // short writes
+};
+
+// Buffer, flush and sync logic shared by the pcap and pcapng writers
+template <typename FileT> class CaptureFileWriter {
+public:
+    static const uint32_t DEFAULT_FLUSH_INTERVAL_MS = 1000;
+
+    // `buffer` is owned by the caller and must outlive the sink
+    void setBuffer(uint8_t *buffer, size_t capacity) {
+        buffer_ = buffer;
+        capacity_ = capacity;
+        used_ = 0;
+    }
+    void setFlushInterval(uint32_t ms) { flushIntervalMs_ = ms; }
+
+    // Time based flush, call regularly from the task that owns the sink
+    bool poll(uint32_t nowMs) {
+        if (!open_) return true;
+        if ((uint32_t)(nowMs - lastSyncMs_) < flushIntervalMs_) return true;
+        return flush(nowMs);
+    }
+
+    // Writes out everything buffered and syncs the file to the medium
+    bool flush(uint32_t nowMs) {
+        if (!open_) return true;
+        lastSyncMs_ = nowMs;
+        bool ok = drain();
+        if (stats_.bytes != syncedBytes_) {
+            file_.flush();
+            syncedBytes_ = stats_.bytes;
+            stats_.syncs++;
+        }
+        return ok;
+    }
+
+    void close() {
+        if (!open_) return;
+        drain();
+        file_.flush();
+        file_.close();
+        open_ = false;
+        used_ = 0;
+    }
+
+    bool isOpen() const { return open_; }
+    size_t buffered() const { return used_; }
+    uint32_t lastAppendMs() const { return lastAppendMs_; }
+    uint32_t openedMs() const { return openedMs_; }
+    // Size of the current file, buffered bytes included
+    uint32_t fileBytes() const { return fileBytes_; }
+    const PcapSinkStats &stats() const { return stats_; }
+    void resetStats() {
+        stats_ = PcapSinkStats();
+        syncedBytes_ = 0;
+    }
+
+protected:
+    bool begin(FileT file, uint32_t nowMs) {
+        close();
+        if (!file) return false;
+        file_ = file;
+        open_ = true;
+        used_ = 0;
+        fileBytes_ = 0;
+        openedMs_ = nowMs;
+        lastSyncMs_ = nowMs;
+        lastAppendMs_ = nowMs;
+        return true;
+    }
+
+    static void put16(uint8_t *p, uint16_t v) {
+        p[0] = v & 0xFF;
+        p[1] = v >> 8;
+    }
+    static void put32(uint8_t *p, uint32_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = v >> 24;
+    }
+
+    bool stage(const uint8_t *data, size_t len) {
+        if (len == 0) return true;
+        fileBytes_ += len;
+        if (!buffer_ || capacity_ == 0) return writeOut(data, len);
+        if (used_ + len > capacity_ && !drain()) return false;
+        // Larger than the whole buffer: nothing to gain from copying it
+        if (len > capacity_) return writeOut(data, len);
+        memcpy(buffer_ + used_, data, len);
+        used_ += len;
+        return true;
+    }
+
+    bool drain() {
+        if (used_ == 0) return true;
+        bool ok = writeOut(buffer_, used_);
+        used_ = 0;
+        return ok;
+    }
+
+    bool writeOut(const uint8_t *data, size_t len) {
+        size_t written = file_.write(data, len);
+        stats_.writes++;
+        stats_.bytes += written;
+        if (written != len) {
+            stats_.failed++;
+            return false;
+        }
+        return true;
+    }
+
+    FileT file_;
+    bool open_ = false;
+    uint8_t *buffer_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    uint32_t flushIntervalMs_ = DEFAULT_FLUSH_INTERVAL_MS;
+    uint32_t openedMs_ = 0;
+    uint32_t lastSyncMs_ = 0;
+    uint32_t lastAppendMs_ = 0;
+    uint32_t syncedBytes_ = 0;
+    uint32_t fileBytes_ = 0;
+    PcapSinkStats stats_;
+};
+
+template <typename FileT> class PcapSink : public CaptureFileWriter<FileT> {
+    typedef CaptureFileWriter<FileT> Base;
+
+public:
+    // Takes over an already opened file. With writeGlobalHeader the pcap file header goes first.
+    bool attach(
+        FileT file, uint32_t nowMs, bool writeGlobalHeader, uint32_t linktype = PCAP_LINKTYPE_IEEE802_11,
+        uint32_t snaplen = PCAP_DEFAULT_SNAPLEN
+    ) {
+        if (!Base::begin(file, nowMs)) return false;
+        if (writeGlobalHeader) {
+            uint8_t hdr[24];
+            Base::put32(hdr, 0xa1b2c3d4);
+            Base::put16(hdr + 4, 2);
+            Base::put16(hdr + 6, 4);
+            Base::put32(hdr + 8, 0);
+            Base::put32(hdr + 12, 0);
+            Base::put32(hdr + 16, snaplen);
+            Base::put32(hdr + 20, linktype);
+            return Base::stage(hdr, sizeof(hdr));
+        }
+        return true;
+    }
+
+    bool append(
+        uint32_t tsSec, uint32_t tsUsec, const uint8_t *data, uint32_t inclLen, uint32_t origLen,
+        uint32_t nowMs
+    ) {
+        if (!Base::open_) return false;
+        if (origLen < inclLen) origLen = inclLen;
+        uint8_t rec[16];
+        Base::put32(rec, tsSec);
+        Base::put32(rec + 4, tsUsec);
+        Base::put32(rec + 8, inclLen);
+        Base::put32(rec + 12, origLen);
+        Base::lastAppendMs_ = nowMs;
+        Base::stats_.frames++;
+        if (!Base::stage(rec, sizeof(rec))) return false;
+        return Base::stage(data, inclLen);
+    }
+};
+
+#endif
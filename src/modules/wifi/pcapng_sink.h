@@ -0,0 +1,198 @@
+#ifndef __PCAPNG_SINK_H__
+#define __PCAPNG_SINK_H__
+// Buffered pcapng writer with a radiotap header in front of every frame (linktype 127), so
+// RSSI and channel from rx_ctrl survive into the capture. Each channel gets its own Interface
+// Description Block, written the first time a frame from that channel shows up in the file.
+// Rotation is decided here (rotationDue) but performed by the owner, which knows how to name
+// and open the next file. Plain C++, same FileT contract as PcapSink.
+#include "pcap_sink.h"
+
+#define PCAP_LINKTYPE_IEEE802_11_RADIOTAP 127
+
+// Radiotap fields written per frame: Flags, Channel, dBm Antenna Signal
+const uint8_t RADIOTAP_HEADER_LEN = 15;
+const uint8_t RADIOTAP_FLAG_FCS = 0x10; // frame ends with the 4-byte FCS
+
+inline uint16_t wifiChannelToMhz(uint8_t channel) {
+    if (channel == 14) return 2484;
+    if (channel < 14) return 2407 + channel * 5;
+    return 5000 + channel * 5;
+}
+
+// Writes the radiotap header into out (RADIOTAP_HEADER_LEN bytes), returns its length
+inline uint8_t buildRadiotapHeader(uint8_t *out, uint8_t channel, int8_t rssi, bool fcs) {
+    const uint16_t freq = wifiChannelToMhz(channel);
+    const uint16_t chanFlags = channel > 14 ? 0x0100 : 0x0080; // 5 GHz : 2 GHz spectrum
+    const uint32_t present = (1u << 1) | (1u << 3) | (1u << 5);
+    out[0] = 0; // version
+    out[1] = 0; // pad
+    out[2] = RADIOTAP_HEADER_LEN;
+    out[3] = 0;
+    out[4] = present & 0xFF;
+    out[5] = (present >> 8) & 0xFF;
+    out[6] = (present >> 16) & 0xFF;
+    out[7] = present >> 24;
+    out[8] = fcs ? RADIOTAP_FLAG_FCS : 0;
+    out[9] = 0; // channel field is 2-byte aligned
+    out[10] = freq & 0xFF;
+    out[11] = freq >> 8;
+    out[12] = chanFlags & 0xFF;
+    out[13] = chanFlags >> 8;
+    out[14] = (uint8_t)rssi;
+    return RADIOTAP_HEADER_LEN;
+}
+
+template <typename FileT> class PcapngSink : public CaptureFileWriter<FileT> {
+    typedef CaptureFileWriter<FileT> Base;
+
+public:
+    static const uint8_t MAX_INTERFACES = 48;
+    static const uint8_t MAX_CHANNEL = 200;
+    static const uint16_t MAX_COMMENT_LEN = 128;
+
+    // Rotation thresholds, 0 disables either one
+    void setRotation(uint32_t maxBytes, uint32_t maxAgeMs) {
+        rotateBytes_ = maxBytes;
+        rotateAgeMs_ = maxAgeMs;
+    }
+
+    // Takes over a freshly created file and starts a new section in it
+    bool attach(
+        FileT file, uint32_t nowMs, const char *application = nullptr, uint32_t snaplen = PCAP_DEFAULT_SNAPLEN
+    ) {
+        if (!Base::begin(file, nowMs)) return false;
+        snaplen_ = snaplen;
+        interfaceCount_ = 0;
+        memset(interfaceFor_, NO_INTERFACE, sizeof(interfaceFor_));
+
+        const size_t appLen = application ? strnlen(application, MAX_COMMENT_LEN) : 0;
+        const uint32_t optLen = appLen ? 4 + pad4(appLen) + 4 : 0;
+        const uint32_t total = 28 + optLen;
+        uint8_t shb[28];
+        Base::put32(shb, 0x0A0D0D0A);
+        Base::put32(shb + 4, total);
+        Base::put32(shb + 8, 0x1A2B3C4D); // byte-order magic
+        Base::put16(shb + 12, 1);
+        Base::put16(shb + 14, 0);
+        Base::put32(shb + 16, 0xFFFFFFFF); // section length unknown
+        Base::put32(shb + 20, 0xFFFFFFFF);
+        if (!Base::stage(shb, 24)) return false;
+        if (appLen && !stageOption(4, (const uint8_t *)application, appLen)) return false; // shb_userappl
+        if (appLen && !stageEndOfOptions()) return false;
+        Base::put32(shb, total);
+        return Base::stage(shb, 4);
+    }
+
+    // tsUsec is microseconds, as announced by if_tsresol in every IDB
+    bool append(
+        uint64_t tsUsec, uint8_t channel, int8_t rssi, bool fcs, const uint8_t *data, uint32_t inclLen,
+        uint32_t origLen, uint32_t nowMs, const char *comment = nullptr
+    ) {
+        if (!Base::open_) return false;
+        uint32_t iface = interfaceFor(channel);
+        if (iface == NO_INTERFACE) return false;
+        if (origLen < inclLen) origLen = inclLen;
+
+        uint8_t radiotap[RADIOTAP_HEADER_LEN];
+        const uint8_t rtLen = buildRadiotapHeader(radiotap, channel, rssi, fcs);
+        const uint32_t captured = rtLen + inclLen;
+        const size_t commentLen = comment ? strnlen(comment, MAX_COMMENT_LEN) : 0;
+        const uint32_t optLen = commentLen ? 4 + pad4(commentLen) + 4 : 0;
+        const uint32_t total = 28 + pad4(captured) + optLen + 4;
+
+        uint8_t epb[28];
+        Base::put32(epb, 0x00000006);
+        Base::put32(epb + 4, total);
+        Base::put32(epb + 8, iface);
+        Base::put32(epb + 12, (uint32_t)(tsUsec >> 32));
+        Base::put32(epb + 16, (uint32_t)tsUsec);
+        Base::put32(epb + 20, captured);
+        Base::put32(epb + 24, rtLen + origLen);
+        Base::lastAppendMs_ = nowMs;
+        Base::stats_.frames++;
+        if (!Base::stage(epb, sizeof(epb))) return false;
+        if (!Base::stage(radiotap, rtLen)) return false;
+        if (!Base::stage(data, inclLen)) return false;
+        if (!stagePadding(captured)) return false;
+        if (commentLen) {
+            if (!stageOption(1, (const uint8_t *)comment, commentLen)) return false; // opt_comment
+            if (!stageEndOfOptions()) return false;
+        }
+        Base::put32(epb, total);
+        return Base::stage(epb, 4);
+    }
+
+    bool rotationDue(uint32_t nowMs) const {
+        if (!Base::open_) return false;
+        if (rotateBytes_ && Base::fileBytes_ >= rotateBytes_) return true;
+        return rotateAgeMs_ && (uint32_t)(nowMs - Base::openedMs_) >= rotateAgeMs_;
+    }
+
+    uint8_t interfaceCount() const { return interfaceCount_; }
+
+private:
+    static const uint8_t NO_INTERFACE = 0xFF;
+
+    static uint32_t pad4(uint32_t len) { return (len + 3) & ~(uint32_t)3; }
+
+    bool stagePadding(uint32_t len) {
+        static const uint8_t zeros[4] = {0, 0, 0, 0};
+        return Base::stage(zeros, pad4(len) - len);
+    }
+
+    bool stageOption(uint16_t code, const uint8_t *value, uint16_t len) {
+        uint8_t hdr[4];
+        Base::put16(hdr, code);
+        Base::put16(hdr + 2, len);
+        if (!Base::stage(hdr, sizeof(hdr))) return false;
+        if (!Base::stage(value, len)) return false;
+        return stagePadding(len);
+    }
+
+    bool stageEndOfOptions() {
+        static const uint8_t end[4] = {0, 0, 0, 0};
+        return Base::stage(end, sizeof(end));
+    }
+
+    // Emits the IDB for a channel the first time it is needed in the current file
+    uint32_t interfaceFor(uint8_t channel) {
+        if (channel > MAX_CHANNEL) channel = 0;
+        if (interfaceFor_[channel] != NO_INTERFACE) return interfaceFor_[channel];
+        if (interfaceCount_ >= MAX_INTERFACES) return NO_INTERFACE;
+
+        char name[12];
+        size_t nameLen = 0;
+        name[nameLen++] = 'c';
+        name[nameLen++] = 'h';
+        if (channel >= 100) name[nameLen++] = '0' + channel / 100;
+        if (channel >= 10) name[nameLen++] = '0' + (channel / 10) % 10;
+        name[nameLen++] = '0' + channel % 10;
+        const uint8_t tsresol = 6; // microseconds
+
+        // block header (8) + linktype/reserved/snaplen (8) + if_name + if_tsresol + end + trailer (4)
+        const uint32_t total = 16 + 4 + pad4(nameLen) + 4 + 4 + 4 + 4;
+        uint8_t idb[16];
+        Base::put32(idb, 0x00000001);
+        Base::put32(idb + 4, total);
+        Base::put16(idb + 8, PCAP_LINKTYPE_IEEE802_11_RADIOTAP);
+        Base::put16(idb + 10, 0);
+        Base::put32(idb + 12, snaplen_ + RADIOTAP_HEADER_LEN);
+        if (!Base::stage(idb, sizeof(idb))) return NO_INTERFACE;
+        if (!stageOption(2, (const uint8_t *)name, nameLen)) return NO_INTERFACE; // if_name
+        if (!stageOption(9, &tsresol, 1)) return NO_INTERFACE;                    // if_tsresol
+        if (!stageEndOfOptions()) return NO_INTERFACE;
+        Base::put32(idb, total);
+        if (!Base::stage(idb, 4)) return NO_INTERFACE;
+
+        interfaceFor_[channel] = interfaceCount_;
+        return interfaceCount_++;
+    }
+
+    uint32_t snaplen_ = PCAP_DEFAULT_SNAPLEN;
+    uint32_t rotateBytes_ = 0;
+    uint32_t rotateAgeMs_ = 0;
+    uint8_t interfaceCount_ = 0;
+    uint8_t interfaceFor_[MAX_CHANNEL + 1];
+};
+
+#endif
@@ -21,8 +21,6 @@
 #include "nvs_flash.h"
 #include <algorithm>
 #include <ctype.h>
-#include <map>
-#include <set>
 #include <vector>
 
 #include "FS.h"
@@ -39,6 +37,11 @@
 #include <SPI.h>
 #include <SdFat.h>
 #endif
+#include "modules/wifi/frame_bus.h"
+#include "modules/wifi/hc22000.h"
+#include "modules/wifi/packet_slab.h"
+#include "modules/wifi/pcap_sink.h"
+#include "modules/wifi/pcapng_sink.h"
 #include "modules/wifi/wifi_atks.h" // to use deauth frames and cmds
 
 //===== SETTINGS =====//
@@ -68,39 +71,87 @@ long deauth_tmp = 0;
 
 File _pcap_file;
 File _deauth_file;
+PcapngSink<File> rawSink;
+PcapngSink<File> deauthSink;
 bool deauthFileOpen = false;
 SnifferMode currentMode = SnifferMode::HandshakesOnly;
 bool sdDetected = false;
 FS *activeFs = &LittleFS;
 SemaphoreHandle_t fileMutex = nullptr;
-QueueHandle_t snifferQueue = nullptr;
+PacketSlab snifferSlab;
+uint8_t *snifferSlabMemory = nullptr;
+volatile bool snifferWriterBusy = false;
+volatile bool snifferWriterStop = false;
 TaskHandle_t snifferWriterHandle = nullptr;
 StaticSemaphore_t fileMutexBuffer;
 SemaphoreHandle_t handshakeMutex = nullptr;
 StaticSemaphore_t handshakeMutexBuffer;
-std::set<BeaconList> registeredBeacons;
-std::set<String> SavedHS; // Saves the MAC of beacon HS detected in the session
-String filename = "/BrucePCAP/" + (String)FILENAME + ".pcap";
-String deauthFilename = "/BrucePCAP/deauth_0.pcap";
+BeaconTable registeredBeacons;
+// Handshake files written in the session, key = MAC << 8 | low byte of the SSID label hash
+MacSsidTable savedHandshakes;
+String filename = "/BrucePCAP/" + (String)FILENAME + ".pcapng";
+String deauthFilename = "/BrucePCAP/deauth_0.pcapng";
 int deauthFileIndex = 0;
 int rawFileIndex = 0;
-std::map<uint64_t, String> beaconSsidCache;
 const size_t MAX_CAPTURE_SSID_LEN = 32;
-const size_t SNIFFER_QUEUE_DEPTH = 48;
-std::set<uint64_t> handshakeReadyBssids;
+// Slab geometry: frames beyond the payload size are stored truncated (incl_len < orig_len)
+const uint16_t SNIFFER_SLOTS_PSRAM = 96;
+const uint16_t SNIFFER_SLOT_PAYLOAD_PSRAM = 2500;
+const uint16_t SNIFFER_SLOTS_INTERNAL = 16;
+const uint16_t SNIFFER_SLOT_PAYLOAD_INTERNAL = 1600;
+
+// pcap write buffers. Handshake files stay open in a small cache and are closed once idle,
+// which also commits their FAT directory entry. SD.begin() leaves the VFS at 5 open files: raw,
+// deauth, the 22000 line being written and the handshake slots must fit in that.
+const size_t RAW_SINK_BUFFER_PSRAM = 32 * 1024;
+const size_t RAW_SINK_BUFFER_INTERNAL = 8 * 1024;
+const size_t DEAUTH_SINK_BUFFER = 2 * 1024;
+const size_t HS_SINK_BUFFER = 1024;
+const uint8_t HS_SINK_SLOTS = 2;
+const uint32_t HS_SINK_IDLE_CLOSE_MS = 5000;
+// Raw and deauth captures are pcapng with radiotap (RSSI, channel). Raw files roll over to the
+// next index when either limit is hit, keeping single files manageable on FAT.
+const uint32_t RAW_ROTATE_BYTES = 16 * 1024 * 1024;
+const uint32_t RAW_ROTATE_MS = 30 * 60 * 1000;
+const char *const PCAPNG_APPLICATION = "Bruce";
+
+// hashcat 22000 lines extracted from EAPOL frames as they are written, one file per session
+Hc22000Extractor hashExtractor;
+String hashFilePath = "";
+int hashFileIndex = 0;
+const size_t HASH_DEDUP_SLOTS = 128;
+
+struct HandshakeSinkEntry {
+    String path;
+    PcapSink<File> sink;
+};
+HandshakeSinkEntry handshakeSinks[HS_SINK_SLOTS];
+uint8_t *sinkBufferMemory = nullptr;
+MacSet handshakeReadyBssids;
 portMUX_TYPE handshakeReadyMux = portMUX_INITIALIZER_UNLOCKED;
-std::set<uint64_t> handshakeBeaconLogged;
-
-// --- New globals for beacon last-seen tracking & cleanup ---
-std::map<uint64_t, uint32_t> beaconLastSeen; // key = macToKey(mac) -> last seen millis()
-const uint32_t BEACON_TIMEOUT_MS = 120000;   // 2 minutes
+MacSet handshakeBeaconLogged;
+
+// --- Beacon SSID and last-seen tracking, key = macKey(apAddr) ---
+MacTable<BeaconInfo> beaconInfo;
+const uint32_t BEACON_TIMEOUT_MS = 120000; // 2 minutes
+SnifferAnalysisStats analysisStats;
+SnifferAnalysisState analysisState = {
+    &registeredBeacons, &beaconInfo, &analysisStats, &hsTracker, targetBssid, &beacon_frames
+};
 unsigned long lastBeaconCleanup = 0;
 
+// Table sizes (slots, 3/4 usable). Allocated once with the rest of the sniffer backend.
+const size_t BEACON_TABLE_SLOTS_PSRAM = 1024;
+const size_t BEACON_TABLE_SLOTS_INTERNAL = 256;
+const size_t HANDSHAKE_TABLE_SLOTS = 64;
+
+// Lives at the start of each slab slot, the packet copy follows it in the same slot
 struct SnifferQueueItem {
     wifi_promiscuous_pkt_t *packet = nullptr;
     uint32_t ts_sec = 0;
     uint32_t ts_usec = 0;
     uint16_t raw_len = 0;
+    uint16_t orig_len = 0;
     wifi_promiscuous_pkt_type_t type = WIFI_PKT_MISC;
     bool isBeacon = false;
     bool isHandshakeFrame = false;
@@ -109,36 +160,32 @@ struct SnifferQueueItem {
     bool saveHandshake = false;
     bool saveDeauth = false;
     uint8_t bssid[6] = {0};
-    char ssid[MAX_CAPTURE_SSID_LEN + 1] = {0};
-};
-
-struct FrameInfo {
-    bool valid = false;
-    bool isBeacon = false;
-    bool isDeauth = false;
-    bool isEapol = false;
-    int eapolMsgNum = -1;
-    uint8_t apAddr[6] = {0};
-    uint64_t apKey = 0;
-    String ssid;
+    char ssid[MAX_CAPTURE_SSID_LEN + 1] = {0}; // printable label for paths and comments
+    bool ssidKnown = false;                    // false when ssid holds the "UNKNOWN" label
+    uint8_t ssidRawLen = 0;
+    uint8_t ssidRaw[MAX_CAPTURE_SSID_LEN] = {0}; // ESSID bytes as broadcast, for the 22000 lines
 };
 
 static bool ensureSnifferBackend();
 static void snifferWriterTask(void *param);
-static wifi_promiscuous_pkt_t *duplicatePacket(const wifi_promiscuous_pkt_t *pkt, uint16_t length);
-static void releasePacketCopy(wifi_promiscuous_pkt_t *packet);
-static uint64_t macToKey(const void *mac); // changed to const void *
+static bool allocateSnifferSlab();
+static bool allocateSinkBuffers();
+static bool allocateSnifferTables();
+static void releaseSinkBuffers();
+static PcapSink<File> *handshakeSinkFor(const String &path, FS &Fs, bool exists);
+static void flushCaptureSinks(uint32_t now, bool force);
+static void closeHandshakeSinks();
+static size_t slotHeaderSize();
 static void copyMac(uint8_t *dest, const uint8_t *src);
-static String extractSsid(const wifi_promiscuous_pkt_t *packet);
-static void copySsidToBuffer(const String &ssid, char *buffer, size_t len);
+static void copySsidToBuffer(const char *ssid, char *buffer, size_t len);
+static size_t printableSsid(const FixedSsid &ssid, char *buffer, size_t len);
 static String sanitizeSsid(const char *ssid);
 static String macToHex(const uint8_t *mac);
 static String buildHandshakePath(const uint8_t *mac, const char *ssid);
-static bool handshakeFileExists(const String &path);
 static bool shouldSaveBeaconForHandshake(const uint8_t *mac);
 static void resetHandshakeTracking();
-static bool handshakeRecordExists(const String &path);
-static void registerHandshakeRecord(const String &path);
+static bool handshakeRecordExists(const uint8_t *mac, const char *ssidLabel);
+static void registerHandshakeRecord(const uint8_t *mac, const char *ssidLabel);
 static bool handshakeBeaconRecorded(uint64_t key);
 static void registerHandshakeBeacon(uint64_t key);
 static void resetHandshakeBeaconCache();
@@ -152,9 +199,6 @@ static String currentModeString();
 static bool rawCaptureEnabled();
 static bool handshakeCaptureEnabled();
 static bool deauthCaptureEnabled();
-static FrameInfo analyzeFrame(wifi_promiscuous_pkt_t *pkt);
-static String resolveSsidForFrame(FrameInfo &info, const wifi_promiscuous_pkt_t *packet);
-static void registerBeacon(const uint8_t *apAddr);
 
 // --- New helper prototypes ---
 static void cleanupStaleBeacons();
@@ -180,78 +224,13 @@ const uint16_t DEAUTH_BG = TFT_BLACK; // background color used to clear the text
 
 // Handshake detection
 bool isItEAPOL(const wifi_promiscuous_pkt_t *packet) {
-    const uint8_t *payload = packet->payload;
-    int len = packet->rx_ctrl.sig_len;
-
-    // length check to ensure packet is large enough for EAPOL (minimum length)
-    if (len < (24 + 8 + 4)) { // 24 bytes for the MAC header, 8 for LLC/SNAP, 4 for EAPOL minimum
-        return false;
-    }
-
-    // check for LLC/SNAP header indicating EAPOL payload
-    // LLC: AA-AA-03, SNAP: 00-00-00-88-8E for EAPOL
-    if (payload[24] == 0xAA && payload[25] == 0xAA && payload[26] == 0x03 && payload[27] == 0x00 &&
-        payload[28] == 0x00 && payload[29] == 0x00 && payload[30] == 0x88 && payload[31] == 0x8E) {
-        return true;
-    }
-
-    // handle QoS tagging which shifts the start of the LLC/SNAP headers by 2 bytes
-    // check if the frame control field's subtype indicates a QoS data subtype (0x08)
-    if ((payload[0] & 0x0F) == 0x08) {
-        // Adjust for the QoS Control field and recheck for LLC/SNAP header
-        if (payload[26] == 0xAA && payload[27] == 0xAA && payload[28] == 0x03 && payload[29] == 0x00 &&
-            payload[30] == 0x00 && payload[31] == 0x00 && payload[32] == 0x88 && payload[33] == 0x8E) {
-            return true;
-        }
-    }
-
-    return false;
+    WifiFrameDesc frame;
+    if (!parseWifiFrame(packet->payload, packet->rx_ctrl.sig_len, 0, 0, frame)) return false;
+    return frame.is(WIFI_FRAME_EAPOL);
 }
 
 HandshakeTracker hsTracker;
 
-bool handshakeUsable(const HandshakeTracker &hs) { // EAPOL Messages needed: 1+2 or 3+4
-    return (hs.msg1 && hs.msg2) || (hs.msg3 && hs.msg4);
-}
-
-// Analyze the EAPOL Message Number
-int classifyEapolMessage(const wifi_promiscuous_pkt_t *pkt) {
-    const uint8_t *payload = pkt->payload;
-    // QoS frames add 2 bytes to MAC header
-    int qosOffset = ((payload[0] & 0x0F) == 0x08) ? 2 : 0;
-
-    // Offset to Key Information field:
-    // MAC header (24 + qosOffset) + LLC/SNAP (8) + EAPOL header (4) + Descriptor Type (1)
-    int keyInfoOffset = 24 + qosOffset + 8 + 4 + 1;
-
-    if (pkt->rx_ctrl.sig_len < keyInfoOffset + 2) return -1; // safety check
-
-    uint16_t keyInfo = (payload[keyInfoOffset] << 8) | payload[keyInfoOffset + 1];
-
-    bool install = keyInfo & (1 << 6);
-    bool ack = keyInfo & (1 << 7);
-    bool mic = keyInfo & (1 << 8);
-    bool secure = keyInfo & (1 << 9);
-
-    if (ack && !mic && !install) return 1;            // Message 1
-    if (!ack && mic && !install && !secure) return 2; // Message 2
-    if (ack && mic && install) return 3;              // Message 3
-    if (!ack && mic && !install && secure) return 4;  // Message 4
-
-    return -1; // Unknown
-}
-
-bool matchesTargetAP(const wifi_promiscuous_pkt_t *pkt, const uint8_t targetBssid[6]) {
-    const uint8_t *payload = pkt->payload;
-
-    const uint8_t *addr1 = payload + 4;
-    const uint8_t *addr2 = payload + 10;
-    const uint8_t *addr3 = payload + 16; // BSSID
-
-    return memcmp(addr1, targetBssid, 6) == 0 || memcmp(addr2, targetBssid, 6) == 0 ||
-           memcmp(addr3, targetBssid, 6) == 0;
-}
-
 // Définition de l'en-tête d'un paquet PCAP
 typedef struct pcaprec_hdr_s {
     uint32_t ts_sec;   /* timestamp secondes */
@@ -277,45 +256,90 @@ void saveHandshake(const wifi_promiscuous_pkt_t *packet, bool beacon, FS &Fs, co
     String filePath = buildHandshakePath(apAddr, sanitizedSsid.c_str());
 
     // Vérifier si le fichier existe déjà
-    bool fichierExiste = handshakeFileExists(filePath);
+    bool fichierExiste = handshakeRecordExists(apAddr, sanitizedSsid.c_str());
 
     // Si probe est true et que le fichier n'existe pas, ignorer l'enregistrement
     if (beacon && !fichierExiste) { return; }
 
-    // Ouvrir le fichier en mode ajout si existant sinon en mode écriture
-    File fichierPcap = Fs.open(
-        filePath, fichierExiste ? FILE_APPEND : FILE_WRITE
-    ); // if the file already exists in the new session, will overwrite it
-    if (!fichierPcap) {
+    if (beacon && fichierExiste) {
+        uint64_t beaconKey = macKey(apAddr);
+        if (handshakeBeaconRecorded(beaconKey)) { return; }
+        registerHandshakeBeacon(beaconKey);
+    }
+
+    // Files stay open between frames, a new one in this session is (re)created with a header
+    if (!lockFileMutex(pdMS_TO_TICKS(200))) { return; }
+    PcapSink<File> *sink = handshakeSinkFor(filePath, Fs, fichierExiste);
+    if (!sink) {
+        unlockFileMutex();
         Serial.println("Fail creating the EAPOL/Handshake PCAP file");
         return;
     }
+    sink->append(
+        packet->rx_ctrl.timestamp / 1000000,
+        packet->rx_ctrl.timestamp % 1000000,
+        packet->payload,
+        packet->rx_ctrl.sig_len,
+        packet->rx_ctrl.sig_len,
+        millis()
+    );
+    unlockFileMutex();
 
     if (!beacon && !fichierExiste) {
-        // Serial.println("New EAPOL/Handshake PCAP file, writing header");
-        registerHandshakeRecord(filePath);
+        registerHandshakeRecord(apAddr, sanitizedSsid.c_str());
         num_HS++;
-        writeHeader(fichierPcap);
-        markHandshakeReady(macToKey(apAddr));
+        markHandshakeReady(macKey(apAddr));
     }
-    if (beacon && fichierExiste) {
-        uint64_t beaconKey = macToKey(apAddr);
-        if (handshakeBeaconRecorded(beaconKey)) {
-            fichierPcap.close();
-            return;
+}
+
+// Must be called with fileMutex held
+static PcapSink<File> *handshakeSinkFor(const String &path, FS &Fs, bool exists) {
+    HandshakeSinkEntry *victim = &handshakeSinks[0];
+    for (auto &entry : handshakeSinks) {
+        if (entry.sink.isOpen() && entry.path == path) { return &entry.sink; }
+        if (!entry.sink.isOpen()) {
+            victim = &entry;
+        } else if (victim->sink.isOpen() && entry.sink.lastAppendMs() < victim->sink.lastAppendMs()) {
+            victim = &entry;
         }
-        registerHandshakeBeacon(beaconKey);
     }
+    victim->sink.close();
+    File file = Fs.open(path, exists ? FILE_APPEND : FILE_WRITE);
+    if (!file) { return nullptr; }
+    victim->path = path;
+    if (!victim->sink.attach(file, millis(), !exists)) { return nullptr; }
+    return &victim->sink;
+}
+
+static void closeHandshakeSinks() {
+    for (auto &entry : handshakeSinks) {
+        entry.sink.close();
+        entry.path = "";
+    }
+}
 
-    // Écrire l'en-tête du paquet et le paquet lui-même dans le fichier
-    pcaprec_hdr_t pcap_packet_header;
-    pcap_packet_header.ts_sec = packet->rx_ctrl.timestamp / 1000000;
-    pcap_packet_header.ts_usec = packet->rx_ctrl.timestamp % 1000000;
-    pcap_packet_header.incl_len = packet->rx_ctrl.sig_len;
-    pcap_packet_header.orig_len = packet->rx_ctrl.sig_len;
-    fichierPcap.write((const byte *)&pcap_packet_header, sizeof(pcaprec_hdr_t));
-    fichierPcap.write(packet->payload, packet->rx_ctrl.sig_len);
-    fichierPcap.close();
+// Called by the writer task after each drain and by the UI loop once per second
+static void flushCaptureSinks(uint32_t now, bool force) {
+    if (!lockFileMutex(pdMS_TO_TICKS(50))) { return; }
+    if (force) {
+        rawSink.flush(now);
+        deauthSink.flush(now);
+    } else {
+        rawSink.poll(now);
+        deauthSink.poll(now);
+    }
+    for (auto &entry : handshakeSinks) {
+        if (!entry.sink.isOpen()) { continue; }
+        if ((uint32_t)(now - entry.sink.lastAppendMs()) > HS_SINK_IDLE_CLOSE_MS) {
+            entry.sink.close();
+            entry.path = "";
+        } else if (force) {
+            entry.sink.flush(now);
+        } else {
+            entry.sink.poll(now);
+        }
+    }
+    unlockFileMutex();
 }
 
 static String sanitizeSsid(const char *ssid) {
@@ -340,8 +364,6 @@ static String macToHex(const uint8_t *mac) {
     return String(buffer);
 }
 
-static bool handshakeFileExists(const String &path) { return handshakeRecordExists(path); }
-
 static String buildHandshakePath(const uint8_t *mac, const char *ssid) {
     String path = "/BrucePCAP/handshakes/HS_" + macToHex(mac);
     if (ssid && ssid[0] != '\0') {
@@ -354,10 +376,10 @@ static String buildHandshakePath(const uint8_t *mac, const char *ssid) {
 
 static bool shouldSaveBeaconForHandshake(const uint8_t *mac) {
     if (!mac) return false;
-    uint64_t key = macToKey(mac);
+    uint64_t key = macKey(mac);
     bool ready = false;
     portENTER_CRITICAL(&handshakeReadyMux);
-    ready = handshakeReadyBssids.find(key) != handshakeReadyBssids.end();
+    ready = handshakeReadyBssids.contains(key);
     portEXIT_CRITICAL(&handshakeReadyMux);
     return ready;
 }
@@ -374,37 +396,51 @@ static void resetHandshakeTracking() {
     portEXIT_CRITICAL(&handshakeReadyMux);
 }
 
-static bool handshakeRecordExists(const String &path) {
-    if (!handshakeMutex) { return SavedHS.find(path) != SavedHS.end(); }
+static bool savedHandshakeMatches(const uint8_t *mac, const char *ssidLabel) {
+    return savedHandshakes.contains(mac, ssidLabel, strlen(ssidLabel));
+}
+
+static void storeHandshakeRecord(const uint8_t *mac, const char *ssidLabel) {
+    savedHandshakes.insert(mac, ssidLabel, strlen(ssidLabel));
+}
+
+static bool handshakeRecordExists(const uint8_t *mac, const char *ssidLabel) {
+    if (!handshakeMutex) { return savedHandshakeMatches(mac, ssidLabel); }
     if (xSemaphoreTake(handshakeMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-        bool exists = SavedHS.find(path) != SavedHS.end();
+        bool exists = savedHandshakeMatches(mac, ssidLabel);
         xSemaphoreGive(handshakeMutex);
         return exists;
     }
-    return SavedHS.find(path) != SavedHS.end();
+    return savedHandshakeMatches(mac, ssidLabel);
 }
 
-static void registerHandshakeRecord(const String &path) {
+static void registerHandshakeRecord(const uint8_t *mac, const char *ssidLabel) {
     if (!handshakeMutex) {
-        SavedHS.insert(path);
+        storeHandshakeRecord(mac, ssidLabel);
         return;
     }
     if (xSemaphoreTake(handshakeMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-        SavedHS.insert(path);
+        storeHandshakeRecord(mac, ssidLabel);
         xSemaphoreGive(handshakeMutex);
     } else {
-        SavedHS.insert(path);
+        storeHandshakeRecord(mac, ssidLabel);
     }
 }
 
+void sniffer_register_handshake(const uint8_t *bssid, const char *ssidLabel) {
+    if (!bssid || !ssidLabel) return;
+    allocateSnifferTables();
+    registerHandshakeRecord(bssid, ssidLabel);
+}
+
 static bool handshakeBeaconRecorded(uint64_t key) {
-    if (!handshakeMutex) { return handshakeBeaconLogged.find(key) != handshakeBeaconLogged.end(); }
+    if (!handshakeMutex) { return handshakeBeaconLogged.contains(key); }
     if (xSemaphoreTake(handshakeMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-        bool exists = handshakeBeaconLogged.find(key) != handshakeBeaconLogged.end();
+        bool exists = handshakeBeaconLogged.contains(key);
         xSemaphoreGive(handshakeMutex);
         return exists;
     }
-    return handshakeBeaconLogged.find(key) != handshakeBeaconLogged.end();
+    return handshakeBeaconLogged.contains(key);
 }
 
 static void registerHandshakeBeacon(uint64_t key) {
@@ -433,127 +469,98 @@ static void resetHandshakeBeaconCache() {
     }
 }
 
-static void registerBeacon(const uint8_t *apAddr) {
-    if (!apAddr) return;
-    BeaconList beacon;
-    memcpy(beacon.MAC, apAddr, sizeof(beacon.MAC));
-    beacon.channel = ch;
-    registeredBeacons.insert(beacon);
+static void copyMac(uint8_t *dest, const uint8_t *src) { memcpy(dest, src, 6); }
+
+static void copySsidToBuffer(const char *ssid, char *buffer, size_t len) {
+    if (!buffer || len == 0) return;
+    size_t copyLen = std::min<size_t>(strlen(ssid), len - 1);
+    memcpy(buffer, ssid, copyLen);
+    buffer[copyLen] = '\0';
 }
 
-static String resolveSsidForFrame(FrameInfo &info, const wifi_promiscuous_pkt_t *packet) {
-    if (!packet) return "";
-    if (info.isBeacon) {
-        beacon_frames++;
-        String ssid = extractSsid(packet);
-        beaconSsidCache[info.apKey] = ssid;
-        return ssid;
+// Printable characters of ssid, NUL terminated, returns the length written
+static size_t printableSsid(const FixedSsid &ssid, char *buffer, size_t len) {
+    if (!buffer || len == 0) return 0;
+    size_t n = 0;
+    for (uint8_t i = 0; i < ssid.len && n + 1 < len; ++i) {
+        if (isprint((uint8_t)ssid.text[i])) { buffer[n++] = ssid.text[i]; }
     }
-    auto it = beaconSsidCache.find(info.apKey);
-    if (it != beaconSsidCache.end()) { return it->second; }
-    return "";
+    buffer[n] = '\0';
+    return n;
 }
 
-static FrameInfo analyzeFrame(wifi_promiscuous_pkt_t *pkt) {
-    FrameInfo info;
-    if (!pkt) { return info; } // removed redundant pkt->payload check
-    const uint16_t len = pkt->rx_ctrl.sig_len;
-    if (len < 24) { return info; }
-
-    info.valid = true;
-    const uint8_t *frame = pkt->payload;
-    const uint16_t frameControl = (uint16_t)frame[0] | ((uint16_t)frame[1] << 8);
-    const uint8_t frameType = (frameControl & 0x0C) >> 2;
-    const uint8_t frameSubType = (frameControl & 0xF0) >> 4;
-
-    const uint8_t *addr1 = frame + 4;
-    const uint8_t *addr2 = frame + 10;
-    const uint8_t *bssid = frame + 16;
-    const uint8_t *apAddr = (memcmp(addr1, bssid, 6) == 0) ? addr1 : addr2;
-    copyMac(info.apAddr, apAddr);
-    info.apKey = macToKey(info.apAddr);
-
-    info.isBeacon = (frameType == 0x00 && frameSubType == 0x08);
-    info.isDeauth = (frameType == 0x00) && (frameSubType == 0x0C || frameSubType == 0x0A);
-    info.isEapol = isItEAPOL(pkt);
-
-    if (info.isEapol && matchesTargetAP(pkt, targetBssid)) {
-        int msg = classifyEapolMessage(pkt);
-        info.eapolMsgNum = msg;
-        // Update handshake tracker
-        switch (msg) {
-            case 1: hsTracker.msg1 = true; break;
-            case 2: hsTracker.msg2 = true; break;
-            case 3: hsTracker.msg3 = true; break;
-            case 4: hsTracker.msg4 = true; break;
-        }
+static size_t slotHeaderSize() { return (sizeof(SnifferQueueItem) + 3) & ~(size_t)3; }
+
+// One allocation for the whole capture path, kept for the lifetime of the writer task.
+// PSRAM boards get a deep slab with full-size slots, the others a small one in internal RAM.
+static bool allocateSnifferSlab() {
+    if (snifferSlab.ready()) { return true; }
+    uint16_t slots = SNIFFER_SLOTS_INTERNAL;
+    uint16_t payload = SNIFFER_SLOT_PAYLOAD_INTERNAL;
+    size_t slotSize = 0;
+    if (psramFound()) {
+        slots = SNIFFER_SLOTS_PSRAM;
+        payload = SNIFFER_SLOT_PAYLOAD_PSRAM;
+        slotSize = slotHeaderSize() + sizeof(wifi_pkt_rx_ctrl_t) + payload;
+        snifferSlabMemory =
+            (uint8_t *)heap_caps_malloc(slots * slotSize, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
     }
-
-    info.ssid = resolveSsidForFrame(info, pkt);
-    if (info.isBeacon) {
-        registerBeacon(info.apAddr);
-        // UPDATE last-seen timestamp for this beacon
-        beaconLastSeen[info.apKey] = (uint32_t)millis();
+    if (!snifferSlabMemory) {
+        slots = SNIFFER_SLOTS_INTERNAL;
+        payload = SNIFFER_SLOT_PAYLOAD_INTERNAL;
+        slotSize = slotHeaderSize() + sizeof(wifi_pkt_rx_ctrl_t) + payload;
+        snifferSlabMemory = (uint8_t *)heap_caps_malloc(slots * slotSize, MALLOC_CAP_8BIT);
     }
-
-    return info;
-}
-
-static uint64_t macToKey(const void *mac) {
-    const uint8_t *u = reinterpret_cast<const uint8_t *>(mac);
-    uint64_t key = 0;
-    for (int i = 0; i < 6; ++i) { key = (key << 8) | (uint64_t)u[i]; }
-    return key;
+    if (!snifferSlabMemory) { return false; }
+    return snifferSlab.init(snifferSlabMemory, slots, (uint16_t)slotSize);
 }
 
-static void copyMac(uint8_t *dest, const uint8_t *src) { memcpy(dest, src, 6); }
-
-static void copySsidToBuffer(const String &ssid, char *buffer, size_t len) {
-    if (!buffer || len == 0) return;
-    size_t copyLen = std::min<size_t>(ssid.length(), len - 1);
-    memcpy(buffer, ssid.c_str(), copyLen);
-    buffer[copyLen] = '\0';
+static bool allocateSnifferTables() {
+    const size_t beaconSlots = psramFound() ? BEACON_TABLE_SLOTS_PSRAM : BEACON_TABLE_SLOTS_INTERNAL;
+    bool ok = registeredBeacons.init(beaconSlots);
+    ok = beaconInfo.init(beaconSlots) && ok;
+    ok = savedHandshakes.init(HANDSHAKE_TABLE_SLOTS) && ok;
+    ok = handshakeBeaconLogged.init(HANDSHAKE_TABLE_SLOTS) && ok;
+    ok = handshakeReadyBssids.init(HANDSHAKE_TABLE_SLOTS) && ok;
+    ok = hashExtractor.init(HASH_DEDUP_SLOTS) && ok;
+    return ok;
 }
 
-static String extractSsid(const wifi_promiscuous_pkt_t *packet) {
-    if (!packet) return "";
-    const uint8_t *payload = packet->payload;
-    int len = packet->rx_ctrl.sig_len;
-    if (len < 36) return "";
-    int offset = 36;
-    while (offset + 1 < len) {
-        uint8_t tagNumber = payload[offset];
-        uint8_t tagLength = payload[offset + 1];
-        if (offset + 2 + tagLength > len) break;
-        if (tagNumber == 0x00) {
-            String ssid = "";
-            for (int i = 0; i < tagLength; ++i) {
-                uint8_t chValue = payload[offset + 2 + i];
-                if (isprint(chValue)) { ssid += (char)chValue; }
-            }
-            return ssid;
-        }
-        offset += 2 + tagLength;
+static bool allocateSinkBuffers() {
+    if (sinkBufferMemory) { return true; }
+    size_t rawSize = RAW_SINK_BUFFER_INTERNAL;
+    if (psramFound()) {
+        rawSize = RAW_SINK_BUFFER_PSRAM;
+        sinkBufferMemory = (uint8_t *)heap_caps_malloc(
+            rawSize + DEAUTH_SINK_BUFFER + HS_SINK_SLOTS * HS_SINK_BUFFER, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM
+        );
     }
-    return "";
-}
-
-static wifi_promiscuous_pkt_t *duplicatePacket(const wifi_promiscuous_pkt_t *pkt, uint16_t length) {
-    size_t total = sizeof(wifi_pkt_rx_ctrl_t) + length;
-    uint8_t *buffer = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-    if (!buffer) { buffer = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_8BIT); }
-    if (!buffer) { buffer = (uint8_t *)malloc(total); }
-    if (!buffer) { return nullptr; }
-    auto *copy = reinterpret_cast<wifi_promiscuous_pkt_t *>(buffer);
-    memcpy(copy, pkt, sizeof(wifi_pkt_rx_ctrl_t));
-    memcpy(buffer + sizeof(wifi_pkt_rx_ctrl_t), pkt->payload, length);
-    copy->rx_ctrl.sig_len = length;
-    return copy;
+    if (!sinkBufferMemory) {
+        rawSize = RAW_SINK_BUFFER_INTERNAL;
+        sinkBufferMemory = (uint8_t *)heap_caps_malloc(
+            rawSize + DEAUTH_SINK_BUFFER + HS_SINK_SLOTS * HS_SINK_BUFFER, MALLOC_CAP_8BIT
+        );
+    }
+    if (!sinkBufferMemory) { return false; }
+    uint8_t *cursor = sinkBufferMemory;
+    rawSink.setBuffer(cursor, rawSize);
+    cursor += rawSize;
+    deauthSink.setBuffer(cursor, DEAUTH_SINK_BUFFER);
+    cursor += DEAUTH_SINK_BUFFER;
+    for (auto &entry : handshakeSinks) {
+        entry.sink.setBuffer(cursor, HS_SINK_BUFFER);
+        cursor += HS_SINK_BUFFER;
+    }
+    return true;
 }
 
-static void releasePacketCopy(wifi_promiscuous_pkt_t *packet) {
-    if (!packet) return;
-    heap_caps_free(packet);
+// Sinks must be closed
+static void releaseSinkBuffers() {
+    rawSink.setBuffer(nullptr, 0);
+    deauthSink.setBuffer(nullptr, 0);
+    for (auto &entry : handshakeSinks) entry.sink.setBuffer(nullptr, 0);
+    free(sinkBufferMemory);
+    sinkBufferMemory = nullptr;
 }
 
 static bool lockFileMutex(TickType_t ticks) {
@@ -574,14 +581,14 @@ static void ensureDirectories(FS &Fs) {
 static void openDeauthFile(FS &Fs) {
     ensureDirectories(Fs);
     closeDeauthFile();
-    deauthFilename = "/BrucePCAP/deauth_" + String(deauthFileIndex) + ".pcap";
+    deauthFilename = "/BrucePCAP/deauth_" + String(deauthFileIndex) + ".pcapng";
     while (Fs.exists(deauthFilename)) {
         deauthFileIndex++;
-        deauthFilename = "/BrucePCAP/deauth_" + String(deauthFileIndex) + ".pcap";
+        deauthFilename = "/BrucePCAP/deauth_" + String(deauthFileIndex) + ".pcapng";
     }
     if (lockFileMutex(pdMS_TO_TICKS(200))) {
         _deauth_file = Fs.open(deauthFilename, FILE_WRITE);
-        deauthFileOpen = _deauth_file && writeHeader(_deauth_file);
+        deauthFileOpen = _deauth_file && deauthSink.attach(_deauth_file, millis(), PCAPNG_APPLICATION);
         unlockFileMutex();
         if (!deauthFileOpen) { Serial.println("Fail opening deauth capture file"); }
     }
@@ -589,10 +596,8 @@ static void openDeauthFile(FS &Fs) {
 
 static void closeRawFile() {
     if (lockFileMutex(pdMS_TO_TICKS(200))) {
-        if (_pcap_file) {
-            _pcap_file.flush();
-            _pcap_file.close();
-        }
+        rawSink.close();
+        if (_pcap_file) { _pcap_file.close(); }
         rawFileOpen = false;
         unlockFileMutex();
     }
@@ -600,10 +605,8 @@ static void closeRawFile() {
 
 static void closeDeauthFile() {
     if (lockFileMutex(pdMS_TO_TICKS(200))) {
-        if (_deauth_file) {
-            _deauth_file.flush();
-            _deauth_file.close();
-        }
+        deauthSink.close();
+        if (_deauth_file) { _deauth_file.close(); }
         deauthFileOpen = false;
         unlockFileMutex();
     }
@@ -626,8 +629,9 @@ static String currentModeString() {
 static bool ensureSnifferBackend() {
     if (!fileMutex) { fileMutex = xSemaphoreCreateMutexStatic(&fileMutexBuffer); }
     if (!handshakeMutex) { handshakeMutex = xSemaphoreCreateMutexStatic(&handshakeMutexBuffer); }
-    if (!snifferQueue) { snifferQueue = xQueueCreate(SNIFFER_QUEUE_DEPTH, sizeof(SnifferQueueItem)); }
-    if (!snifferQueue) { return false; }
+    if (!allocateSnifferSlab()) { return false; }
+    if (!allocateSinkBuffers()) { return false; }
+    if (!allocateSnifferTables()) { return false; }
     if (!snifferWriterHandle) {
 #if SOC_CPU_CORES_NUM > 1
         BaseType_t res = xTaskCreatePinnedToCore(
@@ -642,12 +646,42 @@ static bool ensureSnifferBackend() {
     return snifferWriterHandle != nullptr;
 }
 
+// The driver leaves the FCS on every frame, the callback strips it from management frames
+static bool itemHasFcs(const SnifferQueueItem &item) { return item.type != WIFI_PKT_MGMT; }
+
+static void appendToPcapng(PcapngSink<File> &sink, const SnifferQueueItem &item, const char *comment) {
+    const uint64_t ts = (uint64_t)item.ts_sec * 1000000ULL + item.ts_usec;
+    sink.append(
+        ts,
+        item.packet->rx_ctrl.channel,
+        item.packet->rx_ctrl.rssi,
+        itemHasFcs(item),
+        item.packet->payload,
+        item.raw_len,
+        item.orig_len,
+        millis(),
+        comment
+    );
+}
+
 static void handleRawWrite(const SnifferQueueItem &item) {
     if (!rawCaptureEnabled() || !item.packet) { return; }
+    bool rotate = false;
     if (lockFileMutex(pdMS_TO_TICKS(200))) {
-        newPacketSD(item.ts_sec, item.ts_usec, item.raw_len, item.packet->payload, _pcap_file);
+        char comment[MAX_CAPTURE_SSID_LEN + 8];
+        const char *note = nullptr;
+        if (item.isHandshakeFrame) {
+            snprintf(comment, sizeof(comment), "EAPOL %s", item.ssid);
+            note = comment;
+        }
+        appendToPcapng(rawSink, item, note);
+        rotate = rawSink.rotationDue(millis());
         unlockFileMutex();
     }
+    if (rotate) {
+        rawFileIndex++;
+        openFile(*activeFs);
+    }
 }
 
 static void handleHandshakeWrite(const SnifferQueueItem &item) {
@@ -655,25 +689,88 @@ static void handleHandshakeWrite(const SnifferQueueItem &item) {
     saveHandshake(item.packet, item.isBeacon, *activeFs, item.ssid);
 }
 
+// Extractor emitter, runs in the writer task with fileMutex held. The file is opened per line:
+// lines are rare and this keeps the directory entry current.
+static void writeHashLine(void *ctx, const char *line) {
+    (void)ctx;
+    if (hashFilePath.length() == 0) {
+        do {
+            hashFilePath = "/BrucePCAP/handshakes/session_" + String(hashFileIndex++) + ".22000";
+        } while (activeFs->exists(hashFilePath));
+    }
+    File file = activeFs->open(hashFilePath, FILE_APPEND);
+    if (!file) {
+        Serial.println("Fail opening the 22000 hash file");
+        return;
+    }
+    file.println(line);
+    file.close();
+}
+
+static void handleHashExtract(const SnifferQueueItem &item) {
+    if (!item.packet || !item.ssidKnown) { return; }
+    WifiFrameDesc frame;
+    if (!parseWifiFrame(item.packet->payload, item.raw_len, 0, 0, frame)) { return; }
+    if (lockFileMutex(pdMS_TO_TICKS(200))) {
+        hashExtractor.feed(frame, (const char *)item.ssidRaw, item.ssidRawLen, millis());
+        unlockFileMutex();
+    }
+}
+
 static void handleDeauthWrite(const SnifferQueueItem &item) {
     if (!deauthCaptureEnabled() || !item.packet) { return; }
     if (lockFileMutex(pdMS_TO_TICKS(200))) {
-        newPacketSD(item.ts_sec, item.ts_usec, item.raw_len, item.packet->payload, _deauth_file);
+        appendToPcapng(deauthSink, item, nullptr);
         unlockFileMutex();
     }
 }
 
 static void snifferWriterTask(void *param) {
     (void)param;
-    SnifferQueueItem item;
-    while (true) {
-        if (xQueueReceive(snifferQueue, &item, portMAX_DELAY) == pdTRUE) {
+    uint16_t idx;
+    while (!snifferWriterStop) {
+        // The callback notifies on every commit, the timeout only covers a missed wake-up
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        snifferWriterBusy = true;
+        while (snifferSlab.next(idx)) {
+            const SnifferQueueItem &item = *reinterpret_cast<const SnifferQueueItem *>(snifferSlab.slot(idx));
             if (item.saveRaw) { handleRawWrite(item); }
             if (item.saveHandshake) { handleHandshakeWrite(item); }
+            if (item.saveHandshake && item.isHandshakeFrame) { handleHashExtract(item); }
             if (item.saveDeauth) { handleDeauthWrite(item); }
-            releasePacketCopy(item.packet);
+            snifferSlab.release(idx);
         }
+        flushCaptureSinks(millis(), false);
+        snifferWriterBusy = false;
     }
+    snifferWriterHandle = nullptr;
+    vTaskDelete(NULL);
+}
+
+void sniffer_release_backend() {
+    if (snifferWriterHandle) {
+        sniffer_wait_for_flush(1000);
+        snifferWriterStop = true;
+        xTaskNotifyGive(snifferWriterHandle);
+        for (int i = 0; i < 50 && snifferWriterHandle; ++i) vTaskDelay(pdMS_TO_TICKS(10));
+        if (snifferWriterHandle) {
+            // Still writing, its slots and buffers stay until the next session reuses them
+            Serial.println("[SNIFFER] writer did not stop, keeping its buffers");
+            snifferWriterStop = false;
+            return;
+        }
+        snifferWriterStop = false;
+    }
+    closeRawFile();
+    closeDeauthFile();
+    if (lockFileMutex(pdMS_TO_TICKS(200))) {
+        closeHandshakeSinks();
+        releaseSinkBuffers();
+        unlockFileMutex();
+    }
+    snifferSlab.deinit();
+    free(snifferSlabMemory);
+    snifferSlabMemory = nullptr;
 }
 
 bool sniffer_prepare_storage(FS *fs, bool sdDetectedParam) {
@@ -683,6 +780,12 @@ bool sniffer_prepare_storage(FS *fs, bool sdDetectedParam) {
     isLittleFS = (fs == &LittleFS);
     sdDetected = sdDetectedParam;
     ensureDirectories(*activeFs);
+    if (lockFileMutex(pdMS_TO_TICKS(200))) {
+        hashExtractor.setEmitter(writeHashLine, nullptr);
+        hashExtractor.reset();
+        hashFilePath = "";
+        unlockFileMutex();
+    }
     littleFsSpaceAvailable = !isLittleFS || checkLittleFsSizeNM();
     littleFsWasFull = !littleFsSpaceAvailable && isLittleFS;
     if (currentMode == SnifferMode::Full && !sdDetected) { currentMode = SnifferMode::HandshakesOnly; }
@@ -711,10 +814,10 @@ SnifferMode sniffer_get_mode() { return currentMode; }
 bool sniffer_full_mode_available() { return sdDetected; }
 
 void sniffer_wait_for_flush(uint32_t timeoutMs) {
-    if (!snifferQueue) { return; }
+    if (!snifferSlab.ready()) { return; }
     TickType_t start = xTaskGetTickCount();
     TickType_t deadline = pdMS_TO_TICKS(timeoutMs);
-    while (uxQueueMessagesWaiting(snifferQueue) > 0) {
+    while (snifferSlab.pending() > 0 || snifferWriterBusy) {
         vTaskDelay(pdMS_TO_TICKS(10));
         if (timeoutMs == 0) { continue; }
         if ((xTaskGetTickCount() - start) > deadline) { break; }
@@ -723,10 +826,14 @@ void sniffer_wait_for_flush(uint32_t timeoutMs) {
 
 void sniffer_reset_handshake_cache() {
     if (handshakeMutex && xSemaphoreTake(handshakeMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        SavedHS.clear();
+        savedHandshakes.clear();
         xSemaphoreGive(handshakeMutex);
     } else {
-        SavedHS.clear();
+        savedHandshakes.clear();
+    }
+    if (lockFileMutex(pdMS_TO_TICKS(200))) {
+        closeHandshakeSinks();
+        unlockFileMutex();
     }
     resetHandshakeTracking();
     resetHandshakeBeaconCache();
@@ -740,21 +847,60 @@ void printAddress(const uint8_t *addr) {
     Serial.println();
 }
 
-/* write packet to file */
-void newPacketSD(uint32_t ts_sec, uint32_t ts_usec, uint32_t len, uint8_t *buf, File pcap_file) {
-    if (pcap_file) {
+PacketSlabStats sniffer_get_pool_stats() { return snifferSlab.stats(); }
 
-        uint32_t orig_len = len;
-        uint32_t incl_len = len;
-        // if(incl_len > snaplen) incl_len = snaplen; /* safty check that the packet isn't too big (I ran into
-        // problems here) */
+SnifferAnalysisStats sniffer_get_analysis_stats() { return analysisStats; }
 
-        pcap_file.write((uint8_t *)&ts_sec, sizeof(ts_sec));
-        pcap_file.write((uint8_t *)&ts_usec, sizeof(ts_usec));
-        pcap_file.write((uint8_t *)&incl_len, sizeof(incl_len));
-        pcap_file.write((uint8_t *)&orig_len, sizeof(orig_len));
+// One line per subsystem on the serial console, the on-device stand-in for a replay benchmark
+static void logSnifferStats() {
+    const FrameBusStats bus = frame_bus_get_stats();
+    if (bus.frames) {
+        Serial.printf(
+            "[SNIFFER] frame bus: %lu frames, avg %lu us, max %lu us\n",
+            (unsigned long)bus.frames,
+            (unsigned long)(bus.busyUs / bus.frames),
+            (unsigned long)bus.maxUs
+        );
+    }
+    const SnifferAnalysisStats &a = analysisStats;
+    Serial.printf(
+        "[SNIFFER] ssid cache: %lu/%lu hits, %lu APs tracked, %lu refused (table full)\n",
+        (unsigned long)a.ssidHits,
+        (unsigned long)a.ssidLookups,
+        (unsigned long)a.beaconsTracked,
+        (unsigned long)a.beaconTableFull
+    );
+    const PacketSlabStats slab = snifferSlab.stats();
+    Serial.printf(
+        "[SNIFFER] slab: %lu queued, %lu dropped, peak %lu/%u\n",
+        (unsigned long)slab.queued,
+        (unsigned long)slab.dropped,
+        (unsigned long)slab.highWater,
+        (unsigned)slab.slotCount
+    );
+    const Hc22000Stats &hc = hashExtractor.stats();
+    Serial.printf(
+        "[SNIFFER] 22000: %lu key frames, %lu PMKID, %lu pairs, %lu duplicates, %lu dedup resets\n",
+        (unsigned long)hc.keyFrames,
+        (unsigned long)hc.pmkids,
+        (unsigned long)hc.pairs,
+        (unsigned long)hc.duplicates,
+        (unsigned long)hc.dedupResets
+    );
+}
 
-        pcap_file.write(buf, incl_len);
+/* write packet to file */
+void newPacketSD(
+    uint32_t ts_sec, uint32_t ts_usec, uint32_t len, uint8_t *buf, File pcap_file, uint32_t orig_len
+) {
+    if (pcap_file) {
+        pcaprec_hdr_t header;
+        header.ts_sec = ts_sec;
+        header.ts_usec = ts_usec;
+        header.incl_len = len;
+        header.orig_len = orig_len < len ? len : orig_len;
+        pcap_file.write((uint8_t *)&header, sizeof(header));
+        pcap_file.write(buf, len);
     }
 }
 
@@ -783,9 +929,11 @@ bool writeHeader(File file) {
 }
 
 /* will be executed on every packet the ESP32 gets while being in promiscuous mode */
-// Sniffer callback
-void sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
-    if (!snifferQueue && !ensureSnifferBackend()) { return; }
+// Sniffer subscriber on the frame bus, the header is already parsed into `frame`
+static void snifferOnFrame(
+    const WifiFrameDesc &frame, const wifi_promiscuous_pkt_t *pkt, wifi_promiscuous_pkt_type_t type
+) {
+    if (!snifferWriterHandle && !ensureSnifferBackend()) { return; }
     // If using LittleFS to save .pcaps and storage is exhausted, stop promiscuous mode
     if (isLittleFS && !littleFsSpaceAvailable) {
         littleFsWasFull = true; // storage triggered exit
@@ -794,12 +942,11 @@ void sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
         return;
     }
 
-    wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
     wifi_pkt_rx_ctrl_t ctrl = pkt->rx_ctrl;
 
     packet_counter++;
 
-    FrameInfo frameInfo = analyzeFrame(pkt);
+    FrameInfo frameInfo = analyzeFrame(frame, analysisState, ch, (uint32_t)millis());
     if (!frameInfo.valid) { return; }
     if (frameInfo.isEapol) { num_EAPOL++; }
 
@@ -811,17 +958,33 @@ void sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
 
     if (!saveRaw && !saveHandshake && !saveDeauth) { return; }
 
-    wifi_promiscuous_pkt_t *copy = duplicatePacket(pkt, ctrl.sig_len);
-    if (!copy) { return; }
+    const uint16_t idx = snifferSlab.acquire();
+    if (idx == PacketSlab::INVALID_SLOT) { return; }
+    uint8_t *slot = snifferSlab.slot(idx);
+    const uint16_t maxPayload = snifferSlab.slotSize() - slotHeaderSize() - sizeof(wifi_pkt_rx_ctrl_t);
+    uint16_t copyLen = ctrl.sig_len;
+    if (copyLen > maxPayload) {
+        copyLen = maxPayload;
+        snifferSlab.noteOversize();
+    }
+
+    SnifferQueueItem &item = *new (slot) SnifferQueueItem();
+    auto *copy = reinterpret_cast<wifi_promiscuous_pkt_t *>(slot + slotHeaderSize());
+    memcpy(copy, pkt, sizeof(wifi_pkt_rx_ctrl_t));
+    memcpy(copy->payload, pkt->payload, copyLen);
+    copy->rx_ctrl.sig_len = copyLen;
     if (frameInfo.isBeacon && copy->rx_ctrl.sig_len >= 4) { copy->rx_ctrl.sig_len -= 4; }
 
-    SnifferQueueItem item;
     item.packet = copy;
     uint64_t pktTimestamp = copy->rx_ctrl.timestamp;
     item.ts_sec = pktTimestamp / 1000000ULL;
     item.ts_usec = pktTimestamp % 1000000ULL;
-    item.raw_len = ctrl.sig_len;
-    if (type == WIFI_PKT_MGMT && item.raw_len >= 4) { item.raw_len -= 4; }
+    item.raw_len = copyLen;
+    item.orig_len = ctrl.sig_len;
+    if (type == WIFI_PKT_MGMT && item.raw_len >= 4) {
+        item.raw_len -= 4;
+        item.orig_len -= 4;
+    }
     item.type = type;
     item.isBeacon = frameInfo.isBeacon;
     item.isHandshakeFrame = frameInfo.isEapol;
@@ -830,17 +993,26 @@ void sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
     item.saveHandshake = saveHandshake;
     item.saveDeauth = saveDeauth;
     copyMac(item.bssid, frameInfo.apAddr);
-    String ssidLabel = frameInfo.ssid.length() == 0 ? "UNKNOWN" : frameInfo.ssid;
-    copySsidToBuffer(ssidLabel, item.ssid, sizeof(item.ssid));
+    if (printableSsid(frameInfo.ssid, item.ssid, sizeof(item.ssid)) == 0) {
+        copySsidToBuffer("UNKNOWN", item.ssid, sizeof(item.ssid));
+    }
+    item.ssidKnown = !frameInfo.ssid.empty();
+    item.ssidRawLen = frameInfo.ssid.len;
+    memcpy(item.ssidRaw, frameInfo.ssid.text, frameInfo.ssid.len);
 
+    if (!snifferSlab.commit(idx)) { return; }
     BaseType_t taskWoken = pdFALSE;
-    if (xQueueSendFromISR(snifferQueue, &item, &taskWoken) != pdTRUE) {
-        releasePacketCopy(copy);
-    } else if (taskWoken) {
-        portYIELD_FROM_ISR();
-    }
+    vTaskNotifyGiveFromISR(snifferWriterHandle, &taskWoken);
+    if (taskWoken) { portYIELD_FROM_ISR(); }
 }
 
+void sniffer_attach() {
+    frame_bus_subscribe(snifferOnFrame, WIFI_FRAME_ALL);
+    frame_bus_attach();
+}
+
+void sniffer_detach() { frame_bus_unsubscribe(snifferOnFrame); }
+
 // esp_err_t event_handler(void *ctx, system_event_t *event){ return ESP_OK; }
 void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT) {
@@ -863,14 +1035,15 @@ void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, voi
 void openFile(FS &Fs) {
     ensureDirectories(Fs);
     closeRawFile();
-    filename = "/BrucePCAP/" + (String)FILENAME + String(rawFileIndex) + ".pcap";
+    filename = "/BrucePCAP/" + (String)FILENAME + String(rawFileIndex) + ".pcapng";
     while (Fs.exists(filename)) {
         rawFileIndex++;
-        filename = "/BrucePCAP/" + (String)FILENAME + String(rawFileIndex) + ".pcap";
+        filename = "/BrucePCAP/" + (String)FILENAME + String(rawFileIndex) + ".pcapng";
     }
     if (lockFileMutex(pdMS_TO_TICKS(200))) {
         _pcap_file = Fs.open(filename, FILE_WRITE);
-        rawFileOpen = _pcap_file && writeHeader(_pcap_file);
+        rawSink.setRotation(RAW_ROTATE_BYTES, RAW_ROTATE_MS);
+        rawFileOpen = _pcap_file && rawSink.attach(_pcap_file, millis(), PCAPNG_APPLICATION);
         unlockFileMutex();
         if (!rawFileOpen) { Serial.println("Fail opening the file"); }
     }
@@ -879,55 +1052,37 @@ void openFile(FS &Fs) {
 // --- New helper implementations ---
 
 static void cleanupStaleBeacons() {
-    unsigned long now = millis();
-    std::vector<BeaconList> toRemove;
-    for (auto it = registeredBeacons.begin(); it != registeredBeacons.end(); ++it) {
-        uint64_t key = macToKey(it->MAC);
-        auto lastIt = beaconLastSeen.find(key);
-        if (lastIt == beaconLastSeen.end() || (now - (unsigned long)lastIt->second) > BEACON_TIMEOUT_MS) {
-            toRemove.push_back(*it);
-        }
-    }
-    for (const auto &b : toRemove) {
-        // erase by matching MAC bytes
-        for (auto it = registeredBeacons.begin(); it != registeredBeacons.end();) {
-            if (memcmp(it->MAC, b.MAC, 6) == 0) {
-                it = registeredBeacons.erase(it);
-            } else {
-                ++it;
-            }
-        }
-        uint64_t key = macToKey(b.MAC);
-        beaconSsidCache.erase(key);
-        beaconLastSeen.erase(key);
-    }
+    const uint32_t now = millis();
+    auto isStale = [now](const BeaconInfo &entry) { return (now - entry.lastSeen) > BEACON_TIMEOUT_MS; };
+    // one pass over each table: drop deauth targets whose AP went quiet, then the AP records
+    registeredBeacons.eraseIf([&](const BeaconList &b) {
+        const BeaconInfo *entry = beaconInfo.find(macKey(b.MAC));
+        return !entry || isStale(*entry);
+    });
+    beaconInfo.eraseIf([&](uint64_t, BeaconInfo &entry) { return isStale(entry); });
 }
 
 static size_t countActiveBeaconsOnChannel(uint8_t channel) {
-    unsigned long now = millis();
+    const uint32_t now = millis();
     size_t cnt = 0;
-    for (const auto &b : registeredBeacons) {
+    for (const BeaconList b : registeredBeacons) {
         if (b.channel != channel) continue;
-        uint64_t key = macToKey(b.MAC);
-        auto it = beaconLastSeen.find(key);
-        if (it != beaconLastSeen.end() && (now - (unsigned long)it->second) <= BEACON_TIMEOUT_MS) { ++cnt; }
+        const BeaconInfo *entry = beaconInfo.find(macKey(b.MAC));
+        if (entry && (now - entry->lastSeen) <= BEACON_TIMEOUT_MS) { ++cnt; }
     }
     return cnt;
 }
 
 static std::vector<String> recentSsidsOnChannel(uint8_t channel, size_t maxItems) {
     std::vector<String> out;
-    unsigned long now = millis();
-    for (const auto &b : registeredBeacons) {
+    const uint32_t now = millis();
+    for (const BeaconList b : registeredBeacons) {
         if (b.channel != channel) continue;
-        uint64_t key = macToKey(b.MAC);
-        auto lastIt = beaconLastSeen.find(key);
-        if (lastIt == beaconLastSeen.end() || (now - (unsigned long)lastIt->second) > BEACON_TIMEOUT_MS)
-            continue;
-        auto ssidIt = beaconSsidCache.find(key);
-        if (ssidIt == beaconSsidCache.end()) continue;
-        String ss = ssidIt->second;
-        if (ss.length() == 0) continue;
+        const BeaconInfo *entry = beaconInfo.find(macKey(b.MAC));
+        if (!entry || (now - entry->lastSeen) > BEACON_TIMEOUT_MS) continue;
+        char label[MAX_CAPTURE_SSID_LEN + 1];
+        if (printableSsid(entry->ssid, label, sizeof(label)) == 0) continue;
+        String ss = label;
         bool dup = false;
         for (auto &x : out)
             if (x == ss) {
@@ -980,8 +1135,7 @@ void sniffer_setup() {
 
     sniffer_reset_handshake_cache(); // Need to clear to restart HS count
     registeredBeacons.clear();
-    beaconSsidCache.clear();
-    beaconLastSeen.clear(); // ensure starts empty
+    beaconInfo.clear(); // ensure starts empty
 
     /* setup wifi */
     ensureWifiPlatform();
@@ -1005,7 +1159,9 @@ void sniffer_setup() {
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
     esp_wifi_set_promiscuous(true);
-    esp_wifi_set_promiscuous_rx_cb(sniffer);
+    frame_bus_reset_stats();
+    analysisStats = SnifferAnalysisStats();
+    sniffer_attach();
     wifi_second_chan_t secondCh = (wifi_second_chan_t)NULL;
     esp_wifi_set_channel(all_wifi_channels[ch], secondCh);
 
@@ -1056,7 +1212,7 @@ void sniffer_setup() {
             redraw = true;
             vTaskDelay(50 / portTICK_RATE_MS);
             esp_wifi_set_promiscuous(true);
-            esp_wifi_set_promiscuous_rx_cb(sniffer);
+            frame_bus_attach();
         }
 
         if (PrevPress) {
@@ -1079,7 +1235,7 @@ void sniffer_setup() {
             }
             if (millis() - _tmp > 700) { // longpress detected to exit
                 returnToMenu = true;
-                _pcap_file.close();
+                closeRawFile();
                 break;
             }
 #endif
@@ -1094,14 +1250,14 @@ void sniffer_setup() {
             redraw = true;
             vTaskDelay(50 / portTICK_PERIOD_MS);
             esp_wifi_set_promiscuous(true);
-            esp_wifi_set_promiscuous_rx_cb(sniffer);
+            frame_bus_attach();
         }
 
 #if defined(HAS_KEYBOARD) || defined(T_EMBED)
         // T-Embed has a different btn for Escape, different from StickCs that uses Previous btn
         if (check(EscPress)) {
             returnToMenu = true;
-            _pcap_file.close();
+            closeRawFile();
             break;
         }
 #endif
@@ -1144,8 +1300,9 @@ void sniffer_setup() {
                      num_HS = 0;
                      start_time = millis();
                      beacon_frames = 0;
+                     analysisStats = SnifferAnalysisStats();
                      registeredBeacons.clear();
-                     beaconSsidCache.clear();
+                     beaconInfo.clear();
                      sniffer_reset_handshake_cache();
                      deauth_tmp = millis();
                  }                                                                                        },
@@ -1212,6 +1369,13 @@ void sniffer_setup() {
                 padprintln(s);
             }
 
+            // capture slab health: drops and deepest backlog seen by the writer task
+            PacketSlabStats slabStats = sniffer_get_pool_stats();
+            padprintln(
+                "Drops " + String(slabStats.dropped) + " (no slot " + String(slabStats.slotExhausted) +
+                ") peak " + String(slabStats.highWater) + "/" + String(slabStats.slotCount)
+            );
+
             // make a nice reverse video bar
             tft.setTextColor(bruceConfig.bgColor, bruceConfig.priColor);
             tft.drawRightString(
@@ -1234,12 +1398,8 @@ void sniffer_setup() {
 
         if (currentTime - lastTime > 100) tft.drawPixel(0, 0, 0);
 
-        if ((rawCaptureEnabled() || deauthCaptureEnabled()) && currentTime - lastTime > 1000) {
-            if (lockFileMutex(pdMS_TO_TICKS(50))) {
-                if (rawCaptureEnabled()) { _pcap_file.flush(); }
-                if (deauthCaptureEnabled()) { _deauth_file.flush(); }
-                unlockFileMutex();
-            }
+        if (currentTime - lastTime > 1000) {
+            flushCaptureSinks(currentTime, true);
             lastTime = currentTime; // update time
         }
 
@@ -1293,15 +1453,15 @@ Exit:
     esp_wifi_set_promiscuous(false);
     esp_wifi_stop();
     esp_wifi_set_promiscuous_rx_cb(NULL);
+    sniffer_detach();
     esp_wifi_deinit();
-    sniffer_wait_for_flush(1000);
-    closeRawFile();
-    closeDeauthFile();
+    logSnifferStats();
+    sniffer_release_backend();
     wifiDisconnect();
     vTaskDelay(1 / portTICK_RATE_MS);
 }
 
 void setHandshakeSniffer() {
     esp_wifi_set_promiscuous_rx_cb(NULL);
-    esp_wifi_set_promiscuous_rx_cb(sniffer);
+    sniffer_attach();
 }
@@ -3,19 +3,13 @@
 #include <FS.h>
 #include <SD.h>
 #include <WiFi.h>
-#include <set>
 
-struct HandshakeTracker {
-    bool msg1 = false;
-    bool msg2 = false;
-    bool msg3 = false;
-    bool msg4 = false;
-};
+#include "modules/wifi/mac_table.h"
+#include "modules/wifi/packet_slab.h"
+#include "modules/wifi/sniffer_analysis.h"
 
 extern HandshakeTracker hsTracker;
 
-bool handshakeUsable(const HandshakeTracker &hs);
-
 // List of channels to hop through
 // priority channels are used more often
 #ifdef CONFIG_IDF_TARGET_ESP32C5
@@ -27,19 +21,6 @@ const uint8_t pri_wifi_channels[] = {1, 6, 11, 36, 40, 44, 48, 149, 153, 157, 16
 const uint8_t all_wifi_channels[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
 const uint8_t pri_wifi_channels[] = {1, 6, 11};
 #endif
-struct BeaconList {
-    char MAC[6];
-    uint8_t channel;
-    // Define comparison operator to use <set>
-    bool operator<(const BeaconList &other) const {
-        // Compare MACs (using memcmp)
-        int cmp = memcmp(MAC, other.MAC, sizeof(MAC));
-        if (cmp != 0) {
-            return cmp < 0; // if MACs are diferent, compares lexicografically
-        }
-        return channel < other.channel; // If MACs are equal, compare by channel
-    }
-};
 
 enum class SnifferMode : uint8_t {
     Full,
@@ -60,11 +41,19 @@ bool sniffer_prepare_storage(FS *fs, bool sdDetected);
 void sniffer_wait_for_flush(uint32_t timeoutMs = 2000);
 void sniffer_reset_handshake_cache();
 void markHandshakeReady(uint64_t key);
+PacketSlabStats sniffer_get_pool_stats();
+
+SnifferAnalysisStats sniffer_get_analysis_stats();
+
+extern BeaconTable registeredBeacons;
 
-extern std::set<BeaconList> registeredBeacons;
-extern std::set<String> SavedHS;
+// Handshake files known in this session, keyed by AP MAC + sanitized SSID label
+void sniffer_register_handshake(const uint8_t *bssid, const char *ssidLabel);
 
-void newPacketSD(uint32_t ts_sec, uint32_t ts_usec, uint32_t len, uint8_t *buf, File pcap_file);
+// orig_len is the on-air length when the stored copy was truncated, 0 means same as len
+void newPacketSD(
+    uint32_t ts_sec, uint32_t ts_usec, uint32_t len, uint8_t *buf, File pcap_file, uint32_t orig_len = 0
+);
 
 void openFile(FS &Fs);
 
@@ -72,4 +61,9 @@ bool writeHeader(File file);
 
 void sniffer_setup();
 
-void sniffer(void *buf, wifi_promiscuous_pkt_type_t type);
+// Subscribes the sniffer to the frame bus and installs the bus as promiscuous callback
+void sniffer_attach();
+void sniffer_detach();
+// Stops the writer task and frees the slab and the write buffers once nothing feeds the slab,
+// the next sniffer_prepare_storage() or sniffer_attach() allocates them again
+void sniffer_release_backend();
@@ -0,0 +1,203 @@
+#ifndef __SNIFFER_ANALYSIS_H__
+#define __SNIFFER_ANALYSIS_H__
+// Per-frame analysis of the sniffer callback: EAPOL message classification, the handshake
+// tracker and the beacon tables SSIDs are resolved from. It only touches preallocated tables.
+// Plain C++, so test/bench_sniffer_replay.cpp can replay pcap files through the same code.
+#include "frame_parser.h"
+#include "hc22000.h"
+#include "mac_table.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct HandshakeTracker {
+    bool msg1 = false;
+    bool msg2 = false;
+    bool msg3 = false;
+    bool msg4 = false;
+};
+
+inline bool handshakeUsable(const HandshakeTracker &hs) { // EAPOL Messages needed: 1+2 or 3+4
+    return (hs.msg1 && hs.msg2) || (hs.msg3 && hs.msg4);
+}
+
+struct BeaconList {
+    char MAC[6];
+    uint8_t channel;
+};
+
+// Beacons seen per (BSSID, channel), the deauth target list.
+// Backed by a MacTable keyed by MAC << 8 | channel, so inserts from the WiFi callback don't allocate.
+class BeaconTable {
+public:
+    static uint64_t keyOf(const BeaconList &b) { return (macKey(b.MAC) << 8) | b.channel; }
+    static BeaconList fromKey(uint64_t key) {
+        BeaconList b;
+        b.channel = key & 0xFF;
+        macFromKey(key >> 8, (uint8_t *)b.MAC);
+        return b;
+    }
+
+    bool init(size_t slots) { return table_.init(slots); }
+    void release() { table_.release(); }
+    bool insert(const BeaconList &b) { return table_.insert(keyOf(b)) != nullptr; }
+    bool contains(const BeaconList &b) const { return table_.contains(keyOf(b)); }
+    size_t size() const { return table_.size(); }
+    void clear() { table_.clear(); }
+    size_t memoryBytes() const { return table_.memoryBytes(); }
+    // pred(const BeaconList &)
+    template <typename Pred> size_t eraseIf(Pred pred) {
+        return table_.eraseIf([&](uint64_t key, MacTableEmpty &) { return pred(fromKey(key)); });
+    }
+
+    class const_iterator {
+    public:
+        explicit const_iterator(MacSet::const_iterator it) : it_(it) {}
+        BeaconList operator*() const { return fromKey(it_.key()); }
+        const_iterator &operator++() {
+            ++it_;
+            return *this;
+        }
+        bool operator!=(const const_iterator &other) const { return it_ != other.it_; }
+
+    private:
+        MacSet::const_iterator it_;
+    };
+    const_iterator begin() const { return const_iterator(table_.begin()); }
+    const_iterator end() const { return const_iterator(table_.end()); }
+
+private:
+    MacSet table_;
+};
+
+// Counters kept by the frame analysis in the WiFi callback
+struct SnifferAnalysisStats {
+    uint32_t ssidLookups = 0;     // non-beacon frames resolved against the beacon SSID table
+    uint32_t ssidHits = 0;
+    uint32_t beaconsTracked = 0;  // new APs added to the SSID table
+    uint32_t beaconTableFull = 0; // beacons not tracked because the table was full
+};
+
+// Beacon SSID and last-seen time, key = macKey(apAddr)
+struct BeaconInfo {
+    FixedSsid ssid;        // raw ESSID bytes
+    uint32_t lastSeen = 0; // millis()
+};
+
+struct FrameInfo {
+    bool valid = false;
+    bool isBeacon = false;
+    bool isDeauth = false;
+    bool isEapol = false;
+    int eapolMsgNum = -1;
+    uint8_t apAddr[6] = {0};
+    uint64_t apKey = 0;
+    FixedSsid ssid; // raw ESSID bytes
+};
+
+// Tables and counters the analysis updates. The sniffer points them at its globals, the replay
+// harness at its own.
+struct SnifferAnalysisState {
+    BeaconTable *beacons;
+    MacTable<BeaconInfo> *beaconInfo;
+    SnifferAnalysisStats *stats;
+    HandshakeTracker *tracker;
+    const uint8_t *targetBssid; // EAPOL frames from or to this AP feed the tracker
+    uint32_t *beaconFrames;
+};
+
+// Analyze the EAPOL Message Number
+inline int classifyEapolMessage(const WifiFrameDesc &frame) {
+    if (!frame.eapolOffset) return -1;
+    // Key Information field: EAPOL header (4) + Descriptor Type (1)
+    const uint16_t keyInfoOffset = frame.eapolOffset + 4 + 1;
+
+    if (frame.len < keyInfoOffset + 2) return -1; // safety check
+
+    uint16_t keyInfo = (frame.frame[keyInfoOffset] << 8) | frame.frame[keyInfoOffset + 1];
+    return eapolKeyMessageNumber(keyInfo);
+}
+
+inline bool matchesTargetAP(const WifiFrameDesc &frame, const uint8_t targetBssid[6]) {
+    if (!frame.addr3) return false;
+    return memcmp(frame.addr1, targetBssid, 6) == 0 || memcmp(frame.addr2, targetBssid, 6) == 0 ||
+           memcmp(frame.addr3, targetBssid, 6) == 0;
+}
+
+// Keeps the bytes as broadcast, hashcat needs the exact ESSID. A zero-filled SSID is a hidden one.
+inline void extractSsid(const WifiFrameDesc &frame, FixedSsid &out) {
+    out.set(nullptr, 0);
+    if (!frame.ssidOffset) return;
+    const char *ssid = (const char *)frame.frame + frame.ssidOffset;
+    for (int i = 0; i < frame.ssidLen; ++i) {
+        if (ssid[i] != '\0') {
+            out.set(ssid, frame.ssidLen);
+            return;
+        }
+    }
+}
+
+// Beacons refresh the SSID table, every other frame looks its AP up in it
+inline void
+resolveSsidForFrame(FrameInfo &info, const WifiFrameDesc &frame, SnifferAnalysisState &st, uint32_t nowMs) {
+    if (info.isBeacon) {
+        (*st.beaconFrames)++;
+        extractSsid(frame, info.ssid);
+        bool created = false;
+        BeaconInfo *entry = st.beaconInfo->insert(info.apKey, &created);
+        if (entry) {
+            if (created) { st.stats->beaconsTracked++; }
+            entry->ssid = info.ssid;
+            entry->lastSeen = nowMs; // last-seen timestamp for the stale sweep
+        } else {
+            st.stats->beaconTableFull++;
+        }
+        return;
+    }
+    st.stats->ssidLookups++;
+    const BeaconInfo *entry = st.beaconInfo->find(info.apKey);
+    if (entry) {
+        st.stats->ssidHits++;
+        info.ssid = entry->ssid;
+    }
+}
+
+// channel is the one the radio is tuned to, it goes into the beacon table
+inline FrameInfo
+analyzeFrame(const WifiFrameDesc &frame, SnifferAnalysisState &st, uint8_t channel, uint32_t nowMs) {
+    FrameInfo info;
+    if (frame.len < 24) { return info; }
+
+    info.valid = true;
+    if (!frame.apAddr) { return info; } // control frame, nothing to track
+    memcpy(info.apAddr, frame.apAddr, 6);
+    info.apKey = macKey(info.apAddr);
+
+    info.isBeacon = frame.is(WIFI_FRAME_BEACON);
+    info.isDeauth = frame.is(WIFI_FRAME_DEAUTH);
+    info.isEapol = frame.is(WIFI_FRAME_EAPOL);
+
+    if (info.isEapol && st.targetBssid && matchesTargetAP(frame, st.targetBssid)) {
+        int msg = classifyEapolMessage(frame);
+        info.eapolMsgNum = msg;
+        // Update handshake tracker
+        switch (msg) {
+            case 1: st.tracker->msg1 = true; break;
+            case 2: st.tracker->msg2 = true; break;
+            case 3: st.tracker->msg3 = true; break;
+            case 4: st.tracker->msg4 = true; break;
+        }
+    }
+
+    resolveSsidForFrame(info, frame, st, nowMs);
+    if (info.isBeacon) {
+        BeaconList beacon;
+        memcpy(beacon.MAC, info.apAddr, sizeof(beacon.MAC));
+        beacon.channel = channel;
+        st.beacons->insert(beacon);
+    }
+
+    return info;
+}
+
+#endif
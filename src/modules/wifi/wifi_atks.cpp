@@ -475,15 +475,14 @@ void capture_handshake(String tssid, String mac, uint8_t channel) {
         hsExists = LittleFS.exists(hsFileName);
     }
 
-    // Register the file path so the sniffer knows to save the capture to it
-    String hsFilePath = String(hsFileName);
+    // Register the file so the sniffer knows to save the capture to it
     if (!hsExists) {
         File hsFile = fs->open(hsFileName, FILE_WRITE);
         if (hsFile) {
             writeHeader(hsFile);
             hsFile.close();
-            // Register using the file path
-            SavedHS.insert(hsFilePath);
+            // Register the file so the sniffer appends to it
+            sniffer_register_handshake(bssid_array, sanitizedSsid.c_str());
             // Mark as ready to capture
             uint64_t apKey = 0;
             for (int i = 0; i < 6; ++i) { apKey = (apKey << 8) | bssid_array[i]; }
@@ -495,13 +494,13 @@ void capture_handshake(String tssid, String mac, uint8_t channel) {
                 if (i < 5) Serial.print(":");
             }
             Serial.println();
-            Serial.println("Added to SavedHS set for beacon capture");
+            Serial.println("Registered with the sniffer for beacon capture");
         } else {
             Serial.println("Failed to create handshake file");
         }
     } else {
-        // File already exists: Add to SavedHS and mark as captured
-        SavedHS.insert(hsFilePath);
+        // File already exists: register it and mark as captured
+        sniffer_register_handshake(bssid_array, sanitizedSsid.c_str());
         uint64_t apKey = 0;
         for (int i = 0; i < 6; ++i) { apKey = (apKey << 8) | bssid_array[i]; }
         markHandshakeReady(apKey);
@@ -519,7 +518,7 @@ void capture_handshake(String tssid, String mac, uint8_t channel) {
 
     ch = channel;
     esp_wifi_set_promiscuous(true);
-    esp_wifi_set_promiscuous_rx_cb(sniffer);
+    sniffer_attach();
     wifi_second_chan_t secondCh = (wifi_second_chan_t)NULL;
     esp_wifi_set_channel(channel, secondCh);
 
@@ -542,7 +541,7 @@ void capture_handshake(String tssid, String mac, uint8_t channel) {
         BeaconList targetBeacon;
         memcpy(targetBeacon.MAC, bssid_array, 6);
         targetBeacon.channel = channel;
-        if (registeredBeacons.find(targetBeacon) != registeredBeacons.end()) { hasBeacons = true; }
+        if (registeredBeacons.contains(targetBeacon)) { hasBeacons = true; }
 
         // Redraw whenever new EAPOL Frame arrives
         if (num_EAPOL > prevNumEAPOL) {
@@ -630,6 +629,8 @@ void capture_handshake(String tssid, String mac, uint8_t channel) {
 
     esp_wifi_set_promiscuous(false);
     esp_wifi_set_promiscuous_rx_cb(NULL);
+    sniffer_detach();
+    sniffer_release_backend();
     wifi_atk_unsetWifi();
     returnToMenu = true;
 }
@@ -2,11 +2,19 @@
 /*
   WiFi Password Cracker for Bruce (ESP32-S3 / T-Embed)
   - Reads passwords from wordlist file
-  - Tests against PCAP handshake using PBKDF2 + PMK verification
+  - Tests against PCAP handshakes or 22000 hashes using PBKDF2 + PMK verification
+  - Captures of the same SSID share one PMK per candidate
   - Single unified workflow
 */
 
 #include "wifi_recover.h"
+#include "packet_slab.h"
+#include "wpa_candidates.h"
+#include "wpa_checkpoint.h"
+#include "wpa_crypto.h"
+#include "wpa_rules.h"
+#include "wpa_sha1_backend.h"
+#include "wpa_targets.h"
 
 // Bruce core includes
 #include "core/display.h"
@@ -23,9 +31,11 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "esp_heap_caps.h"
 #include "esp_rom_crc.h"
-#include "mbedtls/md.h"
 
+#include <atomic>
+#include <new>
 #include <string.h>
 #include <string>
 
@@ -327,202 +337,259 @@ static bool parse_pcap_handshake(FS &fs, const String &path, HandshakeData &hs)
     return true;
 }
 
-/* ----------------- PBKDF2 Implementation ----------------- */
+/* ----------------- Targets ----------------- */
 /*
- * PBKDF2 now polls for user input on each iteration so the user can abort
- * during the heavy work. Returns:
- *  0 = ok
- * -1/-2/-3 = error (as before)
- * -4 = aborted by user
+ * A run can take a single capture, every capture in its folder, or a hashcat 22000 file.
+ * All of them end up in one WpaTargetSet, grouped by SSID.
  */
-static int pbkdf2_hmac_sha1(
-    const unsigned char *password, size_t plen, const unsigned char *salt, size_t slen,
-    unsigned int iterations, size_t dklen, unsigned char *output
-) {
-    if (!password || !salt || !output || iterations == 0) return -1;
-
-    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
-    if (!md_info) return -2;
+static const char *RECOVERED_FILE = "/BrucePCAP/recovered.txt";
+
+static bool add_handshake(WpaTargetSet &targets, const HandshakeData &hs) {
+    return targets.addEapol(
+        hs.ap_mac,
+        hs.sta_mac,
+        hs.anonce,
+        hs.snonce,
+        hs.eapol,
+        hs.eapol_len,
+        hs.mic,
+        hs.ssid,
+        strlen(hs.ssid)
+    );
+}
 
-    mbedtls_md_context_t ctx;
-    mbedtls_md_init(&ctx);
-    if (mbedtls_md_setup(&ctx, md_info, 1) != 0) {
-        mbedtls_md_free(&ctx);
-        return -3;
+static uint8_t load_hc22000(FS &fs, const String &path, WpaTargetSet &targets) {
+    File f = fs.open(path, FILE_READ);
+    if (!f) return 0;
+    uint8_t added = 0;
+    while (f.available() && targets.count() < WPA_MAX_TARGETS) {
+        String line = f.readStringUntil('\n');
+        line.trim();
+        if (targets.addHc22000Line(line.c_str())) added++;
     }
+    f.close();
+    return added;
+}
 
-    const size_t hlen = 20;
-    size_t l = (dklen + hlen - 1) / hlen;
-    unsigned char U[20], T[20], int_block[4];
-
-    for (size_t block = 1; block <= l; ++block) {
-        // Abort check
-        if (g_abortRequested) {
-            mbedtls_md_free(&ctx);
-            return -4;
-        }
-
-        int_block[0] = (block >> 24) & 0xff;
-        int_block[1] = (block >> 16) & 0xff;
-        int_block[2] = (block >> 8) & 0xff;
-        int_block[3] = block & 0xff;
-
-        mbedtls_md_hmac_starts(&ctx, password, plen);
-        mbedtls_md_hmac_update(&ctx, salt, slen);
-        mbedtls_md_hmac_update(&ctx, int_block, 4);
-        mbedtls_md_hmac_finish(&ctx, U);
-
-        memcpy(T, U, hlen);
-
-        for (unsigned int iter = 1; iter < iterations; ++iter) {
-            // Poll user in inner PBKDF2 loop too
-            if (g_abortRequested) {
-                mbedtls_md_free(&ctx);
-                return -4;
-            }
-
-            mbedtls_md_hmac_reset(&ctx);
-            mbedtls_md_hmac_update(&ctx, U, hlen);
-            mbedtls_md_hmac_finish(&ctx, U);
-            for (size_t k = 0; k < hlen; ++k) T[k] ^= U[k];
-
-            // Yield briefly so other tasks (input) can run
-            if ((iter & 0x1FF) == 0) vTaskDelay(pdMS_TO_TICKS(1));
+// Every pcap/cap in the folder of `path`; captures without an SSID are skipped
+static uint8_t load_pcap_folder(FS &fs, const String &path, WpaTargetSet &targets) {
+    const String folder = path.substring(0, path.lastIndexOf('/'));
+    File dir = fs.open(folder.length() ? folder : "/");
+    if (!dir || !dir.isDirectory()) return 0;
+    uint8_t added = 0;
+    bool isDir;
+    String name = dir.getNextFileName(&isDir);
+    while (name != "" && targets.count() < WPA_MAX_TARGETS) {
+        String lower = name;
+        lower.toLowerCase();
+        if (!isDir && (lower.endsWith(".pcap") || lower.endsWith(".cap"))) {
+            HandshakeData hs;
+            if (parse_pcap_handshake(fs, name, hs) && hs.ssid[0] && add_handshake(targets, hs)) added++;
         }
-
-        size_t offset = (block - 1) * hlen;
-        size_t to_copy = (offset + hlen > dklen) ? (dklen - offset) : hlen;
-        memcpy(output + offset, T, to_copy);
+        name = dir.getNextFileName(&isDir);
     }
+    dir.close();
+    return added;
+}
 
-    mbedtls_md_free(&ctx);
-    return 0;
+static void save_recovered(FS &fs, const WpaTarget &t) {
+    File f = fs.open(RECOVERED_FILE, fs.exists(RECOVERED_FILE) ? FILE_APPEND : FILE_WRITE);
+    if (!f) return;
+    f.printf(
+        "%s %02X:%02X:%02X:%02X:%02X:%02X %s\n",
+        t.ssid,
+        t.ap[0],
+        t.ap[1],
+        t.ap[2],
+        t.ap[3],
+        t.ap[4],
+        t.ap[5],
+        t.password
+    );
+    f.close();
 }
 
-/* ----------------- PTK Derivation (PRF-512) ----------------- */
+/* ----------------- Worker pool ----------------- */
 /*
- * derive_ptk now returns 'false' if the user aborted during the small loop.
+ * One worker per core tests candidates in batches. The UI task reads the wordlist into free
+ * batches and pushes their index to the least loaded worker; workers push indices back when done.
+ * Both directions are SPSC rings, so nothing blocks on a lock while PBKDF2 runs.
  */
-static bool derive_ptk(
-    const uint8_t *pmk, const uint8_t *ap_mac, const uint8_t *sta_mac, const uint8_t *anonce,
-    const uint8_t *snonce, uint8_t *ptk_out
-) {
-    uint8_t data[100];
-    size_t pos = 0;
-
-    // MAC ordering (min first)
-    if (memcmp(ap_mac, sta_mac, 6) < 0) {
-        memcpy(data + pos, ap_mac, 6);
-        pos += 6;
-        memcpy(data + pos, sta_mac, 6);
-        pos += 6;
-    } else {
-        memcpy(data + pos, sta_mac, 6);
-        pos += 6;
-        memcpy(data + pos, ap_mac, 6);
-        pos += 6;
-    }
-
-    // Nonce ordering (min first)
-    if (memcmp(anonce, snonce, 32) < 0) {
-        memcpy(data + pos, anonce, 32);
-        pos += 32;
-        memcpy(data + pos, snonce, 32);
-        pos += 32;
-    } else {
-        memcpy(data + pos, snonce, 32);
-        pos += 32;
-        memcpy(data + pos, anonce, 32);
-        pos += 32;
-    }
+#define RECOVER_WORKERS portNUM_PROCESSORS
+static const uint8_t RECOVER_BATCHES_PER_WORKER = 3;
+static const uint32_t RECOVER_UI_INTERVAL_MS = 500;
+static const uint32_t RECOVER_WORKER_STACK = 4096;
+
+struct RecoverWorker {
+    TaskHandle_t task;
+    SpscRing<uint8_t, 4> todo; // UI task -> worker
+    SpscRing<uint8_t, 4> done; // worker -> UI task
+    const Sha1Backend *sha1;
+    volatile bool running;
+};
 
-    // WPA2 uses PRF-512 to generate 64 bytes of PTK
-    const char *label = "Pairwise key expansion";
+static RecoverWorker g_workers[RECOVER_WORKERS];
+static CandidateBatch *g_batches = nullptr;
+static WpaTargetSet *g_targets = nullptr;
+static const WpaRuleSet *g_rules = nullptr; // nullptr tests the wordlist as is
+static std::atomic<uint32_t> g_tested{0};
+static volatile bool g_stopWorkers = false; // everything cracked, abort, or end of wordlist
+
+// Tests one candidate against every target, false when the run is stopping
+static bool test_candidate(const RecoverWorker &w, const char *word, uint8_t len, uint32_t &tested) {
+    if (g_stopWorkers) return false;
+    // Inputs are pre-validated, so a failure means the run is stopping
+    if (g_targets->test(word, len, &g_stopWorkers, *w.sha1) < 0) return false;
+    tested++;
+    g_tested.fetch_add(1, std::memory_order_relaxed);
+    if (g_targets->allCracked()) g_stopWorkers = true;
+    return true;
+}
 
-    mbedtls_md_context_t ctx;
-    mbedtls_md_init(&ctx);
-    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
-    mbedtls_md_setup(&ctx, md, 1);
+static void recover_worker_task(void *arg) {
+    RecoverWorker &w = *(RecoverWorker *)arg;
+    char candidate[WPA_PASSPHRASE_MAX + 1];
+    uint8_t candidateLen;
+    uint8_t idx;
 
-    // Generate PTK in 20-byte blocks (SHA1 output size)
-    for (int i = 0; i < 4; i++) { // 4 iterations for 64 bytes
-        // Abort check
-        if (g_abortRequested) {
-            mbedtls_md_free(&ctx);
-            return false;
+    while (!g_stopWorkers) {
+        if (!w.todo.pop(idx)) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+            continue;
         }
+        CandidateBatch &batch = g_batches[idx];
+        batch.tested = 0;
+        bool complete = true;
+        for (uint8_t i = 0; i < batch.count && complete; ++i) {
+            if (!g_rules) {
+                complete = test_candidate(w, batch.words[i], batch.lens[i], batch.tested);
+                continue;
+            }
+            // Rules expand the base word in RAM, so one SD line feeds many PBKDF2 runs
+            for (size_t r = 0; r < g_rules->count() && complete; ++r) {
+                if (!applyWpaRule(g_rules->rule(r), batch.words[i], batch.lens[i], candidate, candidateLen)) {
+                    continue;
+                }
+                complete = test_candidate(w, candidate, candidateLen, batch.tested);
+            }
+        }
+        batch.complete = complete;
+        // The UI task drains done every few ms, a full ring only has to wait for it. Once the run
+        // stops nothing drains it any more: the batch then stays in flight and the checkpoint
+        // keeps its words for the next run.
+        while (!w.done.push(idx) && !g_stopWorkers) vTaskDelay(1);
+        // A batch is roughly a second of PBKDF2 per SSID, let the idle task on this core run
+        vTaskDelay(1);
+    }
 
-        uint8_t counter = (uint8_t)i;
-
-        mbedtls_md_hmac_starts(&ctx, pmk, 32);
-        mbedtls_md_hmac_update(&ctx, (const uint8_t *)label, strlen(label));
-        mbedtls_md_hmac_update(&ctx, (const uint8_t *)"\0", 1); // null terminator
-        mbedtls_md_hmac_update(&ctx, data, pos);
-        mbedtls_md_hmac_update(&ctx, &counter, 1);
-
-        uint8_t hash[20];
-        mbedtls_md_hmac_finish(&ctx, hash);
-
-        size_t copy_len = (i == 3) ? 4 : 20; // Last block only 4 bytes (64 total)
-        memcpy(ptk_out + (i * 20), hash, copy_len);
+    w.running = false;
+    vTaskDelete(nullptr);
+}
 
-        mbedtls_md_hmac_reset(&ctx);
-        // give up CPU briefly to keep UI/input responsive
-        taskYIELD();
+// The first worker gets the fastest SHA1 backend even if it cannot be shared (the SHA
+// peripheral), the others the fastest one they can all run at once
+static bool start_workers(const Sha1Selection &sha1) {
+    g_stopWorkers = false;
+    g_tested.store(0, std::memory_order_relaxed);
+    for (int core = 0; core < RECOVER_WORKERS; ++core) {
+        RecoverWorker &w = g_workers[core];
+        w.todo.reset();
+        w.done.reset();
+        w.sha1 = core == 0 ? sha1.exclusive : sha1.shared;
+        w.running = true;
+        if (xTaskCreatePinnedToCore(
+                recover_worker_task, "wpa_worker", RECOVER_WORKER_STACK, &w, 1, &w.task, core
+            ) != pdPASS) {
+            w.running = false;
+            return false;
+        }
     }
-
-    mbedtls_md_free(&ctx);
     return true;
 }
 
-/* ----------------- MIC Verification ----------------- */
-static bool verify_mic(const HandshakeData &hs, const uint8_t *ptk) {
-    const uint8_t *kck = ptk; // KCK is first 16 bytes of PTK
+static void stop_workers() {
+    g_stopWorkers = true;
+    for (auto &w : g_workers) {
+        while (w.running) {
+            if (w.task) xTaskNotifyGive(w.task);
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        w.task = nullptr;
+    }
+}
 
-    uint8_t eapol_copy[256];
-    memcpy(eapol_copy, hs.eapol, hs.eapol_len);
+// Least loaded worker that still has room in its ring, nullptr when all are full
+static RecoverWorker *pick_worker() {
+    RecoverWorker *target = nullptr;
+    for (auto &w : g_workers) {
+        const size_t queued = w.todo.size();
+        if (queued >= RECOVER_BATCHES_PER_WORKER) continue;
+        if (!target || queued < target->todo.size()) target = &w;
+    }
+    return target;
+}
 
-    // Zero out MIC field (at offset 77 in EAPOL-Key, offset 81 in full EAPOL)
-    memset(eapol_copy + 81, 0, 16);
+/* ----------------- Checkpoints ----------------- */
+static const uint32_t RECOVER_CHECKPOINT_INTERVAL_MS = 30000;
 
-    mbedtls_md_context_t ctx;
-    mbedtls_md_init(&ctx);
+static bool load_checkpoint(FS &fs, const String &path, RecoverCheckpoint &cp) {
+    if (!fs.exists(path)) return false;
+    File f = fs.open(path, FILE_READ);
+    if (!f) return false;
+    const bool ok = f.read((uint8_t *)&cp, sizeof(cp)) == sizeof(cp);
+    f.close();
+    return ok;
+}
 
-    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
-    mbedtls_md_setup(&ctx, md, 1);
-    mbedtls_md_hmac_starts(&ctx, kck, 16);
-    mbedtls_md_hmac_update(&ctx, eapol_copy, hs.eapol_len);
+// Written to a temp file first so a power cut never leaves a torn checkpoint behind
+static bool save_checkpoint(FS &fs, const String &path, RecoverCheckpoint &cp) {
+    cp.seal();
+    const String tmp = path + ".tmp";
+    File f = fs.open(tmp, FILE_WRITE);
+    if (!f) return false;
+    const bool ok = f.write((const uint8_t *)&cp, sizeof(cp)) == sizeof(cp);
+    f.close();
+    if (!ok) {
+        fs.remove(tmp);
+        return false;
+    }
+    if (fs.exists(path)) fs.remove(path);
+    return fs.rename(tmp, path);
+}
 
-    uint8_t computed_mic[20];
-    mbedtls_md_hmac_finish(&ctx, computed_mic);
-    mbedtls_md_free(&ctx);
+/* ----------------- Rules ----------------- */
+static const size_t RECOVER_MAX_RULES = 512;
 
-    return memcmp(computed_mic, hs.mic, 16) == 0;
+// Reads a hashcat style rule file, returns how many lines were unsupported or did not fit
+static uint16_t load_rules(FS &fs, const String &path, WpaRuleSet &rules) {
+    File f = fs.open(path, FILE_READ);
+    if (!f) return 0;
+    uint16_t skipped = 0;
+    while (f.available()) {
+        String line = f.readStringUntil('\n');
+        if (!rules.add(line.c_str(), line.length())) skipped++;
+    }
+    f.close();
+    return skipped;
 }
 
 /* ----------------- Main Cracking Function ----------------- */
-void wifi_crack_handshake(const String &wordlist_path, const String &pcap_path) {
-    // reset abort flag
-    g_abortRequested = false;
-
-    resetTftDisplay();
-    drawMainBorderWithTitle("WiFi Password Recover", true);
-    padprintln("");
+enum RecoverSource { RECOVER_SINGLE_PCAP, RECOVER_PCAP_FOLDER, RECOVER_HC22000 };
 
-    FS *fs = nullptr;
-    if (!getFsStorage(fs)) {
-        displayError("No filesystem available", true);
-        return;
+// Fills targets from the selected source, prompting for the SSID of a lone capture without one
+static bool load_targets(FS &fs, const String &path, RecoverSource source, WpaTargetSet &targets) {
+    if (source == RECOVER_HC22000) {
+        padprintln("Loading 22000 hashes...");
+        return load_hc22000(fs, path, targets) > 0;
+    }
+    if (source == RECOVER_PCAP_FOLDER) {
+        padprintln("Parsing captures in folder...");
+        return load_pcap_folder(fs, path, targets) > 0;
     }
 
-    // Parse handshake
     padprintln("Parsing handshake...");
     HandshakeData hs;
-    if (!parse_pcap_handshake(*fs, pcap_path, hs)) {
-        displayError("Failed to parse handshake", true);
-        vTaskDelay(pdMS_TO_TICKS(3000));
-        return;
-    }
+    if (!parse_pcap_handshake(fs, path, hs)) return false;
 
     padprintln("Handshake loaded!");
     padprintf("SSID: %s\n", hs.ssid[0] ? hs.ssid : "(not found)");
@@ -541,10 +608,7 @@ void wifi_crack_handshake(const String &wordlist_path, const String &pcap_path)
     if (hs.ssid[0] == '\0') {
         padprintln("SSID not found in PCAP");
         String ssid = keyboard("", 32, "Enter SSID:");
-        if (ssid.length() == 0) {
-            displayError("SSID required", true);
-            return;
-        }
+        if (ssid.length() == 0) return false;
         strncpy(hs.ssid, ssid.c_str(), sizeof(hs.ssid) - 1);
         resetTftDisplay();
         drawMainBorderWithTitle("WiFi Password Recover", true);
@@ -552,110 +616,265 @@ void wifi_crack_handshake(const String &wordlist_path, const String &pcap_path)
         padprintf("SSID: %s\n", hs.ssid);
         padprintln("");
     }
+    return add_handshake(targets, hs);
+}
+
+void wifi_crack_handshake(
+    const String &wordlist_path, const String &target_path, RecoverSource source, const WpaRuleSet *rules
+) {
+    // reset abort flag
+    g_abortRequested = false;
+
+    resetTftDisplay();
+    drawMainBorderWithTitle("WiFi Password Recover", true);
+    padprintln("");
+
+    FS *fs = nullptr;
+    if (!getFsStorage(fs)) {
+        displayError("No filesystem available", true);
+        return;
+    }
+
+    g_targets = new (std::nothrow) WpaTargetSet();
+    if (!g_targets) {
+        displayError("Not enough memory", true);
+        return;
+    }
+    g_targets->clear();
+    auto release_targets = [&]() {
+        delete g_targets;
+        g_targets = nullptr;
+    };
+    if (!load_targets(*fs, target_path, source, *g_targets)) {
+        release_targets();
+        displayError("No usable handshake", true);
+        vTaskDelay(pdMS_TO_TICKS(3000));
+        return;
+    }
+    if (source != RECOVER_SINGLE_PCAP) {
+        padprintf("Targets: %u in %u networks\n", g_targets->count(), g_targets->groupCount());
+        padprintln("");
+    }
 
     // Open wordlist
     File wf = fs->open(wordlist_path, FILE_READ);
     if (!wf) {
+        release_targets();
         displayError("Cannot open wordlist", true);
         return;
     }
 
+    const uint8_t batchCount = RECOVER_WORKERS * RECOVER_BATCHES_PER_WORKER;
+    g_batches = (CandidateBatch *)heap_caps_malloc(batchCount * sizeof(CandidateBatch), MALLOC_CAP_8BIT);
+    WordlistReader<File> *reader = new (std::nothrow) WordlistReader<File>();
+    auto release = [&]() {
+        free(g_batches);
+        g_batches = nullptr;
+        delete reader;
+        wf.close();
+        release_targets();
+    };
+    if (!g_batches || !reader) {
+        release();
+        displayError("Not enough memory", true);
+        return;
+    }
+
+    // Offer to continue a previous run on the same targets and wordlist
+    const String checkpoint_path = target_path + ".resume";
+    RecoverCheckpoint cp;
+    memset(&cp, 0, sizeof(cp));
+    const uint32_t targetsFingerprint = g_targets->fingerprint();
+    // The rules are part of the candidate stream, a different set must not resume this one
+    uint32_t wordlistHash = fnv1a32(wordlist_path.c_str(), wordlist_path.length());
+    for (size_t r = 0; rules && r < rules->count(); ++r) {
+        wordlistHash = fnv1a32(rules->rule(r).ops, rules->rule(r).len, wordlistHash);
+    }
+    const uint32_t wordlistSize = wf.size();
+    bool resume = false;
+    if (load_checkpoint(*fs, checkpoint_path, cp) &&
+        cp.matches(targetsFingerprint, wordlistHash, wordlistSize)) {
+        std::vector<Option> resumeOptions = {
+            {"Resume",     [&]() { resume = true; } },
+            {"Start over", [&]() { resume = false; }},
+        };
+        const String prompt = "Resume at " + String(cp.tested) + " tested?";
+        loopOptions(resumeOptions, MENU_TYPE_SUBMENU, prompt.c_str());
+        resetTftDisplay();
+        drawMainBorderWithTitle("WiFi Password Recover", true);
+        padprintln("");
+        padprintf("Targets: %u in %u networks\n", g_targets->count(), g_targets->groupCount());
+        padprintln("");
+    }
+    if (!resume) {
+        cp.offset = 0;
+        cp.tested = 0;
+        cp.elapsedSec = 0;
+    }
+    cp.handshake = targetsFingerprint;
+    cp.wordlistPath = wordlistHash;
+    cp.wordlistSize = wordlistSize;
+    if (!reader->begin(&wf, cp.offset)) {
+        release();
+        displayError("Cannot seek wordlist", true);
+        return;
+    }
+    // With rules a batch holds fewer base words, so it still takes about as long as a plain one
+    g_rules = rules && rules->count() ? rules : nullptr;
+    uint8_t wordsPerBatch = WPA_BATCH_CANDIDATES;
+    if (g_rules) {
+        reader->setLengthRange(1, WPA_PASSPHRASE_MAX);
+        const size_t ruleCount = g_rules->count();
+        wordsPerBatch = ruleCount >= WPA_BATCH_CANDIDATES ? 1 : WPA_BATCH_CANDIDATES / ruleCount;
+    }
+    RecoverFrontier frontier;
+    frontier.reset(cp.offset, cp.tested);
+    const uint32_t resumedTested = cp.tested;
+    const uint32_t resumedSec = cp.elapsedSec;
+    uint32_t savedOffset = cp.offset;
+    if (resume) padprintf("Resuming after %u tested\n", resumedTested);
+
+    const Sha1Selection &sha1 = wpa_sha1_select();
+    if (sha1.exclusive == sha1.shared) padprintf("SHA1: %s\n", sha1.shared->name);
+    else padprintf("SHA1: %s + %s\n", sha1.exclusive->name, sha1.shared->name);
+
     // Start Recovering
     padprintln("Recovering...");
     padprintln("(Press SEL to abort at any time)"); // clearer instruction
     padprintln("");
 
     uint64_t start_time = now_us();
-    uint32_t attempts = 0;
-    bool found = false;
-    String found_password;
 
-    char password[128];
-    uint8_t pmk[32];
-    uint8_t ptk[64];
+    uint8_t freeList[batchCount];
+    uint8_t freeCount = 0;
+    for (uint8_t i = 0; i < batchCount; ++i) freeList[freeCount++] = i;
+    uint8_t inFlight = 0;
+    bool inputDone = false;
+    bool reported[WPA_MAX_TARGETS] = {};
+    uint32_t lastUi = millis();
+    uint32_t lastCheckpoint = millis();
+    String current;
+
+    // Hands finished batches back to the free list and moves the checkpoint frontier
+    auto collect = [&]() {
+        uint8_t idx;
+        for (auto &w : g_workers) {
+            while (w.done.pop(idx)) {
+                const CandidateBatch &done = g_batches[idx];
+                frontier.returned(done.seq, done.complete, done.tested);
+                freeList[freeCount++] = idx;
+                inFlight--;
+            }
+        }
+    };
+    auto checkpoint = [&]() {
+        if (frontier.offset() == savedOffset) return;
+        cp.offset = frontier.offset();
+        cp.tested = frontier.tested();
+        cp.elapsedSec = resumedSec + (uint32_t)((now_us() - start_time) / 1000000);
+        if (save_checkpoint(*fs, checkpoint_path, cp)) savedOffset = cp.offset;
+    };
+    // Results are written as they come in, so a later abort never loses a cracked network
+    auto report = [&]() {
+        for (uint8_t i = 0; i < g_targets->count(); ++i) {
+            if (reported[i] || !g_targets->isCracked(i)) continue;
+            reported[i] = true;
+            save_recovered(*fs, g_targets->target(i));
+            if (g_targets->count() > 1) padprintf("\nCracked %s\n", g_targets->target(i).ssid);
+        }
+    };
+
+    if (!start_workers(sha1)) {
+        stop_workers();
+        release();
+        displayError("Failed to start workers", true);
+        return;
+    }
 
-    // Main loop
-    while (wf.available() && !found && !g_abortRequested) {
-        // Poll early for abort (avoid being stuck at file reading)
+    // Main loop: keep the workers fed, draw progress at a fixed rate
+    while (!g_stopWorkers) {
         poll_user_abort();
         if (g_abortRequested) break;
 
-        String line = wf.readStringUntil('\n');
-        line.trim();
-
-        // quick UI heartbeat (so the display doesn't look frozen)
-        if ((attempts & 0x3FF) == 0) { taskYIELD(); }
-
-        if (line.length() == 0 || line[0] == '#') continue;
-        if (line.length() < 8 || line.length() > 63) continue;
-
-        strncpy(password, line.c_str(), sizeof(password) - 1);
-        password[sizeof(password) - 1] = '\0';
+        collect();
 
-        // Compute PMK (may be heavy) — pbkdf2 now checks g_abortRequested internally
-        int pbkdf2_res = pbkdf2_hmac_sha1(
-            (const unsigned char *)password,
-            strlen(password),
-            (const unsigned char *)hs.ssid,
-            strlen(hs.ssid),
-            4096,
-            32,
-            pmk
-        );
-
-        if (pbkdf2_res == -4 || g_abortRequested) {
-            g_abortRequested = true;
-            break;
-        }
-        if (pbkdf2_res != 0) {
-            // Some error; skip this password
-            attempts++;
-            continue;
-        }
-
-        // Derive PTK (small loop) - returns false if aborted
-        if (!derive_ptk(pmk, hs.ap_mac, hs.sta_mac, hs.anonce, hs.snonce, ptk)) {
-            g_abortRequested = true;
-            break;
-        }
-
-        // Verify MIC
-        if (verify_mic(hs, ptk)) {
-            found = true;
-            found_password = String(password);
-            break;
+        while (!inputDone && freeCount && !frontier.full()) {
+            RecoverWorker *target = pick_worker();
+            if (!target) break;
+            const uint8_t idx = freeList[freeCount - 1];
+            CandidateBatch &batch = g_batches[idx];
+            if (!reader->fill(batch, wordsPerBatch)) {
+                inputDone = true;
+                break;
+            }
+            freeCount--;
+            batch.seq = frontier.dispatched(batch.endOffset);
+            current = batch.words[0];
+            target->todo.push(idx);
+            inFlight++;
+            xTaskNotifyGive(target->task);
         }
+        if (inputDone && inFlight == 0) break;
 
-        attempts++;
-
-        // Update UI every 10 attempts for a snappier UI (but not every single attempt to avoid spamming draw)
-        if ((attempts % 10) == 0) {
+        if (millis() - lastUi >= RECOVER_UI_INTERVAL_MS) {
+            lastUi = millis();
+            report();
+            const uint32_t tested = g_tested.load(std::memory_order_relaxed);
+            const uint32_t total = resumedTested + tested;
             uint64_t elapsed = now_us() - start_time;
-            double rate = (elapsed > 0) ? (attempts * 1000000.0 / elapsed) : 0;
+            double rate = (elapsed > 0) ? (tested * 1000000.0 / elapsed) : 0;
             double seconds = elapsed / 1000000.0;
-            padprintf("\rAttempts: %u  %.1f/s  Time: %.1fs   ", attempts, rate, seconds);
+            padprintf("\rAttempts: %u  %.1f/s  Time: %.1fs   ", total, rate, seconds);
 
             // show a small "current candidate" snippet (trim to fit)
-            String cand = line;
+            String cand = current;
             if (cand.length() > 20) { cand = cand.substring(0, 17) + "..."; }
             padprintf("Cur: %s", cand.c_str());
+        }
 
-            // small yield so button checks in other contexts can run
-            vTaskDelay(pdMS_TO_TICKS(1));
-
-            // immediate abort check
-            poll_user_abort();
-            if (g_abortRequested) break;
+        if (millis() - lastCheckpoint >= RECOVER_CHECKPOINT_INTERVAL_MS) {
+            lastCheckpoint = millis();
+            checkpoint();
         }
+
+        vTaskDelay(pdMS_TO_TICKS(20));
     }
 
-    wf.close();
+    stop_workers();
+    collect();
+    report();
+    const uint32_t attempts = g_tested.load(std::memory_order_relaxed);
+    const uint8_t crackedCount = g_targets->crackedCount();
+    const uint8_t targetCount = g_targets->count();
+    const bool allCracked = g_targets->allCracked();
+
+    // A finished run has nothing left to resume; an interrupted one keeps its place
+    if (allCracked || (inputDone && frontier.inFlight() == 0)) {
+        if (fs->exists(checkpoint_path)) fs->remove(checkpoint_path);
+    } else {
+        checkpoint();
+    }
+
+    // Copy the results out before the target set goes away
+    struct Recovered {
+        String ssid;
+        String password;
+    };
+    std::vector<Recovered> recovered;
+    for (uint8_t i = 0; i < targetCount; ++i) {
+        if (g_targets->isCracked(i)) {
+            recovered.push_back({String(g_targets->target(i).ssid), String(g_targets->target(i).password)});
+        }
+    }
+    release();
+    g_rules = nullptr;
 
-    if (g_abortRequested) {
+    if (g_abortRequested && crackedCount == 0) {
         padprintln("");
         padprintln("");
         padprintln("Aborted by user");
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        padprintln("Progress saved, select the same files to resume");
+        vTaskDelay(pdMS_TO_TICKS(1500));
         return;
     }
 
@@ -669,7 +888,7 @@ void wifi_crack_handshake(const String &wordlist_path, const String &pcap_path)
     padprintln("");
 
     /* ----------------- Improved result UI (tidy & minimal) ----------------- */
-    if (found) {
+    if (!recovered.empty()) {
         // Clear and redraw a fresh result screen so the password line is always visible.
         resetTftDisplay(); // << UI TIDY
         drawMainBorderWithTitle("WiFi Password Cracker", true);
@@ -677,27 +896,34 @@ void wifi_crack_handshake(const String &wordlist_path, const String &pcap_path)
 
         // Single green title line
         tft.setTextColor(TFT_GREEN, bruceConfig.bgColor);
-        padprintln("PASSWORD FOUND!");
+        if (targetCount > 1) padprintf("FOUND %u OF %u!\n", crackedCount, targetCount);
+        else padprintln("PASSWORD FOUND!");
         tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
 
-        padprintln(""); // small gap
-
-        // Show SSID line
-        padprintf("SSID: %s\n", hs.ssid[0] ? hs.ssid : "(not found)");
+        const size_t MAX_SHOWN = 3; // what fits above the prompt
+        for (size_t i = 0; i < recovered.size() && i < MAX_SHOWN; ++i) {
+            padprintln(""); // small gap
+
+            // Show SSID line
+            padprintf("SSID: %s\n", recovered[i].ssid.c_str());
+
+            // Trim long passwords so they fit on one line; keep head+tail for readability.
+            String display_pw = recovered[i].password;
+            const int MAX_DISPLAY_LEN = 28; // tune to your visible width
+            if (display_pw.length() > MAX_DISPLAY_LEN) {
+                int head = 14;
+                int tail = MAX_DISPLAY_LEN - head - 3; // for "..."
+                if (tail < 3) tail = 3;
+                display_pw =
+                    display_pw.substring(0, head) + "..." + display_pw.substring(display_pw.length() - tail);
+            }
 
-        // Trim long passwords so they fit on one line; keep head+tail for readability.
-        String display_pw = found_password;
-        const int MAX_DISPLAY_LEN = 28; // tune to your visible width
-        if (display_pw.length() > MAX_DISPLAY_LEN) {
-            int head = 14;
-            int tail = MAX_DISPLAY_LEN - head - 3; // for "..."
-            if (tail < 3) tail = 3;
-            display_pw =
-                display_pw.substring(0, head) + "..." + display_pw.substring(display_pw.length() - tail);
+            // Password line
+            padprintf("Password: %s\n", display_pw.c_str());
+        }
+        if (recovered.size() > MAX_SHOWN) {
+            padprintf("+%u more in %s\n", (unsigned)(recovered.size() - MAX_SHOWN), RECOVERED_FILE);
         }
-
-        // Password line
-        padprintf("Password: %s\n", display_pw.c_str());
 
         padprintln(""); // small gap
 
@@ -748,6 +974,40 @@ void wifi_recover_menu() {
         return;
     }
 
+    // Optional mangling rules: every base word read from SD becomes many candidates
+    WpaRuleSet rules;
+    int ruleChoice = 0;
+    std::vector<Option> ruleOptions = {
+        {"No rules",       [&]() { ruleChoice = 0; }},
+        {"Built-in rules", [&]() { ruleChoice = 1; }},
+        {"Rule file",      [&]() { ruleChoice = 2; }},
+    };
+    loopOptions(ruleOptions, MENU_TYPE_SUBMENU, "Word mangling");
+    if (ruleChoice != 0 && !rules.init(RECOVER_MAX_RULES)) {
+        displayError("Not enough memory", true);
+        return;
+    }
+    if (ruleChoice == 1) rules.addDefaults();
+    if (ruleChoice == 2) {
+        resetTftDisplay();
+        drawMainBorderWithTitle("WiFi Cracker", true);
+        padprintln("");
+        padprintln("Select rule file...");
+        String rulePath = loopSD(*fs, true, "rule|txt|*", WORDLIST_DIR);
+        if (rulePath.length() == 0) {
+            displayInfo("Cancelled", true);
+            return;
+        }
+        const uint16_t skipped = load_rules(*fs, rulePath, rules);
+        if (rules.count() == 0) {
+            displayError("No usable rules", true);
+            return;
+        }
+        if (skipped) {
+            displayInfo(String(rules.count()) + " rules, " + String(skipped) + " skipped", true);
+        }
+    }
+
     // Ensure BrucePCAP folder exists, create if needed
     const String PCAP_DIR = "/BrucePCAP";
     if (!(*fs).exists(PCAP_DIR)) {
@@ -759,19 +1019,31 @@ void wifi_recover_menu() {
         }
     }
 
-    // Select PCAP (start inside /BrucePCAP)
+    // Select PCAP or 22000 file (start inside /BrucePCAP)
     resetTftDisplay();
     drawMainBorderWithTitle("WiFi Cracker", true);
     padprintln("");
-    padprintln("Select PCAP handshake...");
-    String pcap = loopSD(*fs, true, "pcap|cap|*", PCAP_DIR);
+    padprintln("Select PCAP handshake or 22000 file...");
+    String pcap = loopSD(*fs, true, "pcap|cap|22000|*", PCAP_DIR);
     if (pcap.length() == 0) {
         displayInfo("Cancelled", true);
         return;
     }
 
+    RecoverSource source = RECOVER_SINGLE_PCAP;
+    if (pcap.endsWith(".22000")) {
+        source = RECOVER_HC22000;
+    } else {
+        // Captures of the same network share the PMK, testing them together is almost free
+        std::vector<Option> sourceOptions = {
+            {"This capture",  [&]() { source = RECOVER_SINGLE_PCAP; }},
+            {"All in folder", [&]() { source = RECOVER_PCAP_FOLDER; }},
+        };
+        loopOptions(sourceOptions, MENU_TYPE_SUBMENU, "Handshakes to test");
+    }
+
     // Run cracker
-    wifi_crack_handshake(wordlist, pcap);
+    wifi_crack_handshake(wordlist, pcap, source, rules.count() ? &rules : nullptr);
 
     // Wait for keypress
     while (!check(AnyKeyPress)) { vTaskDelay(pdMS_TO_TICKS(50)); }
@@ -0,0 +1,119 @@
+#ifndef __WPA_CANDIDATES_H__
+#define __WPA_CANDIDATES_H__
+// Wordlist streaming for WPA recovery. The reader pulls the file in fixed chunks and packs usable
+// lines (trimmed, not a # comment, 8-63 bytes unless told otherwise) into fixed-size batches,
+// which are what the workers consume. endOffset always sits on a line boundary, so a batch is a
+// resumable unit.
+// Plain C++, FileT needs int read(uint8_t *, size_t) and bool seek(uint32_t).
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t WPA_PASSPHRASE_MIN = 8;
+const uint8_t WPA_PASSPHRASE_MAX = 63;
+const uint8_t WPA_BATCH_CANDIDATES = 32;
+
+struct CandidateBatch {
+    uint32_t endOffset; // wordlist offset right after the last line consumed for this batch
+    uint32_t seq;       // dispatch order, owned by the caller
+    uint32_t tested;    // set by the worker: candidates tested from this batch
+    bool complete;      // set by the worker: every candidate was tested
+    uint8_t count;
+    uint8_t lens[WPA_BATCH_CANDIDATES];
+    char words[WPA_BATCH_CANDIDATES][WPA_PASSPHRASE_MAX + 1]; // NUL terminated
+};
+
+template <typename FileT> class WordlistReader {
+public:
+    static const size_t CHUNK_SIZE = 1024;
+
+    // Starts reading at offset, which must be a line start (0 or a previous endOffset)
+    bool begin(FileT *file, uint32_t offset = 0) {
+        file_ = file;
+        offset_ = offset;
+        pos_ = len_ = 0;
+        lineLen_ = 0;
+        overlong_ = false;
+        eof_ = false;
+        return file_ && (offset == 0 || file_->seek(offset));
+    }
+
+    // Base words for rule expansion can be shorter than a passphrase
+    void setLengthRange(uint8_t minLen, uint8_t maxLen) {
+        minLen_ = minLen;
+        maxLen_ = maxLen > WPA_PASSPHRASE_MAX ? WPA_PASSPHRASE_MAX : maxLen;
+    }
+
+    // Fills batch with up to maxWords candidates; false once the file is exhausted
+    bool fill(CandidateBatch &batch, uint8_t maxWords = WPA_BATCH_CANDIDATES) {
+        if (maxWords == 0 || maxWords > WPA_BATCH_CANDIDATES) maxWords = WPA_BATCH_CANDIDATES;
+        batch.count = 0;
+        while (batch.count < maxWords) {
+            if (pos_ == len_) {
+                if (eof_) break;
+                const int n = file_->read(chunk_, CHUNK_SIZE);
+                pos_ = 0;
+                len_ = n > 0 ? n : 0;
+                if (len_ == 0) {
+                    eof_ = true;
+                    endLine(batch); // last line without a newline
+                    break;
+                }
+            }
+            const uint8_t *start = chunk_ + pos_;
+            const uint8_t *nl = (const uint8_t *)memchr(start, '\n', len_ - pos_);
+            const size_t take = nl ? nl - start : len_ - pos_;
+            if (lineLen_ + take <= sizeof(line_)) {
+                memcpy(line_ + lineLen_, start, take);
+                lineLen_ += take;
+            } else {
+                overlong_ = true;
+            }
+            pos_ += take;
+            offset_ += take;
+            if (nl) {
+                pos_++;
+                offset_++;
+                endLine(batch);
+            }
+        }
+        batch.endOffset = offset_;
+        return batch.count > 0;
+    }
+
+    bool exhausted() const { return eof_ && pos_ == len_; }
+    uint32_t offset() const { return offset_; }
+
+private:
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+    void endLine(CandidateBatch &batch) {
+        const bool overlong = overlong_;
+        size_t begin = 0, end = lineLen_;
+        lineLen_ = 0;
+        overlong_ = false;
+        if (overlong) return;
+        while (begin < end && isSpace(line_[begin])) begin++;
+        while (end > begin && isSpace(line_[end - 1])) end--;
+        const size_t len = end - begin;
+        if (len == 0 || len < minLen_ || len > maxLen_ || line_[begin] == '#') return;
+        memcpy(batch.words[batch.count], line_ + begin, len);
+        batch.words[batch.count][len] = '\0';
+        batch.lens[batch.count] = len;
+        batch.count++;
+    }
+
+    FileT *file_ = nullptr;
+    uint32_t offset_ = 0;
+    size_t pos_ = 0;
+    size_t len_ = 0;
+    bool eof_ = false;
+    bool overlong_ = false;
+    uint8_t minLen_ = WPA_PASSPHRASE_MIN;
+    uint8_t maxLen_ = WPA_PASSPHRASE_MAX;
+    size_t lineLen_ = 0;
+    char line_[128]; // room for surrounding whitespace, longer lines are skipped
+    uint8_t chunk_[CHUNK_SIZE];
+};
+
+#endif
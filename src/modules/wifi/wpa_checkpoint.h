@@ -0,0 +1,111 @@
+#ifndef __WPA_CHECKPOINT_H__
+#define __WPA_CHECKPOINT_H__
+// Resume state for long wordlist runs. Batches finish out of order across workers, so the saved
+// position is the in-order completion frontier: every candidate before `offset` has been tested
+// and `tested` counts exactly those. Batches finished past the frontier are tested again after a
+// resume, but never counted twice and never skipped. Plain C++ so it can be built off-target.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const uint32_t RECOVER_CHECKPOINT_MAGIC = 0x4B435042; // "BPCK"
+const uint16_t RECOVER_CHECKPOINT_VERSION = 1;
+
+inline uint32_t fnv1a32(const void *data, size_t len, uint32_t h = 2166136261u) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Stored verbatim (little-endian targets only, like the pcap headers)
+struct RecoverCheckpoint {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t handshake;    // fingerprint of the target handshake and SSID
+    uint32_t wordlistPath; // fnv1a32 of the wordlist path
+    uint32_t wordlistSize;
+    uint32_t offset; // resume here, always a line start
+    uint32_t tested;
+    uint32_t elapsedSec;
+    uint32_t crc; // fnv1a32 of everything above
+
+    void seal() {
+        magic = RECOVER_CHECKPOINT_MAGIC;
+        version = RECOVER_CHECKPOINT_VERSION;
+        reserved = 0;
+        crc = fnv1a32(this, offsetof(RecoverCheckpoint, crc));
+    }
+
+    // Intact and written for this handshake and this exact wordlist
+    bool matches(uint32_t handshakeFp, uint32_t pathHash, uint32_t size) const {
+        if (magic != RECOVER_CHECKPOINT_MAGIC || version != RECOVER_CHECKPOINT_VERSION) return false;
+        if (crc != fnv1a32(this, offsetof(RecoverCheckpoint, crc))) return false;
+        return handshake == handshakeFp && wordlistPath == pathHash && wordlistSize == size &&
+               offset <= size;
+    }
+};
+
+// Follows dispatched batches by sequence number and advances over the ones that completed
+class RecoverFrontier {
+public:
+    static const uint8_t MAX_IN_FLIGHT = 32; // must cover every batch that can be out at once
+
+    void reset(uint32_t offset, uint32_t tested) {
+        offset_ = offset;
+        tested_ = tested;
+        nextSeq_ = 0;
+        frontierSeq_ = 0;
+        memset(slots_, 0, sizeof(slots_));
+    }
+
+    // Do not dispatch while full, the slot of the oldest pending batch would be reused
+    bool full() const { return inFlight() >= MAX_IN_FLIGHT; }
+
+    // Returns the sequence number to carry with the batch
+    uint32_t dispatched(uint32_t endOffset) {
+        Slot &s = slots_[nextSeq_ % MAX_IN_FLIGHT];
+        s.endOffset = endOffset;
+        s.tested = 0;
+        s.done = false;
+        return nextSeq_++;
+    }
+
+    // complete is false when the batch was cut short by a stop; it then pins the frontier.
+    // tested is how many candidates the batch produced, which rules can make differ from its lines.
+    void returned(uint32_t seq, bool complete, uint32_t tested) {
+        if (!complete || seq < frontierSeq_ || seq >= nextSeq_) return;
+        Slot &done = slots_[seq % MAX_IN_FLIGHT];
+        done.tested = tested;
+        done.done = true;
+        while (frontierSeq_ < nextSeq_) {
+            Slot &s = slots_[frontierSeq_ % MAX_IN_FLIGHT];
+            if (!s.done) break;
+            offset_ = s.endOffset;
+            tested_ += s.tested;
+            frontierSeq_++;
+        }
+    }
+
+    uint32_t offset() const { return offset_; }
+    uint32_t tested() const { return tested_; }
+    uint32_t inFlight() const { return nextSeq_ - frontierSeq_; }
+
+private:
+    struct Slot {
+        uint32_t endOffset;
+        uint32_t tested;
+        bool done;
+    };
+
+    uint32_t offset_ = 0;
+    uint32_t tested_ = 0;
+    uint32_t nextSeq_ = 0;
+    uint32_t frontierSeq_ = 0;
+    Slot slots_[MAX_IN_FLIGHT];
+};
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef __WPA_CRYPTO_H__
+#define __WPA_CRYPTO_H__
+// WPA-PSK key derivation on top of a bare SHA1 block function.
+// PBKDF2-HMAC-SHA1 for the PMK hashes the ipad/opad key blocks once per passphrase and starts
+// every iteration from those midstates, so an iteration costs two compressions instead of four.
+// Intermediate values stay as big-endian words, bytes are only produced for the final PMK.
+// The block function is pluggable (Sha1Backend); the two software ones live here so the whole
+// derivation can be built and measured off-target.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SHA1_ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+const uint32_t SHA1_IV[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+inline uint32_t loadBe32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+inline void storeBe32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+// One SHA1 compression of a 16-word big-endian block into state
+inline void sha1Compress(uint32_t state[5], const uint32_t block[16]) {
+    uint32_t w[16];
+    memcpy(w, block, sizeof(w));
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+#define SHA1_W(i)                                                                                            \
+    (w[(i) & 15] = SHA1_ROL(w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^ w[((i) + 2) & 15] ^ w[(i) & 15], 1))
+#define SHA1_STEP(f, k, wi)                                                                                  \
+    do {                                                                                                     \
+        uint32_t t = SHA1_ROL(a, 5) + (f) + e + (k) + (wi);                                                  \
+        e = d;                                                                                               \
+        d = c;                                                                                               \
+        c = SHA1_ROL(b, 30);                                                                                 \
+        b = a;                                                                                               \
+        a = t;                                                                                               \
+    } while (0)
+
+    int i = 0;
+    for (; i < 16; ++i) SHA1_STEP((b & c) | (~b & d), 0x5A827999, w[i]);
+    for (; i < 20; ++i) SHA1_STEP((b & c) | (~b & d), 0x5A827999, SHA1_W(i));
+    for (; i < 40; ++i) SHA1_STEP(b ^ c ^ d, 0x6ED9EBA1, SHA1_W(i));
+    for (; i < 60; ++i) SHA1_STEP((b & c) | (b & d) | (c & d), 0x8F1BBCDC, SHA1_W(i));
+    for (; i < 80; ++i) SHA1_STEP(b ^ c ^ d, 0xCA62C1D6, SHA1_W(i));
+
+#undef SHA1_STEP
+#undef SHA1_W
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+// Same compression fully unrolled with the working variables renamed instead of shuffled
+inline void sha1CompressUnrolled(uint32_t state[5], const uint32_t block[16]) {
+    uint32_t w[16];
+    memcpy(w, block, sizeof(w));
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+#define SHA1_F1(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA1_F2(x, y, z) ((x) ^ (y) ^ (z))
+#define SHA1_F3(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define SHA1_WX(i)                                                                                           \
+    ((i) < 16 ? w[(i) & 15]                                                                                  \
+              : (w[(i) & 15] = SHA1_ROL(                                                                     \
+                     w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^ w[((i) + 2) & 15] ^ w[(i) & 15], 1             \
+                 )))
+#define SHA1_R(v, x, y, z, u, F, K, i)                                                                       \
+    u += SHA1_ROL(v, 5) + F(x, y, z) + (K) + SHA1_WX(i);                                                     \
+    x = SHA1_ROL(x, 30);
+#define SHA1_R5(F, K, i)                                                                                     \
+    SHA1_R(a, b, c, d, e, F, K, i)                                                                           \
+    SHA1_R(e, a, b, c, d, F, K, (i) + 1)                                                                     \
+    SHA1_R(d, e, a, b, c, F, K, (i) + 2)                                                                     \
+    SHA1_R(c, d, e, a, b, F, K, (i) + 3)                                                                     \
+    SHA1_R(b, c, d, e, a, F, K, (i) + 4)
+
+    SHA1_R5(SHA1_F1, 0x5A827999, 0)
+    SHA1_R5(SHA1_F1, 0x5A827999, 5)
+    SHA1_R5(SHA1_F1, 0x5A827999, 10)
+    SHA1_R5(SHA1_F1, 0x5A827999, 15)
+    SHA1_R5(SHA1_F2, 0x6ED9EBA1, 20)
+    SHA1_R5(SHA1_F2, 0x6ED9EBA1, 25)
+    SHA1_R5(SHA1_F2, 0x6ED9EBA1, 30)
+    SHA1_R5(SHA1_F2, 0x6ED9EBA1, 35)
+    SHA1_R5(SHA1_F3, 0x8F1BBCDC, 40)
+    SHA1_R5(SHA1_F3, 0x8F1BBCDC, 45)
+    SHA1_R5(SHA1_F3, 0x8F1BBCDC, 50)
+    SHA1_R5(SHA1_F3, 0x8F1BBCDC, 55)
+    SHA1_R5(SHA1_F2, 0xCA62C1D6, 60)
+    SHA1_R5(SHA1_F2, 0xCA62C1D6, 65)
+    SHA1_R5(SHA1_F2, 0xCA62C1D6, 70)
+    SHA1_R5(SHA1_F2, 0xCA62C1D6, 75)
+
+#undef SHA1_R5
+#undef SHA1_R
+#undef SHA1_WX
+#undef SHA1_F3
+#undef SHA1_F2
+#undef SHA1_F1
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+typedef void (*Sha1CompressFn)(uint32_t state[5], const uint32_t block[16]);
+
+// A SHA1 block function plus optional hooks run around a whole PMK derivation, e.g. to hold a
+// hardware lock. shared is false when only one task at a time can use the backend.
+struct Sha1Backend {
+    const char *name;
+    Sha1CompressFn compress;
+    void (*begin)();
+    void (*end)();
+    bool shared;
+};
+
+const Sha1Backend SHA1_BACKEND_PORTABLE = {"portable", sha1Compress, nullptr, nullptr, true};
+
+// HMAC-SHA1 with the key pads hashed once. Keys longer than one block are not needed for WPA.
+class HmacSha1Midstate {
+public:
+    explicit HmacSha1Midstate(Sha1CompressFn compress = sha1Compress) : compress_(compress) {}
+
+    bool setKey(const uint8_t *key, size_t keyLen) {
+        if (keyLen > 64) return false;
+        uint8_t pad[64];
+        uint32_t block[16];
+        memset(pad, 0, sizeof(pad));
+        memcpy(pad, key, keyLen);
+        for (int i = 0; i < 16; ++i) block[i] = loadBe32(pad + i * 4) ^ 0x36363636;
+        memcpy(inner_, SHA1_IV, sizeof(inner_));
+        compress_(inner_, block);
+        for (int i = 0; i < 16; ++i) block[i] = loadBe32(pad + i * 4) ^ 0x5C5C5C5C;
+        memcpy(outer_, SHA1_IV, sizeof(outer_));
+        compress_(outer_, block);
+        return true;
+    }
+
+    // HMAC of a 20-byte message given as 5 words, the PBKDF2 inner loop
+    void digestWords(const uint32_t msg[5], uint32_t out[5]) const {
+        uint32_t block[16] = {0};
+        memcpy(block, msg, 20);
+        block[5] = 0x80000000;
+        block[15] = (64 + 20) * 8;
+        memcpy(out, inner_, 20);
+        compress_(out, block);
+        finish(out);
+    }
+
+    // HMAC of an arbitrary message, out is 5 words
+    void digest(const uint8_t *msg, size_t len, uint32_t out[5]) const {
+        memcpy(out, inner_, 20);
+        hashTail(out, msg, len, 64);
+        finish(out);
+    }
+
+private:
+    // Outer hash over the 20-byte inner digest already in h
+    void finish(uint32_t h[5]) const {
+        uint32_t block[16] = {0};
+        memcpy(block, h, 20);
+        block[5] = 0x80000000;
+        block[15] = (64 + 20) * 8;
+        memcpy(h, outer_, 20);
+        compress_(h, block);
+    }
+
+    // Hashes msg plus SHA1 padding into h, `prefix` bytes already went through h
+    void hashTail(uint32_t h[5], const uint8_t *msg, size_t len, size_t prefix) const {
+        uint32_t block[16];
+        size_t pos = 0;
+        while (len - pos >= 64) {
+            for (int i = 0; i < 16; ++i) block[i] = loadBe32(msg + pos + i * 4);
+            compress_(h, block);
+            pos += 64;
+        }
+        uint8_t tail[128];
+        const size_t rest = len - pos;
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, msg + pos, rest);
+        tail[rest] = 0x80;
+        const size_t tailLen = rest + 9 > 64 ? 128 : 64;
+        const uint64_t bits = (uint64_t)(prefix + len) * 8;
+        storeBe32(tail + tailLen - 8, (uint32_t)(bits >> 32));
+        storeBe32(tail + tailLen - 4, (uint32_t)bits);
+        for (size_t off = 0; off < tailLen; off += 64) {
+            for (int i = 0; i < 16; ++i) block[i] = loadBe32(tail + off + i * 4);
+            compress_(h, block);
+        }
+    }
+
+    Sha1CompressFn compress_;
+    uint32_t inner_[5];
+    uint32_t outer_[5];
+};
+
+// PMK = PBKDF2-HMAC-SHA1(passphrase, ssid, 4096, 32). Returns false for an out-of-range input or
+// when *abort became true; it is polled every 1024 iterations.
+inline bool wpaDerivePmkWith(
+    const Sha1Backend &backend, const char *passphrase, size_t passLen, const uint8_t *ssid, size_t ssidLen,
+    uint8_t pmk[32], const volatile bool *abort
+) {
+    if (passLen == 0 || passLen > 63 || ssidLen > 32) return false;
+    HmacSha1Midstate hmac(backend.compress);
+    hmac.setKey((const uint8_t *)passphrase, passLen);
+
+    uint8_t salt[36];
+    memcpy(salt, ssid, ssidLen);
+    uint32_t t[10];
+    for (uint8_t blockIndex = 1; blockIndex <= 2; ++blockIndex) {
+        salt[ssidLen] = 0;
+        salt[ssidLen + 1] = 0;
+        salt[ssidLen + 2] = 0;
+        salt[ssidLen + 3] = blockIndex;
+        uint32_t u[5];
+        hmac.digest(salt, ssidLen + 4, u);
+        uint32_t *acc = t + (blockIndex - 1) * 5;
+        memcpy(acc, u, 20);
+        for (int iter = 1; iter < 4096; ++iter) {
+            if ((iter & 0x3FF) == 0 && abort && *abort) return false;
+            hmac.digestWords(u, u);
+            acc[0] ^= u[0];
+            acc[1] ^= u[1];
+            acc[2] ^= u[2];
+            acc[3] ^= u[3];
+            acc[4] ^= u[4];
+        }
+    }
+    for (int i = 0; i < 8; ++i) storeBe32(pmk + i * 4, t[i]);
+    return true;
+}
+
+inline bool wpaDerivePmk(
+    const char *passphrase, size_t passLen, const uint8_t *ssid, size_t ssidLen, uint8_t pmk[32],
+    const volatile bool *abort = nullptr, const Sha1Backend &backend = SHA1_BACKEND_PORTABLE
+) {
+    if (backend.begin) backend.begin();
+    const bool ok = wpaDerivePmkWith(backend, passphrase, passLen, ssid, ssidLen, pmk, abort);
+    if (backend.end) backend.end();
+    return ok;
+}
+
+// Everything about one captured handshake that does not depend on the passphrase: the PRF-512
+// input for the PTK and the EAPOL frame with its MIC zeroed. Testing a PMK is then two short HMACs.
+// A PMKID target uses the same storage: prfData holds "PMK Name" | AP | STA and eapolLen is 0.
+struct WpaHandshakeVector {
+    static const uint16_t MAX_EAPOL_LEN = 256;
+
+    bool init(
+        const uint8_t ap[6], const uint8_t sta[6], const uint8_t anonce[32], const uint8_t snonce[32],
+        const uint8_t *eapolFrame, uint16_t eapolFrameLen, const uint8_t expectedMic[16]
+    ) {
+        if (eapolFrameLen > MAX_EAPOL_LEN || eapolFrameLen < 81 + 16) return false;
+        static const char label[] = "Pairwise key expansion"; // NUL included below
+        uint8_t *p = prfData;
+        memcpy(p, label, sizeof(label));
+        p += sizeof(label);
+        const bool apFirst = memcmp(ap, sta, 6) < 0;
+        memcpy(p, apFirst ? ap : sta, 6);
+        memcpy(p + 6, apFirst ? sta : ap, 6);
+        p += 12;
+        const bool anonceFirst = memcmp(anonce, snonce, 32) < 0;
+        memcpy(p, anonceFirst ? anonce : snonce, 32);
+        memcpy(p + 32, anonceFirst ? snonce : anonce, 32);
+        p += 64;
+        *p++ = 0; // PRF counter, only the first block (KCK) is ever needed
+        prfLen = p - prfData;
+
+        memcpy(eapol, eapolFrame, eapolFrameLen);
+        memset(eapol + 81, 0, 16);
+        eapolLen = eapolFrameLen;
+        memcpy(mic, expectedMic, 16);
+        return true;
+    }
+
+    void initPmkid(const uint8_t ap[6], const uint8_t sta[6], const uint8_t pmkid[16]) {
+        memcpy(prfData, "PMK Name", 8);
+        memcpy(prfData + 8, ap, 6);
+        memcpy(prfData + 14, sta, 6);
+        prfLen = 20;
+        eapolLen = 0;
+        memcpy(mic, pmkid, 16);
+    }
+
+    bool isPmkid() const { return eapolLen == 0; }
+
+    // HMAC-SHA1 MIC check (key descriptor version 2), or the PMKID for a PMKID target
+    bool pmkMatches(const uint8_t pmk[32]) const {
+        HmacSha1Midstate hmac;
+        uint32_t block[5];
+        uint8_t kck[20];
+        hmac.setKey(pmk, 32);
+        hmac.digest(prfData, prfLen, block);
+        if (isPmkid()) return matchesMic(block);
+        for (int i = 0; i < 5; ++i) storeBe32(kck + i * 4, block[i]);
+        hmac.setKey(kck, 16);
+        hmac.digest(eapol, eapolLen, block);
+        return matchesMic(block);
+    }
+
+    bool matchesMic(const uint32_t digest[5]) const {
+        for (int i = 0; i < 4; ++i) {
+            if (digest[i] != loadBe32(mic + i * 4)) return false;
+        }
+        return true;
+    }
+
+    uint8_t prfData[23 + 12 + 64 + 1];
+    size_t prfLen = 0;
+    uint8_t eapol[MAX_EAPOL_LEN];
+    uint16_t eapolLen = 0;
+    uint8_t mic[16];
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef __WPA_RULES_H__
+#define __WPA_RULES_H__
+// Word mangling rules for WPA recovery, a subset of the hashcat rule language:
+//   :        nothing               l u c C t  lower / upper / capitalize / inverse cap / toggle all
+//   TN       toggle case at N      $X ^X      append / prepend character X
+//   sXY      replace all X by Y    <N >N      reject unless length <= N / >= N
+// N is 0-9 then A-Z (10-35). Every expanded word that ends up outside 8-63 bytes is dropped, so
+// short base words are still useful once rules lengthen them. Plain C++ so it can be built
+// off-target.
+#include "wpa_candidates.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const uint8_t WPA_RULE_MAX_LEN = 16;
+const uint8_t WPA_RULE_WORK_LEN = WPA_PASSPHRASE_MAX + WPA_RULE_MAX_LEN;
+
+struct WpaRule {
+    uint8_t len;
+    char ops[WPA_RULE_MAX_LEN];
+};
+
+inline int wpaRulePosition(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return -1;
+}
+
+// Validates one rule line; whitespace between operations is allowed and dropped
+inline bool parseWpaRule(const char *text, size_t textLen, WpaRule &rule) {
+    rule.len = 0;
+    size_t i = 0;
+    while (i < textLen) {
+        const char op = text[i];
+        if (op == ' ' || op == '\t' || op == '\r') {
+            i++;
+            continue;
+        }
+        size_t argc;
+        switch (op) {
+            case ':':
+            case 'l':
+            case 'u':
+            case 'c':
+            case 'C':
+            case 't': argc = 0; break;
+            case '$':
+            case '^': argc = 1; break;
+            case 'T':
+            case '<':
+            case '>':
+                argc = 1;
+                if (i + 1 < textLen && wpaRulePosition(text[i + 1]) < 0) return false;
+                break;
+            case 's': argc = 2; break;
+            default: return false; // unsupported operation
+        }
+        if (i + 1 + argc > textLen || rule.len + 1 + argc > WPA_RULE_MAX_LEN) return false;
+        memcpy(rule.ops + rule.len, text + i, 1 + argc);
+        rule.len += 1 + argc;
+        i += 1 + argc;
+    }
+    return rule.len > 0;
+}
+
+inline char wpaToLower(char c) { return (c >= 'A' && c <= 'Z') ? c + 32 : c; }
+inline char wpaToUpper(char c) { return (c >= 'a' && c <= 'z') ? c - 32 : c; }
+inline char wpaToggle(char c) { return (c >= 'a' && c <= 'z') ? wpaToUpper(c) : wpaToLower(c); }
+
+// Applies a parsed rule. out needs WPA_PASSPHRASE_MAX + 1 bytes; false when the rule rejects the
+// word or the result is not a valid WPA passphrase length.
+inline bool applyWpaRule(const WpaRule &rule, const char *word, uint8_t wordLen, char *out, uint8_t &outLen) {
+    char buf[WPA_RULE_WORK_LEN];
+    if (wordLen > WPA_PASSPHRASE_MAX) return false;
+    memcpy(buf, word, wordLen);
+    uint8_t len = wordLen;
+
+    for (uint8_t i = 0; i < rule.len;) {
+        const char op = rule.ops[i++];
+        switch (op) {
+            case ':': break;
+            case 'l':
+                for (uint8_t k = 0; k < len; ++k) buf[k] = wpaToLower(buf[k]);
+                break;
+            case 'u':
+                for (uint8_t k = 0; k < len; ++k) buf[k] = wpaToUpper(buf[k]);
+                break;
+            case 'c':
+            case 'C':
+                for (uint8_t k = 0; k < len; ++k) {
+                    const bool first = k == 0;
+                    buf[k] = (first == (op == 'c')) ? wpaToUpper(buf[k]) : wpaToLower(buf[k]);
+                }
+                break;
+            case 't':
+                for (uint8_t k = 0; k < len; ++k) buf[k] = wpaToggle(buf[k]);
+                break;
+            case 'T': {
+                const int pos = wpaRulePosition(rule.ops[i++]);
+                if (pos < len) buf[pos] = wpaToggle(buf[pos]);
+                break;
+            }
+            case '$':
+                if (len >= sizeof(buf)) return false;
+                buf[len++] = rule.ops[i++];
+                break;
+            case '^':
+                if (len >= sizeof(buf)) return false;
+                memmove(buf + 1, buf, len);
+                buf[0] = rule.ops[i++];
+                len++;
+                break;
+            case 's': {
+                const char from = rule.ops[i++];
+                const char to = rule.ops[i++];
+                for (uint8_t k = 0; k < len; ++k) {
+                    if (buf[k] == from) buf[k] = to;
+                }
+                break;
+            }
+            case '<':
+                if (len > wpaRulePosition(rule.ops[i++])) return false;
+                break;
+            case '>':
+                if (len < wpaRulePosition(rule.ops[i++])) return false;
+                break;
+            default: return false;
+        }
+    }
+
+    if (len < WPA_PASSPHRASE_MIN || len > WPA_PASSPHRASE_MAX) return false;
+    memcpy(out, buf, len);
+    out[len] = '\0';
+    outLen = len;
+    return true;
+}
+
+class WpaRuleSet {
+public:
+    ~WpaRuleSet() { release(); }
+
+    bool init(size_t capacity) {
+        release();
+        rules_ = (WpaRule *)malloc(capacity * sizeof(WpaRule));
+        if (!rules_) return false;
+        capacity_ = capacity;
+        count_ = 0;
+        return true;
+    }
+
+    void release() {
+        free(rules_);
+        rules_ = nullptr;
+        capacity_ = count_ = 0;
+    }
+
+    // false for a full set or a rule that does not parse; '#' lines and blanks are ignored (true)
+    bool add(const char *text, size_t len) {
+        while (len && (text[len - 1] == '\r' || text[len - 1] == '\n')) len--;
+        if (len == 0 || text[0] == '#') return true;
+        if (count_ >= capacity_) return false;
+        if (!parseWpaRule(text, len, rules_[count_])) return false;
+        count_++;
+        return true;
+    }
+    bool add(const char *text) { return add(text, strlen(text)); }
+
+    // Common human password habits: case variants, a digit or two, years, and simple leetspeak
+    void addDefaults() {
+        static const char *const fixed[] = {
+            ":", "c", "u", "l", "C", "t", "$!", "c$!", "c$1", "$1$2$3", "c$1$2$3", "$1$2$3$4", "c$1$2$3$4",
+            "^1", "^3^2^1", "sa@", "se3", "si1", "so0", "ss$", "sa@se3si1so0", "csa@se3si1so0",
+        };
+        for (const char *rule : fixed) add(rule);
+        char rule[9];
+        for (int d = 0; d <= 9; ++d) {
+            rule[0] = '$';
+            rule[1] = '0' + d;
+            add(rule, 2);
+        }
+        for (int d = 0; d <= 99; ++d) {
+            rule[0] = '$';
+            rule[1] = '0' + d / 10;
+            rule[2] = '$';
+            rule[3] = '0' + d % 10;
+            add(rule, 4);
+        }
+        for (int year = 1970; year <= 2030; ++year) {
+            size_t n = 0;
+            rule[n++] = 'c';
+            for (int div = 1000; div; div /= 10) {
+                rule[n++] = '$';
+                rule[n++] = '0' + (year / div) % 10;
+            }
+            add(rule + 1, n - 1); // word + year
+            add(rule, n);         // Word + year
+        }
+    }
+
+    size_t count() const { return count_; }
+    const WpaRule &rule(size_t i) const { return rules_[i]; }
+
+private:
+    WpaRule *rules_ = nullptr;
+    size_t capacity_ = 0;
+    size_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "wpa_sha1_backend.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+
+#if SOC_SHA_SUPPORT_RESUME
+#include "sha/sha_core.h"
+#define WPA_SHA1_HARDWARE 1
+#endif
+
+namespace {
+const char *TAG = "wpa_sha1";
+const uint32_t BENCH_BLOCKS = 2000;
+
+void IRAM_ATTR compressFast(uint32_t state[5], const uint32_t block[16]) {
+    sha1CompressUnrolled(state, block);
+}
+
+const Sha1Backend SHA1_BACKEND_FAST = {"software", compressFast, nullptr, nullptr, true};
+
+#ifdef WPA_SHA1_HARDWARE
+// The peripheral takes message and digest as raw big-endian bytes, our words are host order
+void IRAM_ATTR compressHardware(uint32_t state[5], const uint32_t block[16]) {
+    uint32_t data[16];
+    uint32_t digest[5];
+    for (int i = 0; i < 16; ++i) data[i] = __builtin_bswap32(block[i]);
+    for (int i = 0; i < 5; ++i) digest[i] = __builtin_bswap32(state[i]);
+    esp_sha_write_digest_state(SHA1, digest);
+    esp_sha_block(SHA1, data, false);
+    esp_sha_read_digest_state(SHA1, digest);
+    for (int i = 0; i < 5; ++i) state[i] = __builtin_bswap32(digest[i]);
+}
+
+// Held for a whole PMK: 16k blocks, a few milliseconds, then mbedtls users get a turn
+void hardwareBegin() {
+    esp_sha_acquire_hardware();
+    esp_sha_set_mode(SHA1);
+}
+void hardwareEnd() { esp_sha_release_hardware(); }
+
+const Sha1Backend SHA1_BACKEND_HARDWARE = {"hardware", compressHardware, hardwareBegin, hardwareEnd, false};
+#endif
+
+const Sha1Backend *const BACKENDS[] = {
+    &SHA1_BACKEND_PORTABLE,
+    &SHA1_BACKEND_FAST,
+#ifdef WPA_SHA1_HARDWARE
+    &SHA1_BACKEND_HARDWARE,
+#endif
+};
+
+// Blocks per millisecond, 0 when the result differs from the reference chain
+uint32_t measure(const Sha1Backend &backend, const uint32_t expected[5]) {
+    uint32_t state[5];
+    uint32_t block[16];
+    sha1ChainStart(state, block);
+
+    if (backend.begin) backend.begin();
+    const int64_t start = esp_timer_get_time();
+    sha1ChainRun(backend.compress, state, block, 0, BENCH_BLOCKS);
+    const int64_t elapsed = esp_timer_get_time() - start;
+    if (backend.end) backend.end();
+
+    if (memcmp(state, expected, sizeof(state)) != 0) {
+        ESP_LOGW(TAG, "%s backend gives wrong digests, not used", backend.name);
+        return 0;
+    }
+    const uint32_t rate = elapsed > 0 ? (uint32_t)(BENCH_BLOCKS * 1000LL / elapsed) : BENCH_BLOCKS;
+    ESP_LOGI(TAG, "%s: %u blocks/ms", backend.name, rate);
+    return rate ? rate : 1;
+}
+
+void referenceChain(uint32_t state[5]) {
+    uint32_t block[16];
+    sha1ChainStart(state, block);
+    sha1ChainRun(sha1Compress, state, block, 0, BENCH_BLOCKS);
+}
+} // namespace
+
+const Sha1Selection &wpa_sha1_select() {
+    static Sha1Selection selection = {&SHA1_BACKEND_PORTABLE, &SHA1_BACKEND_PORTABLE, 0, 0};
+    static bool measured = false;
+    if (measured) return selection;
+
+    uint32_t expected[5];
+    referenceChain(expected);
+    for (const Sha1Backend *backend : BACKENDS) {
+        const uint32_t rate = measure(*backend, expected);
+        if (rate > selection.exclusiveRate) {
+            selection.exclusive = backend;
+            selection.exclusiveRate = rate;
+        }
+        if (backend->shared && rate > selection.sharedRate) {
+            selection.shared = backend;
+            selection.sharedRate = rate;
+        }
+    }
+    measured = true;
+    return selection;
+}
@@ -0,0 +1,34 @@
+#ifndef __WPA_SHA1_BACKEND_H__
+#define __WPA_SHA1_BACKEND_H__
+// SHA1 block functions available on this chip for WPA recovery. Besides the two software ones
+// from wpa_crypto.h, chips whose SHA peripheral can resume from a loaded digest get a hardware
+// backend. The peripheral is a single shared unit, so only one worker may use it at a time.
+#include "wpa_crypto.h"
+
+struct Sha1Selection {
+    const Sha1Backend *exclusive; // fastest for a worker that may hold the hardware
+    const Sha1Backend *shared;    // fastest that any number of workers can run at once
+    uint32_t exclusiveRate;       // blocks per millisecond measured for each pick
+    uint32_t sharedRate;
+};
+
+// The chain of blocks every backend is checked and timed on: each block feeds the digest so far
+// back into the next one. A chain can be continued from any block with a different function.
+inline void sha1ChainStart(uint32_t state[5], uint32_t block[16]) {
+    memcpy(state, SHA1_IV, 5 * sizeof(uint32_t));
+    for (int i = 0; i < 16; ++i) block[i] = 0x9E3779B9u * (i + 1);
+}
+
+inline void
+sha1ChainRun(Sha1CompressFn compress, uint32_t state[5], uint32_t block[16], uint32_t first, uint32_t count) {
+    for (uint32_t n = first; n < first + count; ++n) {
+        compress(state, block);
+        block[n & 15] ^= state[n % 5];
+    }
+}
+
+// Checks every backend against the portable one and times a short run of each. Backends that
+// give a wrong digest are never picked. Measured once, later calls return the cached result.
+const Sha1Selection &wpa_sha1_select();
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef __WPA_TARGETS_H__
+#define __WPA_TARGETS_H__
+// The set of handshakes and PMKIDs one recovery run works on. Targets are grouped by SSID:
+// the PMK only depends on passphrase and SSID, so a candidate costs one PBKDF2 per group and
+// then a couple of short HMACs per target in it. Groups drop out as soon as all their targets
+// are cracked. test() may run on several workers at once. Plain C++ so it can be built off-target.
+#include "wpa_checkpoint.h"
+#include "wpa_crypto.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t WPA_MAX_TARGETS = 16;
+
+struct WpaTarget {
+    enum State : uint8_t { OPEN = 0, CLAIMED = 1, CRACKED = 2 };
+
+    WpaHandshakeVector vector;
+    uint8_t ap[6];
+    uint8_t sta[6];
+    char ssid[33];
+    uint8_t ssidLen;
+    uint8_t group;
+    std::atomic<uint8_t> state{OPEN};
+    char password[64]; // valid once state is CRACKED
+};
+
+class WpaTargetSet {
+public:
+    void clear() {
+        count_ = 0;
+        groupCount_ = 0;
+        cracked_.store(0, std::memory_order_relaxed);
+    }
+
+    // Handshake from a capture. false when the set is full, the frame is unusable or a duplicate.
+    bool addEapol(
+        const uint8_t ap[6], const uint8_t sta[6], const uint8_t anonce[32], const uint8_t snonce[32],
+        const uint8_t *eapol, uint16_t eapolLen, const uint8_t mic[16], const char *ssid, size_t ssidLen
+    ) {
+        // Key descriptor version 2 (HMAC-SHA1 MIC) is the only one the check implements
+        if (eapolLen < 7 || (eapol[6] & 0x07) != 2) return false;
+        WpaTarget *t = newTarget(ap, sta, ssid, ssidLen);
+        if (!t || !t->vector.init(ap, sta, anonce, snonce, eapol, eapolLen, mic)) return false;
+        return commit(*t);
+    }
+
+    bool addPmkid(
+        const uint8_t ap[6], const uint8_t sta[6], const uint8_t pmkid[16], const char *ssid, size_t ssidLen
+    ) {
+        WpaTarget *t = newTarget(ap, sta, ssid, ssidLen);
+        if (!t) return false;
+        t->vector.initPmkid(ap, sta, pmkid);
+        return commit(*t);
+    }
+
+    // One hashcat 22000 line, WPA*01 (PMKID) or WPA*02 (EAPOL); trailing whitespace is ignored
+    bool addHc22000Line(const char *line) {
+        const char *field[9];
+        size_t len[9];
+        size_t n = 0;
+        const char *p = line;
+        while (n < 9) {
+            field[n] = p;
+            while (*p && *p != '*' && *p != '\r' && *p != '\n') p++;
+            len[n] = p - field[n];
+            n++;
+            if (*p != '*') break;
+            p++;
+        }
+        if (n < 6 || len[0] != 3 || memcmp(field[0], "WPA", 3) != 0 || len[1] != 2) return false;
+
+        uint8_t ap[6], sta[6], essid[32];
+        if (!unhex(field[3], len[3], ap, 6) || !unhex(field[4], len[4], sta, 6)) return false;
+        if (len[5] == 0 || len[5] > 64 || (len[5] & 1) || !unhex(field[5], len[5], essid, len[5] / 2)) {
+            return false;
+        }
+        const size_t ssidLen = len[5] / 2;
+
+        if (memcmp(field[1], "01", 2) == 0) {
+            uint8_t pmkid[16];
+            if (!unhex(field[2], len[2], pmkid, 16)) return false;
+            return addPmkid(ap, sta, pmkid, (const char *)essid, ssidLen);
+        }
+        if (memcmp(field[1], "02", 2) != 0 || n < 8) return false;
+        uint8_t mic[16], anonce[32], eapol[WpaHandshakeVector::MAX_EAPOL_LEN];
+        const size_t eapolLen = len[7] / 2;
+        if (!unhex(field[2], len[2], mic, 16) || !unhex(field[6], len[6], anonce, 32)) return false;
+        if (eapolLen < 81 + 16 || eapolLen > sizeof(eapol) || !unhex(field[7], len[7], eapol, eapolLen)) {
+            return false;
+        }
+        // The SNonce is the key nonce of the M2 carried in the line
+        return addEapol(ap, sta, anonce, eapol + 17, eapol, eapolLen, mic, (const char *)essid, ssidLen);
+    }
+
+    // Tests one candidate against every group with uncracked targets. Returns the number of
+    // targets it cracked, or -1 when *abort stopped the PBKDF2.
+    int test(
+        const char *word, size_t len, const volatile bool *abort = nullptr,
+        const Sha1Backend &backend = SHA1_BACKEND_PORTABLE
+    ) {
+        uint8_t pmk[32];
+        int hits = 0;
+        for (uint8_t g = 0; g < groupCount_; ++g) {
+            Group &group = groups_[g];
+            if (group.remaining.load(std::memory_order_relaxed) == 0) continue;
+            if (!wpaDerivePmk(word, len, (const uint8_t *)group.ssid, group.ssidLen, pmk, abort, backend)) {
+                return -1;
+            }
+            for (uint8_t i = 0; i < count_; ++i) {
+                WpaTarget &t = targets_[i];
+                if (t.group != g || t.state.load(std::memory_order_acquire) != WpaTarget::OPEN) continue;
+                if (!t.vector.pmkMatches(pmk)) continue;
+                uint8_t expected = WpaTarget::OPEN;
+                if (!t.state.compare_exchange_strong(expected, WpaTarget::CLAIMED)) continue;
+                memcpy(t.password, word, len);
+                t.password[len] = '\0';
+                t.state.store(WpaTarget::CRACKED, std::memory_order_release);
+                group.remaining.fetch_sub(1, std::memory_order_relaxed);
+                cracked_.fetch_add(1, std::memory_order_release);
+                hits++;
+            }
+        }
+        return hits;
+    }
+
+    uint8_t count() const { return count_; }
+    uint8_t groupCount() const { return groupCount_; }
+    uint8_t crackedCount() const { return cracked_.load(std::memory_order_acquire); }
+    bool allCracked() const { return count_ && crackedCount() == count_; }
+    const WpaTarget &target(uint8_t i) const { return targets_[i]; }
+    bool isCracked(uint8_t i) const {
+        return targets_[i].state.load(std::memory_order_acquire) == WpaTarget::CRACKED;
+    }
+
+    // Identifies the exact set of targets, for checkpoints
+    uint32_t fingerprint() const {
+        uint32_t h = fnv1a32(&count_, sizeof(count_));
+        for (uint8_t i = 0; i < count_; ++i) {
+            const WpaTarget &t = targets_[i];
+            h = fnv1a32(t.vector.prfData, t.vector.prfLen, h);
+            h = fnv1a32(t.vector.eapol, t.vector.eapolLen, h);
+            h = fnv1a32(t.vector.mic, sizeof(t.vector.mic), h);
+            h = fnv1a32(t.ssid, t.ssidLen, h);
+        }
+        return h;
+    }
+
+private:
+    struct Group {
+        char ssid[33];
+        uint8_t ssidLen;
+        std::atomic<uint8_t> remaining{0};
+    };
+
+    static bool unhex(const char *hex, size_t hexLen, uint8_t *out, size_t outLen) {
+        if (hexLen != outLen * 2) return false;
+        for (size_t i = 0; i < hexLen; ++i) {
+            const char c = hex[i];
+            uint8_t v;
+            if (c >= '0' && c <= '9') v = c - '0';
+            else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+            else return false;
+            if (i & 1) out[i / 2] |= v;
+            else out[i / 2] = v << 4;
+        }
+        return true;
+    }
+
+    // Fills the next free slot; it only becomes part of the set in commit()
+    WpaTarget *newTarget(const uint8_t ap[6], const uint8_t sta[6], const char *ssid, size_t ssidLen) {
+        if (count_ >= WPA_MAX_TARGETS || ssidLen == 0 || ssidLen > 32) return nullptr;
+        WpaTarget &t = targets_[count_];
+        memcpy(t.ap, ap, 6);
+        memcpy(t.sta, sta, 6);
+        memcpy(t.ssid, ssid, ssidLen);
+        t.ssid[ssidLen] = '\0';
+        t.ssidLen = ssidLen;
+        t.password[0] = '\0';
+        t.state.store(WpaTarget::OPEN, std::memory_order_relaxed);
+        return &t;
+    }
+
+    bool commit(WpaTarget &t) {
+        for (uint8_t i = 0; i < count_; ++i) {
+            const WpaTarget &other = targets_[i];
+            if (other.ssidLen == t.ssidLen && memcmp(other.ssid, t.ssid, t.ssidLen) == 0 &&
+                memcmp(other.vector.mic, t.vector.mic, 16) == 0 &&
+                other.vector.prfLen == t.vector.prfLen &&
+                memcmp(other.vector.prfData, t.vector.prfData, t.vector.prfLen) == 0) {
+                return false; // same handshake from another capture
+            }
+        }
+        uint8_t g = 0;
+        while (g < groupCount_ &&
+               (groups_[g].ssidLen != t.ssidLen || memcmp(groups_[g].ssid, t.ssid, t.ssidLen) != 0)) {
+            g++;
+        }
+        if (g == groupCount_) {
+            memcpy(groups_[g].ssid, t.ssid, t.ssidLen + 1);
+            groups_[g].ssidLen = t.ssidLen;
+            groups_[g].remaining.store(0, std::memory_order_relaxed);
+            groupCount_++;
+        }
+        t.group = g;
+        groups_[g].remaining.fetch_add(1, std::memory_order_relaxed);
+        count_++;
+        return true;
+    }
+
+    WpaTarget targets_[WPA_MAX_TARGETS];
+    Group groups_[WPA_MAX_TARGETS];
+    uint8_t count_ = 0;
+    uint8_t groupCount_ = 0;
+    std::atomic<uint8_t> cracked_{0};
+};
+
+#endif
@@ -0,0 +1,201 @@
+// Times the promiscuous callback of frame_bus.cpp with one to four subscribers (sniffer on every
+// class, karma on probe requests, pwngrid on beacons, one on data) against the callbacks it
+// replaced, where every module parsed each frame itself. Reports ns and deliveries per frame.
+//   bench_frame_bus [--frames N] [--check] [capture.pcap]
+// Frames come from the capture (802.11 or radiotap linktype, default data/frame_parser.pcap),
+// replayed until N went through. The esp_timer stand-in in host/ does not move, which leaves the
+// callback's own timing out. --check makes the bus delivering to exactly the subscribers whose
+// mask matches, and counting the frames too short to parse, a pass/fail.
+#include "host_test.h"
+#include "modules/wifi/frame_bus.h"
+#include <chrono>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Each packet as the WiFi driver hands it over: rx_ctrl, then the frame. Kept in uint32_t words
+// for the alignment of rx_ctrl.
+static std::vector<std::vector<uint32_t>> loadPackets(const char *path) {
+    std::vector<std::vector<uint32_t>> packets;
+    FILE *f = fopen(path, "rb");
+    if (!f) return packets;
+    uint8_t hdr[24], rec[16];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || get32(hdr) != 0xa1b2c3d4) {
+        fclose(f);
+        return packets;
+    }
+    const uint32_t linktype = get32(hdr + 20);
+    std::vector<uint8_t> frame;
+    while (fread(rec, 1, sizeof(rec), f) == sizeof(rec)) {
+        frame.resize(get32(rec + 8));
+        if (fread(frame.data(), 1, frame.size(), f) != frame.size()) break;
+        size_t skip = 0;
+        if (linktype == 127) skip = frame.size() >= 4 ? frame[2] | (frame[3] << 8) : frame.size();
+        else if (linktype != 105) break;
+        if (skip > frame.size() || frame.size() - skip > 2500) continue;
+        const size_t len = frame.size() - skip;
+        std::vector<uint32_t> packet((sizeof(wifi_promiscuous_pkt_t) + len + 3) / 4);
+        wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)packet.data();
+        pkt->rx_ctrl.rssi = -50;
+        pkt->rx_ctrl.channel = 6;
+        pkt->rx_ctrl.sig_len = len;
+        memcpy(pkt->payload, frame.data() + skip, len);
+        packets.push_back(packet);
+    }
+    fclose(f);
+    return packets;
+}
+
+struct Consumer {
+    const char *name;
+    uint16_t mask;
+};
+
+static const Consumer CONSUMERS[FRAME_BUS_MAX_SUBSCRIBERS] = {
+    {"sniffer", WIFI_FRAME_ALL},
+    {"karma", WIFI_FRAME_PROBE_REQ},
+    {"pwngrid", WIFI_FRAME_BEACON},
+    {"data", WIFI_FRAME_DATA},
+};
+
+static uint64_t handled[FRAME_BUS_MAX_SUBSCRIBERS];
+static volatile uint64_t work = 0;
+
+// What a subscriber does with a frame, cheap enough that the dispatch itself shows
+template <int K>
+static void
+handler(const WifiFrameDesc &frame, const wifi_promiscuous_pkt_t *, wifi_promiscuous_pkt_type_t) {
+    handled[K]++;
+    work = work + frame.len + frame.ssidLen + (frame.apAddr ? frame.apAddr[5] : 0);
+}
+
+static const WifiFrameHandler HANDLERS[FRAME_BUS_MAX_SUBSCRIBERS] = {
+    handler<0>,
+    handler<1>,
+    handler<2>,
+    handler<3>,
+};
+
+static wifi_promiscuous_pkt_type_t pktType(const wifi_promiscuous_pkt_t *pkt) {
+    const uint8_t type = pkt->rx_ctrl.sig_len ? (pkt->payload[0] & 0x0C) >> 2 : 3;
+    return type == 0 ? WIFI_PKT_MGMT : type == 1 ? WIFI_PKT_CTRL : type == 2 ? WIFI_PKT_DATA : WIFI_PKT_MISC;
+}
+
+struct RunResult {
+    double nsPerFrame = 0;
+    uint64_t handled[FRAME_BUS_MAX_SUBSCRIBERS] = {};
+    FrameBusStats stats;
+};
+
+// The bus: one parse, fanned out to the subscribers
+static RunResult
+runBus(const std::vector<std::vector<uint32_t>> &packets, size_t frames, int subscribers) {
+    frame_bus_clear();
+    for (int k = 0; k < subscribers; ++k) frame_bus_subscribe(HANDLERS[k], CONSUMERS[k].mask);
+    frame_bus_reset_stats();
+    memset(handled, 0, sizeof(handled));
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < frames; ++n) {
+        void *buf = (void *)packets[n % packets.size()].data();
+        frame_bus_rx_cb(buf, pktType((const wifi_promiscuous_pkt_t *)buf));
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    RunResult r;
+    r.nsPerFrame = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)frames;
+    memcpy(r.handled, handled, sizeof(handled));
+    r.stats = frame_bus_get_stats();
+    frame_bus_clear();
+    return r;
+}
+
+// Before the bus: every module had its own callback and parsed the frame again
+static RunResult
+runPerModule(const std::vector<std::vector<uint32_t>> &packets, size_t frames, int subscribers) {
+    memset(handled, 0, sizeof(handled));
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < frames; ++n) {
+        const auto *pkt = (const wifi_promiscuous_pkt_t *)packets[n % packets.size()].data();
+        const wifi_promiscuous_pkt_type_t type = pktType(pkt);
+        for (int k = 0; k < subscribers; ++k) {
+            WifiFrameDesc frame;
+            const uint16_t len = pkt->rx_ctrl.sig_len;
+            if (!parseWifiFrame(pkt->payload, len, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel, frame)) continue;
+            if (frame.classes & CONSUMERS[k].mask) HANDLERS[k](frame, pkt, type);
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    RunResult r;
+    r.nsPerFrame = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)frames;
+    memcpy(r.handled, handled, sizeof(handled));
+    return r;
+}
+
+int main(int argc, char **argv) {
+    size_t frames = 1000000;
+    bool check = false;
+    const char *path = BRUCE_TEST_DATA "/frame_parser.pcap";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) frames = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--check") check = true;
+        else if (arg[0] != '-') path = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--check] [capture.pcap]\n", argv[0]);
+            return 2;
+        }
+    }
+    const std::vector<std::vector<uint32_t>> packets = loadPackets(path);
+    if (packets.empty()) {
+        fprintf(stderr, "%s: no frames in a little-endian 802.11 pcap\n", path);
+        return 1;
+    }
+    if (frames < 1) frames = 1;
+
+    // what each consumer should get, from the parser alone
+    uint64_t expected[FRAME_BUS_MAX_SUBSCRIBERS] = {};
+    uint64_t malformed = 0;
+    for (size_t n = 0; n < frames; ++n) {
+        const auto *pkt = (const wifi_promiscuous_pkt_t *)packets[n % packets.size()].data();
+        WifiFrameDesc frame;
+        if (!parseWifiFrame(pkt->payload, pkt->rx_ctrl.sig_len, 0, 0, frame)) {
+            malformed++;
+            continue;
+        }
+        for (int k = 0; k < FRAME_BUS_MAX_SUBSCRIBERS; ++k) {
+            expected[k] += (frame.classes & CONSUMERS[k].mask) != 0;
+        }
+    }
+
+    printf("%s: %zu frames, %zu replayed\n", path, packets.size(), frames);
+    const RunResult idle = runBus(packets, frames, 0);
+    printf("no subscribers\n  bus           %.1f ns/frame\n", idle.nsPerFrame);
+    if (check) {
+        CHECK_EQ(idle.stats.frames, frames);
+        CHECK_EQ(idle.stats.delivered, 0);
+    }
+    for (int subscribers = 1; subscribers <= FRAME_BUS_MAX_SUBSCRIBERS; ++subscribers) {
+        const RunResult bus = runBus(packets, frames, subscribers);
+        const RunResult old = runPerModule(packets, frames, subscribers);
+        printf("%d subscriber(s), up to %s\n", subscribers, CONSUMERS[subscribers - 1].name);
+        printf(
+            "  bus           %.1f ns/frame, %.2f deliveries/frame\n",
+            bus.nsPerFrame,
+            (double)bus.stats.delivered / frames
+        );
+        printf("  per module    %.1f ns/frame\n", old.nsPerFrame);
+        if (!check) continue;
+        uint64_t delivered = 0;
+        for (int k = 0; k < subscribers; ++k) {
+            CHECK_EQ(bus.handled[k], expected[k]);
+            CHECK_EQ(old.handled[k], expected[k]);
+            delivered += expected[k];
+        }
+        for (int k = subscribers; k < FRAME_BUS_MAX_SUBSCRIBERS; ++k) CHECK_EQ(bus.handled[k], 0);
+        CHECK_EQ(bus.stats.frames, frames);
+        CHECK_EQ(bus.stats.malformed, malformed);
+        CHECK_EQ(bus.stats.delivered, delivered);
+    }
+    return check ? hostTestResult("bench_frame_bus") : 0;
+}
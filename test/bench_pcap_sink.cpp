@@ -0,0 +1,237 @@
+// Writes the same frames as classic pcap three ways and reports MB/s, frames/s and the file calls
+// each one makes: the old handshake path (for every frame: open for append, a write per record
+// header field and one for the frame, close), the old raw capture path (the same writes on a file
+// kept open, a flush every second) and PcapSink.
+//   bench_pcap_sink [--frames N] [--buffer BYTES] [--dir DIR] [--check]
+// Files are unbuffered so that every write() is a call into the filesystem, as on fs::File.
+// --check makes the three files coming out byte for byte the same a pass/fail.
+#include "host_test.h"
+#include "modules/wifi/pcap_sink.h"
+#include <chrono>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+struct FileCalls {
+    uint64_t opens = 0;
+    uint64_t writes = 0;
+    uint64_t flushes = 0;
+};
+
+// fs::File stand-in on an unbuffered stdio file, counting the calls
+struct CountingFile {
+    FILE *f = nullptr;
+    FileCalls *calls = nullptr;
+
+    static CountingFile open(const std::string &path, const char *mode, FileCalls &calls) {
+        CountingFile file;
+        file.f = fopen(path.c_str(), mode);
+        file.calls = &calls;
+        if (file.f) setvbuf(file.f, nullptr, _IONBF, 0);
+        calls.opens++;
+        return file;
+    }
+    size_t write(const uint8_t *buf, size_t len) {
+        calls->writes++;
+        return fwrite(buf, 1, len, f);
+    }
+    void flush() {
+        calls->flushes++;
+        fflush(f);
+    }
+    void close() { fclose(f); }
+    explicit operator bool() const { return f != nullptr; }
+};
+
+struct Frame {
+    uint64_t tsUsec;
+    std::vector<uint8_t> bytes;
+};
+
+// Sizes like a busy channel: mostly small management and control frames, some full data frames
+static std::vector<Frame> makeFrames(size_t count) {
+    std::mt19937 rng(11);
+    std::vector<Frame> frames(count);
+    uint64_t ts = 1700000000ull * 1000000;
+    for (Frame &f : frames) {
+        ts += 100 + rng() % 400;
+        const uint32_t roll = rng() % 100;
+        const size_t len = roll < 40 ? 24 + rng() % 16 : roll < 70 ? 100 + rng() % 200 : 200 + rng() % 1300;
+        f.tsUsec = ts;
+        f.bytes.resize(len);
+        for (uint8_t &b : f.bytes) b = rng();
+    }
+    return frames;
+}
+
+static uint32_t nowMsOf(const Frame &f) { return (uint32_t)(f.tsUsec / 1000); }
+
+// writeHeader() as it was: one write per field
+static void writeHeaderFields(CountingFile &file) {
+    const uint32_t magic = 0xa1b2c3d4, zone = 0, sigfigs = 0, snaplen = 2500, network = 105;
+    const uint16_t major = 2, minor = 4;
+    file.write((const uint8_t *)&magic, 4);
+    file.write((const uint8_t *)&major, 2);
+    file.write((const uint8_t *)&minor, 2);
+    file.write((const uint8_t *)&zone, 4);
+    file.write((const uint8_t *)&sigfigs, 4);
+    file.write((const uint8_t *)&snaplen, 4);
+    file.write((const uint8_t *)&network, 4);
+}
+
+// The old saveHandshake(): the file opened, the record written field by field, closed
+static bool writeOpenPerFrame(const std::vector<Frame> &frames, const std::string &path, FileCalls &calls) {
+    remove(path.c_str());
+    bool exists = false;
+    for (const Frame &f : frames) {
+        CountingFile file = CountingFile::open(path, exists ? "ab" : "wb", calls);
+        if (!file) return false;
+        if (!exists) writeHeaderFields(file);
+        exists = true;
+        const uint32_t sec = f.tsUsec / 1000000, usec = f.tsUsec % 1000000, len = f.bytes.size();
+        file.write((const uint8_t *)&sec, 4);
+        file.write((const uint8_t *)&usec, 4);
+        file.write((const uint8_t *)&len, 4);
+        file.write((const uint8_t *)&len, 4);
+        file.write(f.bytes.data(), len);
+        file.close();
+    }
+    return true;
+}
+
+// The old raw capture: newPacketSD() as it was per frame and the UI loop's flush once a second
+static bool writePerFrame(const std::vector<Frame> &frames, const std::string &path, FileCalls &calls) {
+    CountingFile file = CountingFile::open(path, "wb", calls);
+    if (!file) return false;
+    writeHeaderFields(file);
+    uint32_t lastFlushMs = frames.empty() ? 0 : nowMsOf(frames[0]);
+    for (const Frame &f : frames) {
+        const uint32_t sec = f.tsUsec / 1000000, usec = f.tsUsec % 1000000, len = f.bytes.size();
+        file.write((const uint8_t *)&sec, 4);
+        file.write((const uint8_t *)&usec, 4);
+        file.write((const uint8_t *)&len, 4);
+        file.write((const uint8_t *)&len, 4);
+        file.write(f.bytes.data(), len);
+        if (nowMsOf(f) - lastFlushMs > 1000) {
+            file.flush();
+            lastFlushMs = nowMsOf(f);
+        }
+    }
+    file.flush();
+    file.close();
+    return true;
+}
+
+static bool writeSink(
+    const std::vector<Frame> &frames,
+    const std::string &path,
+    FileCalls &calls,
+    std::vector<uint8_t> &buffer
+) {
+    PcapSink<CountingFile> sink;
+    sink.setBuffer(buffer.data(), buffer.size());
+    const uint32_t startMs = frames.empty() ? 0 : nowMsOf(frames[0]);
+    if (!sink.attach(CountingFile::open(path, "wb", calls), startMs, true)) return false;
+    bool ok = true;
+    for (const Frame &f : frames) {
+        const uint32_t len = f.bytes.size();
+        ok = sink.append(f.tsUsec / 1000000, f.tsUsec % 1000000, f.bytes.data(), len, len, nowMsOf(f)) && ok;
+        ok = sink.poll(nowMsOf(f)) && ok;
+    }
+    sink.close();
+    return ok && sink.stats().failed == 0;
+}
+
+static std::vector<uint8_t> readFile(const std::string &path) {
+    std::vector<uint8_t> out;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return out;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return out;
+}
+
+int main(int argc, char **argv) {
+    size_t count = 20000;
+    size_t bufferBytes = 16384;
+    const char *dir = ".";
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) count = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--buffer" && i + 1 < argc) bufferBytes = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--dir" && i + 1 < argc) dir = argv[++i];
+        else if (arg == "--check") check = true;
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--buffer BYTES] [--dir DIR] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    const std::vector<Frame> frames = makeFrames(count < 1 ? 1 : count);
+    std::vector<uint8_t> buffer(bufferBytes);
+    const std::string base = std::string(dir) + "/bench_pcap_sink";
+
+    struct Path {
+        const char *name;
+        std::string file;
+        FileCalls calls;
+        bool ok;
+        double seconds;
+    };
+    Path paths[3] = {
+        {"open per frame", base + "_open.pcap", {}, false, 0},
+        {"write per frame", base + "_write.pcap", {}, false, 0},
+        {"PcapSink", base + "_sink.pcap", {}, false, 0},
+    };
+    for (int p = 0; p < 3; ++p) {
+        Path &path = paths[p];
+        const auto start = std::chrono::steady_clock::now();
+        if (p == 0) path.ok = writeOpenPerFrame(frames, path.file, path.calls);
+        else if (p == 1) path.ok = writePerFrame(frames, path.file, path.calls);
+        else path.ok = writeSink(frames, path.file, path.calls, buffer);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        path.seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e9;
+    }
+
+    const std::vector<uint8_t> expected = readFile(paths[2].file);
+    printf(
+        "%zu frames, %zu bytes of pcap, %zu byte sink buffer\n", frames.size(), expected.size(), bufferBytes
+    );
+    for (const Path &path : paths) {
+        if (!path.ok) {
+            fprintf(stderr, "%s: cannot write %s\n", path.name, path.file.c_str());
+            return 1;
+        }
+        const double s = path.seconds > 0 ? path.seconds : 1e-9;
+        printf("%s\n", path.name);
+        printf("  throughput    %.1f MB/s, %.0f frames/s\n", expected.size() / s / 1e6, frames.size() / s);
+        printf(
+            "  file calls    %llu opens, %llu writes (%.2f per frame), %llu flushes\n",
+            (unsigned long long)path.calls.opens,
+            (unsigned long long)path.calls.writes,
+            (double)path.calls.writes / frames.size(),
+            (unsigned long long)path.calls.flushes
+        );
+    }
+    if (!check) return 0;
+    for (int p = 0; p < 2; ++p) {
+        if (readFile(paths[p].file) != expected) {
+            fprintf(stderr, "%s: the file differs from PcapSink's\n", paths[p].name);
+            CHECK(false);
+        }
+    }
+    size_t payload = 0;
+    for (const Frame &f : frames) payload += f.bytes.size();
+    CHECK_EQ(expected.size(), 24 + 16 * frames.size() + payload);
+    CHECK_EQ(paths[2].calls.opens, 1);
+    // a full buffer goes out with less than one record of room left, plus one write per sync
+    const size_t largest = 16 + 1500;
+    if (bufferBytes > 2 * largest) {
+        const FileCalls &sink = paths[2].calls;
+        CHECK(sink.writes <= expected.size() / (bufferBytes - largest) + sink.flushes + 1);
+    }
+    return hostTestResult("bench_pcap_sink");
+}
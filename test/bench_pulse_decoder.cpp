@@ -0,0 +1,170 @@
+// Runs PulseDecoder over the RAW captures listed in data/rf_raw/expected.txt: four of every protocol
+// in the table (8 or 18% jitter, one to five repeats, the remote's clock off nominal, glitches and
+// noise around them), noise alone, and the RAW files of data/sub. Reports how many captures have
+// their key as the top candidate or anywhere in the list, noise reaching the confidence rf_scan
+// shows, and decodes/s.
+//   bench_pulse_decoder [--rounds N] [--check] [expected.txt]
+// The files are read with SubCompiler, the RAW_Data lines of a file joined into one capture.
+// --check makes the hit counts this was written with, and no noise at 50% or more, a pass/fail.
+#include "host_test.h"
+#include "modules/rf/protocols/pulse_decoder.h"
+#include "modules/rf/sub_compiler.h"
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct Capture {
+    std::string file;
+    std::string protocol; // empty for noise
+    uint64_t key = 0;
+    uint8_t bits = 0;
+    std::vector<int32_t> durations;
+};
+
+struct StdioSource {
+    FILE *f;
+    size_t read(uint8_t *buf, size_t len) { return fread(buf, 1, len, f); }
+};
+
+static bool loadDurations(const std::string &path, std::vector<int32_t> &out) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    StdioSource source = {f};
+    CompiledSub sub;
+    compileSub(source, sub);
+    fclose(f);
+    for (const SubDataLine &line : sub.lines) {
+        if (line.kind != SUB_DATA_TIMINGS) continue;
+        out.insert(out.end(), sub.lineTimings(line), sub.lineTimings(line) + line.count);
+    }
+    return !out.empty();
+}
+
+// "<file> <bits> <key hex> <protocol name>", the files relative to the list
+static bool loadCorpus(const char *list, std::vector<Capture> &corpus) {
+    FILE *f = fopen(list, "r");
+    if (!f) return false;
+    const char *slash = strrchr(list, '/');
+    const std::string dir = slash ? std::string(list, slash - list + 1) : "";
+    char line[256];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        line[strcspn(line, "\r\n")] = '\0';
+        char file[128];
+        unsigned bits = 0;
+        unsigned long long key = 0;
+        int used = 0;
+        if (sscanf(line, "%127s %u %llx %n", file, &bits, &key, &used) < 3) {
+            fprintf(stderr, "%s: bad line \"%s\"\n", list, line);
+            ok = false;
+            break;
+        }
+        Capture c;
+        c.file = file;
+        c.bits = bits;
+        c.key = key;
+        if (bits) c.protocol = line + used;
+        ok = loadDurations(dir + file, c.durations);
+        if (!ok) fprintf(stderr, "%s: no RAW_Data in %s\n", list, (dir + file).c_str());
+        corpus.push_back(c);
+    }
+    fclose(f);
+    return ok && !corpus.empty();
+}
+
+static bool isCandidate(const PulseCandidate &c, const Capture &capture) {
+    return capture.protocol == c.protocol->name && c.key == capture.key && c.bits == capture.bits;
+}
+
+int main(int argc, char **argv) {
+    int rounds = 50;
+    bool check = false;
+    const char *list = BRUCE_TEST_DATA "/rf_raw/expected.txt";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--rounds" && i + 1 < argc) rounds = atoi(argv[++i]);
+        else if (arg == "--check") check = true;
+        else if (arg[0] != '-') list = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [--rounds N] [--check] [expected.txt]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rounds < 1) rounds = 1;
+    std::vector<Capture> corpus;
+    if (!loadCorpus(list, corpus)) return 1;
+
+    PulseDecoder dec;
+    PulseCandidate out[8];
+    size_t signals = 0, top = 0, listed = 0, noise = 0, noiseShown = 0, durations = 0;
+    for (const Capture &c : corpus) {
+        durations += c.durations.size();
+        const size_t n = dec.decode(c.durations.data(), c.durations.size(), out, 8);
+        if (c.protocol.empty()) {
+            noise++;
+            for (size_t k = 0; k < n; k++) {
+                if (out[k].confidence < 50) continue;
+                fprintf(
+                    stderr,
+                    "%s: noise decoded as %s at %u%%\n",
+                    c.file.c_str(),
+                    out[k].protocol->name,
+                    out[k].confidence
+                );
+                noiseShown++;
+                break;
+            }
+            continue;
+        }
+        signals++;
+        bool found = false;
+        for (size_t k = 0; k < n && !found; k++) found = isCandidate(out[k], c);
+        listed += found;
+        if (n > 0 && isCandidate(out[0], c)) {
+            top++;
+            continue;
+        }
+        printf(
+            "  miss %-28s %-12s top %s%s\n",
+            c.file.c_str(),
+            c.protocol.c_str(),
+            n ? out[0].protocol->name : "none",
+            found ? ", listed" : ""
+        );
+    }
+
+    size_t candidates = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const Capture &c : corpus) {
+            candidates += dec.decode(c.durations.data(), c.durations.size(), out, 8);
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    double s = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e9;
+    if (s <= 0) s = 1e-9;
+
+    printf(
+        "%zu captures (%zu signals, %zu noise), %zu durations\n", corpus.size(), signals, noise, durations
+    );
+    printf("  top candidate %zu/%zu, listed %zu/%zu\n", top, signals, listed, signals);
+    printf("  noise >= 50%%  %zu/%zu\n", noiseShown, noise);
+    printf(
+        "  throughput    %.0f decodes/s, %.1f M durations/s, %.2f candidates/decode\n",
+        rounds * corpus.size() / s,
+        rounds * durations / s / 1e6,
+        (double)candidates / (rounds * corpus.size())
+    );
+    if (!check) return 0;
+    CHECK_EQ(signals, 41);
+    CHECK_EQ(noise, 5);
+    // 39 and 41 when this was written: Princeton at a te of 420 and 560 us comes out as Linear,
+    // which has the same shape, with Princeton listed behind it
+    CHECK(top >= 39);
+    CHECK_EQ(listed, signals);
+    CHECK_EQ(noiseShown, 0);
+    return hostTestResult("bench_pulse_decoder");
+}
@@ -0,0 +1,225 @@
+// Sends the RAW_Data of a .sub file two ways and reports the time and the peak memory of each: the
+// old path (txSubFile() reading every line into a String and keeping the RAW_Data values in a list,
+// sendRfCommand() taking copies of the value and splitting it with indexOf/substring/toInt into a
+// calloc'd array) and RawTxStream (512 byte reads into the 2048 duration ring rf_send.cpp uses).
+//   bench_raw_stream [--values N] [--rounds N] [--check]
+// The file holds one RAW_Data line of N values (default 512, 4096 and 32768 in turn) and a short
+// one. Strings are std::string with a counting allocator, so the old path's peak is every
+// String, list and array it holds at once; RawTxStream's is the ring plus the chunk it reads into.
+// --check makes both paths sending the same durations, and the stream's peak staying the same for
+// every line length, a pass/fail.
+#include "host_test.h"
+#include "modules/rf/raw_stream.h"
+#include <chrono>
+#include <new>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static const size_t RAW_TX_RING = 2048; // rf_send.cpp
+
+struct HeapMeter {
+    size_t now = 0;
+    size_t peak = 0;
+
+    void add(size_t n) {
+        now += n;
+        if (now > peak) peak = now;
+    }
+    void sub(size_t n) { now -= n; }
+};
+
+static HeapMeter heap;
+
+template <typename T> struct Counted {
+    typedef T value_type;
+    Counted() = default;
+    template <typename U> Counted(const Counted<U> &) {}
+    T *allocate(size_t n) {
+        heap.add(n * sizeof(T));
+        return (T *)malloc(n * sizeof(T));
+    }
+    void deallocate(T *p, size_t n) {
+        heap.sub(n * sizeof(T));
+        free(p);
+    }
+    template <typename U> bool operator==(const Counted<U> &) const { return true; }
+    template <typename U> bool operator!=(const Counted<U> &) const { return false; }
+};
+
+// Arduino String stand-in
+typedef std::basic_string<char, std::char_traits<char>, Counted<char>> String;
+
+struct MemFile {
+    const std::string *data;
+    size_t pos = 0;
+
+    // Stream::timedRead(), what readStringUntil() calls per byte
+    int read() { return pos < data->size() ? (uint8_t)(*data)[pos++] : -1; }
+    size_t read(uint8_t *buf, size_t len) {
+        const size_t n = data->size() - pos < len ? data->size() - pos : len;
+        memcpy(buf, data->data() + pos, n);
+        pos += n;
+        return n;
+    }
+    bool available() const { return pos < data->size(); }
+};
+
+static std::string makeFile(size_t values) {
+    std::mt19937 rng((uint32_t)values);
+    std::string text = "Filetype: Flipper SubGhz RAW File\nVersion: 1\nFrequency: 433920000\n"
+                       "Preset: FuriHalSubGhzPresetOok650Async\nProtocol: RAW\nRAW_Data:";
+    for (size_t i = 0; i < values; ++i) {
+        const int d = 200 + rng() % 1800;
+        text += " " + std::to_string(i % 2 ? -d : d);
+    }
+    text += "\nRAW_Data: 350 -1050 350 -10850\n";
+    return text;
+}
+
+static String readStringUntil(MemFile &f, char terminator) {
+    String ret;
+    for (int c = f.read(); c >= 0 && c != terminator; c = f.read()) ret += (char)c;
+    ret.shrink_to_fit(); // String grows to the exact length, std::string by doubling
+    return ret;
+}
+
+static bool isBlank(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+// String::trim(), in place
+static void trim(String &s) {
+    size_t start = 0, end = s.size();
+    while (start < end && isBlank(s[start])) start++;
+    while (end > start && isBlank(s[end - 1])) end--;
+    s.erase(end);
+    s.erase(0, start);
+}
+
+// String::toInt(): atol() with a 32-bit long
+static int32_t toInt(const String &s) {
+    const long long v = strtoll(s.c_str(), nullptr, 10);
+    return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+}
+
+struct RfCodes {
+    String protocol;
+    String data;
+};
+
+// sendRfCommand(), rfcode by value as it was, for protocol RAW
+static void sendRfCommand(RfCodes rfcode, std::vector<int32_t> &sent) {
+    String data = rfcode.data;
+    int buffSize = 0;
+    for (int index = 0; index >= 0; buffSize++) {
+        const size_t at = data.find(' ', index + 1);
+        index = at == String::npos ? -1 : (int)at;
+    }
+    int *timings = (int *)calloc(sizeof(int), buffSize + 1);
+    heap.add(sizeof(int) * (buffSize + 1));
+    size_t start = 0;
+    for (int i = 0; i < buffSize; ++i) {
+        const size_t index = data.find(' ', start);
+        if (index == String::npos) timings[i] = toInt(data.substr(start));
+        else timings[i] = toInt(data.substr(start, index - start));
+        start = index + 1;
+    }
+    // RCSwitch_RAW_send() stops at the first 0
+    for (int i = 0; timings[i] != 0; ++i) sent.push_back(timings[i]);
+    sent.push_back(RAW_STREAM_LINE_END);
+    heap.sub(sizeof(int) * (buffSize + 1));
+    free(timings);
+}
+
+// txSubFile(): line and txt live for the whole read, every RAW_Data value is kept in a list
+static void sendWithStrings(const std::string &text, std::vector<int32_t> &sent) {
+    MemFile file = {&text};
+    RfCodes selected;
+    String line, txt;
+    std::vector<String, Counted<String>> rawDataList;
+    while (file.available()) {
+        line = readStringUntil(file, '\n');
+        txt = line.substr(line.find(':') == String::npos ? 0 : line.find(':') + 1);
+        if (!txt.empty() && txt.back() == '\r') txt.pop_back();
+        trim(txt);
+        if (line.compare(0, 9, "Protocol:") == 0) selected.protocol = txt;
+        if (line.compare(0, 9, "RAW_Data:") == 0) rawDataList.push_back(txt);
+    }
+    for (String rawData : rawDataList) {
+        selected.data = rawData;
+        sendRfCommand(selected, sent);
+    }
+}
+
+// txRawStream() with the reader and the transmit loop taking turns on one thread
+static void sendStreamed(const std::string &text, std::vector<int32_t> &sent) {
+    MemFile file = {&text};
+    Counted<RawTxStream<RAW_TX_RING>> alloc;
+    RawTxStream<RAW_TX_RING> *stream = new (alloc.allocate(1)) RawTxStream<RAW_TX_RING>();
+    heap.add(RAW_STREAM_CHUNK); // pump()'s read buffer, on the reader task's stack
+    int32_t v;
+    while (!stream->done() || stream->pending() > 0) {
+        stream->pump(file);
+        while (stream->pop(v)) sent.push_back(v);
+    }
+    heap.sub(RAW_STREAM_CHUNK);
+    stream->~RawTxStream<RAW_TX_RING>();
+    alloc.deallocate(stream, 1);
+}
+
+struct RunResult {
+    double us = 0;
+    size_t peak = 0;
+    std::vector<int32_t> sent;
+};
+
+template <typename SendFn> static RunResult run(const std::string &text, int rounds, SendFn send) {
+    RunResult r;
+    double total = 0;
+    for (int i = 0; i < rounds; ++i) {
+        r.sent.clear();
+        r.sent.reserve(text.size() / 2);
+        heap = HeapMeter();
+        const auto start = std::chrono::steady_clock::now();
+        send(text, r.sent);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        total += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e3;
+        if (heap.peak > r.peak) r.peak = heap.peak;
+    }
+    r.us = total / rounds;
+    return r;
+}
+
+int main(int argc, char **argv) {
+    std::vector<size_t> sizes = {512, 4096, 32768};
+    int rounds = 20;
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--values" && i + 1 < argc) sizes = {strtoul(argv[++i], nullptr, 10)};
+        else if (arg == "--rounds" && i + 1 < argc) rounds = atoi(argv[++i]);
+        else if (arg == "--check") check = true;
+        else {
+            fprintf(stderr, "usage: %s [--values N] [--rounds N] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rounds < 1) rounds = 1;
+
+    size_t streamPeak = 0;
+    for (size_t values : sizes) {
+        const std::string text = makeFile(values);
+        const RunResult old = run(text, rounds, sendWithStrings);
+        const RunResult streamed = run(text, rounds, sendStreamed);
+        printf("RAW_Data line of %zu values, %zu byte file\n", values, text.size());
+        printf("  String/calloc  %10.1f us %10zu bytes peak\n", old.us, old.peak);
+        printf("  RawTxStream    %10.1f us %10zu bytes peak\n", streamed.us, streamed.peak);
+        if (!check) continue;
+        CHECK_EQ(old.sent.size(), values + 1 + 4 + 1);
+        CHECK(streamed.sent == old.sent);
+        CHECK(streamed.peak < old.peak);
+        if (streamPeak) CHECK_EQ(streamed.peak, streamPeak);
+        streamPeak = streamed.peak;
+    }
+    return check ? hostTestResult("bench_raw_stream") : 0;
+}
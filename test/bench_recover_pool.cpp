@@ -0,0 +1,304 @@
+// The WPA recovery worker pool of wifi_recover.cpp on threads: the feeding loop fills batches from
+// a wordlist, hands their index to the least loaded worker through its todo ring and takes them
+// back from the done rings into the checkpoint frontier; each worker expands its batches (rules
+// or not) and tests every candidate. Reports batches and candidates per second.
+//   bench_recover_pool [--words N] [--workers N] [--blocks N] [--check]
+// --blocks is the SHA1 compressions a candidate costs (a real one is ~16k, 0 measures the pool
+// alone). Runs the wordlist as is, then with the default rules. --check makes every candidate
+// tested exactly once and the frontier at the end of the wordlist a pass/fail.
+#include "host_test.h"
+#include "modules/wifi/packet_slab.h"
+#include "modules/wifi/wpa_candidates.h"
+#include "modules/wifi/wpa_checkpoint.h"
+#include "modules/wifi/wpa_crypto.h"
+#include "modules/wifi/wpa_rules.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const uint8_t BATCHES_PER_WORKER = 3; // RECOVER_BATCHES_PER_WORKER
+static const int MAX_WORKERS = RecoverFrontier::MAX_IN_FLIGHT / BATCHES_PER_WORKER;
+
+struct MemFile {
+    const std::string *data;
+    size_t pos = 0;
+
+    int read(uint8_t *buf, size_t len) {
+        const size_t n = data->size() - pos < len ? data->size() - pos : len;
+        memcpy(buf, data->data() + pos, n);
+        pos += n;
+        return n;
+    }
+    bool seek(uint32_t p) {
+        if (p > data->size()) return false;
+        pos = p;
+        return true;
+    }
+};
+
+struct Worker {
+    std::thread thread;
+    SpscRing<uint8_t, 4> todo; // feeder -> worker
+    SpscRing<uint8_t, 4> done; // worker -> feeder
+    // written by the worker only, read after join()
+    uint64_t tested = 0;
+    uint64_t signature = 0; // sum of testCandidate() over the candidates tested
+    uint64_t idlePolls = 0; // todo was empty
+    uint64_t donePushWaits = 0;
+};
+
+struct Pool {
+    std::vector<CandidateBatch> batches;
+    const WpaRuleSet *rules = nullptr;
+    int blocks = 0;
+    std::atomic<bool> stop{false};
+};
+
+// Stands in for PBKDF2 and the MIC check: `blocks` compressions seeded by the candidate
+static uint32_t testCandidate(const char *word, uint8_t len, int blocks) {
+    const uint32_t h = fnv1a32(word, len);
+    if (blocks == 0) return h;
+    uint32_t state[5], block[16] = {h};
+    memcpy(state, SHA1_IV, sizeof(state));
+    for (int i = 0; i < blocks; ++i) sha1Compress(state, block);
+    return h ^ state[0];
+}
+
+// recover_worker_task() with the FreeRTOS waits replaced by yields
+static void workerLoop(Pool &pool, Worker &w) {
+    char candidate[WPA_PASSPHRASE_MAX + 1];
+    uint8_t candidateLen;
+    uint8_t idx;
+    while (!pool.stop.load(std::memory_order_acquire)) {
+        if (!w.todo.pop(idx)) {
+            w.idlePolls++;
+            std::this_thread::yield();
+            continue;
+        }
+        CandidateBatch &batch = pool.batches[idx];
+        batch.tested = 0;
+        for (uint8_t i = 0; i < batch.count; ++i) {
+            if (!pool.rules) {
+                w.signature += testCandidate(batch.words[i], batch.lens[i], pool.blocks);
+                batch.tested++;
+                continue;
+            }
+            for (size_t r = 0; r < pool.rules->count(); ++r) {
+                const WpaRule &rule = pool.rules->rule(r);
+                if (!applyWpaRule(rule, batch.words[i], batch.lens[i], candidate, candidateLen)) continue;
+                w.signature += testCandidate(candidate, candidateLen, pool.blocks);
+                batch.tested++;
+            }
+        }
+        w.tested += batch.tested;
+        batch.complete = true;
+        while (!w.done.push(idx) && !pool.stop.load(std::memory_order_acquire)) {
+            w.donePushWaits++;
+            std::this_thread::yield();
+        }
+    }
+}
+
+struct RunResult {
+    uint64_t batches = 0;
+    uint64_t tested = 0;
+    uint64_t signature = 0;
+    uint64_t idlePolls = 0;
+    uint64_t donePushWaits = 0;
+    uint64_t allOut = 0; // feeder rounds with every batch out at the workers
+    uint32_t frontierOffset = 0;
+    uint32_t frontierTested = 0;
+    double seconds = 0;
+};
+
+// The feeding side of wifi_recover(): free list, pick_worker(), collect()
+static RunResult run(const std::string &wordlist, const WpaRuleSet *rules, int workerCount, int blocks) {
+    Pool pool;
+    pool.rules = rules;
+    pool.blocks = blocks;
+    const uint8_t batchCount = workerCount * BATCHES_PER_WORKER;
+    pool.batches.resize(batchCount);
+    std::vector<Worker> workers(workerCount);
+
+    MemFile file = {&wordlist};
+    WordlistReader<MemFile> reader;
+    reader.begin(&file, 0);
+    uint8_t wordsPerBatch = WPA_BATCH_CANDIDATES;
+    if (rules) {
+        reader.setLengthRange(1, WPA_PASSPHRASE_MAX);
+        wordsPerBatch = rules->count() >= WPA_BATCH_CANDIDATES ? 1 : WPA_BATCH_CANDIDATES / rules->count();
+    }
+    RecoverFrontier frontier;
+    frontier.reset(0, 0);
+    std::vector<uint8_t> freeList;
+    for (uint8_t i = 0; i < batchCount; ++i) freeList.push_back(i);
+    int inFlight = 0;
+    bool inputDone = false;
+    RunResult r;
+
+    auto collect = [&]() {
+        uint8_t idx;
+        for (Worker &w : workers) {
+            while (w.done.pop(idx)) {
+                const CandidateBatch &done = pool.batches[idx];
+                frontier.returned(done.seq, done.complete, done.tested);
+                freeList.push_back(idx);
+                inFlight--;
+            }
+        }
+    };
+    auto pickWorker = [&]() -> Worker * {
+        Worker *target = nullptr;
+        for (Worker &w : workers) {
+            const size_t queued = w.todo.size();
+            if (queued >= BATCHES_PER_WORKER) continue;
+            if (!target || queued < target->todo.size()) target = &w;
+        }
+        return target;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    for (Worker &w : workers) w.thread = std::thread(workerLoop, std::ref(pool), std::ref(w));
+    while (true) {
+        collect();
+        while (!inputDone && !freeList.empty() && !frontier.full()) {
+            Worker *target = pickWorker();
+            if (!target) break;
+            const uint8_t idx = freeList.back();
+            CandidateBatch &batch = pool.batches[idx];
+            if (!reader.fill(batch, wordsPerBatch)) {
+                inputDone = true;
+                break;
+            }
+            freeList.pop_back();
+            batch.seq = frontier.dispatched(batch.endOffset);
+            target->todo.push(idx);
+            inFlight++;
+            r.batches++;
+        }
+        if (inputDone && inFlight == 0) break;
+        if (freeList.empty()) r.allOut++;
+        std::this_thread::yield();
+    }
+    pool.stop.store(true, std::memory_order_release);
+    for (Worker &w : workers) w.thread.join();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    r.seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e9;
+
+    for (const Worker &w : workers) {
+        r.tested += w.tested;
+        r.signature += w.signature;
+        r.idlePolls += w.idlePolls;
+        r.donePushWaits += w.donePushWaits;
+    }
+    r.frontierOffset = frontier.offset();
+    r.frontierTested = frontier.tested();
+    return r;
+}
+
+// The same candidates on one thread, nothing in between
+static void expected(
+    const std::string &wordlist,
+    const WpaRuleSet *rules,
+    int blocks,
+    uint64_t &tested,
+    uint64_t &signature
+) {
+    MemFile file = {&wordlist};
+    WordlistReader<MemFile> reader;
+    reader.begin(&file, 0);
+    if (rules) reader.setLengthRange(1, WPA_PASSPHRASE_MAX);
+    CandidateBatch batch;
+    char candidate[WPA_PASSPHRASE_MAX + 1];
+    uint8_t candidateLen;
+    tested = signature = 0;
+    while (reader.fill(batch)) {
+        for (uint8_t i = 0; i < batch.count; ++i) {
+            if (!rules) {
+                signature += testCandidate(batch.words[i], batch.lens[i], blocks);
+                tested++;
+                continue;
+            }
+            for (size_t r = 0; r < rules->count(); ++r) {
+                const WpaRule &rule = rules->rule(r);
+                if (!applyWpaRule(rule, batch.words[i], batch.lens[i], candidate, candidateLen)) continue;
+                signature += testCandidate(candidate, candidateLen, blocks);
+                tested++;
+            }
+        }
+    }
+}
+
+// Mostly 4-14 letters, with comments, blanks, CRLF and overlong lines the reader skips
+static std::string makeWordlist(size_t words) {
+    std::mt19937 rng(17);
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        const uint32_t roll = rng() % 100;
+        if (roll == 0) text += "# comment\n";
+        else if (roll == 1) text += "\n";
+        else if (roll == 2) text += std::string(70 + rng() % 100, 'x') + "\n";
+        const size_t len = 4 + rng() % 11;
+        for (size_t k = 0; k < len; ++k) text += (char)('a' + rng() % 26);
+        text += roll == 3 ? "\r\n" : "\n";
+    }
+    return text;
+}
+
+int main(int argc, char **argv) {
+    size_t words = 20000;
+    int workerCount = 2;
+    int blocks = 0;
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--words" && i + 1 < argc) words = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--workers" && i + 1 < argc) workerCount = atoi(argv[++i]);
+        else if (arg == "--blocks" && i + 1 < argc) blocks = atoi(argv[++i]);
+        else if (arg == "--check") check = true;
+        else {
+            fprintf(stderr, "usage: %s [--words N] [--workers N] [--blocks N] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (workerCount < 1) workerCount = 1;
+    if (workerCount > MAX_WORKERS) workerCount = MAX_WORKERS;
+
+    const std::string wordlist = makeWordlist(words);
+    WpaRuleSet defaults;
+    defaults.init(512);
+    defaults.addDefaults();
+    for (const WpaRuleSet *rules : {(const WpaRuleSet *)nullptr, (const WpaRuleSet *)&defaults}) {
+        const RunResult r = run(wordlist, rules, workerCount, blocks);
+        const char *name = rules ? "default rules" : "wordlist";
+        printf("%s, %d workers, %d blocks per candidate\n", name, workerCount, blocks);
+        printf(
+            "  batches       %llu, %.0f/s\n",
+            (unsigned long long)r.batches,
+            r.seconds > 0 ? r.batches / r.seconds : 0.0
+        );
+        printf(
+            "  candidates    %llu, %.0f/s\n",
+            (unsigned long long)r.tested,
+            r.seconds > 0 ? r.tested / r.seconds : 0.0
+        );
+        printf(
+            "  waits         %llu empty todo polls, %llu full done pushes, %llu with every batch out\n",
+            (unsigned long long)r.idlePolls,
+            (unsigned long long)r.donePushWaits,
+            (unsigned long long)r.allOut
+        );
+        if (!check) continue;
+        uint64_t tested, signature;
+        expected(wordlist, rules, blocks, tested, signature);
+        CHECK_EQ(r.tested, tested);
+        CHECK_EQ(r.frontierTested, tested);
+        CHECK(r.signature == signature);
+        CHECK_EQ(r.frontierOffset, wordlist.size());
+    }
+    return check ? hostTestResult("bench_recover_pool") : 0;
+}
@@ -0,0 +1,428 @@
+// Replays pcap / pcapng captures through the sniffer's frame analysis (sniffer_analysis.h) and the
+// 22000 extractor at full speed, and reports time per frame, heap allocations and SSID cache hits.
+//   bench_sniffer_replay [--repeat N] capture.pcap [more.pcapng ...]
+//   bench_sniffer_replay --synthetic FRAMES [--check] [--dir DIR]
+// --synthetic writes a generated capture into DIR (default .) as pcap and as pcapng (radiotap, like
+// the sniffer's raw files) and replays both; --check turns the expected counts into a pass/fail.
+#include "host_test.h"
+#include "modules/wifi/pcapng_sink.h"
+#include "modules/wifi/sniffer_analysis.h"
+#include <chrono>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// Heap allocations made while replaying, the analysis path must not make any
+static volatile size_t allocCount = 0;
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+// from sanitizer/allocator_interface.h, which not every toolchain installs
+extern "C" int __sanitizer_install_malloc_and_free_hooks(
+    void (*mallocHook)(const volatile void *, size_t), void (*freeHook)(const volatile void *)
+);
+static void countMalloc(const volatile void *, size_t) { allocCount = allocCount + 1; }
+static const int mallocHookInstalled = __sanitizer_install_malloc_and_free_hooks(countMalloc, nullptr);
+#elif defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *malloc(size_t n) {
+    allocCount = allocCount + 1;
+    return __libc_malloc(n);
+}
+#endif
+
+struct CapturedFrame {
+    uint64_t tsUsec;
+    uint32_t offset; // into Capture::bytes
+    uint16_t len;
+};
+
+struct Capture {
+    std::vector<uint8_t> bytes;
+    std::vector<CapturedFrame> frames;
+};
+
+static uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static bool readFile(const char *path, std::vector<uint8_t> &out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+// Radiotap is skipped, the analysis only looks at the 802.11 frame
+static void addFrame(Capture &cap, uint32_t linktype, uint64_t tsUsec, size_t at, size_t len) {
+    if (linktype == PCAP_LINKTYPE_IEEE802_11_RADIOTAP) {
+        if (len < 4) return;
+        const uint16_t rtLen = get16(cap.bytes.data() + at + 2);
+        if (rtLen > len) return;
+        at += rtLen;
+        len -= rtLen;
+    } else if (linktype != PCAP_LINKTYPE_IEEE802_11) {
+        return;
+    }
+    if (len > 0xFFFF) return;
+    cap.frames.push_back({tsUsec, (uint32_t)at, (uint16_t)len});
+}
+
+// Little-endian classic pcap (us or ns timestamps) and pcapng with EPBs
+static bool loadCapture(const char *path, Capture &cap) {
+    if (!readFile(path, cap.bytes) || cap.bytes.size() < 24) return false;
+    const uint8_t *b = cap.bytes.data();
+    const size_t size = cap.bytes.size();
+    const uint32_t magic = get32(b);
+    if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+        const uint32_t linktype = get32(b + 20);
+        const bool nanos = magic == 0xa1b23c4d;
+        size_t pos = 24;
+        while (pos + 16 <= size) {
+            const uint32_t incl = get32(b + pos + 8);
+            if (pos + 16 + incl > size) break;
+            const uint64_t ts = (uint64_t)get32(b + pos) * 1000000 + get32(b + pos + 4) / (nanos ? 1000 : 1);
+            addFrame(cap, linktype, ts, pos + 16, incl);
+            pos += 16 + incl;
+        }
+        return true;
+    }
+    if (magic == 0x0A0D0D0A) {
+        std::vector<uint32_t> linktypes;
+        size_t pos = 0;
+        while (pos + 12 <= size) {
+            const uint32_t type = get32(b + pos);
+            const uint32_t total = get32(b + pos + 4);
+            if (total < 12 || pos + total > size) break;
+            if (type == 0x0A0D0D0A) {
+                if (get32(b + pos + 8) != 0x1A2B3C4D) return false; // big-endian section
+                linktypes.clear();
+            } else if (type == 1) {
+                linktypes.push_back(get16(b + pos + 8));
+            } else if (type == 6 && total >= 32) {
+                const uint32_t iface = get32(b + pos + 8);
+                const uint64_t ts = ((uint64_t)get32(b + pos + 12) << 32) | get32(b + pos + 16);
+                const uint32_t captured = get32(b + pos + 20);
+                if (iface < linktypes.size() && 28 + captured <= total) {
+                    addFrame(cap, linktypes[iface], ts, pos + 28, captured);
+                }
+            }
+            pos += total;
+        }
+        return true;
+    }
+    return false;
+}
+
+struct ReplayResult {
+    size_t frames = 0;
+    double nsPerFrame = 0;
+    size_t allocations = 0;
+    size_t eapol = 0;
+    size_t hashLines = 0;
+    SnifferAnalysisStats stats;
+    uint32_t beaconFrames = 0;
+    size_t beaconsListed = 0;
+    HandshakeTracker tracker;
+    Hc22000Stats hc;
+};
+
+static size_t hashLines = 0;
+static void countHashLine(void *, const char *) { hashLines++; }
+
+// Same sizes as a PSRAM board, the tables are allocated before the clock starts
+static ReplayResult replay(const Capture &cap, int repeat, const uint8_t *targetBssid) {
+    BeaconTable beacons;
+    MacTable<BeaconInfo> beaconInfo;
+    Hc22000Extractor extractor;
+    beacons.init(1024);
+    beaconInfo.init(1024);
+    extractor.init(128);
+    extractor.setEmitter(countHashLine, nullptr);
+    hashLines = 0;
+
+    ReplayResult r;
+    SnifferAnalysisState state = {&beacons, &beaconInfo, &r.stats, &r.tracker, targetBssid, &r.beaconFrames};
+    const size_t allocsBefore = allocCount;
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < repeat; ++pass) {
+        for (const CapturedFrame &f : cap.frames) {
+            WifiFrameDesc frame;
+            if (!parseWifiFrame(cap.bytes.data() + f.offset, f.len, 0, 0, frame)) continue;
+            const uint32_t nowMs = (uint32_t)(f.tsUsec / 1000);
+            const FrameInfo info = analyzeFrame(frame, state, 6, nowMs);
+            r.frames++;
+            if (!info.isEapol) continue;
+            r.eapol++;
+            // the writer task does this part, off the callback
+            if (!info.ssid.empty()) extractor.feed(frame, info.ssid.text, info.ssid.len, nowMs);
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    r.allocations = allocCount - allocsBefore;
+    const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    r.nsPerFrame = r.frames ? ns / r.frames : 0;
+    r.hashLines = hashLines;
+    r.beaconsListed = beacons.size();
+    r.hc = extractor.stats();
+    return r;
+}
+
+static void report(const char *name, const ReplayResult &r) {
+    const SnifferAnalysisStats &s = r.stats;
+    printf("%s\n", name);
+    printf(
+        "  frames        %zu, %.1f ns/frame, %zu heap allocations\n", r.frames, r.nsPerFrame, r.allocations
+    );
+    printf(
+        "  ssid cache    %u lookups, %u hits (%.1f%%)\n",
+        s.ssidLookups,
+        s.ssidHits,
+        s.ssidLookups ? 100.0 * s.ssidHits / s.ssidLookups : 0.0
+    );
+    printf(
+        "  beacons       %u frames, %u APs tracked, %u refused (table full), %zu in the target list\n",
+        r.beaconFrames,
+        s.beaconsTracked,
+        s.beaconTableFull,
+        r.beaconsListed
+    );
+    printf(
+        "  eapol         %zu frames, handshake %s, %zu 22000 lines (%u PMKID, %u pairs)\n",
+        r.eapol,
+        handshakeUsable(r.tracker) ? "usable" : "incomplete",
+        r.hashLines,
+        r.hc.pmkids,
+        r.hc.pairs
+    );
+}
+
+// --- synthetic capture -------------------------------------------------------------------------
+
+struct SyntheticFrame {
+    std::vector<uint8_t> bytes;
+    uint8_t channel;
+};
+
+struct Synthetic {
+    std::vector<SyntheticFrame> frames;
+    uint8_t target[6];
+    uint32_t aps = 0;
+    uint32_t lookups = 0;  // non-beacon frames with an AP address
+    uint32_t hits = 0;     // of those, to an AP that beaconed before
+    uint32_t beacons = 0;
+};
+
+static void macFor(uint32_t n, uint8_t prefix, uint8_t *mac) {
+    mac[0] = prefix;
+    mac[1] = 0x00;
+    mac[2] = n >> 24;
+    mac[3] = n >> 16;
+    mac[4] = n >> 8;
+    mac[5] = n;
+}
+
+static std::vector<uint8_t>
+header(uint8_t fc0, uint8_t fc1, const uint8_t *a1, const uint8_t *a2, const uint8_t *a3) {
+    std::vector<uint8_t> b = {fc0, fc1, 0, 0};
+    b.insert(b.end(), a1, a1 + 6);
+    b.insert(b.end(), a2, a2 + 6);
+    b.insert(b.end(), a3, a3 + 6);
+    b.push_back(0);
+    b.push_back(0);
+    return b;
+}
+
+static SyntheticFrame beaconFrame(const uint8_t *ap, uint32_t n, uint8_t channel) {
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    SyntheticFrame f = {header(0x80, 0, bcast, ap, ap), channel};
+    f.bytes.insert(f.bytes.end(), 12, 0); // timestamp, interval, capabilities
+    const std::string ssid = "AP-" + std::to_string(n) + (n % 7 == 0 ? "\xE9" : "");
+    f.bytes.push_back(0);
+    f.bytes.push_back(ssid.size());
+    f.bytes.insert(f.bytes.end(), ssid.begin(), ssid.end());
+    f.bytes.push_back(3); // DS parameter set
+    f.bytes.push_back(1);
+    f.bytes.push_back(channel);
+    return f;
+}
+
+static SyntheticFrame dataFrame(const uint8_t *ap, const uint8_t *sta, uint8_t channel, size_t payload) {
+    SyntheticFrame f = {header(0x08, 0x01, ap, sta, ap), channel};
+    const uint8_t llc[8] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x08, 0x00};
+    f.bytes.insert(f.bytes.end(), llc, llc + 8);
+    f.bytes.insert(f.bytes.end(), payload, 0x5A);
+    return f;
+}
+
+static SyntheticFrame eapolFrame(const uint8_t *ap, const uint8_t *sta, int msg, uint8_t channel) {
+    static const uint16_t keyInfo[5] = {0, 0x008A, 0x010A, 0x13CA, 0x030A};
+    const bool fromAp = msg == 1 || msg == 3;
+    SyntheticFrame f = {fromAp ? header(0x08, 0x02, sta, ap, ap) : header(0x08, 0x01, ap, sta, ap), channel};
+    const uint8_t llc[8] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8E};
+    f.bytes.insert(f.bytes.end(), llc, llc + 8);
+    std::vector<uint8_t> e(EAPOL_KEY_DATA, 0);
+    e[0] = 2;
+    e[1] = 3;
+    e[3] = EAPOL_KEY_DATA - 4;
+    e[4] = 2;
+    e[EAPOL_KEY_INFO] = keyInfo[msg] >> 8;
+    e[EAPOL_KEY_INFO + 1] = keyInfo[msg] & 0xFF;
+    e[EAPOL_KEY_REPLAY + 7] = msg >= 3 ? 2 : 1;
+    if (msg != 4) {
+        for (int i = 0; i < 32; ++i) e[EAPOL_KEY_NONCE + i] = (fromAp ? 0x10 : 0x60) + i;
+    }
+    if (msg >= 2) {
+        for (int i = 0; i < 16; ++i) e[EAPOL_KEY_MIC + i] = msg * 16 + i;
+    }
+    f.bytes.insert(f.bytes.end(), e.begin(), e.end());
+    return f;
+}
+
+// Beacons from `aps` APs first, then traffic: mostly data frames to known APs, some to APs that
+// never beaconed, periodic beacons and one 4-way handshake with the target AP in the middle
+static Synthetic generate(size_t count) {
+    Synthetic syn;
+    std::mt19937 rng(7);
+    syn.aps = count < 2000 ? 50 : 400;
+    macFor(3, 0x02, syn.target);
+    for (uint32_t i = 0; i < syn.aps; ++i) {
+        uint8_t ap[6];
+        macFor(i, 0x02, ap);
+        syn.frames.push_back(beaconFrame(ap, i, 1 + i % 11));
+        syn.beacons++;
+    }
+    const uint8_t sta[6] = {0x0A, 0x11, 0x22, 0x33, 0x44, 0x55};
+    while (syn.frames.size() < count) {
+        if (syn.frames.size() == count / 2) {
+            for (int msg = 1; msg <= 4; ++msg) {
+                syn.frames.push_back(eapolFrame(syn.target, sta, msg, 6));
+                syn.lookups++;
+                syn.hits++;
+            }
+            continue;
+        }
+        const uint32_t roll = rng() % 100;
+        uint8_t ap[6];
+        if (roll < 10) {
+            const uint32_t n = rng() % syn.aps;
+            macFor(n, 0x02, ap);
+            syn.frames.push_back(beaconFrame(ap, n, 1 + n % 11));
+            syn.beacons++;
+        } else if (roll < 20) {
+            macFor(rng() % 1000, 0x06, ap); // never beacons
+            uint8_t client[6];
+            macFor(rng(), 0x0A, client);
+            syn.frames.push_back(dataFrame(ap, client, 6, 40 + rng() % 400));
+            syn.lookups++;
+        } else {
+            macFor(rng() % syn.aps, 0x02, ap);
+            uint8_t client[6];
+            macFor(rng() % 5000, 0x0A, client);
+            syn.frames.push_back(dataFrame(ap, client, 6, 40 + rng() % 1400));
+            syn.lookups++;
+            syn.hits++;
+        }
+    }
+    return syn;
+}
+
+struct StdioFile {
+    FILE *f = nullptr;
+    size_t write(const uint8_t *buf, size_t len) { return fwrite(buf, 1, len, f); }
+    void flush() { fflush(f); }
+    void close() { fclose(f); }
+    explicit operator bool() const { return f != nullptr; }
+};
+
+static bool writeSynthetic(const Synthetic &syn, const std::string &pcapPath, const std::string &pcapngPath) {
+    static uint8_t buffer[16384];
+    PcapSink<StdioFile> pcap;
+    PcapngSink<StdioFile> pcapng;
+    StdioFile a, b;
+    a.f = fopen(pcapPath.c_str(), "wb");
+    b.f = fopen(pcapngPath.c_str(), "wb");
+    if (!a || !b) return false;
+    pcap.setBuffer(buffer, sizeof(buffer) / 2);
+    pcapng.setBuffer(buffer + sizeof(buffer) / 2, sizeof(buffer) / 2);
+    bool ok = pcap.attach(a, 0, true) && pcapng.attach(b, 0, "bench_sniffer_replay");
+    uint64_t ts = 1700000000ull * 1000000;
+    for (const SyntheticFrame &f : syn.frames) {
+        ts += 250;
+        const uint32_t len = f.bytes.size();
+        ok = pcap.append(ts / 1000000, ts % 1000000, f.bytes.data(), len, len, 0) && ok;
+        ok = pcapng.append(ts, f.channel, -50, false, f.bytes.data(), len, len, 0) && ok;
+    }
+    pcap.close();
+    pcapng.close();
+    return ok;
+}
+
+static void checkSynthetic(const Synthetic &syn, const ReplayResult &r) {
+    CHECK_EQ(r.frames, syn.frames.size());
+    CHECK_EQ(r.allocations, 0);
+    CHECK_EQ(r.beaconFrames, syn.beacons);
+    CHECK_EQ(r.stats.beaconsTracked, syn.aps);
+    CHECK_EQ(r.stats.beaconTableFull, 0);
+    CHECK_EQ(r.stats.ssidLookups, syn.lookups);
+    CHECK_EQ(r.stats.ssidHits, syn.hits);
+    CHECK_EQ(r.eapol, 4);
+    CHECK(handshakeUsable(r.tracker));
+    CHECK_EQ(r.hashLines, 1); // M1/M2, M2/M3 shares its MIC
+}
+
+static int runSynthetic(size_t count, bool check, const char *dir) {
+    const Synthetic syn = generate(count);
+    const std::string base = std::string(dir) + "/bench_sniffer_replay";
+    const std::string pcapPath = base + ".pcap", pcapngPath = base + ".pcapng";
+    if (!writeSynthetic(syn, pcapPath, pcapngPath)) {
+        fprintf(stderr, "cannot write the synthetic captures to %s\n", dir);
+        return 1;
+    }
+    const char *paths[2] = {pcapPath.c_str(), pcapngPath.c_str()};
+    for (const char *path : paths) {
+        Capture cap;
+        if (!loadCapture(path, cap)) {
+            fprintf(stderr, "%s: cannot read it back\n", path);
+            return 1;
+        }
+        const ReplayResult r = replay(cap, 1, syn.target);
+        report(path, r);
+        if (check) checkSynthetic(syn, r);
+    }
+    return check ? hostTestResult("bench_sniffer_replay") : 0;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 1;
+    size_t synthetic = 0;
+    bool check = false;
+    const char *dir = ".";
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (arg == "--synthetic" && i + 1 < argc) synthetic = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--dir" && i + 1 < argc) dir = argv[++i];
+        else if (arg == "--check") check = true;
+        else files.push_back(argv[i]);
+    }
+    if (synthetic) return runSynthetic(synthetic < 1000 ? 1000 : synthetic, check, dir);
+    if (files.empty()) {
+        fprintf(stderr, "usage: %s [--repeat N] capture.pcap|capture.pcapng ...\n", argv[0]);
+        fprintf(stderr, "       %s --synthetic FRAMES [--check] [--dir DIR]\n", argv[0]);
+        return 2;
+    }
+    int status = 0;
+    for (const char *path : files) {
+        Capture cap;
+        if (!loadCapture(path, cap)) {
+            fprintf(stderr, "%s: not a little-endian pcap or pcapng file\n", path);
+            status = 1;
+            continue;
+        }
+        report(path, replay(cap, repeat < 1 ? 1 : repeat, nullptr));
+    }
+    return status;
+}
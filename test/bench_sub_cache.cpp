@@ -0,0 +1,303 @@
+// Loads every .sub file of a directory the way txSubFile() + sendRfCommand() used to (lines read
+// into Strings, RAW_Data split with indexOf/substring/toInt into a calloc'd array per send) and
+// from the sidecar sub_cache.cpp keeps (the file read into memory, loadCompiledSub()), and
+// reports both per file, with the one-off cost of compiling the file and writing its sidecar.
+//   bench_sub_cache [--rounds N] [--dir DIR] [--check] [corpus dir]
+// The corpus defaults to data/sub: Flipper key, RAW and BinRAW files, some with CRLF, and a RAW
+// file as rf_raw_save() writes it. Sidecars go to --dir. --check makes the sidecar giving back
+// what the String parser sent (RAW timings, keys, bits, Data_RAW bytes) a pass/fail.
+#include "host_test.h"
+#include "modules/rf/sub_compiler.h"
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+static bool isBlank(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+// String::trim()
+static void trim(std::string &s) {
+    size_t start = 0, end = s.size();
+    while (start < end && isBlank(s[start])) start++;
+    while (end > start && isBlank(s[end - 1])) end--;
+    s = s.substr(start, end - start);
+}
+
+// String::toInt(): atol() with a 32-bit long
+static int32_t toInt(const std::string &s) {
+    const long long v = strtoll(s.c_str(), nullptr, 10);
+    return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// hexStringToDecimal()
+static uint32_t hexStringToDecimal(const char *s) {
+    const size_t len = strlen(s);
+    uint32_t v = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        const int hi = hexDigit(s[i]), lo = hexDigit(s[i + 1]);
+        v = v << 8 | (uint32_t)((hi < 0 ? 0 : hi) << 4 | (lo < 0 ? 0 : lo));
+    }
+    return v;
+}
+
+static bool startsWith(const std::string &s, const char *prefix) {
+    return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// What the old path ended up sending
+struct StringParsed {
+    std::string protocol, preset;
+    uint32_t frequency = 0;
+    int32_t te = 0;
+    std::vector<int32_t> bits, bitRaws;
+    std::vector<uint32_t> keys;
+    std::vector<std::vector<int32_t>> raw;   // per RAW_Data line, up to the 0 RCSwitch_RAW_send() stops at
+    std::vector<std::vector<uint8_t>> bytes; // per Data_RAW line, as hexStrToBinStr() read it
+};
+
+// sendRfCommand() on one RAW_Data line: count the spaces, calloc, substring().toInt() per word
+static std::vector<int32_t> sendRaw(const std::string &data) {
+    int buffSize = 0;
+    for (int index = 0; index >= 0; buffSize++) {
+        const size_t at = data.find(' ', index + 1);
+        index = at == std::string::npos ? -1 : (int)at;
+    }
+    int *timings = (int *)calloc(sizeof(int), buffSize + 1);
+    size_t start = 0;
+    for (int i = 0; i < buffSize; ++i) {
+        const size_t index = data.find(' ', start);
+        if (index == std::string::npos) timings[i] = toInt(data.substr(start));
+        else timings[i] = toInt(data.substr(start, index - start));
+        start = index + 1;
+    }
+    std::vector<int32_t> sent;
+    for (int i = 0; timings[i] != 0; ++i) sent.push_back(timings[i]);
+    free(timings);
+    return sent;
+}
+
+static std::vector<uint8_t> sendBinRaw(const std::string &data) {
+    std::vector<uint8_t> out;
+    int nibble = -1;
+    for (char c : data) {
+        const int d = hexDigit(c);
+        if (d < 0) continue;
+        if (nibble < 0) {
+            nibble = d;
+            continue;
+        }
+        out.push_back((uint8_t)(nibble << 4 | d));
+        nibble = -1;
+    }
+    return out;
+}
+
+// txSubFile() as it was: readStringUntil('\n') a byte at a time, every line into Strings
+static bool parseWithStrings(const std::string &path, StringParsed &out) {
+    out = StringParsed();
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::vector<std::string> rawDataList;
+    std::vector<bool> isRaw;
+    int c = 0;
+    while (c != EOF) {
+        std::string line;
+        while ((c = fgetc(f)) != EOF && c != '\n') line += (char)c;
+        if (c == EOF && line.empty()) break;
+        std::string txt = line.substr(line.find(':') == std::string::npos ? 0 : line.find(':') + 1);
+        if (!txt.empty() && txt.back() == '\r') txt.pop_back();
+        trim(txt);
+        if (startsWith(line, "Protocol:")) out.protocol = txt;
+        if (startsWith(line, "Preset:")) out.preset = txt;
+        if (startsWith(line, "Frequency:")) out.frequency = toInt(txt);
+        if (startsWith(line, "TE:")) out.te = toInt(txt);
+        if (startsWith(line, "Bit:")) out.bits.push_back(toInt(txt));
+        if (startsWith(line, "Bit_RAW:")) out.bitRaws.push_back(toInt(txt));
+        if (startsWith(line, "Key:")) out.keys.push_back(hexStringToDecimal(txt.c_str()));
+        if (startsWith(line, "RAW_Data:") || startsWith(line, "Data_RAW:")) {
+            rawDataList.push_back(txt);
+            isRaw.push_back(line[0] == 'R');
+        }
+    }
+    fclose(f);
+    // then one sendRfCommand() per data line
+    for (size_t i = 0; i < rawDataList.size(); ++i) {
+        if (out.protocol == "RAW" && isRaw[i]) out.raw.push_back(sendRaw(rawDataList[i]));
+        else if (out.protocol == "BinRAW" && !isRaw[i]) out.bytes.push_back(sendBinRaw(rawDataList[i]));
+    }
+    return true;
+}
+
+struct StdioSource {
+    FILE *f;
+    size_t read(uint8_t *buf, size_t len) { return fread(buf, 1, len, f); }
+};
+
+struct StdioSink {
+    FILE *f;
+    size_t write(const uint8_t *buf, size_t len) { return fwrite(buf, 1, len, f); }
+};
+
+static bool sourceKey(const std::string &path, SubSourceKey &key) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    key.size = (uint32_t)st.st_size;
+    key.mtime = (uint32_t)st.st_mtime;
+    return true;
+}
+
+// First send of a file: compile it, write the sidecar
+static bool compileToSidecar(const std::string &path, const std::string &sidecar) {
+    SubSourceKey key;
+    FILE *in = fopen(path.c_str(), "rb");
+    if (!in || !sourceKey(path, key)) {
+        if (in) fclose(in);
+        return false;
+    }
+    CompiledSub sub;
+    StdioSource source = {in};
+    compileSub(source, sub);
+    fclose(in);
+    FILE *out = fopen(sidecar.c_str(), "wb");
+    if (!out) return false;
+    StdioSink sink = {out};
+    const bool ok = writeCompiledSub(sink, sub, key);
+    fclose(out);
+    return ok;
+}
+
+// Every later send: stat the source for its key, read the sidecar, decode it
+static bool loadSidecar(const std::string &path, const std::string &sidecar, CompiledSub &sub) {
+    SubSourceKey key;
+    if (!sourceKey(path, key)) return false;
+    FILE *f = fopen(sidecar.c_str(), "rb");
+    if (!f) return false;
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return loadCompiledSub(data.data(), data.size(), key, sub);
+}
+
+static bool sameAsStrings(const StringParsed &s, const CompiledSub &sub) {
+    if (s.protocol != sub.protocolName || s.preset != sub.presetName || s.frequency != sub.frequency ||
+        s.te != sub.te || s.bits != sub.bits || s.bitRaws != sub.bitRaws || s.keys != sub.keys) {
+        return false;
+    }
+    size_t raw = 0, bytes = 0;
+    for (const SubDataLine &line : sub.lines) {
+        if (line.kind == SUB_DATA_TIMINGS && sub.protocol == SUB_PROTOCOL_RAW) {
+            const std::vector<int32_t> t(sub.lineTimings(line), sub.lineTimings(line) + line.count);
+            if (raw >= s.raw.size() || s.raw[raw++] != t) return false;
+        } else if (line.kind == SUB_DATA_BYTES && sub.protocol == SUB_PROTOCOL_BINRAW) {
+            const std::vector<uint8_t> b(sub.lineBytes(line), sub.lineBytes(line) + line.count);
+            if (bytes >= s.bytes.size() || s.bytes[bytes++] != b) return false;
+        }
+    }
+    return raw == s.raw.size() && bytes == s.bytes.size();
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e9;
+}
+
+static long fileSize(const std::string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long)st.st_size : 0;
+}
+
+int main(int argc, char **argv) {
+    int rounds = 200;
+    const char *dir = ".";
+    const char *corpus = BRUCE_TEST_DATA "/sub";
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--rounds" && i + 1 < argc) rounds = atoi(argv[++i]);
+        else if (arg == "--dir" && i + 1 < argc) dir = argv[++i];
+        else if (arg == "--check") check = true;
+        else if (arg[0] != '-') corpus = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [--rounds N] [--dir DIR] [--check] [corpus dir]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rounds < 1) rounds = 1;
+
+    std::vector<std::string> names;
+    if (DIR *d = opendir(corpus)) {
+        while (const dirent *e = readdir(d)) {
+            const std::string name = e->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".sub") == 0) names.push_back(name);
+        }
+        closedir(d);
+    }
+    std::sort(names.begin(), names.end());
+    if (names.empty()) {
+        fprintf(stderr, "%s: no .sub files\n", corpus);
+        return 1;
+    }
+
+    printf("%zu files in %s, %d rounds\n", names.size(), corpus, rounds);
+    printf(
+        "  %-26s %7s %7s %12s %12s %12s\n", "file", "bytes", "sidecar", "String us", "compile us", "load us"
+    );
+    double totalParse = 0, totalLoad = 0;
+    for (const std::string &name : names) {
+        const std::string path = std::string(corpus) + "/" + name;
+        const std::string sidecar = std::string(dir) + "/bench_sub_cache_" + name + ".bin";
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = true;
+        for (int r = 0; r < rounds && ok; ++r) ok = compileToSidecar(path, sidecar);
+        const double compile = secondsSince(start) / rounds;
+
+        StringParsed parsed;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds && ok; ++r) ok = parseWithStrings(path, parsed);
+        const double parse = secondsSince(start) / rounds;
+
+        CompiledSub sub;
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds && ok; ++r) ok = loadSidecar(path, sidecar, sub);
+        const double load = secondsSince(start) / rounds;
+        if (!ok) {
+            fprintf(stderr, "%s: cannot compile, parse or load it\n", path.c_str());
+            return 1;
+        }
+        totalParse += parse;
+        totalLoad += load;
+        printf(
+            "  %-26s %7ld %7ld %12.1f %12.1f %12.1f\n",
+            name.c_str(),
+            fileSize(path),
+            fileSize(sidecar),
+            parse * 1e6,
+            compile * 1e6,
+            load * 1e6
+        );
+        if (check && !sameAsStrings(parsed, sub)) {
+            fprintf(stderr, "%s: the sidecar differs from what the String parser sent\n", name.c_str());
+            CHECK(false);
+        }
+    }
+    printf(
+        "all files\n  String parse  %.1f us\n  sidecar load  %.1f us (%.1fx)\n",
+        totalParse * 1e6,
+        totalLoad * 1e6,
+        totalLoad > 0 ? totalParse / totalLoad : 0
+    );
+    return check ? hostTestResult("bench_sub_cache") : 0;
+}
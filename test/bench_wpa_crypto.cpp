@@ -0,0 +1,116 @@
+// Tests candidate passphrases against one handshake the way a recovery worker does (PMK, then the
+// MIC check) with each software SHA1 block function, and reports candidates per second.
+//   bench_wpa_crypto [--candidates N] [--check]
+// The last candidate is the passphrase; --check makes finding it exactly once, with every block
+// function, a pass/fail.
+#include "host_test.h"
+#include "modules/wifi/wpa_crypto.h"
+#include <chrono>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static const char *const SSID = "ThisIsASSID";
+static const char *const PASSPHRASE = "ThisIsAPassword";
+
+static const Sha1Backend SHA1_BACKEND_UNROLLED = {"unrolled", sha1CompressUnrolled, nullptr, nullptr, true};
+
+// An M2 for PASSPHRASE on SSID, its MIC made with the portable backend
+static WpaHandshakeVector makeHandshake() {
+    static const uint8_t ap[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x03};
+    static const uint8_t sta[6] = {0x0A, 0x11, 0x22, 0x33, 0x44, 0x55};
+    uint8_t anonce[32], snonce[32], frame[121] = {0};
+    for (int i = 0; i < 32; ++i) {
+        anonce[i] = 0x10 + i;
+        snonce[i] = 0x60 + i;
+    }
+    frame[0] = 1;
+    frame[1] = 3;
+    frame[3] = 117;
+    frame[4] = 2;
+    frame[5] = 0x01;
+    frame[6] = 0x0A;
+    memcpy(frame + 17, snonce, 32);
+    frame[98] = 22;
+
+    WpaHandshakeVector v;
+    v.init(ap, sta, anonce, snonce, frame, sizeof(frame), frame + 81);
+    uint8_t pmk[32], kck[20];
+    wpaDerivePmk(PASSPHRASE, strlen(PASSPHRASE), (const uint8_t *)SSID, strlen(SSID), pmk);
+    HmacSha1Midstate hmac;
+    uint32_t block[5];
+    hmac.setKey(pmk, 32);
+    hmac.digest(v.prfData, v.prfLen, block);
+    for (int i = 0; i < 5; ++i) storeBe32(kck + i * 4, block[i]);
+    hmac.setKey(kck, 16);
+    hmac.digest(v.eapol, v.eapolLen, block);
+    for (int i = 0; i < 4; ++i) storeBe32(v.mic + i * 4, block[i]);
+    return v;
+}
+
+struct RunResult {
+    size_t tested = 0;
+    size_t found = 0;
+    size_t foundAt = 0;
+    double seconds = 0;
+};
+
+static RunResult
+run(const Sha1Backend &backend, const WpaHandshakeVector &v, const std::vector<std::string> &words) {
+    RunResult r;
+    uint8_t pmk[32];
+    const uint8_t *ssid = (const uint8_t *)SSID;
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::string &w : words) {
+        if (!wpaDerivePmk(w.data(), w.size(), ssid, strlen(SSID), pmk, nullptr, backend)) continue;
+        if (v.pmkMatches(pmk)) {
+            r.found++;
+            r.foundAt = r.tested;
+        }
+        r.tested++;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    r.seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e9;
+    return r;
+}
+
+int main(int argc, char **argv) {
+    size_t count = 200;
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--candidates" && i + 1 < argc) count = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--check") check = true;
+        else {
+            fprintf(stderr, "usage: %s [--candidates N] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count < 1) count = 1;
+    std::vector<std::string> words;
+    for (size_t i = 0; i + 1 < count; ++i) words.push_back("candidate" + std::to_string(i));
+    words.push_back(PASSPHRASE);
+
+    const WpaHandshakeVector v = makeHandshake();
+    // a PMK is two chains of 4096 HMACs at two compressions each, plus the two key pads; the MIC
+    // check adds another 11
+    const double blocksPerCandidate = 2 * 4096 * 2 + 2 + 11;
+    for (const Sha1Backend *backend : {&SHA1_BACKEND_PORTABLE, &SHA1_BACKEND_UNROLLED}) {
+        const RunResult r = run(*backend, v, words);
+        const double perSecond = r.seconds > 0 ? r.tested / r.seconds : 0;
+        printf("%s\n", backend->name);
+        printf(
+            "  candidates    %zu tested, %.1f candidates/s, %.2f ms each\n",
+            r.tested,
+            perSecond,
+            r.tested ? r.seconds * 1000 / r.tested : 0.0
+        );
+        printf("  sha1          %.0f blocks/ms\n", perSecond * blocksPerCandidate / 1000);
+        if (check) {
+            CHECK_EQ(r.tested, count);
+            CHECK_EQ(r.found, 1);
+            CHECK_EQ(r.foundAt, count - 1);
+        }
+    }
+    return check ? hostTestResult("bench_wpa_crypto") : 0;
+}
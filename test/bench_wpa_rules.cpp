@@ -0,0 +1,143 @@
+// Expands a wordlist through the default rules the way a recovery worker does (every rule on
+// every base word) and reports candidates per second, without the PBKDF2 that follows on the
+// device.
+//   bench_wpa_rules [--repeat N] wordlist.txt
+//   bench_wpa_rules --synthetic WORDS [--check]
+// --synthetic makes WORDS random base words of 4-12 letters; --check turns the expected candidate
+// counts into a pass/fail.
+#include "host_test.h"
+#include "modules/wifi/wpa_rules.h"
+#include <chrono>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+struct ExpandResult {
+    size_t words = 0;
+    size_t applied = 0;    // rule applications
+    size_t candidates = 0; // of those, the ones a worker would test
+    size_t bytes = 0;
+    double seconds = 0;
+};
+
+static ExpandResult expand(const std::vector<std::string> &words, const WpaRuleSet &rules, int repeat) {
+    ExpandResult r;
+    char candidate[WPA_PASSPHRASE_MAX + 1];
+    uint8_t candidateLen;
+    const auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < repeat; ++pass) {
+        for (const std::string &word : words) {
+            for (size_t i = 0; i < rules.count(); ++i) {
+                r.applied++;
+                if (!applyWpaRule(rules.rule(i), word.data(), word.size(), candidate, candidateLen)) continue;
+                r.candidates++;
+                r.bytes += candidateLen;
+            }
+        }
+        r.words += words.size();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    r.seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1e9;
+    return r;
+}
+
+static void report(const char *name, const WpaRuleSet &rules, const ExpandResult &r) {
+    printf("%s\n", name);
+    printf("  rules         %zu defaults, %zu base words\n", rules.count(), r.words);
+    printf(
+        "  candidates    %zu of %zu applications, %.1f bytes on average\n",
+        r.candidates,
+        r.applied,
+        r.candidates ? (double)r.bytes / r.candidates : 0.0
+    );
+    printf(
+        "  speed         %.2f M candidates/s, %.1f ns per application\n",
+        r.seconds > 0 ? r.candidates / r.seconds / 1e6 : 0.0,
+        r.applied ? r.seconds * 1e9 / r.applied : 0.0
+    );
+}
+
+// The same wordlist lines the recovery reader hands on: CR/LF stripped, at most 63 bytes
+static bool loadWords(const char *path, std::vector<std::string> &words) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        while (len && (line[len - 1] == '\r' || line[len - 1] == '\n')) len--;
+        if (len > 0 && len <= WPA_PASSPHRASE_MAX) words.emplace_back(line, len);
+    }
+    fclose(f);
+    return true;
+}
+
+static std::vector<std::string> synthetic(size_t count, size_t lengths[13]) {
+    std::mt19937 rng(5);
+    std::vector<std::string> words;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t len = 4 + rng() % 9;
+        std::string w;
+        for (size_t k = 0; k < len; ++k) w += (char)('a' + rng() % 26);
+        lengths[len]++;
+        words.push_back(w);
+    }
+    return words;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 1;
+    size_t count = 0;
+    bool check = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (arg == "--synthetic" && i + 1 < argc) count = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--check") check = true;
+        else path = argv[i];
+    }
+    if (!count && !path) {
+        fprintf(stderr, "usage: %s [--repeat N] wordlist.txt\n", argv[0]);
+        fprintf(stderr, "       %s --synthetic WORDS [--check]\n", argv[0]);
+        return 2;
+    }
+    WpaRuleSet rules;
+    rules.init(512);
+    rules.addDefaults();
+
+    if (path) {
+        std::vector<std::string> words;
+        if (!loadWords(path, words)) {
+            fprintf(stderr, "%s: cannot read it\n", path);
+            return 1;
+        }
+        report(path, rules, expand(words, rules, repeat < 1 ? 1 : repeat));
+        return 0;
+    }
+
+    size_t lengths[13] = {};
+    const std::vector<std::string> words = synthetic(count, lengths);
+    const ExpandResult r = expand(words, rules, 1);
+    report("synthetic", rules, r);
+    if (!check) return 0;
+    // Case changes and substitutions keep the length, so only what a rule adds decides: adding n
+    // bytes keeps the words of 8 - n letters and longer.
+    size_t atLeast[14] = {};
+    for (int len = 12; len >= 4; --len) atLeast[len] = atLeast[len + 1] + lengths[len];
+    size_t expected = 0;
+    for (size_t i = 0; i < rules.count(); ++i) {
+        const WpaRule &rule = rules.rule(i);
+        size_t added = 0;
+        for (uint8_t k = 0; k < rule.len; ++k) {
+            const char op = rule.ops[k];
+            if (op == '$' || op == '^') added++;
+            k += op == 's' ? 2 : op == '$' || op == '^' || op == 'T' || op == '<' || op == '>' ? 1 : 0;
+        }
+        expected += atLeast[8 - added];
+    }
+    CHECK_EQ(r.words, count);
+    CHECK_EQ(r.applied, count * rules.count());
+    CHECK_EQ(r.candidates, expected);
+    return hostTestResult("bench_wpa_rules");
+}
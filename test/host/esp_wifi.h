@@ -0,0 +1,11 @@
+#ifndef __HOST_ESP_WIFI_H__
+#define __HOST_ESP_WIFI_H__
+// Host stand-in: installing the promiscuous callback does nothing off-target
+#include "esp_wifi_types.h"
+
+typedef int esp_err_t;
+typedef void (*wifi_promiscuous_cb_t)(void *buf, wifi_promiscuous_pkt_type_t type);
+
+inline esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t) { return 0; }
+
+#endif
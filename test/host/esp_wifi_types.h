@@ -0,0 +1,26 @@
+#ifndef __HOST_ESP_WIFI_TYPES_H__
+#define __HOST_ESP_WIFI_TYPES_H__
+// Host stand-in for the ESP-IDF promiscuous packet types, only the fields the frame bus reads
+#include <stdint.h>
+
+typedef enum {
+    WIFI_PKT_MGMT,
+    WIFI_PKT_CTRL,
+    WIFI_PKT_DATA,
+    WIFI_PKT_MISC,
+} wifi_promiscuous_pkt_type_t;
+
+typedef struct {
+    signed rssi : 8;
+    unsigned rate : 5;
+    unsigned channel : 4;
+    unsigned sig_len : 12;
+    unsigned timestamp : 32;
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t payload[0];
+} wifi_promiscuous_pkt_t;
+
+#endif
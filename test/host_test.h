@@ -0,0 +1,38 @@
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+// Checks for the host tests. A failed CHECK is reported and counted, the test goes on;
+// main() returns hostTestResult() so ctest sees the failure.
+#include <stdio.h>
+#include <string.h>
+
+static int hostTestFailures = 0;
+
+#define CHECK(cond)                                                                                      \
+    do {                                                                                                 \
+        if (!(cond)) {                                                                                   \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);                     \
+            hostTestFailures++;                                                                          \
+        }                                                                                                \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                                   \
+    do {                                                                                                 \
+        const long long va_ = (long long)(a), vb_ = (long long)(b);                                      \
+        if (va_ != vb_) {                                                                                \
+            fprintf(stderr, "%s:%d: %s == %s: %lld != %lld\n", __FILE__, __LINE__, #a, #b, va_, vb_);     \
+            hostTestFailures++;                                                                          \
+        }                                                                                                \
+    } while (0)
+
+#define CHECK_STR(a, b) CHECK(strcmp((a), (b)) == 0)
+
+static inline int hostTestResult(const char *name) {
+    if (hostTestFailures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, hostTestFailures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+#endif
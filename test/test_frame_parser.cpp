@@ -0,0 +1,169 @@
+// parseWifiFrame() on the frames of data/frame_parser.pcap: management frames with and without an
+// SSID IE (first, later, cut short, at the very end), data frames in every DS direction, QoS and
+// 4-address EAPOL, control frames and frames too short for a header. Every prefix of every frame
+// is parsed from an exactly sized copy as well, so a read past the end shows up under ASan.
+#include "host_test.h"
+#include "modules/wifi/frame_parser.h"
+#include <string>
+#include <vector>
+
+struct Expected {
+    bool parsed;
+    uint8_t type;
+    uint8_t subtype;
+    uint16_t classes;
+    uint8_t addr2; // offsets into the frame, 0 for nullptr
+    uint8_t bssid;
+    uint8_t apAddr;
+    uint16_t headerLen;
+    const char *ssid; // nullptr when there is no SSID IE
+    uint16_t ssidOffset;
+    uint16_t eapolOffset;
+};
+
+static const uint16_t BEACON = WIFI_FRAME_BEACON, PROBE_REQ = WIFI_FRAME_PROBE_REQ;
+static const uint16_t PROBE_RESP = WIFI_FRAME_PROBE_RESP, DEAUTH = WIFI_FRAME_DEAUTH;
+static const uint16_t MGMT = WIFI_FRAME_MGMT_OTHER, DATA = WIFI_FRAME_DATA, CTRL = WIFI_FRAME_CTRL;
+static const uint16_t EAPOL = WIFI_FRAME_DATA | WIFI_FRAME_EAPOL;
+
+// In the order of the capture. AP 02:00:00:00:00:01, client 0a:00:00:00:00:02
+static const Expected EXPECTED[] = {
+    {true, 0, 0x8, BEACON, 10, 16, 10, 24, "HomeNet", 38, 0},  // beacon
+    {true, 0, 0x4, PROBE_REQ, 10, 16, 4, 24, "", 26, 0},       // wildcard probe request
+    {true, 0, 0x4, PROBE_REQ, 10, 16, 4, 24, "HomeNet", 26, 0}, // directed probe request
+    {true, 0, 0x5, PROBE_RESP, 10, 16, 10, 24, "HomeNet", 38, 0},
+    {true, 0, 0xC, DEAUTH, 10, 16, 10, 24, nullptr, 0, 0},     // deauthentication
+    {true, 0, 0xA, DEAUTH, 10, 16, 4, 24, nullptr, 0, 0},      // disassociation
+    {true, 0, 0xB, MGMT, 10, 16, 4, 24, nullptr, 0, 0},        // authentication
+    {true, 0, 0x0, MGMT, 10, 16, 4, 24, "HomeNet", 30, 0},     // association request
+    {true, 0, 0x2, MGMT, 10, 16, 4, 24, "HomeNet", 36, 0},     // reassociation request
+    {true, 0, 0x8, BEACON, 10, 16, 10, 24, "Second", 48, 0},   // SSID after the rates
+    {true, 0, 0x8, BEACON, 10, 16, 10, 24, nullptr, 0, 0},     // SSID IE longer than the frame
+    {true, 2, 0x0, DATA, 10, 4, 10, 24, nullptr, 0, 0},        // to DS
+    {true, 2, 0x0, DATA, 10, 10, 10, 24, nullptr, 0, 0},       // from DS
+    {true, 2, 0x0, DATA, 10, 0, 10, 30, nullptr, 0, 0},        // WDS, addr4
+    {true, 2, 0x8, EAPOL, 10, 10, 10, 26, nullptr, 0, 34},     // QoS EAPOL M1
+    {true, 2, 0x0, EAPOL, 10, 4, 4, 24, nullptr, 0, 32},       // EAPOL M2
+    {true, 2, 0x8, EAPOL, 10, 0, 10, 32, nullptr, 0, 40},      // QoS WDS EAPOL
+    {true, 2, 0xC, DATA, 10, 4, 4, 26, nullptr, 0, 0},         // QoS null
+    {true, 2, 0x8, DATA, 10, 4, 4, 26, nullptr, 0, 0},         // EAPOL SNAP, too short for a header
+    {true, 2, 0x8, DATA, 10, 4, 4, 26, nullptr, 0, 0},         // QoS IPv4
+    {true, 1, 0xB, CTRL, 10, 0, 0, 16, nullptr, 0, 0},         // RTS
+    {true, 1, 0xD, CTRL, 0, 0, 0, 10, nullptr, 0, 0},          // ACK
+    {true, 1, 0xC, CTRL, 0, 0, 0, 10, nullptr, 0, 0},          // CTS
+    {false, 0, 0, 0, 0, 0, 0, 0, nullptr, 0, 0},               // 9 bytes
+    {false, 0, 0, 0, 0, 0, 0, 0, nullptr, 0, 0},               // management, 23 bytes
+    {false, 0, 0, 0, 0, 0, 0, 0, nullptr, 0, 0},               // data, 20 bytes
+    {true, 0, 0x8, BEACON, 10, 16, 10, 24, nullptr, 0, 0},     // beacon without IEs
+    {true, 0, 0x8, BEACON, 10, 16, 10, 24, "AtTheEnd", 48, 0}, // SSID IE ending the frame
+    {true, 0, 0xD, MGMT, 10, 16, 4, 24, nullptr, 0, 0},        // action, no IEs to look at
+    {true, 3, 0x0, 0, 10, 0, 4, 24, nullptr, 0, 0},            // reserved type
+};
+static const size_t EXPECTED_COUNT = sizeof(EXPECTED) / sizeof(EXPECTED[0]);
+
+static uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Little-endian classic pcap, 802.11 without radiotap
+static std::vector<std::vector<uint8_t>> loadFrames(const char *path) {
+    std::vector<std::vector<uint8_t>> frames;
+    FILE *f = fopen(path, "rb");
+    if (!f) return frames;
+    uint8_t hdr[24];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || get32(hdr) != 0xa1b2c3d4 || get32(hdr + 20) != 105) {
+        fclose(f);
+        return frames;
+    }
+    uint8_t rec[16];
+    while (fread(rec, 1, sizeof(rec), f) == sizeof(rec)) {
+        std::vector<uint8_t> frame(get32(rec + 8));
+        if (fread(frame.data(), 1, frame.size(), f) != frame.size()) break;
+        frames.push_back(frame);
+    }
+    fclose(f);
+    return frames;
+}
+
+static uint8_t offsetOf(const WifiFrameDesc &d, const uint8_t *p) { return p ? (uint8_t)(p - d.frame) : 0; }
+
+static bool matches(const WifiFrameDesc &d, bool parsed, const Expected &e) {
+    if (parsed != e.parsed) return false;
+    if (!parsed) return true;
+    if (d.type != e.type || d.subtype != e.subtype || d.classes != e.classes) return false;
+    if (offsetOf(d, d.addr1) != 4 || offsetOf(d, d.addr2) != e.addr2) return false;
+    if (offsetOf(d, d.addr3) != (e.type == 1 ? 0 : 16)) return false;
+    if (offsetOf(d, d.bssid) != e.bssid || offsetOf(d, d.apAddr) != e.apAddr) return false;
+    if (d.headerLen != e.headerLen || d.eapolOffset != e.eapolOffset) return false;
+    if (!e.ssid) return d.ssidOffset == 0 && d.ssidLen == 0;
+    const std::string ssid((const char *)d.frame + d.ssidOffset, d.ssidLen);
+    return d.ssidOffset == e.ssidOffset && ssid == e.ssid;
+}
+
+static void testCapture(const std::vector<std::vector<uint8_t>> &frames) {
+    CHECK_EQ(frames.size(), EXPECTED_COUNT);
+    for (size_t i = 0; i < frames.size() && i < EXPECTED_COUNT; ++i) {
+        WifiFrameDesc d;
+        const bool parsed = parseWifiFrame(frames[i].data(), frames[i].size(), -40 - i, 1 + i % 13, d);
+        if (!matches(d, parsed, EXPECTED[i])) {
+            fprintf(
+                stderr,
+                "frame %zu: parsed %d type %u subtype %u classes 0x%x header %u ssid %u+%u eapol %u\n",
+                i,
+                parsed,
+                d.type,
+                d.subtype,
+                d.classes,
+                d.headerLen,
+                d.ssidOffset,
+                d.ssidLen,
+                d.eapolOffset
+            );
+            CHECK(false);
+            continue;
+        }
+        if (!parsed) continue;
+        CHECK(d.frame == frames[i].data());
+        CHECK_EQ(d.len, frames[i].size());
+        CHECK_EQ(d.rssi, -40 - (int)i);
+        CHECK_EQ(d.channel, 1 + i % 13);
+    }
+}
+
+// Cut anywhere, a frame parses once its header fits and never yields an SSID or EAPOL offset past
+// its end
+static void testPrefixes(const std::vector<std::vector<uint8_t>> &frames) {
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const size_t headerMin = (frames[i][0] & 0x0C) == 0x04 ? 10 : 24;
+        for (size_t len = 0; len <= frames[i].size(); ++len) {
+            std::vector<uint8_t> cut(frames[i].begin(), frames[i].begin() + len);
+            WifiFrameDesc d;
+            const bool parsed = parseWifiFrame(len ? cut.data() : nullptr, len, 0, 0, d);
+            const bool inside =
+                (size_t)d.ssidOffset + d.ssidLen <= len && (!d.eapolOffset || d.eapolOffset + 4u <= len);
+            if (parsed != (len >= headerMin) || !inside) {
+                fprintf(
+                    stderr,
+                    "frame %zu cut to %zu bytes: parsed %d, ssid %u+%u, eapol %u\n",
+                    i,
+                    len,
+                    parsed,
+                    d.ssidOffset,
+                    d.ssidLen,
+                    d.eapolOffset
+                );
+                CHECK(false);
+                return;
+            }
+        }
+    }
+}
+
+int main() {
+    const std::vector<std::vector<uint8_t>> frames = loadFrames(BRUCE_TEST_DATA "/frame_parser.pcap");
+    if (frames.empty()) {
+        fprintf(stderr, "cannot read %s\n", BRUCE_TEST_DATA "/frame_parser.pcap");
+        CHECK(false);
+    }
+    testCapture(frames);
+    testPrefixes(frames);
+    return hostTestResult("test_frame_parser");
+}
@@ -0,0 +1,217 @@
+// GpsFeed and NmeaFramer: the framer on single sentences (checksums, cut-offs, the 82 character
+// limit), then data/gps_nmea.log (30 s of a u-blox receiver at 1 Hz, with two corrupted sentences,
+// an overlong PUBX,03 and a sentence cut short by lost bytes) replayed from a producer thread in
+// UART-sized chunks at ten times 9600 baud, while the consumer drains in odd-sized batches and
+// stalls once for 3 s of data. Every byte has to reach the parser in order and the counts match.
+#include "host_test.h"
+#include "modules/gps/gps_feed.h"
+#include <chrono>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t RING_BYTES = 4096; // GpsService::RING_BYTES
+static const uint32_t LOG_SENTENCES = 237, LOG_BAD_CHECKSUM = 2, LOG_TRUNCATED = 2;
+
+// Stands in for TinyGPSPlus: keeps every byte and the sentences, '$' to <CR>
+struct RecordingParser {
+    std::string bytes;
+    std::vector<std::string> sentences;
+
+    bool encode(char c) {
+        bytes += c;
+        if (c == '$') sentences.emplace_back();
+        if (sentences.empty()) return false;
+        std::string &s = sentences.back();
+        if (s.empty() || s.back() != '\r') s += c;
+        return false;
+    }
+};
+
+// "$body*hh"
+static std::string sentence(const std::string &body) {
+    uint8_t sum = 0;
+    for (char c : body) sum ^= (uint8_t)c;
+    char star[4];
+    snprintf(star, sizeof(star), "*%02X", sum);
+    return "$" + body + star;
+}
+
+static NmeaFramer::Result framerResult(const std::string &text) {
+    NmeaFramer framer;
+    NmeaFramer::Result last = NmeaFramer::NONE;
+    for (char c : text) {
+        const NmeaFramer::Result r = framer.feed(c);
+        if (r != NmeaFramer::NONE) last = r;
+    }
+    return last;
+}
+
+static void testFramer() {
+    const std::string gll = sentence("GPGLL,4808.23043,N,01134.57306,E,102407.00,A,A");
+    CHECK_EQ(framerResult(gll + "\r\n"), NmeaFramer::SENTENCE);
+    CHECK_EQ(framerResult(gll + "\n"), NmeaFramer::SENTENCE);
+    CHECK_EQ(framerResult("\x7f\xfe" + gll + "\r\n"), NmeaFramer::SENTENCE); // noise before the '$'
+    CHECK_EQ(framerResult("$GPTXT,01,01,02,ANTSTATUS=OK*3b\r\n"), NmeaFramer::SENTENCE); // lower case hex
+    CHECK_EQ(framerResult(gll), NmeaFramer::NONE);                                        // not ended yet
+
+    std::string bad = gll;
+    bad[bad.size() - 1] ^= 1;
+    CHECK_EQ(framerResult(bad + "\r\n"), NmeaFramer::BAD_CHECKSUM);
+    bad = gll;
+    bad[10] ^= 1;
+    CHECK_EQ(framerResult(bad + "\r\n"), NmeaFramer::BAD_CHECKSUM);
+    CHECK_EQ(framerResult(gll.substr(0, gll.size() - 1) + "G\r\n"), NmeaFramer::BAD_CHECKSUM);
+    CHECK_EQ(framerResult(gll + "7\r\n"), NmeaFramer::BAD_CHECKSUM);
+    CHECK_EQ(framerResult(gll.substr(0, gll.size() - 3) + "\r\n"), NmeaFramer::TRUNCATED);
+    CHECK_EQ(framerResult(gll.substr(0, gll.size() - 1) + "\r\n"), NmeaFramer::TRUNCATED);
+    CHECK_EQ(framerResult(gll.substr(0, 24) + gll), NmeaFramer::TRUNCATED); // cut by the next '$'
+
+    // 82 characters from '$' to <LF> is the most NMEA allows
+    std::string body = "GPTXT";
+    while (body.size() < 82 - 5) body += ',';
+    const std::string longest = sentence(body) + "\n";
+    CHECK_EQ(longest.size(), 82);
+    CHECK_EQ(framerResult(longest), NmeaFramer::SENTENCE);
+    const std::string overlong = sentence(body + ",") + "\r\n";
+    NmeaFramer framer;
+    int cuts = 0;
+    for (char c : overlong) cuts += framer.feed(c) == NmeaFramer::TRUNCATED;
+    CHECK_EQ(cuts, 1);
+    CHECK_EQ(framerResult(gll + "\r\n" + overlong + gll + "\r\n"), NmeaFramer::SENTENCE);
+}
+
+static std::string readLog(const char *path) {
+    std::string out;
+    FILE *f = fopen(path, "rb");
+    if (!f) return out;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return out;
+}
+
+// The sentences in the log that end in a good checksum, without relying on NmeaFramer
+static std::vector<std::string> goodSentences(const std::string &log) {
+    std::vector<std::string> good;
+    size_t at = 0;
+    while ((at = log.find('$', at)) != std::string::npos) {
+        const size_t end = log.find_first_of("$\r\n", at + 1);
+        const std::string s = log.substr(at, end == std::string::npos ? std::string::npos : end - at);
+        at = end;
+        if (end == std::string::npos || log[end] == '$' || s.size() + 1 > NmeaFramer::MAX_SENTENCE) continue;
+        const size_t star = s.find('*');
+        if (star == std::string::npos || star + 3 != s.size()) continue;
+        uint8_t sum = 0;
+        for (size_t i = 1; i < star; ++i) sum ^= (uint8_t)s[i];
+        if (strtoul(s.c_str() + star + 1, nullptr, 16) == sum) good.push_back(s + "\r");
+    }
+    return good;
+}
+
+// One fix a second: each epoch starts at an RMC and goes out in one burst, 120 byte FIFO chunks
+// at 9600 baud, then the line is idle until the next second. Everything runs ten times as fast.
+static void replay(GpsFeed<RING_BYTES> &feed, const std::string &log) {
+    using namespace std::chrono;
+    const double speedup = 10, bytesPerSecond = 960 * speedup;
+    const auto start = steady_clock::now();
+    size_t at = 0;
+    for (int epoch = 0; at < log.size(); ++epoch) {
+        size_t end = log.find("$GPRMC", at + 1);
+        if (end == std::string::npos) end = log.size();
+        const auto epochStart = start + microseconds((int64_t)(epoch * 1e6 / speedup));
+        std::this_thread::sleep_until(epochStart);
+        for (size_t sent = at; sent < end;) {
+            const size_t n = end - sent < 120 ? end - sent : 120;
+            const auto due = epochStart + microseconds((int64_t)((sent + n - at) * 1e6 / bytesPerSecond));
+            std::this_thread::sleep_until(due);
+            feed.receive((const uint8_t *)log.data() + sent, n);
+            sent += n;
+        }
+        at = end;
+    }
+}
+
+static void testReplay() {
+    const std::string log = readLog(BRUCE_TEST_DATA "/gps_nmea.log");
+    CHECK(!log.empty());
+    if (log.empty()) return;
+    const std::vector<std::string> good = goodSentences(log);
+    CHECK_EQ(good.size(), LOG_SENTENCES);
+
+    static GpsFeed<RING_BYTES> feed;
+    feed.reset();
+    RecordingParser parser;
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        replay(feed, log);
+        done.store(true);
+    });
+    // The GPS task: woken every 10 ms (100 ms on the device), 37 bytes at a time so sentences
+    // straddle drain() calls, and once held up for 300 ms by something else on its core
+    bool stalled = false;
+    while (true) {
+        const bool last = done.load();
+        while (feed.drain(parser, 37) > 0) {
+        }
+        if (last) break;
+        if (!stalled && feed.received() > log.size() / 3) {
+            stalled = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    producer.join();
+
+    const GpsFeedStats stats = feed.stats();
+    CHECK(stalled);
+    CHECK_EQ(stats.bytes, log.size());
+    CHECK_EQ(stats.overflowBytes, 0);
+    CHECK_EQ(feed.pending(), 0);
+    CHECK(parser.bytes == log);
+    CHECK_EQ(stats.sentences, LOG_SENTENCES);
+    CHECK_EQ(stats.badChecksum, LOG_BAD_CHECKSUM);
+    CHECK_EQ(stats.truncated, LOG_TRUNCATED);
+
+    // the good ones came through whole and in order among everything the parser saw
+    size_t next = 0;
+    for (const std::string &s : parser.sentences) {
+        if (next < good.size() && s == good[next]) next++;
+    }
+    CHECK_EQ(next, good.size());
+}
+
+// A consumer that stops draining loses the bytes past the ring, counted. The sentence the gap cuts
+// into is spliced onto whatever comes next and never passes as a good one.
+static void testOverflow() {
+    const std::string log = readLog(BRUCE_TEST_DATA "/gps_nmea.log");
+    if (log.size() < 2 * RING_BYTES + 600) return;
+    static GpsFeed<RING_BYTES> feed;
+    feed.reset();
+    RecordingParser parser;
+    feed.receive((const uint8_t *)log.data(), 2 * RING_BYTES);
+    feed.drain(parser, SIZE_MAX);
+    GpsFeedStats stats = feed.stats();
+    CHECK_EQ(stats.bytes, 2 * RING_BYTES);
+    CHECK_EQ(stats.overflowBytes, RING_BYTES);
+    CHECK(parser.bytes == log.substr(0, RING_BYTES));
+    const uint32_t before = stats.sentences, lost = stats.badChecksum + stats.truncated;
+    CHECK_EQ(before, goodSentences(parser.bytes).size());
+
+    const std::string after = log.substr(2 * RING_BYTES, 600);
+    feed.receive((const uint8_t *)after.data(), after.size());
+    feed.drain(parser, SIZE_MAX);
+    stats = feed.stats();
+    CHECK_EQ(stats.sentences - before, goodSentences(after.substr(after.find('$'))).size());
+    CHECK(stats.badChecksum + stats.truncated > lost);
+}
+
+int main() {
+    testFramer();
+    testReplay();
+    testOverflow();
+    return hostTestResult("test_gps_feed");
+}
@@ -0,0 +1,180 @@
+// Hc22000Extractor on synthetic EAPOL-Key frames: PMKID and message pair lines, replay counter
+// checks, deduplication, a full dedup set and ESSIDs with bytes outside the printable range.
+#include "host_test.h"
+#include "modules/wifi/hc22000.h"
+#include <string>
+#include <vector>
+
+static const uint8_t AP[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t STA[6] = {0x0A, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
+static const uint16_t KEY_M1 = 0x008A; // pairwise, ack
+static const uint16_t KEY_M2 = 0x010A; // pairwise, mic
+static const uint16_t KEY_M3 = 0x13CA; // pairwise, install, ack, mic, secure
+
+struct Frame {
+    std::vector<uint8_t> bytes;
+    WifiFrameDesc desc;
+};
+
+// Data frame carrying one EAPOL-Key, AP to station when fromAp
+static Frame eapolFrame(
+    bool fromAp, uint16_t keyInfo, uint64_t replay, uint8_t fill, const std::vector<uint8_t> &keyData = {}
+) {
+    Frame f;
+    std::vector<uint8_t> &b = f.bytes;
+    b = {0x08, (uint8_t)(fromAp ? 0x02 : 0x01), 0, 0};
+    const uint8_t *a1 = fromAp ? STA : AP;
+    const uint8_t *a2 = fromAp ? AP : STA;
+    b.insert(b.end(), a1, a1 + 6);
+    b.insert(b.end(), a2, a2 + 6);
+    b.insert(b.end(), AP, AP + 6);
+    b.push_back(0);
+    b.push_back(0);
+    const uint8_t llc[8] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8E};
+    b.insert(b.end(), llc, llc + 8);
+
+    std::vector<uint8_t> e(EAPOL_KEY_DATA, 0);
+    const size_t bodyLen = EAPOL_KEY_DATA - 4 + keyData.size();
+    e[0] = 2;
+    e[1] = 3;
+    e[2] = bodyLen >> 8;
+    e[3] = bodyLen & 0xFF;
+    e[4] = 2;
+    e[EAPOL_KEY_INFO] = keyInfo >> 8;
+    e[EAPOL_KEY_INFO + 1] = keyInfo & 0xFF;
+    for (int i = 0; i < 8; ++i) e[EAPOL_KEY_REPLAY + i] = (uint8_t)(replay >> (56 - 8 * i));
+    for (int i = 0; i < 32; ++i) e[EAPOL_KEY_NONCE + i] = fill + i;
+    if (keyInfo & (1 << 8)) {
+        for (int i = 0; i < 16; ++i) e[EAPOL_KEY_MIC + i] = fill ^ (0x80 + i);
+    }
+    e[EAPOL_KEY_DATA_LEN] = keyData.size() >> 8;
+    e[EAPOL_KEY_DATA_LEN + 1] = keyData.size() & 0xFF;
+    e.insert(e.end(), keyData.begin(), keyData.end());
+    b.insert(b.end(), e.begin(), e.end());
+
+    parseWifiFrame(b.data(), b.size(), -40, 6, f.desc);
+    return f;
+}
+
+static std::vector<uint8_t> pmkidKde(uint8_t fill) {
+    std::vector<uint8_t> kd = {0xDD, 20, 0x00, 0x0F, 0xAC, 0x04};
+    for (int i = 0; i < 16; ++i) kd.push_back(fill + i);
+    return kd;
+}
+
+static std::string hex(const uint8_t *data, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < len; ++i) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0x0F];
+    }
+    return out;
+}
+
+static std::vector<std::string> lines;
+static void collect(void *, const char *line) { lines.push_back(line); }
+
+// "Caf\xE9" plus a control byte, the ESSID goes out as broadcast
+static const char ESSID[] = "Caf\xE9\x01net";
+static const size_t ESSID_LEN = sizeof(ESSID) - 1;
+
+static void testPmkid() {
+    Hc22000Extractor ex;
+    CHECK(ex.init(64));
+    ex.setEmitter(collect, nullptr);
+    lines.clear();
+
+    Frame m1 = eapolFrame(true, KEY_M1, 1, 0x10, pmkidKde(0x40));
+    CHECK(m1.desc.is(WIFI_FRAME_EAPOL));
+    ex.feed(m1.desc, ESSID, ESSID_LEN, 0);
+    CHECK_EQ(lines.size(), 1);
+    const std::vector<uint8_t> kd = pmkidKde(0x40);
+    const std::string expect = "WPA*01*" + hex(kd.data() + 6, 16) + "*" + hex(AP, 6) + "*" + hex(STA, 6) +
+                               "*" + hex((const uint8_t *)ESSID, ESSID_LEN) + "***";
+    if (!lines.empty()) CHECK_STR(lines[0].c_str(), expect.c_str());
+    CHECK_EQ(ex.stats().pmkids, 1);
+
+    // retransmitted M1, same PMKID
+    ex.feed(m1.desc, ESSID, ESSID_LEN, 1);
+    CHECK_EQ(lines.size(), 1);
+    CHECK_EQ(ex.stats().duplicates, 1);
+
+    // unknown ESSID, nothing can be written
+    ex.feed(eapolFrame(true, KEY_M1, 2, 0x11, pmkidKde(0x50)).desc, ESSID, 0, 2);
+    CHECK_EQ(lines.size(), 1);
+}
+
+static void testPairs() {
+    Hc22000Extractor ex;
+    CHECK(ex.init(64));
+    ex.setEmitter(collect, nullptr);
+    lines.clear();
+
+    Frame m1 = eapolFrame(true, KEY_M1, 5, 0x10);
+    Frame m2 = eapolFrame(false, KEY_M2, 5, 0x20);
+    ex.feed(m1.desc, ESSID, ESSID_LEN, 0);
+    CHECK_EQ(lines.size(), 0); // no PMKID in this M1
+    ex.feed(m2.desc, ESSID, ESSID_LEN, 1);
+    CHECK_EQ(lines.size(), 1);
+    CHECK_EQ(ex.stats().pairs, 1);
+
+    // EAPOL field is M2 with the MIC zeroed, ANonce comes from M1
+    std::vector<uint8_t> eapol(m2.bytes.begin() + m2.desc.eapolOffset, m2.bytes.end());
+    const uint8_t *mic = m2.bytes.data() + m2.desc.eapolOffset + EAPOL_KEY_MIC;
+    memset(eapol.data() + EAPOL_KEY_MIC, 0, 16);
+    const uint8_t *anonce = m1.bytes.data() + m1.desc.eapolOffset + EAPOL_KEY_NONCE;
+    const std::string expect = "WPA*02*" + hex(mic, 16) + "*" + hex(AP, 6) + "*" + hex(STA, 6) + "*" +
+                               hex((const uint8_t *)ESSID, ESSID_LEN) + "*" + hex(anonce, 32) + "*" +
+                               hex(eapol.data(), eapol.size()) + "*00";
+    if (!lines.empty()) CHECK_STR(lines[0].c_str(), expect.c_str());
+
+    // M3 pairs with the same M2 MIC, already written
+    ex.feed(eapolFrame(true, KEY_M3, 6, 0x10).desc, ESSID, ESSID_LEN, 2);
+    CHECK_EQ(lines.size(), 1);
+    CHECK_EQ(ex.stats().duplicates, 1);
+
+    // M2/M3 without M1, message pair 02
+    ex.reset();
+    lines.clear();
+    ex.feed(eapolFrame(false, KEY_M2, 9, 0x30).desc, ESSID, ESSID_LEN, 3);
+    CHECK_EQ(lines.size(), 0);
+    ex.feed(eapolFrame(true, KEY_M3, 10, 0x31).desc, ESSID, ESSID_LEN, 4);
+    CHECK_EQ(lines.size(), 1);
+    if (!lines.empty()) CHECK(lines[0].size() > 3 && lines[0].compare(lines[0].size() - 3, 3, "*02") == 0);
+
+    // replay counters that do not line up are not paired
+    ex.reset();
+    lines.clear();
+    ex.feed(eapolFrame(true, KEY_M1, 20, 0x40).desc, ESSID, ESSID_LEN, 5);
+    ex.feed(eapolFrame(false, KEY_M2, 21, 0x41).desc, ESSID, ESSID_LEN, 6);
+    ex.feed(eapolFrame(true, KEY_M3, 30, 0x40).desc, ESSID, ESSID_LEN, 7);
+    CHECK_EQ(lines.size(), 0);
+    CHECK_EQ(ex.stats().replayMismatch, 2);
+}
+
+// 8 slots take 6 hashes, the 7th starts the set over instead of being dropped as a duplicate
+static void testDedupFull() {
+    Hc22000Extractor ex;
+    CHECK(ex.init(8));
+    ex.setEmitter(collect, nullptr);
+    lines.clear();
+    for (uint8_t i = 0; i < 10; ++i) {
+        ex.feed(eapolFrame(true, KEY_M1, i, i, pmkidKde(0x10 * i + 1)).desc, ESSID, ESSID_LEN, i);
+    }
+    CHECK_EQ(lines.size(), 10);
+    CHECK_EQ(ex.stats().pmkids, 10);
+    CHECK_EQ(ex.stats().duplicates, 0);
+    CHECK_EQ(ex.stats().dedupResets, 1);
+    // the set still deduplicates what came in after the reset
+    ex.feed(eapolFrame(true, KEY_M1, 9, 9, pmkidKde(0x10 * 9 + 1)).desc, ESSID, ESSID_LEN, 11);
+    CHECK_EQ(lines.size(), 10);
+    CHECK_EQ(ex.stats().duplicates, 1);
+}
+
+int main() {
+    testPmkid();
+    testPairs();
+    testDedupFull();
+    return hostTestResult("test_hc22000");
+}
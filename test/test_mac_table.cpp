@@ -0,0 +1,154 @@
+// MacTable and MacSsidTable: find/insert/erase against a std::map model, the 3/4 load limit,
+// eraseIf() across wrapped probe chains and SSIDs of one MAC whose 16-bit hashes collide.
+#include "host_test.h"
+#include "modules/wifi/mac_table.h"
+#include <map>
+#include <random>
+#include <string>
+
+static void testMacKey() {
+    const uint8_t mac[6] = {0x00, 0x11, 0x22, 0xAA, 0xBB, 0xCC};
+    const uint64_t key = macKey(mac);
+    CHECK(key == 0x001122AABBCCull);
+    uint8_t back[6];
+    macFromKey(key, back);
+    CHECK(memcmp(mac, back, 6) == 0);
+}
+
+static void testBasic() {
+    MacTable<int> table;
+    CHECK(table.insert(1) == nullptr); // not allocated
+    CHECK(table.init(10));
+    CHECK_EQ(table.capacity(), 16);
+    CHECK(table.init(1000)); // no-op once allocated
+    CHECK_EQ(table.capacity(), 16);
+
+    bool created = false;
+    int *v = table.insert(42, &created);
+    CHECK(v && created && *v == 0);
+    *v = 7;
+    v = table.insert(42, &created);
+    CHECK(v && !created && *v == 7);
+    CHECK(table.contains(42));
+    CHECK(!table.contains(43));
+
+    // 3/4 of 16 slots
+    for (uint64_t k = 100; k < 111; ++k) CHECK(table.insert(k));
+    CHECK_EQ(table.size(), 12);
+    CHECK(table.insert(200) == nullptr);
+    CHECK_EQ(table.rejected(), 1);
+    CHECK(table.insert(42) != nullptr); // existing keys are still found when full
+
+    CHECK(table.erase(42));
+    CHECK(!table.erase(42));
+    CHECK(table.insert(200) != nullptr);
+
+    size_t seen = 0;
+    for (const auto &entry : table) {
+        CHECK(table.contains(entry.key()));
+        seen++;
+    }
+    CHECK_EQ(seen, table.size());
+
+    table.clear();
+    CHECK(table.empty());
+    CHECK(!table.contains(100));
+    table.release();
+    CHECK(!table.ready());
+    CHECK(table.find(100) == nullptr);
+}
+
+// Random operations checked against std::map, small table so chains collide and wrap
+static void testAgainstModel() {
+    MacTable<uint32_t> table;
+    CHECK(table.init(64));
+    std::map<uint64_t, uint32_t> model;
+    std::mt19937 rng(1234);
+    for (int step = 0; step < 200000; ++step) {
+        const uint64_t key = rng() % 96;
+        switch (rng() % 4) {
+        case 0:
+        case 1: {
+            uint32_t *v = table.insert(key);
+            if (v) {
+                *v = step;
+                model[key] = step;
+            } else {
+                CHECK(model.count(key) == 0 && model.size() == 48);
+            }
+            break;
+        }
+        case 2: CHECK_EQ(table.erase(key), model.erase(key)); break;
+        default: {
+            // drop every key of one residue, walks the whole table like the sniffer's prune
+            const uint64_t residue = rng() % 5;
+            const size_t removed = table.eraseIf([&](uint64_t k, uint32_t) { return k % 5 == residue; });
+            size_t expected = 0;
+            for (auto it = model.begin(); it != model.end();) {
+                if (it->first % 5 == residue) {
+                    it = model.erase(it);
+                    expected++;
+                } else {
+                    ++it;
+                }
+            }
+            CHECK_EQ(removed, expected);
+        }
+        }
+        if (step % 1000 == 0) {
+            CHECK_EQ(table.size(), model.size());
+            for (const auto &kv : model) {
+                const uint32_t *v = table.find(kv.first);
+                CHECK(v && *v == kv.second);
+            }
+        }
+    }
+}
+
+static uint16_t low16(const std::string &ssid) { return (uint16_t)ssidHash(ssid.data(), ssid.size()); }
+
+static void testMacSsidCollisions() {
+    // two SSIDs whose hashes share the low 16 bits, the table keys on exactly those
+    std::map<uint16_t, std::string> seen;
+    std::string a, b;
+    for (int i = 0; a.empty(); ++i) {
+        const std::string ssid = "net" + std::to_string(i);
+        auto it = seen.find(low16(ssid));
+        if (it != seen.end()) {
+            a = it->second;
+            b = ssid;
+        } else {
+            seen[low16(ssid)] = ssid;
+        }
+    }
+
+    MacSsidTable table;
+    CHECK(table.init(64));
+    const uint8_t mac[6] = {1, 2, 3, 4, 5, 6};
+    const uint8_t other[6] = {1, 2, 3, 4, 5, 7};
+    CHECK(table.insert(mac, a.data(), a.size()));
+    CHECK(!table.contains(mac, b.data(), b.size()));
+    CHECK(table.insert(mac, b.data(), b.size()));
+    CHECK(!table.insert(mac, a.data(), a.size()));
+    CHECK(!table.insert(mac, b.data(), b.size()));
+    CHECK(table.contains(mac, a.data(), a.size()));
+    CHECK(table.contains(mac, b.data(), b.size()));
+    CHECK(!table.contains(other, a.data(), a.size()));
+    CHECK(table.insert(other, a.data(), a.size()));
+    CHECK_EQ(table.size(), 3);
+    CHECK_EQ(table.rejected(), 0);
+
+    // SSIDs longer than FixedSsid keep matching on the stored 32 bytes
+    const std::string longSsid(40, 'x');
+    CHECK(table.insert(mac, longSsid.data(), longSsid.size()));
+    CHECK(table.contains(mac, longSsid.data(), longSsid.size()));
+    CHECK(!table.insert(mac, longSsid.data(), longSsid.size()));
+}
+
+int main() {
+    testMacKey();
+    testBasic();
+    testAgainstModel();
+    testMacSsidCollisions();
+    return hostTestResult("test_mac_table");
+}
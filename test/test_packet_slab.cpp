@@ -0,0 +1,145 @@
+// SpscRing and PacketSlab: ordering, wrap-around, exhaustion accounting and a two-thread run of
+// the producer/consumer protocol the sniffer callback and writer task use.
+#include "host_test.h"
+#include "modules/wifi/packet_slab.h"
+#include <thread>
+#include <vector>
+
+static void testRingOrderAndWrap() {
+    SpscRing<uint32_t, 8> ring;
+    uint32_t v = 0;
+    CHECK(ring.empty());
+    CHECK(!ring.pop(v));
+    uint32_t next = 0, expect = 0;
+    // head and tail run far past the capacity so the index masking is exercised
+    for (int round = 0; round < 1000; ++round) {
+        const int batch = 1 + round % 8;
+        for (int i = 0; i < batch; ++i) CHECK(ring.push(next++));
+        CHECK_EQ(ring.size(), batch);
+        for (int i = 0; i < batch; ++i) {
+            CHECK(ring.pop(v));
+            CHECK_EQ(v, expect++);
+        }
+    }
+    for (uint32_t i = 0; i < 8; ++i) CHECK(ring.push(i));
+    CHECK(!ring.push(99));
+    CHECK_EQ(ring.size(), 8);
+    ring.reset();
+    CHECK(ring.empty());
+}
+
+static void testRingThreads() {
+    static SpscRing<uint32_t, 64> ring;
+    const uint32_t total = 200000;
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < total;) {
+            if (ring.push(i)) ++i;
+            else std::this_thread::yield(); // one core would spin out the whole time slice
+        }
+    });
+    uint32_t expect = 0, v;
+    bool ordered = true;
+    while (expect < total) {
+        if (!ring.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (v != expect) ordered = false;
+        ++expect;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK(ring.empty());
+}
+
+static void testSlabExhaustion() {
+    std::vector<uint8_t> memory(4 * 64);
+    PacketSlab slab;
+    CHECK(!slab.init(nullptr, 4, 64));
+    CHECK(!slab.init(memory.data(), PacketSlab::MAX_SLOTS + 1, 64));
+    CHECK(slab.init(memory.data(), 4, 64));
+    CHECK(slab.ready());
+
+    uint16_t held[4];
+    for (auto &idx : held) {
+        idx = slab.acquire();
+        CHECK(idx != PacketSlab::INVALID_SLOT);
+    }
+    CHECK(slab.acquire() == PacketSlab::INVALID_SLOT);
+    PacketSlabStats s = slab.stats();
+    CHECK_EQ(s.slotExhausted, 1);
+    CHECK_EQ(s.dropped, 1);
+
+    // a cancelled slot is handed out again before the free ring
+    slab.cancel(held[3]);
+    CHECK_EQ(slab.acquire(), held[3]);
+
+    for (auto idx : held) CHECK(slab.commit(idx));
+    CHECK_EQ(slab.pending(), 4);
+    CHECK_EQ(slab.stats().highWater, 4);
+    uint16_t idx;
+    int seen = 0;
+    while (slab.next(idx)) {
+        CHECK_EQ(idx, held[seen++]);
+        slab.release(idx);
+    }
+    CHECK_EQ(seen, 4);
+    CHECK_EQ(slab.stats().queued, 4);
+
+    slab.deinit();
+    CHECK(!slab.ready());
+    CHECK(!slab.next(idx));
+}
+
+// Same protocol as snifferOnFrame() / snifferWriterTask(): each slot carries a sequence number,
+// the consumer must see every committed one exactly once and in order
+static void testSlabThreads() {
+    const uint16_t slots = 16, slotSize = 32;
+    std::vector<uint8_t> memory(slots * slotSize);
+    PacketSlab slab;
+    CHECK(slab.init(memory.data(), slots, slotSize));
+    const uint32_t frames = 100000;
+    std::thread producer([&] {
+        for (uint32_t seq = 0; seq < frames; ++seq) {
+            const uint16_t idx = slab.acquire();
+            if (idx == PacketSlab::INVALID_SLOT) continue; // dropped, counted by the slab
+            memcpy(slab.slot(idx), &seq, sizeof(seq));
+            slab.commit(idx);
+        }
+    });
+    uint32_t received = 0, last = 0;
+    bool ordered = true;
+    auto drain = [&] {
+        uint16_t idx;
+        while (slab.next(idx)) {
+            uint32_t seq;
+            memcpy(&seq, slab.slot(idx), sizeof(seq));
+            if (received && seq <= last) ordered = false;
+            last = seq;
+            received++;
+            slab.release(idx);
+        }
+    };
+    bool done = false;
+    while (!done) {
+        done = slab.stats().queued + slab.stats().dropped >= frames;
+        drain();
+        std::this_thread::yield();
+    }
+    producer.join();
+    drain();
+    const PacketSlabStats s = slab.stats();
+    CHECK(ordered);
+    CHECK_EQ(received, s.queued);
+    CHECK_EQ(s.queued + s.dropped, frames);
+    CHECK_EQ(s.dropped, s.slotExhausted);
+    CHECK(s.highWater <= slots);
+}
+
+int main() {
+    testRingOrderAndWrap();
+    testRingThreads();
+    testSlabExhaustion();
+    testSlabThreads();
+    return hostTestResult("test_packet_slab");
+}
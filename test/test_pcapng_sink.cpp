@@ -0,0 +1,337 @@
+// PcapngSink round trip: sections, interfaces and enhanced packet blocks with radiotap written to
+// memory and parsed back by a minimal reader that checks every block length, the trailing copy of
+// it, the padding and the options; frame bytes, timestamps and radiotap fields come back intact
+// whatever the buffer size, and the interface limit and a short write are reported.
+#include "host_test.h"
+#include "modules/wifi/pcapng_sink.h"
+#include <random>
+#include <string>
+#include <vector>
+
+struct MemFile {
+    std::vector<uint8_t> *data = nullptr;
+    size_t failAfter = SIZE_MAX; // bytes accepted before writes come up short
+
+    size_t write(const uint8_t *buf, size_t len) {
+        size_t n = len;
+        if (data->size() + n > failAfter) n = failAfter > data->size() ? failAfter - data->size() : 0;
+        data->insert(data->end(), buf, buf + n);
+        return n;
+    }
+    void flush() {}
+    void close() {}
+    explicit operator bool() const { return data != nullptr; }
+};
+
+static uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+struct Option {
+    uint16_t code;
+    std::string value;
+};
+
+struct Packet {
+    uint32_t iface;
+    uint64_t tsUsec;
+    uint32_t origLen;
+    std::vector<uint8_t> radiotap;
+    std::vector<uint8_t> frame;
+    std::string comment;
+};
+
+struct Interface {
+    uint16_t linktype;
+    uint32_t snaplen;
+    std::string name;
+    int tsresol = -1;
+};
+
+struct Parsed {
+    std::string application;
+    std::vector<Interface> interfaces;
+    std::vector<Packet> packets;
+    std::string error;
+};
+
+static bool zeros(const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (p[i]) return false;
+    }
+    return true;
+}
+
+// Options from `at` to the block trailer: padded to 4, zero padding, closed by opt_endofopt
+static bool readOptions(const uint8_t *b, size_t at, size_t end, std::vector<Option> &out) {
+    while (at + 4 <= end) {
+        const uint16_t code = get16(b + at), len = get16(b + at + 2);
+        at += 4;
+        if (code == 0) return len == 0 && at == end;
+        const size_t padded = (len + 3) & ~3u;
+        if (at + padded > end || !zeros(b + at + len, padded - len)) return false;
+        out.push_back({code, std::string((const char *)b + at, len)});
+        at += padded;
+    }
+    return false;
+}
+
+static Parsed readPcapng(const std::vector<uint8_t> &bytes) {
+    Parsed r;
+    const uint8_t *b = bytes.data();
+    size_t pos = 0;
+    auto fail = [&](const std::string &what) {
+        r.error = "block at " + std::to_string(pos) + ": " + what;
+        return r;
+    };
+    while (pos < bytes.size()) {
+        if (pos + 12 > bytes.size()) return fail("truncated");
+        const uint32_t type = get32(b + pos), total = get32(b + pos + 4);
+        if (total % 4 || total < 12 || pos + total > bytes.size()) {
+            return fail("length " + std::to_string(total));
+        }
+        if (get32(b + pos + total - 4) != total) return fail("the trailing length differs");
+        const size_t end = pos + total - 4;
+        std::vector<Option> options;
+        if (type == 0x0A0D0D0A) {
+            if (pos != 0 || total < 28 || get32(b + 8) != 0x1A2B3C4D || get16(b + 12) != 1 ||
+                get16(b + 14) != 0 || get32(b + 16) != 0xFFFFFFFF || get32(b + 20) != 0xFFFFFFFF) {
+                return fail("bad section header");
+            }
+            if (total > 28 && !readOptions(b, 24, end, options)) return fail("section options");
+            for (const Option &o : options) {
+                if (o.code == 4) r.application = o.value;
+            }
+        } else if (type == 1) {
+            Interface i;
+            i.linktype = get16(b + pos + 8);
+            i.snaplen = get32(b + pos + 12);
+            if (get16(b + pos + 10) || !readOptions(b, pos + 16, end, options)) return fail("bad interface");
+            for (const Option &o : options) {
+                if (o.code == 2) i.name = o.value;
+                if (o.code == 9 && o.value.size() == 1) i.tsresol = (uint8_t)o.value[0];
+            }
+            r.interfaces.push_back(i);
+        } else if (type == 6) {
+            Packet p;
+            p.iface = get32(b + pos + 8);
+            p.tsUsec = ((uint64_t)get32(b + pos + 12) << 32) | get32(b + pos + 16);
+            const uint32_t captured = get32(b + pos + 20);
+            p.origLen = get32(b + pos + 24);
+            const size_t padded = (captured + 3) & ~3u;
+            const uint8_t *data = b + pos + 28;
+            if (p.iface >= r.interfaces.size() || pos + 28 + padded > end) return fail("bad packet");
+            if (!zeros(data + captured, padded - captured)) return fail("packet padding");
+            const uint16_t rtLen = captured >= 4 ? get16(data + 2) : 0xFFFF;
+            if (rtLen > captured) return fail("bad radiotap");
+            p.radiotap.assign(data, data + rtLen);
+            p.frame.assign(data + rtLen, data + captured);
+            if (pos + 28 + padded < end && !readOptions(b, pos + 28 + padded, end, options)) {
+                return fail("packet options");
+            }
+            for (const Option &o : options) {
+                if (o.code == 1) p.comment = o.value;
+            }
+            r.packets.push_back(p);
+        } else {
+            return fail("unexpected type " + std::to_string(type));
+        }
+        pos += total;
+    }
+    return r;
+}
+
+struct Sent {
+    uint64_t tsUsec;
+    uint8_t channel;
+    int8_t rssi;
+    bool fcs;
+    std::vector<uint8_t> frame;
+    uint32_t origLen;
+    std::string comment;
+};
+
+// Every length modulo 4, empty to larger than the buffer, some truncated and some with comments
+static std::vector<Sent> makeFrames() {
+    std::mt19937 rng(5);
+    static const uint8_t channels[] = {1, 6, 11, 14, 36, 165, 6, 1};
+    std::vector<Sent> out;
+    uint64_t ts = 1700000000ull * 1000000;
+    for (int i = 0; i < 200; ++i) {
+        Sent s;
+        ts += 1 + rng() % 100000;
+        s.tsUsec = ts + ((uint64_t)(i % 3) << 40);
+        s.channel = channels[i % sizeof(channels)];
+        s.rssi = -(int)(rng() % 100);
+        s.fcs = i % 5 == 0;
+        const size_t len = i < 12 ? i : i % 17 == 0 ? 3000 + rng() % 500 : 24 + rng() % 1500;
+        s.frame.resize(len);
+        for (uint8_t &b : s.frame) b = rng();
+        s.origLen = i % 9 == 0 ? len + 100 : len;
+        if (i % 4 == 1) s.comment = std::string(i % 11, 'a' + i % 26);
+        if (i == 9) s.comment = std::string(300, 'z'); // cut at MAX_COMMENT_LEN
+        out.push_back(s);
+    }
+    return out;
+}
+
+static std::vector<uint8_t> writeAll(const std::vector<Sent> &frames, size_t bufferSize) {
+    std::vector<uint8_t> bytes, buffer(bufferSize);
+    MemFile file;
+    file.data = &bytes;
+    PcapngSink<MemFile> sink;
+    sink.setBuffer(bufferSize ? buffer.data() : nullptr, bufferSize);
+    CHECK(sink.attach(file, 0, "test_pcapng_sink"));
+    for (const Sent &s : frames) {
+        CHECK(sink.append(
+            s.tsUsec,
+            s.channel,
+            s.rssi,
+            s.fcs,
+            s.frame.data(),
+            s.frame.size(),
+            s.origLen,
+            0,
+            s.comment.empty() ? nullptr : s.comment.c_str()
+        ));
+    }
+    CHECK_EQ(sink.fileBytes(), bytes.size() + sink.buffered());
+    sink.close();
+    CHECK_EQ(sink.stats().failed, 0);
+    CHECK_EQ(sink.stats().frames, frames.size());
+    return bytes;
+}
+
+static void testRoundTrip() {
+    const std::vector<Sent> frames = makeFrames();
+    const std::vector<uint8_t> reference = writeAll(frames, 0);
+    const Parsed r = readPcapng(reference);
+    if (!r.error.empty()) {
+        fprintf(stderr, "%s\n", r.error.c_str());
+        CHECK(false);
+        return;
+    }
+    CHECK_STR(r.application.c_str(), "test_pcapng_sink");
+    // interfaces in order of first use, one per channel
+    static const char *const names[] = {"ch1", "ch6", "ch11", "ch14", "ch36", "ch165"};
+    CHECK_EQ(r.interfaces.size(), 6);
+    for (size_t i = 0; i < r.interfaces.size() && i < 6; ++i) {
+        CHECK_EQ(r.interfaces[i].linktype, PCAP_LINKTYPE_IEEE802_11_RADIOTAP);
+        CHECK_EQ(r.interfaces[i].snaplen, PCAP_DEFAULT_SNAPLEN + RADIOTAP_HEADER_LEN);
+        CHECK_STR(r.interfaces[i].name.c_str(), names[i]);
+        CHECK_EQ(r.interfaces[i].tsresol, 6);
+    }
+    CHECK_EQ(r.packets.size(), frames.size());
+    for (size_t i = 0; i < r.packets.size() && i < frames.size(); ++i) {
+        const Packet &p = r.packets[i];
+        const Sent &s = frames[i];
+        const uint8_t *rt = p.radiotap.data();
+        const std::string comment = s.comment.substr(0, PcapngSink<MemFile>::MAX_COMMENT_LEN);
+        const bool sameFrame = p.tsUsec == s.tsUsec && p.frame == s.frame &&
+                               p.origLen == RADIOTAP_HEADER_LEN + s.origLen && p.comment == comment &&
+                               r.interfaces[p.iface].name == "ch" + std::to_string(s.channel);
+        const bool sameRadiotap = p.radiotap.size() == RADIOTAP_HEADER_LEN && rt[0] == 0 &&
+                                  get32(rt + 4) == 0x2A && rt[8] == (s.fcs ? RADIOTAP_FLAG_FCS : 0) &&
+                                  get16(rt + 10) == wifiChannelToMhz(s.channel) &&
+                                  get16(rt + 12) == (s.channel > 14 ? 0x0100 : 0x0080) &&
+                                  (int8_t)rt[14] == s.rssi;
+        const bool ok = sameFrame && sameRadiotap;
+        if (!ok) {
+            fprintf(stderr, "packet %zu (%zu bytes, ch%u) came back wrong\n", i, s.frame.size(), s.channel);
+            CHECK(false);
+            return;
+        }
+    }
+
+    // the buffer only changes how the bytes reach the file
+    for (size_t bufferSize : {64, 512, 4096, 16384}) {
+        if (writeAll(frames, bufferSize) != reference) {
+            fprintf(stderr, "a %zu byte buffer writes another file\n", bufferSize);
+            CHECK(false);
+        }
+    }
+}
+
+static void testChannels() {
+    CHECK_EQ(wifiChannelToMhz(1), 2412);
+    CHECK_EQ(wifiChannelToMhz(13), 2472);
+    CHECK_EQ(wifiChannelToMhz(14), 2484);
+    CHECK_EQ(wifiChannelToMhz(36), 5180);
+    CHECK_EQ(wifiChannelToMhz(165), 5825);
+
+    std::vector<uint8_t> bytes;
+    MemFile file;
+    file.data = &bytes;
+    PcapngSink<MemFile> sink;
+    CHECK(sink.attach(file, 0));
+    const uint8_t frame[4] = {0x80, 0, 0, 0};
+    // out of range channels share "ch0"; the 49th interface is refused
+    CHECK(sink.append(1, 250, -40, false, frame, 4, 4, 0));
+    CHECK(sink.append(2, 201, -40, false, frame, 4, 4, 0));
+    for (uint8_t ch = 1; ch < PcapngSink<MemFile>::MAX_INTERFACES; ++ch) {
+        CHECK(sink.append(3, ch, -40, false, frame, 4, 4, 0));
+    }
+    CHECK_EQ(sink.interfaceCount(), PcapngSink<MemFile>::MAX_INTERFACES);
+    CHECK(!sink.append(4, 100, -40, false, frame, 4, 4, 0));
+    CHECK(sink.append(5, 7, -40, false, frame, 4, 4, 0));
+    sink.close();
+    const Parsed r = readPcapng(bytes);
+    if (!r.error.empty()) {
+        fprintf(stderr, "%s\n", r.error.c_str());
+        CHECK(false);
+        return;
+    }
+    CHECK(r.application.empty());
+    CHECK_EQ(r.interfaces.size(), PcapngSink<MemFile>::MAX_INTERFACES);
+    CHECK_STR(r.interfaces[0].name.c_str(), "ch0");
+    CHECK_EQ(r.packets.size(), PcapngSink<MemFile>::MAX_INTERFACES + 2);
+    CHECK_EQ(r.packets[1].iface, 0);
+}
+
+static void testShortWrite() {
+    const std::vector<Sent> frames = makeFrames();
+    std::vector<uint8_t> bytes, buffer(1024);
+    MemFile file;
+    file.data = &bytes;
+    file.failAfter = 5000;
+    PcapngSink<MemFile> sink;
+    sink.setBuffer(buffer.data(), buffer.size());
+    CHECK(sink.attach(file, 0));
+    bool failed = false;
+    for (const Sent &s : frames) {
+        const uint32_t len = s.frame.size();
+        failed = !sink.append(s.tsUsec, s.channel, s.rssi, s.fcs, s.frame.data(), len, s.origLen, 0);
+        if (failed) break;
+    }
+    CHECK(failed);
+    sink.close();
+    CHECK(sink.stats().failed >= 1);
+    CHECK_EQ(bytes.size(), 5000);
+}
+
+static void testRotation() {
+    std::vector<uint8_t> bytes;
+    MemFile file;
+    file.data = &bytes;
+    PcapngSink<MemFile> sink;
+    sink.setRotation(1000, 60000);
+    CHECK(!sink.rotationDue(0));
+    CHECK(sink.attach(file, 1000));
+    const uint8_t frame[600] = {0};
+    CHECK(sink.append(0, 1, -40, false, frame, sizeof(frame), sizeof(frame), 1000));
+    CHECK(!sink.rotationDue(1000));
+    CHECK(sink.append(0, 1, -40, false, frame, sizeof(frame), sizeof(frame), 1000));
+    CHECK(sink.rotationDue(1000)); // by size
+    sink.setRotation(0, 60000);
+    CHECK(!sink.rotationDue(60999));
+    CHECK(sink.rotationDue(61000)); // by age
+    sink.close();
+    CHECK(!sink.rotationDue(61000));
+}
+
+int main() {
+    testRoundTrip();
+    testChannels();
+    testShortWrite();
+    testRotation();
+    return hostTestResult("test_pcapng_sink");
+}
@@ -0,0 +1,170 @@
+// PulseDecoder: clean repeats of every protocol in the table decode to their key, and a corpus of
+// captures with drift, jitter, glitches and noise around them, made by encoders written apart from
+// the decoder, keeps its hit rate while noise alone never reaches the confidence rf_scan shows.
+#include "host_test.h"
+#include "modules/rf/protocols/pulse_decoder.h"
+#include <random>
+#include <string.h>
+#include <string>
+
+// Frame shapes in us as the bruteforce tables send them, or in te when te is not 1
+struct Encoder {
+    const char *name;
+    std::vector<int> zero, one, pilot, stop;
+    int bits;
+    int te; // 1 when the shapes are in us
+};
+
+static const std::vector<Encoder> &encoders() {
+    static const std::vector<Encoder> list = {
+        {"CAME",        {-320, 640},  {-640, 320},  {-11520, 320}, {},           12, 1  },
+        {"CAME",        {-320, 640},  {-640, 320},  {-15040, 320}, {},           24, 1  },
+        {"Nice FLO",    {-700, 1400}, {-1400, 700}, {-25200, 700}, {},           12, 1  },
+        {"Ansonic",     {-1111, 555}, {-555, 1111}, {-19425, 555}, {},           12, 1  },
+        {"Holtek",      {-870, 430},  {-430, 870},  {-15480, 430}, {},           40, 1  },
+        {"Linear",      {500, -1500}, {1500, -500}, {},            {1, -21500},  10, 1  },
+        {"Chamberlain", {-870, 430},  {-430, 870},  {},            {-3000, 1000}, 9, 1  },
+        {"Princeton",   {1, -3},      {3, -1},      {},            {1, -31},     24, 350},
+        {"RcSwitch 2",  {1, -2},      {2, -1},      {},            {1, -10},     24, 650},
+    };
+    return list;
+}
+
+// Appends d, merged into the last pulse when it has the same level
+static void push(std::vector<int32_t> &v, int32_t d) {
+    if (!v.empty() && (v.back() > 0) == (d > 0)) v.back() += d;
+    else v.push_back(d);
+}
+
+static uint64_t keyOf(std::mt19937 &rng, int bits) {
+    return ((uint64_t)rng() << 32 | rng()) & ((1ull << bits) - 1);
+}
+
+// Hands every element of repeats frames of key to emit(us)
+template <typename EmitFn>
+static void emitFrames(const Encoder &e, uint64_t key, int repeats, double te, EmitFn emit) {
+    for (int r = 0; r < repeats; r++) {
+        for (int d : e.pilot) emit(d * te);
+        for (int b = e.bits - 1; b >= 0; b--) {
+            for (int d : (key >> b & 1) ? e.one : e.zero) emit(d * te);
+        }
+        for (int d : e.stop) emit(d * te);
+    }
+}
+
+static bool isCandidate(const PulseCandidate &c, const Encoder &e, uint64_t key) {
+    return strcmp(c.protocol->name, e.name) == 0 && c.key == key && c.bits == e.bits;
+}
+
+static void testEdgeCases() {
+    PulseDecoder dec;
+    PulseCandidate out[4];
+    CHECK_EQ(dec.decode(nullptr, 0, out, 4), 0);
+    const int32_t endsFirst[] = {0, 300, -900};
+    CHECK_EQ(dec.decode(endsFirst, 3, out, 4), 0);
+    const int32_t gap[] = {-20000};
+    CHECK_EQ(dec.decode(gap, 1, out, 4), 0);
+
+    // glitches are folded into the pulse they interrupt
+    const int32_t glitchy[] = {300, 20, 280, -900, -100, 10, -50};
+    dec.decode(glitchy, 7, out, 4);
+    CHECK(dec.pulses() == std::vector<int32_t>({600, -1060}));
+}
+
+// Nominal timings, three repeats: every protocol comes out first with its key
+static void testClean() {
+    std::mt19937 rng(7);
+    PulseDecoder dec;
+    PulseCandidate out[8];
+    for (const Encoder &e : encoders()) {
+        for (int round = 0; round < 5; round++) {
+            const uint64_t key = keyOf(rng, e.bits);
+            std::vector<int32_t> t;
+            emitFrames(e, key, 3, e.te, [&](double us) { push(t, (int32_t)us); });
+            push(t, -30000);
+            const size_t n = dec.decode(t.data(), t.size(), out, 8);
+            CHECK(n > 0);
+            if (n == 0 || !isCandidate(out[0], e, key) || out[0].frames != 3 || out[0].confidence < 50) {
+                const char *top = n ? out[0].protocol->name : "none";
+                fprintf(stderr, "%s key %llx: top %s\n", e.name, (unsigned long long)key, top);
+                CHECK(n > 0 && isCandidate(out[0], e, key));
+                return;
+            }
+        }
+    }
+
+    // one slot: the best candidate takes it
+    const Encoder &came = encoders()[0];
+    std::vector<int32_t> t;
+    emitFrames(came, 0xA5C, 4, 1, [&](double us) { push(t, (int32_t)us); });
+    CHECK_EQ(dec.decode(t.data(), t.size(), out, 1), 1);
+    CHECK(isCandidate(out[0], came, 0xA5C));
+}
+
+static std::vector<int32_t> noise(std::mt19937 &rng, int count) {
+    std::uniform_real_distribution<double> us(30, 3000);
+    std::vector<int32_t> v;
+    for (int i = 0; i < count; i++) push(v, (i % 2 ? -1 : 1) * (int32_t)us(rng));
+    return v;
+}
+
+// Twenty captures per encoder: the remote's clock 10% off, 8 or 18% jitter per pulse, receiver
+// stretched highs, the odd glitch and noise before and after. Then noise only.
+static void testCorpus() {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> unit(0, 1);
+    PulseDecoder dec;
+    PulseCandidate out[8];
+    int signals = 0, top = 0, listed = 0;
+    for (const Encoder &e : encoders()) {
+        for (int k = 0; k < 20; k++) {
+            const uint64_t key = keyOf(rng, e.bits);
+            const double princetonTe[] = {180, 350, 420, 560};
+            const double te = e.te == 1 ? 1 : strcmp(e.name, "Princeton") == 0 ? princetonTe[k % 4] : e.te;
+            const double drift = 0.9 + 0.2 * unit(rng);
+            const double jitter = k < 10 ? 0.08 : 0.18;
+            std::vector<int32_t> t = noise(rng, 10 + k % 30);
+            emitFrames(e, key, 1 + k % 5, te * drift, [&](double us) {
+                const int32_t d = (int32_t)(us * (1 - jitter + 2 * jitter * unit(rng)) + (us > 0 ? 20 : -20));
+                if (unit(rng) < 0.005) { // a glitch of the other level halfway through
+                    const int32_t glitch = 5 + (int32_t)(35 * unit(rng));
+                    push(t, d / 2);
+                    push(t, d > 0 ? -glitch : glitch);
+                    push(t, d - d / 2);
+                } else {
+                    push(t, d);
+                }
+            });
+            push(t, -(int32_t)(20000 + 40000 * unit(rng)));
+            for (int32_t d : noise(rng, 10)) push(t, d);
+
+            const size_t n = dec.decode(t.data(), t.size(), out, 8);
+            signals++;
+            top += n > 0 && isCandidate(out[0], e, key);
+            for (size_t c = 0; c < n; c++) {
+                if (isCandidate(out[c], e, key)) {
+                    listed++;
+                    break;
+                }
+            }
+        }
+    }
+    CHECK_EQ(signals, 180);
+    // 162 and 167 when this was written. The misses are single repeats at 18% jitter, first bits
+    // merged into the noise before them, and Princeton at a te that Linear (same shape) shares.
+    CHECK(top >= 155);
+    CHECK(listed >= 160);
+
+    for (int k = 0; k < 40; k++) {
+        const std::vector<int32_t> t = noise(rng, 200 + k * 20);
+        const size_t n = dec.decode(t.data(), t.size(), out, 8);
+        for (size_t c = 0; c < n; c++) CHECK(out[c].confidence < 50);
+    }
+}
+
+int main() {
+    testEdgeCases();
+    testClean();
+    testCorpus();
+    return hostTestResult("test_pulse_decoder");
+}
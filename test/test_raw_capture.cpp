@@ -0,0 +1,280 @@
+// RawCaptureArena: the RAW_Data lines it spills and flushes hold every stored duration once, in
+// order, also when writes fail part way and are retried; spilling stops after repeated failures or
+// when a failed write cannot be taken back, and flush() says so. Then with the producer on a thread.
+#include "host_test.h"
+#include "modules/rf/raw_capture.h"
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A file that can fail: the failAt-th write() from now keeps only failKeep bytes, and every write
+// while failing does
+struct MemFile {
+    std::string data;
+    size_t pos = 0;
+    int failAt = -1;
+    bool failing = false;
+    size_t failKeep = 0;
+    bool seekFails = false;
+    int writes = 0;
+
+    size_t position() const { return pos; }
+    bool seek(size_t p) {
+        if (seekFails || p > data.size()) return false;
+        pos = p;
+        return true;
+    }
+    size_t write(const uint8_t *buf, size_t len) {
+        writes++;
+        size_t n = len;
+        if (failing || failAt == 0) n = len < failKeep ? len : failKeep;
+        if (failAt >= 0) failAt--;
+        const size_t over = data.size() - pos < n ? data.size() - pos : n;
+        data.replace(pos, over, (const char *)buf, n);
+        pos += n;
+        return n;
+    }
+};
+
+typedef RawCaptureArena<MemFile> Arena;
+
+// Durations out of RAW_Data lines; false when a line is malformed or longer than a block
+static bool parse(const std::string &text, std::vector<int32_t> &out) {
+    out.clear();
+    size_t p = 0;
+    while (p < text.size()) {
+        const size_t end = text.find('\n', p);
+        if (end == std::string::npos || text.compare(p, 9, "RAW_Data:") != 0) return false;
+        const std::string line = text.substr(p + 9, end - p - 9);
+        const char *c = line.c_str();
+        size_t count = 0;
+        while (*c) {
+            char *next;
+            const long v = strtol(c, &next, 10);
+            if (*c != ' ' || next <= c + 1) return false;
+            out.push_back((int32_t)v);
+            c = next;
+            count++;
+        }
+        if (count == 0 || count > RAW_CAPTURE_BLOCK) return false;
+        p = end + 1;
+    }
+    return true;
+}
+
+static uint32_t symbol(uint32_t d0, bool l0, uint32_t d1, bool l1) {
+    return (d0 & 0x7FFF) | (l0 ? 0x8000 : 0) | (d1 & 0x7FFF) << 16 | (l1 ? 0x80000000u : 0);
+}
+
+// A frame of 64 symbols, high then low, the last one ended by a 0 half. Appends what it should
+// store to expected.
+static void makeFrame(std::mt19937 &rng, std::vector<uint32_t> &words, std::vector<int32_t> &expected,
+                      uint32_t gapUs) {
+    words.clear();
+    if (gapUs) expected.push_back(-(int32_t)gapUs);
+    for (int i = 0; i < 64; i++) {
+        const uint32_t high = 1 + rng() % 32767, low = i == 63 ? 0 : 1 + rng() % 32767;
+        words.push_back(symbol(high, true, low, false));
+        expected.push_back(high);
+        if (low) expected.push_back(-(int32_t)low);
+    }
+}
+
+static void testRoundTrip() {
+    std::vector<int32_t> memory(4096 + 100);
+    Arena arena;
+    CHECK(!arena.init(memory.data(), 100, 0));
+    CHECK(arena.init(memory.data(), memory.size(), 3072));
+    CHECK_EQ(arena.capacity(), 4096);
+
+    std::mt19937 rng(1);
+    MemFile file;
+    std::vector<int32_t> expected;
+    std::vector<uint32_t> words;
+    for (int f = 0; f < 500; f++) {
+        const uint32_t gap = f ? 5000 + f : 0;
+        makeFrame(rng, words, expected, gap);
+        arena.pushFrame(words.data(), words.size(), gap);
+        arena.spill(file);
+        CHECK(arena.size() < 3072 + 128);
+    }
+    CHECK(arena.spilledAny());
+    MemFile peek;
+    CHECK(arena.write(peek));
+    CHECK(arena.size() > 0); // write() keeps what it wrote
+    CHECK(arena.flush(file));
+    CHECK_EQ(arena.size(), 0);
+    std::vector<int32_t> got;
+    CHECK(parse(file.data, got));
+    CHECK(got == expected);
+    const RawCaptureStats stats = arena.stats();
+    CHECK_EQ(stats.frames, 500);
+    CHECK_EQ(stats.durations, expected.size());
+    CHECK_EQ(stats.spilled, expected.size());
+    CHECK_EQ(stats.overflows, 0);
+
+    // a gap too long for an int32_t is clamped, 0 halves are not stored
+    Arena small;
+    CHECK(small.init(memory.data(), 1024, 1024));
+    const uint32_t frame[2] = {symbol(300, true, 0, false), symbol(0x7FFF, false, 1, true)};
+    small.pushFrame(frame, 2, 0xFFFFFFFFu);
+    MemFile text;
+    CHECK(small.write(text));
+    CHECK_STR(text.data.c_str(), "RAW_Data: -2147483647 300 -32767 1\n");
+    std::vector<int32_t> held;
+    small.forEach([&](int32_t d) {
+        held.push_back(d);
+        return true;
+    });
+    CHECK(held == std::vector<int32_t>({-2147483647, 300, -32767, 1}));
+
+    // with nobody spilling, what does not fit is dropped and counted
+    const std::vector<uint32_t> full(64, symbol(100, true, 100, false));
+    for (int i = 0; i < 10; i++) small.pushFrame(full.data(), full.size(), 0);
+    CHECK_EQ(small.size(), 1024);
+    CHECK_EQ(small.stats().overflows, 4 + 1280 - 1024);
+    CHECK_EQ(small.stats().highWater, 1024);
+}
+
+// Writes that fail part way, at random: retried, nothing in the file twice. The ring holds the
+// whole recording, so when spilling stops flush() still gets everything out.
+static void testPartialFailures() {
+    std::mt19937 rng(9);
+    for (int round = 0; round < 200; round++) {
+        std::vector<int32_t> memory(8192);
+        Arena arena;
+        arena.init(memory.data(), memory.size(), 1024);
+        MemFile file;
+        std::vector<int32_t> expected;
+        std::vector<uint32_t> words;
+        for (int f = 0; f < 40; f++) {
+            makeFrame(rng, words, expected, f ? 900 : 0);
+            arena.pushFrame(words.data(), words.size(), f ? 900 : 0);
+            if (rng() % 3 == 0) {
+                file.failAt = rng() % 40;
+                file.failKeep = rng() % RAW_CAPTURE_TEXT;
+            }
+            arena.spill(file);
+        }
+        file.failAt = -1;
+        const bool flushed = arena.flush(file);
+        std::vector<int32_t> got;
+        const bool ok = parse(file.data, got) && got == expected && flushed;
+        if (!ok) {
+            fprintf(stderr, "round %d: %zu of %zu durations\n", round, got.size(), expected.size());
+            CHECK(ok);
+            return;
+        }
+    }
+}
+
+static void fillArena(Arena &arena, std::mt19937 &rng, std::vector<int32_t> &expected, int frames) {
+    std::vector<uint32_t> words;
+    for (int f = 0; f < frames; f++) {
+        makeFrame(rng, words, expected, 0);
+        arena.pushFrame(words.data(), words.size(), 0);
+    }
+}
+
+static void testStops() {
+    std::mt19937 rng(4);
+    std::vector<int32_t> memory(4096);
+
+    // failing RAW_CAPTURE_SPILL_RETRIES times in a row stops spilling, flush() still tries
+    {
+        Arena arena;
+        arena.init(memory.data(), memory.size(), 1024);
+        std::vector<int32_t> expected;
+        fillArena(arena, rng, expected, 10);
+        MemFile file;
+        file.failing = true;
+        file.failKeep = 100;
+        for (int i = 0; i < RAW_CAPTURE_SPILL_RETRIES; i++) CHECK_EQ(arena.spill(file), 0);
+        CHECK(arena.spillStopped());
+        const int writes = file.writes;
+        CHECK_EQ(arena.spill(file), 0);
+        CHECK_EQ(file.writes, writes);
+        CHECK_EQ(arena.stats().spillErrors, RAW_CAPTURE_SPILL_RETRIES);
+        file.failing = false;
+        CHECK(arena.flush(file));
+        std::vector<int32_t> got;
+        CHECK(parse(file.data, got) && got == expected);
+        arena.reset();
+        CHECK(!arena.spillStopped());
+    }
+
+    // a failure in between successes does not add up
+    {
+        Arena arena;
+        arena.init(memory.data(), memory.size(), 1024);
+        std::vector<int32_t> expected;
+        MemFile file;
+        for (int i = 0; i < 3 * RAW_CAPTURE_SPILL_RETRIES; i++) {
+            fillArena(arena, rng, expected, 9);
+            file.failAt = i % 2 ? -1 : 0;
+            arena.spill(file);
+            file.failAt = -1;
+            arena.spill(file);
+        }
+        CHECK(!arena.spillStopped());
+        CHECK(arena.flush(file));
+        std::vector<int32_t> got;
+        CHECK(parse(file.data, got) && got == expected);
+    }
+
+    // a failed write that cannot be taken back leaves a cut line: nothing more goes in
+    {
+        Arena arena;
+        arena.init(memory.data(), memory.size(), 1024);
+        std::vector<int32_t> expected;
+        fillArena(arena, rng, expected, 10);
+        MemFile file;
+        file.failAt = 1;
+        file.failKeep = 10;
+        file.seekFails = true;
+        CHECK_EQ(arena.spill(file), 0);
+        CHECK(arena.spillStopped());
+        CHECK(!arena.flush(file));
+        CHECK(arena.size() > 0);
+    }
+}
+
+// The capture task on its own thread, the record loop spilling as it goes. The producer only
+// waits here so that nothing is dropped and the file can be compared.
+static void testThreads() {
+    std::vector<int32_t> memory(8192);
+    Arena arena;
+    arena.init(memory.data(), memory.size(), 6144);
+    std::vector<int32_t> expected;
+    std::atomic<bool> done{false};
+    std::thread producer([&]() {
+        std::mt19937 rng(21);
+        std::vector<uint32_t> words;
+        for (int f = 0; f < 2000; f++) {
+            while (arena.size() + 129 > arena.capacity()) std::this_thread::yield();
+            makeFrame(rng, words, expected, f ? 1000 : 0);
+            arena.pushFrame(words.data(), words.size(), f ? 1000 : 0);
+        }
+        done.store(true);
+    });
+    MemFile file;
+    while (!done.load()) {
+        if (arena.spill(file) == 0) std::this_thread::yield();
+    }
+    producer.join();
+    CHECK(arena.flush(file));
+    std::vector<int32_t> got;
+    CHECK(parse(file.data, got));
+    CHECK(got == expected);
+    CHECK_EQ(arena.stats().overflows, 0);
+    CHECK(arena.stats().highWater <= arena.capacity());
+}
+
+int main() {
+    testRoundTrip();
+    testPartialFailures();
+    testStops();
+    testThreads();
+    return hostTestResult("test_raw_capture");
+}
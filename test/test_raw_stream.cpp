@@ -0,0 +1,144 @@
+// RawTxStream: the durations it streams out of a .sub file match what SubCompiler decodes, line
+// ends included, whatever the ring size and read sizes, with the producer and consumer on one
+// thread or on two.
+#include "host_test.h"
+#include "modules/rf/sub_compiler.h"
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct MemFile {
+    std::string data;
+    size_t pos = 0;
+    size_t chunk = 512;
+    size_t read(uint8_t *buf, size_t len) {
+        size_t n = data.size() - pos;
+        if (n > len) n = len;
+        if (n > chunk) n = chunk;
+        memcpy(buf, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+};
+
+// RAW_Data durations as SubCompiler reads them, every line followed by RAW_STREAM_LINE_END
+static std::vector<int32_t> expected(const std::string &text) {
+    MemFile f;
+    f.data = text;
+    CompiledSub sub;
+    compileSub(f, sub);
+    std::vector<int32_t> out;
+    for (const SubDataLine &line : sub.lines) {
+        if (line.kind != SUB_DATA_TIMINGS) continue;
+        out.insert(out.end(), sub.lineTimings(line), sub.lineTimings(line) + line.count);
+        out.push_back(RAW_STREAM_LINE_END);
+    }
+    return out;
+}
+
+template <size_t Capacity>
+static std::vector<int32_t> streamOneThread(const std::string &text, size_t chunk) {
+    RawTxStream<Capacity> stream;
+    MemFile f;
+    f.data = text;
+    f.chunk = chunk;
+    std::vector<int32_t> out;
+    int32_t v;
+    while (!stream.done() || stream.pending() > 0) {
+        stream.pump(f);
+        CHECK(stream.pending() <= Capacity);
+        while (stream.pop(v)) out.push_back(v);
+    }
+    CHECK_EQ(stream.stats().bytes, text.size());
+    return out;
+}
+
+static std::string randomFile(std::mt19937 &rng) {
+    const char alphabet[] = "0123456789   --\t\rx";
+    std::string text = "Filetype: Flipper SubGhz RAW File\nProtocol: RAW\n";
+    const int lines = 1 + rng() % 6;
+    for (int l = 0; l < lines; ++l) {
+        if (rng() % 4 == 0) text += "Data_RAW: 00 FF 12\n";
+        text += rng() % 5 == 0 ? "RAW_Data:" : "RAW_Data: ";
+        const int len = rng() % 200;
+        for (int i = 0; i < len; ++i) {
+            if (rng() % 2) text += std::to_string((int)(rng() % 4000) - 2000);
+            else text += alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+        if (l + 1 < lines || rng() % 2) text += rng() % 2 ? "\r\n" : "\n";
+    }
+    return text;
+}
+
+static void testAgainstCompiler() {
+    const std::string sample = "Protocol: RAW\r\nRAW_Data: 500 -1500  700\r\nKey: 01\r\nRAW_Data: 9 -9 0 5";
+    CHECK(streamOneThread<8>(sample, 3) == expected(sample));
+    CHECK(streamOneThread<8>(sample, 3) == std::vector<int32_t>({500, -1500, 0, 9, -9, 0}));
+
+    std::mt19937 rng(77);
+    for (int round = 0; round < 2000; ++round) {
+        const std::string text = randomFile(rng);
+        const std::vector<int32_t> want = expected(text);
+        const size_t chunk = 1 + rng() % 100;
+        bool ok = streamOneThread<4>(text, chunk) == want && streamOneThread<8>(text, chunk) == want &&
+                  streamOneThread<256>(text, chunk) == want;
+        if (!ok) {
+            CHECK(ok);
+            fprintf(stderr, "mismatch, chunk %zu:\n%s\n", chunk, text.c_str());
+            return;
+        }
+    }
+}
+
+// The transmit loop on its own thread, as in rf_send.cpp: it spins on pop() and only stops once
+// done() and the ring is empty
+static void testTwoThreads() {
+    std::mt19937 rng(5);
+    std::string text = "Protocol: RAW\n";
+    for (int l = 0; l < 200; ++l) {
+        text += "RAW_Data:";
+        for (int i = 0; i < 100; ++i) {
+            text += " " + std::to_string((i % 2 ? -1 : 1) * (int)(1 + rng() % 3000));
+        }
+        text += "\n";
+    }
+    const std::vector<int32_t> want = expected(text);
+
+    RawTxStream<64> stream;
+    MemFile f;
+    f.data = text;
+    f.chunk = 37;
+    std::vector<int32_t> got;
+    std::thread consumer([&]() {
+        int32_t v;
+        while (true) {
+            if (stream.pop(v)) {
+                got.push_back(v);
+                continue;
+            }
+            if (stream.done() && stream.pending() == 0) break;
+            std::this_thread::yield();
+        }
+    });
+    while (!stream.done()) {
+        if (stream.pump(f) == 0) std::this_thread::yield();
+    }
+    consumer.join();
+    CHECK(got == want);
+    CHECK_EQ(stream.stats().lines, 200);
+    CHECK_EQ(stream.stats().durations, want.size() - 200);
+    CHECK(stream.stats().highWater <= 64);
+
+    // reset() makes it reusable for the next file
+    stream.reset();
+    f.pos = 0;
+    CHECK(!stream.done());
+    CHECK(stream.pump(f) > 0);
+}
+
+int main() {
+    testAgainstCompiler();
+    testTwoThreads();
+    return hostTestResult("test_raw_stream");
+}
@@ -0,0 +1,296 @@
+// RfTxSession against a mock radio that logs every call: the first signal inits and writes
+// everything, an unchanged config writes nothing, changed fields are the only writes, a 0 keeps
+// the module's value, a new frequency deinits and inits, and a 16-key file takes one init.
+#include "host_test.h"
+#include "modules/rf/rf_tx_session.h"
+#include <string>
+#include <vector>
+
+// Logs the calls as "init 4.3392e+08", "dev 47.6", "tx", ... and keeps what the module holds
+struct MockRadio {
+    std::vector<std::string> calls;
+    RfTxConfig module;       // the settings written last
+    bool transmitting = false;
+    bool initOk = true;
+    bool cc1101 = true;      // false: ASK/OOK only
+    uint32_t clockUs = 1000;
+    uint32_t usPerCall = 10; // nowUs() moves on this much at every call
+
+    void log(const char *name, double value) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%s %g", name, value);
+        calls.push_back(buf);
+    }
+
+    bool supports(const RfTxConfig &cfg) { return cc1101 || cfg.modulation == 2; }
+    bool init(const RfTxConfig &cfg) {
+        log("init", cfg.frequency);
+        if (!initOk) return false;
+        module = RfTxConfig();
+        module.frequency = cfg.frequency;
+        return true;
+    }
+    void setModulation(uint8_t modulation) {
+        CHECK(!transmitting);
+        log("mod", modulation);
+        module.modulation = modulation;
+    }
+    void setDeviation(float deviation) {
+        CHECK(!transmitting);
+        log("dev", deviation);
+        module.deviation = deviation;
+    }
+    void setRxBW(float rxBW) {
+        CHECK(!transmitting);
+        log("bw", rxBW);
+        module.rxBW = rxBW;
+    }
+    void setDataRate(float dataRate) {
+        CHECK(!transmitting);
+        log("rate", dataRate);
+        module.dataRate = dataRate;
+    }
+    void setPower(int8_t power) {
+        CHECK(!transmitting);
+        log("power", power);
+        module.power = power;
+    }
+    void startTx() {
+        calls.push_back("tx");
+        transmitting = true;
+    }
+    void idle() {
+        calls.push_back("idle");
+        transmitting = false;
+    }
+    void deinit() {
+        calls.push_back("deinit");
+        transmitting = false;
+    }
+    uint32_t nowUs() { return clockUs += usPerCall; }
+
+    // The calls since the last take(), joined by ", "
+    std::string take() {
+        std::string s;
+        for (const std::string &c : calls) s += (s.empty() ? "" : ", ") + c;
+        calls.clear();
+        return s;
+    }
+};
+
+typedef RfTxSession<MockRadio> Session;
+
+static RfTxConfig ook(uint32_t frequency) {
+    RfTxConfig cfg;
+    cfg.frequency = frequency;
+    return cfg;
+}
+
+static void checkCalls(MockRadio &radio, const char *expected) {
+    const std::string got = radio.take();
+    if (got != expected) {
+        fprintf(stderr, "calls: \"%s\"\n  expected \"%s\"\n", got.c_str(), expected);
+        CHECK(got == expected);
+    }
+}
+
+static void testFirstInit() {
+    MockRadio radio;
+    Session tx(radio);
+    CHECK(!tx.active());
+    CHECK(tx.begin(ook(433920000)));
+    checkCalls(radio, "init 4.3392e+08, mod 2, dev 1.58, bw 270.83, rate 10, power 12, tx");
+    CHECK(tx.active());
+    CHECK_EQ(tx.stats().inits, 1);
+    CHECK_EQ(tx.stats().writes, 5);
+    CHECK_EQ(tx.stats().signals, 1);
+    CHECK_EQ(tx.stats().gaps, 0);
+    tx.signalDone();
+    checkCalls(radio, "idle");
+    tx.end();
+    checkCalls(radio, "deinit");
+    CHECK(!tx.active());
+    tx.end();
+    tx.signalDone();
+    checkCalls(radio, "");
+
+    // a 0 at init leaves the module's value, nothing is written for it
+    RfTxConfig zeros = ook(315000000);
+    zeros.deviation = 0;
+    zeros.dataRate = 0;
+    CHECK(tx.begin(zeros));
+    checkCalls(radio, "init 3.15e+08, mod 2, bw 270.83, power 12, tx");
+    tx.end();
+    radio.take();
+
+    // a failed init or an unsupported modulation skips the signal and leaves the radio alone
+    radio.initOk = false;
+    CHECK(!tx.begin(ook(433920000)));
+    checkCalls(radio, "init 4.3392e+08");
+    CHECK(!tx.active());
+    radio.initOk = true;
+    radio.cc1101 = false;
+    RfTxConfig fsk = ook(433920000);
+    fsk.modulation = 0;
+    CHECK(!tx.begin(fsk));
+    checkCalls(radio, "");
+    CHECK(tx.begin(ook(433920000)));
+    CHECK_EQ(tx.stats().inits, 3);
+}
+
+static void testUnchanged() {
+    MockRadio radio;
+    Session tx(radio);
+    CHECK(tx.begin(ook(433920000)));
+    tx.signalDone();
+    radio.take();
+    const uint32_t writes = tx.stats().writes;
+    for (int i = 0; i < 5; i++) {
+        CHECK(tx.begin(ook(433920000)));
+        checkCalls(radio, "tx");
+        tx.signalDone();
+        checkCalls(radio, "idle");
+    }
+    CHECK_EQ(tx.stats().writes, writes);
+    CHECK_EQ(tx.stats().reconfigs, 0);
+
+    // lines of one capture: the radio stays in TX between them
+    CHECK(tx.begin(ook(433920000)));
+    tx.signalDone(true);
+    CHECK(tx.begin(ook(433920000)));
+    tx.signalDone(true);
+    checkCalls(radio, "tx");
+    CHECK(radio.transmitting);
+    CHECK(tx.begin(ook(433920000)));
+    tx.signalDone();
+    checkCalls(radio, "idle");
+}
+
+static void testApply() {
+    MockRadio radio;
+    Session tx(radio);
+    RfTxConfig cfg = ook(433920000);
+    CHECK(tx.begin(cfg));
+    tx.signalDone(true); // still in TX: apply() has to idle first
+    radio.take();
+
+    cfg.modulation = 0;
+    cfg.deviation = 47.6;
+    CHECK(tx.begin(cfg));
+    checkCalls(radio, "idle, mod 0, dev 47.6, tx");
+    CHECK_EQ(tx.stats().reconfigs, 1);
+    tx.signalDone();
+    radio.take();
+
+    cfg.rxBW = 650;
+    cfg.power = 10;
+    CHECK(tx.begin(cfg));
+    checkCalls(radio, "bw 650, power 10, tx");
+    tx.signalDone();
+    radio.take();
+
+    cfg.dataRate = 3.79;
+    CHECK(tx.begin(cfg));
+    checkCalls(radio, "rate 3.79, tx");
+    tx.signalDone();
+    radio.take();
+    CHECK_EQ(tx.stats().reconfigs, 3);
+    CHECK_EQ(tx.stats().writes, 5 + 2 + 2 + 1);
+    CHECK_EQ(tx.stats().inits, 1);
+
+    // the module ends up with the last config, same as a full init would give
+    CHECK(radio.module.modulation == 0 && radio.module.deviation == 47.6f && radio.module.rxBW == 650);
+    CHECK(radio.module.dataRate == 3.79f && radio.module.power == 10);
+}
+
+static void testZeroKeeps() {
+    MockRadio radio;
+    Session tx(radio);
+    RfTxConfig cfg = ook(433920000);
+    cfg.deviation = 47.6;
+    CHECK(tx.begin(cfg));
+    tx.signalDone();
+    radio.take();
+
+    // 0 means "whatever the module has": nothing to write, the old value stays the current one
+    RfTxConfig zeros = cfg;
+    zeros.deviation = zeros.rxBW = zeros.dataRate = 0;
+    CHECK(tx.begin(zeros));
+    checkCalls(radio, "tx");
+    tx.signalDone();
+    radio.take();
+    CHECK_EQ(tx.stats().reconfigs, 0);
+
+    // a change next to a 0: only the change is written
+    zeros.power = 5;
+    CHECK(tx.begin(zeros));
+    checkCalls(radio, "power 5, tx");
+    tx.signalDone();
+    radio.take();
+
+    // and going back to the values from before the 0 writes nothing, they never changed
+    cfg.power = 5;
+    CHECK(tx.begin(cfg));
+    checkCalls(radio, "tx");
+    CHECK(radio.module.deviation == 47.6f && radio.module.power == 5);
+}
+
+static void testFrequencyChange() {
+    MockRadio radio;
+    Session tx(radio);
+    CHECK(tx.begin(ook(433920000)));
+    tx.signalDone();
+    radio.take();
+    RfTxConfig other = ook(868350000);
+    other.power = 10;
+    CHECK(tx.begin(other));
+    checkCalls(radio, "deinit, init 8.6835e+08, mod 2, dev 1.58, bw 270.83, rate 10, power 10, tx");
+    CHECK_EQ(tx.stats().inits, 2);
+    CHECK_EQ(tx.stats().reconfigs, 0);
+
+    // a failed init at the new frequency leaves the session ended
+    tx.signalDone();
+    radio.take();
+    radio.initOk = false;
+    CHECK(!tx.begin(ook(315000000)));
+    checkCalls(radio, "deinit, init 3.15e+08");
+    CHECK(!tx.active());
+}
+
+// What txSubFile() does for a .sub file with 16 keys: one begin()/signalDone() per key, then end()
+static void testSixteenKeys() {
+    MockRadio radio;
+    Session tx(radio);
+    for (int key = 0; key < 16; key++) {
+        CHECK(tx.begin(ook(433920000)));
+        radio.clockUs += 5000; // the signal itself
+        tx.signalDone();
+    }
+    tx.end();
+    const RfTxSessionStats &s = tx.stats();
+    CHECK_EQ(s.inits, 1);
+    CHECK_EQ(s.signals, 16);
+    CHECK_EQ(s.reconfigs, 0);
+    CHECK_EQ(s.writes, 5);
+    CHECK_EQ(s.gaps, 15);
+    // signalDone() reads the clock, begin() reads it again after startTx(): one call apart
+    CHECK_EQ(s.gapMinUs, radio.usPerCall);
+    CHECK_EQ(s.gapMaxUs, radio.usPerCall);
+    CHECK_EQ(s.gapAvgUs(), radio.usPerCall);
+    size_t inits = 0, deinits = 0;
+    std::string all = radio.take();
+    for (size_t p = 0; (p = all.find("init ", p)) != std::string::npos; p++) inits++;
+    for (size_t p = 0; (p = all.find("deinit", p)) != std::string::npos; p++) deinits++;
+    CHECK_EQ(inits, 1);
+    CHECK_EQ(deinits, 1);
+}
+
+int main() {
+    testFirstInit();
+    testUnchanged();
+    testApply();
+    testZeroKeeps();
+    testFrequencyChange();
+    testSixteenKeys();
+    return hostTestResult("test_rf_tx_session");
+}
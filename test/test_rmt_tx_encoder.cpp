@@ -0,0 +1,180 @@
+// RmtPulseEncoder: symbols decoded back into pulses keep every edge within half a tick of where the
+// durations put it at any resolution, long pulses are split and never leave a 0 half before the
+// end, and blocks of any size end in a low period once they hold the minimum.
+#include "host_test.h"
+#include "modules/rf/rmt_tx_encoder.h"
+#include <random>
+#include <vector>
+
+struct Half {
+    uint32_t ticks;
+    bool level;
+};
+
+struct Encoded {
+    std::vector<Half> halves;
+    size_t blocks = 0;
+    bool blocksOk = true; // every block full, ended low or the last one
+    bool zeroOk = true;   // a 0 half only as the second half of the very last symbol
+};
+
+static Encoded encodeAll(
+    const std::vector<int32_t> &durations,
+    uint32_t resolutionHz,
+    size_t maxSymbols,
+    size_t minSymbols
+) {
+    RmtPulseEncoder enc(resolutionHz);
+    size_t i = 0;
+    auto next = [&](int32_t &d) {
+        if (i == durations.size()) return false;
+        d = durations[i++];
+        return true;
+    };
+    Encoded e;
+    std::vector<uint32_t> words;
+    std::vector<uint32_t> block(maxSymbols);
+    size_t n;
+    while ((n = enc.encode(next, block.data(), maxSymbols, minSymbols)) > 0) {
+        e.blocks++;
+        if (n < maxSymbols && rmtLevel1(block[n - 1]) && !enc.finished()) e.blocksOk = false;
+        words.insert(words.end(), block.begin(), block.begin() + n);
+    }
+    CHECK(enc.finished());
+    CHECK_EQ(enc.symbols(), words.size());
+    for (size_t w = 0; w < words.size(); ++w) {
+        const bool last = w + 1 == words.size();
+        if (rmtDuration0(words[w]) == 0) e.zeroOk = false;
+        e.halves.push_back({rmtDuration0(words[w]), rmtLevel0(words[w])});
+        if (rmtDuration1(words[w]) == 0) {
+            if (!last) e.zeroOk = false;
+            continue;
+        }
+        e.halves.push_back({rmtDuration1(words[w]), rmtLevel1(words[w])});
+    }
+    return e;
+}
+
+// Merges halves of the same level into pulses, returns where each pulse ends in ticks
+static std::vector<uint64_t> pulseEnds(const std::vector<Half> &halves, std::vector<bool> &levels) {
+    std::vector<uint64_t> ends;
+    levels.clear();
+    uint64_t at = 0;
+    for (size_t h = 0; h < halves.size(); ++h) {
+        at += halves[h].ticks;
+        if (h > 0 && halves[h].level == halves[h - 1].level) {
+            ends.back() = at;
+        } else {
+            ends.push_back(at);
+            levels.push_back(halves[h].level);
+        }
+    }
+    return ends;
+}
+
+static void testSimple() {
+    const std::vector<int32_t> d = {500, -1500, 300, 200, -100, -50000};
+    const Encoded e = encodeAll(d, 1000000, 64, SIZE_MAX);
+    std::vector<bool> levels;
+    const std::vector<uint64_t> ends = pulseEnds(e.halves, levels);
+    CHECK(ends == std::vector<uint64_t>({500, 2000, 2500, 52600}));
+    CHECK(levels == std::vector<bool>({true, false, true, false}));
+    CHECK(e.zeroOk);
+    // 50100 low ticks take two halves, plus 500, 1500, 500: five halves and the end marker
+    CHECK_EQ(e.halves.size(), 5);
+    CHECK_EQ(e.blocks, 1);
+
+    // an even number of halves needs no end marker
+    const Encoded even = encodeAll({100, -100}, 1000000, 8, SIZE_MAX);
+    CHECK_EQ(even.halves.size(), 2);
+
+    const Encoded none = encodeAll({}, 1000000, 8, SIZE_MAX);
+    CHECK_EQ(none.blocks, 0);
+
+    // rounding carries over: 1 us at 0.4 ticks/us adds up to the right length
+    const Encoded slow = encodeAll(std::vector<int32_t>(1000, 1), 400000, 8, SIZE_MAX);
+    std::vector<bool> slowLevels;
+    const std::vector<uint64_t> slowEnds = pulseEnds(slow.halves, slowLevels);
+    CHECK(slowEnds == std::vector<uint64_t>({400}));
+}
+
+// Durations of at least one tick each: every edge stays within half a tick of the exact one
+static void testEdges() {
+    const uint32_t resolutions[] = {1000000, 312500, 3333333, 10000000, 80000000};
+    std::mt19937 rng(11);
+    for (int round = 0; round < 3000; ++round) {
+        const uint32_t res = resolutions[rng() % 5];
+        const uint32_t minUs = (1000000 + res - 1) / res;
+        std::vector<int32_t> d;
+        const int count = rng() % 300;
+        for (int i = 0; i < count; ++i) {
+            int32_t us = minUs + rng() % (rng() % 8 == 0 ? 200000 : 3000);
+            if (rng() % 500 == 0) us = res == 1000000 ? INT32_MAX : 5000000; // thousands of halves
+            d.push_back(rng() % 3 ? (i % 2 ? -us : us) : (rng() % 2 ? -us : us));
+        }
+        const size_t maxSymbols = 1 + rng() % 300;
+        const size_t minSymbols = rng() % 2 ? SIZE_MAX : maxSymbols * 3 / 4;
+        const Encoded e = encodeAll(d, res, maxSymbols, minSymbols);
+
+        // the exact pulse ends, in 1e-6 ticks
+        std::vector<uint64_t> exact;
+        std::vector<bool> exactLevels;
+        uint64_t at = 0;
+        for (size_t i = 0; i < d.size(); ++i) {
+            const bool level = d[i] > 0;
+            at += (uint64_t)(level ? (int64_t)d[i] : -(int64_t)d[i]) * res;
+            if (i > 0 && level == exactLevels.back()) {
+                exact.back() = at;
+            } else {
+                exact.push_back(at);
+                exactLevels.push_back(level);
+            }
+        }
+        std::vector<bool> levels;
+        const std::vector<uint64_t> ends = pulseEnds(e.halves, levels);
+        bool ok = ends.size() == exact.size() && levels == exactLevels && e.zeroOk && e.blocksOk;
+        for (size_t p = 0; ok && p < ends.size(); ++p) {
+            const int64_t error = (int64_t)(ends[p] * 1000000) - (int64_t)exact[p];
+            ok = error >= -500000 && error <= 500000;
+        }
+        for (const Half &h : e.halves) ok = ok && h.ticks <= RMT_HALF_MAX_TICKS;
+        if (!ok) {
+            fprintf(
+                stderr, "round %d: %zu durations at %u Hz, blocks of %zu\n", round, d.size(), res, maxSymbols
+            );
+            CHECK(ok);
+            return;
+        }
+    }
+}
+
+// Durations shorter than a tick: their time is not lost and no 0 half is written
+static void testShortDurations() {
+    std::mt19937 rng(3);
+    for (int round = 0; round < 1000; ++round) {
+        std::vector<int32_t> d;
+        uint64_t exact = 0;
+        const int count = rng() % 400;
+        for (int i = 0; i < count; ++i) {
+            const int32_t us = rng() % 6;
+            d.push_back(rng() % 2 ? -us : us);
+            exact += (uint64_t)us * 250000;
+        }
+        const Encoded e = encodeAll(d, 250000, 1 + rng() % 20, 1);
+        uint64_t total = 0;
+        for (const Half &h : e.halves) total += h.ticks;
+        const int64_t error = (int64_t)(total * 1000000) - (int64_t)exact;
+        if (!e.zeroOk || !e.blocksOk || error < -500000 || error > 500000) {
+            CHECK(e.zeroOk && e.blocksOk);
+            CHECK_EQ(total, (exact + 500000) / 1000000);
+            return;
+        }
+    }
+}
+
+int main() {
+    testSimple();
+    testEdges();
+    testShortDurations();
+    return hostTestResult("test_rmt_tx_encoder");
+}
@@ -0,0 +1,238 @@
+// SubCompiler and the .sub sidecar: header fields and presets, RAW_Data checked against the String
+// parser it replaced (trim, split on single spaces, atol() per token, the first 0 ends the signal)
+// on fuzzed lines fed in chunks of every size, and sidecars that are damaged or stale.
+#include "host_test.h"
+#include "modules/rf/sub_compiler.h"
+#include <random>
+#include <string>
+#include <vector>
+
+struct MemFile {
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+    size_t chunk = 512;
+    size_t read(uint8_t *buf, size_t len) {
+        size_t n = data.size() - pos;
+        if (n > len) n = len;
+        if (n > chunk) n = chunk;
+        memcpy(buf, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+    size_t write(const uint8_t *buf, size_t len) {
+        data.insert(data.end(), buf, buf + len);
+        return len;
+    }
+};
+
+static MemFile fileOf(const std::string &text, size_t chunk = 512) {
+    MemFile f;
+    f.data.assign(text.begin(), text.end());
+    f.chunk = chunk;
+    return f;
+}
+
+static CompiledSub compile(const std::string &text, size_t chunk = 512, bool streamed = false) {
+    MemFile f = fileOf(text, chunk);
+    CompiledSub sub;
+    compileSub(f, sub, streamed);
+    return sub;
+}
+
+static bool isBlank(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+// What txSubFile() + sendRfCommand() made of one RAW_Data line: String::trim(), indexOf(' ')
+// splitting, toInt() (atol() with a 32-bit long) per token, transmission up to the first 0
+static std::vector<int32_t> referenceRaw(const std::string &line) {
+    std::string txt = line.substr(line.find(':') + 1);
+    if (!txt.empty() && txt.back() == '\r') txt.pop_back();
+    size_t start = 0, end = txt.size();
+    while (start < end && isBlank(txt[start])) start++;
+    while (end > start && isBlank(txt[end - 1])) end--;
+    txt = txt.substr(start, end - start);
+
+    std::vector<int32_t> out;
+    size_t from = 0;
+    while (true) {
+        const size_t space = txt.find(' ', from);
+        const size_t len = space == std::string::npos ? std::string::npos : space - from;
+        const std::string token = txt.substr(from, len);
+        long long v = strtoll(token.c_str(), nullptr, 10);
+        if (v > INT32_MAX) v = INT32_MAX;
+        if (v < INT32_MIN) v = INT32_MIN;
+        if (v == 0) break;
+        out.push_back((int32_t)v);
+        if (space == std::string::npos) break;
+        from = space + 1;
+    }
+    return out;
+}
+
+static std::vector<int32_t> lineTimings(const CompiledSub &sub, size_t i) {
+    const SubDataLine &line = sub.lines[i];
+    return std::vector<int32_t>(sub.lineTimings(line), sub.lineTimings(line) + line.count);
+}
+
+static const char SAMPLE[] = "Filetype: Flipper SubGhz RAW File\r\n"
+                             "Version: 1\r\n"
+                             "Frequency: 433920000\r\n"
+                             "Preset: FuriHalSubGhzPresetOok650Async\r\n"
+                             "Protocol: RAW\r\n"
+                             "RAW_Data: 500 -1500 500 -500 1500\r\n"
+                             "RAW_Data: 300  -300 0 999\r\n"
+                             "RAW_Data:\r\n";
+
+static void testSample() {
+    for (size_t chunk = 1; chunk <= sizeof(SAMPLE); chunk += 3) {
+        const CompiledSub sub = compile(SAMPLE, chunk);
+        CHECK(sub.complete());
+        CHECK_EQ(sub.frequency, 433920000);
+        CHECK_EQ(sub.preset, SUB_PRESET_OOK650);
+        CHECK_EQ(sub.rcswitchProtocol, 2);
+        CHECK_EQ(sub.protocol, SUB_PROTOCOL_RAW);
+        CHECK_STR(sub.protocolName, "RAW");
+        CHECK_EQ(sub.lines.size(), 3);
+        if (sub.lines.size() != 3) return;
+        CHECK(lineTimings(sub, 0) == std::vector<int32_t>({500, -1500, 500, -500, 1500}));
+        CHECK(lineTimings(sub, 1) == std::vector<int32_t>({300})); // the double space reads as a 0
+        CHECK_EQ(sub.lines[2].count, 0);
+    }
+
+    const CompiledSub keys = compile("Protocol: Princeton_433\nPreset: 12\nFrequency: 315000000\nTE: 350\n"
+                                     "Bit: 24\nKey: 00 00 00 00 00 AB CD EF\nKey: 11 22 33 44 55\n"
+                                     "Bit_RAW: 64\nData_RAW: 00 01 fE\nNotAKey: 5\nFrequencyX: 1\nTE 7");
+    CHECK(keys.complete());
+    CHECK_EQ(keys.protocol, SUB_PROTOCOL_PRINCETON);
+    CHECK_EQ(keys.preset, SUB_PRESET_RCSWITCH);
+    CHECK_EQ(keys.rcswitchProtocol, 12);
+    CHECK_EQ(keys.te, 350);
+    CHECK(keys.bits == std::vector<int32_t>({24}));
+    CHECK(keys.bitRaws == std::vector<int32_t>({64}));
+    CHECK(keys.keys == std::vector<uint32_t>({0xABCDEF, 0x22334455}));
+    CHECK_EQ(keys.lines.size(), 1);
+    if (keys.lines.size() == 1) {
+        CHECK_EQ(keys.lines[0].kind, SUB_DATA_BYTES);
+        CHECK_EQ(keys.lines[0].count, 3);
+        CHECK(memcmp(keys.lineBytes(keys.lines[0]), "\x00\x01\xFE", 3) == 0);
+    }
+
+    CHECK(!compile("Protocol: RAW\nPreset: FuriHalSubGhzPresetOok270Async\n").complete());
+}
+
+static void testPresets() {
+    uint8_t rc = 0;
+    CHECK_EQ(subPresetId("FuriHalSubGhzPresetOok270Async", rc), SUB_PRESET_OOK270);
+    CHECK_EQ(rc, 1);
+    CHECK_EQ(subPresetId("FuriHalSubGhzPresetGFSK9_99KbAsync", rc), SUB_PRESET_GFSK9_99);
+    CHECK_EQ(subPresetId("0", rc), SUB_PRESET_RCSWITCH);
+    CHECK_EQ(rc, 0);
+    CHECK_EQ(subPresetId("29", rc), SUB_PRESET_RCSWITCH);
+    CHECK_EQ(rc, 29);
+    const char *unsupported[] = {"", "30", "07", "1a", "100", "Ook650", "-1"};
+    for (const char *name : unsupported) CHECK_EQ(subPresetId(name, rc), SUB_PRESET_UNSUPPORTED);
+    CHECK_EQ(subProtocolId("BinRAW"), SUB_PROTOCOL_BINRAW);
+    CHECK_EQ(subProtocolId("Came"), SUB_PROTOCOL_OTHER);
+}
+
+// Random RAW_Data lines out of the characters that matter to the tokenizer
+static void testAgainstReference() {
+    std::mt19937 rng(2024);
+    const char alphabet[] = "0123456789 --+\t\rx";
+    for (int round = 0; round < 3000; ++round) {
+        std::string text = "Protocol: RAW\n";
+        std::vector<std::string> rawLines;
+        const int lines = 1 + rng() % 4;
+        for (int l = 0; l < lines; ++l) {
+            std::string line = rng() % 2 ? "RAW_Data: " : "RAW_Data:";
+            const int len = rng() % 60;
+            for (int i = 0; i < len; ++i) {
+                if (rng() % 3 == 0) line += std::to_string((int)(rng() % 20000) - 10000);
+                else line += alphabet[rng() % (sizeof(alphabet) - 1)];
+            }
+            if (rng() % 50 == 0) line += " 99999999999";
+            rawLines.push_back(line);
+            text += line + (l + 1 < lines || rng() % 2 ? "\n" : "");
+        }
+        const CompiledSub sub = compile(text, 1 + rng() % 64);
+        CHECK_EQ(sub.lines.size(), rawLines.size());
+        if (sub.lines.size() != rawLines.size()) return;
+        for (size_t l = 0; l < rawLines.size(); ++l) {
+            if (lineTimings(sub, l) != referenceRaw(rawLines[l])) {
+                fprintf(stderr, "mismatch on \"%s\"\n", rawLines[l].c_str());
+                CHECK(lineTimings(sub, l) == referenceRaw(rawLines[l]));
+                return;
+            }
+        }
+    }
+}
+
+static void testStreamed() {
+    std::string text = "Frequency: 433920000\nPreset: 1\nProtocol: RAW\nRAW_Data: 100 -100\nRAW_Data:";
+    for (uint32_t i = 0; i < SUB_STREAM_KEEP_MAX + 500; ++i) text += i % 2 ? " -250" : " 250";
+    text += "\n";
+    const CompiledSub sub = compile(text, 512, true);
+    CHECK(sub.streamed);
+    CHECK_EQ(sub.lines.size(), 2);
+    if (sub.lines.size() == 2) CHECK_EQ(sub.lines[1].count, SUB_STREAM_KEEP_MAX + 500);
+    CHECK_EQ(sub.timings.size(), SUB_STREAM_KEEP_MAX); // only the start of the last line
+    MemFile sink;
+    CHECK(!writeCompiledSub(sink, sub, SubSourceKey()));
+}
+
+static bool sameSub(const CompiledSub &a, const CompiledSub &b) {
+    if (a.frequency != b.frequency || a.te != b.te || a.preset != b.preset || a.protocol != b.protocol ||
+        a.rcswitchProtocol != b.rcswitchProtocol || strcmp(a.protocolName, b.protocolName) != 0 ||
+        strcmp(a.presetName, b.presetName) != 0 || a.bits != b.bits || a.bitRaws != b.bitRaws ||
+        a.keys != b.keys || a.lines.size() != b.lines.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.lines.size(); ++i) {
+        const SubDataLine &la = a.lines[i], &lb = b.lines[i];
+        if (la.kind != lb.kind || la.count != lb.count) return false;
+        const size_t bytes = la.kind == SUB_DATA_BYTES ? la.count : la.count * 4;
+        const void *pa = la.kind == SUB_DATA_BYTES ? (const void *)a.lineBytes(la) : a.lineTimings(la);
+        const void *pb = lb.kind == SUB_DATA_BYTES ? (const void *)b.lineBytes(lb) : b.lineTimings(lb);
+        if (bytes && memcmp(pa, pb, bytes) != 0) return false;
+    }
+    return true;
+}
+
+static void testSidecar() {
+    const CompiledSub sub = compile(std::string(SAMPLE) + "Bit: 12\nKey: 01 02\nData_RAW: AA 55\n");
+    SubSourceKey key;
+    key.size = sizeof(SAMPLE);
+    key.mtime = 1760000000;
+    MemFile sink;
+    CHECK(writeCompiledSub(sink, sub, key));
+
+    CompiledSub back;
+    CHECK(loadCompiledSub(sink.data.data(), sink.data.size(), key, back));
+    CHECK(sameSub(sub, back));
+
+    SubSourceKey stale = key;
+    stale.mtime++;
+    CHECK(!loadCompiledSub(sink.data.data(), sink.data.size(), stale, back));
+    CHECK(!loadCompiledSub(sink.data.data(), sink.data.size() - 1, key, back));
+    CHECK(!loadCompiledSub(sink.data.data(), 4, key, back));
+    for (size_t i = 0; i < sink.data.size(); ++i) {
+        std::vector<uint8_t> bad = sink.data;
+        bad[i] ^= 0x20;
+        if (loadCompiledSub(bad.data(), bad.size(), key, back)) {
+            CHECK(!"a damaged sidecar loaded");
+            break;
+        }
+    }
+    CHECK(back.lines.empty()); // cleared on failure
+
+    CHECK_EQ(subCachePathHash("/BruceRF/a.sub"), subCachePathHash("/BruceRF/a.sub"));
+    CHECK(subCachePathHash("/BruceRF/a.sub") != subCachePathHash("/BruceRF/b.sub"));
+}
+
+int main() {
+    testSample();
+    testPresets();
+    testAgainstReference();
+    testStreamed();
+    testSidecar();
+    return hostTestResult("test_sub_compiler");
+}
@@ -0,0 +1,228 @@
+// WardriveApTable and its helpers: beacon parsing and security labels, merging beacons with probe
+// responses, the settle/force rules of drain(), pruning idle entries and the hop schedule parser.
+#include "host_test.h"
+#include "modules/gps/wardriving_ap_table.h"
+#include <vector>
+
+static const uint8_t BSSID[6] = {0x02, 0x10, 0x20, 0x30, 0x40, 0x50};
+
+// Beacon (or probe response) with an SSID IE, a DS parameter set and optional RSN / WPA IEs
+static std::vector<uint8_t> beacon(
+    const uint8_t *bssid, const char *ssid, size_t ssidLen, bool privacy, const std::vector<uint8_t> &rsn,
+    bool wpaIe, bool probeResponse = false
+) {
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    std::vector<uint8_t> f = {(uint8_t)(probeResponse ? 0x50 : 0x80), 0, 0, 0};
+    f.insert(f.end(), bcast, bcast + 6);
+    f.insert(f.end(), bssid, bssid + 6);
+    f.insert(f.end(), bssid, bssid + 6);
+    f.insert(f.end(), 2, 0);
+    f.insert(f.end(), 10, 0); // timestamp, interval
+    f.push_back(privacy ? 0x11 : 0x01);
+    f.push_back(0);
+    f.push_back(0);
+    f.push_back(ssidLen);
+    f.insert(f.end(), ssid, ssid + ssidLen);
+    f.insert(f.end(), {3, 1, 11});
+    if (!rsn.empty()) {
+        f.push_back(48);
+        f.push_back(rsn.size());
+        f.insert(f.end(), rsn.begin(), rsn.end());
+    }
+    if (wpaIe) f.insert(f.end(), {221, 6, 0x00, 0x50, 0xF2, 0x01, 0x01, 0x00});
+    return f;
+}
+
+// RSN IE body: version 1, CCMP group and pairwise, the given AKM suite types
+static std::vector<uint8_t> rsnWith(std::initializer_list<uint8_t> akms) {
+    std::vector<uint8_t> r = {1, 0, 0x00, 0x0F, 0xAC, 4, 1, 0, 0x00, 0x0F, 0xAC, 4};
+    r.push_back(akms.size());
+    r.push_back(0);
+    for (uint8_t akm : akms) r.insert(r.end(), {0x00, 0x0F, 0xAC, akm});
+    return r;
+}
+
+static bool parse(const std::vector<uint8_t> &bytes, WardriveBeacon &out, uint8_t heardOn = 6) {
+    WifiFrameDesc frame;
+    if (!parseWifiFrame(bytes.data(), bytes.size(), -60, heardOn, frame)) return false;
+    return parseWardriveBeacon(frame, out);
+}
+
+static void testParse() {
+    WardriveBeacon b;
+    CHECK(parse(beacon(BSSID, "home", 4, true, rsnWith({2}), false), b));
+    CHECK(b.bssid == macKey(BSSID));
+    CHECK(b.ssid.equals("home", 4));
+    CHECK_EQ(b.channel, 11); // DS parameter set wins over the channel the frame was heard on
+    CHECK_EQ(b.rssi, -60);
+    CHECK_EQ(b.auth, WARDRIVE_AUTH_WPA2_PSK);
+    CHECK(!b.probeResponse);
+
+    struct Case {
+        bool privacy;
+        std::vector<uint8_t> rsn;
+        bool wpa;
+        uint8_t auth;
+    } cases[] = {
+        {false, {}, false, WARDRIVE_AUTH_OPEN},
+        {true, {}, false, WARDRIVE_AUTH_WEP},
+        {true, {}, true, WARDRIVE_AUTH_WPA_PSK},
+        {true, rsnWith({2}), true, WARDRIVE_AUTH_WPA_WPA2_PSK},
+        {true, rsnWith({1}), false, WARDRIVE_AUTH_WPA2_ENTERPRISE},
+        {true, rsnWith({8}), false, WARDRIVE_AUTH_WPA3_PSK},
+        {true, rsnWith({2, 8}), false, WARDRIVE_AUTH_WPA2_WPA3_PSK},
+        {false, rsnWith({18}), false, WARDRIVE_AUTH_OWE},
+    };
+    for (const Case &c : cases) {
+        CHECK(parse(beacon(BSSID, "x", 1, c.privacy, c.rsn, c.wpa), b));
+        CHECK_EQ(b.auth, c.auth);
+    }
+    CHECK_STR(wardriveAuthName(WARDRIVE_AUTH_WPA2_WPA3_PSK), "WPA2_WPA3_PSK");
+
+    // hidden: empty or NUL-filled SSID
+    const char zeros[5] = {0};
+    CHECK(parse(beacon(BSSID, zeros, 5, true, rsnWith({2}), false), b));
+    CHECK(b.ssid.empty());
+
+    // a data frame is not a beacon
+    std::vector<uint8_t> data = beacon(BSSID, "x", 1, false, {}, false);
+    data[0] = 0x08;
+    CHECK(!parse(data, b));
+}
+
+static WardriveFix fixAt(double lat) {
+    WardriveFix fix;
+    fix.lat = lat;
+    fix.lng = 1.5;
+    fix.valid = true;
+    return fix;
+}
+
+static void testMergeAndDrain() {
+    WardriveApTable table;
+    CHECK(table.init(16));
+    WardriveBeacon hidden, named;
+    CHECK(parse(beacon(BSSID, "", 0, true, rsnWith({2}), false), hidden));
+    CHECK(parse(beacon(BSSID, "office", 6, false, {}, false, true), named));
+
+    // no fix yet: tracked but never handed out
+    CHECK(table.merge(hidden, 1000));
+    CHECK(!table.merge(hidden, 1100));
+    CHECK_EQ(table.drain(100000, 0, true, 10, [](uint64_t, const WardriveAp &) {}), 0);
+
+    // the probe response names it but does not overwrite what the beacon said
+    table.setFix(fixAt(10));
+    CHECK(!table.merge(named, 2000));
+    const WardriveAp *ap = table.find(macKey(BSSID));
+    CHECK(ap != nullptr);
+    if (ap) {
+        CHECK(ap->ssid.equals("office", 6));
+        CHECK_EQ(ap->auth, WARDRIVE_AUTH_WPA2_PSK);
+        CHECK(ap->first.valid && ap->first.lat == 10);
+        CHECK_EQ(ap->firstSeenMs, 1000);
+        CHECK_EQ(ap->lastSeenMs, 2000);
+    }
+    CHECK_EQ(table.stats().revealed, 1);
+    CHECK_EQ(table.stats().aps, 1);
+    CHECK_EQ(table.stats().frames, 3);
+
+    // settle time counts from the first sighting, force ignores it
+    size_t rows = 0;
+    uint64_t last = 0;
+    auto count = [&](uint64_t bssid, const WardriveAp &) {
+        last = bssid;
+        rows++;
+    };
+    CHECK_EQ(table.drain(1500, 5000, false, 10, count), 0);
+    CHECK_EQ(table.drain(1500, 5000, true, 10, count), 1);
+    CHECK(last == macKey(BSSID));
+    CHECK_EQ(table.drain(99999, 0, true, 10, count), 0); // logged once
+    CHECK_EQ(rows, 1);
+
+    // later fixes move `last` only
+    table.setFix(fixAt(20));
+    table.merge(named, 3000);
+    ap = table.find(macKey(BSSID));
+    if (ap) CHECK(ap->first.lat == 10 && ap->last.lat == 20);
+
+    // max bounds a drain
+    for (uint8_t i = 0; i < 5; ++i) {
+        uint8_t mac[6] = {0x02, 0, 0, 0, 1, i};
+        WardriveBeacon b;
+        parse(beacon(mac, "n", 1, false, {}, false), b);
+        table.merge(b, 4000);
+    }
+    CHECK_EQ(table.drain(4000, 0, false, 2, count), 2);
+    CHECK_EQ(table.drain(4000, 0, false, 10, count), 3);
+}
+
+static void testPrune() {
+    WardriveApTable table;
+    CHECK(table.init(16));
+    uint8_t macs[3][6] = {{2, 0, 0, 0, 0, 1}, {2, 0, 0, 0, 0, 2}, {2, 0, 0, 0, 0, 3}};
+    WardriveBeacon b[3];
+    for (int i = 0; i < 3; ++i) CHECK(parse(beacon(macs[i], "p", 1, false, {}, false), b[i]));
+
+    table.merge(b[0], 0); // never located
+    table.setFix(fixAt(1));
+    table.merge(b[1], 0); // located and logged
+    table.drain(0, 0, true, 10, [](uint64_t, const WardriveAp &) {});
+    table.merge(b[2], 50000); // still heard
+
+    CHECK_EQ(table.prune(60000, 30000), 2);
+    CHECK_EQ(table.size(), 1);
+    CHECK(table.find(macKey(macs[2])) != nullptr);
+    CHECK_EQ(table.stats().unlocated, 1);
+
+    // a pruned AP that comes back is new again
+    CHECK(table.merge(b[1], 61000));
+}
+
+// Filling the table with APs that never get a fix must not lock new ones out for good
+static void testPruneFreesRoom() {
+    WardriveApTable table;
+    CHECK(table.init(8)); // 6 usable
+    for (uint8_t i = 0; i < 6; ++i) {
+        uint8_t mac[6] = {2, 0, 0, 0, 2, i};
+        WardriveBeacon b;
+        parse(beacon(mac, "u", 1, false, {}, false), b);
+        CHECK(table.merge(b, 0));
+    }
+    uint8_t late[6] = {2, 0, 0, 0, 3, 0};
+    WardriveBeacon b;
+    parse(beacon(late, "l", 1, false, {}, false), b);
+    CHECK(!table.merge(b, 1000));
+    CHECK_EQ(table.stats().dropped, 1);
+    CHECK_EQ(table.prune(400000, 300000), 6);
+    CHECK(table.merge(b, 400000));
+}
+
+static void testHopSchedule() {
+    WardriveHopSchedule s;
+    s.setDefault();
+    CHECK_EQ(s.count(), 13);
+    CHECK_EQ(s.step(0).channel, 1);
+    CHECK_EQ(s.cycleMs(), 3 * 250 + 10 * 100);
+
+    const char spec[] = " 36:200, 1-3:50\n";
+    CHECK(s.parse(spec, strlen(spec)));
+    CHECK_EQ(s.count(), 4);
+    CHECK_EQ(s.step(0).channel, 36);
+    CHECK_EQ(s.step(3).channel, 3);
+    CHECK_EQ(s.step(3).dwellMs, 50);
+
+    const char *bad[] = {"", "6", "6:", "6:10", "0:100", "5-3:100", "1-40:100", "6:100,x"};
+    for (const char *text : bad) {
+        CHECK(!s.parse(text, strlen(text)));
+        CHECK_EQ(s.count(), 4); // untouched
+    }
+}
+
+int main() {
+    testParse();
+    testMergeAndDrain();
+    testPrune();
+    testPruneFreesRoom();
+    testHopSchedule();
+    return hostTestResult("test_wardriving_ap_table");
+}
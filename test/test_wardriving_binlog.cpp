@@ -0,0 +1,285 @@
+// Binary wardriving log: encode/decode round trips with names, key and delta fixes, the name
+// table reset, records cut short at the end of a file and sessions appended after a cut record
+// or after garbage, which the reader resyncs to. Rows without a fix are refused by every format.
+#include "host_test.h"
+#include "modules/gps/wardriving_binlog.h"
+#include <string>
+#include <vector>
+
+struct MemFile {
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+    size_t chunk = 512; // most bytes one read() returns
+    size_t read(uint8_t *buf, size_t len) {
+        size_t n = data.size() - pos;
+        if (n > len) n = len;
+        if (n > chunk) n = chunk;
+        memcpy(buf, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+    size_t write(const uint8_t *buf, size_t len) {
+        data.insert(data.end(), buf, buf + len);
+        return len;
+    }
+};
+
+static WardriveSighting sighting(int i) {
+    WardriveSighting s;
+    s.mac = 0x020000000000ull + i;
+    s.type = i % 3 == 0 ? WARDRIVE_DEVICE_BLE : WARDRIVE_DEVICE_WIFI;
+    if (s.type == WARDRIVE_DEVICE_BLE) {
+        s.mfgrId = 0x004C;
+    } else {
+        s.auth = WARDRIVE_AUTH_WPA2_PSK;
+        s.channel = 1 + i % 13;
+    }
+    s.rssi = -40 - i % 50;
+    if (i % 4 != 0) {
+        const std::string name = "net" + std::to_string(i % 7);
+        s.name.set(name.data(), name.size());
+    }
+    WardriveFix &fix = s.fix;
+    fix.valid = true;
+    fix.year = 2026;
+    fix.month = 10;
+    fix.day = 17;
+    fix.hour = 12;
+    fix.minute = i / 60 % 60;
+    fix.second = i % 60;
+    fix.lat = 38.7 + (i / 5) * 1e-4 + (i % 50 == 49 ? 1.0 : 0); // the occasional jump needs a key fix
+    fix.lng = -9.1 - (i / 5) * 1e-4;
+    fix.altitudeM = 12.5f;
+    fix.accuracyM = 1.25f;
+    return s;
+}
+
+static bool sameRow(const WardriveSighting &a, const WardriveSighting &b) {
+    return a.mac == b.mac && a.type == b.type && a.auth == b.auth && a.channel == b.channel &&
+           a.rssi == b.rssi && a.mfgrId == b.mfgrId && a.name.len == b.name.len &&
+           memcmp(a.name.text, b.name.text, a.name.len) == 0 &&
+           wardriveBinFix(a.fix) == wardriveBinFix(b.fix);
+}
+
+static void appendSession(MemFile &file, WardriveBinEncoder &enc, int first, int count) {
+    enc.restart();
+    uint8_t record[WardriveBinEncoder::MAX_OUTPUT];
+    for (int i = first; i < first + count; ++i) file.write(record, enc.encode(sighting(i), record));
+}
+
+static MemFile newFile() {
+    MemFile file;
+    uint8_t header[WARDRIVE_BIN_HEADER_SIZE];
+    file.write(header, WardriveBinEncoder::header(header));
+    return file;
+}
+
+// Decodes everything, returns the rows and the final result
+static std::vector<WardriveSighting> readAll(MemFile &file, int &last, uint32_t *damaged = nullptr) {
+    file.pos = 0;
+    std::vector<WardriveSighting> rows;
+    WardriveBinReader<MemFile> reader(file);
+    last = -1;
+    if (!reader.begin()) return rows;
+    WardriveSighting s;
+    while ((last = reader.next(s)) == WardriveBinReader<MemFile>::ROW) rows.push_back(s);
+    if (damaged) *damaged = reader.damaged();
+    return rows;
+}
+
+static size_t rowCount(MemFile &file) {
+    int last;
+    return readAll(file, last).size();
+}
+
+static void testRoundTrip() {
+    WardriveBinEncoder enc;
+    CHECK(enc.init());
+    MemFile file = newFile();
+    appendSession(file, enc, 0, 300);
+    CHECK(file.data.size() < 300 * 25); // a delta fix and a row each, names written once
+
+    for (size_t chunk : {(size_t)512, (size_t)7, (size_t)1}) {
+        file.chunk = chunk;
+        int last;
+        uint32_t damaged = 99;
+        const std::vector<WardriveSighting> rows = readAll(file, last, &damaged);
+        CHECK_EQ(last, WardriveBinReader<MemFile>::END);
+        CHECK_EQ(damaged, 0);
+        CHECK_EQ(rows.size(), 300);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (!sameRow(rows[i], sighting(i))) {
+                CHECK(sameRow(rows[i], sighting(i)));
+                break;
+            }
+        }
+    }
+
+    // more names than the table holds: a reset record starts the ids over
+    MemFile many = newFile();
+    enc.restart();
+    uint8_t record[WardriveBinEncoder::MAX_OUTPUT];
+    const size_t total = WardriveBinEncoder::MAX_NAMES * 2 + 10;
+    for (size_t i = 0; i < total; ++i) {
+        WardriveSighting s = sighting(1);
+        const std::string name = "unique" + std::to_string(i);
+        s.name.set(name.data(), name.size());
+        many.write(record, enc.encode(s, record));
+    }
+    int last;
+    const std::vector<WardriveSighting> rows = readAll(many, last);
+    CHECK_EQ(last, WardriveBinReader<MemFile>::END);
+    CHECK_EQ(rows.size(), total);
+    if (rows.size() == total) CHECK(rows[total - 1].name.equals("unique1033", 10));
+
+    // a name holding the sync record is dropped, the row stays
+    MemFile crafted = newFile();
+    enc.restart();
+    WardriveSighting s = sighting(1);
+    char text[12] = "x";
+    memcpy(text + 1, WARDRIVE_BIN_SYNC, sizeof(WARDRIVE_BIN_SYNC));
+    s.name.set(text, 9);
+    crafted.write(record, enc.encode(s, record));
+    crafted.write(record, enc.encode(sighting(2), record));
+    const std::vector<WardriveSighting> craftedRows = readAll(crafted, last);
+    CHECK_EQ(craftedRows.size(), 2);
+    if (craftedRows.size() == 2) CHECK(craftedRows[0].name.empty() && sameRow(craftedRows[1], sighting(2)));
+}
+
+// The file ends inside a record: END, with every whole row before it
+static void testCutAtEnd() {
+    WardriveBinEncoder enc;
+    CHECK(enc.init());
+    MemFile file = newFile();
+    appendSession(file, enc, 0, 20);
+    const size_t full = file.data.size();
+    for (size_t cut = full - 30; cut < full; ++cut) {
+        MemFile part;
+        part.data.assign(file.data.begin(), file.data.begin() + cut);
+        int last;
+        uint32_t damaged = 99;
+        const std::vector<WardriveSighting> rows = readAll(part, last, &damaged);
+        CHECK_EQ(last, WardriveBinReader<MemFile>::END);
+        CHECK_EQ(damaged, 0);
+        CHECK(rows.size() >= 17 && rows.size() <= 20);
+    }
+}
+
+// A session appended after the previous one was cut at any byte of its last records: every row of
+// the new session comes back and the result is not CORRUPT
+static void testAppendAfterCut() {
+    WardriveBinEncoder enc;
+    CHECK(enc.init());
+    MemFile first = newFile();
+    appendSession(first, enc, 0, 20);
+    const size_t full = first.data.size();
+    for (size_t cut = full - 60; cut <= full; ++cut) {
+        MemFile file;
+        file.data.assign(first.data.begin(), first.data.begin() + cut);
+        const size_t kept = rowCount(file);
+        appendSession(file, enc, 100, 30);
+        int last;
+        const std::vector<WardriveSighting> rows = readAll(file, last);
+        CHECK_EQ(last, WardriveBinReader<MemFile>::END);
+        CHECK_EQ(rows.size(), kept + 30);
+        bool tailOk = rows.size() >= 30;
+        for (size_t i = 0; tailOk && i < 30; ++i) {
+            tailOk = sameRow(rows[rows.size() - 30 + i], sighting(100 + i));
+        }
+        CHECK(tailOk);
+        if (!tailOk) break;
+    }
+}
+
+// Garbage between sessions is skipped and counted; garbage with no session after it is CORRUPT
+static void testGarbage() {
+    WardriveBinEncoder enc;
+    CHECK(enc.init());
+    MemFile file = newFile();
+    appendSession(file, enc, 0, 10);
+    const uint8_t junk[] = {0xEE, 'S', 0xA5, 'B', 'W', 0x00, 0x13, 'N', 200, 0x42};
+    file.write(junk, sizeof(junk));
+    MemFile corrupt = file;
+    appendSession(file, enc, 10, 10);
+
+    int last;
+    uint32_t damaged = 0;
+    std::vector<WardriveSighting> rows = readAll(file, last, &damaged);
+    CHECK_EQ(last, WardriveBinReader<MemFile>::END);
+    CHECK_EQ(rows.size(), 20);
+    CHECK_EQ(damaged, 1);
+
+    rows = readAll(corrupt, last);
+    CHECK_EQ(last, WardriveBinReader<MemFile>::CORRUPT);
+    CHECK_EQ(rows.size(), 10);
+
+    // a row before any fix does not decode either
+    MemFile noFix = newFile();
+    const uint8_t row[12] = {WARDRIVE_BIN_WIFI, 2, 0, 0, 0, 0, 1, 0xFF, 0xFF, 0, 1, 0xC0};
+    noFix.write(row, sizeof(row));
+    appendSession(noFix, enc, 0, 5);
+    rows = readAll(noFix, last, &damaged);
+    CHECK_EQ(rows.size(), 5);
+    CHECK_EQ(damaged, 1);
+}
+
+// Rows without a fix are refused by every format, and the next valid row still opens the session
+static void testInvalidFix() {
+    WardriveSighting s = sighting(1);
+    s.fix.valid = false;
+    char line[FixedSsid::MAX_LEN * 6 + 256];
+    CHECK_EQ(formatWigleRow(line, sizeof(line), s), 0);
+    CHECK_EQ(formatKmlPlacemark(line, sizeof(line), s), 0);
+    CHECK(formatWigleRow(line, sizeof(line), sighting(1)) > 0);
+
+    WardriveBinEncoder enc;
+    CHECK(enc.init());
+    MemFile file = newFile();
+    enc.restart();
+    uint8_t record[WardriveBinEncoder::MAX_OUTPUT];
+    CHECK_EQ(enc.encode(s, record), 0);
+    file.write(record, enc.encode(sighting(2), record));
+    int last;
+    const std::vector<WardriveSighting> rows = readAll(file, last);
+    CHECK_EQ(rows.size(), 1);
+    if (rows.size() == 1) CHECK(sameRow(rows[0], sighting(2)));
+}
+
+static void testExport() {
+    WardriveBinEncoder enc;
+    CHECK(enc.init());
+    MemFile file = newFile();
+    appendSession(file, enc, 0, 12);
+    MemFile csv;
+    WardriveExportResult result = wardriveExport(file, csv, WARDRIVE_EXPORT_CSV, "1.0");
+    CHECK(result.ok && !result.corrupt);
+    CHECK_EQ(result.rows, 12);
+    const std::string text(csv.data.begin(), csv.data.end());
+    size_t lines = 0;
+    for (char c : text) lines += c == '\n';
+    CHECK_EQ(lines, 2 + 12);
+    const char *row1 = "02:00:00:00:00:01,\"net1\",[WPA2_PSK],2026-10-17 12:00:01,2,2417,-41,";
+    CHECK(text.find(row1) != std::string::npos);
+
+    file.pos = 0;
+    MemFile kml;
+    result = wardriveExport(file, kml, WARDRIVE_EXPORT_KML, "1.0");
+    CHECK(result.ok);
+    const std::string k(kml.data.begin(), kml.data.end());
+    CHECK(k.size() > strlen(WARDRIVE_KML_FOOTER));
+    CHECK(k.compare(k.size() - strlen(WARDRIVE_KML_FOOTER), std::string::npos, WARDRIVE_KML_FOOTER) == 0);
+
+    MemFile notLog;
+    notLog.write((const uint8_t *)"MAC,SSID\n", 9);
+    CHECK(!wardriveExport(notLog, csv, WARDRIVE_EXPORT_CSV, "1.0").ok);
+}
+
+int main() {
+    testRoundTrip();
+    testCutAtEnd();
+    testAppendAfterCut();
+    testGarbage();
+    testInvalidFix();
+    testExport();
+    return hostTestResult("test_wardriving_binlog");
+}
@@ -0,0 +1,106 @@
+// WardriveDedup: the byte budget layout, LRU eviction checked against a list model, the re-log
+// window (including millis() wrap) and index deletion across long probe chains.
+#include "host_test.h"
+#include "modules/gps/wardriving_dedup.h"
+#include <list>
+#include <random>
+
+static void testLayout() {
+    size_t entries, buckets;
+    WardriveDedup::layoutFor(0, entries, buckets);
+    CHECK_EQ(entries, 0);
+
+    const size_t budgets[] = {100, 4 * 1024, 16 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+    for (size_t budget : budgets) {
+        WardriveDedup::layoutFor(budget, entries, buckets);
+        CHECK(entries > 0);
+        CHECK(entries <= buckets - buckets / 4);
+        CHECK(entries <= WardriveDedup::MAX_ENTRIES);
+        CHECK((buckets & (buckets - 1)) == 0);
+        CHECK(entries * WardriveDedup::NODE_BYTES + buckets * sizeof(uint16_t) <= budget);
+    }
+    WardriveDedup::layoutFor(16 * 1024, entries, buckets);
+    CHECK_EQ(entries, 768); // the default setting
+
+    WardriveDedup dedup;
+    CHECK(!dedup.init(8));
+    CHECK(dedup.shouldLog(1, 0, 0)); // not allocated: log everything
+    CHECK(dedup.init(4 * 1024));
+    CHECK(dedup.memoryBytes() <= 4 * 1024);
+    dedup.release();
+    CHECK_EQ(dedup.memoryBytes(), 0);
+}
+
+static void testLru() {
+    WardriveDedup dedup;
+    CHECK(dedup.init(100)); // 8 buckets, 6 entries
+    CHECK_EQ(dedup.capacity(), 5);
+    for (uint64_t k = 1; k <= 5; ++k) CHECK(dedup.shouldLog(k, 0, 0));
+    CHECK(!dedup.shouldLog(1, 0, 0)); // 1 is now the most recent, 2 the least
+    CHECK(dedup.shouldLog(6, 0, 0));
+    CHECK_EQ(dedup.stats().evicted, 1);
+    CHECK(!dedup.shouldLog(1, 0, 0));
+    CHECK(!dedup.shouldLog(3, 0, 0));
+    CHECK(dedup.shouldLog(2, 0, 0)); // evicted, logged again
+    CHECK_EQ(dedup.size(), 5);
+}
+
+static void testRelogWindow() {
+    WardriveDedup dedup;
+    CHECK(dedup.init(4 * 1024));
+    CHECK(dedup.shouldLog(7, 1000, 60000));
+    CHECK(!dedup.shouldLog(7, 60999, 60000));
+    CHECK(dedup.shouldLog(7, 61000, 60000));
+    CHECK(!dedup.shouldLog(7, 62000, 60000)); // the window restarts at the re-log
+    CHECK_EQ(dedup.stats().relogged, 1);
+    CHECK_EQ(dedup.stats().logged, 2);
+
+    // across the millis() wrap
+    CHECK(dedup.shouldLog(8, 0xFFFFF000u, 60000));
+    CHECK(!dedup.shouldLog(8, 0x1000, 60000));
+    CHECK(dedup.shouldLog(8, 0xFFFFF000u + 60000, 60000));
+
+    // window 0: once per session, however long ago
+    CHECK(!dedup.shouldLog(7, 0x7FFFFFFF, 0));
+    dedup.clear();
+    CHECK_EQ(dedup.size(), 0);
+    CHECK(dedup.shouldLog(7, 0, 0));
+}
+
+// Random keys against a list model of the LRU order; a small key space keeps the set full and
+// evicting, and clustered keys make long probe chains for the backward-shift deletion
+static void testAgainstModel() {
+    WardriveDedup dedup;
+    CHECK(dedup.init(1024));
+    const size_t cap = dedup.capacity();
+    std::list<uint64_t> model; // front is the most recent
+    std::mt19937 rng(99);
+    uint32_t evicted = 0;
+    for (int step = 0; step < 200000; ++step) {
+        const uint64_t key = (rng() % 3 == 0) ? (uint64_t)(rng() % 64) << 32 : rng() % (cap * 2);
+        bool known = false;
+        for (auto it = model.begin(); it != model.end(); ++it) {
+            if (*it == key) {
+                model.erase(it);
+                known = true;
+                break;
+            }
+        }
+        if (!known && model.size() == cap) {
+            model.pop_back();
+            evicted++;
+        }
+        model.push_front(key);
+        CHECK_EQ(dedup.shouldLog(key, step, 0), !known);
+        if (step % 5000 == 0) CHECK_EQ(dedup.size(), model.size());
+    }
+    CHECK_EQ(dedup.stats().evicted, evicted);
+}
+
+int main() {
+    testLayout();
+    testLru();
+    testRelogWindow();
+    testAgainstModel();
+    return hostTestResult("test_wardriving_dedup");
+}
@@ -0,0 +1,182 @@
+// WardriveLogWriter on a local file: block writes end on 512 byte boundaries of the file (also
+// when it already held a partial block, and after a sync pushed one out), close() writes the
+// partial final block, rows larger than the buffer keep their order, and a short write is
+// reported with only the bytes that made it in the file.
+#include "host_test.h"
+#include "modules/gps/wardriving_writer.h"
+#include <random>
+#include <string>
+#include <vector>
+
+struct Write {
+    long offset;
+    size_t len;
+};
+
+// A temporary file. close() only marks it closed, the test reads it back afterwards.
+struct LocalFile {
+    FILE *f = nullptr;
+    std::vector<Write> *writes = nullptr;
+    long limit = -1; // file size at which writes come up short, -1 for none
+    bool *closed = nullptr;
+
+    size_t write(const uint8_t *buf, size_t len) {
+        const long at = ftell(f);
+        size_t n = len;
+        if (limit >= 0) n = at >= limit ? 0 : (size_t)(limit - at) < len ? limit - at : len;
+        n = fwrite(buf, 1, n, f);
+        writes->push_back({at, n});
+        return n;
+    }
+    void flush() { fflush(f); }
+    void close() { *closed = true; }
+    explicit operator bool() const { return f != nullptr; }
+};
+
+static std::string contents(FILE *f) {
+    fflush(f);
+    fseek(f, 0, SEEK_END);
+    std::string out(ftell(f), '\0');
+    fseek(f, 0, SEEK_SET);
+    if (fread(&out[0], 1, out.size(), f) != out.size()) out.clear();
+    fseek(f, 0, SEEK_END);
+    return out;
+}
+
+static std::vector<std::string> makeRows(size_t count, std::mt19937 &rng) {
+    std::vector<std::string> rows;
+    for (size_t i = 0; i < count; ++i) {
+        std::string row = "02:00:00:00:" + std::to_string(i) + ",net" + std::to_string(rng() % 1000);
+        row += ",[WPA2]" + std::string(rng() % 120, 'x') + "\n";
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+// Every write but the ones a sync or close() issued ends on a block boundary of the file
+static bool blockAligned(const std::vector<Write> &writes, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+        if ((writes[i].offset + writes[i].len) % WardriveLogWriter<LocalFile>::WRITE_BLOCK != 0) {
+            fprintf(stderr, "write %zu: %zu bytes at %ld\n", i, writes[i].len, writes[i].offset);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Appended to a file that already holds a partial block, synced once in the middle
+static void testAlignment() {
+    std::mt19937 rng(21);
+    for (size_t existing : {0, 700, 1024, 4000}) {
+        FILE *f = tmpfile();
+        CHECK(f != nullptr);
+        if (!f) return;
+        const std::string before(existing, 'h');
+        fwrite(before.data(), 1, before.size(), f);
+        std::vector<Write> writes;
+        bool closed = false;
+        LocalFile file = {f, &writes, -1, &closed};
+        std::vector<uint8_t> buffer(4096 + 100); // rounded down to 8 blocks
+
+        WardriveLogWriter<LocalFile> writer;
+        writer.setBuffer(buffer.data(), buffer.size());
+        writer.setFlushInterval(1000);
+        CHECK(writer.attach(file, existing, 0));
+        const std::vector<std::string> rows = makeRows(1000, rng);
+        std::string expected = before;
+        size_t syncWrite = SIZE_MAX;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            CHECK(writer.append(rows[i].data(), rows[i].size()));
+            expected += rows[i];
+            if (i == rows.size() / 2) {
+                CHECK(writer.poll(999)); // not due yet
+                syncWrite = writes.size();
+                CHECK(writer.poll(1000)); // pushes out the partial block
+                CHECK_EQ(writes.size(), syncWrite + 1);
+            }
+        }
+        CHECK(writes.size() > 10);
+        const size_t beforeClose = writes.size();
+        CHECK(blockAligned(writes, 0, syncWrite));
+        CHECK(blockAligned(writes, syncWrite + 1, beforeClose)); // realigned to the file offset
+
+        const size_t tail = writer.buffered();
+        CHECK(tail > 0);
+        writer.close();
+        CHECK(closed);
+        CHECK(!writer.isOpen());
+        CHECK_EQ(writes.size(), beforeClose + 1);
+        CHECK_EQ(writes.back().len, tail); // the partial final block
+        CHECK_EQ(writer.stats().rows, rows.size());
+        CHECK_EQ(writer.stats().failed, 0);
+        CHECK_EQ(writer.stats().bytes, expected.size() - existing);
+        CHECK(contents(f) == expected);
+        fclose(f);
+    }
+}
+
+static void testLargeRowsAndNoBuffer() {
+    std::mt19937 rng(4);
+    for (size_t capacity : {0, 1500}) {
+        FILE *f = tmpfile();
+        CHECK(f != nullptr);
+        if (!f) return;
+        std::vector<Write> writes;
+        bool closed = false;
+        std::vector<uint8_t> buffer(capacity);
+        WardriveLogWriter<LocalFile> writer;
+        writer.setBuffer(capacity ? buffer.data() : nullptr, capacity);
+        CHECK(writer.attach(LocalFile{f, &writes, -1, &closed}, 0, 0));
+        std::string expected;
+        std::vector<std::string> rows = makeRows(50, rng);
+        rows[10] = std::string(3000, 'L') + "\n"; // larger than the 1024 bytes of buffer kept
+        rows[30] = std::string(1024, 'M');
+        for (const std::string &row : rows) {
+            CHECK(writer.append(row.data(), row.size()));
+            expected += row;
+        }
+        writer.close();
+        CHECK(contents(f) == expected);
+        if (capacity == 0) CHECK_EQ(writes.size(), rows.size()); // one write per row
+        else CHECK(writes.size() < rows.size());
+        fclose(f);
+    }
+}
+
+// The card fills up: the write comes up short, append() says so, the file has what was written
+static void testShortWrite() {
+    std::mt19937 rng(8);
+    FILE *f = tmpfile();
+    CHECK(f != nullptr);
+    if (!f) return;
+    std::vector<Write> writes;
+    bool closed = false;
+    std::vector<uint8_t> buffer(2048);
+    WardriveLogWriter<LocalFile> writer;
+    writer.setBuffer(buffer.data(), buffer.size());
+    CHECK(writer.attach(LocalFile{f, &writes, 5000, &closed}, 0, 0));
+    std::string expected;
+    bool refused = false;
+    for (const std::string &row : makeRows(300, rng)) {
+        expected += row;
+        if (!writer.append(row.data(), row.size())) {
+            refused = true;
+            break;
+        }
+    }
+    CHECK(refused);
+    CHECK(writer.stats().failed >= 1);
+    CHECK_EQ(writer.stats().bytes, 5000);
+    writer.close();
+    const std::string written = contents(f);
+    CHECK_EQ(written.size(), 5000);
+    CHECK(written == expected.substr(0, 5000));
+    fclose(f);
+}
+
+int main() {
+    testAlignment();
+    testLargeRowsAndNoBuffer();
+    testShortWrite();
+    return hostTestResult("test_wardriving_writer");
+}
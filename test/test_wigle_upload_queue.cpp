@@ -0,0 +1,281 @@
+// WigleUploadQueue and wigleUploadStep against a fake server: parts that split on row boundaries
+// and repeat the header, the saved queue format, and the rule that a part whose outcome is unknown
+// is only sent again once the server says it is not there.
+#include "host_test.h"
+#include "modules/gps/wigle_upload_queue.h"
+#include <map>
+#include <string>
+#include <vector>
+
+static const char HEADER[] = "WigleWifi-1.6,appRelease=v1\nMAC,SSID,AuthMode\n";
+
+struct MemFile {
+    std::string data;
+    size_t pos = 0;
+    void seek(size_t p) { pos = p < data.size() ? p : data.size(); }
+    size_t read(uint8_t *buf, size_t len) {
+        const size_t n = data.size() - pos < len ? data.size() - pos : len;
+        memcpy(buf, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+};
+
+static MemFile wigleFile(int rows) {
+    MemFile f;
+    f.data = HEADER;
+    for (int i = 0; i < rows; ++i) {
+        f.data += "02:00:00:00:00:" + std::to_string(10 + i % 90) + ",net,[WPA2]\n";
+    }
+    return f;
+}
+
+// Keeps what was uploaded by part name. A send can be made to fail before or after it landed.
+struct FakeServer {
+    std::map<std::string, std::string> parts;
+    std::vector<std::string> order;
+    int sends = 0;
+    int lookups = 0;
+    int failNext = 0;              // sends that fail...
+    bool failAfterLanding = false; // ...after the part landed
+    int landedAnswer = 2;          // 2: answer from parts, otherwise returned as is
+    bool reject = false;
+
+    WigleSendResult send(
+        const char *name,
+        const uint8_t *header,
+        size_t headerLen,
+        MemFile &file,
+        uint32_t offset,
+        uint32_t length
+    ) {
+        sends++;
+        if (reject) return WIGLE_SEND_REJECTED;
+        if (failNext > 0 && !failAfterLanding) {
+            failNext--;
+            return WIGLE_SEND_FAILED;
+        }
+        std::string body((const char *)header, headerLen);
+        body += file.data.substr(offset, length);
+        parts[name] = body;
+        order.push_back(name);
+        if (failNext > 0) {
+            failNext--;
+            return WIGLE_SEND_FAILED;
+        }
+        return WIGLE_SEND_OK;
+    }
+    int landed(const char *name) {
+        lookups++;
+        if (landedAnswer != 2) return landedAnswer;
+        return parts.count(name) ? 1 : 0;
+    }
+};
+
+// Rows the server holds, in upload order, without the repeated headers
+static std::string uploadedRows(const FakeServer &server) {
+    std::string rows;
+    for (const std::string &name : server.order) rows += server.parts.at(name).substr(strlen(HEADER));
+    return rows;
+}
+
+static void testQueue() {
+    CHECK_EQ(WigleUploadQueue::backoffMs(0), 0);
+    CHECK_EQ(WigleUploadQueue::backoffMs(1), 2000);
+    CHECK_EQ(WigleUploadQueue::backoffMs(3), 8000);
+    CHECK_EQ(WigleUploadQueue::backoffMs(40), WigleUploadQueue::BACKOFF_MAX_MS);
+
+    WigleUploadQueue q;
+    WigleQueueEntry *e = q.add("/BruceWardriving/a.csv", 1000);
+    CHECK(e != nullptr);
+    e->offset = 600;
+    e->parts = 2;
+    CHECK(q.add("/BruceWardriving/a.csv", 1200) == e); // grew, progress kept
+    CHECK_EQ(e->offset, 600);
+    CHECK(q.add("/BruceWardriving/a.csv", 500) == e); // replaced, starts over
+    CHECK_EQ(e->offset, 0);
+    CHECK_EQ(e->size, 500);
+    CHECK(q.add(std::string(120, 'x').c_str(), 1) == nullptr);
+    for (size_t i = q.count(); i < WIGLE_QUEUE_MAX_FILES; ++i) {
+        CHECK(q.add(("/f" + std::to_string(i) + ".csv").c_str(), i) != nullptr);
+    }
+    CHECK(q.add("/one_more.csv", 1) == nullptr);
+
+    q.at(3).pendingEnd = 77;
+    q.at(3).attempts = 4;
+    char text[WIGLE_QUEUE_MAX_FILES * 160];
+    const size_t len = q.serialize(text, sizeof(text));
+    CHECK(len > 0);
+    CHECK_EQ(q.serialize(text, 20), 0);
+    WigleUploadQueue back;
+    back.parse(text, len);
+    CHECK_EQ(back.count(), q.count());
+    CHECK_STR(back.at(3).path, q.at(3).path);
+    CHECK_EQ(back.at(3).pendingEnd, 77);
+    CHECK_EQ(back.at(3).attempts, 4);
+
+    const char saved[] =
+        "# wigle upload queue v1\r\n10 0 1 0 20 /a.csv\r\nbroken line\n5 0 0\n1 2 3 4 5 /b.csv";
+    back.parse(saved, strlen(saved));
+    CHECK_EQ(back.count(), 2);
+    CHECK_STR(back.at(0).path, "/a.csv");
+    CHECK_STR(back.at(1).path, "/b.csv");
+    CHECK_EQ(back.at(1).size, 5);
+
+    back.remove(0);
+    CHECK_EQ(back.count(), 1);
+    CHECK_EQ(back.find("/b.csv"), 0);
+    CHECK_EQ(back.find("/a.csv"), -1);
+
+    char name[64];
+    wiglePartName(name, sizeof(name), "/BruceWardriving/2026_wardriving.csv", 4096);
+    CHECK_STR(name, "2026_wardriving_4096.csv");
+}
+
+static void testSplit() {
+    MemFile f = wigleFile(50);
+    uint8_t header[WIGLE_HEADER_MAX];
+    const size_t headerLen = wigleReadHeader(f, header, sizeof(header));
+    CHECK_EQ(headerLen, strlen(HEADER));
+    const uint32_t size = f.data.size();
+    uint32_t offset = headerLen;
+    while (offset < size) {
+        const uint32_t end = wiglePartEnd(f, offset, size, 300);
+        CHECK(end > offset && end - offset <= 300);
+        CHECK(f.data[end - 1] == '\n');
+        offset = end;
+    }
+
+    // a row cut short at the end is never part of a part
+    MemFile cut = f;
+    cut.data += "02:00:00:00:00:99,tr";
+    CHECK_EQ(wiglePartEnd(cut, size, cut.data.size(), 300), size);
+
+    MemFile notWigle;
+    notWigle.data = "MAC,SSID\n1,2\n";
+    CHECK_EQ(wigleReadHeader(notWigle, header, sizeof(header)), 0);
+}
+
+// Runs steps until the file is done or stepping stops, counting how often the queue was saved
+static WigleStepResult run(WigleQueueEntry &e, MemFile &f, FakeServer &server, int &saves) {
+    WigleStepResult r = WIGLE_STEP_PART_DONE;
+    for (int i = 0; i < 100 && r == WIGLE_STEP_PART_DONE; ++i) {
+        r = wigleUploadStep(e, f, server, 512, [&]() { saves++; });
+    }
+    return r;
+}
+
+static void testUpload() {
+    MemFile f = wigleFile(100);
+    WigleUploadQueue q;
+    WigleQueueEntry &e = *q.add("/w/run.csv", f.data.size());
+    FakeServer server;
+    int saves = 0;
+    CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_FILE_DONE);
+    CHECK(e.done());
+    CHECK(server.order.size() > 5);
+    CHECK_EQ(e.parts, server.order.size());
+    CHECK(uploadedRows(server) == f.data.substr(strlen(HEADER)));
+    for (const auto &part : server.parts) {
+        CHECK(part.second.size() <= 512 && part.second.compare(0, strlen(HEADER), HEADER) == 0);
+    }
+    CHECK(saves >= 2 * (int)e.parts); // before and after every part
+
+    // more rows appended later go up as new parts
+    f.data += "02:00:00:00:00:AA,late,[OPEN]\n";
+    q.add("/w/run.csv", f.data.size());
+    CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_FILE_DONE);
+    CHECK(uploadedRows(server) == f.data.substr(strlen(HEADER)));
+}
+
+static void testUnknownOutcome() {
+    MemFile f = wigleFile(40);
+    WigleUploadQueue q;
+    int saves = 0;
+
+    // the part landed but the answer was lost: confirmed by lookup, never sent twice
+    {
+        FakeServer server;
+        WigleQueueEntry &e = *q.add("/w/a.csv", f.data.size());
+        server.failNext = 1;
+        server.failAfterLanding = true;
+        CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_RETRY);
+        CHECK(e.pendingEnd != 0);
+        CHECK_EQ(e.attempts, 1);
+        const int sends = server.sends;
+        CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_FILE_DONE);
+        CHECK_EQ(server.lookups, 1);
+        CHECK(uploadedRows(server) == f.data.substr(strlen(HEADER)));
+        CHECK_EQ(server.sends, sends + (int)e.parts - 1);
+    }
+
+    // the server cannot be asked: retry later, do not resend
+    {
+        FakeServer server;
+        WigleQueueEntry &e = *q.add("/w/b.csv", f.data.size());
+        server.failNext = 1;
+        server.failAfterLanding = true;
+        CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_RETRY);
+        server.landedAnswer = -1;
+        for (int i = 0; i < 3; ++i) CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_RETRY);
+        CHECK_EQ(server.sends, 1);
+        CHECK_EQ(e.attempts, 4);
+        server.landedAnswer = 2;
+        CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_FILE_DONE);
+        CHECK(uploadedRows(server) == f.data.substr(strlen(HEADER)));
+    }
+
+    // it did not land: sent again
+    {
+        FakeServer server;
+        WigleQueueEntry &e = *q.add("/w/c.csv", f.data.size());
+        server.failNext = 1;
+        CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_RETRY);
+        CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_FILE_DONE);
+        CHECK(uploadedRows(server) == f.data.substr(strlen(HEADER)));
+        CHECK_EQ(e.attempts, 0);
+    }
+
+    // a bad token ends the run
+    {
+        FakeServer server;
+        WigleQueueEntry &e = *q.add("/w/d.csv", f.data.size());
+        server.reject = true;
+        CHECK_EQ(run(e, f, server, saves), WIGLE_STEP_REJECTED);
+    }
+
+    MemFile bad;
+    bad.data = "not a wigle file\n";
+    WigleQueueEntry &e = *q.add("/w/e.csv", bad.data.size());
+    FakeServer server;
+    CHECK_EQ(run(e, bad, server, saves), WIGLE_STEP_BAD_FILE);
+    CHECK_EQ(server.sends, 0);
+}
+
+static void feed(WigleTransactionScan &scan, const std::string &text) {
+    for (char c : text) scan.feed(c);
+}
+
+static void testTransactionScan() {
+    WigleTransactionScan scan("run_4096.csv");
+    feed(scan, "{\"success\":true,\"results\":[");
+    for (int i = 0; i < 3; ++i) {
+        feed(scan, "{\"transid\":\"2026" + std::to_string(i) + "\",\"fileName\":\"run_" + std::to_string(i) +
+                       ".csv\",\"fileName\":\"\"run_4096.csv\"},");
+    }
+    CHECK_EQ(scan.entries(), 3);
+    CHECK(!scan.found());
+    scan.nextPage();
+    feed(scan, "{\"transid\":\"1\",\"fileName\":\"run_4096.csv\"}]}");
+    CHECK_EQ(scan.entries(), 1);
+    CHECK(scan.found());
+}
+
+int main() {
+    testQueue();
+    testSplit();
+    testUpload();
+    testUnknownOutcome();
+    testTransactionScan();
+    return hostTestResult("test_wigle_upload_queue");
+}
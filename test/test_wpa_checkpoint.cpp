@@ -0,0 +1,241 @@
+// Recovery checkpoints: runs stopped with up to MAX_IN_FLIGHT batches out, finishing in any order,
+// are saved, reloaded and resumed without skipping a candidate or counting one twice; a damaged
+// checkpoint or one for another wordlist, rule set or handshake is refused.
+#include "host_test.h"
+#include "modules/wifi/wpa_candidates.h"
+#include "modules/wifi/wpa_checkpoint.h"
+#include "modules/wifi/wpa_rules.h"
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+struct MemFile {
+    const std::string *data;
+    size_t pos = 0;
+
+    int read(uint8_t *buf, size_t len) {
+        const size_t n = data->size() - pos < len ? data->size() - pos : len;
+        memcpy(buf, data->data() + pos, n);
+        pos += n;
+        return n;
+    }
+    bool seek(uint32_t p) {
+        if (p > data->size()) return false;
+        pos = p;
+        return true;
+    }
+};
+
+static std::string makeWordlist(std::mt19937 &rng, size_t words) {
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        if (rng() % 40 == 0) text += "# skipped\n";
+        text += "password" + std::to_string(i) + std::string(rng() % 6, 'x') + "\n";
+    }
+    return text;
+}
+
+// The fingerprint wifi_recover() gives a wordlist: its path, then every rule folded in
+static uint32_t wordlistHash(const char *path, const WpaRuleSet *rules) {
+    uint32_t h = fnv1a32(path, strlen(path));
+    for (size_t r = 0; rules && r < rules->count(); ++r) {
+        h = fnv1a32(rules->rule(r).ops, rules->rule(r).len, h);
+    }
+    return h;
+}
+
+struct Run {
+    RecoverCheckpoint cp;
+    std::map<std::string, int> tested; // candidate -> times tested, over all runs
+};
+
+// One run from cp: batches go out until the frontier is full, come back in random order, and
+// after stopAfter returns the run stops with whatever is still out. A batch out at the stop is
+// either cut short (returned incomplete) or never comes back. Returns true at the end of the
+// wordlist, with nothing out.
+static bool runOnce(
+    Run &run,
+    const std::string &wordlist,
+    std::mt19937 &rng,
+    size_t stopAfter,
+    uint8_t batchWords
+) {
+    MemFile file = {&wordlist};
+    WordlistReader<MemFile> reader;
+    CHECK(reader.begin(&file, run.cp.offset));
+    RecoverFrontier frontier;
+    frontier.reset(run.cp.offset, run.cp.tested);
+    std::vector<CandidateBatch> out;
+    size_t returns = 0;
+    bool inputDone = false;
+    while (true) {
+        while (!inputDone && !frontier.full() && rng() % 4) {
+            CandidateBatch batch;
+            if (!reader.fill(batch, batchWords)) {
+                inputDone = true;
+                break;
+            }
+            batch.seq = frontier.dispatched(batch.endOffset);
+            out.push_back(batch);
+        }
+        CHECK(frontier.inFlight() <= RecoverFrontier::MAX_IN_FLIGHT);
+        if (out.empty()) {
+            if (inputDone) break;
+            continue;
+        }
+        if (returns == stopAfter) {
+            for (CandidateBatch &b : out) {
+                if (rng() % 2) continue; // still queued: never tested
+                const uint8_t cut = rng() % b.count; // the worker stopped part way
+                for (uint8_t i = 0; i < cut; ++i) run.tested[b.words[i]]++;
+                frontier.returned(b.seq, false, cut);
+            }
+            break;
+        }
+        const size_t pick = rng() % out.size();
+        CandidateBatch b = out[pick];
+        out.erase(out.begin() + pick);
+        for (uint8_t i = 0; i < b.count; ++i) run.tested[b.words[i]]++;
+        frontier.returned(b.seq, true, b.count);
+        returns++;
+    }
+    run.cp.offset = frontier.offset();
+    run.cp.tested = frontier.tested();
+    return inputDone && out.empty() && returns != stopAfter;
+}
+
+// Saved as the bytes save_checkpoint() writes and read back as load_checkpoint() does
+static RecoverCheckpoint reload(RecoverCheckpoint cp) {
+    cp.seal();
+    uint8_t bytes[sizeof(RecoverCheckpoint)];
+    memcpy(bytes, &cp, sizeof(bytes));
+    RecoverCheckpoint loaded;
+    memset(&loaded, 0xA5, sizeof(loaded));
+    memcpy(&loaded, bytes, sizeof(loaded));
+    return loaded;
+}
+
+static void testInterrupted() {
+    std::mt19937 rng(3);
+    for (int round = 0; round < 300; ++round) {
+        const std::string wordlist = makeWordlist(rng, 200 + rng() % 2000);
+        std::vector<std::string> all;
+        {
+            MemFile file = {&wordlist};
+            WordlistReader<MemFile> reader;
+            reader.begin(&file, 0);
+            CandidateBatch batch;
+            while (reader.fill(batch)) {
+                for (uint8_t i = 0; i < batch.count; ++i) all.push_back(batch.words[i]);
+            }
+        }
+        const uint8_t batchWords = 1 + rng() % WPA_BATCH_CANDIDATES;
+        const uint32_t hash = wordlistHash("/wordlists/test.txt", nullptr);
+
+        Run run;
+        memset(&run.cp, 0, sizeof(run.cp));
+        run.cp.handshake = 0x1234;
+        run.cp.wordlistPath = hash;
+        run.cp.wordlistSize = wordlist.size();
+        int stops = 0;
+        bool finished = false;
+        while (!finished && stops < 1000) {
+            const size_t stopAfter = rng() % 3 ? rng() % 40 : SIZE_MAX;
+            finished = runOnce(run, wordlist, rng, stopAfter, batchWords);
+            if (finished) break;
+            stops++;
+            const RecoverCheckpoint loaded = reload(run.cp);
+            CHECK(loaded.matches(0x1234, hash, wordlist.size()));
+            CHECK(loaded.offset == run.cp.offset && loaded.tested == run.cp.tested);
+            run.cp = loaded;
+        }
+        CHECK(finished);
+
+        // every candidate tested at least once; the count is exact, as if nothing ever stopped
+        bool ok = run.cp.offset == wordlist.size() && run.cp.tested == all.size();
+        for (const std::string &word : all) ok = ok && run.tested[word] >= 1;
+        if (!ok) {
+            fprintf(
+                stderr,
+                "round %d, %d stops: offset %u of %zu, %u of %zu counted\n",
+                round,
+                stops,
+                run.cp.offset,
+                wordlist.size(),
+                run.cp.tested,
+                all.size()
+            );
+            CHECK(ok);
+            return;
+        }
+    }
+}
+
+// The frontier alone: up to MAX_IN_FLIGHT out, the oldest one still missing pins it
+static void testFrontier() {
+    RecoverFrontier f;
+    f.reset(100, 7);
+    for (uint32_t i = 0; i < RecoverFrontier::MAX_IN_FLIGHT; ++i) CHECK_EQ(f.dispatched(200 + i * 10), i);
+    CHECK(f.full());
+    for (uint32_t seq = RecoverFrontier::MAX_IN_FLIGHT - 1; seq >= 1; --seq) f.returned(seq, true, 3);
+    CHECK_EQ(f.offset(), 100);
+    CHECK_EQ(f.tested(), 7);
+    f.returned(0, false, 2); // cut short: pins it
+    CHECK_EQ(f.offset(), 100);
+    f.returned(0, true, 4);
+    CHECK_EQ(f.offset(), 200 + (RecoverFrontier::MAX_IN_FLIGHT - 1) * 10);
+    CHECK_EQ(f.tested(), 7 + 4 + 3 * (RecoverFrontier::MAX_IN_FLIGHT - 1));
+    CHECK_EQ(f.inFlight(), 0);
+    f.returned(5, true, 100); // late or unknown: ignored
+    f.returned(99, true, 100);
+    CHECK_EQ(f.tested(), 7 + 4 + 3 * (RecoverFrontier::MAX_IN_FLIGHT - 1));
+}
+
+static void testRefused() {
+    WpaRuleSet rules;
+    rules.init(512);
+    rules.addDefaults();
+    const uint32_t plain = wordlistHash("/rockyou.txt", nullptr);
+    const uint32_t ruled = wordlistHash("/rockyou.txt", &rules);
+    CHECK(plain != ruled);
+    CHECK(plain != wordlistHash("/rockyou2.txt", nullptr));
+
+    RecoverCheckpoint cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.handshake = 0xCAFE;
+    cp.wordlistPath = ruled;
+    cp.wordlistSize = 5000;
+    cp.offset = 1234;
+    cp.tested = 99;
+    const RecoverCheckpoint good = reload(cp);
+    CHECK(good.matches(0xCAFE, ruled, 5000));
+    CHECK(!good.matches(0xCAFE, plain, 5000)); // same wordlist without the rules
+    CHECK(!good.matches(0xCAFE, ruled, 5001)); // the file changed
+    CHECK(!good.matches(0xBEEF, ruled, 5000)); // other handshakes
+
+    // any byte flipped before the crc, or in it, is caught
+    for (size_t i = 0; i < sizeof(RecoverCheckpoint); ++i) {
+        RecoverCheckpoint bad = good;
+        ((uint8_t *)&bad)[i] ^= 0x10;
+        if (bad.matches(0xCAFE, ruled, 5000)) {
+            fprintf(stderr, "byte %zu flipped and still accepted\n", i);
+            CHECK(false);
+        }
+    }
+    // sealed with a wrong crc, e.g. a torn write that left the old one
+    RecoverCheckpoint stale = good;
+    stale.offset = 2000;
+    CHECK(!stale.matches(0xCAFE, ruled, 5000));
+    cp.offset = 5001; // past the end, even with a valid crc
+    CHECK(!reload(cp).matches(0xCAFE, ruled, 5000));
+    cp.offset = 5000;
+    CHECK(reload(cp).matches(0xCAFE, ruled, 5000));
+}
+
+int main() {
+    testFrontier();
+    testInterrupted();
+    testRefused();
+    return hostTestResult("test_wpa_checkpoint");
+}
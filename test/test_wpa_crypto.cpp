@@ -0,0 +1,251 @@
+// WPA key derivation: HMAC-SHA1 against reference digests across the padding boundaries, the PMK
+// against the IEEE 802.11i PBKDF2 vectors with both software block functions, the passphrase and
+// SSID bounds, and the MIC (EAPOL frame, MIC at offset 81) and PMKID checks of a PMK.
+#include "host_test.h"
+#include "modules/wifi/wpa_crypto.h"
+#include <string>
+
+// The reference values come from Python's hashlib / hmac
+static void fromHex(const char *hex, uint8_t *out) {
+    for (size_t i = 0; hex[2 * i]; ++i) {
+        unsigned v;
+        sscanf(hex + 2 * i, "%2x", &v);
+        out[i] = v;
+    }
+}
+
+static std::string toHex(const uint8_t *bytes, size_t len) {
+    std::string s;
+    char buf[3];
+    for (size_t i = 0; i < len; ++i) {
+        snprintf(buf, sizeof(buf), "%02x", bytes[i]);
+        s += buf;
+    }
+    return s;
+}
+
+static std::string wordsHex(const uint32_t words[5]) {
+    uint8_t bytes[20];
+    for (int i = 0; i < 5; ++i) storeBe32(bytes + i * 4, words[i]);
+    return toHex(bytes, 20);
+}
+
+static const Sha1Backend SHA1_BACKEND_UNROLLED = {"unrolled", sha1CompressUnrolled, nullptr, nullptr, true};
+
+static void testHmac() {
+    // HMAC("key", bytes i % 251): one and two tail blocks, whole blocks before the tail
+    static const struct {
+        size_t len;
+        const char *digest;
+    } cases[] = {
+        {0,   "f42bb0eeb018ebbd4597ae7213711ec60760843f"},
+        {20,  "ccd022cf7070754a9389da58aca04b9b6d8311e9"},
+        {55,  "59eba1ecd24c7c10c4c7c45f808ea46b4e425511"},
+        {56,  "1b367ffb22e88f095e0bb8e02ac8631518b2dd66"},
+        {63,  "0546168f33b33fc453b270eee82e527cf0c263cd"},
+        {64,  "be8461049908529f6f7aea5447ba4b1a7d91eb42"},
+        {119, "e25ae395ad54b16996316eb28c47c11d7662c8d9"},
+        {120, "442a9158ab4793067eaef8397d1d2e94a5f7bcf3"},
+        {200, "981f337ec5abdde5df6c1b0fe26350cb520da041"},
+    };
+    uint8_t msg[200];
+    for (size_t i = 0; i < sizeof(msg); ++i) msg[i] = i % 251;
+    for (Sha1CompressFn compress : {sha1Compress, sha1CompressUnrolled}) {
+        HmacSha1Midstate hmac(compress);
+        CHECK(hmac.setKey((const uint8_t *)"key", 3));
+        uint32_t out[5];
+        for (const auto &c : cases) {
+            hmac.digest(msg, c.len, out);
+            if (wordsHex(out) != c.digest) {
+                fprintf(stderr, "HMAC of %zu bytes: %s\n", c.len, wordsHex(out).c_str());
+                CHECK(false);
+            }
+        }
+        // the PBKDF2 inner loop form gives the same as the byte form
+        uint32_t words[5];
+        for (int i = 0; i < 5; ++i) words[i] = loadBe32(msg + i * 4);
+        hmac.digestWords(words, out);
+        CHECK(wordsHex(out) == cases[1].digest);
+
+        // RFC 2202 test case 1
+        uint8_t key[20];
+        memset(key, 0x0b, sizeof(key));
+        CHECK(hmac.setKey(key, sizeof(key)));
+        hmac.digest((const uint8_t *)"Hi There", 8, out);
+        CHECK(wordsHex(out) == "b617318655057264e28bc0b6fb378c8ef146be00");
+
+        uint8_t longKey[65] = {0};
+        CHECK(hmac.setKey(longKey, 64));
+        CHECK(!hmac.setKey(longKey, 65));
+    }
+}
+
+static std::string pmkHex(const Sha1Backend &backend, const std::string &pass, const std::string &ssid) {
+    uint8_t pmk[32];
+    const uint8_t *ssidBytes = (const uint8_t *)ssid.data();
+    const bool ok = wpaDerivePmk(pass.data(), pass.size(), ssidBytes, ssid.size(), pmk, nullptr, backend);
+    return ok ? toHex(pmk, 32) : "<refused>";
+}
+
+static void testPmk() {
+    // IEEE 802.11i-2004 H.4.2, then the shortest and longest passphrases this accepts
+    static const struct {
+        std::string pass, ssid;
+        const char *pmk;
+    } cases[] = {
+        {"password",
+         "IEEE",
+         "f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e"},
+        {"ThisIsAPassword",
+         "ThisIsASSID",
+         "0dc0d6eb90555ed6419756b9a15ec3e3209b63df707dd508d14581f8982721af"},
+        {std::string(32, 'a'),
+         std::string(32, 'Z'),
+         "becb93866bb8c3832cb777c2f559807c8c59afcb6eae734885001300a981cc62"},
+        {"x",
+         "bruce",
+         "fc8eb2d706b787b10bac9f369a48dd3d0ce0704b8728cc2cc3303fb7975860ae"},
+        {std::string(63, '~'),
+         "bruce",
+         "9792fa16896004122d7cc217ea3b95d154a6eb8aaef74465d8b16bd9fd40a230"},
+    };
+    for (const Sha1Backend *backend : {&SHA1_BACKEND_PORTABLE, &SHA1_BACKEND_UNROLLED}) {
+        for (const auto &c : cases) {
+            const std::string got = pmkHex(*backend, c.pass, c.ssid);
+            if (got != c.pmk) {
+                fprintf(
+                    stderr,
+                    "%s: PMK of %s / %s: %s\n",
+                    backend->name,
+                    c.pass.c_str(),
+                    c.ssid.c_str(),
+                    got.c_str()
+                );
+                CHECK(false);
+            }
+        }
+    }
+    CHECK(pmkHex(SHA1_BACKEND_PORTABLE, "", "bruce") == "<refused>");
+    CHECK(pmkHex(SHA1_BACKEND_PORTABLE, std::string(64, '~'), "bruce") == "<refused>");
+    CHECK(pmkHex(SHA1_BACKEND_PORTABLE, "password", std::string(33, 'Z')) == "<refused>");
+    CHECK(pmkHex(SHA1_BACKEND_PORTABLE, "password", "") != "<refused>");
+
+    // abort is polled inside the iterations
+    uint8_t pmk[32];
+    volatile bool abort = true;
+    CHECK(!wpaDerivePmk("password", 8, (const uint8_t *)"IEEE", 4, pmk, &abort));
+    abort = false;
+    CHECK(wpaDerivePmk("password", 8, (const uint8_t *)"IEEE", 4, pmk, &abort));
+}
+
+// Begin/end hooks run once around each derivation
+static int hookDepth = 0, hookRuns = 0;
+static void hookBegin() {
+    hookDepth++;
+    hookRuns++;
+}
+static void hookEnd() { hookDepth--; }
+
+static void testHooks() {
+    const Sha1Backend hooked = {"hooked", sha1Compress, hookBegin, hookEnd, false};
+    uint8_t pmk[32];
+    CHECK(wpaDerivePmk("password", 8, (const uint8_t *)"IEEE", 4, pmk, nullptr, hooked));
+    CHECK(!wpaDerivePmk("", 0, (const uint8_t *)"IEEE", 4, pmk, nullptr, hooked));
+    CHECK_EQ(hookRuns, 2);
+    CHECK_EQ(hookDepth, 0);
+}
+
+// M2 of a handshake for "ThisIsAPassword" on "ThisIsASSID", MIC computed with Python's hmac
+static const uint8_t AP[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x03};
+static const uint8_t STA[6] = {0x0A, 0x11, 0x22, 0x33, 0x44, 0x55};
+
+static void makeM2(uint8_t anonce[32], uint8_t snonce[32], uint8_t frame[121]) {
+    for (int i = 0; i < 32; ++i) {
+        anonce[i] = 0x10 + i;
+        snonce[i] = 0x60 + i;
+    }
+    static const uint8_t rsn[22] = {
+        0x30, 20, 1, 0, 0, 0x0F, 0xAC, 4, 1, 0, 0, 0x0F, 0xAC, 4, 1, 0, 0, 0x0F, 0xAC, 2, 0, 0,
+    };
+    memset(frame, 0, 121);
+    frame[0] = 1;    // version
+    frame[1] = 3;    // EAPOL-Key
+    frame[3] = 117;  // body length
+    frame[4] = 2;    // RSN descriptor
+    frame[5] = 0x01; // key info: MIC, pairwise, version 2
+    frame[6] = 0x0A;
+    frame[14] = 1;   // replay counter
+    memcpy(frame + 17, snonce, 32);
+    frame[98] = sizeof(rsn);
+    memcpy(frame + 99, rsn, sizeof(rsn));
+    fromHex("ee7f6d35c911a553eea85d25fb717be3", frame + 81);
+}
+
+static void testMic() {
+    uint8_t pmk[32], wrong[32];
+    CHECK(wpaDerivePmk("ThisIsAPassword", 15, (const uint8_t *)"ThisIsASSID", 11, pmk));
+    CHECK(wpaDerivePmk("ThisIsAPasswore", 15, (const uint8_t *)"ThisIsASSID", 11, wrong));
+
+    uint8_t anonce[32], snonce[32], frame[121];
+    makeM2(anonce, snonce, frame);
+    WpaHandshakeVector v;
+    CHECK(v.init(AP, STA, anonce, snonce, frame, sizeof(frame), frame + 81));
+    CHECK(!v.isPmkid());
+    CHECK_EQ(v.eapolLen, 121);
+    CHECK_EQ(v.prfLen, 100);
+    CHECK(memcmp(v.eapol, frame, 81) == 0);
+    CHECK(memcmp(v.eapol + 81, std::string(16, '\0').data(), 16) == 0); // the MIC is zeroed
+    CHECK(memcmp(v.eapol + 97, frame + 97, 121 - 97) == 0);
+    CHECK(v.pmkMatches(pmk));
+    CHECK(!v.pmkMatches(wrong));
+
+    // the PRF input is sorted, so which side is which does not matter
+    WpaHandshakeVector swapped;
+    CHECK(swapped.init(STA, AP, snonce, anonce, frame, sizeof(frame), frame + 81));
+    CHECK(swapped.pmkMatches(pmk));
+
+    // a MIC off by one bit, or a frame byte changed next to the MIC, fails
+    uint8_t mic[16];
+    memcpy(mic, frame + 81, 16);
+    mic[15] ^= 1;
+    CHECK(v.init(AP, STA, anonce, snonce, frame, sizeof(frame), mic));
+    CHECK(!v.pmkMatches(pmk));
+    frame[80] ^= 1;
+    CHECK(v.init(AP, STA, anonce, snonce, frame, sizeof(frame), frame + 81));
+    CHECK(!v.pmkMatches(pmk));
+    frame[80] ^= 1;
+    frame[97] ^= 1;
+    CHECK(v.init(AP, STA, anonce, snonce, frame, sizeof(frame), frame + 81));
+    CHECK(!v.pmkMatches(pmk));
+    frame[97] ^= 1;
+
+    // the frame has to hold the MIC and fit the buffer
+    uint8_t big[WpaHandshakeVector::MAX_EAPOL_LEN + 1] = {0};
+    CHECK(!v.init(AP, STA, anonce, snonce, frame, 81 + 15, frame + 81));
+    CHECK(v.init(AP, STA, anonce, snonce, big, 81 + 16, big + 81));
+    CHECK(v.init(AP, STA, anonce, snonce, big, WpaHandshakeVector::MAX_EAPOL_LEN, big + 81));
+    CHECK(!v.init(AP, STA, anonce, snonce, big, sizeof(big), big + 81));
+}
+
+static void testPmkid() {
+    uint8_t pmk[32], wrong[32], pmkid[16];
+    CHECK(wpaDerivePmk("ThisIsAPassword", 15, (const uint8_t *)"ThisIsASSID", 11, pmk));
+    CHECK(wpaDerivePmk("ThisIsAPasswore", 15, (const uint8_t *)"ThisIsASSID", 11, wrong));
+    fromHex("3445d645907537bd8e203bd22ca2d5ba", pmkid);
+    WpaHandshakeVector v;
+    v.initPmkid(AP, STA, pmkid);
+    CHECK(v.isPmkid());
+    CHECK(v.pmkMatches(pmk));
+    CHECK(!v.pmkMatches(wrong));
+    v.initPmkid(STA, AP, pmkid); // unlike the PTK, PMKID input is not sorted
+    CHECK(!v.pmkMatches(pmk));
+}
+
+int main() {
+    testHmac();
+    testPmk();
+    testHooks();
+    testMic();
+    testPmkid();
+    return hostTestResult("test_wpa_crypto");
+}
@@ -0,0 +1,199 @@
+// WPA word mangling rules: every operation against a table of inputs and outputs, the rules
+// parseWpaRule() refuses, the 8-63 byte bounds, and each default rule on one word.
+#include "host_test.h"
+#include "modules/wifi/wpa_rules.h"
+#include <string>
+
+// The output of rule on word, "<reject>" when applyWpaRule() refuses, "<parse>" when the rule
+// does not parse
+static std::string apply(const char *ruleText, const std::string &word) {
+    WpaRule rule;
+    if (!parseWpaRule(ruleText, strlen(ruleText), rule)) return "<parse>";
+    char out[WPA_PASSPHRASE_MAX + 1];
+    uint8_t outLen = 0;
+    if (!applyWpaRule(rule, word.data(), (uint8_t)word.size(), out, outLen)) return "<reject>";
+    if (outLen != strlen(out)) return "<length>";
+    return std::string(out, outLen);
+}
+
+struct Case {
+    const char *rule;
+    const char *word;
+    const char *out;
+};
+
+static void testOperations() {
+    static const Case cases[] = {
+        {":",                "PassWord",     "PassWord"       },
+        {"l",                "PassWORD1",    "password1"      },
+        {"u",                "PassWord1!",   "PASSWORD1!"     },
+        {"c",                "pASSWORD",     "Password"       },
+        {"c",                "1PASSWORD",    "1password"      },
+        {"C",                "password",     "pASSWORD"       },
+        {"t",                "PassWord1",    "pASSwORD1"      },
+        {"T0",               "password",     "Password"       },
+        {"T7",               "password",     "passworD"       },
+        {"TA",               "passwordabcd", "passwordabCd"   },
+        {"TA",               "password",     "password"       }, // past the end: nothing
+        {"T3",               "pas$word",     "pas$word"       }, // not a letter
+        {"$1",               "password",     "password1"      },
+        {"$ ",               "password",     "password "      }, // the argument may be a blank
+        {"^1",               "password",     "1password"      },
+        {"^3^2^1",           "password",     "123password"    },
+        {"$1$2$3",           "password",     "password123"    },
+        {"sa@",              "banana12",     "b@n@n@12"       },
+        {"sxy",              "password",     "password"       },
+        {"<8",               "password",     "password"       },
+        {"<7",               "password",     "<reject>"       },
+        {">8",               "password",     "password"       },
+        {">9",               "password",     "<reject>"       },
+        {"<A",               "passwordab",   "passwordab"     },
+        {">A",               "passwordab",   "passwordab"     },
+        {">B",               "passwordab",   "<reject>"       },
+        {"$d>8",             "passwor",      "password"       }, // checks the length at that point
+        {">8$d",             "passwor",      "<reject>"       },
+        {"csa@se3si1so0",    "passionate",   "P@ss10n@t3"     },
+        {"u sa4 $!",         "password",     "PASSWORD!"      }, // s is case sensitive
+        {"l\t$1\r",          "PASSWORD",     "password1"      },
+    };
+    for (const Case &c : cases) {
+        const std::string got = apply(c.rule, c.word);
+        if (got != c.out) {
+            fprintf(
+                stderr, "rule \"%s\" on \"%s\": \"%s\", expected \"%s\"\n", c.rule, c.word, got.c_str(), c.out
+            );
+            CHECK(got == c.out);
+        }
+    }
+}
+
+static void testParse() {
+    static const char *const refused[] = {
+        "",                  // nothing
+        " \t",               // nothing either
+        "x",                 // unsupported
+        "d",                 // hashcat has it, this subset does not
+        "$",                 // arguments missing
+        "^",
+        "s1",
+        "T",
+        "Ta",                // positions are 0-9 then A-Z
+        "<!",
+        ">z",
+        ":$1$2$3$4$5$6$7$8", // 17 bytes
+    };
+    WpaRule rule;
+    for (const char *text : refused) {
+        if (parseWpaRule(text, strlen(text), rule)) {
+            fprintf(stderr, "rule \"%s\" parses\n", text);
+            CHECK(false);
+        }
+    }
+    CHECK(parseWpaRule("$1$2$3$4$5$6$7$8", 16, rule));
+    CHECK_EQ(rule.len, WPA_RULE_MAX_LEN);
+    CHECK(parseWpaRule(" $1  $2 ", 8, rule));
+    CHECK_EQ(rule.len, 4);
+    CHECK(memcmp(rule.ops, "$1$2", 4) == 0);
+
+    CHECK_EQ(wpaRulePosition('0'), 0);
+    CHECK_EQ(wpaRulePosition('9'), 9);
+    CHECK_EQ(wpaRulePosition('A'), 10);
+    CHECK_EQ(wpaRulePosition('Z'), 35);
+    CHECK_EQ(wpaRulePosition('a'), -1);
+}
+
+// Results outside 8-63 bytes are dropped, whatever the rule did on the way
+static void testBounds() {
+    CHECK_STR(apply(":", "short").c_str(), "<reject>");
+    CHECK_STR(apply("$1$2$3", "short").c_str(), "short123");
+    CHECK_STR(apply("$1$2", "short").c_str(), "<reject>");
+
+    const std::string max(WPA_PASSPHRASE_MAX, 'a');
+    CHECK(apply(":", max) == max);
+    CHECK_STR(apply("$1", max).c_str(), "<reject>");
+    CHECK_STR(apply("^1", max).c_str(), "<reject>");
+    CHECK_STR(apply(":", max + "a").c_str(), "<reject>"); // the word itself is too long
+    CHECK(apply("T0", max) == "A" + max.substr(1));
+    CHECK(apply("TZ", max) == max.substr(0, 35) + "A" + max.substr(36));
+
+    // the longest rule on the longest word stays inside the work buffer
+    CHECK_STR(apply("$1$2$3$4$5$6$7$8", max).c_str(), "<reject>");
+    CHECK_STR(apply("^1^2^3^4^5^6^7^8", max).c_str(), "<reject>");
+    const std::string shorter(WPA_PASSPHRASE_MAX - 8, 'a');
+    CHECK(apply("$1$2$3$4$5$6$7$8", shorter) == shorter + "12345678");
+    CHECK(apply("^1^2^3^4^5^6^7^8", shorter) == "87654321" + shorter);
+    CHECK_STR(apply("$1$2$3$4$5$6$7$8", shorter + "a").c_str(), "<reject>");
+}
+
+// The defaults in order, each on a word that every substitution touches
+static void testDefaults() {
+    static const char *const expected[] = {
+        // : c u l C t
+        "passionate", "Passionate", "PASSIONATE", "passionate", "pASSIONATE", "PASSIONATE",
+        // $! c$! c$1 $1$2$3 c$1$2$3 $1$2$3$4 c$1$2$3$4
+        "passionate!", "Passionate!", "Passionate1", "passionate123", "Passionate123", "passionate1234",
+        "Passionate1234",
+        // ^1 ^3^2^1
+        "1passionate", "123passionate",
+        // sa@ se3 si1 so0 ss$ sa@se3si1so0 csa@se3si1so0
+        "p@ssion@te", "passionat3", "pass1onate", "passi0nate", "pa$$ionate", "p@ss10n@t3", "P@ss10n@t3",
+    };
+    const size_t fixed = sizeof(expected) / sizeof(expected[0]);
+    WpaRuleSet rules;
+    CHECK(rules.init(512));
+    rules.addDefaults();
+    CHECK_EQ(rules.count(), fixed + 10 + 100 + 2 * 61);
+    if (rules.count() != fixed + 10 + 100 + 2 * 61) return;
+
+    const std::string word = "passionate";
+    char out[WPA_PASSPHRASE_MAX + 1];
+    uint8_t outLen;
+    for (size_t r = 0; r < rules.count(); ++r) {
+        std::string want;
+        if (r < fixed) want = expected[r];
+        else if (r < fixed + 10) want = word + (char)('0' + r - fixed);
+        else if (r < fixed + 110) {
+            const size_t d = r - fixed - 10;
+            want = word + (char)('0' + d / 10) + (char)('0' + d % 10);
+        } else {
+            const size_t y = r - fixed - 110;
+            want = (y % 2 ? "Passionate" : "passionate") + std::to_string(1970 + y / 2);
+        }
+        const bool ok = applyWpaRule(rules.rule(r), word.data(), word.size(), out, outLen);
+        if (!ok || want != std::string(out, outLen)) {
+            fprintf(
+                stderr, "default rule %zu: \"%s\", expected \"%s\"\n", r, ok ? out : "<reject>", want.c_str()
+            );
+            CHECK(false);
+        }
+    }
+}
+
+static void testRuleSet() {
+    WpaRuleSet rules;
+    CHECK(rules.init(3));
+    CHECK(rules.add("# comment"));
+    CHECK(rules.add(""));
+    CHECK(rules.add("\r\n"));
+    CHECK_EQ(rules.count(), 0);
+    CHECK(rules.add("$1\r\n"));
+    CHECK(!rules.add("x"));
+    CHECK(rules.add("c"));
+    CHECK(rules.add("u"));
+    CHECK(!rules.add("l")); // full
+    CHECK(rules.add("# comments still go"));
+    CHECK_EQ(rules.count(), 3);
+    CHECK_EQ(rules.rule(0).len, 2);
+    CHECK(memcmp(rules.rule(0).ops, "$1", 2) == 0);
+    rules.release();
+    CHECK_EQ(rules.count(), 0);
+}
+
+int main() {
+    testOperations();
+    testParse();
+    testBounds();
+    testDefaults();
+    testRuleSet();
+    return hostTestResult("test_wpa_rules");
+}
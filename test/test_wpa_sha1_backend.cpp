@@ -0,0 +1,89 @@
+// SHA1 block functions for WPA recovery: the portable and the unrolled (software backend) one give
+// the same digest on a known message, on the chain the backends are checked against at startup,
+// when a chain switches from one to the other at any block, and from random midstates.
+#include "host_test.h"
+#include "modules/wifi/wpa_sha1_backend.h"
+#include <random>
+
+static const Sha1CompressFn FUNCTIONS[2] = {sha1Compress, sha1CompressUnrolled};
+
+static void testKnownDigest() {
+    // "abc" with its padding, one block
+    uint32_t block[16] = {0x61626380};
+    block[15] = 24;
+    static const uint32_t expected[5] = {0xA9993E36, 0x4706816A, 0xBA3E2571, 0x7850C26C, 0x9CD0D89D};
+    for (Sha1CompressFn compress : FUNCTIONS) {
+        uint32_t state[5];
+        memcpy(state, SHA1_IV, sizeof(state));
+        compress(state, block);
+        CHECK(memcmp(state, expected, sizeof(state)) == 0);
+    }
+}
+
+// The chain wpa_sha1_select() runs, 2000 blocks; the digests come from a Python model
+static void testReferenceChain() {
+    static const uint32_t afterOne[5] = {0xF1CC68C5, 0xCC4B79F5, 0xCDB3775F, 0xA352E50D, 0xBD463E83};
+    static const uint32_t afterAll[5] = {0x3436A9A7, 0xBDF55A48, 0xDCAA65CE, 0x5DC5AF81, 0x97E08308};
+    for (Sha1CompressFn compress : FUNCTIONS) {
+        uint32_t state[5], block[16];
+        sha1ChainStart(state, block);
+        sha1ChainRun(compress, state, block, 0, 1);
+        CHECK(memcmp(state, afterOne, sizeof(state)) == 0);
+        sha1ChainRun(compress, state, block, 1, 1999);
+        CHECK(memcmp(state, afterAll, sizeof(state)) == 0);
+    }
+}
+
+// A chain handed from one function to the other at random blocks, resuming from the midstate the
+// other one left, ends where either alone does
+static void testResume() {
+    uint32_t reference[5], block[16];
+    sha1ChainStart(reference, block);
+    sha1ChainRun(sha1Compress, reference, block, 0, 2000);
+
+    std::mt19937 rng(13);
+    for (int round = 0; round < 200; ++round) {
+        uint32_t state[5];
+        sha1ChainStart(state, block);
+        uint32_t n = 0;
+        int which = rng() % 2;
+        while (n < 2000) {
+            uint32_t count = rng() % 3 ? rng() % 40 : rng() % 400;
+            if (count > 2000 - n) count = 2000 - n;
+            sha1ChainRun(FUNCTIONS[which], state, block, n, count);
+            n += count;
+            which ^= 1;
+        }
+        if (memcmp(state, reference, sizeof(state)) != 0) {
+            fprintf(stderr, "round %d: the switched chain ends elsewhere\n", round);
+            CHECK(false);
+            return;
+        }
+    }
+}
+
+// Any state and any block, such as the HMAC pad midstates the PBKDF2 loop resumes from
+static void testRandomMidstates() {
+    std::mt19937 rng(29);
+    for (int round = 0; round < 20000; ++round) {
+        uint32_t a[5], b[5], block[16];
+        for (uint32_t &w : a) w = rng();
+        for (uint32_t &w : block) w = round % 5 ? rng() : (rng() % 2 ? 0xFFFFFFFF : 0);
+        memcpy(b, a, sizeof(a));
+        sha1Compress(a, block);
+        sha1CompressUnrolled(b, block);
+        if (memcmp(a, b, sizeof(a)) != 0) {
+            fprintf(stderr, "round %d: digests differ\n", round);
+            CHECK(false);
+            return;
+        }
+    }
+}
+
+int main() {
+    testKnownDigest();
+    testReferenceChain();
+    testResume();
+    testRandomMidstates();
+    return hostTestResult("test_wpa_sha1_backend");
+}
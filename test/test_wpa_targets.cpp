@@ -0,0 +1,296 @@
+// WpaTargetSet: one PBKDF2 per SSID group and candidate, groups dropping out once cracked, a
+// target claimed by exactly one of several workers testing the passphrase at once, nothing left
+// to derive when every target is cracked, key descriptor versions other than 2 and a 17th target
+// refused, and 22000 lines parsed into the same targets.
+#include "host_test.h"
+#include "modules/wifi/wpa_targets.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counts PMK derivations: wpaDerivePmk() runs begin() once for each
+static std::atomic<int> derivations{0};
+static void countDerivation() { derivations.fetch_add(1, std::memory_order_relaxed); }
+static const Sha1Backend COUNTING = {"counting", sha1Compress, countDerivation, nullptr, true};
+
+static void macFor(int n, uint8_t prefix, uint8_t mac[6]) {
+    const uint8_t m[6] = {prefix, 0, 0, 0, 0, (uint8_t)n};
+    memcpy(mac, m, 6);
+}
+
+static void pmkFor(const char *pass, const char *ssid, uint8_t pmk[32]) {
+    wpaDerivePmk(pass, strlen(pass), (const uint8_t *)ssid, strlen(ssid), pmk);
+}
+
+static void pmkidFor(const uint8_t pmk[32], const uint8_t ap[6], const uint8_t sta[6], uint8_t pmkid[16]) {
+    WpaHandshakeVector v;
+    v.initPmkid(ap, sta, pmkid);
+    HmacSha1Midstate hmac;
+    uint32_t digest[5];
+    hmac.setKey(pmk, 32);
+    hmac.digest(v.prfData, v.prfLen, digest);
+    for (int i = 0; i < 4; ++i) storeBe32(pmkid + i * 4, digest[i]);
+}
+
+// An M2 with its MIC for pmk; keyInfo low bits are the key descriptor version
+struct M2 {
+    uint8_t anonce[32];
+    uint8_t snonce[32];
+    uint8_t frame[121];
+};
+
+static M2 m2For(const uint8_t pmk[32], const uint8_t ap[6], const uint8_t sta[6], uint8_t keyInfo = 0x0A) {
+    M2 m;
+    for (int i = 0; i < 32; ++i) {
+        m.anonce[i] = 0x10 + i + ap[5];
+        m.snonce[i] = 0x60 + i + sta[5];
+    }
+    memset(m.frame, 0, sizeof(m.frame));
+    m.frame[0] = 1;
+    m.frame[1] = 3;
+    m.frame[3] = 117;
+    m.frame[4] = 2;
+    m.frame[5] = 0x01;
+    m.frame[6] = keyInfo;
+    memcpy(m.frame + 17, m.snonce, 32);
+    WpaHandshakeVector v;
+    v.init(ap, sta, m.anonce, m.snonce, m.frame, sizeof(m.frame), m.frame + 81);
+    HmacSha1Midstate hmac;
+    uint32_t digest[5];
+    uint8_t kck[20];
+    hmac.setKey(pmk, 32);
+    hmac.digest(v.prfData, v.prfLen, digest);
+    for (int i = 0; i < 5; ++i) storeBe32(kck + i * 4, digest[i]);
+    hmac.setKey(kck, 16);
+    hmac.digest(v.eapol, v.eapolLen, digest);
+    for (int i = 0; i < 4; ++i) storeBe32(m.frame + 81 + i * 4, digest[i]);
+    return m;
+}
+
+static bool
+addM2(WpaTargetSet &set, const M2 &m, const uint8_t ap[6], const uint8_t sta[6], const char *ssid) {
+    return set.addEapol(
+        ap,
+        sta,
+        m.anonce,
+        m.snonce,
+        m.frame,
+        sizeof(m.frame),
+        m.frame + 81,
+        ssid,
+        strlen(ssid)
+    );
+}
+
+static bool addPmkid(WpaTargetSet &set, const uint8_t pmk[32], int n, const char *ssid) {
+    uint8_t ap[6], sta[6], pmkid[16];
+    macFor(n, 0x02, ap);
+    macFor(n, 0x0A, sta);
+    pmkidFor(pmk, ap, sta, pmkid);
+    return set.addPmkid(ap, sta, pmkid, ssid, strlen(ssid));
+}
+
+static int testWord(WpaTargetSet &set, const char *word) {
+    return set.test(word, strlen(word), nullptr, COUNTING);
+}
+
+// Three networks: "home" with an M2 and a PMKID, "office" with three targets, "cafe" with one
+static void fillNetworks(WpaTargetSet &set) {
+    uint8_t home[32], office[32], cafe[32];
+    pmkFor("homepassword", "home", home);
+    pmkFor("officepassword", "office", office);
+    pmkFor("cafepassword", "cafe", cafe);
+    uint8_t ap[6], sta[6];
+    macFor(1, 0x02, ap);
+    macFor(1, 0x0A, sta);
+    CHECK(addM2(set, m2For(home, ap, sta), ap, sta, "home"));
+    CHECK(addPmkid(set, home, 2, "home"));
+    for (int n = 3; n <= 5; ++n) CHECK(addPmkid(set, office, n, "office"));
+    macFor(6, 0x02, ap);
+    macFor(6, 0x0A, sta);
+    CHECK(addM2(set, m2For(cafe, ap, sta), ap, sta, "cafe"));
+}
+
+static void testGroups() {
+    WpaTargetSet set;
+    set.clear();
+    fillNetworks(set);
+    CHECK_EQ(set.count(), 6);
+    CHECK_EQ(set.groupCount(), 3);
+
+    derivations = 0;
+    CHECK_EQ(testWord(set, "notthepassword"), 0);
+    CHECK_EQ(derivations, 3); // one per SSID, not one per target
+    CHECK_EQ(set.crackedCount(), 0);
+
+    derivations = 0;
+    CHECK_EQ(testWord(set, "officepassword"), 3);
+    CHECK_EQ(derivations, 3);
+    CHECK_EQ(set.crackedCount(), 3);
+    for (uint8_t i = 0; i < set.count(); ++i) {
+        const bool office = strcmp(set.target(i).ssid, "office") == 0;
+        CHECK(set.isCracked(i) == office);
+        if (office) CHECK_STR(set.target(i).password, "officepassword");
+    }
+
+    // the cracked group drops out
+    derivations = 0;
+    CHECK_EQ(testWord(set, "officepassword"), 0);
+    CHECK_EQ(derivations, 2);
+    CHECK_EQ(testWord(set, "homepassword"), 2); // the M2 and the PMKID
+    CHECK(!set.allCracked());
+    derivations = 0;
+    CHECK_EQ(testWord(set, "cafepassword"), 1);
+    CHECK_EQ(derivations, 1);
+    CHECK(set.allCracked());
+
+    // nothing left: no PBKDF2 at all, which is what lets the workers stop
+    derivations = 0;
+    CHECK_EQ(testWord(set, "anything"), 0);
+    CHECK_EQ(derivations, 0);
+
+    // an abort during the PBKDF2 comes back as -1
+    WpaTargetSet fresh;
+    fresh.clear();
+    fillNetworks(fresh);
+    volatile bool abort = true;
+    CHECK_EQ(fresh.test("homepassword", 12, &abort), -1);
+    CHECK_EQ(fresh.crackedCount(), 0);
+}
+
+// Holds every worker at the end of its PBKDF2 until all of them got there, so that they reach
+// the claim on the same targets together
+static const int CLAIM_WORKERS = 4;
+static std::atomic<int> arrived{0};
+static void waitForAll() {
+    const int round = arrived.fetch_add(1) / CLAIM_WORKERS;
+    while (arrived.load() < (round + 1) * CLAIM_WORKERS) std::this_thread::yield();
+}
+static const Sha1Backend BARRIER = {"barrier", sha1Compress, nullptr, waitForAll, true};
+
+// Every worker tests the passphrase at the same time: each target is claimed by exactly one
+static void testClaim() {
+    uint8_t pmk[32];
+    pmkFor("officepassword", "office", pmk);
+    arrived = 0;
+    for (int round = 0; round < 20; ++round) {
+        WpaTargetSet set;
+        set.clear();
+        for (int n = 1; n <= 8; ++n) CHECK(addPmkid(set, pmk, n, "office"));
+        int hits[CLAIM_WORKERS];
+        std::vector<std::thread> workers;
+        for (int w = 0; w < CLAIM_WORKERS; ++w) {
+            workers.emplace_back([&set, &hits, w]() {
+                hits[w] = set.test("officepassword", 14, nullptr, BARRIER);
+            });
+        }
+        for (std::thread &t : workers) t.join();
+        int total = 0;
+        for (int h : hits) total += h;
+        if (total != 8 || set.crackedCount() != 8) {
+            fprintf(stderr, "round %d: %d claims, %d cracked of 8\n", round, total, set.crackedCount());
+            CHECK(false);
+            return;
+        }
+        for (uint8_t i = 0; i < set.count(); ++i) CHECK_STR(set.target(i).password, "officepassword");
+        CHECK(set.allCracked());
+    }
+}
+
+static void testRefused() {
+    WpaTargetSet set;
+    set.clear();
+    uint8_t pmk[32];
+    pmkFor("homepassword", "home", pmk);
+    uint8_t ap[6], sta[6];
+    macFor(1, 0x02, ap);
+    macFor(1, 0x0A, sta);
+
+    // HMAC-MD5 (1) and AES-CMAC (3) MICs are not implemented
+    CHECK(!addM2(set, m2For(pmk, ap, sta, 0x09), ap, sta, "home"));
+    CHECK(!addM2(set, m2For(pmk, ap, sta, 0x0B), ap, sta, "home"));
+    CHECK_EQ(set.count(), 0);
+    const M2 m = m2For(pmk, ap, sta);
+    CHECK(addM2(set, m, ap, sta, "home"));
+    CHECK(!addM2(set, m, ap, sta, "home")); // the same handshake again
+    CHECK(!set.addPmkid(ap, sta, m.frame, "", 0));
+    CHECK(!set.addPmkid(ap, sta, m.frame, "0123456789abcdef0123456789abcdefX", 33));
+    CHECK_EQ(set.count(), 1);
+
+    // up to WPA_MAX_TARGETS, in up to as many groups
+    for (int n = 2; n <= WPA_MAX_TARGETS; ++n) {
+        const std::string ssid = "net" + std::to_string(n);
+        CHECK(addPmkid(set, pmk, n, ssid.c_str()));
+    }
+    CHECK_EQ(set.count(), WPA_MAX_TARGETS);
+    CHECK_EQ(set.groupCount(), WPA_MAX_TARGETS);
+    CHECK(!addPmkid(set, pmk, 99, "home"));
+    macFor(99, 0x02, ap);
+    CHECK(!addM2(set, m2For(pmk, ap, sta), ap, sta, "home"));
+    CHECK_EQ(set.count(), WPA_MAX_TARGETS);
+    derivations = 0;
+    CHECK_EQ(testWord(set, "homepassword"), 1);
+    CHECK_EQ(derivations, WPA_MAX_TARGETS);
+}
+
+static std::string hex(const uint8_t *b, size_t len) {
+    std::string s;
+    char buf[3];
+    for (size_t i = 0; i < len; ++i) {
+        snprintf(buf, sizeof(buf), "%02x", b[i]);
+        s += buf;
+    }
+    return s;
+}
+
+static void testHc22000() {
+    uint8_t pmk[32], ap[6], sta[6], pmkid[16];
+    pmkFor("homepassword", "home", pmk);
+    macFor(1, 0x02, ap);
+    macFor(1, 0x0A, sta);
+    pmkidFor(pmk, ap, sta, pmkid);
+    const M2 m = m2For(pmk, ap, sta);
+    const std::string essid = hex((const uint8_t *)"home", 4);
+    const std::string macs = hex(ap, 6) + "*" + hex(sta, 6) + "*" + essid;
+    const std::string pmkidLine = "WPA*01*" + hex(pmkid, 16) + "*" + macs + "***\r\n";
+    const std::string eapolLine = "WPA*02*" + hex(m.frame + 81, 16) + "*" + macs + "*" + hex(m.anonce, 32) +
+                                  "*" + hex(m.frame, sizeof(m.frame)) + "*00";
+
+    WpaTargetSet set;
+    set.clear();
+    CHECK(set.addHc22000Line(pmkidLine.c_str()));
+    CHECK(set.addHc22000Line(eapolLine.c_str()));
+    CHECK(!set.addHc22000Line(eapolLine.c_str()));
+    CHECK(!set.addHc22000Line("WPA*03*00"));
+    CHECK(!set.addHc22000Line(("WPA*01*" + hex(pmkid, 15) + "*" + macs).c_str()));
+    M2 md5 = m;
+    md5.frame[6] = 0x09; // key descriptor version 1
+    const std::string md5Line = "WPA*02*" + hex(m.frame + 81, 16) + "*" + macs + "*" + hex(m.anonce, 32) +
+                                "*" + hex(md5.frame, sizeof(md5.frame)) + "*00";
+    CHECK(!set.addHc22000Line(md5Line.c_str()));
+    CHECK_EQ(set.count(), 2);
+    CHECK_EQ(set.groupCount(), 1);
+    CHECK(set.target(0).vector.isPmkid());
+    CHECK(!set.target(1).vector.isPmkid());
+    CHECK_STR(set.target(1).ssid, "home");
+    derivations = 0;
+    CHECK_EQ(testWord(set, "homepassword"), 2);
+    CHECK_EQ(derivations, 1);
+
+    // the fingerprint follows the exact set
+    WpaTargetSet other;
+    other.clear();
+    CHECK(other.addHc22000Line(pmkidLine.c_str()));
+    const uint32_t one = other.fingerprint();
+    CHECK(other.addHc22000Line(eapolLine.c_str()));
+    CHECK(other.fingerprint() != one);
+    CHECK(other.fingerprint() == set.fingerprint());
+}
+
+int main() {
+    testGroups();
+    testClaim();
+    testRefused();
+    testHc22000();
+    return hostTestResult("test_wpa_targets");
+}
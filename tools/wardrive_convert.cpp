@@ -0,0 +1,52 @@
+// Host-side converter for binary wardriving logs (.bwd), same decoder and row formatting the
+// device uses. Build from the repository root:
+//   c++ -std=gnu++17 -O2 -Isrc tools/wardrive_convert.cpp -o wardrive_convert
+// Usage:
+//   wardrive_convert [--kml] input.bwd [output]
+// Without an output path the result goes to stdout.
+#include "modules/gps/wardriving_binlog.h"
+#include <stdio.h>
+
+struct StdioFile {
+    FILE *f;
+    size_t read(uint8_t *buf, size_t len) { return fread(buf, 1, len, f); }
+    size_t write(const uint8_t *buf, size_t len) { return fwrite(buf, 1, len, f); }
+};
+
+int main(int argc, char **argv) {
+    WardriveExportFormat format = WARDRIVE_EXPORT_CSV;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--kml") == 0) {
+        format = WARDRIVE_EXPORT_KML;
+        arg++;
+    }
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [--kml] input.bwd [output]\n", argv[0]);
+        return 2;
+    }
+
+    StdioFile in = {fopen(argv[arg], "rb")};
+    if (!in.f) {
+        perror(argv[arg]);
+        return 1;
+    }
+    StdioFile out = {arg + 1 < argc ? fopen(argv[arg + 1], "wb") : stdout};
+    if (!out.f) {
+        perror(argv[arg + 1]);
+        return 1;
+    }
+
+    const WardriveExportResult result = wardriveExport(in, out, format, "host");
+    fclose(in.f);
+    if (out.f != stdout) fclose(out.f);
+    if (!result.ok) {
+        fprintf(stderr, "%s: not a wardriving log or write failed\n", argv[arg]);
+        return 1;
+    }
+    if (result.damaged) {
+        fprintf(stderr, "warning: skipped %lu damaged spots\n", (unsigned long)result.damaged);
+    }
+    if (result.corrupt) fprintf(stderr, "warning: stopped at a corrupt record\n");
+    fprintf(stderr, "%lu rows\n", (unsigned long)result.rows);
+    return 0;
+}